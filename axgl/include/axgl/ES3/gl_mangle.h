@@ -252,6 +252,7 @@
 #define glGetInternalformativ axglGetInternalformativ 
 
 /* extension */
+#define glBufferStorageEXT axglBufferStorageEXT
 #define glInvalidateCacheAXGL axglInvalidateCache
 
 #endif /* __gl_mangle_h_ */
@@ -51,6 +51,7 @@ extern "C" {
 #define GL_APPLE_copy_texture_levels                            1
 #define GL_APPLE_rgb_422                                        1
 #define GL_APPLE_texture_format_BGRA8888                        1
+#define GL_EXT_buffer_storage                                   1
 #define GL_EXT_color_buffer_half_float                          1
 #define GL_EXT_debug_label                                      1
 #define GL_EXT_debug_marker                                     1
@@ -106,6 +107,16 @@ extern "C" {
 /*------------------------------------------------------------------------*
  * EXT extension tokens
  *------------------------------------------------------------------------*/
+#if GL_EXT_buffer_storage
+#define GL_MAP_PERSISTENT_BIT_EXT                               0x0040
+#define GL_MAP_COHERENT_BIT_EXT                                 0x0080
+#define GL_DYNAMIC_STORAGE_BIT_EXT                              0x0100
+#define GL_CLIENT_STORAGE_BIT_EXT                               0x0200
+#define GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT_EXT                 0x00004000
+#define GL_BUFFER_IMMUTABLE_STORAGE_EXT                         0x821F
+#define GL_BUFFER_STORAGE_FLAGS_EXT                             0x8220
+#endif
+
 #if GL_EXT_color_buffer_half_float
 #define GL_RGBA16F_EXT                                          0x881A
 #define GL_RGB16F_EXT                                           0x881B
@@ -237,6 +248,10 @@ GL_API GLvoid glCopyTextureLevelsAPPLE(GLuint destinationTexture, GLuint sourceT
 /*------------------------------------------------------------------------*
  * EXT extension functions
  *------------------------------------------------------------------------*/
+#if GL_EXT_buffer_storage
+GL_API GLvoid glBufferStorageEXT(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+#endif
+
 #if GL_EXT_debug_label
 GL_API GLvoid glLabelObjectEXT(GLenum type, GLuint object, GLsizei length, const GLchar *label)  __AXGL_AVAILABLE_STARTING(__MAC_NA,__IPHONE_5_0);
 GL_API GLvoid glGetObjectLabelEXT(GLenum type, GLuint object, GLsizei bufSize, GLsizei *length, GLchar *label)  __AXGL_AVAILABLE_STARTING(__MAC_NA,__IPHONE_5_0);
@@ -304,6 +319,7 @@ GL_API GLvoid glProgramUniformMatrix4x3fvEXT(GLuint program, GLint location, GLs
 
 #define GL_CACHE_RENDER_PIPELINE_STATE_BIT_AXGL 0x00000001
 #define GL_CACHE_DEPTH_STENCIL_STATE_BIT_AXGL 0x00000002
+#define GL_CACHE_TEXTURE_POOL_BIT_AXGL 0x00000004
 GL_API void GL_APIENTRY glInvalidateCacheAXGL(GLbitfield flags);
 
 #ifdef __cplusplus
@@ -0,0 +1,126 @@
+﻿// axglExt.h
+// axgl specific extension functions (statistics, resource budgets and loaders)
+#ifndef __axglExt_h_
+#define __axglExt_h_
+
+#include "AXGLAllocator.h" // AXGL_API, AXGL_APIENTRY
+
+#include <cstddef> // std::size_t
+
+// buffer object upload statistics
+struct AXGLBufferUploadStats
+{
+	unsigned long long updateCount;		// glBufferSubData, glUnmapBuffer and glFlushMappedBufferRange writes uploaded to the GPU
+	unsigned long long copyCount;		// GPU copy commands issued for the uploads
+	unsigned long long uploadBytes;		// bytes uploaded (CPU writes into GPU visible memory and GPU copies)
+	unsigned long long coalescedCount;	// writes merged into another copy through the staging memory
+	unsigned long long coalescedBytes;	// bytes uploaded through the staging memory
+};
+
+// get buffer object upload statistics of the current context
+// small writes to a buffer between draws are gathered into one staging copy at the next draw
+AXGL_API void AXGL_APIENTRY axglGetBufferUploadStats(AXGLBufferUploadStats* stats);
+
+// shadow buffer (CPU copy of buffer object data) class
+enum AXGLShadowBufferClass
+{
+	AXGL_SHADOW_BUFFER_STATIC = 0,	// GL_STATIC_*
+	AXGL_SHADOW_BUFFER_DYNAMIC = 1,	// GL_DYNAMIC_*
+	AXGL_SHADOW_BUFFER_STREAM = 2,	// GL_STREAM_*
+	AXGL_SHADOW_BUFFER_ALL = 3
+};
+
+// set shadow buffer memory budget (SIZE_MAX: unlimited)
+// the budget is shared by all contexts, each context releases the shadow buffers it used last and has not written recently
+// while the budget is exceeded (a buffer moves to the context which uses it)
+AXGL_API void AXGL_APIENTRY axglSetShadowBufferBudget(std::size_t size);
+
+// get shadow buffer memory size of all contexts
+AXGL_API std::size_t AXGL_APIENTRY axglGetShadowBufferSize(AXGLShadowBufferClass bufferClass);
+
+// texture upload statistics
+struct AXGLTextureUploadStats
+{
+	std::size_t queueDepth;			// uploads queued or running
+	std::size_t maxQueueDepth;		// peak of queueDepth
+	unsigned long long uploadCount;		// completed uploads
+	unsigned long long uploadBytes;		// source bytes of completed uploads
+	double averageLatencyMs;		// queued to completed
+	double maxLatencyMs;
+	unsigned long long waitCount;		// times the GL thread waited for an upload
+	double waitTimeMs;			// total time the GL thread waited
+	std::size_t stagingPoolSize;		// staging memory kept for reuse
+};
+
+// enable background texture upload thread (default: disabled)
+// large texture uploads are copied to staging memory, then converted and uploaded on a worker thread
+// the first use of the texture waits only if the upload has not finished
+// uploads of all contexts are queued to one worker thread, disabling waits for the queued uploads
+AXGL_API void AXGL_APIENTRY axglSetTextureUploadThreadEnabled(bool enable);
+
+// get texture upload statistics (shared by all contexts)
+AXGL_API void AXGL_APIENTRY axglGetTextureUploadStats(AXGLTextureUploadStats* stats);
+
+// memory category
+enum AXGLMemoryCategory
+{
+	AXGL_MEMORY_TEXTURE = 0,	// all mip levels, array layers and cube faces
+	AXGL_MEMORY_RENDERBUFFER = 1,	// including multisample storage
+	AXGL_MEMORY_BUFFER = 2,
+	AXGL_MEMORY_POOL = 3,		// storage of deleted textures, renderbuffers and orphaned buffers kept for reuse
+	AXGL_MEMORY_SHADOW_BUFFER = 4,	// CPU copies of buffer object data
+	AXGL_MEMORY_STAGING = 5,	// streaming ring buffers and texture upload staging memory
+	AXGL_MEMORY_ALL = 6
+};
+
+// called when the memory size exceeds the budget
+// called on the thread which allocated the memory, GL functions must not be called in the callback (axglGetMemorySize can be called)
+typedef void (*AXGLMemoryBudgetCallback)(std::size_t totalSize, std::size_t budget, void* userData);
+
+// set memory budget and callback (SIZE_MAX: unlimited)
+// the budget covers all categories, the callback is called each time the total size crosses the budget from below
+AXGL_API void AXGL_APIENTRY axglSetMemoryBudget(std::size_t budget, AXGLMemoryBudgetCallback callback, void* userData);
+
+// get memory size of textures, renderbuffers, buffers and the storage axgl keeps for them
+AXGL_API std::size_t AXGL_APIENTRY axglGetMemorySize(AXGLMemoryCategory category);
+
+// texture and renderbuffer storage pool statistics
+struct AXGLTexturePoolStats
+{
+	unsigned long long hitCount;		// storage reused from the pool
+	unsigned long long missCount;		// storage newly allocated
+	std::size_t pooledCount;		// deleted storage kept for reuse
+	std::size_t pooledBytes;		// GPU memory of pooled storage (axglGetMemorySize(AXGL_MEMORY_POOL) also includes orphaned buffers)
+};
+
+// get storage pool statistics of the current context
+// storage of deleted textures and renderbuffers is reused by new ones of the same format, size, mip levels, samples and usage
+// glInvalidateCacheAXGL(GL_CACHE_TEXTURE_POOL_BIT_AXGL) releases the pooled storage
+AXGL_API void AXGL_APIENTRY axglGetTexturePoolStats(AXGLTexturePoolStats* stats);
+
+// load a KTX (version 1) or KTX2 file into the texture bound to the active texture unit
+// the file is memory-mapped and every mip level, cube face and 3D slice is uploaded directly from the mapping
+// the target (GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP or GL_TEXTURE_3D) is decided by the file and returned in target (can be NULL)
+// array textures, compressed 3D textures and images the texture storage can not be created for fail with GL_INVALID_OPERATION
+// pixel unpack parameters and GL_PIXEL_UNPACK_BUFFER are ignored, supercompressed KTX2 files are not supported
+// mipmaps are generated when the file has no mip levels (uncompressed, non-integer and non-depth formats only)
+AXGL_API bool AXGL_APIENTRY axglTexImageKTXFile(const char* path, unsigned int* target);
+
+// same as axglTexImageKTXFile for KTX/KTX2 file data in memory (e.g. mapped by the application)
+// data can be released when the function returns
+AXGL_API bool AXGL_APIENTRY axglTexImageKTX(const void* data, std::size_t size, unsigned int* target);
+
+// render pass statistics
+struct AXGLRenderPassStats
+{
+	unsigned long long passCount;		// render passes started
+	unsigned long long loadSkippedCount;	// attachments not loaded at the start of a pass (invalidated by glInvalidateFramebuffer)
+	unsigned long long storeSkippedCount;	// attachments not stored at the end of a pass (invalidated by glInvalidateFramebuffer)
+};
+
+// get render pass statistics of the current context
+// glInvalidateFramebuffer and glInvalidateSubFramebuffer covering the whole framebuffer skip the store of the current pass
+// (when nothing is drawn after the invalidation) and the load of the next pass, other sub-regions are ignored
+AXGL_API void AXGL_APIENTRY axglGetRenderPassStats(AXGLRenderPassStats* stats);
+
+#endif // __axglExt_h_
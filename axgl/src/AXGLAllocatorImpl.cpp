@@ -12,6 +12,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #ifdef USE_VS_CRTDBG
 #include <crtdbg.h>
 #endif
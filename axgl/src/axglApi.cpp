@@ -4,6 +4,7 @@
 #include "axglApi.h"
 #include "AXGLAllocatorImpl.h"
 #include "common/axglCommon.h"
+#include "common/MappedFile.h"
 #include "core/CoreContext.h"
 #include "backend/Backend.h"
 
@@ -2503,6 +2504,17 @@ void GL_APIENTRY glGetInternalformativ(GLenum target, GLenum internalformat, GLe
 //======================================================================
 // Extension API
 
+// イミュータブルなバッファストレージを確保する(GL_EXT_buffer_storage)
+void GL_APIENTRY glBufferStorageEXT(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags)
+{
+	axgl::CoreContext* context = axgl::getCurrentContext();
+	if (context == nullptr) {
+		return;
+	}
+	context->bufferStorage(target, size, data, flags);
+	return;
+}
+
 // キャッシュのInvalidateを実行する
 void GL_APIENTRY glInvalidateCacheAXGL(GLbitfield flags)
 {
@@ -2513,3 +2525,72 @@ void GL_APIENTRY glInvalidateCacheAXGL(GLbitfield flags)
 	context->invalidateCache(flags);
 	return;
 }
+
+// テクスチャ、レンダーバッファのストレージのプールの統計を取得する
+void AXGL_APIENTRY axglGetTexturePoolStats(AXGLTexturePoolStats* stats)
+{
+	if (stats == nullptr) {
+		return;
+	}
+	axgl::CoreContext* context = axgl::getCurrentContext();
+	if (context == nullptr) {
+		*stats = {};
+		return;
+	}
+	context->getTexturePoolStats(stats);
+	return;
+}
+
+// レンダーパスの統計を取得する
+void AXGL_APIENTRY axglGetRenderPassStats(AXGLRenderPassStats* stats)
+{
+	if (stats == nullptr) {
+		return;
+	}
+	axgl::CoreContext* context = axgl::getCurrentContext();
+	if (context == nullptr) {
+		*stats = {};
+		return;
+	}
+	context->getRenderPassStats(stats);
+	return;
+}
+
+// バッファ更新の統計を取得する
+void AXGL_APIENTRY axglGetBufferUploadStats(AXGLBufferUploadStats* stats)
+{
+	if (stats == nullptr) {
+		return;
+	}
+	axgl::CoreContext* context = axgl::getCurrentContext();
+	if (context == nullptr) {
+		*stats = {};
+		return;
+	}
+	context->getBufferUploadStats(stats);
+	return;
+}
+
+// KTX、KTX2ファイルをメモリにマップしてテクスチャに設定する
+bool AXGL_APIENTRY axglTexImageKTXFile(const char* path, unsigned int* target)
+{
+	axgl::CoreContext* context = axgl::getCurrentContext();
+	if (context == nullptr) {
+		return false;
+	}
+	axgl::MappedFile file;
+	if (!file.open(path)) {
+		return false;
+	}
+	return context->texImageKTX(file.getData(), file.getSize(), target);
+}
+
+// メモリ上のKTX、KTX2ファイルのデータをテクスチャに設定する
+bool AXGL_APIENTRY axglTexImageKTX(const void* data, std::size_t size, unsigned int* target)
+{
+	axgl::CoreContext* context = axgl::getCurrentContext();
+	if (context == nullptr) {
+		return false;
+	}
+	return context->texImageKTX(data, size, target);
+}
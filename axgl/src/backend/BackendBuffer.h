@@ -16,7 +16,9 @@ public:
 		ConversionModeTriFanIndices8 = 1,
 		ConversionModeTriFanIndices16 = 2,
 		ConversionModeTriFanIndices32 = 3,
-		ConversionModeTriFanVertices = 4
+		ConversionModeLineLoopIndices8 = 4,
+		ConversionModeLineLoopIndices16 = 5,
+		ConversionModeLineLoopIndices32 = 6
 	};
 
 public:
@@ -24,6 +26,7 @@ public:
 	virtual bool initialize(BackendContext* context) = 0;
 	virtual void terminate(BackendContext* context) = 0;
 	virtual bool setData(BackendContext* context, GLsizeiptr size, const void* data, GLenum usage) = 0;
+	virtual bool setStorage(BackendContext* context, GLsizeiptr size, const void* data, GLbitfield flags) = 0;
 	virtual bool setSubData(BackendContext* context, GLintptr offset, GLsizeiptr size, const void* data) = 0;
 	virtual bool mapRange(BackendContext* context, GLintptr offset, GLsizeiptr length, GLenum access, void** mapPointer) = 0;
 	virtual bool unmap(BackendContext* context) = 0;
@@ -12,6 +12,7 @@ struct DrawParameters;
 struct ClearParameters;
 struct BackendRenderbufferFormat;
 class BackendSync;
+class BackendBuffer;
 class BackendFramebuffer;
 class BackendProgram;
 class BackendVertexArray;
@@ -73,6 +74,39 @@ public:
 		GLint subpixelBits;
 		GLint uniformBufferOffsetAlignment;
 	};
+	// テクスチャ、レンダーバッファのストレージのプールの統計
+	struct TexturePoolStats
+	{
+		uint64_t hitCount;
+		uint64_t missCount;
+		size_t pooledCount;
+		size_t pooledBytes;
+	};
+	// レンダーパスの統計
+	struct RenderPassStats
+	{
+		uint64_t passCount;
+		uint64_t loadSkippedCount;
+		uint64_t storeSkippedCount;
+	};
+	// バッファ更新の統計
+	struct BufferUploadStats
+	{
+		uint64_t updateCount; // glBufferSubData等による更新回数
+		uint64_t copyCount; // 発行したコピーコマンド数
+		uint64_t uploadBytes; // 転送したバイト数
+		uint64_t coalescedCount; // ステージング領域でまとめた更新回数
+		uint64_t coalescedBytes; // ステージング領域で転送したバイト数
+	};
+	// ピクセルパックのパラメータ
+	struct PackParameters {
+		GLint rowLength = 0;
+		GLint skipPixels = 0;
+		GLint skipRows = 0;
+		GLint alignment = 4;
+		// NOTE: GL_PIXEL_PACK_BUFFERのバッファ、設定時はpixelsをバッファ先頭からのオフセットとして扱う
+		BackendBuffer* buffer = nullptr;
+	};
 
 public:
 	virtual ~BackendContext() {}
@@ -91,6 +125,8 @@ public:
 	virtual bool clearBufferfi(GLenum buffer, GLint drawbuffer, GLfloat depth, GLint stencil, const DrawParameters* drawParams) = 0;
 	virtual bool drawArrays(GLenum mode, GLint first, GLsizei count, const DrawParameters* drawParams, const ClearParameters* clearParams) = 0;
 	virtual bool drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices, const DrawParameters* drawParams, const ClearParameters* clearParams) = 0;
+	virtual bool drawRangeElements(GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void* indices,
+		const DrawParameters* drawParams, const ClearParameters* clearParams) = 0;
 	virtual bool drawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount,
 		const DrawParameters* drawParams, const ClearParameters* clearParams) = 0;
 	virtual bool drawElementsInstanced(GLenum mode, GLsizei count, GLsizei type, const void* indices, GLsizei instancecount,
@@ -98,8 +134,12 @@ public:
 	virtual bool flush() = 0;
 	virtual bool finish() = 0;
 	virtual bool readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type,
-		BackendFramebuffer* readFramebuffer, GLenum readBuffer, void* pixels) = 0;
+		BackendFramebuffer* readFramebuffer, GLenum readBuffer, void* pixels, const PackParameters* pack) = 0;
+	virtual bool getImplementationColorReadFormat(BackendFramebuffer* readFramebuffer, GLenum readBuffer, GLenum* format, GLenum* type) = 0;
 	virtual void invalidateCache(GLbitfield flags) = 0;
+	virtual void getTexturePoolStats(TexturePoolStats* stats) const = 0;
+	virtual void getRenderPassStats(RenderPassStats* stats) const = 0;
+	virtual void getBufferUploadStats(BufferUploadStats* stats) const = 0;
 	virtual void discardCachesAssociatedWithProgram(BackendProgram* program) = 0;
 	virtual void discardCachesAssociatedWithVertexArray(BackendVertexArray* vertexArray) = 0;
 
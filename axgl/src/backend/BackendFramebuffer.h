@@ -21,6 +21,8 @@ public:
 		GLenum textarget, GLint level) = 0;
 	virtual bool setTextureLayer(BackendContext* context, GLenum attachment, BackendTexture* texture,
 		GLint level, GLint layer) = 0;
+	virtual void invalidate(BackendContext* context, GLsizei numAttachments, const GLenum* attachments,
+		GLint x, GLint y, GLsizei width, GLsizei height) = 0;
 	virtual GLenum checkStatus() const = 0;
 
 public:
@@ -25,6 +25,8 @@ public:
 	virtual bool createStorageMultisample(BackendContext* context, GLsizei samples,
 		GLenum internalformat, GLsizei width, GLsizei height) = 0;
 	virtual void getStorageInformation(GLenum* format, GLsizei* width, GLsizei* height, GLsizei* samples) = 0;
+	// ストレージのGPUメモリのサイズ(マルチサンプルを含む)
+	virtual size_t getMemorySize() const = 0;
 
 public:
 	static BackendRenderbuffer* create();
@@ -7,6 +7,8 @@
 namespace axgl {
 
 class BackendContext;
+class BackendBuffer;
+class BackendFramebuffer;
 
 class BackendTexture
 {
@@ -20,33 +22,44 @@ public:
 		GLenum swizzleB = GL_BLUE;
 		GLenum swizzleA = GL_ALPHA;
 	};
+	// pixel unpack parameters
+	struct UnpackParameters {
+		GLint rowLength = 0;
+		GLint imageHeight = 0;
+		GLint skipPixels = 0;
+		GLint skipRows = 0;
+		GLint skipImages = 0;
+		GLint alignment = 4;
+		// NOTE: GL_PIXEL_UNPACK_BUFFERのバッファ、設定時はpixelsをバッファ先頭からのオフセットとして扱う
+		BackendBuffer* buffer = nullptr;
+	};
 
 public:
 	virtual ~BackendTexture() {}
 	virtual bool initialize(BackendContext* context) = 0;
 	virtual void terminate(BackendContext* context) = 0;
 	virtual bool setImage2D(BackendContext* context, GLint level, GLenum internalformat,
-		GLsizei width, GLsizei height, GLenum fomrat, GLenum type, const void* pixels, const TextureParameters* params) = 0;
+		GLsizei width, GLsizei height, GLenum fomrat, GLenum type, const void* pixels, const UnpackParameters* unpack, const TextureParameters* params) = 0;
 	virtual bool setSubImage2D(BackendContext* context, GLint level, GLint xoffset, GLint yoffset,
-		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) = 0;
+		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack) = 0;
 	virtual bool setCompressedImage2D(BackendContext* context, GLint level, GLenum internalformat,
 		GLsizei width, GLsizei height, GLsizei imageSize, const void* data, const TextureParameters* params) = 0;
 	virtual bool setImageCube(BackendContext* context, GLenum target, GLint level, GLenum internalformat,
-		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const TextureParameters* params) = 0;
+		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack, const TextureParameters* params) = 0;
 	virtual bool setSubImageCube(BackendContext* context, GLenum target, GLint level, GLenum xoffset, GLenum yoffset,
-		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) = 0;
+		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack) = 0;
 	virtual bool setCompressedImageCube(BackendContext* context, GLenum target, GLint level, GLenum internalformat,
 		GLsizei width, GLsizei height, GLsizei imageSize, const void* data, const TextureParameters* params) = 0;
 	virtual bool setImage3D(BackendContext* context, GLint level, GLenum internalformat,
-		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const TextureParameters* params) = 0;
+		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack, const TextureParameters* params) = 0;
 	virtual bool setSubImage3D(BackendContext* context, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
-		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) = 0;
+		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack) = 0;
 	virtual bool setCompressedImage3D(BackendContext* context, GLint level, GLenum internalformat,
 		GLsizei width, GLsizei height, GLsizei depth, GLsizei imageSize, const void* data, const TextureParameters* params) = 0;
 	virtual bool setImage2DArray(BackendContext* context, GLint level, GLenum internalformat,
-		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const TextureParameters* params) = 0;
+		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack, const TextureParameters* params) = 0;
 	virtual bool setSubImage2DArray(BackendContext* context, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
-		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) = 0;
+		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack) = 0;
 	virtual bool setCompressedImage2DArray(BackendContext* context, GLint level, GLenum internalformat,
 		GLsizei width, GLsizei height, GLsizei depth, GLsizei imageSize, const void* data, const TextureParameters* params) = 0;
 	virtual bool createStorage2D(BackendContext* context, GLsizei levels, GLenum internalformat,
@@ -58,6 +71,13 @@ public:
 	virtual bool createStorage2DArray(BackendContext* context, GLsizei levels, GLenum internalformat,
 		GLsizei width, GLsizei height, GLsizei depth, const TextureParameters* params) = 0;
 	virtual bool generateMipmap(BackendContext* context, const TextureParameters* params) = 0;
+	// リードフレームバッファのカラーバッファからコピー(targetは2Dまたはキューブマップの面)
+	virtual bool copyImage2D(BackendContext* context, GLenum target, GLint level, GLenum internalformat,
+		GLint x, GLint y, GLsizei width, GLsizei height, BackendFramebuffer* readFramebuffer, GLenum readBuffer, const TextureParameters* params) = 0;
+	virtual bool copySubImage2D(BackendContext* context, GLenum target, GLint level, GLint xoffset, GLint yoffset,
+		GLint x, GLint y, GLsizei width, GLsizei height, BackendFramebuffer* readFramebuffer, GLenum readBuffer) = 0;
+	// ストレージのGPUメモリのサイズ(全てのミップマップレベル、スライスを含む)
+	virtual size_t getMemorySize() const = 0;
 
 public:
 	static BackendTexture* create();
@@ -30,6 +30,7 @@ MTLCullMode convert_cull_mode(int32_t enable, int32_t mode);
 MTLPixelFormat get_pixel_format(int32_t format, int32_t type);
 NSUInteger get_bytes_per_pixel(int32_t format, int32_t type);
 NSUInteger get_bytes_per_row_blocks(int32_t format, int32_t width);
+bool is_compressed_format_supported(id<MTLDevice> device, int32_t internalformat);
 int32_t get_shader_data_type(MTLDataType type);
 uint32_t get_size_from_gltype(int32_t gltype);
 int32_t get_internalformat(MTLPixelFormat pixelFormat);
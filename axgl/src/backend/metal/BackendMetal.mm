@@ -2,6 +2,7 @@
 #include "BackendMetal.h"
 #include "../../common/axglCommon.h"
 #include "../../common/axglDebug.h"
+#include "../../common/TextureTranscoder.h"
 
 namespace axgl {
 
@@ -15,8 +16,8 @@ MTLPrimitiveType convert_primitive_type(int32_t mode)
 		mtl_type = MTLPrimitiveTypeLineStrip;
 		break;
 	case GL_LINE_LOOP:
-		AXGL_DBGOUT("GL_LINE_LOOP is not supported\n");
-		mtl_type = MTLPrimitiveTypeLine;
+		// NOTE: LineLoopはインデックスでループを閉じたLineStripとして描画する
+		mtl_type = MTLPrimitiveTypeLineStrip;
 		break;
 	case GL_LINES:
 		mtl_type = MTLPrimitiveTypeLine;
@@ -160,8 +161,7 @@ MTLVertexFormat convert_vertex_format(int32_t type, int32_t size, bool normalize
 			vertex_format = MTLVertexFormatFloat; // ignore normalized
 			break;
 		case GL_FIXED:
-			// Unsupported
-			AXGL_ASSERT(0);
+			vertex_format = MTLVertexFormatFloat; // converted to float on CPU
 			break;
 		case GL_INT_2_10_10_10_REV:
 			// Incorrect: size==4 only
@@ -203,8 +203,7 @@ MTLVertexFormat convert_vertex_format(int32_t type, int32_t size, bool normalize
 			vertex_format = MTLVertexFormatFloat2; // ignore normalized
 			break;
 		case GL_FIXED:
-			// Unsupported
-			AXGL_ASSERT(0);
+			vertex_format = MTLVertexFormatFloat2; // converted to float on CPU
 			break;
 		case GL_INT_2_10_10_10_REV:
 			// Incorrect: size==4 only
@@ -246,8 +245,7 @@ MTLVertexFormat convert_vertex_format(int32_t type, int32_t size, bool normalize
 			vertex_format = MTLVertexFormatFloat3; // ignore normalized
 			break;
 		case GL_FIXED:
-			// Unsupported
-			AXGL_ASSERT(0);
+			vertex_format = MTLVertexFormatFloat3; // converted to float on CPU
 			break;
 		case GL_INT_2_10_10_10_REV:
 			// Incorrect: size==4 only
@@ -289,14 +287,14 @@ MTLVertexFormat convert_vertex_format(int32_t type, int32_t size, bool normalize
 			vertex_format = MTLVertexFormatFloat4; // ignore normalized
 			break;
 		case GL_FIXED:
-			// Unsupported
-			AXGL_ASSERT(0);
+			vertex_format = MTLVertexFormatFloat4; // converted to float on CPU
 			break;
 		case GL_INT_2_10_10_10_REV:
-			vertex_format = MTLVertexFormatInt1010102Normalized; // force normalized
+			// NOTE: 正規化しない場合はCPUでfloat4に変換する
+			vertex_format = (normalized) ? MTLVertexFormatInt1010102Normalized : MTLVertexFormatFloat4;
 			break;
 		case GL_UNSIGNED_INT_2_10_10_10_REV:
-			vertex_format = MTLVertexFormatUInt1010102Normalized; // force normalized
+			vertex_format = (normalized) ? MTLVertexFormatUInt1010102Normalized : MTLVertexFormatFloat4;
 			break;
 		default:
 			break;
@@ -388,6 +386,14 @@ MTLPixelFormat convert_internalformat(int32_t internalformat)
 		// RGBA8
 		pixel_format = MTLPixelFormatRGBA8Unorm;
 		break;
+	case GL_LUMINANCE: // unsized internal format
+	case GL_LUMINANCE_ALPHA: // unsized internal format
+		// RGBA8
+		pixel_format = MTLPixelFormatRGBA8Unorm;
+		break;
+	case GL_ALPHA: // unsized internal format
+		pixel_format = MTLPixelFormatA8Unorm;
+		break;
 	case GL_RGB10_A2:
 		pixel_format = MTLPixelFormatRGB10A2Unorm;
 		break;
@@ -500,6 +506,90 @@ MTLPixelFormat convert_internalformat(int32_t internalformat)
 	case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
 		pixel_format = MTLPixelFormatEAC_RGBA8_sRGB;
 		break;
+	case GL_COMPRESSED_RGBA_ASTC_4x4_KHR:
+		pixel_format = MTLPixelFormatASTC_4x4_LDR;
+		break;
+	case GL_COMPRESSED_RGBA_ASTC_5x4_KHR:
+		pixel_format = MTLPixelFormatASTC_5x4_LDR;
+		break;
+	case GL_COMPRESSED_RGBA_ASTC_5x5_KHR:
+		pixel_format = MTLPixelFormatASTC_5x5_LDR;
+		break;
+	case GL_COMPRESSED_RGBA_ASTC_6x5_KHR:
+		pixel_format = MTLPixelFormatASTC_6x5_LDR;
+		break;
+	case GL_COMPRESSED_RGBA_ASTC_6x6_KHR:
+		pixel_format = MTLPixelFormatASTC_6x6_LDR;
+		break;
+	case GL_COMPRESSED_RGBA_ASTC_8x5_KHR:
+		pixel_format = MTLPixelFormatASTC_8x5_LDR;
+		break;
+	case GL_COMPRESSED_RGBA_ASTC_8x6_KHR:
+		pixel_format = MTLPixelFormatASTC_8x6_LDR;
+		break;
+	case GL_COMPRESSED_RGBA_ASTC_8x8_KHR:
+		pixel_format = MTLPixelFormatASTC_8x8_LDR;
+		break;
+	case GL_COMPRESSED_RGBA_ASTC_10x5_KHR:
+		pixel_format = MTLPixelFormatASTC_10x5_LDR;
+		break;
+	case GL_COMPRESSED_RGBA_ASTC_10x6_KHR:
+		pixel_format = MTLPixelFormatASTC_10x6_LDR;
+		break;
+	case GL_COMPRESSED_RGBA_ASTC_10x8_KHR:
+		pixel_format = MTLPixelFormatASTC_10x8_LDR;
+		break;
+	case GL_COMPRESSED_RGBA_ASTC_10x10_KHR:
+		pixel_format = MTLPixelFormatASTC_10x10_LDR;
+		break;
+	case GL_COMPRESSED_RGBA_ASTC_12x10_KHR:
+		pixel_format = MTLPixelFormatASTC_12x10_LDR;
+		break;
+	case GL_COMPRESSED_RGBA_ASTC_12x12_KHR:
+		pixel_format = MTLPixelFormatASTC_12x12_LDR;
+		break;
+	case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR:
+		pixel_format = MTLPixelFormatASTC_4x4_sRGB;
+		break;
+	case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_5x4_KHR:
+		pixel_format = MTLPixelFormatASTC_5x4_sRGB;
+		break;
+	case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_5x5_KHR:
+		pixel_format = MTLPixelFormatASTC_5x5_sRGB;
+		break;
+	case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6x5_KHR:
+		pixel_format = MTLPixelFormatASTC_6x5_sRGB;
+		break;
+	case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6x6_KHR:
+		pixel_format = MTLPixelFormatASTC_6x6_sRGB;
+		break;
+	case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x5_KHR:
+		pixel_format = MTLPixelFormatASTC_8x5_sRGB;
+		break;
+	case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x6_KHR:
+		pixel_format = MTLPixelFormatASTC_8x6_sRGB;
+		break;
+	case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x8_KHR:
+		pixel_format = MTLPixelFormatASTC_8x8_sRGB;
+		break;
+	case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x5_KHR:
+		pixel_format = MTLPixelFormatASTC_10x5_sRGB;
+		break;
+	case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x6_KHR:
+		pixel_format = MTLPixelFormatASTC_10x6_sRGB;
+		break;
+	case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x8_KHR:
+		pixel_format = MTLPixelFormatASTC_10x8_sRGB;
+		break;
+	case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x10_KHR:
+		pixel_format = MTLPixelFormatASTC_10x10_sRGB;
+		break;
+	case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x10_KHR:
+		pixel_format = MTLPixelFormatASTC_12x10_sRGB;
+		break;
+	case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12_KHR:
+		pixel_format = MTLPixelFormatASTC_12x12_sRGB;
+		break;
 #endif // TARGET_OS_IPHONE
 	case 0:
 		// 内部実装で使用している無効フォーマット値
@@ -1397,13 +1487,44 @@ NSUInteger get_bytes_per_row_blocks(int32_t format, int32_t width)
 		break;
 #endif // TARGET_OS_IPHONE
 	default:
-		AXGL_DBGOUT("get_bytes_per_row_blocks> Unknown format:0x%04X\n", format);
+		{
+			// ASTC : 128 bit block
+			CompressedFormatInfo info;
+			if (getCompressedFormatInfo(format, &info)) {
+				bytes_per_row_blocks = ((width + info.blockWidth - 1) / info.blockWidth) * info.blockBytes;
+			} else {
+				AXGL_DBGOUT("get_bytes_per_row_blocks> Unknown format:0x%04X\n", format);
+			}
+		}
 		break;
 	}
 
 	return bytes_per_row_blocks;
 }
 
+bool is_compressed_format_supported(id<MTLDevice> device, int32_t internalformat)
+{
+	CompressedFormatInfo info;
+	if (!getCompressedFormatInfo(internalformat, &info)) {
+		// ETC2/EAC、ASTC以外
+		return true;
+	}
+#if TARGET_OS_IPHONE
+	bool is_astc = ((internalformat >= GL_COMPRESSED_RGBA_ASTC_4x4_KHR) && (internalformat <= GL_COMPRESSED_RGBA_ASTC_12x12_KHR))
+		|| ((internalformat >= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR) && (internalformat <= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12_KHR));
+	if (!is_astc) {
+		// ETC2/EAC : 全てのiOSデバイスで対応
+		return true;
+	}
+	// ASTC : A8以降のGPUで対応
+	return [device supportsFamily:MTLGPUFamilyApple2];
+#else
+	// NOTE: macOSはETC2/EAC、ASTCをCPUでデコードする
+	AXGL_UNUSED(device);
+	return false;
+#endif
+}
+
 int32_t get_shader_data_type(MTLDataType type)
 {
 	int32_t gl_type = 0;
@@ -4,12 +4,16 @@
 #include "BackendMetal.h"
 #include "../BackendBuffer.h"
 #include "../../common/MemoryBuffer.h"
+#include "../../common/ShadowBufferBudget.h"
+#include "../../common/DirtyRangeList.h"
+#include "../../AXGLAllocatorImpl.h"
+#include <unordered_map>
 
 namespace axgl {
 
 class ContextMetal;
 
-class BufferMetal : public BackendBuffer
+class BufferMetal : public BackendBuffer, public ShadowBufferEntry
 {
 public:
 	BufferMetal();
@@ -17,10 +21,13 @@ public:
 	virtual bool initialize(BackendContext* context) override;
 	virtual void terminate(BackendContext* context) override;
 	virtual bool setData(BackendContext* context, GLsizeiptr size, const void* data, GLenum usage) override;
+	virtual bool setStorage(BackendContext* context, GLsizeiptr size, const void* data, GLbitfield flags) override;
 	virtual bool setSubData(BackendContext* context, GLintptr offset, GLsizeiptr size, const void* data) override;
 	virtual bool mapRange(BackendContext* context, GLintptr offset, GLsizeiptr length, GLenum access, void** mapPointer) override;
 	virtual bool unmap(BackendContext* context) override;
 	virtual bool flushMappedRange(BackendContext* context, GLintptr offset, GLsizeiptr length) override;
+	// ShadowBufferEntry
+	virtual bool evictShadowBuffer(const SubmissionSerial* submissionSerial) override;
 
 public:
 	enum {
@@ -31,58 +38,150 @@ public:
 
 public:
 	id<MTLBuffer> getMtlBuffer() const;
-	void setU8U16ConversionMode();
+	void setU8U16ConversionMode(bool primitiveRestart);
 	bool setupBufferInDraw(BackendContext* context,
-		ConversionMode conversion = ConversionModeNone, intptr_t offset = 0, intptr_t size = 0);
-	bool needUpdateWithStrideConversion(uint32_t stride, uint32_t convertedStride) const;
-	bool needUpdateWithStrideAndDataConversion(uint32_t stride, uint32_t convertedStride, ConversionMode conversion, GLint first, GLsizei count) const;
+		ConversionMode conversion = ConversionModeNone, intptr_t offset = 0, intptr_t size = 0, bool primitiveRestart = false);
+	bool needUpdateWithStrideConversion(uint32_t stride, uint32_t convertedStride, uint32_t startVertex, uint32_t endVertex) const;
 	bool needUpdateWithoutConversion() const;
-	int needUpdateWithIndexConversion(ConversionMode conversion, intptr_t iboOffset, intptr_t iboSize, bool isUbyte) const;
-	bool setupBufferWithStrideConversion(ContextMetal* context, uint32_t stride, uint32_t convertedStride);
-	bool setupWithStrideAndDataConversion(ContextMetal* context,
-		uint32_t stride, uint32_t convertedStride, ConversionMode conversion, GLint first, GLsizei count);
+	int needUpdateWithIndexConversion(ConversionMode conversion, intptr_t iboOffset, intptr_t iboSize, bool isUbyte, bool primitiveRestart) const;
+	bool setupBufferWithStrideConversion(ContextMetal* context, uint32_t stride, uint32_t convertedStride, uint32_t startVertex, uint32_t endVertex);
 	bool isMTLBufferDirty() const;
 	void clearMTLBufferDirty();
 	bool isDynamicBuffer() const;
 	size_t getBufferDataSize() const;
-	void copyToDynamicBuffer(id<MTLBuffer> dynamicBuffer, size_t offset) const;
+	void copyToDynamicBuffer(id<MTLBuffer> dynamicBuffer, size_t offset, size_t start, size_t end) const;
+	bool isU8U16ConversionMode() const;
+	bool getIndexRange(intptr_t offset, GLsizei count, GLenum type, bool primitiveRestart, uint32_t* minIndex, uint32_t* maxIndex);
+	uint32_t getConvertedIndexCount() const;
+	bool canUseAsCopySource() const;
+	const uint8_t* getOriginalData() const;
+	void setLastUsedSerial(const SubmissionSerial* submissionSerial, uint64_t serial);
+	id<MTLBuffer> getFormatConvertedBuffer(ContextMetal* context, GLenum type, GLint size, GLboolean normalized,
+		uint32_t offset, uint32_t stride, uint32_t startVertex, uint32_t endVertex);
+	size_t getStorageSize() const;
+	id<MTLBuffer> beginGpuWrite(ContextMetal* context, size_t start, size_t end);
+	void resolveGpuWrite(ContextMetal* context, bool cpuRead);
 
 private:
 	bool setupMTLBuffer(ContextMetal* context, size_t size, const uint8_t* data);
+	id<MTLBuffer> newSharedBuffer(ContextMetal* context, size_t size, const uint8_t* data);
+	bool allocateDeferredStorage(ContextMetal* context, bool forWrite);
 	bool setupShadowBuffer(size_t size, const uint8_t* data);
 	bool setupShadowBufferForReserved();
+	void acquireShadowBufferBudget(ContextMetal* context);
+	void updateShadowBufferBudget();
+	void updateShadowMemorySize();
 	bool setupWithDataConversion(ContextMetal* context,
-		ConversionMode conversion, intptr_t offset, intptr_t size);
-	bool convertTriFanIndices8(ContextMetal* context, intptr_t offset, intptr_t size);
-	bool convertTriFanIndices16(ContextMetal* context, intptr_t offset, intptr_t size);
-	bool convertTriFanIndices32(ContextMetal* context, intptr_t offset, intptr_t size);
-	
+		ConversionMode conversion, intptr_t offset, intptr_t size, bool primitiveRestart);
+	bool convertTriFanIndices8(ContextMetal* context, intptr_t offset, intptr_t size, bool primitiveRestart);
+	bool convertTriFanIndices16(ContextMetal* context, intptr_t offset, intptr_t size, bool primitiveRestart);
+	bool convertTriFanIndices32(ContextMetal* context, intptr_t offset, intptr_t size, bool primitiveRestart);
+	bool convertLineLoopIndices(ContextMetal* context, ConversionMode conversion, intptr_t offset, intptr_t size, bool primitiveRestart);
+	void widenIndices(uint16_t* dst, const uint8_t* src, size_t count) const;
+	void convertVertexStride(uint8_t* dst, uint32_t stride, uint32_t convertedStride, uint32_t startVertex, uint32_t endVertex) const;
+	void invalidateIndexRangeCache(intptr_t start, intptr_t end);
+	void addDirtyRange(intptr_t start, intptr_t end);
+	void clearDirtyRange();
+	bool uploadDirtyRangesWithStaging(ContextMetal* context);
+	bool uploadDirtyRangesDirect(ContextMetal* context);
+	bool isInFlight(const ContextMetal* context) const;
+	void recycleUsedBuffer(ContextMetal* context, id<MTLBuffer> buffer) const;
+	void discardGpuWrite(ContextMetal* context);
+	void releaseStorage(ContextMetal* context);
+	bool copyGpuWriteInStream(ContextMetal* context);
+	void applyGpuWriteToShadowBuffer(intptr_t start, intptr_t end, const uint8_t* src);
+
 
 private:
+	// index range cache key
+	struct IndexRangeKey {
+		intptr_t offset;
+		GLsizei count;
+		GLenum type;
+		bool primitiveRestart;
+		bool operator==(const IndexRangeKey& rhs) const {
+			return (offset == rhs.offset) && (count == rhs.count) && (type == rhs.type)
+				&& (primitiveRestart == rhs.primitiveRestart);
+		}
+		struct Hash {
+			size_t operator()(const IndexRangeKey& key) const;
+		};
+	};
+	// index range
+	struct IndexRange {
+		uint32_t minIndex;
+		uint32_t maxIndex;
+	};
+	using IndexRangeMap = std::unordered_map<IndexRangeKey, IndexRange, IndexRangeKey::Hash, std::equal_to<IndexRangeKey>, AXGLStlAllocator<std::pair<const IndexRangeKey, IndexRange>>>;
+	// vertex format conversion cache entry
+	struct FormatConversionEntry {
+		GLenum type;
+		GLint size;
+		GLboolean normalized;
+		uint32_t offset;
+		uint32_t stride;
+		// NOTE: 変換済みの頂点範囲[startVertex, endVertex]
+		uint32_t startVertex;
+		uint32_t endVertex;
+		uint32_t generation;
+		id<MTLBuffer> buffer;
+	};
 	enum {
 		SHADOW_BUFFER_STATE_INITIAL = 0,
 		SHADOW_BUFFER_STATE_RESERVED = 1,
-		SHADOW_BUFFER_STATE_CREATED = 2
+		SHADOW_BUFFER_STATE_CREATED = 2,
+		// シャドウバッファを使用せず、永続マップされたMTLBufferがオリジナルデータ
+		SHADOW_BUFFER_STATE_PERSISTENT = 3
 	};
 	MemoryBuffer m_shadowBuffer;
+	ShadowBufferBudget* m_shadowBufferBudget = nullptr; // 使用中のコンテキストの予算管理
+	size_t m_shadowMemorySize = 0; // MemoryAccountingに通知済みのシャドウバッファのサイズ
 	uint32_t m_mapAccessFlags = 0;
 	intptr_t m_mapOffset = 0;
 	intptr_t m_mapLength = 0;
 	id<MTLBuffer> m_srcBuffer = nil;
 	id<MTLBuffer> m_mtlBuffer = nil;
+	// NOTE: GL_MAP_PERSISTENT_BIT_EXTで確保したストレージ(変換時もm_mtlBufferとは別に保持する)
+	id<MTLBuffer> m_persistentBuffer = nil;
+	// NOTE: 永続マップされたストレージのuint8インデックスをuint16に変換するバッファ(描画間で再利用する)
+	id<MTLBuffer> m_widenedIndexBuffer = nil;
 	bool m_mtlBufferDirty = false;
 	intptr_t m_dirtyStart = 0;
 	intptr_t m_dirtyEnd = 0;
+	// NOTE: 書き換えられた範囲を結合して保持(上限を超える場合はm_dirtyStart/m_dirtyEndの1つ)
+	DirtyRangeList m_dirtyRanges;
 	bool m_u8u16ConversionMode = false;
+	bool m_u8u16PrimitiveRestart = false;
 	intptr_t m_setDataSize = 0;
 	uint32_t m_convertedStride = UINT32_MAX;
+	uint32_t m_convertedStartVertex = 0;
+	uint32_t m_convertedEndVertex = 0;
 	ConversionMode m_convertedMode = ConversionModeNone;
 	intptr_t m_convertedOffset = 0;
 	intptr_t m_convertedSize = 0;
-	GLint m_convertedFirst = 0;
-	GLsizei m_convertedCount = 0;
+	bool m_convertedPrimitiveRestart = false;
+	uint32_t m_convertedIndexCount = 0;
 	int m_shadowBufferState = SHADOW_BUFFER_STATE_INITIAL;
+	// NOTE: glBufferData(NULL)のストレージ確保を、最初の書き込みか描画まで遅延している
+	bool m_allocationDeferred = false;
 	GLenum m_usage = 0;
+	IndexRangeMap m_indexRangeCache;
+	AXGLVector<FormatConversionEntry> m_formatConversionCache;
+	// NOTE: データが書き換えられる毎に更新する
+	uint32_t m_generation = 0;
+	// NOTE: 最後に描画で参照したサブミッションのシリアル(m_mtlBufferとm_srcBufferに共通)
+	uint64_t m_lastUsedSerial = 0;
+	// NOTE: m_lastUsedSerialを発行したコンテキストのシリアル(比較のみに使用し、参照はしない)
+	const SubmissionSerial* m_lastUsedSerialSource = nullptr;
+	// NOTE: GPUが書き込むSharedのMTLBuffer(オリジナルデータと同じオフセットで、[m_gpuWriteStart, m_gpuWriteEnd)が有効)
+	// NOTE: 永続マップされたストレージにはGPUが直接書き込むため使用しない
+	id<MTLBuffer> m_gpuWriteBuffer = nil;
+	intptr_t m_gpuWriteStart = 0;
+	intptr_t m_gpuWriteEnd = 0;
+	// NOTE: GPUによる書き込みを記録したサブミッションのシリアル(0は保留中の書き込みなし)
+	uint64_t m_gpuWriteSerial = 0;
+	// NOTE: 書き込みをm_mtlBufferにコピーするBlitを記録済み(シャドウバッファへの反映のみ保留中)
+	bool m_gpuWriteCopied = false;
 };
 
 } // namespace axgl
@@ -2,12 +2,38 @@
 #include "BufferMetal.h"
 #include "ContextMetal.h"
 #include "../../AXGLAllocatorImpl.h"
+#include "../../common/IndexConversion.h"
+#include "../../common/MemoryAccounting.h"
+#include "../../common/VertexConversion.h"
 
 #include <algorithm>
 
 namespace axgl {
 
 static constexpr size_t DYNAMIC_BUFFER_SIZE_THRESHOLD = 4096;
+static constexpr size_t INDEX_RANGE_CACHE_MAX = 256;
+static constexpr size_t FORMAT_CONVERSION_CACHE_MAX = 8;
+static constexpr size_t STAGING_UPLOAD_MAX = 64 * 1024;
+
+// インデックスのサイズ(バイト数)を取得
+static inline intptr_t get_index_type_size(GLenum type)
+{
+	intptr_t size = 0;
+	switch (type) {
+	case GL_UNSIGNED_BYTE:
+		size = sizeof(uint8_t);
+		break;
+	case GL_UNSIGNED_SHORT:
+		size = sizeof(uint16_t);
+		break;
+	case GL_UNSIGNED_INT:
+		size = sizeof(uint32_t);
+		break;
+	default:
+		break;
+	}
+	return size;
+}
 
 // BackendBufferクラスの実装 --------
 BackendBuffer* BackendBuffer::create()
@@ -25,6 +51,16 @@ void BackendBuffer::destroy(BackendBuffer* buffer)
 	return;
 }
 
+// BufferMetal::IndexRangeKey --------
+size_t BufferMetal::IndexRangeKey::Hash::operator()(const IndexRangeKey& key) const
+{
+	size_t h = std::hash<intptr_t>()(key.offset);
+	combineHash(&h, static_cast<size_t>(key.count));
+	combineHash(&h, static_cast<size_t>(key.type));
+	combineHash(&h, static_cast<size_t>(key.primitiveRestart));
+	return h;
+}
+
 // BufferMetalクラスの実装 --------
 BufferMetal::BufferMetal()
 {
@@ -36,36 +72,60 @@ BufferMetal::~BufferMetal()
 
 bool BufferMetal::initialize(BackendContext* context)
 {
-	AXGL_UNUSED(context);
+	AXGL_ASSERT(context != nullptr);
+	m_shadowBufferBudget = &static_cast<ContextMetal*>(context)->getShadowBufferBudget();
 	// 念のため初期値でクリア
 	m_mtlBufferDirty = false;
 	m_mapAccessFlags = 0;
 	m_mapOffset = 0;
 	m_mapLength = 0;
-	m_dirtyStart = 0;
-	m_dirtyEnd = 0;
+	clearDirtyRange();
 	m_u8u16ConversionMode = false;
+	m_u8u16PrimitiveRestart = false;
 	m_setDataSize = 0;
 	m_convertedStride = UINT32_MAX;
+	m_convertedStartVertex = 0;
+	m_convertedEndVertex = 0;
 	m_convertedMode = ConversionModeNone;
 	m_convertedOffset = 0;
 	m_convertedSize = 0;
-	m_convertedFirst = 0;
-	m_convertedCount = 0;
+	m_convertedPrimitiveRestart = false;
+	m_convertedIndexCount = 0;
 	m_shadowBufferState = SHADOW_BUFFER_STATE_INITIAL;
+	m_allocationDeferred = false;
+	m_persistentBuffer = nil;
+	m_indexRangeCache.clear();
+	m_gpuWriteBuffer = nil;
+	m_gpuWriteStart = 0;
+	m_gpuWriteEnd = 0;
+	m_gpuWriteSerial = 0;
+	m_gpuWriteCopied = false;
 	return true;
 }
 
 void BufferMetal::terminate(BackendContext* context)
 {
 	AXGL_UNUSED(context);
+	ShadowBufferBudget::remove(this);
+	m_shadowBufferBudget = nullptr;
 	m_shadowBuffer.releaseResources();
+	updateShadowMemorySize();
 	m_srcBuffer = nil;
 	m_mtlBuffer = nil;
+	m_persistentBuffer = nil;
+	m_widenedIndexBuffer = nil;
 	m_mtlBufferDirty = true;
 	m_mapAccessFlags = 0;
 	m_mapOffset = 0;
 	m_mapLength = 0;
+	m_indexRangeCache.clear();
+	m_formatConversionCache.clear();
+	// NOTE: GPUが書き込み中の場合も、コマンドバッファがMTLBufferを保持する
+	m_gpuWriteBuffer = nil;
+	m_gpuWriteStart = 0;
+	m_gpuWriteEnd = 0;
+	m_gpuWriteSerial = 0;
+	m_gpuWriteCopied = false;
 	return;
 }
 
@@ -74,24 +134,89 @@ bool BufferMetal::setData(BackendContext* context, GLsizeiptr size, const void*
 	AXGL_ASSERT(context != nullptr);
 	ContextMetal* mtl_context = static_cast<ContextMetal*>(context);
 	const uint8_t* src_data = static_cast<const uint8_t*>(data);
-	setupMTLBuffer(mtl_context, size, src_data);
-	if (usage == GL_STATIC_DRAW) {
-		// GL_STATIC_DRAWが指定されている場合は、基本的にバッファを書き換えないはず
-		// シャドウバッファが必要になった時に作成する
-		m_shadowBufferState = SHADOW_BUFFER_STATE_RESERVED;
+	acquireShadowBufferBudget(mtl_context);
+	releaseStorage(mtl_context);
+	m_setDataSize = size;
+	m_usage = usage;
+	if (src_data == nullptr) {
+		// データ未指定の場合は内容が未定義のため、確保を最初の書き込みか描画まで遅延する
+		m_allocationDeferred = true;
+		m_shadowBufferState = SHADOW_BUFFER_STATE_INITIAL;
 	} else {
-		// 他のusageはシャドウバッファを作成
-		setupShadowBuffer(size, src_data);
+		m_allocationDeferred = false;
+		bool result = setupMTLBuffer(mtl_context, size, src_data);
+		if (usage == GL_STATIC_DRAW) {
+			// GL_STATIC_DRAWが指定されている場合は、基本的にバッファを書き換えないはず
+			// シャドウバッファが必要になった時に作成する
+			m_shadowBufferState = SHADOW_BUFFER_STATE_RESERVED;
+		} else if (result) {
+			// 他のusageはシャドウバッファを作成
+			result = setupShadowBuffer(size, src_data);
+		}
+		if (!result) {
+			// 確保に失敗した場合は空のバッファとする
+			mtl_context->recycleBuffer(m_mtlBuffer, 0);
+			m_mtlBuffer = nil;
+			m_setDataSize = 0;
+			m_shadowBufferState = SHADOW_BUFFER_STATE_INITIAL;
+			return false;
+		}
+	}
+	// 変換情報をクリア
+	m_convertedMode = ConversionModeNone;
+	m_convertedStride = UINT32_MAX;
+	m_convertedStartVertex = 0;
+	m_convertedEndVertex = 0;
+	m_indexRangeCache.clear();
+	m_formatConversionCache.clear();
+	m_generation++;
+	m_convertedOffset = 0;
+	m_convertedSize = 0;
+	updateShadowBufferBudget();
+	return true;
+}
+
+bool BufferMetal::setStorage(BackendContext* context, GLsizeiptr size, const void* data, GLbitfield flags)
+{
+	AXGL_ASSERT(context != nullptr);
+	if ((flags & GL_MAP_PERSISTENT_BIT_EXT) == 0) {
+		// 永続マップしない場合は、glBufferDataと同様に扱う
+		GLenum usage = ((flags & GL_DYNAMIC_STORAGE_BIT_EXT) != 0) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
+		return setData(context, size, data, usage);
+	}
+	ContextMetal* mtl_context = static_cast<ContextMetal*>(context);
+	acquireShadowBufferBudget(mtl_context);
+	releaseStorage(mtl_context);
+	// NOTE: 永続マップするストレージは確保を遅延しない(マップ時にストレージを直接返すため)
+	m_allocationDeferred = false;
+	// uint8のインデックスとしての変換は、新しいストレージを描画に使用する時に改めて設定される
+	m_u8u16ConversionMode = false;
+	m_u8u16PrimitiveRestart = false;
+	// CPUとGPUが同じメモリを参照するSharedのMTLBufferを作成し、マップ時はその領域を直接返す
+	// NOTE: Sharedのバッファはコマンドバッファのコミット時にCPUの書き込みが見えるため、COHERENTも同じ扱い
+	if (!setupMTLBuffer(mtl_context, size, static_cast<const uint8_t*>(data))) {
+		m_setDataSize = 0;
+		m_shadowBuffer.releaseResources();
+		m_shadowBufferState = SHADOW_BUFFER_STATE_INITIAL;
+		updateShadowBufferBudget();
+		return false;
 	}
+	m_persistentBuffer = m_mtlBuffer;
+	m_shadowBuffer.releaseResources();
+	m_shadowBufferState = SHADOW_BUFFER_STATE_PERSISTENT;
 	m_setDataSize = size;
-	m_usage = usage;
+	m_usage = GL_DYNAMIC_DRAW;
 	// 変換情報をクリア
 	m_convertedMode = ConversionModeNone;
 	m_convertedStride = UINT32_MAX;
+	m_convertedStartVertex = 0;
+	m_convertedEndVertex = 0;
+	m_indexRangeCache.clear();
+	m_formatConversionCache.clear();
+	m_generation++;
 	m_convertedOffset = 0;
 	m_convertedSize = 0;
-	m_convertedFirst = 0;
-	m_convertedCount = 0;
+	updateShadowBufferBudget();
 	return true;
 }
 
@@ -100,6 +225,23 @@ bool BufferMetal::setSubData(BackendContext* context, GLintptr offset, GLsizeipt
 	if (data == nullptr) {
 		return true;
 	}
+	// GPUによる書き込みが保留中の場合は、上書きする前に反映する
+	resolveGpuWrite(static_cast<ContextMetal*>(context), true);
+	if (m_persistentBuffer != nil) {
+		// 永続マップされたストレージに直接書き込む
+		// NOTE: GPUが参照中の領域との同期はアプリケーション側で行う(glFenceSync等)
+		if (offset >= m_setDataSize) {
+			return false;
+		}
+		const uint8_t* src_data = static_cast<const uint8_t*>(data);
+		size_t copy_size = std::min<size_t>(size, m_setDataSize - offset);
+		std::copy(src_data, src_data + copy_size, static_cast<uint8_t*>([m_persistentBuffer contents]) + offset);
+		return true;
+	}
+	// 確保を遅延している場合は確保
+	if (!allocateDeferredStorage(static_cast<ContextMetal*>(context), true)) {
+		return false;
+	}
 	// シャドウバッファ未作成の場合は作成
 	setupShadowBufferForReserved();
 	// サイズによるオフセットチェック
@@ -113,28 +255,41 @@ bool BufferMetal::setSubData(BackendContext* context, GLintptr offset, GLsizeipt
 	size_t copy_size = (size < shadow_remain) ? size : shadow_remain;
 	std::copy(src_data, src_data + copy_size, m_shadowBuffer.getPointer() + offset);
 	// ダーティ領域を更新
-	if (m_dirtyStart == m_dirtyEnd) {
-		m_dirtyStart = offset;
-		m_dirtyEnd = offset + size;
-	} else {
-		m_dirtyStart = std::min(m_dirtyStart, offset);
-		m_dirtyEnd = std::max(m_dirtyEnd, offset + size);
-	}
+	addDirtyRange(offset, offset + size);
+	// 書き換えた領域のインデックス範囲を破棄
+	invalidateIndexRangeCache(offset, offset + size);
+	m_generation++;
 	// 変換情報をクリアしておく
 	m_convertedMode = ConversionModeNone;
 	m_convertedStride = UINT32_MAX;
 	m_convertedOffset = 0;
 	m_convertedSize = 0;
-	m_convertedFirst = 0;
-	m_convertedCount = 0;
+	updateShadowBufferBudget();
 	return true;
 }
 
 bool BufferMetal::mapRange(BackendContext* context, GLintptr offset, GLsizeiptr length, GLenum access, void** mapPointer)
 {
-	// 現サポート範囲ではGPUが書き換えることはなく、GL_MAP_READ_BITも本実装でマップする
+	// GPUが書き換えるのはglReadPixelsによる保留中の書き込みのみで、反映した上でGL_MAP_READ_BITも本実装でマップする
 	AXGL_ASSERT((context != nullptr) && (mapPointer != nullptr));
 	AXGL_ASSERT(m_mapAccessFlags == 0);
+	// NOTE: GPUの書き込みとの同期はここで行う(glFenceSyncで完了を待っている場合は待たない)
+	resolveGpuWrite(static_cast<ContextMetal*>(context), true);
+	if (m_persistentBuffer != nil) {
+		// 永続マップ可能なストレージは、GPUが参照するメモリを直接返す
+		if ((offset + length) > m_setDataSize) {
+			return false; // レンジが正しくない
+		}
+		*mapPointer = static_cast<uint8_t*>([m_persistentBuffer contents]) + offset;
+		m_mapAccessFlags = access;
+		m_mapOffset = offset;
+		m_mapLength = length;
+		return true;
+	}
+	// 確保を遅延している場合は確保
+	if (!allocateDeferredStorage(static_cast<ContextMetal*>(context), true)) {
+		return false;
+	}
 	// シャドウバッファ未作成の場合は作成する
 	setupShadowBufferForReserved();
 	if ((offset + length) > m_shadowBuffer.getSize()) {
@@ -150,46 +305,46 @@ bool BufferMetal::mapRange(BackendContext* context, GLintptr offset, GLsizeiptr
 
 bool BufferMetal::unmap(BackendContext* context)
 {
-	AXGL_UNUSED(context);
+	AXGL_ASSERT(context != nullptr);
+	acquireShadowBufferBudget(static_cast<ContextMetal*>(context));
+	if (m_persistentBuffer != nil) {
+		// 書き込みはストレージに直接反映されているため、ダーティ領域の更新は不要
+		m_mapAccessFlags = 0;
+		return true;
+	}
 	if (m_mapAccessFlags & GL_MAP_WRITE_BIT) {
-		if (m_dirtyStart == m_dirtyEnd) {
-			m_dirtyStart = m_mapOffset;
-			m_dirtyEnd = m_mapOffset + m_mapLength;
-		} else {
-			m_dirtyStart = std::min(m_dirtyStart, m_mapOffset);
-			m_dirtyEnd = std::max(m_dirtyEnd, m_mapOffset + m_mapLength);
-		}
+		addDirtyRange(m_mapOffset, m_mapOffset + m_mapLength);
+		invalidateIndexRangeCache(m_mapOffset, m_mapOffset + m_mapLength);
+		m_generation++;
 		m_mapAccessFlags = 0;
+		updateShadowBufferBudget();
 	}
 	// 変換情報をクリアしておく
 	m_convertedMode = ConversionModeNone;
 	m_convertedStride = UINT32_MAX;
 	m_convertedOffset = 0;
 	m_convertedSize = 0;
-	m_convertedFirst = 0;
-	m_convertedCount = 0;
 	return true;
 }
 
 bool BufferMetal::flushMappedRange(BackendContext* context, GLintptr offset, GLsizeiptr length)
 {
-	AXGL_UNUSED(context);
+	AXGL_ASSERT(context != nullptr);
+	acquireShadowBufferBudget(static_cast<ContextMetal*>(context));
+	if (m_persistentBuffer != nil) {
+		// 書き込みはストレージに直接反映されている
+		return true;
+	}
 	if (m_mapAccessFlags & GL_MAP_WRITE_BIT) {
-		if (m_dirtyStart == m_dirtyEnd) {
-			m_dirtyStart = offset;
-			m_dirtyEnd = offset + length;
-		} else {
-			m_dirtyStart = std::min(m_dirtyStart, offset);
-			m_dirtyEnd = std::max(m_dirtyEnd, offset + length);
-		}
+		addDirtyRange(offset, offset + length);
+		invalidateIndexRangeCache(offset, offset + length);
+		m_generation++;
 	}
 	// 変換情報をクリアしておく
 	m_convertedMode = ConversionModeNone;
 	m_convertedStride = UINT32_MAX;
 	m_convertedOffset = 0;
 	m_convertedSize = 0;
-	m_convertedFirst = 0;
-	m_convertedCount = 0;	
 	return true;
 }
 
@@ -198,18 +353,60 @@ id<MTLBuffer> BufferMetal::getMtlBuffer() const
 	return m_mtlBuffer;
 }
 
-void BufferMetal::setU8U16ConversionMode()
+void BufferMetal::setU8U16ConversionMode(bool primitiveRestart)
 {
+	if (m_u8u16ConversionMode && (m_u8u16PrimitiveRestart != primitiveRestart)) {
+		// プリミティブリスタートの有無で0xFFの変換結果が異なるため、変換済みのバッファを破棄して全体を変換し直す
+		setupShadowBufferForReserved();
+		m_mtlBuffer = nil;
+		m_srcBuffer = nil;
+		m_mtlBufferDirty = true;
+		clearDirtyRange();
+	}
 	m_u8u16ConversionMode = true;
+	m_u8u16PrimitiveRestart = primitiveRestart;
 }
 
-bool BufferMetal::setupBufferInDraw(BackendContext* context, ConversionMode conversion, intptr_t offset, intptr_t size)
+bool BufferMetal::setupBufferInDraw(BackendContext* context, ConversionMode conversion, intptr_t offset, intptr_t size, bool primitiveRestart)
 {
 	AXGL_ASSERT(context != nullptr);
 	ContextMetal* mtl_context = static_cast<ContextMetal*>(context);
+	// GPUによる書き込みが保留中の場合は反映する(CPUで変換する場合は永続マップされたストレージも完了を待つ)
+	resolveGpuWrite(mtl_context, (conversion != ConversionModeNone) || m_u8u16ConversionMode);
+	// 書き込まれずに描画に使用された場合は、ここで確保する
+	if (!allocateDeferredStorage(mtl_context, false)) {
+		return false;
+	}
 	if (conversion != ConversionModeNone) {
 		// データ内容の変換をともなうバッファセットアップを呼び出す
-		return setupWithDataConversion(mtl_context, conversion, offset, size);
+		return setupWithDataConversion(mtl_context, conversion, offset, size, primitiveRestart);
+	}
+	if (m_persistentBuffer != nil) {
+		// 永続マップされたストレージはCPUが書き込んだ内容をGPUが直接参照する
+		if (m_u8u16ConversionMode) {
+			// uint8のインデックスは、いつ書き換えられたか分からないため描画毎にuint16に変換
+			// NOTE: 変換先は保持して再利用し、GPUが参照中の場合のみ新たな領域に切り替える(リネーム)
+			const uint32_t num_indices = static_cast<uint32_t>(m_setDataSize);
+			const size_t widened_size = sizeof(uint16_t) * num_indices;
+			if ((m_widenedIndexBuffer != nil) && (([m_widenedIndexBuffer length] < widened_size) || isInFlight(mtl_context))) {
+				recycleUsedBuffer(mtl_context, m_widenedIndexBuffer);
+				m_widenedIndexBuffer = nil;
+			}
+			if (m_widenedIndexBuffer == nil) {
+				m_widenedIndexBuffer = newSharedBuffer(mtl_context, widened_size, nullptr);
+				if (m_widenedIndexBuffer == nil) {
+					return false;
+				}
+			}
+			widenIndices(static_cast<uint16_t*>([m_widenedIndexBuffer contents]), getOriginalData(), num_indices);
+			m_mtlBuffer = m_widenedIndexBuffer;
+			m_mtlBufferDirty = true;
+		} else if (m_mtlBuffer != m_persistentBuffer) {
+			// 変換したバッファからストレージに戻す
+			m_mtlBuffer = m_persistentBuffer;
+			m_mtlBufferDirty = true;
+		}
+		return true;
 	}
 	// ダーティ領域がない場合
 	if (m_dirtyStart == m_dirtyEnd) {
@@ -222,17 +419,29 @@ bool BufferMetal::setupBufferInDraw(BackendContext* context, ConversionMode conv
 			setupMTLBuffer(static_cast<ContextMetal*>(context), sizeof(uint16_t) * num_indices, nullptr);
 			const uint8_t* u8_src = m_shadowBuffer.getPointer();
 			uint16_t* u16_dst = static_cast<uint16_t*>([m_mtlBuffer contents]);
-			for (uint32_t i = 0; i < num_indices; i++) {
-				u16_dst[i] = u8_src[i];
-			}
+			widenIndices(u16_dst, u8_src, num_indices);
 		}
 		return true;
 	}
+	// GPUの使用状況に応じて、Blitを使わずにCPUから書き換える
+	if (uploadDirtyRangesDirect(mtl_context)) {
+		clearDirtyRange();
+		return true;
+	}
+	// 小さな更新の場合は、コンテキストのステージング領域を経由して転送する
+	if (uploadDirtyRangesWithStaging(mtl_context)) {
+		clearDirtyRange();
+		return true;
+	}
 	// シャドウバッファからBlitの転送元にコピーする
 	{
 		// shadow buffer 未作成の場合は作成する
 		setupShadowBufferForReserved();
-		// NOTE: m_srcBufferは常に作り直すほうが良いかも
+		if ((m_srcBuffer != nil) && isInFlight(mtl_context)) {
+			// GPUが転送元として使用中の場合は、新たな領域に切り替える(リネーム)
+			recycleUsedBuffer(mtl_context, m_srcBuffer);
+			m_srcBuffer = nil;
+		}
 		if (m_srcBuffer != nil) {
 			uint8_t* dst = static_cast<uint8_t*>([m_srcBuffer contents]);
 			if (dst != nullptr) {
@@ -242,26 +451,21 @@ bool BufferMetal::setupBufferInDraw(BackendContext* context, ConversionMode conv
 				} else {
 					// uint16に変換しつつ転送
 					uint16_t* dst_u16 = reinterpret_cast<uint16_t*>(dst);
-					for (intptr_t i = m_dirtyStart; i < m_dirtyEnd; i++) {
-						dst_u16[i] = src[i];
-					}
+					widenIndices(dst_u16 + m_dirtyStart, src + m_dirtyStart, m_dirtyEnd - m_dirtyStart);
 				}
 			}
 		} else {
-			id<MTLDevice> mtlDevice = mtl_context->getDevice();
 			const uint8_t* data_ptr = m_shadowBuffer.getPointer();
 			intptr_t data_size = m_shadowBuffer.getSize();
 			if (!m_u8u16ConversionMode) {
-				m_srcBuffer = [mtlDevice newBufferWithBytes:data_ptr length:data_size options:MTLResourceStorageModeShared];
+				m_srcBuffer = newSharedBuffer(mtl_context, data_size, data_ptr);
 			} else {
 				// uint16に変換したBlit転送元を作成
 				const uint32_t num_indices = static_cast<uint32_t>(m_shadowBuffer.getSize());
-				m_srcBuffer = [mtlDevice newBufferWithLength:data_size * sizeof(uint16_t) options:MTLResourceStorageModeShared];
+				m_srcBuffer = newSharedBuffer(mtl_context, data_size * sizeof(uint16_t), nullptr);
 				const uint8_t* u8_src = m_shadowBuffer.getPointer();
 				uint16_t* u16_dst = static_cast<uint16_t*>([m_srcBuffer contents]);
-				for (uint32_t i = 0; i < num_indices; i++) {
-					u16_dst[i] = u8_src[i];
-				}
+				widenIndices(u16_dst, u8_src, num_indices);
 			}
 		}
 	}
@@ -280,34 +484,28 @@ bool BufferMetal::setupBufferInDraw(BackendContext* context, ConversionMode conv
 	}
 	id<MTLBlitCommandEncoder> command_encoder = mtl_context->getBlitCommandEncoder();
 	[command_encoder copyFromBuffer:m_srcBuffer sourceOffset:m_dirtyStart toBuffer:m_mtlBuffer destinationOffset:m_dirtyStart size:(m_dirtyEnd - m_dirtyStart)];
+	mtl_context->addBufferUploadStats(m_dirtyRanges.getUpdateCount(), 1, static_cast<size_t>(m_dirtyEnd - m_dirtyStart), false);
 	// clear dirty area
-	m_dirtyStart = 0;
-	m_dirtyEnd = 0;
+	clearDirtyRange();
 
 	return true;
 }
 
-bool BufferMetal::needUpdateWithStrideConversion(uint32_t stride, uint32_t convertedStride) const
+bool BufferMetal::needUpdateWithStrideConversion(uint32_t stride, uint32_t convertedStride, uint32_t startVertex, uint32_t endVertex) const
 {
 	bool rval = false;
 	AXGL_ASSERT(m_convertedMode == ConversionModeNone);
-	if ((m_dirtyStart != m_dirtyEnd) || (m_convertedStride != convertedStride)) {
+	AXGL_ASSERT(stride > 0);
+	// 使用する頂点範囲をバッファのサイズに制限(endVertexを含む)
+	uint32_t num_vertices = static_cast<uint32_t>(m_setDataSize / stride);
+	uint32_t start_vertex = std::min(startVertex, num_vertices);
+	uint32_t end_vertex = (endVertex < num_vertices) ? (endVertex + 1) : num_vertices;
+	if ((m_persistentBuffer != nil) || m_allocationDeferred) {
+		rval = true; // 永続マップされたストレージは描画毎に変換する、未確保の場合は確保する
+	} else if ((m_dirtyStart != m_dirtyEnd) || (m_convertedStride != convertedStride)) {
 		rval = true; // 変換済みのストライドと異なる場合
-	}
-	return rval;
-}
-
-bool BufferMetal::needUpdateWithStrideAndDataConversion(uint32_t stride, uint32_t convertedStride, ConversionMode conversion, GLint first, GLsizei count) const
-{
-	bool rval = false;
-	if (conversion == ConversionModeNone) {
-		// データ変換が無い場合、ストライド処理のメソッド
-		rval = needUpdateWithStrideConversion(stride, convertedStride);
-	} else {
-		if ((m_convertedMode != conversion) || (convertedStride != m_convertedStride)
-			|| (first != m_convertedFirst) || (count != m_convertedCount)) {
-			rval = true; // VBOフォーマット変換済みデータと異なる場合
-		}
+	} else if ((start_vertex < m_convertedStartVertex) || (end_vertex > m_convertedEndVertex)) {
+		rval = true; // 変換済みの頂点範囲に含まれない場合
 	}
 	return rval;
 }
@@ -315,20 +513,36 @@ bool BufferMetal::needUpdateWithStrideAndDataConversion(uint32_t stride, uint32_
 bool BufferMetal::needUpdateWithoutConversion() const
 {
 	AXGL_ASSERT(m_convertedMode == ConversionModeNone);
-	return (m_dirtyStart != m_dirtyEnd);
+	if (m_persistentBuffer != nil) {
+		// 変換したバッファを使用していた場合のみ更新
+		return (m_mtlBuffer != m_persistentBuffer);
+	}
+	return (m_dirtyStart != m_dirtyEnd) || m_allocationDeferred;
 }
 
-int BufferMetal::needUpdateWithIndexConversion(ConversionMode conversion, intptr_t iboOffset, intptr_t iboSize, bool isUbyte) const
+int BufferMetal::needUpdateWithIndexConversion(ConversionMode conversion, intptr_t iboOffset, intptr_t iboSize, bool isUbyte, bool primitiveRestart) const
 {
 	int rval = NoUpdateRequired;
-	if (conversion != ConversionModeNone) {
+	if (m_allocationDeferred) {
+		// ストレージ未確保の場合: バッファを新たに作成するため Blit は行わない
+		rval = UpdateRequiredWithoutBlitCommand;
+	} else if (m_persistentBuffer != nil) {
+		if ((conversion != ConversionModeNone) || isUbyte || (m_mtlBuffer != m_persistentBuffer)) {
+			// 永続マップされたストレージの変換は描画毎に行う: バッファを新たに作成するため Blit は行わない
+			rval = UpdateRequiredWithoutBlitCommand;
+		}
+	} else if (conversion != ConversionModeNone) {
 		if ((conversion != m_convertedMode) || (m_dirtyStart != m_dirtyEnd)
-			|| (m_convertedOffset != iboOffset) || (m_convertedSize != iboSize)) {
+			|| (m_convertedOffset != iboOffset) || (m_convertedSize != iboSize)
+			|| (m_convertedPrimitiveRestart != primitiveRestart)) {
 			// IBOフォーマット変換済みのインデックスと異なる場合: バッファを新たに作成するため Blit は行わない
 			rval = UpdateRequiredWithoutBlitCommand;
 		}
 	} else {
-		if (m_dirtyStart != m_dirtyEnd) {
+		if (isUbyte && m_u8u16ConversionMode && (m_u8u16PrimitiveRestart != primitiveRestart)) {
+			// Ubyteインデックスでリスタートの有無が変わった場合: 全体を変換し直すため Blit は行わない
+			rval = UpdateRequiredWithoutBlitCommand;
+		} else if (m_dirtyStart != m_dirtyEnd) {
 			// バッファが書き換えられている場合: 既存バッファの書き換えを行うため Blit を行う
 			rval = UpdateRequiredWithBlitCommand;
 		} else if (isUbyte && (m_mtlBuffer.length != (m_shadowBuffer.getSize() * 2))) {
@@ -339,117 +553,60 @@ int BufferMetal::needUpdateWithIndexConversion(ConversionMode conversion, intptr
 	return rval;
 }
 
-bool BufferMetal::setupBufferWithStrideConversion(ContextMetal* context, uint32_t stride, uint32_t convertedStride)
+bool BufferMetal::setupBufferWithStrideConversion(ContextMetal* context, uint32_t stride, uint32_t convertedStride, uint32_t startVertex, uint32_t endVertex)
 {
-	if ((m_dirtyStart == m_dirtyEnd) && (m_convertedStride == convertedStride)) {
+	AXGL_ASSERT(stride > 0);
+	// GPUによる書き込みが保留中の場合は、CPUで変換する前に反映する
+	resolveGpuWrite(context, true);
+	// 確保を遅延している場合は確保
+	if (!allocateDeferredStorage(context, false)) {
+		return false;
+	}
+	// 使用する頂点範囲をバッファのサイズに制限(endVertexを含む)
+	uint32_t num_vertices = static_cast<uint32_t>(m_setDataSize / stride);
+	uint32_t start_vertex = std::min(startVertex, num_vertices);
+	uint32_t end_vertex = (endVertex < num_vertices) ? (endVertex + 1) : num_vertices;
+	bool rebuild = (m_dirtyStart != m_dirtyEnd) || (m_convertedStride != convertedStride) || (m_mtlBuffer == nil)
+		|| (m_persistentBuffer != nil);
+	if (!rebuild && (start_vertex >= m_convertedStartVertex) && (end_vertex <= m_convertedEndVertex)) {
 		return true;
 	}
 	AXGL_ASSERT(context != nullptr);
 	// シャドウバッファ未作成の場合は作成する
 	setupShadowBufferForReserved();
-	// 古いバッファをリリース
-	m_mtlBuffer = nil;
-	m_mtlBufferDirty = true;
 	// 拡大方向のみ正しく機能する
 	AXGL_ASSERT(convertedStride > stride);
-	// 変換後のデータサイズを算出
-	intptr_t copy_count = m_setDataSize / stride;
-	intptr_t converted_size = copy_count * convertedStride;
-	// ワークバッファを確保
-	void* work_buf = AXGL_ALLOC(converted_size);
-	bool result = false;
-	if (work_buf != nullptr) {
-		// ストライド変換しながらコピー
-		const uint8_t* sp = m_shadowBuffer.getPointer();
-		AXGL_ASSERT(sp != nullptr);
-		uint8_t* dp = static_cast<uint8_t*>(work_buf);
-		for (intptr_t i = 0; i < copy_count; i++) {
-			memcpy(dp, sp, stride);
-			sp += stride;
-			dp += convertedStride;
-		}
-		// 変換後のデータでバッファを作成
-		id<MTLDevice> mtlDevice = context->getDevice();
-		AXGL_ASSERT(mtlDevice != nil);
-		m_mtlBuffer = [mtlDevice newBufferWithBytes:work_buf length:converted_size options:MTLResourceStorageModeShared];
-		if (m_mtlBuffer != nil) {
-			m_convertedStride = convertedStride;
-			result = true;
-		}
-		AXGL_ASSERT(m_mtlBuffer != nil);
-		// ワークを解放
-		AXGL_FREE(work_buf);
-	} else {
-		AXGL_ASSERT(0);
-	}
-	return result;
-}
-
-bool BufferMetal::setupWithStrideAndDataConversion(ContextMetal* context,
-	uint32_t stride, uint32_t convertedStride, ConversionMode conversion, GLint first, GLsizei count)
-{
-	if (conversion == ConversionModeNone) {
-		// データ変換が無い場合、ストライド処理のみのメソッドを呼び出して終了
-		return setupBufferWithStrideConversion(context, stride, convertedStride);
-	}
-	if ((m_convertedMode == conversion) && (convertedStride == m_convertedStride) && (first == m_convertedFirst) && (count == m_convertedCount)) {
-		return true; // 変換済み
-	}
-	// ここに到達するのは頂点データのTriangleFan変換のみ
-	AXGL_ASSERT(conversion == ConversionModeTriFanVertices);
-	if (count < 3) {
-		return false; // 描画されないので変換不要
-	}
-	// TriangleFanの頂点データ書き換え
-	{
-		// shadow buffer 未作成の場合は作成する
-		setupShadowBufferForReserved();
+	if (rebuild) {
 		// 古いバッファをリリース
-		AXGL_ASSERT(context != nullptr);
-		id<MTLDevice> mtl_device = context->getDevice();
-		AXGL_ASSERT(mtl_device != nil);
 		m_mtlBuffer = nil;
 		m_mtlBufferDirty = true;
-		// トライアングル数
-		int32_t num_triangle = count - 2;
-		AXGL_ASSERT(num_triangle > 0);
-		// 変換後データサイズでバッファを作成
-		uint32_t converted_size = 3 * convertedStride * num_triangle;
-		m_mtlBuffer = [mtl_device newBufferWithLength:converted_size options:MTLResourceStorageModeShared];
-		AXGL_ASSERT(m_mtlBuffer != nil);
-		uint8_t* dst_buffer = static_cast<uint8_t*>([m_mtlBuffer contents]);
-		AXGL_ASSERT(dst_buffer != nullptr);
-		// シャドウバッファを変換元として参照
-		const uint8_t* sp = reinterpret_cast<uint8_t*>(m_shadowBuffer.getPointer() + (stride * first));
-		AXGL_ASSERT(sp != nullptr);
-		const uint8_t* first_sp = sp;
-		// 変換済みの頂点は常にバッファ先頭から格納
-		uint8_t* dp = dst_buffer;
-		// 最初の三角形
-		memcpy(dp, sp, stride);
-		sp += stride;
-		dp += convertedStride;
-		memcpy(dp, sp, stride);
-		sp += stride;
-		dp += convertedStride;
-		memcpy(dp, sp, stride);
-		dp += convertedStride;
-		// 2番目以降の三角形
-		for (int32_t j = 1; j < num_triangle; j++) {
-			memcpy(dp, first_sp, stride);
-			dp += convertedStride;
-			memcpy(dp, sp, stride);
-			sp += stride;
-			dp += convertedStride;
-			memcpy(dp, sp, stride);
-			dp += convertedStride;
+		// 変換後のデータサイズでバッファを作成し、使用する頂点範囲のみ変換する
+		intptr_t converted_size = static_cast<intptr_t>(num_vertices) * convertedStride;
+		id<MTLDevice> mtlDevice = context->getDevice();
+		AXGL_ASSERT(mtlDevice != nil);
+		m_mtlBuffer = [mtlDevice newBufferWithLength:std::max<intptr_t>(converted_size, convertedStride) options:MTLResourceStorageModeShared];
+		if (m_mtlBuffer == nil) {
+			AXGL_ASSERT(0);
+			return false;
+		}
+		convertVertexStride(static_cast<uint8_t*>([m_mtlBuffer contents]), stride, convertedStride, start_vertex, end_vertex);
+		m_convertedStride = convertedStride;
+		m_convertedStartVertex = start_vertex;
+		m_convertedEndVertex = end_vertex;
+		// シャドウバッファから作り直したためダーティ領域をクリア
+		clearDirtyRange();
+	} else {
+		// 変換済みの範囲外のみ追加で変換する(変換済みの範囲はGPUが参照中の可能性があるため書き換えない)
+		uint8_t* dst = static_cast<uint8_t*>([m_mtlBuffer contents]);
+		if (start_vertex < m_convertedStartVertex) {
+			convertVertexStride(dst, stride, convertedStride, start_vertex, m_convertedStartVertex);
+			m_convertedStartVertex = start_vertex;
+		}
+		if (end_vertex > m_convertedEndVertex) {
+			convertVertexStride(dst, stride, convertedStride, m_convertedEndVertex, end_vertex);
+			m_convertedEndVertex = end_vertex;
 		}
 	}
-	// 変換情報を保持
-	m_convertedMode   = conversion;
-	m_convertedStride = convertedStride;
-	m_convertedFirst  = first;
-	m_convertedCount  = count;
 	return true;
 }
 
@@ -466,7 +623,8 @@ void BufferMetal::clearMTLBufferDirty()
 
 bool BufferMetal::isDynamicBuffer() const
 {
-	if (m_mtlBuffer == nil) {
+	if ((m_mtlBuffer == nil) || (m_persistentBuffer != nil)) {
+		// 永続マップされたストレージはリングバッファにコピーせず直接参照する
 		return false;
 	}
 	// DYNAMIC_DRAWかつ閾値以下の場合に、動的なバッファとして扱う
@@ -482,11 +640,14 @@ size_t BufferMetal::getBufferDataSize() const
 	} else if (m_shadowBufferState == SHADOW_BUFFER_STATE_RESERVED) {
 		// シャドウバッファ未作成でMTLBufferがオリジナルデータ
 		data_size = m_mtlBuffer.length;
+	} else if (m_shadowBufferState == SHADOW_BUFFER_STATE_PERSISTENT) {
+		// 永続マップされたストレージがオリジナルデータ
+		data_size = m_setDataSize;
 	}
 	return data_size;
 }
 
-void BufferMetal::copyToDynamicBuffer(id<MTLBuffer> dynamicBuffer, size_t offset) const
+void BufferMetal::copyToDynamicBuffer(id<MTLBuffer> dynamicBuffer, size_t offset, size_t start, size_t end) const
 {
 	if (dynamicBuffer == nil) {
 		return;
@@ -496,28 +657,405 @@ void BufferMetal::copyToDynamicBuffer(id<MTLBuffer> dynamicBuffer, size_t offset
 	size_t data_size = m_shadowBuffer.getSize();
 	const uint8_t* src = m_shadowBuffer.getPointer();
 	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	// 使用する範囲[start, end)のみを、offsetを先頭とした同じ位置にコピー
+	end = std::min(end, data_size);
+	if (start >= end) {
+		return;
+	}
 	dst += offset;
-	AXGL_ASSERT((offset + data_size) <= [dynamicBuffer length]);
-	memcpy(dst, src, data_size);
+	if (!m_u8u16ConversionMode) {
+		AXGL_ASSERT((offset + end) <= [dynamicBuffer length]);
+		memcpy(dst + start, src + start, end - start);
+	} else {
+		// uint8のインデックスはuint16に変換しながらコピー
+		AXGL_ASSERT((offset + (end * sizeof(uint16_t))) <= [dynamicBuffer length]);
+		uint16_t* dst_u16 = reinterpret_cast<uint16_t*>(dst);
+		widenIndices(dst_u16 + start, src + start, end - start);
+	}
+	return;
+}
+
+bool BufferMetal::isU8U16ConversionMode() const
+{
+	return m_u8u16ConversionMode;
+}
+
+bool BufferMetal::getIndexRange(intptr_t offset, GLsizei count, GLenum type, bool primitiveRestart, uint32_t* minIndex, uint32_t* maxIndex)
+{
+	AXGL_ASSERT((minIndex != nullptr) && (maxIndex != nullptr));
+	intptr_t type_size = get_index_type_size(type);
+	if ((count <= 0) || (type_size == 0) || (offset < 0)) {
+		return false;
+	}
+	// キャッシュを検索
+	// NOTE: 永続マップされたストレージは通知なく書き換えられるため、キャッシュを使用しない
+	const bool use_cache = (m_persistentBuffer == nil);
+	IndexRangeKey key = {offset, count, type, primitiveRestart};
+	if (use_cache) {
+		auto it = m_indexRangeCache.find(key);
+		if (it != m_indexRangeCache.end()) {
+			*minIndex = it->second.minIndex;
+			*maxIndex = it->second.maxIndex;
+			return true;
+		}
+	}
+	// インデックスを参照するメモリを取得
+	const uint8_t* data = getOriginalData();
+	if ((data == nullptr) || ((offset + (type_size * count)) > m_setDataSize)) {
+		return false;
+	}
+	// インデックスの範囲を走査
+	data += offset;
+	switch (type) {
+	case GL_UNSIGNED_BYTE:
+		scanIndexRangeU8(data, count, primitiveRestart, minIndex, maxIndex);
+		break;
+	case GL_UNSIGNED_SHORT:
+		scanIndexRangeU16(reinterpret_cast<const uint16_t*>(data), count, primitiveRestart, minIndex, maxIndex);
+		break;
+	default:
+		scanIndexRangeU32(reinterpret_cast<const uint32_t*>(data), count, primitiveRestart, minIndex, maxIndex);
+		break;
+	}
+	if (!use_cache) {
+		return true;
+	}
+	// キャッシュに追加、エントリ数を超える場合は破棄してから追加
+	if (m_indexRangeCache.size() >= INDEX_RANGE_CACHE_MAX) {
+		m_indexRangeCache.clear();
+	}
+	IndexRange range = {*minIndex, *maxIndex};
+	m_indexRangeCache.emplace(key, range);
+	return true;
+}
+
+uint32_t BufferMetal::getConvertedIndexCount() const
+{
+	return m_convertedIndexCount;
+}
+
+bool BufferMetal::canUseAsCopySource() const
+{
+	// MTLBufferが変換したデータを保持している場合は、Blitの転送元に使用できない
+	if (m_u8u16ConversionMode || (m_convertedMode != ConversionModeNone) || (m_convertedStride != UINT32_MAX)) {
+		return false;
+	}
+	return true;
+}
+
+void BufferMetal::setLastUsedSerial(const SubmissionSerial* submissionSerial, uint64_t serial)
+{
+	m_lastUsedSerial = serial;
+	m_lastUsedSerialSource = submissionSerial;
 	return;
 }
 
+bool BufferMetal::evictShadowBuffer(const SubmissionSerial* submissionSerial)
+{
+	AXGL_ASSERT(submissionSerial != nullptr);
+	// マップ中、もしくはMTLBufferに反映していない書き込みがある場合は破棄できない
+	if ((m_mapAccessFlags != 0) || (m_dirtyStart != m_dirtyEnd)) {
+		return false;
+	}
+	if (m_shadowBufferState == SHADOW_BUFFER_STATE_CREATED) {
+		// 変換していないSharedのMTLBufferが、オリジナルデータと同じ内容を保持している場合のみ
+		// NOTE: 動的バッファはシャドウバッファからリングバッファにコピーするため対象外
+		if (m_u8u16ConversionMode || isDynamicBuffer() || (m_mtlBuffer == nil) || (m_mtlBuffer.storageMode != MTLStorageModeShared)
+			|| (m_convertedMode != ConversionModeNone) || (m_convertedStride != UINT32_MAX)
+			|| ([m_mtlBuffer length] < static_cast<NSUInteger>(m_setDataSize))) {
+			return false;
+		}
+		// MTLBufferへのBlit転送が完了していること
+		// NOTE: 他のコンテキストが最後に使用した場合は完了を判定できないため残す
+		if (!submissionSerial->isCompleted(m_lastUsedSerialSource, m_lastUsedSerial)) {
+			return false;
+		}
+		// MTLBufferをオリジナルデータとし、シャドウバッファは必要になった時にMTLBufferから作成する
+		m_shadowBufferState = SHADOW_BUFFER_STATE_RESERVED;
+	} else if (m_shadowBufferState == SHADOW_BUFFER_STATE_PERSISTENT) {
+		return false;
+	}
+	// NOTE: INITIAL/RESERVEDの状態では、シャドウバッファの内容は使用されていない
+	m_shadowBuffer.releaseResources();
+	updateShadowMemorySize();
+	return true;
+}
+
+id<MTLBuffer> BufferMetal::getFormatConvertedBuffer(ContextMetal* context, GLenum type, GLint size, GLboolean normalized,
+	uint32_t offset, uint32_t stride, uint32_t startVertex, uint32_t endVertex)
+{
+	AXGL_ASSERT(context != nullptr);
+	// GPUによる書き込みが保留中の場合は、CPUで変換する前に反映する
+	resolveGpuWrite(context, true);
+	// 確保を遅延している場合は確保
+	if (!allocateDeferredStorage(context, false)) {
+		return nil;
+	}
+	const uint8_t* data = getOriginalData();
+	uint32_t attrib_size = getVertexAttribSize(type, size);
+	if ((data == nullptr) || (stride == 0) || ((static_cast<intptr_t>(offset) + attrib_size) > m_setDataSize)) {
+		return nil;
+	}
+	// 頂点範囲をバッファのサイズに制限
+	uint32_t max_vertex = static_cast<uint32_t>((m_setDataSize - offset - attrib_size) / stride);
+	endVertex = std::min(endVertex, max_vertex);
+	if (startVertex > endVertex) {
+		return nil;
+	}
+	// 同じ世代で、要求された頂点範囲を含む変換結果があれば使用する
+	// NOTE: 永続マップされたストレージは通知なく書き換えられるため、キャッシュを使用しない
+	const bool use_cache = (m_persistentBuffer == nil);
+	for (const FormatConversionEntry& entry : m_formatConversionCache) {
+		if (use_cache && (entry.generation == m_generation) && (entry.type == type) && (entry.size == size)
+			&& (entry.normalized == normalized) && (entry.offset == offset) && (entry.stride == stride)
+			&& (entry.startVertex <= startVertex) && (endVertex <= entry.endVertex)) {
+			return entry.buffer;
+		}
+	}
+	// 変換結果を格納するMTLBufferを作成
+	// NOTE: 頂点vのデータは v * converted_stride に格納し、オフセット0でバインドする
+	uint32_t converted_stride = getConvertedVertexAttribSize(type, size);
+	size_t converted_size = (static_cast<size_t>(endVertex) + 1) * converted_stride;
+	id<MTLDevice> mtl_device = context->getDevice();
+	id<MTLBuffer> converted_buffer = [mtl_device newBufferWithLength:converted_size options:MTLResourceStorageModeShared];
+	if (converted_buffer == nil) {
+		return nil;
+	}
+	uint8_t* dst = static_cast<uint8_t*>([converted_buffer contents]) + (static_cast<size_t>(startVertex) * converted_stride);
+	const uint8_t* src = data + offset + (static_cast<size_t>(startVertex) * stride);
+	convertVertexAttrib(dst, converted_stride, src, stride, (endVertex - startVertex + 1), type, size, normalized);
+	if (!use_cache) {
+		return converted_buffer;
+	}
+	// 古い世代のエントリを破棄、エントリ数を超える場合は最も古いエントリを破棄
+	m_formatConversionCache.erase(std::remove_if(m_formatConversionCache.begin(), m_formatConversionCache.end(),
+		[this](const FormatConversionEntry& entry) { return entry.generation != m_generation; }), m_formatConversionCache.end());
+	if (m_formatConversionCache.size() >= FORMAT_CONVERSION_CACHE_MAX) {
+		m_formatConversionCache.erase(m_formatConversionCache.begin());
+	}
+	FormatConversionEntry entry = {type, size, normalized, offset, stride, startVertex, endVertex, m_generation, converted_buffer};
+	m_formatConversionCache.push_back(entry);
+	return converted_buffer;
+}
+
+// glBufferData等で指定されたデータのサイズを取得
+size_t BufferMetal::getStorageSize() const
+{
+	return static_cast<size_t>(m_setDataSize);
+}
+
+// GPUが範囲[start, end)に書き込むMTLBufferを取得する(オリジナルデータと同じオフセットで書き込む)
+// NOTE: 書き込みは記録中のサブミッションで実行され、resolveGpuWriteでオリジナルデータに反映する
+id<MTLBuffer> BufferMetal::beginGpuWrite(ContextMetal* context, size_t start, size_t end)
+{
+	AXGL_ASSERT((context != nullptr) && (start < end));
+	acquireShadowBufferBudget(context);
+	if (end > static_cast<size_t>(m_setDataSize)) {
+		return nil;
+	}
+	const uint64_t serial = context->getSubmissionSerial().getPendingSerial();
+	if (m_persistentBuffer != nil) {
+		// 永続マップされたストレージにGPUが直接書き込む
+		// NOTE: 孤立化したストレージを書き込みの完了前に再利用しないよう、使用中として扱う
+		m_gpuWriteSerial = serial;
+		setLastUsedSerial(&context->getSubmissionSerial(), serial);
+		return m_persistentBuffer;
+	}
+	// 確保を遅延している場合は確保
+	if (!allocateDeferredStorage(context, true)) {
+		return nil;
+	}
+	// シャドウバッファ未作成の場合は作成
+	setupShadowBufferForReserved();
+	const uint8_t* data = getOriginalData();
+	if (data == nullptr) {
+		return nil;
+	}
+	// NOTE: 反映時のBlitのオフセットとサイズを4バイト単位にするため、有効範囲を4バイト境界に広げる(macOSの制約)
+	intptr_t write_start = static_cast<intptr_t>(start & ~static_cast<size_t>(3));
+	intptr_t write_end = std::min(static_cast<intptr_t>((end + 3) & ~static_cast<size_t>(3)), m_setDataSize);
+	if (m_gpuWriteBuffer == nil) {
+		m_gpuWriteBuffer = newSharedBuffer(context, m_setDataSize, nullptr);
+		if (m_gpuWriteBuffer == nil) {
+			return nil;
+		}
+		m_gpuWriteStart = write_start;
+		m_gpuWriteEnd = write_start;
+	}
+	// 新たに有効範囲に含める領域にオリジナルデータをコピー
+	// NOTE: 行の間等のGPUが書き込まない領域を、反映時にオリジナルデータの内容で書き戻すため
+	uint8_t* dst = static_cast<uint8_t*>([m_gpuWriteBuffer contents]);
+	if (m_gpuWriteStart == m_gpuWriteEnd) {
+		memcpy(dst + write_start, data + write_start, write_end - write_start);
+		m_gpuWriteStart = write_start;
+		m_gpuWriteEnd = write_end;
+	} else {
+		if (write_start < m_gpuWriteStart) {
+			memcpy(dst + write_start, data + write_start, m_gpuWriteStart - write_start);
+			m_gpuWriteStart = write_start;
+		}
+		if (write_end > m_gpuWriteEnd) {
+			memcpy(dst + m_gpuWriteEnd, data + m_gpuWriteEnd, write_end - m_gpuWriteEnd);
+			m_gpuWriteEnd = write_end;
+		}
+	}
+	m_gpuWriteSerial = serial;
+	// NOTE: 新たな書き込みはm_mtlBufferにコピーされていない
+	m_gpuWriteCopied = false;
+	return m_gpuWriteBuffer;
+}
+
+// GPUによる保留中の書き込みを、完了を待ってオリジナルデータに反映する
+// NOTE: cpuReadがfalseの場合(GPUが参照する場合)は、m_mtlBufferへのコピーを記録中のコマンドバッファに記録して待たない
+// シャドウバッファへの反映はCPUが参照する時(cpuRead)まで遅延する
+// NOTE: 永続マップされたストレージはGPUの実行順で整合するため、GPUが参照する場合は何もしない
+void BufferMetal::resolveGpuWrite(ContextMetal* context, bool cpuRead)
+{
+	AXGL_ASSERT(context != nullptr);
+	// NOTE: 描画やCPUの読み出しで最初に呼ばれるため、ここで使用中のコンテキストの予算管理に移す
+	acquireShadowBufferBudget(context);
+	if (m_gpuWriteSerial == 0) {
+		return;
+	}
+	if (!cpuRead) {
+		if ((m_gpuWriteBuffer == nil) || m_gpuWriteCopied) {
+			return;
+		}
+		if (copyGpuWriteInStream(context)) {
+			return;
+		}
+		// NOTE: 動的バッファや変換したバッファは、オリジナルデータから作成するため完了を待って反映する
+	}
+	const uint64_t serial = m_gpuWriteSerial;
+	if (!context->getSubmissionSerial().isCompleted(serial)) {
+		// 書き込みを記録したサブミッションをコミットして完了を待つ
+		context->finish();
+	}
+	id<MTLBuffer> write_buffer = m_gpuWriteBuffer;
+	intptr_t write_start = m_gpuWriteStart;
+	intptr_t write_end = m_gpuWriteEnd;
+	bool copied = m_gpuWriteCopied;
+	m_gpuWriteBuffer = nil;
+	m_gpuWriteStart = 0;
+	m_gpuWriteEnd = 0;
+	m_gpuWriteSerial = 0;
+	m_gpuWriteCopied = false;
+	if (write_buffer != nil) {
+		const uint8_t* src = static_cast<const uint8_t*>([write_buffer contents]);
+		if (copied) {
+			// m_mtlBufferはBlitで更新済みのため、シャドウバッファのみに反映する
+			applyGpuWriteToShadowBuffer(write_start, write_end, src + write_start);
+		} else {
+			// CPUから書き込まれた場合と同様に、シャドウバッファとMTLBufferに反映する
+			setSubData(context, write_start, write_end - write_start, src + write_start);
+		}
+		context->recycleBuffer(write_buffer, serial);
+	}
+	return;
+}
+
+// GPUによる保留中の書き込みを、記録中のコマンドバッファでm_mtlBufferにコピーする
+// NOTE: 以降に記録する描画、転送はコピー後の内容を参照するため、完了を待たない
+bool BufferMetal::copyGpuWriteInStream(ContextMetal* context)
+{
+	AXGL_ASSERT((context != nullptr) && (m_gpuWriteBuffer != nil));
+	// 変換していないMTLBufferを直接参照する場合のみ
+	// NOTE: 動的バッファはオリジナルデータからリングバッファにコピーし、ダーティ領域は後でシャドウバッファから転送するため対象外
+	if (isDynamicBuffer() || !canUseAsCopySource() || (m_mtlBuffer == nil) || (m_dirtyStart != m_dirtyEnd)) {
+		return false;
+	}
+	// NOTE: Blitのオフセットとサイズは4バイト単位(バッファの終端で揃わない場合は完了を待って反映する)
+	if (((m_gpuWriteStart | m_gpuWriteEnd) & 3) != 0) {
+		return false;
+	}
+	if ((m_gpuWriteEnd > static_cast<intptr_t>([m_mtlBuffer length])) || (m_gpuWriteEnd > static_cast<intptr_t>([m_gpuWriteBuffer length]))) {
+		return false;
+	}
+	context->copyBufferInStream(m_gpuWriteBuffer, m_mtlBuffer, m_gpuWriteStart, m_gpuWriteEnd - m_gpuWriteStart);
+	// 記録中のサブミッションでm_mtlBufferに書き込む
+	setLastUsedSerial(&context->getSubmissionSerial(), context->getSubmissionSerial().getPendingSerial());
+	m_gpuWriteCopied = true;
+	return true;
+}
+
+// m_mtlBufferにコピー済みのGPUの書き込みを、シャドウバッファに反映する
+void BufferMetal::applyGpuWriteToShadowBuffer(intptr_t start, intptr_t end, const uint8_t* src)
+{
+	AXGL_ASSERT((start <= end) && (src != nullptr));
+	// NOTE: シャドウバッファを破棄している場合は、m_mtlBufferがオリジナルデータのため反映不要
+	if (m_shadowBufferState == SHADOW_BUFFER_STATE_CREATED) {
+		size_t shadow_size = m_shadowBuffer.getSize();
+		if (static_cast<size_t>(start) < shadow_size) {
+			size_t copy_size = std::min(static_cast<size_t>(end - start), shadow_size - static_cast<size_t>(start));
+			std::copy(src, src + copy_size, m_shadowBuffer.getPointer() + start);
+		}
+	}
+	// 書き換えた領域のインデックス範囲を破棄
+	invalidateIndexRangeCache(start, end);
+	m_generation++;
+	// 変換情報をクリアしておく
+	m_convertedMode = ConversionModeNone;
+	m_convertedStride = UINT32_MAX;
+	m_convertedOffset = 0;
+	m_convertedSize = 0;
+	updateShadowBufferBudget();
+	return;
+}
+
+
 //--------
 bool BufferMetal::setupMTLBuffer(ContextMetal* context, size_t size, const uint8_t* data)
 {
-	id<MTLBuffer> mtlBuffer;
+	// 後でシャドウバッファ作成時にCPUが読み出す可能性があるためSharedで作成
+	id<MTLBuffer> mtlBuffer = newSharedBuffer(context, size, data);
+	if (mtlBuffer == nil) {
+		return false;
+	}
+	m_mtlBuffer = mtlBuffer;
+	m_mtlBufferDirty = true;
+	return true;
+}
+
+id<MTLBuffer> BufferMetal::newSharedBuffer(ContextMetal* context, size_t size, const uint8_t* data)
+{
+	AXGL_ASSERT(context != nullptr);
+	// 孤立化したストレージで使用が完了したものがあれば再利用する
+	id<MTLBuffer> mtlBuffer = context->acquireRecycledBuffer(size);
+	if (mtlBuffer != nil) {
+		if (data != nullptr) {
+			memcpy([mtlBuffer contents], data, size);
+		}
+		return mtlBuffer;
+	}
 	id<MTLDevice> mtlDevice = context->getDevice();
 	if (data != nullptr) {
 		mtlBuffer = [mtlDevice newBufferWithBytes:data length:size options:MTLResourceStorageModeShared];
 	} else {
-		// 後でシャドウバッファ作成時にCPUが読み出す可能性があるためSharedで作成
 		mtlBuffer = [mtlDevice newBufferWithLength:size options:MTLResourceStorageModeShared];
 	}
-	if (mtlBuffer == nil) {
+	return mtlBuffer;
+}
+
+bool BufferMetal::allocateDeferredStorage(ContextMetal* context, bool forWrite)
+{
+	if (!m_allocationDeferred) {
+		return true;
+	}
+	AXGL_ASSERT(context != nullptr);
+	m_allocationDeferred = false;
+	// NOTE: 内容は未定義のため、確保のみでクリアやコピーは行わない
+	if (!setupMTLBuffer(context, m_setDataSize, nullptr)) {
 		return false;
 	}
-	m_mtlBuffer = mtlBuffer;
-	m_mtlBufferDirty = true;
+	if ((m_usage == GL_STATIC_DRAW) && !forWrite) {
+		// MTLBufferをオリジナルデータとし、シャドウバッファは必要になった時に作成する
+		m_shadowBufferState = SHADOW_BUFFER_STATE_RESERVED;
+	} else {
+		// 書き込む場合は、MTLBufferからコピーせずにシャドウバッファを作成
+		if (!setupShadowBuffer(m_setDataSize, nullptr)) {
+			return false;
+		}
+	}
 	return true;
 }
 
@@ -537,9 +1075,37 @@ bool BufferMetal::setupShadowBuffer(size_t size, const uint8_t* data)
 	}
 	// 状態を作成済みに変更
 	m_shadowBufferState = SHADOW_BUFFER_STATE_CREATED;
+	updateShadowBufferBudget();
 	return true;
 }
 
+// シャドウバッファを、使用中のコンテキストの予算管理に移す
+// NOTE: 他のコンテキストが破棄しないよう、シャドウバッファにアクセスする前に呼び出す
+void BufferMetal::acquireShadowBufferBudget(ContextMetal* context)
+{
+	m_shadowBufferBudget = &context->getShadowBufferBudget();
+	m_shadowBufferBudget->acquire(this);
+	return;
+}
+
+void BufferMetal::updateShadowBufferBudget()
+{
+	AXGL_ASSERT(m_shadowBufferBudget != nullptr);
+	// 確保済みのシャドウバッファのサイズを通知し、最近書き込まれたものとする
+	m_shadowBufferBudget->update(this, getShadowBufferClass(m_usage), m_shadowBuffer.getSize());
+	updateShadowMemorySize();
+	return;
+}
+
+// シャドウバッファのサイズの変化をMemoryAccountingに通知
+void BufferMetal::updateShadowMemorySize()
+{
+	size_t memory_size = m_shadowBuffer.getSize();
+	MemoryAccounting::getInstance().update(MemoryCategoryShadowBuffer, m_shadowMemorySize, memory_size);
+	m_shadowMemorySize = memory_size;
+	return;
+}
+
 bool BufferMetal::setupShadowBufferForReserved()
 {
 	if (m_shadowBufferState != SHADOW_BUFFER_STATE_RESERVED) {
@@ -561,14 +1127,228 @@ bool BufferMetal::setupShadowBufferForReserved()
 	memcpy(dst, src, m_setDataSize);
 	// 状態を作成済みに変更
 	m_shadowBufferState = SHADOW_BUFFER_STATE_CREATED;
+	updateShadowBufferBudget();
+	return true;
+}
+
+void BufferMetal::convertVertexStride(uint8_t* dst, uint32_t stride, uint32_t convertedStride, uint32_t startVertex, uint32_t endVertex) const
+{
+	AXGL_ASSERT(dst != nullptr);
+	// ストライド変換しながらコピー
+	const uint8_t* sp = getOriginalData();
+	AXGL_ASSERT(sp != nullptr);
+	sp += static_cast<size_t>(startVertex) * stride;
+	uint8_t* dp = dst + (static_cast<size_t>(startVertex) * convertedStride);
+	for (uint32_t i = startVertex; i < endVertex; i++) {
+		memcpy(dp, sp, stride);
+		sp += stride;
+		dp += convertedStride;
+	}
+	return;
+}
+
+void BufferMetal::widenIndices(uint16_t* dst, const uint8_t* src, size_t count) const
+{
+	if (m_u8u16PrimitiveRestart) {
+		// リスタートインデックスを変換(0xFF -> 0xFFFF)
+		widenIndicesU8ToU16Restart(dst, src, count);
+	} else {
+		widenIndicesU8ToU16(dst, src, count);
+	}
+	return;
+}
+
+const uint8_t* BufferMetal::getOriginalData() const
+{
+	const uint8_t* data = nullptr;
+	if (m_shadowBufferState == SHADOW_BUFFER_STATE_CREATED) {
+		data = m_shadowBuffer.getPointer();
+	} else if ((m_shadowBufferState == SHADOW_BUFFER_STATE_RESERVED) && (m_mtlBuffer != nil)) {
+		// シャドウバッファ未作成の場合、Sharedで作成したMTLBufferがオリジナルデータ
+		data = static_cast<const uint8_t*>([m_mtlBuffer contents]);
+	} else if (m_shadowBufferState == SHADOW_BUFFER_STATE_PERSISTENT) {
+		// 永続マップされたストレージがオリジナルデータ
+		data = static_cast<const uint8_t*>([m_persistentBuffer contents]);
+	}
+	return data;
+}
+
+void BufferMetal::addDirtyRange(intptr_t start, intptr_t end)
+{
+	// 範囲全体を更新
+	if (m_dirtyStart == m_dirtyEnd) {
+		m_dirtyStart = start;
+		m_dirtyEnd = end;
+	} else {
+		m_dirtyStart = std::min(m_dirtyStart, start);
+		m_dirtyEnd = std::max(m_dirtyEnd, end);
+	}
+	// 重なる、もしくは隣接する範囲は結合して保持する
+	m_dirtyRanges.add(start, end);
+	return;
+}
+
+void BufferMetal::clearDirtyRange()
+{
+	m_dirtyStart = 0;
+	m_dirtyEnd = 0;
+	m_dirtyRanges.clear();
+	return;
+}
+
+bool BufferMetal::uploadDirtyRangesWithStaging(ContextMetal* context)
+{
+	if (m_u8u16ConversionMode || (m_mtlBuffer == nil) || m_dirtyRanges.empty()) {
+		return false;
+	}
+	// 書き換えた範囲全体が閾値以下の場合のみ
+	// NOTE: Blitのオフセットとサイズは4バイト単位に揃える(macOSの制約)
+	size_t data_size = std::min<size_t>(m_setDataSize, [m_mtlBuffer length]);
+	size_t start = 0;
+	size_t end = 0;
+	if (!m_dirtyRanges.getAlignedExtent(data_size, [m_mtlBuffer length], &start, &end) || ((end - start) > STAGING_UPLOAD_MAX)) {
+		// 4バイトに揃えると転送先の終端を超える場合も、通常の転送を使用する
+		return false;
+	}
+	setupShadowBufferForReserved();
+	const uint8_t* src = m_shadowBuffer.getPointer();
+	id<MTLBlitCommandEncoder> command_encoder = context->getBlitCommandEncoder();
+	AXGL_ASSERT((src != nullptr) && (command_encoder != nil));
+	// 書き換えた範囲をまとめてステージング領域にコピーし、1回のコピーコマンドで転送する
+	// NOTE: 範囲の隙間もシャドウバッファの最新の内容のため、そのまま転送してよい
+	// NOTE: ステージング領域は描画毎に確保されるため、GPUが参照中の領域を書き換えることはない
+	size_t copy_size = end - start;
+	size_t staging_offset = 0;
+	id<MTLBuffer> staging_buffer = context->allocateStagingBuffer(copy_size, &staging_offset);
+	DirtyRangeList::gatherExtent(static_cast<uint8_t*>([staging_buffer contents]) + staging_offset, src, m_shadowBuffer.getSize(), start, end);
+	[command_encoder copyFromBuffer:staging_buffer sourceOffset:staging_offset toBuffer:m_mtlBuffer destinationOffset:start size:copy_size];
+	context->addBufferUploadStats(m_dirtyRanges.getUpdateCount(), 1, copy_size, true);
 	return true;
 }
 
+bool BufferMetal::uploadDirtyRangesDirect(ContextMetal* context)
+{
+	// 変換していないSharedのMTLBufferのみ
+	if (m_u8u16ConversionMode || (m_mtlBuffer == nil) || m_dirtyRanges.empty() || (m_mtlBuffer.storageMode != MTLStorageModeShared)
+		|| (m_convertedStride != UINT32_MAX) || ([m_mtlBuffer length] < static_cast<NSUInteger>(m_setDataSize))) {
+		return false;
+	}
+	setupShadowBufferForReserved();
+	const uint8_t* src = m_shadowBuffer.getPointer();
+	AXGL_ASSERT(src != nullptr);
+	if (!isInFlight(context)) {
+		// GPUが使用していない場合は、書き換えた範囲をそのままコピーする
+		uint8_t* dst = static_cast<uint8_t*>([m_mtlBuffer contents]);
+		size_t total_size = 0;
+		for (const DirtyRangeList::Range& range : m_dirtyRanges.getRanges()) {
+			intptr_t end = std::min(range.end, m_setDataSize);
+			if (range.start < end) {
+				memcpy(dst + range.start, src + range.start, end - range.start);
+				total_size += static_cast<size_t>(end - range.start);
+			}
+		}
+		context->addBufferUploadStats(m_dirtyRanges.getUpdateCount(), 0, total_size, false);
+		return true;
+	}
+	// GPUが使用中で書き換えた範囲が大半を占める場合は、同期せずに新たな領域に切り替える(リネーム)
+	size_t dirty_size = 0;
+	for (const DirtyRangeList::Range& range : m_dirtyRanges.getRanges()) {
+		dirty_size += static_cast<size_t>(std::min(range.end, m_setDataSize) - std::min(range.start, m_setDataSize));
+	}
+	if ((dirty_size * 2) < static_cast<size_t>(m_setDataSize)) {
+		return false;
+	}
+	id<MTLBuffer> renamed_buffer = newSharedBuffer(context, m_setDataSize, src);
+	if (renamed_buffer == nil) {
+		return false;
+	}
+	// 古い領域はGPUの使用完了後に再利用する
+	recycleUsedBuffer(context, m_mtlBuffer);
+	m_mtlBuffer = renamed_buffer;
+	m_mtlBufferDirty = true;
+	context->addBufferUploadStats(m_dirtyRanges.getUpdateCount(), 0, static_cast<size_t>(m_setDataSize), false);
+	return true;
+}
+
+void BufferMetal::recycleUsedBuffer(ContextMetal* context, id<MTLBuffer> buffer) const
+{
+	AXGL_ASSERT(context != nullptr);
+	// NOTE: 他のコンテキストが最後に使用した場合は、再利用できる時期を判定できないため返却しない(ARCによって破棄させる)
+	const SubmissionSerial* submission_serial = &context->getSubmissionSerial();
+	if ((m_lastUsedSerial != 0) && (m_lastUsedSerialSource != submission_serial)) {
+		return;
+	}
+	context->recycleBuffer(buffer, m_lastUsedSerial);
+	return;
+}
+
+bool BufferMetal::isInFlight(const ContextMetal* context) const
+{
+	AXGL_ASSERT(context != nullptr);
+	// 最後に参照したサブミッションが未完了(記録中を含む)
+	// NOTE: 他のコンテキストが最後に参照した場合は、完了を判定できないため使用中とする
+	return !context->getSubmissionSerial().isCompleted(m_lastUsedSerialSource, m_lastUsedSerial);
+}
+
+// 現在のストレージを破棄する(glBufferData、glBufferStorageEXTでデータを置き換える場合)
+void BufferMetal::releaseStorage(ContextMetal* context)
+{
+	AXGL_ASSERT(context != nullptr);
+	// 古いストレージへのGPUの書き込みは反映しない
+	discardGpuWrite(context);
+	// 古いストレージは、GPUの使用完了後に再利用できるようコンテキストに返却する(orphaning)
+	// NOTE: m_mtlBufferは永続マップされたストレージか、インデックスの変換先を指す場合がある
+	if ((m_mtlBuffer != m_persistentBuffer) && (m_mtlBuffer != m_widenedIndexBuffer)) {
+		recycleUsedBuffer(context, m_mtlBuffer);
+	}
+	recycleUsedBuffer(context, m_srcBuffer);
+	recycleUsedBuffer(context, m_persistentBuffer);
+	recycleUsedBuffer(context, m_widenedIndexBuffer);
+	m_mtlBuffer = nil;
+	m_srcBuffer = nil;
+	m_persistentBuffer = nil;
+	m_widenedIndexBuffer = nil;
+	m_lastUsedSerial = 0;
+	m_lastUsedSerialSource = nullptr;
+	m_mtlBufferDirty = true;
+	clearDirtyRange();
+	return;
+}
+
+// GPUによる保留中の書き込みを反映せずに破棄する(データを置き換える場合)
+void BufferMetal::discardGpuWrite(ContextMetal* context)
+{
+	AXGL_ASSERT(context != nullptr);
+	context->recycleBuffer(m_gpuWriteBuffer, m_gpuWriteSerial);
+	m_gpuWriteBuffer = nil;
+	m_gpuWriteStart = 0;
+	m_gpuWriteEnd = 0;
+	m_gpuWriteSerial = 0;
+	m_gpuWriteCopied = false;
+	return;
+}
+
+void BufferMetal::invalidateIndexRangeCache(intptr_t start, intptr_t end)
+{
+	// 書き換えられた領域と重なるエントリを破棄
+	for (auto it = m_indexRangeCache.begin(); it != m_indexRangeCache.end();) {
+		const IndexRangeKey& key = it->first;
+		intptr_t key_end = key.offset + (get_index_type_size(key.type) * key.count);
+		if ((key.offset < end) && (start < key_end)) {
+			it = m_indexRangeCache.erase(it);
+		} else {
+			++it;
+		}
+	}
+	return;
+}
+
 bool BufferMetal::setupWithDataConversion(ContextMetal* context,
-	ConversionMode conversion, intptr_t offset, intptr_t size)
+	ConversionMode conversion, intptr_t offset, intptr_t size, bool primitiveRestart)
 {
-	if ((conversion == m_convertedMode) && (m_dirtyStart == m_dirtyEnd)
-		&& (m_convertedOffset == offset) && (m_convertedSize == size)) {
+	if ((m_persistentBuffer == nil) && (conversion == m_convertedMode) && (m_dirtyStart == m_dirtyEnd)
+		&& (m_convertedOffset == offset) && (m_convertedSize == size)
+		&& (m_convertedPrimitiveRestart == primitiveRestart)) {
 		return true;
 	}
 	AXGL_ASSERT(conversion != ConversionModeNone);
@@ -576,13 +1356,18 @@ bool BufferMetal::setupWithDataConversion(ContextMetal* context,
 	bool result = true;
 	switch (conversion) {
 	case ConversionModeTriFanIndices8:
-		result = convertTriFanIndices8(context, offset, size);
+		result = convertTriFanIndices8(context, offset, size, primitiveRestart);
 		break;
 	case ConversionModeTriFanIndices16:
-		result = convertTriFanIndices16(context, offset, size);
+		result = convertTriFanIndices16(context, offset, size, primitiveRestart);
 		break;
 	case ConversionModeTriFanIndices32:
-		result = convertTriFanIndices32(context, offset, size);
+		result = convertTriFanIndices32(context, offset, size, primitiveRestart);
+		break;
+	case ConversionModeLineLoopIndices8:
+	case ConversionModeLineLoopIndices16:
+	case ConversionModeLineLoopIndices32:
+		result = convertLineLoopIndices(context, conversion, offset, size, primitiveRestart);
 		break;
 	default:
 		break;
@@ -590,7 +1375,7 @@ bool BufferMetal::setupWithDataConversion(ContextMetal* context,
 	return result;
 }
 
-bool BufferMetal::convertTriFanIndices8(ContextMetal* context, intptr_t offset, intptr_t size)
+bool BufferMetal::convertTriFanIndices8(ContextMetal* context, intptr_t offset, intptr_t size, bool primitiveRestart)
 {
 	// シャドウバッファ未作成の場合は作成する
 	setupShadowBufferForReserved();
@@ -609,38 +1394,30 @@ bool BufferMetal::convertTriFanIndices8(ContextMetal* context, intptr_t offset,
 	AXGL_ASSERT(m_mtlBuffer != nil);
 	uint16_t* dst_buffer = static_cast<uint16_t*>([m_mtlBuffer contents]);
 	AXGL_ASSERT(dst_buffer != nullptr);
-	// シャドウバッファから変換しながら格納
+	// オリジナルデータから変換しながら格納
 	{
 		// 正しいパラメータならバッファの範囲を越えない
-		AXGL_ASSERT(((offset + size) <= m_setDataSize) && (offset + size) <= m_shadowBuffer.getSize());
-		const uint8_t* sp = reinterpret_cast<uint8_t*>(m_shadowBuffer.getPointer() + offset);
+		AXGL_ASSERT((offset + size) <= m_setDataSize);
+		const uint8_t* sp = getOriginalData() + offset;
 		AXGL_ASSERT(sp != nullptr);
 		// 変換されたデータは必ずバッファ先頭から格納
-		uint16_t* dp = dst_buffer;
-		// 最初の三角形
-		uint16_t center_index = static_cast<uint16_t>(sp[0]);
-		dp[0] = center_index;
-		dp[1] = static_cast<uint16_t>(sp[1]);
-		dp[2] = static_cast<uint16_t>(sp[2]);
-		sp += 2;
-		dp += 3;
-		// 2番目以降の三角形
-		for (int32_t i = 1; i < num_triangle; i++) {
-			dp[0] = center_index;
-			dp[1] = static_cast<uint16_t>(sp[0]);
-			dp[2] = static_cast<uint16_t>(sp[1]);
-			sp++;
-			dp += 3;
+		if (primitiveRestart) {
+			// リスタートインデックスで区切られた区間毎に変換(リスタートインデックスは出力されない)
+			m_convertedIndexCount = static_cast<uint32_t>(convertTriFanIndicesRestartU8(dst_buffer, sp, size / sizeof(uint8_t)));
+		} else {
+			convertTriFanIndicesU8(dst_buffer, sp, size / sizeof(uint8_t));
+			m_convertedIndexCount = static_cast<uint32_t>(3 * num_triangle);
 		}
 	}
 	// 変換情報を保持
 	m_convertedMode = ConversionModeTriFanIndices8;
 	m_convertedOffset = offset;
 	m_convertedSize = size;
+	m_convertedPrimitiveRestart = primitiveRestart;
 	return true;
 }
 
-bool BufferMetal::convertTriFanIndices16(ContextMetal* context, intptr_t offset, intptr_t size)
+bool BufferMetal::convertTriFanIndices16(ContextMetal* context, intptr_t offset, intptr_t size, bool primitiveRestart)
 {
 	// シャドウバッファ未作成の場合は作成する
 	setupShadowBufferForReserved();
@@ -659,38 +1436,30 @@ bool BufferMetal::convertTriFanIndices16(ContextMetal* context, intptr_t offset,
 	AXGL_ASSERT(m_mtlBuffer != nil);
 	uint16_t* dst_buffer = static_cast<uint16_t*>([m_mtlBuffer contents]);
 	AXGL_ASSERT(dst_buffer != nullptr);
-	// シャドウバッファから変換しながら格納
+	// オリジナルデータから変換しながら格納
 	{
 		// 正しいパラメータならバッファの範囲を越えない
-		AXGL_ASSERT(((offset + size) <= m_setDataSize) && (offset + size) <= m_shadowBuffer.getSize());
-		const uint16_t* sp = reinterpret_cast<uint16_t*>(m_shadowBuffer.getPointer() + offset);
+		AXGL_ASSERT((offset + size) <= m_setDataSize);
+		const uint16_t* sp = reinterpret_cast<const uint16_t*>(getOriginalData() + offset);
 		AXGL_ASSERT(sp != nullptr);
 		// 変換されたデータは必ずバッファ先頭から格納
-		uint16_t* dp = dst_buffer;
-		// 最初の三角形
-		uint16_t center_index = sp[0];
-		dp[0] = center_index;
-		dp[1] = sp[1];
-		dp[2] = sp[2];
-		sp += 2;
-		dp += 3;
-		// 2番目以降の三角形
-		for (int32_t i = 1; i < num_triangle; i++) {
-			dp[0] = center_index;
-			dp[1] = sp[0];
-			dp[2] = sp[1];
-			sp++;
-			dp += 3;
+		if (primitiveRestart) {
+			// リスタートインデックスで区切られた区間毎に変換(リスタートインデックスは出力されない)
+			m_convertedIndexCount = static_cast<uint32_t>(convertTriFanIndicesRestartU16(dst_buffer, sp, size / sizeof(uint16_t)));
+		} else {
+			convertTriFanIndicesU16(dst_buffer, sp, size / sizeof(uint16_t));
+			m_convertedIndexCount = static_cast<uint32_t>(3 * num_triangle);
 		}
 	}
 	// 変換情報を保持
 	m_convertedMode = ConversionModeTriFanIndices16;
 	m_convertedOffset = offset;
 	m_convertedSize = size;
+	m_convertedPrimitiveRestart = primitiveRestart;
 	return true;
 }
 
-bool BufferMetal::convertTriFanIndices32(ContextMetal* context, intptr_t offset, intptr_t size)
+bool BufferMetal::convertTriFanIndices32(ContextMetal* context, intptr_t offset, intptr_t size, bool primitiveRestart)
 {
 	// シャドウバッファ未作成の場合は作成する
 	setupShadowBufferForReserved();
@@ -709,34 +1478,91 @@ bool BufferMetal::convertTriFanIndices32(ContextMetal* context, intptr_t offset,
 	AXGL_ASSERT(m_mtlBuffer != nil);
 	uint32_t* dst_buffer = static_cast<uint32_t*>([m_mtlBuffer contents]);
 	AXGL_ASSERT(dst_buffer != nullptr);
-	// シャドウバッファから変換しながら格納
+	// オリジナルデータから変換しながら格納
 	{
 		// 正しいパラメータならバッファの範囲を越えない
-		AXGL_ASSERT(((offset + size) <= m_setDataSize) && (offset + size) <= m_shadowBuffer.getSize());
-		const uint32_t* sp = reinterpret_cast<uint32_t*>(m_shadowBuffer.getPointer() + offset);
+		AXGL_ASSERT((offset + size) <= m_setDataSize);
+		const uint32_t* sp = reinterpret_cast<const uint32_t*>(getOriginalData() + offset);
 		AXGL_ASSERT(sp != nullptr);
 		// 変換されたデータは必ずバッファ先頭から格納
-		uint32_t* dp = dst_buffer;
-		// 最初の三角形
-		uint32_t center_index = sp[0];
-		dp[0] = center_index;
-		dp[1] = sp[1];
-		dp[2] = sp[2];
-		sp += 2;
-		dp += 3;
-		// 2番目以降の三角形
-		for (int32_t i = 1; i < num_triangle; i++) {
-			dp[0] = center_index;
-			dp[1] = sp[0];
-			dp[2] = sp[1];
-			sp++;
-			dp += 3;
+		if (primitiveRestart) {
+			// リスタートインデックスで区切られた区間毎に変換(リスタートインデックスは出力されない)
+			m_convertedIndexCount = static_cast<uint32_t>(convertTriFanIndicesRestartU32(dst_buffer, sp, size / sizeof(uint32_t)));
+		} else {
+			convertTriFanIndicesU32(dst_buffer, sp, size / sizeof(uint32_t));
+			m_convertedIndexCount = static_cast<uint32_t>(3 * num_triangle);
 		}
 	}
 	// 変換情報を保持
 	m_convertedMode = ConversionModeTriFanIndices32;
 	m_convertedOffset = offset;
 	m_convertedSize = size;
+	m_convertedPrimitiveRestart = primitiveRestart;
+	return true;
+}
+
+bool BufferMetal::convertLineLoopIndices(ContextMetal* context, ConversionMode conversion, intptr_t offset, intptr_t size, bool primitiveRestart)
+{
+	// シャドウバッファ未作成の場合は作成する
+	setupShadowBufferForReserved();
+	AXGL_ASSERT(context != nullptr);
+	id<MTLDevice> mtl_device = context->getDevice();
+	// 古いバッファをリリース
+	m_mtlBuffer = nil;
+	m_mtlBufferDirty = true;
+	// インデックス数と変換後のデータサイズ(uint8はuint16に変換、先頭インデックスを末尾に追加)
+	// NOTE: リスタートが有効な場合は区間毎にループを閉じるため、最大でインデックス数の2倍になる
+	intptr_t src_size = (conversion == ConversionModeLineLoopIndices32) ? sizeof(uint32_t) :
+		(conversion == ConversionModeLineLoopIndices16) ? sizeof(uint16_t) : sizeof(uint8_t);
+	intptr_t dst_size = (conversion == ConversionModeLineLoopIndices32) ? sizeof(uint32_t) : sizeof(uint16_t);
+	size_t num_indices = static_cast<size_t>(size / src_size);
+	AXGL_ASSERT(num_indices > 0);
+	size_t converted_size = (primitiveRestart ? (num_indices * 2) : (num_indices + 1)) * dst_size;
+	// バッファを確保
+	m_mtlBuffer = [mtl_device newBufferWithLength:converted_size options:MTLResourceStorageModeShared];
+	AXGL_ASSERT(m_mtlBuffer != nil);
+	void* dst_buffer = [m_mtlBuffer contents];
+	AXGL_ASSERT(dst_buffer != nullptr);
+	// オリジナルデータから変換しながら格納
+	{
+		// 正しいパラメータならバッファの範囲を越えない
+		AXGL_ASSERT((offset + size) <= m_setDataSize);
+		const uint8_t* sp = getOriginalData() + offset;
+		// 変換されたデータは必ずバッファ先頭から格納
+		size_t converted_count = num_indices + 1;
+		switch (conversion) {
+		case ConversionModeLineLoopIndices8:
+			if (primitiveRestart) {
+				converted_count = convertLineLoopIndicesRestartU8(static_cast<uint16_t*>(dst_buffer), sp, num_indices);
+			} else {
+				convertLineLoopIndicesU8(static_cast<uint16_t*>(dst_buffer), sp, num_indices);
+			}
+			break;
+		case ConversionModeLineLoopIndices16:
+			if (primitiveRestart) {
+				converted_count = convertLineLoopIndicesRestartU16(static_cast<uint16_t*>(dst_buffer), reinterpret_cast<const uint16_t*>(sp), num_indices);
+			} else {
+				convertLineLoopIndicesU16(static_cast<uint16_t*>(dst_buffer), reinterpret_cast<const uint16_t*>(sp), num_indices);
+			}
+			break;
+		case ConversionModeLineLoopIndices32:
+			if (primitiveRestart) {
+				converted_count = convertLineLoopIndicesRestartU32(static_cast<uint32_t*>(dst_buffer), reinterpret_cast<const uint32_t*>(sp), num_indices);
+			} else {
+				convertLineLoopIndicesU32(static_cast<uint32_t*>(dst_buffer), reinterpret_cast<const uint32_t*>(sp), num_indices);
+			}
+			break;
+		default:
+			AXGL_ASSERT(0);
+			break;
+		}
+		m_convertedIndexCount = static_cast<uint32_t>(converted_count);
+	}
+	// 変換情報を保持
+	m_convertedMode = conversion;
+	m_convertedOffset = offset;
+	m_convertedSize = size;
+	m_convertedPrimitiveRestart = primitiveRestart;
 	return true;
 }
 
@@ -5,6 +5,8 @@
 #include "../BackendContext.h"
 #include "../BackendBuffer.h"
 #include "../spirv_msl/SpirvMsl.h"
+#include "../../common/ShadowBufferBudget.h"
+#include "../../common/SubmissionSerial.h"
 #include "../../AXGLAllocatorImpl.h"
 #include <unordered_map>
 #include <utility>
@@ -37,6 +39,8 @@ public:
 	virtual bool clearBufferfi(GLenum buffer, GLint drawbuffer, GLfloat depth, GLint stencil, const DrawParameters* drawParams) override;
 	virtual bool drawArrays(GLenum mode, GLint first, GLsizei count, const DrawParameters* drawParams, const ClearParameters* clearParams) override;
 	virtual bool drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices, const DrawParameters* drawParams, const ClearParameters* clearParams) override;
+	virtual bool drawRangeElements(GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void* indices,
+		const DrawParameters* drawParams, const ClearParameters* clearParams) override;
 	virtual bool drawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount,
 		const DrawParameters* drawParams, const ClearParameters* clearParams) override;
 	virtual bool drawElementsInstanced(GLenum mode, GLsizei count, GLsizei type, const void* indices, GLsizei instancecount,
@@ -44,8 +48,12 @@ public:
 	virtual bool flush() override;
 	virtual bool finish() override;
 	virtual bool readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type,
-		BackendFramebuffer* readFramebuffer, GLenum readBuffer, void* pixels) override;
+		BackendFramebuffer* readFramebuffer, GLenum readBuffer, void* pixels, const PackParameters* pack) override;
+	virtual bool getImplementationColorReadFormat(BackendFramebuffer* readFramebuffer, GLenum readBuffer, GLenum* format, GLenum* type) override;
 	virtual void invalidateCache(GLbitfield flags) override;
+	virtual void getTexturePoolStats(TexturePoolStats* stats) const override;
+	virtual void getRenderPassStats(RenderPassStats* stats) const override;
+	virtual void getBufferUploadStats(BufferUploadStats* stats) const override;
 	virtual void discardCachesAssociatedWithProgram(BackendProgram* program) override;
 	virtual void discardCachesAssociatedWithVertexArray(BackendVertexArray* vertexArray) override;
 
@@ -57,6 +65,20 @@ public:
 	MTLCompileOptions* getCompileOptions() const;
 	bool presentRenderbuffer(RenderbufferMetal* renderbuffer);
 	SpirvMsl* getBackendSpirvMsl();
+	const SubmissionSerial& getSubmissionSerial() const;
+	ShadowBufferBudget& getShadowBufferBudget();
+	id<MTLBuffer> acquireRecycledBuffer(size_t size);
+	void recycleBuffer(id<MTLBuffer> buffer, uint64_t lastUsedSerial);
+	id<MTLBuffer> allocateStagingBuffer(size_t size, size_t* offset);
+	void addBufferUploadStats(uint32_t updateCount, uint32_t copyCount, size_t bytes, bool staged);
+	void copyBufferInStream(id<MTLBuffer> srcBuffer, id<MTLBuffer> dstBuffer, size_t offset, size_t size);
+	bool copyBufferToTexture(BufferMetal* buffer, size_t offset, size_t bytesPerRow, size_t bytesPerImage,
+		id<MTLTexture> texture, NSUInteger slice, NSUInteger level, const MTLRegion& region);
+	id<MTLTexture> newPooledTexture(MTLTextureDescriptor* desc);
+	void recycleTexture(id<MTLTexture> texture, uint64_t lastUsedSerial);
+	bool copyFramebufferToTexture(BackendFramebuffer* readFramebuffer, GLenum readBuffer, GLint x, GLint y, GLsizei width, GLsizei height,
+		id<MTLTexture> texture, NSUInteger slice, NSUInteger level, GLint xoffset, GLint yoffset);
+	void invalidateRenderPassAttachments(FramebufferMetal* framebuffer, uint32_t attachmentMask);
 
 private:
 	// wait mode
@@ -70,9 +92,8 @@ private:
 		BufferMetal* buffer[AXGL_MAX_VERTEX_ATTRIBS];
 		uint32_t stride[AXGL_MAX_VERTEX_ATTRIBS];
 		uint32_t alignedStride[AXGL_MAX_VERTEX_ATTRIBS];
-		BackendBuffer::ConversionMode conversion;
-		GLint first;
-		GLsizei count;
+		uint32_t startVertex[AXGL_MAX_VERTEX_ATTRIBS];
+		uint32_t endVertex[AXGL_MAX_VERTEX_ATTRIBS];
 		bool useBlit;
 	};
 	// UBO update information
@@ -86,14 +107,39 @@ private:
 		intptr_t iboOffset;
 		intptr_t iboSize;
 		bool isUbyte;
+		bool primitiveRestart;
 		bool useBlit;
 	};
+	// client-side vertex array information
+	struct ClientArrayInfo {
+		const void* pointer;
+		uint32_t elementSize;
+		uint32_t stride;
+		uint32_t alignedStride;
+		uint32_t startVertex;
+		uint32_t endVertex;
+		// NOTE: 描画の頂点番号から引く値(頂点毎の属性をbaseVertexで描画する場合のみ0以外)
+		uint32_t baseVertex;
+		GLenum type;
+		GLint size;
+		GLboolean normalized;
+		bool formatConversion;
+	};
 	// VBO dynamic update information
 	struct VboDynamicUpdateInfo {
 		// NOTE: 配列はBackendProgramMetal::getAttribLocations()のロケーションで参照したバッファを格納
 		BufferMetal* buffer[AXGL_MAX_VERTEX_ATTRIBS];
 		id<MTLBuffer> dynamicBuffer[AXGL_MAX_VERTEX_ATTRIBS];
 		size_t offset[AXGL_MAX_VERTEX_ATTRIBS];
+		// NOTE: 動的バッファにコピーするバイト範囲[start, end)
+		size_t start[AXGL_MAX_VERTEX_ATTRIBS];
+		size_t end[AXGL_MAX_VERTEX_ATTRIBS];
+		// NOTE: クライアントメモリの頂点配列は使用する頂点の範囲のみを動的バッファにコピーする
+		ClientArrayInfo clientArray[AXGL_MAX_VERTEX_ATTRIBS];
+		// NOTE: クライアントメモリの頂点配列は先頭の頂点を割り当てた位置に格納し、描画の頂点番号からbaseVertexを引く
+		//       他の頂点毎の属性はbaseVertex分の頂点をバインドするオフセットに加算する(baseOffset)
+		uint32_t baseVertex;
+		size_t baseOffset[AXGL_MAX_VERTEX_ATTRIBS];
 		bool useDynamicBuffer;
 	};
 	// UBO dynamic update information
@@ -109,29 +155,49 @@ private:
 		BufferMetal* buffer;
 		id<MTLBuffer> dynamicBuffer;
 		size_t offset;
+		// NOTE: 動的バッファにコピーするバイト範囲[start, end)
+		size_t start;
+		size_t end;
+		// NOTE: クライアントメモリのインデックスは変換しながら動的バッファにコピーする
+		const void* clientIndices;
+		GLenum type;
+		GLsizei count;
+		BackendBuffer::ConversionMode conversion;
+		bool primitiveRestart;
+		uint32_t convertedCount;
 		bool useDynamicBuffer;
 	};
 	
 private:
 	bool checkVBOUpdate(VboUpdateInfo* updateInfo, VboDynamicUpdateInfo* dynamicUpdateInfo, const DrawParameters* drawParams,
-		BackendBuffer::ConversionMode conversion, GLint first, GLsizei count);
+		GLuint startVertex, GLuint endVertex, GLsizei instanceCount, bool allowBaseVertex);
 	bool checkUBOUpdate(UboUpdateInfo* updateInfo, UboDynamicUpdateInfo* dynamicUpdateInfo, const DrawParameters* drawParams);
 	bool checkIBOUpdate(IboUpdateInfo* updateInfo, IboDynamicUpdateInfo* dynamicUpdateInfo, const DrawParameters* drawParams,
-		BackendBuffer::ConversionMode conversion, intptr_t iboOffset, intptr_t iboSize, bool isUbyte);
+		BackendBuffer::ConversionMode conversion, intptr_t iboOffset, intptr_t iboSize, GLenum type);
 	void updateVBO(const VboUpdateInfo* updateInfo);
 	void updateUBO(const UboUpdateInfo* updateInfo);
 	void updateIBO(const IboUpdateInfo* updateInfo);
 	void updateDynamicBuffers(VboDynamicUpdateInfo* vboInfo, UboDynamicUpdateInfo* uboInfo, IboDynamicUpdateInfo* iboInfo);
+	void markBuffersInUse(const DrawParameters* drawParams);
 	void setupDrawCommandBuffer();
 	void commitDrawCommandBuffer(WaitMode waitMode);
 	bool setupRenderCommandEncoder(MTLRenderPassDescriptor* renderPassDesc);
 	void endRenderCommandEncoder();
+	void setupRenderPassStoreActions();
 	void setupBlitCommandEncoder();
 	void setBlitSignalEvent();
 	void endBlitCommandEncoder();
 	void endCommandEncoder();
 	void setupDefaultUniformBuffer(size_t size);
 	void setupDynamicBuffer(size_t size);
+	size_t allocateDynamicBufferRange(size_t start, size_t end);
+	void uploadClientArray(VboDynamicUpdateInfo* vboInfo, int32_t index);
+	void uploadClientIndices(IboDynamicUpdateInfo* iboInfo);
+	void drawTriFanArrays(id<MTLRenderCommandEncoder> encoder, GLint first, GLsizei count, GLsizei instancecount);
+	void drawLineLoopArrays(id<MTLRenderCommandEncoder> encoder, GLint first, GLsizei count, GLsizei instancecount);
+	id<MTLBuffer> setupTriFanIndexBuffer(GLsizei count, MTLIndexType indexType);
+	void drawIndexedPrimitives(id<MTLRenderCommandEncoder> encoder, MTLPrimitiveType primitiveType, NSUInteger indexCount,
+		MTLIndexType indexType, id<MTLBuffer> indexBuffer, NSUInteger indexBufferOffset, GLsizei instancecount, uint32_t baseVertex);
 	void setBufferForDefaultUniform(id<MTLRenderCommandEncoder> encoder,
 		int32_t vsIndex, int32_t fsIndex, const void* data, size_t size);
 	void setDefaultUniformBuffer(id<MTLRenderCommandEncoder> encoder, const ProgramMetal* program);
@@ -166,30 +232,101 @@ private:
 	 void setVertexDescriptorFromVAO(MTLRenderPipelineDescriptor* pipelineDesc, const VertexArrayMetal* vertexArray,
 		const int32_t* locations, bool isInstanced, const ProgramMetal* program, const uint32_t* adjustedStride);
 	static BackendBuffer::ConversionMode getIboConversionMode(GLenum mode, GLenum type);
+	static BufferMetal* getIndexBufferMetal(const DrawParameters* drawParams);
+	static uint32_t getConvertedIndexCount(const DrawParameters* drawParams, const IboDynamicUpdateInfo* iboInfo);
+	void getVertexRangeFromIndices(const DrawParameters* drawParams, GLsizei count, GLenum type, const void* indices,
+		GLuint* startVertex, GLuint* endVertex);
 	bool updatePipelineStateUsedOrder(const PipelineState* pipelineState);
 	bool updateDepthStencilStateUsedOrder(const DepthStencilState* depthStencilState);
+	id<MTLRenderPipelineState> setupCopyPipelineState(MTLPixelFormat pixelFormat);
+	bool readPixelsToBuffer(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type,
+		BackendFramebuffer* readFramebuffer, GLenum readBuffer, size_t offset, const PackParameters* pack);
+	void releasePooledTextures();
 
 private:
 	// hash関数を指定したunordered_map
 	using PipelineStateMap = std::unordered_map<PipelineState, id<MTLRenderPipelineState>, PipelineState::Hash, std::equal_to<PipelineState>, AXGLStlAllocator<std::pair<const PipelineState, id<MTLRenderPipelineState>>>>;
+	// 孤立化(orphaning)したMTLBuffer
+	struct RecycledBuffer {
+		id<MTLBuffer> buffer;
+		// NOTE: このシリアルのサブミッション完了後に再利用できる
+		uint64_t serial;
+	};
+	using RecycledBufferMap = std::unordered_map<size_t, AXGLVector<RecycledBuffer>, std::hash<size_t>, std::equal_to<size_t>, AXGLStlAllocator<std::pair<const size_t, AXGLVector<RecycledBuffer>>>>;
 	using DepthStencilStateMap = std::unordered_map<DepthStencilState, id<MTLDepthStencilState>, DepthStencilState::Hash, std::equal_to<DepthStencilState>, AXGLStlAllocator<std::pair<const DepthStencilState, id<MTLDepthStencilState>>>>;
+	using CopyPipelineStateMap = AXGLUnorderedMap<NSUInteger, id<MTLRenderPipelineState>>;
+	// プールしたテクスチャのキー(同じキーのテクスチャは互いに置き換えられる)
+	struct TexturePoolKey {
+		MTLTextureType textureType;
+		MTLPixelFormat pixelFormat;
+		NSUInteger width;
+		NSUInteger height;
+		NSUInteger depth;
+		NSUInteger arrayLength;
+		NSUInteger mipmapLevelCount;
+		NSUInteger sampleCount;
+		MTLTextureUsage usage;
+		MTLStorageMode storageMode;
+		uint32_t swizzle;
+		bool operator==(const TexturePoolKey& rhs) const {
+			return (textureType == rhs.textureType) && (pixelFormat == rhs.pixelFormat)
+				&& (width == rhs.width) && (height == rhs.height) && (depth == rhs.depth) && (arrayLength == rhs.arrayLength)
+				&& (mipmapLevelCount == rhs.mipmapLevelCount) && (sampleCount == rhs.sampleCount)
+				&& (usage == rhs.usage) && (storageMode == rhs.storageMode) && (swizzle == rhs.swizzle);
+		}
+		struct Hash {
+			size_t operator()(const TexturePoolKey& key) const;
+		};
+	};
+	// 削除されたテクスチャ、レンダーバッファのストレージ
+	struct PooledTexture {
+		id<MTLTexture> texture;
+		size_t size;
+		// NOTE: このシリアルのサブミッション完了後に再利用できる
+		uint64_t serial;
+	};
+	using TexturePoolMap = std::unordered_map<TexturePoolKey, AXGLVector<PooledTexture>, TexturePoolKey::Hash, std::equal_to<TexturePoolKey>, AXGLStlAllocator<std::pair<const TexturePoolKey, AXGLVector<PooledTexture>>>>;
+	static TexturePoolKey getTexturePoolKey(MTLTextureDescriptor* desc);
+	static TexturePoolKey getTexturePoolKey(id<MTLTexture> texture);
 	id<MTLDevice> m_mtlDevice = nil;
 	id<MTLBuffer> m_disableBuffer = nil;
 	id<MTLCommandQueue> m_commandQueue = nil;
 	id<MTLCommandBuffer> m_drawCommandBuffer = nil;
+	id<MTLCommandBuffer> m_lastDrawCommandBuffer = nil; // 最後にcommitした描画用
+	SubmissionSerial m_submissionSerial;
+	ShadowBufferBudget m_shadowBufferBudget; // このコンテキストが最後に使用したシャドウバッファ
 	id<MTLRenderCommandEncoder> m_renderCommandEncoder = nil; // 描画用
 	id<MTLBlitCommandEncoder> m_blitCommandEncoder = nil; // Blit用
 	id<MTLBuffer> m_defaultUniformBuffer = nil;
 	size_t m_defaultUniformBufferOffset = 0;
 	id<MTLBuffer> m_dynamicBuffer = nil;
 	size_t m_dynamicBufferOffset = 0;
+	RecycledBufferMap m_recycledBuffers; // サイズ毎の再利用リスト
+	size_t m_recycledBufferTotalSize = 0;
+	BufferUploadStats m_bufferUploadStats = {};
+	TexturePoolMap m_texturePool; // キー毎の再利用リスト
+	TexturePoolStats m_texturePoolStats = {};
+	id<MTLBuffer> m_triFanIndexBuffer16 = nil;
+	id<MTLBuffer> m_triFanIndexBuffer32 = nil;
+	GLsizei m_triFanIndexCount16 = 0;
+	GLsizei m_triFanIndexCount32 = 0;
+	bool m_supportsBaseVertex = false;
 	MTLCompileOptions* m_compileOptions = nil;
 	PipelineStateMap m_pipelineStateCache;
 	AXGLList<const PipelineState*> m_pipelineStateUsedOrder;
 	DepthStencilStateMap m_depthStencilStateCache;
 	AXGLList<const DepthStencilState*> m_depthStencilStateUsedOrder;
+	id<MTLLibrary> m_copyLibrary = nil; // フレームバッファからのコピーでフォーマットを変換するシェーダ
+	CopyPipelineStateMap m_copyPipelineStates; // コピー先のMTLPixelFormat毎
 	FramebufferMetal* m_renderFramebuffer = nullptr;
+	// 描画コマンドエンコーダのテクスチャが設定されているアタッチメントと、ストアしないアタッチメント
+	uint32_t m_renderPassAttachmentMask = 0;
+	uint32_t m_renderPassDontCareStoreMask = 0;
+	RenderPassStats m_renderPassStats = {};
 	bool m_setDrawParameterToEncoder = false;
+	// 描画コマンドエンコーダに設定したサンプラのハンドル(Metalのサンプラインデックス毎、0は未設定)
+	uint64_t m_vsBoundSamplerHandles[AXGL_MAX_COMBINED_TEXTURE_IMAGE_UNITS] = {};
+	uint64_t m_fsBoundSamplerHandles[AXGL_MAX_COMBINED_TEXTURE_IMAGE_UNITS] = {};
 	SpirvMsl m_spirvMsl;
 };
 
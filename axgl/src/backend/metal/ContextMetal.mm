@@ -12,6 +12,10 @@
 #include "TextureMetal.h"
 #include "VertexArrayMetal.h"
 #include "../../AXGLAllocatorImpl.h"
+#include "../../common/IndexConversion.h"
+#include "../../common/MemoryAccounting.h"
+#include "../../common/PixelConversion.h"
+#include "../../common/VertexConversion.h"
 #include "../../core/CoreBuffer.h"
 #include "../../core/CoreFramebuffer.h"
 #include "../../core/CoreQuery.h"
@@ -20,6 +24,7 @@
 #include "../../core/CoreVertexArray.h"
 
 #include <algorithm>
+#include <limits>
 
 namespace axgl {
 
@@ -70,12 +75,460 @@ static uint32_t calc_mipmap_size(uint32_t size0, int level)
 	return size;
 }
 
+// 整数のピクセルフォーマットか
+static bool is_integer_pixel_format(MTLPixelFormat pixelFormat)
+{
+	bool is_integer = false;
+	switch (pixelFormat) {
+	case MTLPixelFormatR8Uint:
+	case MTLPixelFormatR8Sint:
+	case MTLPixelFormatR16Uint:
+	case MTLPixelFormatR16Sint:
+	case MTLPixelFormatR32Uint:
+	case MTLPixelFormatR32Sint:
+	case MTLPixelFormatRG8Uint:
+	case MTLPixelFormatRG8Sint:
+	case MTLPixelFormatRG16Uint:
+	case MTLPixelFormatRG16Sint:
+	case MTLPixelFormatRG32Uint:
+	case MTLPixelFormatRG32Sint:
+	case MTLPixelFormatRGBA8Uint:
+	case MTLPixelFormatRGBA8Sint:
+	case MTLPixelFormatRGB10A2Uint:
+	case MTLPixelFormatRGBA16Uint:
+	case MTLPixelFormatRGBA16Sint:
+	case MTLPixelFormatRGBA32Uint:
+	case MTLPixelFormatRGBA32Sint:
+		is_integer = true;
+		break;
+	default:
+		break;
+	}
+	return is_integer;
+}
+
+// glReadPixelsで読み出すピクセルフォーマットの分類
+enum ReadbackClass {
+	ReadbackClassUnorm8 = 0, // 8bitの正規化整数(GL_RGBA/GL_UNSIGNED_BYTEに変換できる)
+	ReadbackClassHalf = 1, // 16bit浮動小数点(GL_RGBA/GL_FLOATに変換できる)
+	ReadbackClassFloat = 2, // 32bit浮動小数点(GL_RGBA/GL_FLOATに変換できる)
+	ReadbackClassUint = 3, // 符号なし整数(GL_RGBA_INTEGER/GL_UNSIGNED_INTに変換できる)
+	ReadbackClassSint = 4, // 符号付き整数(GL_RGBA_INTEGER/GL_INTに変換できる)
+	ReadbackClassDepth16 = 5, // 16bitの深度(GL_DEPTH_COMPONENT/GL_FLOATに変換できる)
+	ReadbackClassDepth32 = 6, // 32bit浮動小数点の深度
+	ReadbackClassPacked = 7 // パックされたフォーマット(変換しない)
+};
+
+// glReadPixelsで読み出すピクセルフォーマットの情報
+struct ReadbackFormat {
+	MTLPixelFormat pixelFormat;
+	// ピクセルの内容をそのまま読み出すformat,type(GL_IMPLEMENTATION_COLOR_READ_FORMAT/TYPE)
+	GLenum format;
+	GLenum type;
+	ReadbackClass readbackClass;
+	uint32_t components;
+	uint32_t componentSize;
+	// BGRAの順に格納されている(formatはGL_RGBAで、読み出し時にR,Bを入れ替える)
+	bool bgra;
+};
+
+static constexpr ReadbackFormat c_readback_formats[] = {
+	{MTLPixelFormatRGBA8Unorm, GL_RGBA, GL_UNSIGNED_BYTE, ReadbackClassUnorm8, 4, 1, false},
+	{MTLPixelFormatRGBA8Unorm_sRGB, GL_RGBA, GL_UNSIGNED_BYTE, ReadbackClassUnorm8, 4, 1, false},
+	{MTLPixelFormatBGRA8Unorm, GL_RGBA, GL_UNSIGNED_BYTE, ReadbackClassUnorm8, 4, 1, true},
+	{MTLPixelFormatBGRA8Unorm_sRGB, GL_RGBA, GL_UNSIGNED_BYTE, ReadbackClassUnorm8, 4, 1, true},
+	{MTLPixelFormatR8Unorm, GL_RED, GL_UNSIGNED_BYTE, ReadbackClassUnorm8, 1, 1, false},
+	{MTLPixelFormatRG8Unorm, GL_RG, GL_UNSIGNED_BYTE, ReadbackClassUnorm8, 2, 1, false},
+	{MTLPixelFormatRGB10A2Unorm, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, ReadbackClassPacked, 1, 4, false},
+	{MTLPixelFormatRG11B10Float, GL_RGB, GL_UNSIGNED_INT_10F_11F_11F_REV, ReadbackClassPacked, 1, 4, false},
+	{MTLPixelFormatR16Float, GL_RED, GL_HALF_FLOAT, ReadbackClassHalf, 1, 2, false},
+	{MTLPixelFormatRG16Float, GL_RG, GL_HALF_FLOAT, ReadbackClassHalf, 2, 2, false},
+	{MTLPixelFormatRGBA16Float, GL_RGBA, GL_HALF_FLOAT, ReadbackClassHalf, 4, 2, false},
+	{MTLPixelFormatR32Float, GL_RED, GL_FLOAT, ReadbackClassFloat, 1, 4, false},
+	{MTLPixelFormatRG32Float, GL_RG, GL_FLOAT, ReadbackClassFloat, 2, 4, false},
+	{MTLPixelFormatRGBA32Float, GL_RGBA, GL_FLOAT, ReadbackClassFloat, 4, 4, false},
+	{MTLPixelFormatR8Uint, GL_RED_INTEGER, GL_UNSIGNED_BYTE, ReadbackClassUint, 1, 1, false},
+	{MTLPixelFormatRG8Uint, GL_RG_INTEGER, GL_UNSIGNED_BYTE, ReadbackClassUint, 2, 1, false},
+	{MTLPixelFormatRGBA8Uint, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, ReadbackClassUint, 4, 1, false},
+	{MTLPixelFormatR16Uint, GL_RED_INTEGER, GL_UNSIGNED_SHORT, ReadbackClassUint, 1, 2, false},
+	{MTLPixelFormatRG16Uint, GL_RG_INTEGER, GL_UNSIGNED_SHORT, ReadbackClassUint, 2, 2, false},
+	{MTLPixelFormatRGBA16Uint, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, ReadbackClassUint, 4, 2, false},
+	{MTLPixelFormatR32Uint, GL_RED_INTEGER, GL_UNSIGNED_INT, ReadbackClassUint, 1, 4, false},
+	{MTLPixelFormatRG32Uint, GL_RG_INTEGER, GL_UNSIGNED_INT, ReadbackClassUint, 2, 4, false},
+	{MTLPixelFormatRGBA32Uint, GL_RGBA_INTEGER, GL_UNSIGNED_INT, ReadbackClassUint, 4, 4, false},
+	{MTLPixelFormatRGB10A2Uint, GL_RGBA_INTEGER, GL_UNSIGNED_INT_2_10_10_10_REV, ReadbackClassPacked, 1, 4, false},
+	{MTLPixelFormatR8Sint, GL_RED_INTEGER, GL_BYTE, ReadbackClassSint, 1, 1, false},
+	{MTLPixelFormatRG8Sint, GL_RG_INTEGER, GL_BYTE, ReadbackClassSint, 2, 1, false},
+	{MTLPixelFormatRGBA8Sint, GL_RGBA_INTEGER, GL_BYTE, ReadbackClassSint, 4, 1, false},
+	{MTLPixelFormatR16Sint, GL_RED_INTEGER, GL_SHORT, ReadbackClassSint, 1, 2, false},
+	{MTLPixelFormatRG16Sint, GL_RG_INTEGER, GL_SHORT, ReadbackClassSint, 2, 2, false},
+	{MTLPixelFormatRGBA16Sint, GL_RGBA_INTEGER, GL_SHORT, ReadbackClassSint, 4, 2, false},
+	{MTLPixelFormatR32Sint, GL_RED_INTEGER, GL_INT, ReadbackClassSint, 1, 4, false},
+	{MTLPixelFormatRG32Sint, GL_RG_INTEGER, GL_INT, ReadbackClassSint, 2, 4, false},
+	{MTLPixelFormatRGBA32Sint, GL_RGBA_INTEGER, GL_INT, ReadbackClassSint, 4, 4, false},
+	{MTLPixelFormatDepth16Unorm, GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT, ReadbackClassDepth16, 1, 2, false},
+	{MTLPixelFormatDepth32Float, GL_DEPTH_COMPONENT, GL_FLOAT, ReadbackClassDepth32, 1, 4, false},
+	// NOTE: 深度のみをBlitで読み出す(MTLBlitOptionDepthFromDepthStencil)
+	{MTLPixelFormatDepth32Float_Stencil8, GL_DEPTH_COMPONENT, GL_FLOAT, ReadbackClassDepth32, 1, 4, false}
+};
+
+// 読み出すピクセルフォーマットの情報を取得(読み出せない場合はnullptr)
+static const ReadbackFormat* get_readback_format(MTLPixelFormat pixelFormat)
+{
+	for (const ReadbackFormat& readback_format : c_readback_formats) {
+		if (readback_format.pixelFormat == pixelFormat) {
+			return &readback_format;
+		}
+	}
+	return nullptr;
+}
+
+// ピクセルの内容をそのまま読み出すformat,typeか
+static bool is_readback_native(const ReadbackFormat* readbackFormat, GLenum format, GLenum type)
+{
+	return (format == readbackFormat->format) && (type == readbackFormat->type);
+}
+
+// 変換して読み出せるformat,typeか(ES 3.0で常に読み出せる組み合わせ)
+static bool is_readback_convertible(const ReadbackFormat* readbackFormat, GLenum format, GLenum type)
+{
+	bool convertible = false;
+	switch (readbackFormat->readbackClass) {
+	case ReadbackClassUnorm8:
+		convertible = (format == GL_RGBA) && (type == GL_UNSIGNED_BYTE);
+		break;
+	case ReadbackClassHalf:
+	case ReadbackClassFloat:
+		convertible = (format == GL_RGBA) && (type == GL_FLOAT);
+		break;
+	case ReadbackClassUint:
+		convertible = (format == GL_RGBA_INTEGER) && (type == GL_UNSIGNED_INT);
+		break;
+	case ReadbackClassSint:
+		convertible = (format == GL_RGBA_INTEGER) && (type == GL_INT);
+		break;
+	case ReadbackClassDepth16:
+		convertible = (format == GL_DEPTH_COMPONENT) && (type == GL_FLOAT);
+		break;
+	default:
+		break;
+	}
+	return convertible;
+}
+
+// 読み出し元の1ピクセルのバイト数
+static inline size_t get_readback_src_bytes_per_pixel(const ReadbackFormat* readbackFormat)
+{
+	return static_cast<size_t>(readbackFormat->components) * readbackFormat->componentSize;
+}
+
+// 書き込み先の1ピクセルのバイト数
+static size_t get_readback_dst_bytes_per_pixel(const ReadbackFormat* readbackFormat, bool native)
+{
+	if (native) {
+		return get_readback_src_bytes_per_pixel(readbackFormat);
+	}
+	size_t bytes_per_pixel = 0;
+	switch (readbackFormat->readbackClass) {
+	case ReadbackClassUnorm8:
+		bytes_per_pixel = 4 * sizeof(uint8_t);
+		break;
+	case ReadbackClassHalf:
+	case ReadbackClassFloat:
+	case ReadbackClassUint:
+	case ReadbackClassSint:
+		bytes_per_pixel = 4 * sizeof(uint32_t);
+		break;
+	case ReadbackClassDepth16:
+		bytes_per_pixel = sizeof(float);
+		break;
+	default:
+		break;
+	}
+	return bytes_per_pixel;
+}
+
+// 整数の要素を読み出す(アライメントを問わない)
+static inline uint32_t load_readback_uint(const uint8_t* src, uint32_t size)
+{
+	uint32_t value = 0;
+	if (size == 1) {
+		value = src[0];
+	} else if (size == 2) {
+		uint16_t v16;
+		memcpy(&v16, src, sizeof(v16));
+		value = v16;
+	} else {
+		memcpy(&value, src, sizeof(value));
+	}
+	return value;
+}
+
+static inline int32_t load_readback_sint(const uint8_t* src, uint32_t size)
+{
+	int32_t value = 0;
+	if (size == 1) {
+		value = static_cast<int8_t>(src[0]);
+	} else if (size == 2) {
+		int16_t v16;
+		memcpy(&v16, src, sizeof(v16));
+		value = v16;
+	} else {
+		memcpy(&value, src, sizeof(value));
+	}
+	return value;
+}
+
+// 読み出したピクセルの1行を、変換先のformat,typeに変換する
+// NOTE: 存在しない要素は(0,0,0,1)で補う
+static void convert_readback_row(uint8_t* dst, const uint8_t* src, size_t width, const ReadbackFormat* readbackFormat)
+{
+	const uint32_t components = readbackFormat->components;
+	const uint32_t component_size = readbackFormat->componentSize;
+	const size_t src_bytes_per_pixel = get_readback_src_bytes_per_pixel(readbackFormat);
+	switch (readbackFormat->readbackClass) {
+	case ReadbackClassUnorm8:
+		for (size_t i = 0; i < width; i++) {
+			uint8_t rgba[4] = {0, 0, 0, 255};
+			memcpy(rgba, src, components);
+			memcpy(dst, rgba, sizeof(rgba));
+			src += src_bytes_per_pixel;
+			dst += sizeof(rgba);
+		}
+		break;
+	case ReadbackClassHalf:
+		if (components == 4) {
+			convertHalfToFloat(dst, src, width * 4);
+			break;
+		}
+		for (size_t i = 0; i < width; i++) {
+			float rgba[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+			convertHalfToFloat(rgba, src, components);
+			memcpy(dst, rgba, sizeof(rgba));
+			src += src_bytes_per_pixel;
+			dst += sizeof(rgba);
+		}
+		break;
+	case ReadbackClassFloat:
+		for (size_t i = 0; i < width; i++) {
+			float rgba[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+			memcpy(rgba, src, src_bytes_per_pixel);
+			memcpy(dst, rgba, sizeof(rgba));
+			src += src_bytes_per_pixel;
+			dst += sizeof(rgba);
+		}
+		break;
+	case ReadbackClassUint:
+		for (size_t i = 0; i < width; i++) {
+			uint32_t rgba[4] = {0, 0, 0, 1};
+			for (uint32_t c = 0; c < components; c++) {
+				rgba[c] = load_readback_uint(src + (c * component_size), component_size);
+			}
+			memcpy(dst, rgba, sizeof(rgba));
+			src += src_bytes_per_pixel;
+			dst += sizeof(rgba);
+		}
+		break;
+	case ReadbackClassSint:
+		for (size_t i = 0; i < width; i++) {
+			int32_t rgba[4] = {0, 0, 0, 1};
+			for (uint32_t c = 0; c < components; c++) {
+				rgba[c] = load_readback_sint(src + (c * component_size), component_size);
+			}
+			memcpy(dst, rgba, sizeof(rgba));
+			src += src_bytes_per_pixel;
+			dst += sizeof(rgba);
+		}
+		break;
+	case ReadbackClassDepth16:
+		for (size_t i = 0; i < width; i++) {
+			float depth = static_cast<float>(load_readback_uint(src, sizeof(uint16_t))) / 65535.0f;
+			memcpy(dst, &depth, sizeof(depth));
+			src += src_bytes_per_pixel;
+			dst += sizeof(depth);
+		}
+		break;
+	default:
+		AXGL_ASSERT(0);
+		break;
+	}
+	return;
+}
+
+// glReadPixelsの読み出し元
+struct ReadSource {
+	id<MTLTexture> texture;
+	uint32_t level;
+	uint32_t slice;
+	const ReadbackFormat* readbackFormat;
+	// CAMetalLayerのレンダーバッファを含むフレームバッファは、GLと上下反対で描画されている
+	bool flipY;
+};
+
+// 読み出し元のテクスチャを取得する(GL_DEPTH_COMPONENTは深度アタッチメントから読み出す)
+// NOTE: 読み出すターゲットが存在しない場合はtextureがnil
+static void get_read_source(BackendFramebuffer* readFramebuffer, GLenum readBuffer, GLenum format, ReadSource* source)
+{
+	AXGL_ASSERT(source != nullptr);
+	source->texture = nil;
+	source->level = 0;
+	source->slice = 0;
+	source->readbackFormat = nullptr;
+	source->flipY = false;
+	// NOTE: デフォルトフレームバッファのリードをiOS GLESはサポートしない
+	if (readFramebuffer == nullptr) {
+		return;
+	}
+	FramebufferMetal* framebuffer_metal = static_cast<FramebufferMetal*>(readFramebuffer);
+	// ストレージが再指定されたアタッチメントのMTLTextureを設定し直す
+	framebuffer_metal->updateAttachmentTextures();
+	if (format == GL_DEPTH_COMPONENT) {
+		source->texture = framebuffer_metal->getDepthTexture();
+		source->level = framebuffer_metal->getDepthTextureLevel();
+		source->slice = framebuffer_metal->getDepthTextureSlice();
+	} else if ((readBuffer >= GL_COLOR_ATTACHMENT0) && (readBuffer < (GL_COLOR_ATTACHMENT0 + AXGL_MAX_COLOR_ATTACHMENTS))) {
+		int attach_index = readBuffer - GL_COLOR_ATTACHMENT0;
+		source->texture = framebuffer_metal->getColorTexture(attach_index);
+		source->level = framebuffer_metal->getColorTextureLevel(attach_index);
+		source->slice = framebuffer_metal->getColorTextureSlice(attach_index);
+	}
+	if (source->texture != nil) {
+		source->readbackFormat = get_readback_format(source->texture.pixelFormat);
+		source->flipY = !framebuffer_metal->onlyOffscreenBufferAttached();
+	}
+	return;
+}
+
+// 読み出し元をBlitで読み出せるか
+static bool is_readable_source(const ReadSource& source)
+{
+	if (source.texture.framebufferOnly == YES) {
+		AXGL_DBGOUT("readPixels> framebufferOnly:YES, MTLTexture can not be blit source\n");
+		return false;
+	}
+	if ([source.texture sampleCount] > 1) {
+		AXGL_DBGOUT("readPixels> multisample read buffer is not supported\n");
+		return false;
+	}
+	if (source.readbackFormat == nullptr) {
+		AXGL_DBGOUT("readPixels> unsupported MTLPixelFormat:%d\n", (int)source.texture.pixelFormat);
+		return false;
+	}
+	return true;
+}
+
+// 読み出す範囲を読み出し元の範囲にクリップする(範囲が空の場合はfalse)
+// NOTE: 範囲外のピクセルは未定義のため、書き込み先の対応する位置は書き換えない
+static bool clip_read_region(const ReadSource& source, GLint x, GLint y, GLsizei width, GLsizei height,
+	int32_t* x0, int32_t* y0, int32_t* x1, int32_t* y1, int32_t* srcHeight)
+{
+	int32_t src_width = (int32_t)calc_mipmap_size((uint32_t)[source.texture width], source.level);
+	*srcHeight = (int32_t)calc_mipmap_size((uint32_t)[source.texture height], source.level);
+	*x0 = std::max(x, 0);
+	*y0 = std::max(y, 0);
+	*x1 = std::min(x + width, src_width);
+	*y1 = std::min(y + height, *srcHeight);
+	return (*x0 < *x1) && (*y0 < *y1);
+}
+
+// パックパラメータから書き込み先の行のバイト数と、先頭のスキップするバイト数を取得
+static void get_pack_layout(GLsizei width, size_t bytesPerPixel, const BackendContext::PackParameters* pack,
+	size_t* bytesPerRow, size_t* skipBytes)
+{
+	AXGL_ASSERT((pack != nullptr) && (bytesPerRow != nullptr) && (skipBytes != nullptr));
+	size_t row_length = (pack->rowLength > 0) ? static_cast<size_t>(pack->rowLength) : static_cast<size_t>(width);
+	size_t alignment = (pack->alignment > 0) ? static_cast<size_t>(pack->alignment) : 1;
+	*bytesPerRow = (((row_length * bytesPerPixel) + alignment - 1) / alignment) * alignment;
+	*skipBytes = (static_cast<size_t>(pack->skipRows) * (*bytesPerRow)) + (static_cast<size_t>(pack->skipPixels) * bytesPerPixel);
+	return;
+}
+
+// フレームバッファからのコピーでフォーマットを変換するシェーダ
+// NOTE: 画面全体を覆う三角形を描画し、ビューポートの範囲にコピー元のテクセルを書き込む
+static const char* c_copy_texture_msl =
+	"#include <metal_stdlib>\n"
+	"using namespace metal;\n"
+	"struct CopyVertexOut {\n"
+	"	float4 position [[position]];\n"
+	"};\n"
+	"struct CopyParams {\n"
+	"	int2 dstOrigin;\n"
+	"	int flipY;\n"
+	"	int height;\n"
+	"};\n"
+	"vertex CopyVertexOut axgl_copy_vs(uint vid [[vertex_id]]) {\n"
+	"	CopyVertexOut out;\n"
+	"	float2 uv = float2((vid << 1) & 2, vid & 2);\n"
+	"	out.position = float4((uv * 2.0) - 1.0, 0.0, 1.0);\n"
+	"	return out;\n"
+	"}\n"
+	"fragment float4 axgl_copy_fs(CopyVertexOut in [[stage_in]], texture2d<float> src [[texture(0)]],\n"
+	"	constant CopyParams& params [[buffer(0)]]) {\n"
+	"	int2 pos = int2(in.position.xy) - params.dstOrigin;\n"
+	"	if (params.flipY != 0) {\n"
+	"		pos.y = params.height - 1 - pos.y;\n"
+	"	}\n"
+	"	return src.read(uint2(pos));\n"
+	"}\n";
+
 // バッファのアライメントされたストライドを取得
 static inline uint32_t get_aligned_stride(uint32_t val)
 {
 	return ((val + 3) / 4) * 4; // 4バイトアライメント
 }
 
+// 頂点範囲から動的バッファにコピーするバイト範囲[start, end)を算出
+static inline void get_vertex_byte_range(uint32_t startVertex, uint32_t endVertex, uint32_t stride, size_t* start, size_t* end)
+{
+	*start = static_cast<size_t>(startVertex) * stride;
+	// NOTE: 属性のオフセット分を含めるため、最後の頂点の次の頂点までを範囲とする
+	*end = (endVertex == UINT32_MAX) ? SIZE_MAX : ((static_cast<size_t>(endVertex) + 2) * stride);
+	return;
+}
+
+// 頂点属性が参照する頂点の範囲[start, end]を取得
+static inline void get_attrib_vertex_range(GLuint divisor, uint32_t startVertex, uint32_t endVertex, GLsizei instanceCount,
+	uint32_t* start, uint32_t* end)
+{
+	if (divisor == 0) {
+		// 頂点毎の属性は描画する頂点の範囲
+		*start = startVertex;
+		*end = endVertex;
+	} else {
+		// インスタンス毎の属性はインスタンス数とdivisorから範囲を決定
+		*start = 0;
+		*end = (instanceCount > 0) ? (static_cast<uint32_t>(instanceCount - 1) / divisor) : 0;
+	}
+	return;
+}
+
+// TriangleFanを三角形リストとして描画するインデックスを作成
+template <typename T>
+static void make_tri_fan_indices(T* dst, uint32_t base, GLsizei count)
+{
+	AXGL_ASSERT(dst != nullptr);
+	int32_t num_triangle = count - 2;
+	for (int32_t i = 0; i < num_triangle; i++) {
+		dst[0] = static_cast<T>(base);
+		dst[1] = static_cast<T>(base + i + 1);
+		dst[2] = static_cast<T>(base + i + 2);
+		dst += 3;
+	}
+	return;
+}
+
+// LineLoopをLineStripとして描画するインデックスを作成
+template <typename T>
+static void make_line_loop_indices(T* dst, uint32_t base, GLsizei count)
+{
+	AXGL_ASSERT(dst != nullptr);
+	for (int32_t i = 0; i < count; i++) {
+		dst[i] = static_cast<T>(base + i);
+	}
+	dst[count] = static_cast<T>(base);
+	return;
+}
+
 // サンプラのタイプから使用するテクスチャを取得する
 static const CoreTexture* get_core_texture(const DrawParameters* drawParams, int32_t type, int index)
 {
@@ -127,16 +580,23 @@ static constexpr BackendRenderbufferFormat c_rbformat[] = {
 };
 static constexpr size_t c_default_uniform_buffer_size = (8 * 1024 * 1024); // 8MB
 static constexpr size_t c_dynamic_buffer_size = (8 * 1024 * 1024); // 8MB
+static constexpr size_t c_recycled_buffer_total_max = (32 * 1024 * 1024); // 32MB
+static constexpr size_t c_recycled_buffer_per_size_max = 4;
+static constexpr size_t c_texture_pool_total_max = (64 * 1024 * 1024); // 64MB
+static constexpr size_t c_texture_pool_per_key_max = 4;
 static constexpr size_t c_pipeline_state_cache_max = 512;
 static constexpr size_t c_depth_stencil_state_cache_max = 64;
 static constexpr uint32_t c_vbo_index_offset = AXGL_MAX_UNIFORM_BUFFER_BINDINGS;
+static constexpr GLsizei c_tri_fan_index_count_min = 64;
+// NOTE: Metalは0xFFFFを常にプリミティブリスタートとして扱うため、uint16で表現できる頂点数は65535まで
+static constexpr GLsizei c_index_count_max_u16 = 65535;
 
 static constexpr BackendContext::PlatformParams c_platformParams = {
 	{1.0f,1.0f}, // aliasedLineWidthRange
 	{1.0f,511.0f}, // aliasedPointSizeRange
 	nullptr, // TODO: compressedTextureFormats
-	0, // TODO: implementationColorReadFormat
-	0, // TODO: implementationColorReadType
+	GL_RGBA, // implementationColorReadFormat
+	GL_UNSIGNED_BYTE, // implementationColorReadType
 	2048, // max3dTextureSize
 	2048, // maxArrayTextureLayers
 	4,    // maxColorAttachments
@@ -185,6 +645,23 @@ static constexpr BackendContext::PlatformParams c_platformParams = {
 	0 //TODO : GLint uniformBufferOffsetAlignment;
 };
 
+// TexturePoolKeyのハッシュ
+size_t ContextMetal::TexturePoolKey::Hash::operator()(const TexturePoolKey& key) const
+{
+	size_t h = std::hash<NSUInteger>()(static_cast<NSUInteger>(key.pixelFormat));
+	combineHash(&h, static_cast<size_t>(key.textureType));
+	combineHash(&h, static_cast<size_t>(key.width));
+	combineHash(&h, static_cast<size_t>(key.height));
+	combineHash(&h, static_cast<size_t>(key.depth));
+	combineHash(&h, static_cast<size_t>(key.arrayLength));
+	combineHash(&h, static_cast<size_t>(key.mipmapLevelCount));
+	combineHash(&h, static_cast<size_t>(key.sampleCount));
+	combineHash(&h, static_cast<size_t>(key.usage));
+	combineHash(&h, static_cast<size_t>(key.storageMode));
+	combineHash(&h, static_cast<size_t>(key.swizzle));
+	return h;
+}
+
 // コンストラクタ
 ContextMetal::ContextMetal()
 {
@@ -228,6 +705,8 @@ bool ContextMetal::initialize()
 			return false;
 		}
 	}
+	// ベース頂点を指定したインデックス描画が可能か
+	m_supportsBaseVertex = [m_mtlDevice supportsFamily:MTLGPUFamilyApple3] || [m_mtlDevice supportsFamily:MTLGPUFamilyMac2];
 	// glslangを初期化
 	// NOTE: プロセスで１回初期化すれば良く、static変数を参照して呼び出すようにしたほうが良いかも
 	m_spirvMsl.initialize();
@@ -237,11 +716,36 @@ bool ContextMetal::initialize()
 // 終了処理
 void ContextMetal::terminate()
 {
+	// NOTE: 完了ハンドラがm_submissionSerialを参照するため、最後のコマンドバッファの完了を待つ
+	if (m_lastDrawCommandBuffer != nil) {
+		[m_lastDrawCommandBuffer waitUntilCompleted];
+	}
+	MemoryAccounting& memory_accounting = MemoryAccounting::getInstance();
+	if (m_defaultUniformBuffer != nil) {
+		memory_accounting.update(MemoryCategoryStaging, c_default_uniform_buffer_size, 0);
+	}
+	if (m_dynamicBuffer != nil) {
+		memory_accounting.update(MemoryCategoryStaging, [m_dynamicBuffer length], 0);
+	}
 	m_defaultUniformBuffer = nil;
+	m_dynamicBuffer = nil;
 	m_drawCommandBuffer = nil;
+	m_lastDrawCommandBuffer = nil;
+	m_recycledBuffers.clear();
+	memory_accounting.update(MemoryCategoryPool, m_recycledBufferTotalSize, 0);
+	m_recycledBufferTotalSize = 0;
+	releasePooledTextures();
+	m_shadowBufferBudget.clear();
+	m_submissionSerial.reset();
 	m_renderCommandEncoder = nil;
 	m_blitCommandEncoder = nil;
 	m_disableBuffer = nil;
+	m_triFanIndexBuffer16 = nil;
+	m_triFanIndexBuffer32 = nil;
+	m_triFanIndexCount16 = 0;
+	m_triFanIndexCount32 = 0;
+	m_copyPipelineStates.clear();
+	m_copyLibrary = nil;
 	m_compileOptions = nil;
 	m_commandQueue = nil;
 	m_mtlDevice = nil;
@@ -517,17 +1021,13 @@ bool ContextMetal::clearBufferfi(GLenum buffer, GLint drawbuffer, GLfloat depth,
 bool ContextMetal::drawArrays(GLenum mode, GLint first, GLsizei count, const DrawParameters* drawParams, const ClearParameters* clearParams)
 {
 	AXGL_ASSERT((drawParams != nullptr) && (clearParams != nullptr));
-	// TriangleFanの場合は変換処理が必要
-	BackendBuffer::ConversionMode vbo_conversion = BackendBuffer::ConversionModeNone;
-	if (mode == GL_TRIANGLE_FAN) {
-		vbo_conversion = BackendBuffer::ConversionModeTriFanVertices;
-	}
 	// 各バッファの更新をチェックする
 	VboUpdateInfo vbo_update_info;
 	UboUpdateInfo ubo_update_info;
 	VboDynamicUpdateInfo vbo_dynamic_update_info;
 	UboDynamicUpdateInfo ubo_dynamic_update_info;
-	bool vbo_update = checkVBOUpdate(&vbo_update_info, &vbo_dynamic_update_info, drawParams, vbo_conversion, first, count);
+	GLuint end_vertex = (count > 0) ? static_cast<GLuint>(first + count - 1) : static_cast<GLuint>(first);
+	bool vbo_update = checkVBOUpdate(&vbo_update_info, &vbo_dynamic_update_info, drawParams, first, end_vertex, 1, true);
 	bool ubo_update = checkUBOUpdate(&ubo_update_info, &ubo_dynamic_update_info, drawParams);
 	// 描画コマンドバッファを用意
 	setupDrawCommandBuffer();
@@ -551,6 +1051,8 @@ bool ContextMetal::drawArrays(GLenum mode, GLint first, GLsizei count, const Dra
 	}
 	// 動的バッファ用のMTLBufferを更新
 	updateDynamicBuffers(&vbo_dynamic_update_info, &ubo_dynamic_update_info, nullptr);
+	// 描画で参照するバッファに、記録中のサブミッションのシリアルを設定
+	markBuffersInUse(drawParams);
 	// MTLRenderPipelineStateを用意
 	bool same_as_last_ps = false;
 	id<MTLRenderPipelineState> pipeline_state = setupRenderPipelineState(drawParams, vbo_update_info.alignedStride, &same_as_last_ps);
@@ -635,16 +1137,18 @@ bool ContextMetal::drawArrays(GLenum mode, GLint first, GLsizei count, const Dra
 			setDepthBias(command_encoder, &drawParams->polygonOffsetParams);
 		}
 		// drawPrimitivesの呼び出し
+		// NOTE: クライアントメモリの頂点配列を動的バッファの割り当て位置から格納した場合は、先頭の頂点をずらす
+		GLint vertex_start = first - static_cast<GLint>(vbo_dynamic_update_info.baseVertex);
 		if (mode == GL_TRIANGLE_FAN) {
-			if (count > 2) {
-				// TriangleFan(TriangleFan変換済みのデータは常にバッファ先頭から格納)
-				uint32_t tri_fan_count = (count - 2) * 3;
-				[command_encoder drawPrimitives:MTLPrimitiveTypeTriangle vertexStart:0 vertexCount:tri_fan_count];
-			}
+			// TriangleFan(インデックスを使用して元の頂点バッファから描画)
+			drawTriFanArrays(command_encoder, vertex_start, count, 1);
+		} else if (mode == GL_LINE_LOOP) {
+			// LineLoop(インデックスでループを閉じて描画)
+			drawLineLoopArrays(command_encoder, vertex_start, count, 1);
 		} else {
 			// TriangleFan以外
 			MTLPrimitiveType primitive_type = convert_primitive_type(mode);
-			[command_encoder drawPrimitives:primitive_type vertexStart:first vertexCount:count];
+			[command_encoder drawPrimitives:primitive_type vertexStart:vertex_start vertexCount:count];
 		}
 		// 描画パラメータを設定済み
 		m_setDrawParameterToEncoder = true;
@@ -656,6 +1160,18 @@ bool ContextMetal::drawArrays(GLenum mode, GLint first, GLsizei count, const Dra
 
 // インデックスありの描画を実行(glDrawElements相当)
 bool ContextMetal::drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices, const DrawParameters* drawParams, const ClearParameters* clearParams)
+{
+	AXGL_ASSERT((drawParams != nullptr) && (clearParams != nullptr));
+	// インデックスから使用する頂点の範囲を取得
+	GLuint start_vertex = 0;
+	GLuint end_vertex = UINT32_MAX;
+	getVertexRangeFromIndices(drawParams, count, type, indices, &start_vertex, &end_vertex);
+	return drawRangeElements(mode, start_vertex, end_vertex, count, type, indices, drawParams, clearParams);
+}
+
+// 頂点範囲を指定したインデックスありの描画を実行(glDrawRangeElements相当)
+bool ContextMetal::drawRangeElements(GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void* indices,
+	const DrawParameters* drawParams, const ClearParameters* clearParams)
 {
 	AXGL_ASSERT((drawParams != nullptr) && (clearParams != nullptr));
 	// インデックスバッファの変換を判別
@@ -670,9 +1186,9 @@ bool ContextMetal::drawElements(GLenum mode, GLsizei count, GLenum type, const v
 	VboDynamicUpdateInfo vbo_dynamic_update_info;
 	UboDynamicUpdateInfo ubo_dynamic_update_info;
 	IboDynamicUpdateInfo ibo_dynamic_update_info;
-	bool vbo_update = checkVBOUpdate(&vbo_update_info, &vbo_dynamic_update_info, drawParams, BackendBuffer::ConversionModeNone, 0, 0);
+	bool vbo_update = checkVBOUpdate(&vbo_update_info, &vbo_dynamic_update_info, drawParams, start, end, 1, m_supportsBaseVertex);
 	bool ubo_update = checkUBOUpdate(&ubo_update_info, &ubo_dynamic_update_info, drawParams);
-	bool ibo_update = checkIBOUpdate(&ibo_update_info, &ibo_dynamic_update_info, drawParams, ibo_conversion, ibo_offset, ibo_size, is_ubyte);
+	bool ibo_update = checkIBOUpdate(&ibo_update_info, &ibo_dynamic_update_info, drawParams, ibo_conversion, ibo_offset, ibo_size, type);
 	// 描画コマンドバッファを用意
 	setupDrawCommandBuffer();
 	AXGL_ASSERT(m_drawCommandBuffer != nil);
@@ -699,6 +1215,8 @@ bool ContextMetal::drawElements(GLenum mode, GLsizei count, GLenum type, const v
 	}
 	// 動的バッファ用のMTLBufferを更新
 	updateDynamicBuffers(&vbo_dynamic_update_info, &ubo_dynamic_update_info, &ibo_dynamic_update_info);
+	// 描画で参照するバッファに、記録中のサブミッションのシリアルを設定
+	markBuffersInUse(drawParams);
 	// MTLRenderPipelineStateを用意
 	bool same_as_last_ps = false;
 	id<MTLRenderPipelineState> pipeline_state = setupRenderPipelineState(drawParams, vbo_update_info.alignedStride, &same_as_last_ps);
@@ -805,20 +1323,30 @@ bool ContextMetal::drawElements(GLenum mode, GLsizei count, GLenum type, const v
 		if (index_buffer != nil) {
 			MTLIndexType index_type = convert_index_type(type);
 			if (mode == GL_TRIANGLE_FAN) {
-				if (count > 2) {
-					// TriangleFan(TriangleFan変換済みのデータは常にバッファ先頭から格納)
-					uint32_t tri_fan_count = (count - 2) * 3;
-					[command_encoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle indexCount:tri_fan_count indexType:index_type indexBuffer:index_buffer indexBufferOffset:index_buffer_base_offset];
+				// TriangleFan(TriangleFan変換済みのデータは常にバッファ先頭から格納)
+				// NOTE: プリミティブリスタートが有効な場合は変換後のインデックス数が変わるため、変換結果の数を使用する
+				uint32_t tri_fan_count = getConvertedIndexCount(drawParams, &ibo_dynamic_update_info);
+				if ((count > 2) && (tri_fan_count > 0)) {
+					drawIndexedPrimitives(command_encoder, MTLPrimitiveTypeTriangle, tri_fan_count, index_type, index_buffer, index_buffer_base_offset, 1, vbo_dynamic_update_info.baseVertex);
+				}
+			} else if (mode == GL_LINE_LOOP) {
+				// LineLoop(LineLoop変換済みのデータは常にバッファ先頭から格納)
+				uint32_t line_loop_count = getConvertedIndexCount(drawParams, &ibo_dynamic_update_info);
+				if ((count > 1) && (line_loop_count > 0)) {
+					drawIndexedPrimitives(command_encoder, MTLPrimitiveTypeLineStrip, line_loop_count, index_type, index_buffer, index_buffer_base_offset, 1, vbo_dynamic_update_info.baseVertex);
 				}
 			} else {
 				// TriangleFan以外
 				MTLPrimitiveType mtl_type = convert_primitive_type(mode);
 				uint32_t index_buffer_offset = (uint32_t)((intptr_t)indices); // GL仕様からのキャスト
-				if (is_ubyte) {
+				if (ibo_dynamic_update_info.clientIndices != nullptr) {
+					// クライアントメモリのインデックスは動的バッファの先頭から格納済み
+					index_buffer_offset = 0;
+				} else if (is_ubyte) {
 					// uint8インデックスの場合、uint16に変換しているためオフセットを調整
 					index_buffer_offset *= 2;
 				}
-				[command_encoder drawIndexedPrimitives:mtl_type indexCount:count indexType:index_type indexBuffer:index_buffer indexBufferOffset:(index_buffer_base_offset + index_buffer_offset)];
+				drawIndexedPrimitives(command_encoder, mtl_type, count, index_type, index_buffer, (index_buffer_base_offset + index_buffer_offset), 1, vbo_dynamic_update_info.baseVertex);
 			}
 		} else {
 			AXGL_ASSERT(0);
@@ -836,17 +1364,13 @@ bool ContextMetal::drawArraysInstanced(GLenum mode, GLint first, GLsizei count,
 	const DrawParameters* drawParams, const ClearParameters* clearParams)
 {
 	AXGL_ASSERT((drawParams != nullptr) && (clearParams != nullptr));
-	// TriangleFanの場合は変換処理が必要
-	BackendBuffer::ConversionMode vbo_conversion = BackendBuffer::ConversionModeNone;
-	if (mode == GL_TRIANGLE_FAN) {
-		vbo_conversion = BackendBuffer::ConversionModeTriFanVertices;
-	}
 	// 各バッファの更新をチェック
 	VboUpdateInfo vbo_update_info;
 	UboUpdateInfo ubo_update_info;
 	VboDynamicUpdateInfo vbo_dynamic_update_info;
 	UboDynamicUpdateInfo ubo_dynamic_update_info;
-	bool vbo_update = checkVBOUpdate(&vbo_update_info, &vbo_dynamic_update_info, drawParams, vbo_conversion, first, count);
+	GLuint end_vertex = (count > 0) ? static_cast<GLuint>(first + count - 1) : static_cast<GLuint>(first);
+	bool vbo_update = checkVBOUpdate(&vbo_update_info, &vbo_dynamic_update_info, drawParams, first, end_vertex, instancecount, true);
 	bool ubo_update = checkUBOUpdate(&ubo_update_info, &ubo_dynamic_update_info, drawParams);
 	// 描画コマンドバッファを用意
 	setupDrawCommandBuffer();
@@ -870,6 +1394,8 @@ bool ContextMetal::drawArraysInstanced(GLenum mode, GLint first, GLsizei count,
 	}
 	// 動的バッファ用のMTLBufferを更新
 	updateDynamicBuffers(&vbo_dynamic_update_info, &ubo_dynamic_update_info, nullptr);
+	// 描画で参照するバッファに、記録中のサブミッションのシリアルを設定
+	markBuffersInUse(drawParams);
 	// MTLRenderPipelineStateを用意
 	bool same_as_last_ps = false;
 	id<MTLRenderPipelineState> pipeline_state = setupRenderPipelineState(drawParams, vbo_update_info.alignedStride, &same_as_last_ps);
@@ -954,16 +1480,18 @@ bool ContextMetal::drawArraysInstanced(GLenum mode, GLint first, GLsizei count,
 			setDepthBias(command_encoder, &drawParams->polygonOffsetParams);
 		}
 		// drawPrimitivesの呼び出し
+		// NOTE: クライアントメモリの頂点配列を動的バッファの割り当て位置から格納した場合は、先頭の頂点をずらす
+		GLint vertex_start = first - static_cast<GLint>(vbo_dynamic_update_info.baseVertex);
 		if (mode == GL_TRIANGLE_FAN) {
-			if (count > 2) {
-				// TriangleFan(TriangleFan変換済みのデータは常にバッファ先頭から格納)
-				uint32_t tri_fan_count = (count - 2) * 3;
-				[command_encoder drawPrimitives:MTLPrimitiveTypeTriangle vertexStart:0 vertexCount:tri_fan_count instanceCount:instancecount];
-			}
+			// TriangleFan(インデックスを使用して元の頂点バッファから描画)
+			drawTriFanArrays(command_encoder, vertex_start, count, instancecount);
+		} else if (mode == GL_LINE_LOOP) {
+			// LineLoop(インデックスでループを閉じて描画)
+			drawLineLoopArrays(command_encoder, vertex_start, count, instancecount);
 		} else {
 			// TriangleFan以外
 			MTLPrimitiveType primitive_type = convert_primitive_type(mode);
-			[command_encoder drawPrimitives:primitive_type vertexStart:first vertexCount:count instanceCount:instancecount];
+			[command_encoder drawPrimitives:primitive_type vertexStart:vertex_start vertexCount:count instanceCount:instancecount];
 		}
 		// 描画パラメータを設定済み
 		m_setDrawParameterToEncoder = true;
@@ -982,6 +1510,10 @@ bool ContextMetal::drawElementsInstanced(GLenum mode, GLsizei count, GLsizei typ
 	intptr_t ibo_offset = (intptr_t)indices;
 	intptr_t ibo_size = get_indices_size(count, type);
 	BackendBuffer::ConversionMode ibo_conversion = getIboConversionMode(mode, type);
+	// インデックスから使用する頂点の範囲を取得
+	GLuint start_vertex = 0;
+	GLuint end_vertex = UINT32_MAX;
+	getVertexRangeFromIndices(drawParams, count, type, indices, &start_vertex, &end_vertex);
 	// 各バッファの更新をチェック
 	bool is_ubyte = (type == GL_UNSIGNED_BYTE);
 	VboUpdateInfo vbo_update_info;
@@ -990,9 +1522,9 @@ bool ContextMetal::drawElementsInstanced(GLenum mode, GLsizei count, GLsizei typ
 	VboDynamicUpdateInfo vbo_dynamic_update_info;
 	UboDynamicUpdateInfo ubo_dynamic_update_info;
 	IboDynamicUpdateInfo ibo_dynamic_update_info;
-	bool vbo_update = checkVBOUpdate(&vbo_update_info, &vbo_dynamic_update_info, drawParams, BackendBuffer::ConversionModeNone, 0, 0);
+	bool vbo_update = checkVBOUpdate(&vbo_update_info, &vbo_dynamic_update_info, drawParams, start_vertex, end_vertex, instancecount, m_supportsBaseVertex);
 	bool ubo_update = checkUBOUpdate(&ubo_update_info, &ubo_dynamic_update_info, drawParams);
-	bool ibo_update = checkIBOUpdate(&ibo_update_info, &ibo_dynamic_update_info, drawParams, ibo_conversion, ibo_offset, ibo_size, is_ubyte);
+	bool ibo_update = checkIBOUpdate(&ibo_update_info, &ibo_dynamic_update_info, drawParams, ibo_conversion, ibo_offset, ibo_size, type);
 	// 描画コマンドバッファを用意
 	setupDrawCommandBuffer();
 	AXGL_ASSERT(m_drawCommandBuffer != nil);
@@ -1019,6 +1551,8 @@ bool ContextMetal::drawElementsInstanced(GLenum mode, GLsizei count, GLsizei typ
 	}
 	// 動的バッファ用のMTLBufferを更新
 	updateDynamicBuffers(&vbo_dynamic_update_info, &ubo_dynamic_update_info, &ibo_dynamic_update_info);
+	// 描画で参照するバッファに、記録中のサブミッションのシリアルを設定
+	markBuffersInUse(drawParams);
 	// MTLRenderPipelineStateを用意
 	bool same_as_last_ps = false;
 	id<MTLRenderPipelineState> pipeline_state = setupRenderPipelineState(drawParams, vbo_update_info.alignedStride, &same_as_last_ps);
@@ -1125,19 +1659,29 @@ bool ContextMetal::drawElementsInstanced(GLenum mode, GLsizei count, GLsizei typ
 		if (index_buffer != nil) {
 			MTLIndexType index_type = convert_index_type(type);
 			if (mode == GL_TRIANGLE_FAN) {
-				if (count > 2) {
-					// TriangleFan(TriangleFan変換済みのデータは常にバッファ先頭から格納)
-					uint32_t tri_fan_count = (count - 2) * 3;
-					[command_encoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle indexCount:tri_fan_count indexType:index_type indexBuffer:index_buffer indexBufferOffset:index_buffer_base_offset instanceCount:instancecount];
+				// TriangleFan(TriangleFan変換済みのデータは常にバッファ先頭から格納)
+				// NOTE: プリミティブリスタートが有効な場合は変換後のインデックス数が変わるため、変換結果の数を使用する
+				uint32_t tri_fan_count = getConvertedIndexCount(drawParams, &ibo_dynamic_update_info);
+				if ((count > 2) && (tri_fan_count > 0)) {
+					drawIndexedPrimitives(command_encoder, MTLPrimitiveTypeTriangle, tri_fan_count, index_type, index_buffer, index_buffer_base_offset, instancecount, vbo_dynamic_update_info.baseVertex);
+				}
+			} else if (mode == GL_LINE_LOOP) {
+				// LineLoop(LineLoop変換済みのデータは常にバッファ先頭から格納)
+				uint32_t line_loop_count = getConvertedIndexCount(drawParams, &ibo_dynamic_update_info);
+				if ((count > 1) && (line_loop_count > 0)) {
+					drawIndexedPrimitives(command_encoder, MTLPrimitiveTypeLineStrip, line_loop_count, index_type, index_buffer, index_buffer_base_offset, instancecount, vbo_dynamic_update_info.baseVertex);
 				}
 			} else {
 				MTLPrimitiveType mtl_type = convert_primitive_type(mode);
 				uint32_t index_buffer_offset = (uint32_t)((intptr_t)indices); // GL仕様からのキャスト
-				if (is_ubyte) {
+				if (ibo_dynamic_update_info.clientIndices != nullptr) {
+					// クライアントメモリのインデックスは動的バッファの先頭から格納済み
+					index_buffer_offset = 0;
+				} else if (is_ubyte) {
 					// uint8インデックスの場合、uint16に変換しているためオフセットを調整
 					index_buffer_offset *= 2;
 				}
-				[command_encoder drawIndexedPrimitives:mtl_type indexCount:count indexType:index_type indexBuffer:index_buffer indexBufferOffset:(index_buffer_base_offset + index_buffer_offset) instanceCount:instancecount];
+				drawIndexedPrimitives(command_encoder, mtl_type, count, index_type, index_buffer, (index_buffer_base_offset + index_buffer_offset), instancecount, vbo_dynamic_update_info.baseVertex);
 			}
 		} else {
 			AXGL_ASSERT(0);
@@ -1173,118 +1717,110 @@ bool ContextMetal::finish()
 }
 
 // カラーバッファのピクセルを読み出す(glReadPixels相当)
-// NOTE: テストやデバッグ用の実装であり、通常のアプリケーションでglReadPixelsを使用すべきでない
+// NOTE: クライアントメモリへの読み出しはテストやデバッグ用の実装であり、通常のアプリケーションではピクセルパックバッファを使用すべき
 bool ContextMetal::readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type,
-	BackendFramebuffer* readFramebuffer, GLenum readBuffer, void* pixels)
+	BackendFramebuffer* readFramebuffer, GLenum readBuffer, void* pixels, const PackParameters* pack)
 {
+	AXGL_ASSERT(pack != nullptr);
+	if (pack->buffer != nullptr) {
+		// ピクセルパックバッファへの読み出しは、完了を待たずにGPUでのコピーとして記録する
+		return readPixelsToBuffer(x, y, width, height, format, type, readFramebuffer, readBuffer,
+			static_cast<size_t>(reinterpret_cast<uintptr_t>(pixels)), pack);
+	}
 	AXGL_ASSERT(pixels != nullptr);
-	// 描画コマンドバッファが存在する場合は commit して完了を待つ
-	commitDrawCommandBuffer(WaitModeCompleted);
-	// ソーステクスチャを取得
-	FramebufferMetal* framebuffer_metal = static_cast<FramebufferMetal*>(readFramebuffer);
-	id<MTLTexture> src_texture = nil;
-	uint32_t src_level = 0;
-	if (readBuffer == GL_BACK) {
-		// NOTE: デフォルトフレームバッファのリードをiOS GLESはサポートしない
-		src_texture = nil;
-	} else if((readBuffer >= GL_COLOR_ATTACHMENT0) && (readBuffer < (GL_COLOR_ATTACHMENT0 + AXGL_MAX_COLOR_ATTACHMENTS))) {
-		if (readFramebuffer != nullptr) {
-			int attach_index = readBuffer - GL_COLOR_ATTACHMENT0;
-			src_texture = framebuffer_metal->getColorTexture(attach_index);
-			src_level = framebuffer_metal->getColorTextureLevel(attach_index);
-		}
+	if ((width <= 0) || (height <= 0)) {
+		return true;
 	}
-	if (src_texture == nil) {
+	// ソーステクスチャを取得
+	ReadSource source;
+	get_read_source(readFramebuffer, readBuffer, format, &source);
+	if (source.texture == nil) {
 		return true; // リードするターゲットが存在しない
 	}
-	if (src_texture.framebufferOnly == YES) {
-		AXGL_DBGOUT("readPixels> framebufferOnly:YES, MTLTexture can not be blit source\n");
-		return false;
-	}
-	if ((src_texture.pixelFormat != MTLPixelFormatRGBA8Unorm) && (src_texture.pixelFormat != MTLPixelFormatBGRA8Unorm)) {
-		AXGL_DBGOUT("readPixels> unsupported MTLPixelFormat\n");
+	if (!is_readable_source(source)) {
 		return false;
 	}
-	if ((format != GL_RGBA) || (type != GL_UNSIGNED_BYTE)) {
+	const ReadbackFormat* readback_format = source.readbackFormat;
+	bool native = is_readback_native(readback_format, format, type);
+	if (!native && !is_readback_convertible(readback_format, format, type)) {
 		AXGL_DBGOUT("readPixels> unsuppoted format:0x%04X type:0x%04X\n", format, type);
 		return false;
 	}
-	// Blit転送先のテクスチャを作成
-	id<MTLTexture> dst_texture = nil;
-	MTLPixelFormat texture_format = src_texture.pixelFormat;
-	{
-		// NOTE: 2D, Level0 only
-		MTLTextureDescriptor* desc = [[MTLTextureDescriptor alloc] init];
-		AXGL_ASSERT(desc != nil);
-		[desc setTextureType:MTLTextureType2D];
-		[desc setPixelFormat:texture_format];
-		[desc setWidth:width];
-		[desc setHeight:height];
-		[desc setUsage:MTLTextureUsageRenderTarget];
-		[desc setStorageMode:MTLStorageModeShared];
-		[desc setSampleCount:1];
-		[desc setMipmapLevelCount:1];
-		dst_texture = [m_mtlDevice newTextureWithDescriptor:desc];
-		AXGL_ASSERT(dst_texture != nil);
-		desc = nil;
+	// 読み出す範囲をクリップ
+	int32_t x0, y0, x1, y1, src_height;
+	if (!clip_read_region(source, x, y, width, height, &x0, &y0, &x1, &y1, &src_height)) {
+		return true;
 	}
-	// Blitコマンドを作成
-	id<MTLCommandBuffer> command_buffer = [m_commandQueue commandBuffer];
-	AXGL_ASSERT(command_buffer != nil);
-	id<MTLBlitCommandEncoder> blit_encoder = [command_buffer blitCommandEncoder];
+	NSUInteger copy_width = (NSUInteger)(x1 - x0);
+	NSUInteger copy_height = (NSUInteger)(y1 - y0);
+	// パックパラメータから書き込み先のレイアウトを取得
+	size_t dst_bytes_per_pixel = get_readback_dst_bytes_per_pixel(readback_format, native);
+	size_t dst_bytes_per_row = 0;
+	size_t dst_skip_bytes = 0;
+	get_pack_layout(width, dst_bytes_per_pixel, pack, &dst_bytes_per_row, &dst_skip_bytes);
+	uint8_t* dst = static_cast<uint8_t*>(pixels) + dst_skip_bytes
+		+ (static_cast<size_t>(y0 - y) * dst_bytes_per_row) + (static_cast<size_t>(x0 - x) * dst_bytes_per_pixel);
+	// ステージングバッファを用意
+	// NOTE: 同じサイズの読み出しを繰り返す場合が多いため、再利用リストから取得する
+	size_t src_bytes_per_pixel = get_readback_src_bytes_per_pixel(readback_format);
+	size_t staging_bytes_per_row = copy_width * src_bytes_per_pixel;
+	size_t staging_size = staging_bytes_per_row * copy_height;
+	id<MTLBuffer> staging_buffer = acquireRecycledBuffer(staging_size);
+	if (staging_buffer == nil) {
+		staging_buffer = [m_mtlDevice newBufferWithLength:staging_size options:MTLResourceStorageModeShared];
+		if (staging_buffer == nil) {
+			AXGL_DBGOUT("readPixels> newBufferWithLength failed\n");
+			return false;
+		}
+	}
+	// 描画コマンドバッファにBlitを記録
+	setupDrawCommandBuffer();
+	AXGL_ASSERT(m_drawCommandBuffer != nil);
+	setupBlitCommandEncoder();
 	{
-		uint32_t src_img_height = calc_mipmap_size((uint32_t)[src_texture height], src_level);
 		MTLSize src_size = {
-			(NSUInteger)width, (NSUInteger)height, 1 // width,height,depth
+			copy_width, copy_height, 1 // width,height,depth
 		};
 		MTLOrigin src_origin = {
-			(NSUInteger)x, (NSUInteger)(src_img_height - y - height), 0, // x,y,z
+			(NSUInteger)x0, (NSUInteger)(source.flipY ? (src_height - y1) : y0), 0 // x,y,z
 		};
-		MTLOrigin dst_origin = {
-			0,0,0 // x,y,z
-		};
-		[blit_encoder copyFromTexture:src_texture sourceSlice:0 sourceLevel:src_level sourceOrigin:src_origin sourceSize:src_size  toTexture:dst_texture destinationSlice:0 destinationLevel:0 destinationOrigin:dst_origin];
+		MTLBlitOption options = (source.texture.pixelFormat == MTLPixelFormatDepth32Float_Stencil8) ? MTLBlitOptionDepthFromDepthStencil : MTLBlitOptionNone;
+		[m_blitCommandEncoder copyFromTexture:source.texture sourceSlice:source.slice sourceLevel:source.level sourceOrigin:src_origin sourceSize:src_size
+			toBuffer:staging_buffer destinationOffset:0 destinationBytesPerRow:staging_bytes_per_row destinationBytesPerImage:staging_size options:options];
 	}
-	[blit_encoder endEncoding];
 	// コマンドを実行して完了待ち
-	[command_buffer commit];
-	[command_buffer waitUntilCompleted];
-	// Blit転送先からデータを取得
-	MTLRegion dst_region = {
-		{0,0,0}, // origin
-		{(NSUInteger)width,(NSUInteger)height,1} // size
-	};
-	NSUInteger bpp = get_bytes_per_pixel(format, type);
-	NSUInteger stride = width * bpp;
-	[dst_texture getBytes:pixels bytesPerRow:stride fromRegion:dst_region mipmapLevel:0];
-	// Blit転送先をリリース
-	dst_texture = nil;
-	// デバイススクリーン座標がGLとMetalで上下反対のため並べ替える
-	if (height > 1) {
-		void* work_buf = AXGL_ALLOC(stride);
-		if (work_buf != nullptr) {
-			uint8_t* pixels_buf = static_cast<uint8_t*>(pixels);
-			for (int i = 0; i < (height / 2); i++) {
-				uint8_t* p0 = pixels_buf + (i * stride);
-				uint8_t* p1 = pixels_buf + ((height - 1 - i) * stride);
-				memcpy(work_buf, p0, stride);
-				memcpy(p0, p1, stride);
-				memcpy(p1, work_buf, stride);
-			}
-			AXGL_FREE(work_buf);
-		} else {
-			AXGL_DBGOUT("BackendContextMetal::readPixels> work memory allocation failed\n");
+	// NOTE: 先行する描画とBlitを1つのコマンドバッファで実行し、待つのは1回のみ
+	uint64_t serial = m_submissionSerial.getPendingSerial();
+	commitDrawCommandBuffer(WaitModeCompleted);
+	const uint8_t* src = static_cast<const uint8_t*>([staging_buffer contents]);
+	if (native) {
+		// 上下反転とBGRAの並べ替えは、書き込み先へのコピーと同時に行う
+		copyImageRows(dst, dst_bytes_per_row, src, staging_bytes_per_row, copy_width * dst_bytes_per_pixel, copy_height,
+			source.flipY, readback_format->bgra);
+	} else {
+		for (NSUInteger row = 0; row < copy_height; row++) {
+			// デバイススクリーン座標がGLとMetalで上下反対のため並べ替える
+			NSUInteger src_row = source.flipY ? (copy_height - 1 - row) : row;
+			convert_readback_row(dst + (row * dst_bytes_per_row), src + (src_row * staging_bytes_per_row), copy_width, readback_format);
 		}
 	}
-	// BGRAはRGBAに並び替える
-	if (texture_format == MTLPixelFormatBGRA8Unorm) {
-		for (int i = 0; i < (width * height); i++) {
-			uint8_t* p = static_cast<uint8_t*>(pixels) + (i * 4);
-			uint8_t tmp = p[0];
-			p[0] = p[2];
-			p[2] = tmp;
-		}
+	recycleBuffer(staging_buffer, serial);
+	staging_buffer = nil;
+	return true;
+}
+
+// リードバッファの内容をそのまま読み出せるformat,typeを取得する
+// NOTE: 取得できない場合はfalse(プラットフォームの既定値を使用する)
+bool ContextMetal::getImplementationColorReadFormat(BackendFramebuffer* readFramebuffer, GLenum readBuffer, GLenum* format, GLenum* type)
+{
+	AXGL_ASSERT((format != nullptr) && (type != nullptr));
+	ReadSource source;
+	get_read_source(readFramebuffer, readBuffer, GL_RGBA, &source);
+	if ((source.texture == nil) || (source.readbackFormat == nullptr)) {
+		return false;
 	}
+	*format = source.readbackFormat->format;
+	*type = source.readbackFormat->type;
 	return true;
 }
 
@@ -1299,6 +1835,33 @@ void ContextMetal::invalidateCache(GLbitfield flags)
 		m_depthStencilStateUsedOrder.clear();
 		m_depthStencilStateCache.clear();
 	}
+	if ((flags & GL_CACHE_TEXTURE_POOL_BIT_AXGL) != 0) {
+		releasePooledTextures();
+	}
+	return;
+}
+
+// テクスチャ、レンダーバッファのストレージのプールの統計を取得
+void ContextMetal::getTexturePoolStats(TexturePoolStats* stats) const
+{
+	AXGL_ASSERT(stats != nullptr);
+	*stats = m_texturePoolStats;
+	return;
+}
+
+// レンダーパスの統計を取得
+void ContextMetal::getRenderPassStats(RenderPassStats* stats) const
+{
+	AXGL_ASSERT(stats != nullptr);
+	*stats = m_renderPassStats;
+	return;
+}
+
+// バッファ更新の統計を取得
+void ContextMetal::getBufferUploadStats(BufferUploadStats* stats) const
+{
+	AXGL_ASSERT(stats != nullptr);
+	*stats = m_bufferUploadStats;
 	return;
 }
 
@@ -1400,20 +1963,483 @@ SpirvMsl* ContextMetal::getBackendSpirvMsl()
 	return &m_spirvMsl;
 }
 
+// サブミッションのシリアルを取得
+const SubmissionSerial& ContextMetal::getSubmissionSerial() const
+{
+	return m_submissionSerial;
+}
+
+ShadowBufferBudget& ContextMetal::getShadowBufferBudget()
+{
+	return m_shadowBufferBudget;
+}
+
+// 孤立化したMTLBufferから、GPUの使用が完了した同じサイズのものを取得
+id<MTLBuffer> ContextMetal::acquireRecycledBuffer(size_t size)
+{
+	auto it = m_recycledBuffers.find(size);
+	if (it == m_recycledBuffers.end()) {
+		return nil;
+	}
+	AXGLVector<RecycledBuffer>& list = it->second;
+	for (auto entry = list.begin(); entry != list.end(); ++entry) {
+		if (m_submissionSerial.isCompleted(entry->serial)) {
+			id<MTLBuffer> buffer = entry->buffer;
+			list.erase(entry);
+			m_recycledBufferTotalSize -= size;
+			MemoryAccounting::getInstance().update(MemoryCategoryPool, size, 0);
+			return buffer;
+		}
+	}
+	return nil;
+}
+
+// 孤立化、もしくはリネームしたMTLBufferを再利用リストに追加
+void ContextMetal::recycleBuffer(id<MTLBuffer> buffer, uint64_t lastUsedSerial)
+{
+	if ((buffer == nil) || (buffer.storageMode != MTLStorageModeShared)) {
+		return;
+	}
+	size_t size = [buffer length];
+	AXGLVector<RecycledBuffer>& list = m_recycledBuffers[size];
+	if ((list.size() >= c_recycled_buffer_per_size_max) || ((m_recycledBufferTotalSize + size) > c_recycled_buffer_total_max)) {
+		// 上限を超える場合は再利用せず、ARCによって破棄させる
+		return;
+	}
+	// NOTE: 最後に使用したサブミッションが完了すれば再利用できる
+	RecycledBuffer entry = {buffer, lastUsedSerial};
+	list.push_back(entry);
+	m_recycledBufferTotalSize += size;
+	MemoryAccounting::getInstance().update(MemoryCategoryPool, 0, size);
+	return;
+}
+
+// バッファ更新の転送元として、動的バッファから領域を確保する
+id<MTLBuffer> ContextMetal::allocateStagingBuffer(size_t size, size_t* offset)
+{
+	AXGL_ASSERT(offset != nullptr);
+	*offset = allocateDynamicBufferRange(0, size);
+	return m_dynamicBuffer;
+}
+
+// バッファ更新の統計を加算
+void ContextMetal::addBufferUploadStats(uint32_t updateCount, uint32_t copyCount, size_t bytes, bool staged)
+{
+	m_bufferUploadStats.updateCount += updateCount;
+	m_bufferUploadStats.copyCount += copyCount;
+	m_bufferUploadStats.uploadBytes += bytes;
+	if (staged) {
+		m_bufferUploadStats.coalescedCount += (updateCount > copyCount) ? (updateCount - copyCount) : 0;
+		m_bufferUploadStats.coalescedBytes += bytes;
+	}
+	return;
+}
+
+// MTLTextureを作成する(プールにGPUの使用が完了した同じキーのものがあれば再利用)
+id<MTLTexture> ContextMetal::newPooledTexture(MTLTextureDescriptor* desc)
+{
+	AXGL_ASSERT(desc != nil);
+	auto it = m_texturePool.find(getTexturePoolKey(desc));
+	if (it != m_texturePool.end()) {
+		AXGLVector<PooledTexture>& list = it->second;
+		for (auto entry = list.begin(); entry != list.end(); ++entry) {
+			if (m_submissionSerial.isCompleted(entry->serial)) {
+				id<MTLTexture> texture = entry->texture;
+				m_texturePoolStats.pooledCount--;
+				m_texturePoolStats.pooledBytes -= entry->size;
+				m_texturePoolStats.hitCount++;
+				MemoryAccounting::getInstance().update(MemoryCategoryPool, entry->size, 0);
+				list.erase(entry);
+				return texture;
+			}
+		}
+	}
+	m_texturePoolStats.missCount++;
+	return [m_mtlDevice newTextureWithDescriptor:desc];
+}
+
+// 削除されたテクスチャ、レンダーバッファのMTLTextureをプールに追加
+// NOTE: 内容は保持されないため、再利用した側で未定義の内容として扱う
+void ContextMetal::recycleTexture(id<MTLTexture> texture, uint64_t lastUsedSerial)
+{
+	if ((texture == nil) || texture.framebufferOnly) {
+		return;
+	}
+	size_t size = [texture allocatedSize];
+	AXGLVector<PooledTexture>& list = m_texturePool[getTexturePoolKey(texture)];
+	if ((list.size() >= c_texture_pool_per_key_max) || ((m_texturePoolStats.pooledBytes + size) > c_texture_pool_total_max)) {
+		// 上限を超える場合は再利用せず、ARCによって破棄させる
+		return;
+	}
+	// NOTE: 最後に使用したサブミッションが完了すれば再利用できる
+	PooledTexture entry = {texture, size, lastUsedSerial};
+	list.push_back(entry);
+	m_texturePoolStats.pooledCount++;
+	m_texturePoolStats.pooledBytes += size;
+	MemoryAccounting::getInstance().update(MemoryCategoryPool, 0, size);
+	return;
+}
+
+// バッファ間のコピーを描画コマンドバッファに記録する(転送元と転送先で同じオフセット)
+// NOTE: 以降に記録する描画、転送はコピー後の内容を参照する
+void ContextMetal::copyBufferInStream(id<MTLBuffer> srcBuffer, id<MTLBuffer> dstBuffer, size_t offset, size_t size)
+{
+	AXGL_ASSERT((srcBuffer != nil) && (dstBuffer != nil) && ((offset & 3) == 0) && ((size & 3) == 0));
+	// 描画コマンドバッファを用意
+	setupDrawCommandBuffer();
+	AXGL_ASSERT(m_drawCommandBuffer != nil);
+	// Blit command encoder を作成、Render command encoder が使用されている場合は終了される
+	setupBlitCommandEncoder();
+	[m_blitCommandEncoder copyFromBuffer:srcBuffer sourceOffset:offset toBuffer:dstBuffer destinationOffset:offset size:size];
+	return;
+}
+
+// バッファからテクスチャへの転送を描画コマンドバッファに記録する
+// NOTE: 記録した位置で転送されるため、CPUはピクセルデータに触れない
+bool ContextMetal::copyBufferToTexture(BufferMetal* buffer, size_t offset, size_t bytesPerRow, size_t bytesPerImage,
+	id<MTLTexture> texture, NSUInteger slice, NSUInteger level, const MTLRegion& region)
+{
+	AXGL_ASSERT((buffer != nullptr) && (texture != nil));
+	// GPUによる書き込みが保留中の場合は、転送元として参照する前に反映する
+	buffer->resolveGpuWrite(this, false);
+	if (!buffer->canUseAsCopySource()) {
+		return false;
+	}
+	// 描画コマンドバッファを用意
+	setupDrawCommandBuffer();
+	AXGL_ASSERT(m_drawCommandBuffer != nil);
+	// 転送元のバッファの書き換えをMTLBufferに反映
+	if (buffer->needUpdateWithoutConversion()) {
+		setupBlitCommandEncoder();
+		bool result = buffer->setupBufferInDraw(this);
+		// NOTE: バッファ更新のBlitの後に転送するため、エンコーダを分ける
+		endBlitCommandEncoder();
+		if (!result) {
+			return false;
+		}
+	}
+	id<MTLBuffer> src_buffer = buffer->getMtlBuffer();
+	if (src_buffer == nil) {
+		return false;
+	}
+	// Blit command encoder を作成、Render command encoder が使用されている場合は終了される
+	// NOTE: エンコーダは次の描画まで終了せず、連続する転送を1つのエンコーダにまとめる
+	setupBlitCommandEncoder();
+	[m_blitCommandEncoder copyFromBuffer:src_buffer sourceOffset:offset sourceBytesPerRow:bytesPerRow sourceBytesPerImage:bytesPerImage
+		sourceSize:region.size toTexture:texture destinationSlice:slice destinationLevel:level destinationOrigin:region.origin];
+	// 記録中のサブミッションで転送元として使用する
+	buffer->setLastUsedSerial(&m_submissionSerial, m_submissionSerial.getPendingSerial());
+	return true;
+}
+
+// リードフレームバッファのカラーバッファをテクスチャにコピーする(glCopyTexImage2D,glCopyTexSubImage2D相当)
+// NOTE: 描画コマンドバッファに記録し、前後の描画と順序を保つ(CPUでの読み出しは行わない)
+bool ContextMetal::copyFramebufferToTexture(BackendFramebuffer* readFramebuffer, GLenum readBuffer, GLint x, GLint y, GLsizei width, GLsizei height,
+	id<MTLTexture> texture, NSUInteger slice, NSUInteger level, GLint xoffset, GLint yoffset)
+{
+	AXGL_ASSERT(texture != nil);
+	// ソーステクスチャを取得
+	FramebufferMetal* framebuffer_metal = static_cast<FramebufferMetal*>(readFramebuffer);
+	id<MTLTexture> src_texture = nil;
+	uint32_t src_level = 0;
+	uint32_t src_slice = 0;
+	if ((readFramebuffer != nullptr) && (readBuffer >= GL_COLOR_ATTACHMENT0) && (readBuffer < (GL_COLOR_ATTACHMENT0 + AXGL_MAX_COLOR_ATTACHMENTS))) {
+		int attach_index = readBuffer - GL_COLOR_ATTACHMENT0;
+		// ストレージが再指定されたアタッチメントのMTLTextureを設定し直す
+		framebuffer_metal->updateAttachmentTextures();
+		src_texture = framebuffer_metal->getColorTexture(attach_index);
+		src_level = framebuffer_metal->getColorTextureLevel(attach_index);
+		src_slice = framebuffer_metal->getColorTextureSlice(attach_index);
+	}
+	if (src_texture == nil) {
+		AXGL_DBGOUT("copyFramebufferToTexture> read buffer is not attached\n");
+		return false;
+	}
+	if (src_texture.framebufferOnly == YES) {
+		AXGL_DBGOUT("copyFramebufferToTexture> framebufferOnly:YES, MTLTexture can not be blit source\n");
+		return false;
+	}
+	if ([src_texture sampleCount] > 1) {
+		AXGL_DBGOUT("copyFramebufferToTexture> multisample read buffer is not supported\n");
+		return false;
+	}
+	// コピー元の範囲をカラーバッファの範囲にクリップ
+	// NOTE: 範囲外のピクセルは未定義のため、コピー先の対応するピクセルは書き換えない
+	int32_t src_width = (int32_t)calc_mipmap_size((uint32_t)[src_texture width], src_level);
+	int32_t src_height = (int32_t)calc_mipmap_size((uint32_t)[src_texture height], src_level);
+	int32_t x0 = std::max(x, 0);
+	int32_t y0 = std::max(y, 0);
+	int32_t x1 = std::min(x + width, src_width);
+	int32_t y1 = std::min(y + height, src_height);
+	if ((x0 >= x1) || (y0 >= y1)) {
+		return true;
+	}
+	NSUInteger dst_x = (NSUInteger)(xoffset + (x0 - x));
+	NSUInteger dst_y = (NSUInteger)(yoffset + (y0 - y));
+	NSUInteger copy_width = (NSUInteger)(x1 - x0);
+	NSUInteger copy_height = (NSUInteger)(y1 - y0);
+	// CAMetalLayerのレンダーバッファを含むフレームバッファは、GLと上下反対で描画されている
+	bool flip_y = !framebuffer_metal->onlyOffscreenBufferAttached();
+	MTLOrigin src_origin = {
+		(NSUInteger)x0, (NSUInteger)(flip_y ? (src_height - y1) : y0), 0 // x,y,z
+	};
+	MTLSize copy_size = {
+		copy_width, copy_height, 1 // width,height,depth
+	};
+	// 描画コマンドバッファを用意
+	setupDrawCommandBuffer();
+	AXGL_ASSERT(m_drawCommandBuffer != nil);
+	// 記録中のサブミッションでコピー元として使用する
+	framebuffer_metal->markAttachmentsInUse(&m_submissionSerial, m_submissionSerial.getPendingSerial());
+	if ((src_texture.pixelFormat == texture.pixelFormat) && !flip_y) {
+		// フォーマットが同じで上下反転が不要な場合はBlitでコピー
+		// NOTE: エンコーダは次の描画まで終了せず、連続する転送を1つのエンコーダにまとめる
+		setupBlitCommandEncoder();
+		MTLOrigin dst_origin = {
+			dst_x, dst_y, 0 // x,y,z
+		};
+		[m_blitCommandEncoder copyFromTexture:src_texture sourceSlice:src_slice sourceLevel:src_level sourceOrigin:src_origin sourceSize:copy_size
+			toTexture:texture destinationSlice:slice destinationLevel:level destinationOrigin:dst_origin];
+		return true;
+	}
+	// フォーマットの変換、または上下反転が必要な場合は描画でコピー
+	// NOTE: 整数フォーマットはシェーダの出力の型が異なるため変換しない
+	if (is_integer_pixel_format(src_texture.pixelFormat) || is_integer_pixel_format(texture.pixelFormat)) {
+		AXGL_DBGOUT("copyFramebufferToTexture> unsupported conversion:%d to %d\n", (int)src_texture.pixelFormat, (int)texture.pixelFormat);
+		return false;
+	}
+	id<MTLRenderPipelineState> pipeline_state = setupCopyPipelineState(texture.pixelFormat);
+	if (pipeline_state == nil) {
+		return false;
+	}
+	// コピーする範囲を一時テクスチャにBlitでコピー
+	// NOTE: レンダーバッファはMTLTextureUsageShaderReadを持たないため、シェーダから直接読み出せない
+	id<MTLTexture> work_texture = nil;
+	{
+		MTLTextureDescriptor* desc = [[MTLTextureDescriptor alloc] init];
+		AXGL_ASSERT(desc != nil);
+		[desc setTextureType:MTLTextureType2D];
+		[desc setPixelFormat:src_texture.pixelFormat];
+		[desc setWidth:copy_width];
+		[desc setHeight:copy_height];
+		[desc setUsage:MTLTextureUsageShaderRead];
+		[desc setStorageMode:MTLStorageModePrivate];
+		[desc setSampleCount:1];
+		[desc setMipmapLevelCount:1];
+		work_texture = newPooledTexture(desc);
+		desc = nil;
+	}
+	if (work_texture == nil) {
+		return false;
+	}
+	setupBlitCommandEncoder();
+	MTLOrigin work_origin = {
+		0, 0, 0 // x,y,z
+	};
+	[m_blitCommandEncoder copyFromTexture:src_texture sourceSlice:src_slice sourceLevel:src_level sourceOrigin:src_origin sourceSize:copy_size
+		toTexture:work_texture destinationSlice:0 destinationLevel:0 destinationOrigin:work_origin];
+	// NOTE: 同じコマンドバッファでレンダーパスを開始するため、Blitのエンコーダを終了する
+	endBlitCommandEncoder();
+	// コピー先がMTLTextureUsageRenderTargetを持たない場合は、一時テクスチャに描画してからBlitでコピーする
+	id<MTLTexture> target_texture = texture;
+	NSUInteger target_level = level;
+	NSUInteger target_slice = slice;
+	NSUInteger target_x = dst_x;
+	NSUInteger target_y = dst_y;
+	id<MTLTexture> target_work_texture = nil;
+	if (([texture usage] & MTLTextureUsageRenderTarget) == 0) {
+		MTLTextureDescriptor* desc = [[MTLTextureDescriptor alloc] init];
+		AXGL_ASSERT(desc != nil);
+		[desc setTextureType:MTLTextureType2D];
+		[desc setPixelFormat:texture.pixelFormat];
+		[desc setWidth:copy_width];
+		[desc setHeight:copy_height];
+		[desc setUsage:MTLTextureUsageRenderTarget];
+		[desc setStorageMode:MTLStorageModePrivate];
+		[desc setSampleCount:1];
+		[desc setMipmapLevelCount:1];
+		target_work_texture = newPooledTexture(desc);
+		desc = nil;
+		if (target_work_texture == nil) {
+			recycleTexture(work_texture, m_submissionSerial.getPendingSerial());
+			work_texture = nil;
+			return false;
+		}
+		target_texture = target_work_texture;
+		target_level = 0;
+		target_slice = 0;
+		target_x = 0;
+		target_y = 0;
+	}
+	// コピー先のレベル、スライスをアタッチしたレンダーパスで描画
+	MTLRenderPassDescriptor* render_pass_desc = [MTLRenderPassDescriptor renderPassDescriptor];
+	render_pass_desc.colorAttachments[0].texture = target_texture;
+	render_pass_desc.colorAttachments[0].level = target_level;
+	render_pass_desc.colorAttachments[0].slice = target_slice;
+	render_pass_desc.colorAttachments[0].loadAction = MTLLoadActionLoad;
+	render_pass_desc.colorAttachments[0].storeAction = MTLStoreActionStore;
+	id<MTLRenderCommandEncoder> encoder = [m_drawCommandBuffer renderCommandEncoderWithDescriptor:render_pass_desc];
+	AXGL_ASSERT(encoder != nil);
+	MTLViewport viewport = {
+		(double)target_x, (double)target_y, (double)copy_width, (double)copy_height, 0.0, 1.0
+	};
+	[encoder setViewport:viewport];
+	[encoder setRenderPipelineState:pipeline_state];
+	[encoder setFragmentTexture:work_texture atIndex:0];
+	// dstOrigin.x, dstOrigin.y, flipY, height
+	int32_t copy_params[4] = {
+		(int32_t)target_x, (int32_t)target_y, flip_y ? 1 : 0, (int32_t)copy_height
+	};
+	[encoder setFragmentBytes:copy_params length:sizeof(copy_params) atIndex:0];
+	[encoder drawPrimitives:MTLPrimitiveTypeTriangle vertexStart:0 vertexCount:3];
+	[encoder endEncoding];
+	if (target_work_texture != nil) {
+		// 描画した一時テクスチャからコピー先のレベル、スライスにBlitでコピー
+		setupBlitCommandEncoder();
+		MTLOrigin dst_origin = {
+			dst_x, dst_y, 0 // x,y,z
+		};
+		[m_blitCommandEncoder copyFromTexture:target_work_texture sourceSlice:0 sourceLevel:0 sourceOrigin:work_origin sourceSize:copy_size
+			toTexture:texture destinationSlice:slice destinationLevel:level destinationOrigin:dst_origin];
+		recycleTexture(target_work_texture, m_submissionSerial.getPendingSerial());
+		target_work_texture = nil;
+	}
+	// 一時テクスチャは記録中のサブミッションの完了後に再利用する
+	recycleTexture(work_texture, m_submissionSerial.getPendingSerial());
+	work_texture = nil;
+	return true;
+}
+
 // private methods --------
+// リードフレームバッファのカラーバッファ、深度バッファを、ピクセルパックバッファにGPUでコピーする
+// NOTE: 描画コマンドバッファに記録して完了を待たない(バッファをCPUから参照する時に同期する)
+bool ContextMetal::readPixelsToBuffer(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type,
+	BackendFramebuffer* readFramebuffer, GLenum readBuffer, size_t offset, const PackParameters* pack)
+{
+	AXGL_ASSERT((pack != nullptr) && (pack->buffer != nullptr));
+	if ((width <= 0) || (height <= 0)) {
+		return true;
+	}
+	// ソーステクスチャを取得
+	ReadSource source;
+	get_read_source(readFramebuffer, readBuffer, format, &source);
+	if (source.texture == nil) {
+		return true; // リードするターゲットが存在しない
+	}
+	if (!is_readable_source(source)) {
+		return false;
+	}
+	// NOTE: GPUでの変換は8bit正規化整数のGL_RGBA/GL_UNSIGNED_BYTEのみ対応
+	const ReadbackFormat* readback_format = source.readbackFormat;
+	bool native = is_readback_native(readback_format, format, type);
+	bool direct_copy = native && !readback_format->bgra && !source.flipY;
+	bool work_copy = ((source.texture.pixelFormat == MTLPixelFormatRGBA8Unorm) || (source.texture.pixelFormat == MTLPixelFormatBGRA8Unorm))
+		&& (format == GL_RGBA) && (type == GL_UNSIGNED_BYTE);
+	if (!direct_copy && !work_copy) {
+		AXGL_DBGOUT("readPixelsToBuffer> unsuppoted format:0x%04X type:0x%04X\n", format, type);
+		return false;
+	}
+	// パックパラメータからバッファ内のレイアウトを取得
+	size_t bytes_per_pixel = get_readback_dst_bytes_per_pixel(readback_format, true);
+	size_t bytes_per_row = 0;
+	size_t skip_bytes = 0;
+	get_pack_layout(width, bytes_per_pixel, pack, &bytes_per_row, &skip_bytes);
+	size_t dst_offset = offset + skip_bytes;
+	size_t dst_end = dst_offset + (bytes_per_row * (height - 1)) + (bytes_per_pixel * width);
+	BufferMetal* pack_buffer = static_cast<BufferMetal*>(pack->buffer);
+	if (dst_end > pack_buffer->getStorageSize()) {
+		AXGL_DBGOUT("readPixelsToBuffer> out of buffer range\n");
+		return false;
+	}
+	// NOTE: Blitの転送先のオフセットはピクセルサイズの倍数である必要がある
+	if ((dst_offset % bytes_per_pixel) != 0) {
+		AXGL_DBGOUT("readPixelsToBuffer> unaligned offset:%zu\n", dst_offset);
+		return false;
+	}
+	// 読み出す範囲をクリップ
+	int32_t x0, y0, x1, y1, src_height;
+	if (!clip_read_region(source, x, y, width, height, &x0, &y0, &x1, &y1, &src_height)) {
+		return true;
+	}
+	NSUInteger copy_width = (NSUInteger)(x1 - x0);
+	NSUInteger copy_height = (NSUInteger)(y1 - y0);
+	size_t write_offset = dst_offset + (static_cast<size_t>(y0 - y) * bytes_per_row) + (static_cast<size_t>(x0 - x) * bytes_per_pixel);
+	size_t write_end = write_offset + (bytes_per_row * (copy_height - 1)) + (bytes_per_pixel * copy_width);
+	MTLSize copy_size = {
+		copy_width, copy_height, 1 // width,height,depth
+	};
+	// 描画コマンドバッファを用意
+	setupDrawCommandBuffer();
+	AXGL_ASSERT(m_drawCommandBuffer != nil);
+	// 記録中のサブミッションで読み出し元として使用する
+	static_cast<FramebufferMetal*>(readFramebuffer)->markAttachmentsInUse(&m_submissionSerial, m_submissionSerial.getPendingSerial());
+	if (direct_copy) {
+		// 並べ替えと上下反転が不要な場合は、読み出し元からバッファにBlitで直接コピー
+		id<MTLBuffer> dst_buffer = pack_buffer->beginGpuWrite(this, write_offset, write_end);
+		if (dst_buffer == nil) {
+			return false;
+		}
+		setupBlitCommandEncoder();
+		MTLOrigin src_origin = {
+			(NSUInteger)x0, (NSUInteger)y0, 0 // x,y,z
+		};
+		MTLBlitOption options = (source.texture.pixelFormat == MTLPixelFormatDepth32Float_Stencil8) ? MTLBlitOptionDepthFromDepthStencil : MTLBlitOptionNone;
+		[m_blitCommandEncoder copyFromTexture:source.texture sourceSlice:source.slice sourceLevel:source.level sourceOrigin:src_origin sourceSize:copy_size
+			toBuffer:dst_buffer destinationOffset:write_offset destinationBytesPerRow:bytes_per_row destinationBytesPerImage:(bytes_per_row * copy_height) options:options];
+		return true;
+	}
+	// BGRAの並べ替え、上下反転は一時テクスチャへの描画で行う
+	// NOTE: 一時テクスチャはオフスクリーンのため、GLと同じ上下の向きで格納される
+	id<MTLTexture> work_texture = nil;
+	{
+		MTLTextureDescriptor* desc = [[MTLTextureDescriptor alloc] init];
+		AXGL_ASSERT(desc != nil);
+		[desc setTextureType:MTLTextureType2D];
+		[desc setPixelFormat:MTLPixelFormatRGBA8Unorm];
+		[desc setWidth:copy_width];
+		[desc setHeight:copy_height];
+		[desc setUsage:MTLTextureUsageRenderTarget];
+		[desc setStorageMode:MTLStorageModePrivate];
+		[desc setSampleCount:1];
+		[desc setMipmapLevelCount:1];
+		work_texture = newPooledTexture(desc);
+		desc = nil;
+	}
+	if (work_texture == nil) {
+		return false;
+	}
+	bool result = copyFramebufferToTexture(readFramebuffer, readBuffer, x0, y0, (GLsizei)copy_width, (GLsizei)copy_height,
+		work_texture, 0, 0, 0, 0);
+	id<MTLBuffer> dst_buffer = nil;
+	if (result) {
+		// NOTE: 一時テクスチャへのコピーの記録後も、GPUの実行前にバッファの準備が行われる
+		dst_buffer = pack_buffer->beginGpuWrite(this, write_offset, write_end);
+		result = (dst_buffer != nil);
+	}
+	if (result) {
+		setupBlitCommandEncoder();
+		MTLOrigin work_origin = {
+			0, 0, 0 // x,y,z
+		};
+		[m_blitCommandEncoder copyFromTexture:work_texture sourceSlice:0 sourceLevel:0 sourceOrigin:work_origin sourceSize:copy_size
+			toBuffer:dst_buffer destinationOffset:write_offset destinationBytesPerRow:bytes_per_row destinationBytesPerImage:(bytes_per_row * copy_height)];
+	}
+	// 一時テクスチャは記録中のサブミッションの完了後に再利用する
+	recycleTexture(work_texture, m_submissionSerial.getPendingSerial());
+	work_texture = nil;
+	return result;
+}
+
 // VBOの更新が必要かをチェックする
 bool ContextMetal::checkVBOUpdate(VboUpdateInfo* updateInfo, VboDynamicUpdateInfo* dynamicUpdateInfo, const DrawParameters* drawParams,
-	BackendBuffer::ConversionMode conversion, GLint first, GLsizei count)
+	GLuint startVertex, GLuint endVertex, GLsizei instanceCount, bool allowBaseVertex)
 {
 	bool update = false;
 	AXGL_ASSERT((updateInfo != nullptr) && (drawParams != nullptr));
-	// 変換パラメータを保持
-	updateInfo->conversion = conversion;
-	updateInfo->first = first;
-	updateInfo->count = count;
 	// Blit マンドを使用しないでクリア
 	updateInfo->useBlit = false;
 	dynamicUpdateInfo->useDynamicBuffer = false;
+	dynamicUpdateInfo->baseVertex = 0;
 	// GL頂点属性のlocationを取得
 	const ProgramMetal* program_metal = static_cast<const ProgramMetal*>(drawParams->renderPipelineState.program);
 	AXGL_ASSERT(program_metal != nullptr);
@@ -1430,8 +2456,15 @@ bool ContextMetal::checkVBOUpdate(VboUpdateInfo* updateInfo, VboDynamicUpdateInf
 			updateInfo->buffer[i] = nullptr;
 			updateInfo->stride[i] = 16;
 			updateInfo->alignedStride[i]  = 16;
+			updateInfo->startVertex[i] = 0;
+			updateInfo->endVertex[i] = UINT32_MAX;
 			dynamicUpdateInfo->buffer[i] = nullptr;
+			dynamicUpdateInfo->dynamicBuffer[i] = nil;
 			dynamicUpdateInfo->offset[i] = 0;
+			dynamicUpdateInfo->start[i] = 0;
+			dynamicUpdateInfo->end[i] = SIZE_MAX;
+			dynamicUpdateInfo->clientArray[i].pointer = nullptr;
+			dynamicUpdateInfo->baseOffset[i] = 0;
 			int32_t loc = locations[i];
 			AXGL_ASSERT(loc < AXGL_MAX_VERTEX_ATTRIBS);
 			int metalIndex = program_metal->getActiveVertexAttribIndex(i);
@@ -1441,25 +2474,35 @@ bool ContextMetal::checkVBOUpdate(VboUpdateInfo* updateInfo, VboDynamicUpdateInf
 				uint32_t aligned_stride = get_aligned_stride(stride);
 				BufferMetal* buffer_metal = attribs[loc].buffer;
 				AXGL_ASSERT(buffer_metal != nullptr);
+				// GPUによる書き込みが保留中の場合は、更新のチェック前に反映する
+				buffer_metal->resolveGpuWrite(this, false);
+				// 使用する頂点の範囲のみを処理する
+				uint32_t start_vertex = 0;
+				uint32_t end_vertex = UINT32_MAX;
+				get_attrib_vertex_range(attribs[loc].divisor, startVertex, endVertex, instanceCount, &start_vertex, &end_vertex);
+				if (attribs[loc].formatConversion) {
+					// Metalで表現できないフォーマットは、CPUで変換したバッファを使用する(変換結果はバッファ側でキャッシュ)
+					uint32_t converted_stride = getConvertedVertexAttribSize(attribs[loc].type, attribs[loc].size);
+					dynamicUpdateInfo->dynamicBuffer[i] = buffer_metal->getFormatConvertedBuffer(this, attribs[loc].type, attribs[loc].size,
+						attribs[loc].normalized ? GL_TRUE : GL_FALSE, attribs[loc].offset, stride, start_vertex, end_vertex);
+					updateInfo->stride[i] = converted_stride;
+					updateInfo->alignedStride[i] = converted_stride;
+					continue;
+				}
 				// NOTE: 頂点バッファ書き換え時は動的バッファを使わない
-				if (conversion != BackendBuffer::ConversionModeNone) {
-					// フォーマット変換が必要な更新をチェック
-					if (buffer_metal->needUpdateWithStrideAndDataConversion(stride, aligned_stride, conversion, first, count)) {
-						updateInfo->buffer[i] = buffer_metal;
-						update = true;
-					}
-				} else if (stride != aligned_stride) {
+				if (stride != aligned_stride) {
 					// ストライド変換が必要な更新をチェック
-					if (buffer_metal->needUpdateWithStrideConversion(stride, aligned_stride)) {
+					if (buffer_metal->needUpdateWithStrideConversion(stride, aligned_stride, start_vertex, end_vertex)) {
 						updateInfo->buffer[i] = buffer_metal;
 						update = true;
 					}
 				} else {
 					// 変換が不要なケース
 					if (buffer_metal->isDynamicBuffer()) {
-						// 動的バッファを割り当て
+						// 動的バッファを割り当て、使用する頂点の範囲のみをコピーする
 						dynamicUpdateInfo->buffer[i] = buffer_metal;
 						dynamicUpdateInfo->useDynamicBuffer = true;
+						get_vertex_byte_range(start_vertex, end_vertex, stride, &dynamicUpdateInfo->start[i], &dynamicUpdateInfo->end[i]);
 					} else if (buffer_metal->needUpdateWithoutConversion()) {
 						// 更新が必要な場合、Blitで更新する
 						updateInfo->buffer[i] = buffer_metal;
@@ -1467,23 +2510,33 @@ bool ContextMetal::checkVBOUpdate(VboUpdateInfo* updateInfo, VboDynamicUpdateInf
 						updateInfo->useBlit = true;
 					}
 				}
-				// ストライドを格納しておく(変換処理で使用)
+				// ストライドと頂点範囲を格納しておく(変換処理で使用)
 				updateInfo->stride[i] = stride;
 				updateInfo->alignedStride[i] = aligned_stride;
+				updateInfo->startVertex[i] = start_vertex;
+				updateInfo->endVertex[i] = end_vertex;
 			}
 		}
 	} else {
 		// 現ステートにバインドされているVBOをチェック
 		const VertexAttrib* vertexAttribs = drawParams->renderPipelineState.vertexAttribs;
 		AXGL_ASSERT(vertexAttribs != nullptr);
+		// クライアントメモリの頂点毎の属性があるか
+		bool has_client_vertex_array = false;
 		for (int32_t i = 0; i < AXGL_MAX_VERTEX_ATTRIBS; i++) {
 			// デフォルト値でクリア
 			updateInfo->buffer[i] = nullptr;
 			updateInfo->stride[i] = 16;
 			updateInfo->alignedStride[i]  = 16;
+			updateInfo->startVertex[i] = 0;
+			updateInfo->endVertex[i] = UINT32_MAX;
 			dynamicUpdateInfo->buffer[i] = nullptr;
 			dynamicUpdateInfo->dynamicBuffer[i] = nil;
 			dynamicUpdateInfo->offset[i] = 0;
+			dynamicUpdateInfo->start[i] = 0;
+			dynamicUpdateInfo->end[i] = SIZE_MAX;
+			dynamicUpdateInfo->clientArray[i].pointer = nullptr;
+			dynamicUpdateInfo->baseOffset[i] = 0;
 			int32_t loc = locations[i];
 			AXGL_ASSERT(loc < AXGL_MAX_VERTEX_ATTRIBS);
 			const VertexAttrib& va = vertexAttribs[loc];
@@ -1491,31 +2544,70 @@ bool ContextMetal::checkVBOUpdate(VboUpdateInfo* updateInfo, VboDynamicUpdateInf
 			if ((loc >= 0) && (metalIndex >= 0) && va.enable) {
 				uint32_t stride = va.stride;
 				if (stride == 0) {
-					stride = get_size_from_gltype(va.type) * va.size;
+					stride = getVertexAttribSize(va.type, va.size);
 				}
 				uint32_t aligned_stride = get_aligned_stride(stride);
-				AXGL_ASSERT(drawParams->vertexBuffer[loc] != nullptr);
+				bool format_conversion = needVertexFormatConversion(va.type, va.normalized);
+				if (format_conversion) {
+					// NOTE: フォーマット変換後はfloatの要素が詰めて格納される
+					aligned_stride = getConvertedVertexAttribSize(va.type, va.size);
+				}
+				// 使用する頂点の範囲のみを処理する
+				uint32_t start_vertex = 0;
+				uint32_t end_vertex = UINT32_MAX;
+				get_attrib_vertex_range(va.divisor, startVertex, endVertex, instanceCount, &start_vertex, &end_vertex);
+				if (drawParams->vertexBuffer[loc] == nullptr) {
+					// クライアントメモリの頂点配列は、使用する頂点の範囲をアライメントされたストライドで動的バッファにコピーする
+					// NOTE: 頂点の範囲が不明な場合はコピーできないため、固定値を使用する
+					const void* client_pointer = drawParams->clientArrayPointer[loc];
+					if ((client_pointer != nullptr) && (end_vertex != UINT32_MAX) && (start_vertex <= end_vertex)) {
+						ClientArrayInfo* client_array = &dynamicUpdateInfo->clientArray[i];
+						client_array->pointer = client_pointer;
+						client_array->elementSize = getVertexAttribSize(va.type, va.size);
+						client_array->type = va.type;
+						client_array->size = va.size;
+						client_array->normalized = va.normalized;
+						client_array->formatConversion = format_conversion;
+						client_array->stride = stride;
+						client_array->alignedStride = aligned_stride;
+						client_array->startVertex = start_vertex;
+						client_array->endVertex = end_vertex;
+						client_array->baseVertex = 0;
+						dynamicUpdateInfo->useDynamicBuffer = true;
+						if (va.divisor == 0) {
+							has_client_vertex_array = true;
+						}
+					}
+					updateInfo->stride[i] = stride;
+					updateInfo->alignedStride[i] = aligned_stride;
+					continue;
+				}
 				BufferMetal* buffer_metal = static_cast<BufferMetal*>(drawParams->vertexBuffer[loc]->getBackendBuffer());
 				AXGL_ASSERT(buffer_metal != nullptr);
+				// GPUによる書き込みが保留中の場合は、更新のチェック前に反映する
+				buffer_metal->resolveGpuWrite(this, false);
+				if (format_conversion) {
+					// Metalで表現できないフォーマットは、CPUで変換したバッファを使用する(変換結果はバッファ側でキャッシュ)
+					dynamicUpdateInfo->dynamicBuffer[i] = buffer_metal->getFormatConvertedBuffer(this, va.type, va.size, va.normalized,
+						static_cast<uint32_t>(reinterpret_cast<uintptr_t>(va.pointer)), stride, start_vertex, end_vertex);
+					updateInfo->stride[i] = aligned_stride;
+					updateInfo->alignedStride[i] = aligned_stride;
+					continue;
+				}
 				// NOTE: 頂点バッファ書き換え時は動的バッファを使わない
-				if (conversion != BackendBuffer::ConversionModeNone) {
-					// フォーマット変換が必要な更新をチェック
-					if (buffer_metal->needUpdateWithStrideAndDataConversion(stride, aligned_stride, conversion, first, count)) {
-						updateInfo->buffer[i] = buffer_metal;
-						update = true;
-					}
-				} else if (stride != aligned_stride) {
+				if (stride != aligned_stride) {
 					// ストライド変換が必要な更新をチェック
-					if (buffer_metal->needUpdateWithStrideConversion(stride, aligned_stride)) {
+					if (buffer_metal->needUpdateWithStrideConversion(stride, aligned_stride, start_vertex, end_vertex)) {
 						updateInfo->buffer[i] = buffer_metal;
 						update = true;
 					}
 				} else {
 					// 変換が不要なケース
 					if (buffer_metal->isDynamicBuffer()) {
-						// 動的バッファを割り当て
+						// 動的バッファを割り当て、使用する頂点の範囲のみをコピーする
 						dynamicUpdateInfo->buffer[i] = buffer_metal;
 						dynamicUpdateInfo->useDynamicBuffer = true;
+						get_vertex_byte_range(start_vertex, end_vertex, stride, &dynamicUpdateInfo->start[i], &dynamicUpdateInfo->end[i]);
 					} else if (buffer_metal->needUpdateWithoutConversion()) {
 						// 更新が必要な場合、Blitで更新する
 						updateInfo->buffer[i] = buffer_metal;
@@ -1523,9 +2615,29 @@ bool ContextMetal::checkVBOUpdate(VboUpdateInfo* updateInfo, VboDynamicUpdateInf
 						updateInfo->useBlit = true;
 					}
 				}
-				// ストライドを格納しておく(変換処理で使用)
+				// ストライドと頂点範囲を格納しておく(変換処理で使用)
 				updateInfo->stride[i] = stride;
 				updateInfo->alignedStride[i] = aligned_stride;
+				updateInfo->startVertex[i] = start_vertex;
+				updateInfo->endVertex[i] = end_vertex;
+			}
+		}
+		// クライアントメモリの頂点配列は描画の先頭の頂点から動的バッファに格納し、描画の頂点番号をずらす
+		// NOTE: 頂点番号の位置に格納すると、firstやインデックスの値に比例して動的バッファが大きくなるため
+		//       ずらした分は他の頂点毎の属性のオフセットに加算する(インスタンス毎の属性はずらさない)
+		if (has_client_vertex_array && allowBaseVertex && (startVertex > 0)) {
+			dynamicUpdateInfo->baseVertex = startVertex;
+			for (int32_t i = 0; i < AXGL_MAX_VERTEX_ATTRIBS; i++) {
+				int32_t loc = locations[i];
+				if ((loc < 0) || (program_metal->getActiveVertexAttribIndex(i) < 0)
+					|| !vertexAttribs[loc].enable || (vertexAttribs[loc].divisor != 0)) {
+					continue;
+				}
+				if (dynamicUpdateInfo->clientArray[i].pointer != nullptr) {
+					dynamicUpdateInfo->clientArray[i].baseVertex = startVertex;
+				} else if (drawParams->vertexBuffer[loc] != nullptr) {
+					dynamicUpdateInfo->baseOffset[i] = static_cast<size_t>(startVertex) * updateInfo->alignedStride[i];
+				}
 			}
 		}
 	}
@@ -1547,6 +2659,8 @@ bool ContextMetal::checkUBOUpdate(UboUpdateInfo* updateInfo, UboDynamicUpdateInf
 		if (core_buffer != nullptr) {
 			BufferMetal* buffer_metal = static_cast<BufferMetal*>(core_buffer->getBackendBuffer());
 			AXGL_ASSERT(buffer_metal != nullptr);
+			// GPUによる書き込みが保留中の場合は、更新のチェック前に反映する
+			buffer_metal->resolveGpuWrite(this, false);
 			if (buffer_metal->isDynamicBuffer()) {
 				dynamicUpdateInfo->buffer[i] = buffer_metal;
 				dynamicUpdateInfo->useDynamicBuffer = true;
@@ -1561,38 +2675,40 @@ bool ContextMetal::checkUBOUpdate(UboUpdateInfo* updateInfo, UboDynamicUpdateInf
 
 // IBOの更新が必要かをチェックする
 bool ContextMetal::checkIBOUpdate(IboUpdateInfo* updateInfo, IboDynamicUpdateInfo* dynamicUpdateInfo, const DrawParameters* drawParams,
-	BackendBuffer::ConversionMode conversion, intptr_t iboOffset, intptr_t iboSize, bool isUbyte)
+	BackendBuffer::ConversionMode conversion, intptr_t iboOffset, intptr_t iboSize, GLenum type)
 {
 	AXGL_ASSERT((updateInfo != nullptr) && (drawParams != nullptr));
-	BufferMetal* buffer_metal = nullptr;
-	if (drawParams->vertexArray == nullptr) {
-		// 現在のインデックスバッファ
-		if (drawParams->indexBuffer != nullptr) {
-			buffer_metal = static_cast<BufferMetal*>(drawParams->indexBuffer->getBackendBuffer());
-		}
-	} else {
-		// VAOからインデックスバッファを取得
-		CoreBuffer* index_buffer = drawParams->vertexArray->getIndexBuffer();
-		if (index_buffer != nullptr) {
-			buffer_metal = static_cast<BufferMetal*>(index_buffer->getBackendBuffer());
-		}
-	}
+	BufferMetal* buffer_metal = getIndexBufferMetal(drawParams);
+	bool isUbyte = (type == GL_UNSIGNED_BYTE);
 	// デフォルト値でクリア
 	updateInfo->buffer = nullptr;
 	updateInfo->conversion = BackendBuffer::ConversionModeNone;
 	updateInfo->iboOffset = iboOffset;
 	updateInfo->iboSize = iboSize;
 	updateInfo->isUbyte = isUbyte;
+	updateInfo->primitiveRestart = (drawParams->primitiveRestartFixedIndex != GL_FALSE);
 	updateInfo->useBlit = false;
 	dynamicUpdateInfo->buffer = nullptr;
 	dynamicUpdateInfo->dynamicBuffer = nil;
 	dynamicUpdateInfo->offset = 0;
+	dynamicUpdateInfo->start = static_cast<size_t>(iboOffset);
+	dynamicUpdateInfo->end = static_cast<size_t>(iboOffset + iboSize);
+	dynamicUpdateInfo->clientIndices = nullptr;
+	dynamicUpdateInfo->type = type;
+	dynamicUpdateInfo->count = static_cast<GLsizei>(iboSize / get_indices_size(1, type));
+	dynamicUpdateInfo->conversion = conversion;
+	dynamicUpdateInfo->primitiveRestart = updateInfo->primitiveRestart;
+	dynamicUpdateInfo->convertedCount = 0;
 	dynamicUpdateInfo->useDynamicBuffer = false;
 	bool update = false;
 	if (buffer_metal != nullptr) {
-		int result = buffer_metal->needUpdateWithIndexConversion(conversion, iboOffset, iboSize, isUbyte);
-		if (buffer_metal->isDynamicBuffer() && ((result == BufferMetal::NoUpdateRequired) || (result == BufferMetal::UpdateRequiredWithBlitCommand))) {
-			// 動的バッファを割り当て
+		// GPUによる書き込みが保留中の場合は、更新のチェック前に反映する
+		buffer_metal->resolveGpuWrite(this, false);
+		int result = buffer_metal->needUpdateWithIndexConversion(conversion, iboOffset, iboSize, isUbyte, updateInfo->primitiveRestart);
+		// NOTE: インデックス変換を行う場合は変換後のバッファを使用するため、動的バッファを使わない
+		if ((conversion == BackendBuffer::ConversionModeNone) && buffer_metal->isDynamicBuffer()
+			&& ((result == BufferMetal::NoUpdateRequired) || (result == BufferMetal::UpdateRequiredWithBlitCommand))) {
+			// 動的バッファを割り当て、使用するインデックスの範囲のみをコピーする
 			dynamicUpdateInfo->buffer = buffer_metal;
 			dynamicUpdateInfo->useDynamicBuffer = true;
 		} else if (result != BufferMetal::NoUpdateRequired) {
@@ -1602,6 +2718,11 @@ bool ContextMetal::checkIBOUpdate(IboUpdateInfo* updateInfo, IboDynamicUpdateInf
 			updateInfo->useBlit = (result == BufferMetal::UpdateRequiredWithBlitCommand);
 			update = true;
 		}
+	} else if (iboOffset != 0) {
+		// インデックスバッファがバインドされていない場合、indicesはクライアントメモリのポインタ
+		// 変換しながら動的バッファにコピーする
+		dynamicUpdateInfo->clientIndices = reinterpret_cast<const void*>(iboOffset);
+		dynamicUpdateInfo->useDynamicBuffer = true;
 	}
 
 	return update;
@@ -1614,16 +2735,10 @@ void ContextMetal::updateVBO(const VboUpdateInfo* updateInfo)
 	for (int i = 0; i < AXGL_MAX_VERTEX_ATTRIBS; i++) {
 		BufferMetal* buffer_metal = updateInfo->buffer[i];
 		if (buffer_metal != nullptr) {
-			if (updateInfo->conversion != BackendBuffer::ConversionModeNone) {
-				// データフォーマット変換を含むセットアップ
-				bool result = buffer_metal->setupWithStrideAndDataConversion(this,
-					updateInfo->stride[i], updateInfo->alignedStride[i],
-					updateInfo->conversion, updateInfo->first, updateInfo->count);
-				AXGL_ASSERT(result);
-			} else if (updateInfo->stride[i] != updateInfo->alignedStride[i]) {
+			if (updateInfo->stride[i] != updateInfo->alignedStride[i]) {
 				// ストライド変換を含むセットアップ
 				bool result = buffer_metal->setupBufferWithStrideConversion(this,
-					updateInfo->stride[i], updateInfo->alignedStride[i]);
+					updateInfo->stride[i], updateInfo->alignedStride[i], updateInfo->startVertex[i], updateInfo->endVertex[i]);
 				AXGL_ASSERT(result);
 			} else {
 				// 変換を必要としないセットアップ
@@ -1655,14 +2770,54 @@ void ContextMetal::updateIBO(const IboUpdateInfo* updateInfo)
 	BufferMetal* buffer_metal = updateInfo->buffer;
 	if (buffer_metal != nullptr) {
 		if (updateInfo->isUbyte) {
-			buffer_metal->setU8U16ConversionMode();
+			buffer_metal->setU8U16ConversionMode(updateInfo->primitiveRestart);
 		}
-		bool result = buffer_metal->setupBufferInDraw(this, updateInfo->conversion, updateInfo->iboOffset, updateInfo->iboSize);
+		bool result = buffer_metal->setupBufferInDraw(this, updateInfo->conversion, updateInfo->iboOffset, updateInfo->iboSize,
+			updateInfo->primitiveRestart);
 		AXGL_ASSERT(result);
 	}
 	return;
 }
 
+// 描画で参照するバッファに、記録中のサブミッションのシリアルを設定する
+void ContextMetal::markBuffersInUse(const DrawParameters* drawParams)
+{
+	AXGL_ASSERT(drawParams != nullptr);
+	uint64_t serial = m_submissionSerial.getPendingSerial();
+	// VBO
+	if (drawParams->vertexArray != nullptr) {
+		VertexArrayMetal* vertex_array_metal = static_cast<VertexArrayMetal*>(drawParams->vertexArray->getBackendVertexArray());
+		AXGL_ASSERT(vertex_array_metal != nullptr);
+		const VertexArrayMetal::AttribParamMetal* attribs = vertex_array_metal->getAttribParams();
+		for (int32_t i = 0; i < AXGL_MAX_VERTEX_ATTRIBS; i++) {
+			if (attribs[i].buffer != nullptr) {
+				attribs[i].buffer->setLastUsedSerial(&m_submissionSerial, serial);
+			}
+		}
+	} else {
+		for (int32_t i = 0; i < AXGL_MAX_VERTEX_ATTRIBS; i++) {
+			if (drawParams->vertexBuffer[i] != nullptr) {
+				BufferMetal* buffer_metal = static_cast<BufferMetal*>(drawParams->vertexBuffer[i]->getBackendBuffer());
+				buffer_metal->setLastUsedSerial(&m_submissionSerial, serial);
+			}
+		}
+	}
+	// UBO
+	for (int32_t i = 0; i < AXGL_MAX_UNIFORM_BUFFER_BINDINGS; i++) {
+		CoreBuffer* core_buffer = drawParams->uniformBuffer[i].buffer;
+		if (core_buffer != nullptr) {
+			BufferMetal* buffer_metal = static_cast<BufferMetal*>(core_buffer->getBackendBuffer());
+			buffer_metal->setLastUsedSerial(&m_submissionSerial, serial);
+		}
+	}
+	// IBO
+	BufferMetal* index_buffer = getIndexBufferMetal(drawParams);
+	if (index_buffer != nullptr) {
+		index_buffer->setLastUsedSerial(&m_submissionSerial, serial);
+	}
+	return;
+}
+
 // 動的バッファの更新を行う
 void ContextMetal::updateDynamicBuffers(VboDynamicUpdateInfo* vboInfo, UboDynamicUpdateInfo* uboInfo, IboDynamicUpdateInfo* iboInfo)
 {
@@ -1673,13 +2828,17 @@ void ContextMetal::updateDynamicBuffers(VboDynamicUpdateInfo* vboInfo, UboDynami
 			if (vboInfo->buffer[i] != nullptr) {
 				BufferMetal* buffer = vboInfo->buffer[i];
 				size_t buffer_data_size = buffer->getBufferDataSize();
-				// 動的バッファを用意してコピー
-				setupDynamicBuffer(buffer_data_size);
-				buffer->copyToDynamicBuffer(m_dynamicBuffer, m_dynamicBufferOffset);
-				// コピーした情報を保持し、現在のオフセットを更新
+				// 描画に使用する範囲のみを動的バッファにコピー
+				size_t copy_start = std::min(vboInfo->start[i], buffer_data_size);
+				size_t copy_end = std::min(vboInfo->end[i], buffer_data_size);
+				size_t offset = allocateDynamicBufferRange(copy_start, copy_end);
+				buffer->copyToDynamicBuffer(m_dynamicBuffer, offset, copy_start, copy_end);
+				// コピーした情報を保持
 				vboInfo->dynamicBuffer[i] = m_dynamicBuffer;
-				vboInfo->offset[i] = m_dynamicBufferOffset;
-				m_dynamicBufferOffset = get_aligned_buffer_offset(m_dynamicBufferOffset + buffer_data_size);
+				vboInfo->offset[i] = offset;
+			} else if (vboInfo->clientArray[i].pointer != nullptr) {
+				// クライアントメモリの頂点配列をコピー
+				uploadClientArray(vboInfo, i);
 			}
 		}
 	}
@@ -1690,12 +2849,11 @@ void ContextMetal::updateDynamicBuffers(VboDynamicUpdateInfo* vboInfo, UboDynami
 				BufferMetal* buffer = uboInfo->buffer[i];
 				size_t buffer_data_size = buffer->getBufferDataSize();
 				// 動的バッファを用意してコピー
-				setupDynamicBuffer(buffer_data_size);
-				buffer->copyToDynamicBuffer(m_dynamicBuffer, m_dynamicBufferOffset);
-				// コピーしたオフセットを保持し、現在のオフセットを更新
+				size_t offset = allocateDynamicBufferRange(0, buffer_data_size);
+				buffer->copyToDynamicBuffer(m_dynamicBuffer, offset, 0, buffer_data_size);
+				// コピーしたオフセットを保持
 				uboInfo->dynamicBuffer[i] = m_dynamicBuffer;
-				uboInfo->offset[i] = m_dynamicBufferOffset;
-				m_dynamicBufferOffset = get_aligned_buffer_offset(m_dynamicBufferOffset + buffer_data_size);
+				uboInfo->offset[i] = offset;
 			}
 		}
 	}
@@ -1704,13 +2862,19 @@ void ContextMetal::updateDynamicBuffers(VboDynamicUpdateInfo* vboInfo, UboDynami
 		if (iboInfo->buffer != nullptr) {
 			BufferMetal* buffer = iboInfo->buffer;
 			size_t buffer_data_size = buffer->getBufferDataSize();
-			// 動的バッファを用意してコピー
-			setupDynamicBuffer(buffer_data_size);
-			buffer->copyToDynamicBuffer(m_dynamicBuffer, m_dynamicBufferOffset);
-			// コピーしたオフセットを保持し、現在のオフセットを更新
+			// 描画に使用するインデックスの範囲のみを動的バッファにコピー
+			size_t copy_start = std::min(iboInfo->start, buffer_data_size);
+			size_t copy_end = std::min(iboInfo->end, buffer_data_size);
+			// uint8のインデックスはuint16に変換してコピーされる
+			size_t scale = buffer->isU8U16ConversionMode() ? sizeof(uint16_t) : sizeof(uint8_t);
+			size_t offset = allocateDynamicBufferRange(copy_start * scale, copy_end * scale);
+			buffer->copyToDynamicBuffer(m_dynamicBuffer, offset, copy_start, copy_end);
+			// コピーしたオフセットを保持
 			iboInfo->dynamicBuffer = m_dynamicBuffer;
-			iboInfo->offset = m_dynamicBufferOffset;
-			m_dynamicBufferOffset = get_aligned_buffer_offset(m_dynamicBufferOffset + buffer_data_size);
+			iboInfo->offset = offset;
+		} else if (iboInfo->clientIndices != nullptr) {
+			// クライアントメモリのインデックスを変換しながらコピー
+			uploadClientIndices(iboInfo);
 		}
 	}
 	return;
@@ -1735,6 +2899,13 @@ void ContextMetal::commitDrawCommandBuffer(WaitMode waitMode)
 	}
 	// 使用中のコマンドエンコーダがある場合、エンコード終了
 	endCommandEncoder();
+	// 完了時にシリアルを完了済みにするハンドラを設定
+	SubmissionSerial* submission_serial = &m_submissionSerial;
+	uint64_t serial = m_submissionSerial.submit();
+	void (^completed_func)(id<MTLCommandBuffer>) = ^(id<MTLCommandBuffer> cmdBuffer){
+		submission_serial->complete(serial);
+	};
+	[m_drawCommandBuffer addCompletedHandler:completed_func];
 	// コマンドバッファをcommit
 	[m_drawCommandBuffer commit];
 	// Scheduled/Completedが指定されている場合、コマンドバッファのwaitを呼び出す
@@ -1749,7 +2920,10 @@ void ContextMetal::commitDrawCommandBuffer(WaitMode waitMode)
 	default:
 		break;
 	}
+	m_lastDrawCommandBuffer = m_drawCommandBuffer;
 	m_drawCommandBuffer = nil;
+	// シャドウバッファのメモリが予算を超えている場合は、書き込まれていないものを破棄
+	m_shadowBufferBudget.evict(&m_submissionSerial);
 	return;
 }
 
@@ -1757,6 +2931,8 @@ void ContextMetal::commitDrawCommandBuffer(WaitMode waitMode)
 bool ContextMetal::setupRenderCommandEncoder(MTLRenderPassDescriptor* renderPassDesc)
 {
 	if (m_renderCommandEncoder != nil) {
+		// NOTE: 無効化後に描画する場合は内容が定義されるため、ストアを省略しない
+		m_renderPassDontCareStoreMask = 0;
 		// エンコーダ作成済み:false
 		return false;
 	}
@@ -1767,8 +2943,29 @@ bool ContextMetal::setupRenderCommandEncoder(MTLRenderPassDescriptor* renderPass
 	AXGL_ASSERT(m_drawCommandBuffer != nil);
 	m_renderCommandEncoder = [m_drawCommandBuffer renderCommandEncoderWithDescriptor:renderPassDesc];
 	AXGL_ASSERT(m_renderCommandEncoder != nil);
+	// アタッチメントのテクスチャ、レンダーバッファに記録中のサブミッションのシリアルを設定
+	// NOTE: レンダーパスは1つのサブミッションに収まるため、エンコーダの作成時に設定すれば良い
+	if (m_renderFramebuffer != nullptr) {
+		m_renderFramebuffer->markAttachmentsInUse(&m_submissionSerial, m_submissionSerial.getPendingSerial());
+	}
 	// 描画パラメータ設定をクリア
 	m_setDrawParameterToEncoder = false;
+	// ストアアクションを設定するアタッチメントを保持
+	m_renderPassAttachmentMask = FramebufferMetal::getAttachmentMask(renderPassDesc);
+	m_renderPassDontCareStoreMask = 0;
+	// 無効化によりロードしないアタッチメントを集計
+	m_renderPassStats.passCount++;
+	for (int i = 0; i < AXGL_MAX_COLOR_ATTACHMENTS; i++) {
+		if (((m_renderPassAttachmentMask & (1u << i)) != 0) && (renderPassDesc.colorAttachments[i].loadAction == MTLLoadActionDontCare)) {
+			m_renderPassStats.loadSkippedCount++;
+		}
+	}
+	if (((m_renderPassAttachmentMask & c_attachment_bit_depth) != 0) && (renderPassDesc.depthAttachment.loadAction == MTLLoadActionDontCare)) {
+		m_renderPassStats.loadSkippedCount++;
+	}
+	if (((m_renderPassAttachmentMask & c_attachment_bit_stencil) != 0) && (renderPassDesc.stencilAttachment.loadAction == MTLLoadActionDontCare)) {
+		m_renderPassStats.loadSkippedCount++;
+	}
 	// エンコーダを作成:true
 	return true;
 }
@@ -1777,6 +2974,7 @@ bool ContextMetal::setupRenderCommandEncoder(MTLRenderPassDescriptor* renderPass
 void ContextMetal::endRenderCommandEncoder()
 {
 	if (m_renderCommandEncoder != nil) {
+		setupRenderPassStoreActions();
 		[m_renderCommandEncoder endEncoding];
 		m_renderCommandEncoder = nil;
 		// 念のため描画パラメータ設定をクリアしておく
@@ -1785,6 +2983,40 @@ void ContextMetal::endRenderCommandEncoder()
 	return;
 }
 
+// 描画コマンドエンコーダのストアアクションを設定する
+// NOTE: レンダーパスはMTLStoreActionUnknownで開始するため、エンコード終了前に必ず設定する
+void ContextMetal::setupRenderPassStoreActions()
+{
+	AXGL_ASSERT(m_renderCommandEncoder != nil);
+	uint32_t dont_care_mask = m_renderPassDontCareStoreMask & m_renderPassAttachmentMask;
+	for (int i = 0; i < AXGL_MAX_COLOR_ATTACHMENTS; i++) {
+		uint32_t bit = 1u << i;
+		if ((m_renderPassAttachmentMask & bit) != 0) {
+			[m_renderCommandEncoder setColorStoreAction:(((dont_care_mask & bit) != 0) ? MTLStoreActionDontCare : MTLStoreActionStore) atIndex:i];
+		}
+	}
+	if ((m_renderPassAttachmentMask & c_attachment_bit_depth) != 0) {
+		[m_renderCommandEncoder setDepthStoreAction:(((dont_care_mask & c_attachment_bit_depth) != 0) ? MTLStoreActionDontCare : MTLStoreActionStore)];
+	}
+	if ((m_renderPassAttachmentMask & c_attachment_bit_stencil) != 0) {
+		[m_renderCommandEncoder setStencilStoreAction:(((dont_care_mask & c_attachment_bit_stencil) != 0) ? MTLStoreActionDontCare : MTLStoreActionStore)];
+	}
+	m_renderPassStats.storeSkippedCount += static_cast<uint64_t>(__builtin_popcount(dont_care_mask));
+	m_renderPassAttachmentMask = 0;
+	m_renderPassDontCareStoreMask = 0;
+	return;
+}
+
+// フレームバッファのアタッチメントの無効化を記録中のレンダーパスに反映する
+// NOTE: 記録中のレンダーパスのフレームバッファの場合、以降に描画がなければエンコード終了時にストアしない
+void ContextMetal::invalidateRenderPassAttachments(FramebufferMetal* framebuffer, uint32_t attachmentMask)
+{
+	if ((m_renderCommandEncoder != nil) && (m_renderFramebuffer == framebuffer)) {
+		m_renderPassDontCareStoreMask |= attachmentMask;
+	}
+	return;
+}
+
 // Blit用のコマンドエンコーダを用意する
 void ContextMetal::setupBlitCommandEncoder()
 {
@@ -1812,12 +3044,7 @@ void ContextMetal::endBlitCommandEncoder()
 // 全てのコマンドエンコーダを終了させる
 void ContextMetal::endCommandEncoder()
 {
-	if (m_renderCommandEncoder != nil) {
-		[m_renderCommandEncoder endEncoding];
-		m_renderCommandEncoder = nil;
-		// 念のため描画パラメータ設定をクリアしておく
-		m_setDrawParameterToEncoder = false;
-	}
+	endRenderCommandEncoder();
 	if (m_blitCommandEncoder != nil) {
 		[m_blitCommandEncoder endEncoding];
 		m_blitCommandEncoder = nil;
@@ -1830,12 +3057,15 @@ void ContextMetal::setupDefaultUniformBuffer(size_t size)
 {
 	AXGL_ASSERT((m_mtlDevice != nil) && (size > 0));
 	if ((m_defaultUniformBuffer == nil) || ((m_defaultUniformBufferOffset + size) > c_default_uniform_buffer_size)) {
+		size_t old_size = 0;
 		if (m_defaultUniformBuffer != nil) {
+			old_size = c_default_uniform_buffer_size;
 			m_defaultUniformBuffer = nil;
 		}
-		// NOTE: 古いMTLBufferはARCによって描画が完了したら破棄される
+		// NOTE: 古いMTLBufferはARCによって描画が完了したら破棄される(使用量は置き換えた時点で減らす)
 		m_defaultUniformBuffer = [m_mtlDevice newBufferWithLength:c_default_uniform_buffer_size options:MTLResourceStorageModeShared];
 		AXGL_ASSERT(m_defaultUniformBuffer != nil);
+		MemoryAccounting::getInstance().update(MemoryCategoryStaging, old_size, c_default_uniform_buffer_size);
 		m_defaultUniformBufferOffset = 0;
 	}
 	return;
@@ -1845,18 +3075,321 @@ void ContextMetal::setupDefaultUniformBuffer(size_t size)
 void ContextMetal::setupDynamicBuffer(size_t size)
 {
 	AXGL_ASSERT((m_mtlDevice != nil) && (size > 0));
-	if ((m_dynamicBuffer == nil) || ((m_dynamicBufferOffset + size) > c_dynamic_buffer_size)) {
+	if ((m_dynamicBuffer == nil) || ((m_dynamicBufferOffset + size) > [m_dynamicBuffer length])) {
+		size_t old_size = 0;
 		if (m_dynamicBuffer != nil) {
+			old_size = [m_dynamicBuffer length];
 			m_dynamicBuffer = nil;
 		}
-		// NOTE: 古いMTLBufferはARCによって描画が完了したら破棄される
-		m_dynamicBuffer = [m_mtlDevice newBufferWithLength:c_dynamic_buffer_size options:MTLResourceStorageModeShared];
+		// NOTE: 古いMTLBufferはARCによって描画が完了したら破棄される(使用量は置き換えた時点で減らす)
+		// NOTE: クライアントメモリの頂点配列が既定のサイズを超える場合は、そのサイズで作成する
+		size_t buffer_size = std::max(c_dynamic_buffer_size, size);
+		m_dynamicBuffer = [m_mtlDevice newBufferWithLength:buffer_size options:MTLResourceStorageModeShared];
 		AXGL_ASSERT(m_dynamicBuffer != nil);
+		MemoryAccounting::getInstance().update(MemoryCategoryStaging, old_size, buffer_size);
 		m_dynamicBufferOffset = 0;
 	}
 	return;
 }
 
+// 動的バッファに[start, end)の範囲を格納する領域を確保し、バインドするオフセットを返す
+size_t ContextMetal::allocateDynamicBufferRange(size_t start, size_t end)
+{
+	AXGL_ASSERT(start <= end);
+	// NOTE: オフセットのアライメント分の余裕を含めて用意
+	setupDynamicBuffer(end + get_aligned_buffer_offset(1));
+	// NOTE: バインドするオフセットからstartまでの領域は参照されないため、
+	//       直前に格納したデータと重なっても問題ない
+	size_t offset = (m_dynamicBufferOffset > start) ? get_aligned_buffer_offset(m_dynamicBufferOffset - start) : 0;
+	AXGL_ASSERT((offset + end) <= [m_dynamicBuffer length]);
+	m_dynamicBufferOffset = get_aligned_buffer_offset(offset + end);
+	return offset;
+}
+
+// クライアントメモリの頂点配列を動的バッファにコピーする
+void ContextMetal::uploadClientArray(VboDynamicUpdateInfo* vboInfo, int32_t index)
+{
+	AXGL_ASSERT((vboInfo != nullptr) && (index >= 0) && (index < AXGL_MAX_VERTEX_ATTRIBS));
+	const ClientArrayInfo* client_array = &vboInfo->clientArray[index];
+	AXGL_ASSERT(client_array->pointer != nullptr);
+	AXGL_ASSERT(client_array->startVertex <= client_array->endVertex);
+	size_t stride = client_array->stride;
+	size_t aligned_stride = client_array->alignedStride;
+	size_t start_vertex = client_array->startVertex;
+	size_t vertex_count = static_cast<size_t>(client_array->endVertex) - start_vertex + 1;
+	AXGL_ASSERT(client_array->baseVertex <= start_vertex);
+	// 頂点データは[(startVertex - baseVertex) * alignedStride, (endVertex + 1 - baseVertex) * alignedStride)の範囲に格納する
+	// NOTE: baseVertexで描画する場合は、割り当てた位置に先頭の頂点から格納される
+	size_t copy_start = (start_vertex - client_array->baseVertex) * aligned_stride;
+	size_t copy_end = copy_start + vertex_count * aligned_stride;
+	size_t offset = allocateDynamicBufferRange(copy_start, copy_end);
+	uint8_t* dst = static_cast<uint8_t*>([m_dynamicBuffer contents]) + offset + copy_start;
+	const uint8_t* src = static_cast<const uint8_t*>(client_array->pointer) + start_vertex * stride;
+	if (client_array->formatConversion) {
+		// Metalで表現できないフォーマットはfloatに変換しながらコピー
+		convertVertexAttrib(dst, aligned_stride, src, stride, vertex_count, client_array->type, client_array->size, client_array->normalized);
+	} else if (stride == aligned_stride) {
+		// ストライドが同じ場合は一括コピー
+		// NOTE: 最後の頂点はストライド分のデータが存在するとは限らないため、要素のサイズまでをコピーする
+		memcpy(dst, src, (vertex_count - 1) * stride + client_array->elementSize);
+	} else {
+		// 頂点毎にアライメントされたストライドでコピー
+		size_t element_size = std::min(static_cast<size_t>(client_array->elementSize), stride);
+		for (size_t v = 0; v < vertex_count; v++) {
+			memcpy(dst, src, element_size);
+			dst += aligned_stride;
+			src += stride;
+		}
+	}
+	// コピーした情報を保持
+	vboInfo->dynamicBuffer[index] = m_dynamicBuffer;
+	vboInfo->offset[index] = offset;
+	return;
+}
+
+// クライアントメモリのインデックスを変換しながら動的バッファにコピーする
+void ContextMetal::uploadClientIndices(IboDynamicUpdateInfo* iboInfo)
+{
+	AXGL_ASSERT((iboInfo != nullptr) && (iboInfo->clientIndices != nullptr));
+	size_t count = static_cast<size_t>(iboInfo->count);
+	bool restart = iboInfo->primitiveRestart;
+	// NOTE: uint8のインデックスはuint16に変換する
+	size_t index_size = (iboInfo->type == GL_UNSIGNED_INT) ? sizeof(uint32_t) : sizeof(uint16_t);
+	// 変換後の最大インデックス数
+	size_t max_count = count;
+	switch (iboInfo->conversion) {
+	case BackendBuffer::ConversionModeTriFanIndices8:
+	case BackendBuffer::ConversionModeTriFanIndices16:
+	case BackendBuffer::ConversionModeTriFanIndices32:
+		max_count = (count > 2) ? (3 * (count - 2)) : 0;
+		break;
+	case BackendBuffer::ConversionModeLineLoopIndices8:
+	case BackendBuffer::ConversionModeLineLoopIndices16:
+	case BackendBuffer::ConversionModeLineLoopIndices32:
+		max_count = restart ? (2 * count) : (count + 1);
+		break;
+	default:
+		break;
+	}
+	// NOTE: 描画されない場合もインデックスバッファは設定されるため、最低1個分の領域を確保する
+	size_t offset = allocateDynamicBufferRange(0, std::max(max_count, static_cast<size_t>(1)) * index_size);
+	void* dst = static_cast<uint8_t*>([m_dynamicBuffer contents]) + offset;
+	const void* src = iboInfo->clientIndices;
+	size_t converted_count = 0;
+	switch (iboInfo->conversion) {
+	case BackendBuffer::ConversionModeNone:
+		if (iboInfo->type == GL_UNSIGNED_BYTE) {
+			if (restart) {
+				widenIndicesU8ToU16Restart(static_cast<uint16_t*>(dst), static_cast<const uint8_t*>(src), count);
+			} else {
+				widenIndicesU8ToU16(static_cast<uint16_t*>(dst), static_cast<const uint8_t*>(src), count);
+			}
+		} else {
+			memcpy(dst, src, count * index_size);
+		}
+		converted_count = count;
+		break;
+	case BackendBuffer::ConversionModeTriFanIndices8:
+		if (count > 2) {
+			if (restart) {
+				converted_count = convertTriFanIndicesRestartU8(static_cast<uint16_t*>(dst), static_cast<const uint8_t*>(src), count);
+			} else {
+				convertTriFanIndicesU8(static_cast<uint16_t*>(dst), static_cast<const uint8_t*>(src), count);
+				converted_count = max_count;
+			}
+		}
+		break;
+	case BackendBuffer::ConversionModeTriFanIndices16:
+		if (count > 2) {
+			if (restart) {
+				converted_count = convertTriFanIndicesRestartU16(static_cast<uint16_t*>(dst), static_cast<const uint16_t*>(src), count);
+			} else {
+				convertTriFanIndicesU16(static_cast<uint16_t*>(dst), static_cast<const uint16_t*>(src), count);
+				converted_count = max_count;
+			}
+		}
+		break;
+	case BackendBuffer::ConversionModeTriFanIndices32:
+		if (count > 2) {
+			if (restart) {
+				converted_count = convertTriFanIndicesRestartU32(static_cast<uint32_t*>(dst), static_cast<const uint32_t*>(src), count);
+			} else {
+				convertTriFanIndicesU32(static_cast<uint32_t*>(dst), static_cast<const uint32_t*>(src), count);
+				converted_count = max_count;
+			}
+		}
+		break;
+	case BackendBuffer::ConversionModeLineLoopIndices8:
+		if (count > 1) {
+			if (restart) {
+				converted_count = convertLineLoopIndicesRestartU8(static_cast<uint16_t*>(dst), static_cast<const uint8_t*>(src), count);
+			} else {
+				convertLineLoopIndicesU8(static_cast<uint16_t*>(dst), static_cast<const uint8_t*>(src), count);
+				converted_count = max_count;
+			}
+		}
+		break;
+	case BackendBuffer::ConversionModeLineLoopIndices16:
+		if (count > 1) {
+			if (restart) {
+				converted_count = convertLineLoopIndicesRestartU16(static_cast<uint16_t*>(dst), static_cast<const uint16_t*>(src), count);
+			} else {
+				convertLineLoopIndicesU16(static_cast<uint16_t*>(dst), static_cast<const uint16_t*>(src), count);
+				converted_count = max_count;
+			}
+		}
+		break;
+	case BackendBuffer::ConversionModeLineLoopIndices32:
+		if (count > 1) {
+			if (restart) {
+				converted_count = convertLineLoopIndicesRestartU32(static_cast<uint32_t*>(dst), static_cast<const uint32_t*>(src), count);
+			} else {
+				convertLineLoopIndicesU32(static_cast<uint32_t*>(dst), static_cast<const uint32_t*>(src), count);
+				converted_count = max_count;
+			}
+		}
+		break;
+	default:
+		AXGL_ASSERT(0);
+		break;
+	}
+	// コピーした情報を保持
+	iboInfo->dynamicBuffer = m_dynamicBuffer;
+	iboInfo->offset = offset;
+	iboInfo->convertedCount = static_cast<uint32_t>(converted_count);
+	return;
+}
+
+// TriangleFanをインデックス付きの三角形リストとして描画する
+void ContextMetal::drawTriFanArrays(id<MTLRenderCommandEncoder> encoder, GLint first, GLsizei count, GLsizei instancecount)
+{
+	AXGL_ASSERT(encoder != nil);
+	if (count < 3) {
+		return; // 描画されない
+	}
+	NSUInteger index_count = static_cast<NSUInteger>(count - 2) * 3;
+	if ((first == 0) || m_supportsBaseVertex) {
+		// 頂点数でキャッシュしたインデックスを使用し、firstはベース頂点で指定する
+		MTLIndexType index_type = (count <= c_index_count_max_u16) ? MTLIndexTypeUInt16 : MTLIndexTypeUInt32;
+		id<MTLBuffer> index_buffer = setupTriFanIndexBuffer(count, index_type);
+		if (index_buffer == nil) {
+			return;
+		}
+		if (first == 0) {
+			[encoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle indexCount:index_count indexType:index_type indexBuffer:index_buffer indexBufferOffset:0 instanceCount:instancecount];
+		} else {
+			[encoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle indexCount:index_count indexType:index_type indexBuffer:index_buffer indexBufferOffset:0 instanceCount:instancecount baseVertex:first baseInstance:0];
+		}
+	} else {
+		// ベース頂点を使用できない場合、firstを加算したインデックスを動的バッファに作成する
+		bool is_u16 = ((first + count) <= c_index_count_max_u16);
+		MTLIndexType index_type = is_u16 ? MTLIndexTypeUInt16 : MTLIndexTypeUInt32;
+		size_t index_size = index_count * (is_u16 ? sizeof(uint16_t) : sizeof(uint32_t));
+		if (index_size > c_dynamic_buffer_size) {
+			AXGL_DBGOUT("drawTriFanArrays> too many vertices:%d\n", count);
+			return;
+		}
+		setupDynamicBuffer(index_size);
+		uint8_t* dst = static_cast<uint8_t*>([m_dynamicBuffer contents]) + m_dynamicBufferOffset;
+		if (is_u16) {
+			make_tri_fan_indices(reinterpret_cast<uint16_t*>(dst), first, count);
+		} else {
+			make_tri_fan_indices(reinterpret_cast<uint32_t*>(dst), first, count);
+		}
+		[encoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle indexCount:index_count indexType:index_type indexBuffer:m_dynamicBuffer indexBufferOffset:m_dynamicBufferOffset instanceCount:instancecount];
+		m_dynamicBufferOffset = get_aligned_buffer_offset(m_dynamicBufferOffset + index_size);
+	}
+	return;
+}
+
+// LineLoopをループを閉じたLineStripとして描画する
+void ContextMetal::drawLineLoopArrays(id<MTLRenderCommandEncoder> encoder, GLint first, GLsizei count, GLsizei instancecount)
+{
+	AXGL_ASSERT(encoder != nil);
+	if (count < 2) {
+		return; // 描画されない
+	}
+	// 先頭の頂点を末尾に追加したインデックスを動的バッファに作成する
+	NSUInteger index_count = static_cast<NSUInteger>(count) + 1;
+	bool is_u16 = ((first + count) <= c_index_count_max_u16);
+	MTLIndexType index_type = is_u16 ? MTLIndexTypeUInt16 : MTLIndexTypeUInt32;
+	size_t index_size = index_count * (is_u16 ? sizeof(uint16_t) : sizeof(uint32_t));
+	if (index_size > c_dynamic_buffer_size) {
+		AXGL_DBGOUT("drawLineLoopArrays> too many vertices:%d\n", count);
+		return;
+	}
+	setupDynamicBuffer(index_size);
+	uint8_t* dst = static_cast<uint8_t*>([m_dynamicBuffer contents]) + m_dynamicBufferOffset;
+	if (is_u16) {
+		make_line_loop_indices(reinterpret_cast<uint16_t*>(dst), first, count);
+	} else {
+		make_line_loop_indices(reinterpret_cast<uint32_t*>(dst), first, count);
+	}
+	[encoder drawIndexedPrimitives:MTLPrimitiveTypeLineStrip indexCount:index_count indexType:index_type indexBuffer:m_dynamicBuffer indexBufferOffset:m_dynamicBufferOffset instanceCount:instancecount];
+	m_dynamicBufferOffset = get_aligned_buffer_offset(m_dynamicBufferOffset + index_size);
+	return;
+}
+
+// インデックス付きの描画を行う(baseVertexはインデックスの値から引く頂点数)
+// NOTE: baseVertexが0以外になるのはm_supportsBaseVertexが有効な場合のみ(checkVBOUpdateで判定)
+void ContextMetal::drawIndexedPrimitives(id<MTLRenderCommandEncoder> encoder, MTLPrimitiveType primitiveType, NSUInteger indexCount,
+	MTLIndexType indexType, id<MTLBuffer> indexBuffer, NSUInteger indexBufferOffset, GLsizei instancecount, uint32_t baseVertex)
+{
+	AXGL_ASSERT((encoder != nil) && (indexBuffer != nil));
+	if (baseVertex == 0) {
+		[encoder drawIndexedPrimitives:primitiveType indexCount:indexCount indexType:indexType indexBuffer:indexBuffer indexBufferOffset:indexBufferOffset instanceCount:instancecount];
+	} else {
+		AXGL_ASSERT(m_supportsBaseVertex);
+		[encoder drawIndexedPrimitives:primitiveType indexCount:indexCount indexType:indexType indexBuffer:indexBuffer indexBufferOffset:indexBufferOffset
+			instanceCount:instancecount baseVertex:-static_cast<NSInteger>(baseVertex) baseInstance:0];
+	}
+	return;
+}
+
+// TriangleFan描画用のインデックスバッファを用意する
+id<MTLBuffer> ContextMetal::setupTriFanIndexBuffer(GLsizei count, MTLIndexType indexType)
+{
+	AXGL_ASSERT((m_mtlDevice != nil) && (count >= 3));
+	bool is_u16 = (indexType == MTLIndexTypeUInt16);
+	id<MTLBuffer> index_buffer = is_u16 ? m_triFanIndexBuffer16 : m_triFanIndexBuffer32;
+	GLsizei cached_count = is_u16 ? m_triFanIndexCount16 : m_triFanIndexCount32;
+	if ((index_buffer != nil) && (count <= cached_count)) {
+		// 少ない頂点数のインデックスは、キャッシュしたインデックスの先頭部分と一致する
+		return index_buffer;
+	}
+	// 頂点数を2のべき乗に切り上げて作成し、再作成の頻度を抑える
+	// NOTE: 倍にするとGLsizeiが桁あふれする場合は切り上げず、必要な頂点数で作成する
+	GLsizei new_count = c_tri_fan_index_count_min;
+	while ((new_count < count) && (new_count <= (std::numeric_limits<GLsizei>::max() / 2))) {
+		new_count *= 2;
+	}
+	new_count = std::max(new_count, count);
+	if (is_u16) {
+		new_count = std::min(new_count, c_index_count_max_u16);
+	}
+	size_t index_size = static_cast<size_t>(new_count - 2) * 3 * (is_u16 ? sizeof(uint16_t) : sizeof(uint32_t));
+	if (index_size > static_cast<size_t>([m_mtlDevice maxBufferLength])) {
+		AXGL_DBGOUT("setupTriFanIndexBuffer> too many vertices:%d\n", count);
+		return nil;
+	}
+	// NOTE: 古いMTLBufferはARCによって描画が完了したら破棄される
+	index_buffer = [m_mtlDevice newBufferWithLength:index_size options:MTLResourceStorageModeShared];
+	if (index_buffer == nil) {
+		AXGL_DBGOUT("setupTriFanIndexBuffer> newBufferWithLength failed\n");
+		return nil;
+	}
+	if (is_u16) {
+		make_tri_fan_indices(static_cast<uint16_t*>([index_buffer contents]), 0, new_count);
+		m_triFanIndexBuffer16 = index_buffer;
+		m_triFanIndexCount16 = new_count;
+	} else {
+		make_tri_fan_indices(static_cast<uint32_t*>([index_buffer contents]), 0, new_count);
+		m_triFanIndexBuffer32 = index_buffer;
+		m_triFanIndexCount32 = new_count;
+	}
+	return index_buffer;
+}
+
 // デフォルトUniform用のバッファを設定する
 void ContextMetal::setBufferForDefaultUniform(id<MTLRenderCommandEncoder> encoder,
 	int32_t vsIndex, int32_t fsIndex, const void* data, size_t size)
@@ -2176,7 +3709,7 @@ void ContextMetal::setVertexBufferForVBO(id<MTLRenderCommandEncoder> encoder, co
 				if (dynamicUpdateInfo->dynamicBuffer[i] != nil) {
 					// 動的バッファを使用
 					id<MTLBuffer> mtl_buffer = dynamicUpdateInfo->dynamicBuffer[i];
-					size_t offset = dynamicUpdateInfo->offset[i];
+					size_t offset = dynamicUpdateInfo->offset[i] + dynamicUpdateInfo->baseOffset[i];
 					[encoder setVertexBuffer:mtl_buffer offset:offset atIndex:(i + c_vbo_index_offset)];
 				} else {
 					// VBOからバッファの実体を取得
@@ -2189,7 +3722,7 @@ void ContextMetal::setVertexBufferForVBO(id<MTLRenderCommandEncoder> encoder, co
 					}
 					if (buffer_metal != nil) {
 						// バッファを設定
-						[encoder setVertexBuffer:buffer_metal offset:0 atIndex:(i + c_vbo_index_offset)];
+						[encoder setVertexBuffer:buffer_metal offset:dynamicUpdateInfo->baseOffset[i] atIndex:(i + c_vbo_index_offset)];
 					} else {
 						// バッファが取得できなかった場合は固定値を設定しておく
 						static const float constantData[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
@@ -2364,6 +3897,13 @@ void ContextMetal::setTextureAndSampler(id<MTLRenderCommandEncoder> encoder, con
 	// NOTE: サンプラは GLのsampler objectとtexture objectが影響
 	bool sampler_binding_dirty = setAll || program_dirty ||
 		((drawParams->dirtyFlags & (CURRENT_PROGRAM_DIRTY_BIT | TEXTURE_BINDING_DIRTY_BIT | SAMPLER_BINDING_DIRTY_BIT)) != 0);
+	if (setAll) {
+		// 新しいエンコーダには何も設定されていないため、設定済みのサンプラのハンドルをクリア
+		memset(m_vsBoundSamplerHandles, 0, sizeof(m_vsBoundSamplerHandles));
+		memset(m_fsBoundSamplerHandles, 0, sizeof(m_fsBoundSamplerHandles));
+	}
+	// NOTE: 描画で参照するテクスチャには、設定済みでも記録中のサブミッションのシリアルを設定する
+	uint64_t serial = m_submissionSerial.getPendingSerial();
 
 	// 頂点シェーダにテクスチャとサンプラを設定
 	// 設定したテクスチャとサンプラを格納する配列(後でダーティクリアに使用)
@@ -2395,6 +3935,9 @@ void ContextMetal::setTextureAndSampler(id<MTLRenderCommandEncoder> encoder, con
 						vs_textures[num_vs_texture] = backend_texture;
 						num_vs_texture++;
 					}
+					if (backend_texture != nullptr) {
+						backend_texture->setLastUsedSerial(&m_submissionSerial, serial);
+					}
 				}
 				// サンプラ設定
 				// unit_index : GL binding texture unit index
@@ -2409,9 +3952,17 @@ void ContextMetal::setTextureAndSampler(id<MTLRenderCommandEncoder> encoder, con
 					backend_sampler = static_cast<SamplerMetal*>(core_texture->getBackendSampler());
 				}
 				if ((backend_sampler != nullptr) && (sampler_binding_dirty || backend_sampler->isDirty())) {
-					id<MTLSamplerState> sampler_state = backend_sampler->getMtlSamplerState();
-					AXGL_ASSERT(sampler_state != nil);
-					[encoder setVertexSamplerState:sampler_state atIndex:metal_index];
+					// NOTE: 同じ設定のサンプラはMTLSamplerStateを共有するため、ハンドルが同じなら設定済み
+					uint64_t sampler_handle = backend_sampler->getSamplerHandle();
+					bool in_range = (metal_index < AXGL_MAX_COMBINED_TEXTURE_IMAGE_UNITS);
+					if (!in_range || (m_vsBoundSamplerHandles[metal_index] != sampler_handle)) {
+						id<MTLSamplerState> sampler_state = backend_sampler->getMtlSamplerState();
+						AXGL_ASSERT(sampler_state != nil);
+						[encoder setVertexSamplerState:sampler_state atIndex:metal_index];
+						if (in_range) {
+							m_vsBoundSamplerHandles[metal_index] = sampler_handle;
+						}
+					}
 					// 一連の設定が終わった後でダーティクリアするため保持
 					vs_samplers[num_vs_sampler] = backend_sampler;
 					num_vs_sampler++;
@@ -2447,6 +3998,9 @@ void ContextMetal::setTextureAndSampler(id<MTLRenderCommandEncoder> encoder, con
 						fs_textures[num_fs_texture] = backend_texture;
 						num_fs_texture++;
 					}
+					if (backend_texture != nullptr) {
+						backend_texture->setLastUsedSerial(&m_submissionSerial, serial);
+					}
 				}
 				// サンプラ設定
 				// unit_index : GL binding texture unit index
@@ -2461,9 +4015,17 @@ void ContextMetal::setTextureAndSampler(id<MTLRenderCommandEncoder> encoder, con
 					backend_sampler = static_cast<SamplerMetal*>(core_texture->getBackendSampler());
 				}
 				if ((backend_sampler != nullptr) && (sampler_binding_dirty || backend_sampler->isDirty())) {
-					id<MTLSamplerState> sampler_state = backend_sampler->getMtlSamplerState();
-					AXGL_ASSERT(sampler_state != nil);
-					[encoder setFragmentSamplerState:sampler_state atIndex:metal_index];
+					// NOTE: 同じ設定のサンプラはMTLSamplerStateを共有するため、ハンドルが同じなら設定済み
+					uint64_t sampler_handle = backend_sampler->getSamplerHandle();
+					bool in_range = (metal_index < AXGL_MAX_COMBINED_TEXTURE_IMAGE_UNITS);
+					if (!in_range || (m_fsBoundSamplerHandles[metal_index] != sampler_handle)) {
+						id<MTLSamplerState> sampler_state = backend_sampler->getMtlSamplerState();
+						AXGL_ASSERT(sampler_state != nil);
+						[encoder setFragmentSamplerState:sampler_state atIndex:metal_index];
+						if (in_range) {
+							m_fsBoundSamplerHandles[metal_index] = sampler_handle;
+						}
+					}
 					// 一連の設定が終わった後でダーティクリアするため保持
 					fs_samplers[num_fs_sampler] = backend_sampler;
 					num_fs_sampler++;
@@ -2613,7 +4175,9 @@ void ContextMetal::setVertexDescriptorFromCurrentState(MTLRenderPipelineDescript
 				if (va.enable == GL_TRUE) {
 					// 頂点バッファ用の設定
 					pipelineDesc.vertexDescriptor.attributes[metal_index].format = vertex_format;
-					pipelineDesc.vertexDescriptor.attributes[metal_index].offset = (NSUInteger)((uintptr_t)va.pointer);
+					// NOTE: フォーマット変換したバッファは属性のオフセットを含めて変換済み
+					NSUInteger attrib_offset = needVertexFormatConversion(va.type, va.normalized) ? 0 : (NSUInteger)((uintptr_t)va.pointer);
+					pipelineDesc.vertexDescriptor.attributes[metal_index].offset = attrib_offset;
 					pipelineDesc.vertexDescriptor.attributes[metal_index].bufferIndex = vb_index;
 					pipelineDesc.vertexDescriptor.layouts[vb_index].stride = adjustedStride[i];
 					if (isInstanced && (va.divisor != 0)) {
@@ -2657,7 +4221,8 @@ void ContextMetal::setVertexDescriptorFromVAO(MTLRenderPipelineDescriptor* pipel
 				if (ap.enabled == GL_TRUE) {
 					// 頂点バッファ用の設定
 					pipelineDesc.vertexDescriptor.attributes[metal_index].format = ap.format;
-					pipelineDesc.vertexDescriptor.attributes[metal_index].offset = ap.offset;
+					// NOTE: フォーマット変換したバッファは属性のオフセットを含めて変換済み
+					pipelineDesc.vertexDescriptor.attributes[metal_index].offset = ap.formatConversion ? 0 : ap.offset;
 					pipelineDesc.vertexDescriptor.attributes[metal_index].bufferIndex = vb_index;
 					pipelineDesc.vertexDescriptor.layouts[vb_index].stride = adjustedStride[i];
 					if (isInstanced && (ap.divisor != 0)) {
@@ -2701,10 +4266,104 @@ BackendBuffer::ConversionMode ContextMetal::getIboConversionMode(GLenum mode, GL
 			AXGL_ASSERT(0);
 			break;
 		}
+	} else if (mode == GL_LINE_LOOP) {
+		switch (type) {
+		case GL_UNSIGNED_BYTE:
+			conversion = BackendBuffer::ConversionModeLineLoopIndices8;
+			break;
+		case GL_UNSIGNED_SHORT:
+			conversion = BackendBuffer::ConversionModeLineLoopIndices16;
+			break;
+		case GL_UNSIGNED_INT:
+			conversion = BackendBuffer::ConversionModeLineLoopIndices32;
+			break;
+		default:
+			AXGL_ASSERT(0);
+			break;
+		}
 	}
 	return conversion;
 }
 
+// 描画に使用するインデックスバッファを取得
+BufferMetal* ContextMetal::getIndexBufferMetal(const DrawParameters* drawParams)
+{
+	AXGL_ASSERT(drawParams != nullptr);
+	BufferMetal* buffer_metal = nullptr;
+	if (drawParams->vertexArray == nullptr) {
+		// 現在のインデックスバッファ
+		if (drawParams->indexBuffer != nullptr) {
+			buffer_metal = static_cast<BufferMetal*>(drawParams->indexBuffer->getBackendBuffer());
+		}
+	} else {
+		// VAOからインデックスバッファを取得
+		CoreBuffer* index_buffer = drawParams->vertexArray->getIndexBuffer();
+		if (index_buffer != nullptr) {
+			buffer_metal = static_cast<BufferMetal*>(index_buffer->getBackendBuffer());
+		}
+	}
+	return buffer_metal;
+}
+
+// 変換後のインデックス数を取得(TriangleFan、LineLoopの描画に使用)
+uint32_t ContextMetal::getConvertedIndexCount(const DrawParameters* drawParams, const IboDynamicUpdateInfo* iboInfo)
+{
+	AXGL_ASSERT(iboInfo != nullptr);
+	if (iboInfo->clientIndices != nullptr) {
+		// クライアントメモリのインデックスは動的バッファへのコピー時に変換済み
+		return iboInfo->convertedCount;
+	}
+	BufferMetal* buffer_metal = getIndexBufferMetal(drawParams);
+	AXGL_ASSERT(buffer_metal != nullptr);
+	return buffer_metal->getConvertedIndexCount();
+}
+
+// インデックスが参照する頂点の範囲を取得
+// NOTE: 範囲を取得できない場合は引数の値を変更しない
+void ContextMetal::getVertexRangeFromIndices(const DrawParameters* drawParams, GLsizei count, GLenum type, const void* indices,
+	GLuint* startVertex, GLuint* endVertex)
+{
+	AXGL_ASSERT((startVertex != nullptr) && (endVertex != nullptr));
+	BufferMetal* buffer_metal = getIndexBufferMetal(drawParams);
+	if (buffer_metal != nullptr) {
+		// GPUによる書き込みが保留中の場合は、インデックスを走査する前に反映する
+		buffer_metal->resolveGpuWrite(this, true);
+	}
+	uint32_t min_index = 0;
+	uint32_t max_index = 0;
+	// NOTE: プリミティブリスタートが有効な場合、リスタートインデックスは範囲に含めない
+	bool primitive_restart = (drawParams->primitiveRestartFixedIndex != GL_FALSE);
+	if (buffer_metal == nullptr) {
+		// インデックスバッファがない場合、クライアントメモリのインデックスを直接走査する
+		if ((indices == nullptr) || (count <= 0)) {
+			return;
+		}
+		switch (type) {
+		case GL_UNSIGNED_BYTE:
+			scanIndexRangeU8(static_cast<const uint8_t*>(indices), count, primitive_restart, &min_index, &max_index);
+			break;
+		case GL_UNSIGNED_SHORT:
+			scanIndexRangeU16(static_cast<const uint16_t*>(indices), count, primitive_restart, &min_index, &max_index);
+			break;
+		case GL_UNSIGNED_INT:
+			scanIndexRangeU32(static_cast<const uint32_t*>(indices), count, primitive_restart, &min_index, &max_index);
+			break;
+		default:
+			return;
+		}
+		if (min_index <= max_index) {
+			*startVertex = min_index;
+			*endVertex = max_index;
+		}
+		return;
+	}
+	if (buffer_metal->getIndexRange((intptr_t)indices, count, type, primitive_restart, &min_index, &max_index) && (min_index <= max_index)) {
+		*startVertex = min_index;
+		*endVertex = max_index;
+	}
+	return;
+}
+
 // PipelineStateの使用履歴を更新する(キャッシュ制御に使用)
 bool ContextMetal::updatePipelineStateUsedOrder(const PipelineState* pipelineState)
 {
@@ -2751,6 +4410,78 @@ bool ContextMetal::updateDepthStencilStateUsedOrder(const DepthStencilState* dep
 	return same_as_last_used;
 }
 
+// プールしたMTLTextureを全て解放する
+void ContextMetal::releasePooledTextures()
+{
+	m_texturePool.clear();
+	MemoryAccounting::getInstance().update(MemoryCategoryPool, m_texturePoolStats.pooledBytes, 0);
+	m_texturePoolStats.pooledCount = 0;
+	m_texturePoolStats.pooledBytes = 0;
+	return;
+}
+
+// MTLTextureDescriptorからプールのキーを取得
+ContextMetal::TexturePoolKey ContextMetal::getTexturePoolKey(MTLTextureDescriptor* desc)
+{
+	MTLTextureSwizzleChannels swizzle = [desc swizzle];
+	TexturePoolKey key = {
+		[desc textureType], [desc pixelFormat],
+		[desc width], [desc height], [desc depth], [desc arrayLength],
+		[desc mipmapLevelCount], [desc sampleCount], [desc usage], [desc storageMode],
+		(uint32_t)swizzle.red | ((uint32_t)swizzle.green << 8) | ((uint32_t)swizzle.blue << 16) | ((uint32_t)swizzle.alpha << 24)
+	};
+	return key;
+}
+
+// MTLTextureからプールのキーを取得
+ContextMetal::TexturePoolKey ContextMetal::getTexturePoolKey(id<MTLTexture> texture)
+{
+	MTLTextureSwizzleChannels swizzle = [texture swizzle];
+	TexturePoolKey key = {
+		[texture textureType], [texture pixelFormat],
+		[texture width], [texture height], [texture depth], [texture arrayLength],
+		[texture mipmapLevelCount], [texture sampleCount], [texture usage], [texture storageMode],
+		(uint32_t)swizzle.red | ((uint32_t)swizzle.green << 8) | ((uint32_t)swizzle.blue << 16) | ((uint32_t)swizzle.alpha << 24)
+	};
+	return key;
+}
+
+// フレームバッファからのコピーで使用するMTLRenderPipelineStateを用意する(キャッシュ制御含む)
+id<MTLRenderPipelineState> ContextMetal::setupCopyPipelineState(MTLPixelFormat pixelFormat)
+{
+	auto it = m_copyPipelineStates.find(static_cast<NSUInteger>(pixelFormat));
+	if (it != m_copyPipelineStates.end()) {
+		return it->second;
+	}
+	NSError* error = nil;
+	if (m_copyLibrary == nil) {
+		// シェーダをコンパイル
+		NSString* msl = [NSString stringWithUTF8String:c_copy_texture_msl];
+		m_copyLibrary = [m_mtlDevice newLibraryWithSource:msl options:m_compileOptions error:&error];
+		if (m_copyLibrary == nil) {
+			if (error != nil) {
+				AXGL_DBGOUT([[error localizedDescription] UTF8String]);
+			}
+			return nil;
+		}
+	}
+	MTLRenderPipelineDescriptor* ps_desc = [[MTLRenderPipelineDescriptor alloc] init];
+	AXGL_ASSERT(ps_desc != nil);
+	ps_desc.vertexFunction = [m_copyLibrary newFunctionWithName:@"axgl_copy_vs"];
+	ps_desc.fragmentFunction = [m_copyLibrary newFunctionWithName:@"axgl_copy_fs"];
+	ps_desc.colorAttachments[0].pixelFormat = pixelFormat;
+	id<MTLRenderPipelineState> pipeline_state = [m_mtlDevice newRenderPipelineStateWithDescriptor:ps_desc error:&error];
+	if (pipeline_state == nil) {
+		if (error != nil) {
+			AXGL_DBGOUT([[error localizedDescription] UTF8String]);
+		}
+		return nil;
+	}
+	// キャッシュに追加
+	m_copyPipelineStates.emplace(static_cast<NSUInteger>(pixelFormat), pipeline_state);
+	return pipeline_state;
+}
+
 } // namespace axgl
 
 #endif // defined(__APPLE_CC__)
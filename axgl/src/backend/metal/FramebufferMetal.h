@@ -7,9 +7,14 @@
 
 namespace axgl {
 
+// アタッチメントのビットマスク(ビット0からカラー、続けて深度、ステンシル)
+static constexpr uint32_t c_attachment_bit_depth = 1u << AXGL_MAX_COLOR_ATTACHMENTS;
+static constexpr uint32_t c_attachment_bit_stencil = 1u << (AXGL_MAX_COLOR_ATTACHMENTS + 1);
+
 class TextureMetal;
 class RenderbufferMetal;
 class QueryMetal;
+class SubmissionSerial;
 
 class FramebufferMetal : public BackendFramebuffer
 {
@@ -23,6 +28,8 @@ public:
 		GLenum textarget, GLint level) override;
 	virtual bool setTextureLayer(BackendContext* context, GLenum attachment, BackendTexture* texture,
 		GLint level, GLint layer) override;
+	virtual void invalidate(BackendContext* context, GLsizei numAttachments, const GLenum* attachments,
+		GLint x, GLint y, GLsizei width, GLsizei height) override;
 	virtual GLenum checkStatus() const override;
 
 public:
@@ -41,12 +48,20 @@ public:
 	void getRectSize(RectSize* rectSize) const;
 	id<MTLTexture> getColorTexture(int index) const;
 	uint32_t getColorTextureLevel(int index) const;
+	uint32_t getColorTextureSlice(int index) const;
+	id<MTLTexture> getDepthTexture() const;
+	uint32_t getDepthTextureLevel() const;
+	uint32_t getDepthTextureSlice() const;
 	bool onlyOffscreenBufferAttached() const;
+	static uint32_t getAttachmentMask(MTLRenderPassDescriptor* renderPassDesc);
+	bool updateAttachmentTextures();
+	void markAttachmentsInUse(const SubmissionSerial* submissionSerial, uint64_t serial);
 
 private:
 	void setColorRenderbuffer(int index, RenderbufferMetal* renderbuffer);
 	void setColorTexture(int index, TextureMetal* texture);
 	void unsetColor(int index);
+	void applyInvalidation();
 	void setColorAttachment(int index, id<MTLTexture> tex, int level, int slice, int depthPlane,
 		MTLLoadAction loadAction, MTLStoreAction storeAction);
 	void setDepthAttachment(id<MTLTexture> tex, int level, int slice, int depthPlane,
@@ -60,16 +75,24 @@ private:
 		ObjectTypeRenderbuffer = 1,
 		ObjectTypeTexture = 2
 	};
-	struct ColorAttachInfo {
+	struct AttachInfo {
 		ObjectType type;
 		union {
 			TextureMetal* texture;
 			RenderbufferMetal* renderbuffer;
 		};
 	};
+	static void setAttachTexture(AttachInfo* info, TextureMetal* texture);
+	static void setAttachRenderbuffer(AttachInfo* info, RenderbufferMetal* renderbuffer);
+	static bool getAttachedMtlTexture(const AttachInfo& info, id<MTLTexture>* texture);
+	static void markAttachInfoInUse(const AttachInfo& info, const SubmissionSerial* submissionSerial, uint64_t serial);
 	MTLRenderPassDescriptor* m_mtlRenderPassDesc = nil;
-	ColorAttachInfo m_colorAttachInfo[AXGL_MAX_COLOR_ATTACHMENTS];
+	AttachInfo m_colorAttachInfo[AXGL_MAX_COLOR_ATTACHMENTS];
+	AttachInfo m_depthAttachInfo;
+	AttachInfo m_stencilAttachInfo;
 	bool m_renderPassModified = true;
+	// NOTE: 無効化され、次のレンダーパスでロードしないアタッチメント
+	uint32_t m_invalidatedMask = 0;
 };
 
 } // namespace axgl
@@ -35,11 +35,14 @@ FramebufferMetal::~FramebufferMetal()
 
 bool FramebufferMetal::initialize(BackendContext* context)
 {
-	// カラーのアタッチ情報をクリア
+	// アタッチ情報をクリア
 	memset(m_colorAttachInfo, 0, sizeof(m_colorAttachInfo));
+	memset(&m_depthAttachInfo, 0, sizeof(m_depthAttachInfo));
+	memset(&m_stencilAttachInfo, 0, sizeof(m_stencilAttachInfo));
 	// RenderPassDescriptorを作成
 	m_mtlRenderPassDesc = [[MTLRenderPassDescriptor alloc] init];
 	m_renderPassModified = true;
+	m_invalidatedMask = 0;
 	return (m_mtlRenderPassDesc != nil) ? true : false;
 }
 
@@ -47,8 +50,10 @@ void FramebufferMetal::terminate(BackendContext* context)
 {
 	// RenderPassDescriptorをリリース
 	m_mtlRenderPassDesc = nil;
-	// カラーのアタッチ情報をクリアしておく
+	// アタッチ情報をクリアしておく
 	memset(m_colorAttachInfo, 0, sizeof(m_colorAttachInfo));
+	memset(&m_depthAttachInfo, 0, sizeof(m_depthAttachInfo));
+	memset(&m_stencilAttachInfo, 0, sizeof(m_stencilAttachInfo));
 	return;
 }
 
@@ -76,7 +81,7 @@ bool FramebufferMetal::setRenderbuffer(BackendContext* context, GLenum attachmen
 		{
 			int index = attachment - GL_COLOR_ATTACHMENT0;
 			AXGL_ASSERT(index <= 7);
-			setColorAttachment(index, mtl_texture, 0, 0, 0, MTLLoadActionLoad, MTLStoreActionStore);
+			setColorAttachment(index, mtl_texture, 0, 0, 0, MTLLoadActionLoad, MTLStoreActionUnknown);
 			if (renderbuffer_metal == nullptr) {
 				unsetColor(index);
 			} else {
@@ -85,14 +90,18 @@ bool FramebufferMetal::setRenderbuffer(BackendContext* context, GLenum attachmen
 		}
 		break;
 	case GL_DEPTH_ATTACHMENT:
-		setDepthAttachment(mtl_texture, 0, 0, 0, MTLLoadActionLoad, MTLStoreActionStore);
+		setDepthAttachment(mtl_texture, 0, 0, 0, MTLLoadActionLoad, MTLStoreActionUnknown);
+		setAttachRenderbuffer(&m_depthAttachInfo, renderbuffer_metal);
 		break;
 	case GL_STENCIL_ATTACHMENT:
-		setStencilAttachment(mtl_texture, 0, 0, 0, MTLLoadActionLoad, MTLStoreActionStore);
+		setStencilAttachment(mtl_texture, 0, 0, 0, MTLLoadActionLoad, MTLStoreActionUnknown);
+		setAttachRenderbuffer(&m_stencilAttachInfo, renderbuffer_metal);
 		break;
 	case GL_DEPTH_STENCIL_ATTACHMENT:
-		setDepthAttachment(mtl_texture, 0, 0, 0, MTLLoadActionLoad, MTLStoreActionStore);
-		setStencilAttachment(mtl_texture, 0, 0, 0, MTLLoadActionLoad, MTLStoreActionStore);
+		setDepthAttachment(mtl_texture, 0, 0, 0, MTLLoadActionLoad, MTLStoreActionUnknown);
+		setStencilAttachment(mtl_texture, 0, 0, 0, MTLLoadActionLoad, MTLStoreActionUnknown);
+		setAttachRenderbuffer(&m_depthAttachInfo, renderbuffer_metal);
+		setAttachRenderbuffer(&m_stencilAttachInfo, renderbuffer_metal);
 		break;
 	default:
 		AXGL_ASSERT(0);
@@ -100,6 +109,8 @@ bool FramebufferMetal::setRenderbuffer(BackendContext* context, GLenum attachmen
 	}
 	// 変更ありに設定
 	m_renderPassModified = true;
+	// NOTE: アタッチメントが変わった場合は無効化を取り消す
+	m_invalidatedMask = 0;
 	return true;
 }
 
@@ -135,7 +146,7 @@ bool FramebufferMetal::setTexture2d(BackendContext* context, GLenum attachment,
 		{
 			int index = attachment - GL_COLOR_ATTACHMENT0;
 			AXGL_ASSERT(index <= 7);
-			setColorAttachment(index, mtl_texture, level, slice, 0, MTLLoadActionLoad, MTLStoreActionStore);
+			setColorAttachment(index, mtl_texture, level, slice, 0, MTLLoadActionLoad, MTLStoreActionUnknown);
 			if (texture_metal == nullptr) {
 				unsetColor(index);
 			} else {
@@ -144,14 +155,18 @@ bool FramebufferMetal::setTexture2d(BackendContext* context, GLenum attachment,
 		}
 		break;
 	case GL_DEPTH_ATTACHMENT:
-		setDepthAttachment(mtl_texture, level, slice, 0, MTLLoadActionLoad, MTLStoreActionStore);
+		setDepthAttachment(mtl_texture, level, slice, 0, MTLLoadActionLoad, MTLStoreActionUnknown);
+		setAttachTexture(&m_depthAttachInfo, texture_metal);
 		break;
 	case GL_STENCIL_ATTACHMENT:
-		setStencilAttachment(mtl_texture, level, slice, 0, MTLLoadActionLoad, MTLStoreActionStore);
+		setStencilAttachment(mtl_texture, level, slice, 0, MTLLoadActionLoad, MTLStoreActionUnknown);
+		setAttachTexture(&m_stencilAttachInfo, texture_metal);
 		break;
 	case GL_DEPTH_STENCIL_ATTACHMENT:
-		setDepthAttachment(mtl_texture, level, slice, 0, MTLLoadActionLoad, MTLStoreActionStore);
-		setStencilAttachment(mtl_texture, level, slice, 0, MTLLoadActionLoad, MTLStoreActionStore);
+		setDepthAttachment(mtl_texture, level, slice, 0, MTLLoadActionLoad, MTLStoreActionUnknown);
+		setStencilAttachment(mtl_texture, level, slice, 0, MTLLoadActionLoad, MTLStoreActionUnknown);
+		setAttachTexture(&m_depthAttachInfo, texture_metal);
+		setAttachTexture(&m_stencilAttachInfo, texture_metal);
 		break;
 	default:
 		AXGL_ASSERT(0);
@@ -159,6 +174,8 @@ bool FramebufferMetal::setTexture2d(BackendContext* context, GLenum attachment,
 	}
 	// 変更ありに設定
 	m_renderPassModified = true;
+	// NOTE: アタッチメントが変わった場合は無効化を取り消す
+	m_invalidatedMask = 0;
 	return true;
 }
 
@@ -187,7 +204,7 @@ bool FramebufferMetal::setTextureLayer(BackendContext* context, GLenum attachmen
 		{
 			int index = attachment - GL_COLOR_ATTACHMENT0;
 			AXGL_ASSERT(index <= 7);
-			setColorAttachment(index, mtl_texture, level, 0, layer, MTLLoadActionLoad, MTLStoreActionStore);
+			setColorAttachment(index, mtl_texture, level, 0, layer, MTLLoadActionLoad, MTLStoreActionUnknown);
 			if (texture_metal == nullptr) {
 				unsetColor(index);
 			} else {
@@ -196,14 +213,18 @@ bool FramebufferMetal::setTextureLayer(BackendContext* context, GLenum attachmen
 		}
 		break;
 	case GL_DEPTH_ATTACHMENT:
-		setDepthAttachment(mtl_texture, level, 0, layer, MTLLoadActionLoad, MTLStoreActionStore);
+		setDepthAttachment(mtl_texture, level, 0, layer, MTLLoadActionLoad, MTLStoreActionUnknown);
+		setAttachTexture(&m_depthAttachInfo, texture_metal);
 		break;
 	case GL_STENCIL_ATTACHMENT:
-		setStencilAttachment(mtl_texture, level, 0, layer, MTLLoadActionLoad, MTLStoreActionStore);
+		setStencilAttachment(mtl_texture, level, 0, layer, MTLLoadActionLoad, MTLStoreActionUnknown);
+		setAttachTexture(&m_stencilAttachInfo, texture_metal);
 		break;
 	case GL_DEPTH_STENCIL_ATTACHMENT:
-		setDepthAttachment(mtl_texture, level, 0, layer, MTLLoadActionLoad, MTLStoreActionStore);
-		setStencilAttachment(mtl_texture, level, 0, layer, MTLLoadActionLoad, MTLStoreActionStore);
+		setDepthAttachment(mtl_texture, level, 0, layer, MTLLoadActionLoad, MTLStoreActionUnknown);
+		setStencilAttachment(mtl_texture, level, 0, layer, MTLLoadActionLoad, MTLStoreActionUnknown);
+		setAttachTexture(&m_depthAttachInfo, texture_metal);
+		setAttachTexture(&m_stencilAttachInfo, texture_metal);
 		break;
 	default:
 		AXGL_ASSERT(0);
@@ -211,9 +232,53 @@ bool FramebufferMetal::setTextureLayer(BackendContext* context, GLenum attachmen
 	}
 	// 変更ありに設定
 	m_renderPassModified = true;
+	// NOTE: アタッチメントが変わった場合は無効化を取り消す
+	m_invalidatedMask = 0;
 	return true;
 }
 
+// アタッチメントの内容を無効化する(glInvalidateFramebuffer相当)
+// NOTE: 次のレンダーパスではロードせず、記録中のレンダーパスでは以降に描画がなければストアしない
+void FramebufferMetal::invalidate(BackendContext* context, GLsizei numAttachments, const GLenum* attachments,
+	GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if ((m_mtlRenderPassDesc == nil) || (attachments == nullptr)) {
+		return;
+	}
+	// NOTE: 一部の領域のみの無効化は、ロードとストアを省略できないため無視する
+	RectSize rect_size;
+	getRectSize(&rect_size);
+	if ((x > 0) || (y > 0)
+		|| ((static_cast<int64_t>(x) + width) < static_cast<int64_t>(rect_size.width))
+		|| ((static_cast<int64_t>(y) + height) < static_cast<int64_t>(rect_size.height))) {
+		return;
+	}
+	uint32_t mask = 0;
+	for (GLsizei i = 0; i < numAttachments; i++) {
+		GLenum attachment = attachments[i];
+		if ((attachment >= GL_COLOR_ATTACHMENT0) && (attachment < (GL_COLOR_ATTACHMENT0 + AXGL_MAX_COLOR_ATTACHMENTS))) {
+			mask |= 1u << (attachment - GL_COLOR_ATTACHMENT0);
+		} else if (attachment == GL_DEPTH_ATTACHMENT) {
+			mask |= c_attachment_bit_depth;
+		} else if (attachment == GL_STENCIL_ATTACHMENT) {
+			mask |= c_attachment_bit_stencil;
+		} else if (attachment == GL_DEPTH_STENCIL_ATTACHMENT) {
+			mask |= c_attachment_bit_depth | c_attachment_bit_stencil;
+		}
+	}
+	// 存在するアタッチメントのみを対象とする
+	mask &= getAttachmentMask(m_mtlRenderPassDesc);
+	if (mask == 0) {
+		return;
+	}
+	m_invalidatedMask |= mask;
+	ContextMetal* mtl_context = static_cast<ContextMetal*>(context);
+	if (mtl_context != nullptr) {
+		mtl_context->invalidateRenderPassAttachments(this, mask);
+	}
+	return;
+}
+
 GLenum FramebufferMetal::checkStatus() const
 {
 	if (m_mtlRenderPassDesc == nil) {
@@ -254,6 +319,10 @@ bool FramebufferMetal::setupRenderPassDescriptor(QueryMetal* query, GLbitfield c
 	MTLClearColor mtl_clear_color = MTLClearColorMake((double)src[0], (double)src[1], (double)src[2], (double)src[3]);
 	// クリアが指定されていたら、エンコーディングの区切りとしてmodifiedで処理
 	bool modified = m_renderPassModified || (clearBits != 0);
+	// ストレージが再指定されたアタッチメントのMTLTextureを設定し直す
+	if (updateAttachmentTextures()) {
+		modified = true;
+	}
 	// カラーアタッチメント
 	MTLLoadAction load_action = ((clearBits & GL_COLOR_BUFFER_BIT) != 0) ? MTLLoadActionClear : MTLLoadActionLoad;
 	for (int i = 0; i < AXGL_MAX_COLOR_ATTACHMENTS; i++) {
@@ -287,6 +356,8 @@ bool FramebufferMetal::setupRenderPassDescriptor(QueryMetal* query, GLbitfield c
 		m_mtlRenderPassDesc.visibilityResultBuffer = vr_buffer;
 		modified = true;
 	}
+	// 無効化されたアタッチメントはロードしない
+	applyInvalidation();
 	// 変更なしにクリア
 	m_renderPassModified = false;
 	return modified;
@@ -295,6 +366,8 @@ bool FramebufferMetal::setupRenderPassDescriptor(QueryMetal* query, GLbitfield c
 bool FramebufferMetal::setupRenderPassDescriptorForClearI(GLenum buffer, GLint drawbuffer, const GLint* value)
 {
 	AXGL_ASSERT(value != nullptr);
+	// ストレージが再指定されたアタッチメントのMTLTextureを設定し直す
+	updateAttachmentTextures();
 	if (buffer == GL_COLOR) {
 		// クリアカラー
 		MTLClearColor mtl_clear_color = MTLClearColorMake((double)value[0], (double)value[1], (double)value[2], (double)value[3]);
@@ -334,6 +407,8 @@ bool FramebufferMetal::setupRenderPassDescriptorForClearI(GLenum buffer, GLint d
 	m_mtlRenderPassDesc.depthAttachment.loadAction = MTLLoadActionLoad;
 	// VisibilityResultBuffer
 	m_mtlRenderPassDesc.visibilityResultBuffer = nil;
+	// 無効化されたアタッチメントはロードしない
+	applyInvalidation();
 	// 変更なしにクリア
 	m_renderPassModified = false;
 	// 機能的にエンコードを分割して実行せざるを得ないため、変更ありとして返す
@@ -344,6 +419,8 @@ bool FramebufferMetal::setupRenderPassDescriptorForClearUI(GLenum buffer, GLint
 {
 	AXGL_ASSERT(value != nullptr);
 	AXGL_ASSERT(buffer == GL_COLOR); // カラーしか有り得ない
+	// ストレージが再指定されたアタッチメントのMTLTextureを設定し直す
+	updateAttachmentTextures();
 	// クリアカラー
 	MTLClearColor mtl_clear_color = MTLClearColorMake((double)value[0], (double)value[1], (double)value[2], (double)value[3]);
 	// カラーアタッチメント
@@ -365,6 +442,8 @@ bool FramebufferMetal::setupRenderPassDescriptorForClearUI(GLenum buffer, GLint
 	m_mtlRenderPassDesc.stencilAttachment.loadAction = MTLLoadActionLoad;
 	// VisibilityResultBuffer
 	m_mtlRenderPassDesc.visibilityResultBuffer = nil;
+	// 無効化されたアタッチメントはロードしない
+	applyInvalidation();
 	// 変更なしにクリア
 	m_renderPassModified = false;
 	// 機能的にエンコードを分割して実行せざるを得ないため、変更ありとして返す
@@ -374,6 +453,8 @@ bool FramebufferMetal::setupRenderPassDescriptorForClearUI(GLenum buffer, GLint
 bool FramebufferMetal::setupRenderPassDescriptorForClearF(GLenum buffer, GLint drawbuffer, const GLfloat* value)
 {
 	AXGL_ASSERT(value != nullptr);
+	// ストレージが再指定されたアタッチメントのMTLTextureを設定し直す
+	updateAttachmentTextures();
 
 	if (buffer == GL_COLOR) {
 		// クリアカラー
@@ -414,6 +495,8 @@ bool FramebufferMetal::setupRenderPassDescriptorForClearF(GLenum buffer, GLint d
 	m_mtlRenderPassDesc.stencilAttachment.loadAction = MTLLoadActionLoad;
 	// VisibilityResultBuffer
 	m_mtlRenderPassDesc.visibilityResultBuffer = nil;
+	// 無効化されたアタッチメントはロードしない
+	applyInvalidation();
 	// 変更なしにクリア
 	m_renderPassModified = false;
 	// 機能的にエンコードを分割して実行せざるを得ないため、変更ありとして返す
@@ -423,6 +506,8 @@ bool FramebufferMetal::setupRenderPassDescriptorForClearF(GLenum buffer, GLint d
 bool FramebufferMetal::setupRenderPassDescriptorForClearFI(GLenum buffer, GLint drawbuffer, GLfloat depth, GLint stencil)
 {
 	AXGL_ASSERT((buffer == GL_DEPTH_STENCIL) && (drawbuffer == 0)); // 深度とステンシルのみ
+	// ストレージが再指定されたアタッチメントのMTLTextureを設定し直す
+	updateAttachmentTextures();
 	// カラーアタッチメント
 	for (int i = 0; i < AXGL_MAX_COLOR_ATTACHMENTS; i++) {
 		if (m_colorAttachInfo[i].type == ObjectTypeRenderbuffer) {
@@ -443,6 +528,8 @@ bool FramebufferMetal::setupRenderPassDescriptorForClearFI(GLenum buffer, GLint
 	m_mtlRenderPassDesc.stencilAttachment.clearStencil = (uint32_t)stencil;
 	// VisibilityResultBuffer
 	m_mtlRenderPassDesc.visibilityResultBuffer = nil;
+	// 無効化されたアタッチメントはロードしない
+	applyInvalidation();
 	// 変更なしにクリア
 	m_renderPassModified = false;
 	// 機能的にエンコードを分割して実行せざるを得ないため、変更ありとして返す
@@ -538,6 +625,63 @@ uint32_t FramebufferMetal::getColorTextureLevel(int index) const
 	return level;
 }
 
+uint32_t FramebufferMetal::getColorTextureSlice(int index) const
+{
+	if ((m_mtlRenderPassDesc == nil) || (index >= AXGL_MAX_COLOR_ATTACHMENTS)) {
+		return 0;
+	}
+	uint32_t slice = (uint32_t)m_mtlRenderPassDesc.colorAttachments[index].slice;
+	return slice;
+}
+
+id<MTLTexture> FramebufferMetal::getDepthTexture() const
+{
+	if (m_mtlRenderPassDesc == nil) {
+		return nil;
+	}
+	id<MTLTexture> mtl_texture = m_mtlRenderPassDesc.depthAttachment.texture;
+	return mtl_texture;
+}
+
+uint32_t FramebufferMetal::getDepthTextureLevel() const
+{
+	if (m_mtlRenderPassDesc == nil) {
+		return 0;
+	}
+	uint32_t level = (uint32_t)m_mtlRenderPassDesc.depthAttachment.level;
+	return level;
+}
+
+uint32_t FramebufferMetal::getDepthTextureSlice() const
+{
+	if (m_mtlRenderPassDesc == nil) {
+		return 0;
+	}
+	uint32_t slice = (uint32_t)m_mtlRenderPassDesc.depthAttachment.slice;
+	return slice;
+}
+
+// テクスチャが設定されているアタッチメントのビットマスクを取得
+uint32_t FramebufferMetal::getAttachmentMask(MTLRenderPassDescriptor* renderPassDesc)
+{
+	uint32_t mask = 0;
+	if (renderPassDesc == nil) {
+		return mask;
+	}
+	for (int i = 0; i < AXGL_MAX_COLOR_ATTACHMENTS; i++) {
+		if (renderPassDesc.colorAttachments[i].texture != nil) {
+			mask |= 1u << i;
+		}
+	}
+	if (renderPassDesc.depthAttachment.texture != nil) {
+		mask |= c_attachment_bit_depth;
+	}
+	if (renderPassDesc.stencilAttachment.texture != nil) {
+		mask |= c_attachment_bit_stencil;
+	}
+	return mask;
+}
+
 bool FramebufferMetal::onlyOffscreenBufferAttached() const
 {
 	bool is_onscreen = false;
@@ -555,6 +699,43 @@ bool FramebufferMetal::onlyOffscreenBufferAttached() const
 	return !is_onscreen;
 }
 
+// アタッチしたテクスチャ、レンダーバッファのMTLTextureが変わっていれば設定し直す
+// NOTE: ストレージの再指定で作り直された場合、古いMTLTextureはプールで別のオブジェクトに再利用される
+bool FramebufferMetal::updateAttachmentTextures()
+{
+	if (m_mtlRenderPassDesc == nil) {
+		return false;
+	}
+	bool modified = false;
+	id<MTLTexture> mtl_tex = nil;
+	for (int i = 0; i < AXGL_MAX_COLOR_ATTACHMENTS; i++) {
+		if (getAttachedMtlTexture(m_colorAttachInfo[i], &mtl_tex) && (m_mtlRenderPassDesc.colorAttachments[i].texture != mtl_tex)) {
+			m_mtlRenderPassDesc.colorAttachments[i].texture = mtl_tex;
+			modified = true;
+		}
+	}
+	if (getAttachedMtlTexture(m_depthAttachInfo, &mtl_tex) && (m_mtlRenderPassDesc.depthAttachment.texture != mtl_tex)) {
+		m_mtlRenderPassDesc.depthAttachment.texture = mtl_tex;
+		modified = true;
+	}
+	if (getAttachedMtlTexture(m_stencilAttachInfo, &mtl_tex) && (m_mtlRenderPassDesc.stencilAttachment.texture != mtl_tex)) {
+		m_mtlRenderPassDesc.stencilAttachment.texture = mtl_tex;
+		modified = true;
+	}
+	return modified;
+}
+
+// アタッチしたテクスチャ、レンダーバッファに、記録中のサブミッションのシリアルを設定する
+void FramebufferMetal::markAttachmentsInUse(const SubmissionSerial* submissionSerial, uint64_t serial)
+{
+	for (int i = 0; i < AXGL_MAX_COLOR_ATTACHMENTS; i++) {
+		markAttachInfoInUse(m_colorAttachInfo[i], submissionSerial, serial);
+	}
+	markAttachInfoInUse(m_depthAttachInfo, submissionSerial, serial);
+	markAttachInfoInUse(m_stencilAttachInfo, submissionSerial, serial);
+	return;
+}
+
 void FramebufferMetal::setColorRenderbuffer(int index, RenderbufferMetal* renderbuffer)
 {
 	if (index >= AXGL_MAX_COLOR_ATTACHMENTS) {
@@ -585,6 +766,71 @@ void FramebufferMetal::unsetColor(int index)
 	return;
 }
 
+void FramebufferMetal::setAttachTexture(AttachInfo* info, TextureMetal* texture)
+{
+	AXGL_ASSERT(info != nullptr);
+	info->type = (texture != nullptr) ? ObjectTypeTexture : ObjectTypeNone;
+	info->texture = texture;
+	return;
+}
+
+void FramebufferMetal::setAttachRenderbuffer(AttachInfo* info, RenderbufferMetal* renderbuffer)
+{
+	AXGL_ASSERT(info != nullptr);
+	info->type = (renderbuffer != nullptr) ? ObjectTypeRenderbuffer : ObjectTypeNone;
+	info->renderbuffer = renderbuffer;
+	return;
+}
+
+// アタッチしたオブジェクトの現在のMTLTextureを取得(CAMetalLayerのレンダーバッファは対象外)
+bool FramebufferMetal::getAttachedMtlTexture(const AttachInfo& info, id<MTLTexture>* texture)
+{
+	AXGL_ASSERT(texture != nullptr);
+	if ((info.type == ObjectTypeTexture) && (info.texture != nullptr)) {
+		*texture = info.texture->getMtlTexture();
+		return true;
+	}
+	if ((info.type == ObjectTypeRenderbuffer) && (info.renderbuffer != nullptr) && !info.renderbuffer->isLayerStorage()) {
+		*texture = info.renderbuffer->getMtlTexture();
+		return true;
+	}
+	return false;
+}
+
+void FramebufferMetal::markAttachInfoInUse(const AttachInfo& info, const SubmissionSerial* submissionSerial, uint64_t serial)
+{
+	if ((info.type == ObjectTypeTexture) && (info.texture != nullptr)) {
+		info.texture->setLastUsedSerial(submissionSerial, serial);
+	} else if ((info.type == ObjectTypeRenderbuffer) && (info.renderbuffer != nullptr)) {
+		info.renderbuffer->setLastUsedSerial(submissionSerial, serial);
+	}
+	return;
+}
+
+// 無効化されたアタッチメントのロードアクションをMTLLoadActionDontCareにする
+// NOTE: クリアする場合はクリアを優先する
+void FramebufferMetal::applyInvalidation()
+{
+	if (m_invalidatedMask == 0) {
+		return;
+	}
+	for (int i = 0; i < AXGL_MAX_COLOR_ATTACHMENTS; i++) {
+		if (((m_invalidatedMask & (1u << i)) != 0) && (m_mtlRenderPassDesc.colorAttachments[i].loadAction == MTLLoadActionLoad)) {
+			m_mtlRenderPassDesc.colorAttachments[i].loadAction = MTLLoadActionDontCare;
+		}
+	}
+	if (((m_invalidatedMask & c_attachment_bit_depth) != 0) && (m_mtlRenderPassDesc.depthAttachment.loadAction == MTLLoadActionLoad)) {
+		m_mtlRenderPassDesc.depthAttachment.loadAction = MTLLoadActionDontCare;
+	}
+	if (((m_invalidatedMask & c_attachment_bit_stencil) != 0) && (m_mtlRenderPassDesc.stencilAttachment.loadAction == MTLLoadActionLoad)) {
+		m_mtlRenderPassDesc.stencilAttachment.loadAction = MTLLoadActionDontCare;
+	}
+	// NOTE: 無効化後のレンダーパスの描画で内容が定義されるため、1回のみ適用する
+	m_invalidatedMask = 0;
+	return;
+}
+
+// NOTE: ストアアクションはMTLStoreActionUnknownを指定し、エンコード終了時に決定する(ContextMetal::endRenderCommandEncoder)
 void FramebufferMetal::setColorAttachment(int index, id<MTLTexture> tex, int level, int slice, int depthPlane,
 	MTLLoadAction loadAction, MTLStoreAction storeAction)
 {
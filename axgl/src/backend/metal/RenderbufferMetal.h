@@ -8,6 +8,7 @@
 namespace axgl {
 
 class ContextMetal;
+class SubmissionSerial;
 
 class RenderbufferMetal : public BackendRenderbuffer
 {
@@ -20,6 +21,7 @@ public:
 	virtual bool createStorageMultisample(BackendContext* context, GLsizei samples,
 		GLenum internalformat, GLsizei width, GLsizei height) override;
 	virtual void getStorageInformation(GLenum* format, GLsizei* width, GLsizei* height, GLsizei* samples) override;
+	virtual size_t getMemorySize() const override;
 
 public:
 	bool setStorageFromLayer(ContextMetal* context, CAMetalLayer* layer);
@@ -29,9 +31,10 @@ public:
 	id<CAMetalDrawable> getCurrentDrawable() const;
 	id<MTLTexture> getMtlTextureFromDrawable() const;
 	bool isLayerStorage() const;
+	void setLastUsedSerial(const SubmissionSerial* submissionSerial, uint64_t serial);
 
 private:
-	void releaseTexture();
+	void releaseTexture(ContextMetal* context);
 	void releaseLayer();
 
 private:
@@ -39,6 +42,10 @@ private:
 	id<MTLTexture> m_mtlTexture = nil;
 	CAMetalLayer* m_layer = nil;
 	id<CAMetalDrawable> m_currentDrawable = nil;
+	// NOTE: 最後に描画、転送で参照したサブミッションのシリアル
+	uint64_t m_lastUsedSerial = 0;
+	// NOTE: m_lastUsedSerialを発行したコンテキストのシリアル(比較のみに使用し、参照はしない)
+	const SubmissionSerial* m_lastUsedSerialSource = nullptr;
 };
 
 } // namespace axgl
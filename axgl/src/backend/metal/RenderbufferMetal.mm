@@ -43,6 +43,10 @@ bool RenderbufferMetal::initialize(BackendContext* context)
 
 void RenderbufferMetal::terminate(BackendContext* context)
 {
+	if ((context != nullptr) && (m_layer == nil)) {
+		// 最後に使用したサブミッションの完了後に再利用させる
+		releaseTexture(static_cast<ContextMetal*>(context));
+	}
 	m_layer = nil;
 	m_currentDrawable = nil;
 	m_mtlTexture = nil;
@@ -66,9 +70,11 @@ bool RenderbufferMetal::createStorage(BackendContext* context, GLenum internalfo
 	[m_mtlTextureDesc setStorageMode:storage_mode];
 	[m_mtlTextureDesc setSampleCount:1];
 	// MTLTextureを作成
+	// NOTE: 削除されたテクスチャ、レンダーバッファの同じ構成のストレージがあれば再利用する
 	ContextMetal* mtl_context = reinterpret_cast<ContextMetal*>(context);
-	id<MTLDevice> mtl_device = mtl_context->getDevice();
-	m_mtlTexture = [mtl_device newTextureWithDescriptor:m_mtlTextureDesc];
+	// ストレージを再指定する場合は、古いMTLTextureを最後に使用したサブミッションの完了後に再利用させる
+	releaseTexture(mtl_context);
+	m_mtlTexture = mtl_context->newPooledTexture(m_mtlTextureDesc);
 	if (m_mtlTexture == nil) {
 		return false;
 	}
@@ -91,9 +97,11 @@ bool RenderbufferMetal::createStorageMultisample(BackendContext* context, GLsize
 	[m_mtlTextureDesc setStorageMode:storage_mode];
 	[m_mtlTextureDesc setSampleCount:samples];
 	// MTLTextureを作成
+	// NOTE: 削除されたテクスチャ、レンダーバッファの同じ構成のストレージがあれば再利用する
 	ContextMetal* mtl_context = reinterpret_cast<ContextMetal*>(context);
-	id<MTLDevice> mtl_device = mtl_context->getDevice();
-	m_mtlTexture = [mtl_device newTextureWithDescriptor:m_mtlTextureDesc];
+	// ストレージを再指定する場合は、古いMTLTextureを最後に使用したサブミッションの完了後に再利用させる
+	releaseTexture(mtl_context);
+	m_mtlTexture = mtl_context->newPooledTexture(m_mtlTextureDesc);
 	if (m_mtlTexture == nil) {
 		return false;
 	}
@@ -127,13 +135,22 @@ void RenderbufferMetal::getStorageInformation(GLenum* format, GLsizei* width, GL
 	return;
 }
 
+size_t RenderbufferMetal::getMemorySize() const
+{
+	// NOTE: CAMetalLayerのDrawableはレイヤーが所有するため含めない
+	if ((m_layer != nil) || (m_mtlTexture == nil)) {
+		return 0;
+	}
+	return [m_mtlTexture allocatedSize];
+}
+
 bool RenderbufferMetal::setStorageFromLayer(ContextMetal* context, CAMetalLayer* layer)
 {
 	if ((context == nil) || (layer == nil)) {
 		return false;
 	}
 	// テクスチャをリリース
-	releaseTexture();
+	releaseTexture(context);
 	// CAMetalLayerを保持
 	m_layer = layer;
 	// Drawableを取得
@@ -184,12 +201,26 @@ bool RenderbufferMetal::isLayerStorage() const
 	return (m_layer != nil);
 }
 
-void RenderbufferMetal::releaseTexture()
+void RenderbufferMetal::setLastUsedSerial(const SubmissionSerial* submissionSerial, uint64_t serial)
 {
+	m_lastUsedSerial = serial;
+	m_lastUsedSerialSource = submissionSerial;
+	return;
+}
+
+void RenderbufferMetal::releaseTexture(ContextMetal* context)
+{
+	AXGL_ASSERT(context != nullptr);
 	// MTLTextureをリリース
 	if (m_mtlTexture != nil) {
+		// NOTE: 他のコンテキストが最後に使用した場合は、再利用できる時期を判定できないため返却しない(ARCによって破棄させる)
+		if ((m_lastUsedSerial == 0) || (m_lastUsedSerialSource == &context->getSubmissionSerial())) {
+			context->recycleTexture(m_mtlTexture, m_lastUsedSerial);
+		}
 		m_mtlTexture = nil;
 	}
+	m_lastUsedSerial = 0;
+	m_lastUsedSerialSource = nullptr;
 	return;
 }
 
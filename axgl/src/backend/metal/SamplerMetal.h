@@ -3,11 +3,71 @@
 #define __SamplerMetal_h_
 #include "BackendMetal.h"
 #include "../BackendSampler.h"
+#include "../../AXGLAllocatorImpl.h"
+#include <mutex>
+#include <unordered_map>
 
 namespace axgl {
 
 class ContextMetal;
 
+// 同じ設定のMTLSamplerStateを共有するキャッシュ(全コンテキストで共通)
+// NOTE: エントリは参照カウントで管理し、参照がなくなった時点で破棄する
+class SamplerStateCache
+{
+public:
+	// 正規化したMTLSamplerDescriptorの設定
+	struct Key {
+		uintptr_t device;
+		MTLSamplerAddressMode sAddressMode;
+		MTLSamplerAddressMode tAddressMode;
+		MTLSamplerAddressMode rAddressMode;
+		MTLSamplerMinMagFilter magFilter;
+		MTLSamplerMinMagFilter minFilter;
+		MTLSamplerMipFilter mipFilter;
+		MTLCompareFunction compareFunction;
+		float lodMinClamp;
+		float lodMaxClamp;
+		bool operator==(const Key& rhs) const {
+			return (device == rhs.device)
+				&& (sAddressMode == rhs.sAddressMode) && (tAddressMode == rhs.tAddressMode) && (rAddressMode == rhs.rAddressMode)
+				&& (magFilter == rhs.magFilter) && (minFilter == rhs.minFilter) && (mipFilter == rhs.mipFilter)
+				&& (compareFunction == rhs.compareFunction)
+				&& (lodMinClamp == rhs.lodMinClamp) && (lodMaxClamp == rhs.lodMaxClamp);
+		}
+		struct Hash {
+			size_t operator()(const Key& key) const;
+		};
+	};
+	struct Entry {
+		Key key;
+		id<MTLSamplerState> samplerState;
+		// NOTE: エントリ毎に一意な値(0は無効)、描画時のバインディングの比較に使用する
+		uint64_t handle;
+		uint32_t refCount;
+	};
+
+public:
+	static SamplerStateCache& getInstance();
+	// パラメータに対応するエントリを取得(ない場合は作成)して参照カウントを加算
+	Entry* acquire(id<MTLDevice> device, const BackendSampler::SamplerParameters& params);
+	// 参照カウントを減算
+	void release(Entry* entry);
+	// エントリ数を取得
+	size_t getNumEntries() const;
+
+private:
+	using EntryMap = std::unordered_map<Key, Entry*, Key::Hash, std::equal_to<Key>, AXGLStlAllocator<std::pair<const Key, Entry*>>>;
+	SamplerStateCache();
+	~SamplerStateCache();
+	static Key makeKey(id<MTLDevice> device, const BackendSampler::SamplerParameters& params);
+
+private:
+	mutable std::mutex m_mutex;
+	EntryMap m_entries;
+	uint64_t m_nextHandle = 1;
+};
+
 class SamplerMetal : public BackendSampler
 {
 public:
@@ -19,13 +79,13 @@ public:
 
 public:
 	id<MTLSamplerState> getMtlSamplerState() const;
-	MTLSamplerDescriptor* getMtlSamplerDescriptor() const;
+	uint64_t getSamplerHandle() const;
 	bool isDirty() const;
 	void clearDirty();
 
 private:
-	MTLSamplerDescriptor* m_pSamplerDesc = nil;
-	id<MTLSamplerState> m_samplerState = nil;
+	// NOTE: SamplerStateCacheのエントリ(同じ設定のサンプラで共有)
+	SamplerStateCache::Entry* m_cacheEntry = nullptr;
 	bool m_dirty = false;
 };
 
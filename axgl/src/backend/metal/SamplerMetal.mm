@@ -2,6 +2,10 @@
 #include "SamplerMetal.h"
 #include "ContextMetal.h"
 #include "../../AXGLAllocatorImpl.h"
+#include "../../common/axglCommon.h"
+
+#include <algorithm>
+#include <cfloat>
 
 namespace axgl {
 
@@ -131,25 +135,151 @@ static MTLCompareFunction convert_compare_function(GLenum mode, GLenum func)
 	return rval;
 }
 
+// SamplerStateCacheクラスの実装 --------
+static size_t float_bits(float value)
+{
+	uint32_t bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+	return static_cast<size_t>(bits);
+}
+
+size_t SamplerStateCache::Key::Hash::operator()(const Key& key) const
+{
+	size_t h = std::hash<uintptr_t>()(key.device);
+	combineHash(&h, static_cast<size_t>(key.sAddressMode));
+	combineHash(&h, static_cast<size_t>(key.tAddressMode));
+	combineHash(&h, static_cast<size_t>(key.rAddressMode));
+	combineHash(&h, static_cast<size_t>(key.magFilter));
+	combineHash(&h, static_cast<size_t>(key.minFilter));
+	combineHash(&h, static_cast<size_t>(key.mipFilter));
+	combineHash(&h, static_cast<size_t>(key.compareFunction));
+	combineHash(&h, float_bits(key.lodMinClamp));
+	combineHash(&h, float_bits(key.lodMaxClamp));
+	return h;
+}
+
+SamplerStateCache::SamplerStateCache()
+{
+}
+
+SamplerStateCache::~SamplerStateCache()
+{
+	// NOTE: 終了時に参照が残っているエントリも破棄する
+	for (auto& it : m_entries) {
+		AXGL_DELETE(it.second);
+	}
+	m_entries.clear();
+}
+
+SamplerStateCache& SamplerStateCache::getInstance()
+{
+	static SamplerStateCache s_instance;
+	return s_instance;
+}
+
+// パラメータをMetalの設定に変換して正規化する
+SamplerStateCache::Key SamplerStateCache::makeKey(id<MTLDevice> device, const BackendSampler::SamplerParameters& params)
+{
+	Key key;
+	key.device = reinterpret_cast<uintptr_t>((__bridge void*)device);
+	key.sAddressMode = convert_address_mode(params.wrapS);
+	key.tAddressMode = convert_address_mode(params.wrapT);
+	key.rAddressMode = convert_address_mode(params.wrapR);
+	key.magFilter = convert_mag_filter(params.magFilter);
+	key.minFilter = convert_min_filter(params.minFilter);
+	key.mipFilter = convert_mip_filter(params.minFilter);
+	key.compareFunction = convert_compare_function(params.compareMode, params.compareFunc);
+	if (key.mipFilter == MTLSamplerMipFilterNotMipmapped) {
+		// ミップマップを使用しない場合、LODの範囲は結果に影響しないため既定値にまとめる
+		key.lodMinClamp = 0.0f;
+		key.lodMaxClamp = FLT_MAX;
+	} else {
+		// NOTE: Metalでは負のLODは0と同じ(GLの既定値-1000もここで0になる)
+		key.lodMinClamp = std::max(0.0f, params.minLod);
+		key.lodMaxClamp = std::max(key.lodMinClamp, params.maxLod);
+	}
+	return key;
+}
+
+SamplerStateCache::Entry* SamplerStateCache::acquire(id<MTLDevice> device, const BackendSampler::SamplerParameters& params)
+{
+	AXGL_ASSERT(device != nil);
+	Key key = makeKey(device, params);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.find(key);
+	if (it != m_entries.end()) {
+		it->second->refCount++;
+		return it->second;
+	}
+	// 新しいMTLSamplerStateを作成
+	MTLSamplerDescriptor* desc = [[MTLSamplerDescriptor alloc] init];
+	desc.sAddressMode = key.sAddressMode;
+	desc.tAddressMode = key.tAddressMode;
+	desc.rAddressMode = key.rAddressMode;
+	desc.magFilter = key.magFilter;
+	desc.minFilter = key.minFilter;
+	desc.mipFilter = key.mipFilter;
+	desc.lodMinClamp = key.lodMinClamp;
+	desc.lodMaxClamp = key.lodMaxClamp;
+	desc.compareFunction = key.compareFunction;
+	id<MTLSamplerState> sampler_state = [device newSamplerStateWithDescriptor:desc];
+	if (sampler_state == nil) {
+		AXGL_DBGOUT("newSamplerStateWithDescriptor> failed\n");
+		return nullptr;
+	}
+	Entry* entry = AXGL_NEW(Entry);
+	entry->key = key;
+	entry->samplerState = sampler_state;
+	entry->handle = m_nextHandle++;
+	entry->refCount = 1;
+	m_entries.insert(std::make_pair(key, entry));
+	return entry;
+}
+
+void SamplerStateCache::release(Entry* entry)
+{
+	if (entry == nullptr) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	AXGL_ASSERT(entry->refCount > 0);
+	entry->refCount--;
+	if (entry->refCount > 0) {
+		return;
+	}
+	// 参照がなくなったエントリを破棄
+	// NOTE: 使用中のコマンドバッファはMTLSamplerStateを保持しているため、すぐに破棄してよい
+	m_entries.erase(entry->key);
+	AXGL_DELETE(entry);
+	return;
+}
+
+size_t SamplerStateCache::getNumEntries() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.size();
+}
+
 SamplerMetal::SamplerMetal()
 {
 }
 
 SamplerMetal::~SamplerMetal()
 {
+	SamplerStateCache::getInstance().release(m_cacheEntry);
+	m_cacheEntry = nullptr;
 }
 
 bool SamplerMetal::initialize(BackendContext* context)
 {
-	m_pSamplerDesc = [[MTLSamplerDescriptor alloc] init];
 	m_dirty = false;
 	return true;
 }
 
 bool SamplerMetal::terminate(BackendContext* context)
 {
-	m_pSamplerDesc = nil;
-	m_samplerState = nil;
+	SamplerStateCache::getInstance().release(m_cacheEntry);
+	m_cacheEntry = nullptr;
 	m_dirty = true;
 	return true;
 }
@@ -157,34 +287,37 @@ bool SamplerMetal::terminate(BackendContext* context)
 bool SamplerMetal::setupSampler(BackendContext* context, const SamplerParameters& params)
 {
 	AXGL_ASSERT(context != nullptr);
-	m_pSamplerDesc.sAddressMode = convert_address_mode(params.wrapS);
-	m_pSamplerDesc.tAddressMode = convert_address_mode(params.wrapT);
-	m_pSamplerDesc.rAddressMode = convert_address_mode(params.wrapR);
-	m_pSamplerDesc.magFilter = convert_mag_filter(params.magFilter);
-	m_pSamplerDesc.minFilter = convert_min_filter(params.minFilter);
-	m_pSamplerDesc.mipFilter = convert_mip_filter(params.minFilter);
-	m_pSamplerDesc.lodMinClamp = params.minLod;
-	m_pSamplerDesc.lodMaxClamp = params.maxLod;
-	m_pSamplerDesc.compareFunction = convert_compare_function(params.compareMode, params.compareFunc);
-
 	ContextMetal* mtl_context = static_cast<ContextMetal*>(context);
 	AXGL_ASSERT(mtl_context != nullptr);
 	id<MTLDevice> device = mtl_context->getDevice();
-	m_samplerState = [device newSamplerStateWithDescriptor:m_pSamplerDesc];
-	// MTLSamplerStateを再生成したことからdirty
-	m_dirty = true;
+	// 同じ設定のMTLSamplerStateをキャッシュから取得
+	// NOTE: 古いエントリを先に解放すると同じ設定で作り直しになるため、取得後に解放する
+	SamplerStateCache& cache = SamplerStateCache::getInstance();
+	SamplerStateCache::Entry* entry = cache.acquire(device, params);
+	if (entry == nullptr) {
+		return false;
+	}
+	if (entry != m_cacheEntry) {
+		cache.release(m_cacheEntry);
+		m_cacheEntry = entry;
+		// MTLSamplerStateが変わったことからdirty
+		m_dirty = true;
+	} else {
+		// 同じエントリの参照を重複して持たない
+		cache.release(entry);
+	}
 
 	return true;
 }
 
 id<MTLSamplerState> SamplerMetal::getMtlSamplerState() const
 {
-	return m_samplerState;
+	return (m_cacheEntry != nullptr) ? m_cacheEntry->samplerState : nil;
 }
 
-MTLSamplerDescriptor* SamplerMetal::getMtlSamplerDescriptor() const
+uint64_t SamplerMetal::getSamplerHandle() const
 {
-	return m_pSamplerDesc;
+	return (m_cacheEntry != nullptr) ? m_cacheEntry->handle : 0;
 }
 
 bool SamplerMetal::isDirty() const
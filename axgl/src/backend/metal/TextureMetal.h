@@ -7,6 +7,8 @@
 namespace axgl {
 
 class BackendContext;
+class ContextMetal;
+class SubmissionSerial;
 
 class TextureMetal : public BackendTexture
 {
@@ -16,27 +18,27 @@ public:
 	virtual bool initialize(BackendContext* context) override;
 	virtual void terminate(BackendContext* context) override;
 	virtual bool setImage2D(BackendContext* context, GLint level, GLenum internalformat,
-		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const TextureParameters* params) override;
+		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack, const TextureParameters* params) override;
 	virtual bool setSubImage2D(BackendContext* context, GLint level, GLint xoffset, GLint yoffset,
-		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) override;
+		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack) override;
 	virtual bool setCompressedImage2D(BackendContext* context, GLint level, GLenum internalformat,
 		GLsizei width, GLsizei height, GLsizei imageSize, const void* data, const TextureParameters* params) override;
 	virtual bool setImageCube(BackendContext* context, GLenum target, GLint level, GLenum internalformat,
-		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const TextureParameters* params) override;
+		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack, const TextureParameters* params) override;
 	virtual bool setSubImageCube(BackendContext* context, GLenum target, GLint level, GLenum xoffset, GLenum yoffset,
-		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) override;
+		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack) override;
 	virtual bool setCompressedImageCube(BackendContext* context, GLenum target, GLint level, GLenum internalformat,
 		GLsizei width, GLsizei height, GLsizei imageSize, const void* data, const TextureParameters* params) override;
 	virtual bool setImage3D(BackendContext* context, GLint level, GLenum internalformat,
-		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const TextureParameters* params) override;
+		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack, const TextureParameters* params) override;
 	virtual bool setSubImage3D(BackendContext* context, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
-		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) override;
+		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack) override;
 	virtual bool setCompressedImage3D(BackendContext* context, GLint level, GLenum internalformat,
 		GLsizei width, GLsizei height, GLsizei depth, GLsizei imageSize, const void* data, const TextureParameters* params) override;
 	virtual bool setImage2DArray(BackendContext* context, GLint level, GLenum internalformat,
-		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const TextureParameters* params) override;
+		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack, const TextureParameters* params) override;
 	virtual bool setSubImage2DArray(BackendContext* context, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
-		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) override;
+		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack) override;
 	virtual bool setCompressedImage2DArray(BackendContext* context, GLint level, GLenum internalformat,
 		GLsizei width, GLsizei height, GLsizei depth, GLsizei imageSize, const void* data, const TextureParameters* params) override;
 	virtual bool createStorage2D(BackendContext* context, GLsizei levels, GLenum internalformat,
@@ -48,23 +50,47 @@ public:
 	virtual bool createStorage2DArray(BackendContext* context, GLsizei levels, GLenum internalformat,
 		GLsizei width, GLsizei height, GLsizei depth, const TextureParameters* params) override;
 	virtual bool generateMipmap(BackendContext* context, const TextureParameters* params) override;
+	virtual bool copyImage2D(BackendContext* context, GLenum target, GLint level, GLenum internalformat,
+		GLint x, GLint y, GLsizei width, GLsizei height, BackendFramebuffer* readFramebuffer, GLenum readBuffer, const TextureParameters* params) override;
+	virtual bool copySubImage2D(BackendContext* context, GLenum target, GLint level, GLint xoffset, GLint yoffset,
+		GLint x, GLint y, GLsizei width, GLsizei height, BackendFramebuffer* readFramebuffer, GLenum readBuffer) override;
+	virtual size_t getMemorySize() const override;
 
 public:
 	id<MTLTexture> getMtlTexture() const;
 	MTLPixelFormat getPixelFormat() const;
 	bool isDirty() const;
 	void clearDirty();
+	void setLastUsedSerial(const SubmissionSerial* submissionSerial, uint64_t serial);
 
 private:
 	bool isStorageChanged(MTLTextureType mtltype, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth);
 	bool isSubImageAcceptable(MTLTextureType mtltype, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
 		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type);
-	static uint8_t* convertPixels(int w, int h, int d, int convertType, const void* pixels);
+	bool uploadFromUnpackBuffer(BackendContext* context, GLint level, NSUInteger slice, const MTLRegion& region,
+		GLenum format, GLenum type, const void** pixels, const UnpackParameters* unpack);
+	bool copyFromFramebuffer(BackendContext* context, GLint level, NSUInteger slice, GLint xoffset, GLint yoffset,
+		GLint x, GLint y, GLsizei width, GLsizei height, BackendFramebuffer* readFramebuffer, GLenum readBuffer);
+	void waitForPendingCopy(BackendContext* context);
+	void uploadPixels(BackendContext* context, GLint level, NSUInteger slice, const MTLRegion& region,
+		GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack);
+	void waitForAsyncUpload() const;
+	void recycleUsedTexture(ContextMetal* context);
+	bool generateMipmapOnCPU(BackendContext* context);
+	static uint8_t* convertPixels(int w, int h, int d, int convertType, const void* pixels, size_t bytesPerRow, size_t bytesPerImage);
 
 private:
 	MTLTextureDescriptor* m_mtlTextureDesc = nil;
 	id<MTLTexture> m_mtlTexture = nil;
 	bool m_dirty = false;
+	// NOTE: ピクセルアンパックバッファ、フレームバッファからの転送を記録したサブミッションのシリアル
+	uint64_t m_pendingCopySerial = 0;
+	// NOTE: 最後に描画、転送で参照したサブミッションのシリアル
+	uint64_t m_lastUsedSerial = 0;
+	// NOTE: m_lastUsedSerialを発行したコンテキストのシリアル(比較のみに使用し、参照はしない)
+	const SubmissionSerial* m_lastUsedSerialSource = nullptr;
+	// NOTE: ワーカースレッドでの転送のチケット
+	uint64_t m_asyncUploadTicket = 0;
 };
 
 } // namespace axgl
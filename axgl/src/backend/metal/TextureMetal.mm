@@ -1,7 +1,12 @@
 // TextureMetal.mm
 #include "TextureMetal.h"
 #include "ContextMetal.h"
+#include "BufferMetal.h"
 #include "../../AXGLAllocatorImpl.h"
+#include "../../common/MipmapGeneration.h"
+#include "../../common/PixelConversion.h"
+#include "../../common/TextureTranscoder.h"
+#include "../../common/TextureUploadQueue.h"
 
 namespace axgl {
 
@@ -25,7 +30,12 @@ void BackendTexture::destroy(BackendTexture* texture)
 enum ConvertType {
 	ConvertTypeNone = 0,
 	ConvertTypeRGB2RGBA = 1,
-	ConvertTypeRGB2RGBAInt = 2
+	ConvertTypeRGB2RGBAInt = 2,
+	ConvertTypeRGB5652RGBA = 3,
+	ConvertTypeRGBA44442RGBA = 4,
+	ConvertTypeRGBA55512RGBA = 5,
+	ConvertTypeL2RGBA = 6,
+	ConvertTypeLA2RGBA = 7
 };
 
 static inline MTLTextureSwizzle convert_swizzle(GLenum swizzle_gl)
@@ -129,6 +139,37 @@ static ConvertType get_convert_type(GLenum format, GLenum type, int* converted_f
 			convert_type = ConvertTypeRGB2RGBA;
 			*converted_format = GL_RGBA;
 			*converted_type = GL_BYTE;
+		} else if (type == GL_UNSIGNED_SHORT_5_6_5) {
+			convert_type = ConvertTypeRGB5652RGBA;
+			*converted_format = GL_RGBA;
+			*converted_type = GL_UNSIGNED_BYTE;
+		}
+		break;
+	// 16bit packed formats
+	case GL_RGBA:
+		if (type == GL_UNSIGNED_SHORT_4_4_4_4) {
+			convert_type = ConvertTypeRGBA44442RGBA;
+			*converted_format = GL_RGBA;
+			*converted_type = GL_UNSIGNED_BYTE;
+		} else if (type == GL_UNSIGNED_SHORT_5_5_5_1) {
+			convert_type = ConvertTypeRGBA55512RGBA;
+			*converted_format = GL_RGBA;
+			*converted_type = GL_UNSIGNED_BYTE;
+		}
+		break;
+	// luminance formats
+	case GL_LUMINANCE:
+		if (type == GL_UNSIGNED_BYTE) {
+			convert_type = ConvertTypeL2RGBA;
+			*converted_format = GL_RGBA;
+			*converted_type = GL_UNSIGNED_BYTE;
+		}
+		break;
+	case GL_LUMINANCE_ALPHA:
+		if (type == GL_UNSIGNED_BYTE) {
+			convert_type = ConvertTypeLA2RGBA;
+			*converted_format = GL_RGBA;
+			*converted_type = GL_UNSIGNED_BYTE;
 		}
 		break;
 	case GL_RGB_INTEGER:
@@ -149,7 +190,56 @@ static ConvertType get_convert_type(GLenum format, GLenum type, int* converted_f
 	return convert_type;
 }
 
-static bool convert_rgb_to_rgba(int w, int h, int d, const uint8_t* src, uint8_t** dst, uint8_t alpha)
+// 1行分のピクセルデータをRGBA8に変換
+static void convert_row_to_rgba(ConvertType convertType, uint8_t* dst, const uint8_t* src, size_t count)
+{
+	switch (convertType) {
+	case ConvertTypeRGB2RGBA:
+		convertPixelsRGB8ToRGBA8(dst, src, count, 0xff);
+		break;
+	case ConvertTypeRGB2RGBAInt:
+		// 整数フォーマットのアルファは1
+		convertPixelsRGB8ToRGBA8(dst, src, count, 1);
+		break;
+	case ConvertTypeRGB5652RGBA:
+		convertPixelsRGB565ToRGBA8(dst, src, count);
+		break;
+	case ConvertTypeRGBA44442RGBA:
+		convertPixelsRGBA4444ToRGBA8(dst, src, count);
+		break;
+	case ConvertTypeRGBA55512RGBA:
+		convertPixelsRGBA5551ToRGBA8(dst, src, count);
+		break;
+	case ConvertTypeL2RGBA:
+		convertPixelsLuminanceToRGBA8(dst, src, count);
+		break;
+	case ConvertTypeLA2RGBA:
+		convertPixelsLuminanceAlphaToRGBA8(dst, src, count);
+		break;
+	default:
+		AXGL_ASSERT(0);
+		break;
+	}
+	return;
+}
+
+// ピクセルデータを行単位で変換(ソースは行、イメージ毎のピッチに従って読み出し、変換後は詰めて格納する)
+// NOTE: ワーカースレッドからも呼ばれるため、メモリを確保しないこと
+static void convert_image_to_rgba(ConvertType convertType, int w, int h, int d, const uint8_t* src, size_t bytesPerRow, size_t bytesPerImage, uint8_t* dst)
+{
+	AXGL_ASSERT((src != nullptr) && (dst != nullptr));
+	uint8_t* dp = dst;
+	for (int z = 0; z < d; z++) {
+		const uint8_t* image = src + (bytesPerImage * z);
+		for (int y = 0; y < h; y++) {
+			convert_row_to_rgba(convertType, dp, image + (bytesPerRow * y), w);
+			dp += w * 4;
+		}
+	}
+	return;
+}
+
+static bool convert_to_rgba(ConvertType convertType, int w, int h, int d, const uint8_t* src, size_t bytesPerRow, size_t bytesPerImage, uint8_t** dst)
 {
 	AXGL_ASSERT((src != nullptr) && (dst != nullptr));
 	int num_pix = w * h * d;
@@ -158,18 +248,123 @@ static bool convert_rgb_to_rgba(int w, int h, int d, const uint8_t* src, uint8_t
 	if (*dst == nullptr) {
 		return false;
 	}
-	// ピクセルデータを変換
-	const uint8_t* sp = src;
-	uint8_t* dp = *dst;
-	for (int i = 0; i < num_pix; i++) {
-		memcpy(dp, sp, sizeof(uint8_t) * 3);
-		dp[3] = alpha;
-		sp += 3;
-		dp += 4;
-	}
+	convert_image_to_rgba(convertType, w, h, d, src, bytesPerRow, bytesPerImage, *dst);
 	return true;
 }
 
+// アンパックパラメータを適用したソースデータのレイアウト
+struct UnpackLayout {
+	const uint8_t* pixels;
+	NSUInteger bytesPerRow;
+	NSUInteger bytesPerImage;
+	NSUInteger skipBytes; // 先頭からスキップするバイト数
+};
+
+// ソースデータの1ピクセルのバイト数を取得
+static NSUInteger get_unpack_bytes_per_pixel(ConvertType convertType, GLenum format, GLenum type)
+{
+	NSUInteger bytes_per_pixel = 0;
+	switch (convertType) {
+	case ConvertTypeRGB2RGBA:
+	case ConvertTypeRGB2RGBAInt:
+		// RGBは変換前の3バイト
+		bytes_per_pixel = 3;
+		break;
+	case ConvertTypeRGB5652RGBA:
+	case ConvertTypeRGBA44442RGBA:
+	case ConvertTypeRGBA55512RGBA:
+	case ConvertTypeLA2RGBA:
+		bytes_per_pixel = 2;
+		break;
+	case ConvertTypeL2RGBA:
+		bytes_per_pixel = 1;
+		break;
+	default:
+		bytes_per_pixel = get_bytes_per_pixel(format, type);
+		break;
+	}
+	return bytes_per_pixel;
+}
+
+// アンパックパラメータからソースデータのレイアウトを算出
+static UnpackLayout get_unpack_layout(const void* pixels, GLsizei width, GLsizei height, NSUInteger bytesPerPixel,
+	const BackendTexture::UnpackParameters* unpack)
+{
+	UnpackLayout layout;
+	layout.pixels = static_cast<const uint8_t*>(pixels);
+	layout.bytesPerRow = bytesPerPixel * width;
+	layout.bytesPerImage = layout.bytesPerRow * height;
+	layout.skipBytes = 0;
+	if (unpack == nullptr) {
+		return layout;
+	}
+	// 行の長さ(ピクセル数)とアライメントから、行のピッチを算出
+	NSUInteger row_length = (unpack->rowLength > 0) ? unpack->rowLength : width;
+	NSUInteger alignment = (unpack->alignment > 0) ? unpack->alignment : 1;
+	layout.bytesPerRow = ((bytesPerPixel * row_length) + (alignment - 1)) / alignment * alignment;
+	NSUInteger image_height = (unpack->imageHeight > 0) ? unpack->imageHeight : height;
+	layout.bytesPerImage = layout.bytesPerRow * image_height;
+	// スキップするピクセル、行、イメージ分だけ先頭をずらす
+	layout.skipBytes = (layout.bytesPerImage * unpack->skipImages) + (layout.bytesPerRow * unpack->skipRows)
+		+ (bytesPerPixel * unpack->skipPixels);
+	if (layout.pixels != nullptr) {
+		layout.pixels += layout.skipBytes;
+	}
+	return layout;
+}
+
+// テクスチャのリージョンをCPUから書き換える
+static void replace_texture_region(id<MTLTexture> texture, const MTLRegion& region, GLint level, NSUInteger slice,
+	const void* pixels, NSUInteger bytesPerRow, NSUInteger bytesPerImage)
+{
+	if ([texture textureType] == MTLTextureType2D) {
+		[texture replaceRegion:region mipmapLevel:level withBytes:pixels bytesPerRow:bytesPerRow];
+	} else {
+		[texture replaceRegion:region mipmapLevel:level slice:slice withBytes:pixels bytesPerRow:bytesPerRow bytesPerImage:bytesPerImage];
+	}
+	return;
+}
+
+// ワーカースレッドで実行するテクスチャの転送
+class TextureUploadTaskMetal : public TextureUploadTask
+{
+public:
+	virtual void execute() override;
+
+public:
+	id<MTLTexture> texture = nil;
+	MTLRegion region = {};
+	GLint level = 0;
+	NSUInteger slice = 0;
+	ConvertType convertType = ConvertTypeNone;
+	// ステージングメモリにコピーしたソースデータの行、イメージ毎のピッチ
+	NSUInteger bytesPerRow = 0;
+	NSUInteger bytesPerImage = 0;
+	// 変換後のデータを格納するステージングメモリ内のオフセット
+	size_t convertedOffset = 0;
+};
+
+void TextureUploadTaskMetal::execute()
+{
+	@autoreleasepool {
+		const uint8_t* src = getStagingMemory();
+		NSUInteger bytes_per_row = bytesPerRow;
+		NSUInteger bytes_per_image = bytesPerImage;
+		if (convertType != ConvertTypeNone) {
+			// 変換後のデータはステージングメモリの後半に詰めて格納する
+			uint8_t* dst = getStagingMemory() + convertedOffset;
+			convert_image_to_rgba(convertType, (int)region.size.width, (int)region.size.height, (int)region.size.depth,
+				src, bytesPerRow, bytesPerImage, dst);
+			src = dst;
+			bytes_per_row = region.size.width * 4;
+			bytes_per_image = bytes_per_row * region.size.height;
+		}
+		replace_texture_region(texture, region, level, slice, src, bytes_per_row, bytes_per_image);
+		texture = nil;
+	}
+	return;
+}
+
 static void release_convert_work(void* work)
 {
 	// バッファを解放
@@ -179,6 +374,88 @@ static void release_convert_work(void* work)
 	return;
 }
 
+// ブリットコマンドでミップマップを生成できるピクセルフォーマットか
+// NOTE: generateMipmapsForTextureはカラーレンダラブルかつフィルタ可能なフォーマットのみ
+static bool is_blit_mipmap_supported(id<MTLDevice> device, MTLPixelFormat pixelFormat)
+{
+	bool supported = true;
+	switch (pixelFormat) {
+	case MTLPixelFormatA8Unorm:
+	case MTLPixelFormatR8Uint:
+	case MTLPixelFormatR8Sint:
+	case MTLPixelFormatR16Uint:
+	case MTLPixelFormatR16Sint:
+	case MTLPixelFormatR32Uint:
+	case MTLPixelFormatR32Sint:
+	case MTLPixelFormatRG8Uint:
+	case MTLPixelFormatRG8Sint:
+	case MTLPixelFormatRG16Uint:
+	case MTLPixelFormatRG16Sint:
+	case MTLPixelFormatRG32Uint:
+	case MTLPixelFormatRG32Sint:
+	case MTLPixelFormatRGBA8Uint:
+	case MTLPixelFormatRGBA8Sint:
+	case MTLPixelFormatRGB10A2Uint:
+	case MTLPixelFormatRGBA16Uint:
+	case MTLPixelFormatRGBA16Sint:
+	case MTLPixelFormatRGBA32Uint:
+	case MTLPixelFormatRGBA32Sint:
+		supported = false;
+		break;
+	case MTLPixelFormatR32Float:
+	case MTLPixelFormatRG32Float:
+	case MTLPixelFormatRGBA32Float:
+#if TARGET_OS_IPHONE
+		// 32bit floatのフィルタはデバイスによって非対応
+		supported = false;
+		if (@available(iOS 14.0, *)) {
+			supported = [device supports32BitFloatFiltering];
+		}
+#else
+		AXGL_UNUSED(device);
+#endif
+		break;
+	default:
+		break;
+	}
+	return supported;
+}
+
+// CPUでミップマップを生成する場合のピクセルフォーマットを取得
+static MipmapPixelFormat get_mipmap_pixel_format(MTLPixelFormat pixelFormat)
+{
+	MipmapPixelFormat mipmap_format = MipmapPixelFormatInvalid;
+	switch (pixelFormat) {
+	case MTLPixelFormatA8Unorm:
+	case MTLPixelFormatR8Unorm:
+		mipmap_format = MipmapPixelFormatR8;
+		break;
+	case MTLPixelFormatRG8Unorm:
+		mipmap_format = MipmapPixelFormatRG8;
+		break;
+	case MTLPixelFormatRGBA8Unorm:
+	case MTLPixelFormatBGRA8Unorm:
+		mipmap_format = MipmapPixelFormatRGBA8;
+		break;
+	case MTLPixelFormatRGBA8Unorm_sRGB:
+	case MTLPixelFormatBGRA8Unorm_sRGB:
+		mipmap_format = MipmapPixelFormatSRGB8A8;
+		break;
+	case MTLPixelFormatR32Float:
+		mipmap_format = MipmapPixelFormatR32F;
+		break;
+	case MTLPixelFormatRG32Float:
+		mipmap_format = MipmapPixelFormatRG32F;
+		break;
+	case MTLPixelFormatRGBA32Float:
+		mipmap_format = MipmapPixelFormatRGBA32F;
+		break;
+	default:
+		break;
+	}
+	return mipmap_format;
+}
+
 static NSUInteger get_slice_value(GLenum target)
 {
 	NSUInteger slice = 0;
@@ -240,12 +517,30 @@ static int32_t num_block_vertical(int32_t internalformat, int32_t height)
 		}
 		break;
 	default:
-		AXGL_ASSERT(0);
+		{
+			// ASTC : ブロックサイズはフォーマット毎に異なる
+			CompressedFormatInfo info;
+			if (getCompressedFormatInfo(internalformat, &info)) {
+				num_block = (height + info.blockHeight - 1) / info.blockHeight;
+			} else {
+				AXGL_ASSERT(0);
+			}
+		}
 		break;
 	}
 	return num_block;
 }
 
+// GPUが対応していない圧縮フォーマットか(CPUでデコードしたフォーマットの情報をinfoに設定)
+static bool is_transcode_required(BackendContext* context, GLenum internalformat, CompressedFormatInfo* info)
+{
+	ContextMetal* mtl_context = static_cast<ContextMetal*>(context);
+	if (is_compressed_format_supported(mtl_context->getDevice(), internalformat)) {
+		return false;
+	}
+	return getCompressedFormatInfo(internalformat, info);
+}
+
 TextureMetal::TextureMetal()
 {
 }
@@ -268,6 +563,10 @@ bool TextureMetal::initialize(BackendContext* context)
 
 void TextureMetal::terminate(BackendContext* context)
 {
+	if ((context != nullptr) && (m_mtlTexture != nil)) {
+		// 最後に使用したサブミッションの完了後に再利用させる
+		recycleUsedTexture(static_cast<ContextMetal*>(context));
+	}
 	m_mtlTexture = nil;
 	m_mtlTextureDesc = nil;
 	// MTLTextureを解放したのでdirtyにしておく
@@ -276,7 +575,7 @@ void TextureMetal::terminate(BackendContext* context)
 }
 
 bool TextureMetal::setImage2D(BackendContext* context, GLint level, GLenum internalformat,
-	GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const TextureParameters* params)
+	GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack, const TextureParameters* params)
 {
 	AXGL_ASSERT(params != nullptr);
 	// ストレージが変化したかをチェック
@@ -293,61 +592,41 @@ bool TextureMetal::setImage2D(BackendContext* context, GLint level, GLenum inter
 		// 2Dストレージを作成
 		createStorage2D(context, num_level, internalformat, lv0_width, lv0_height, params);
 	}
-	// フォーマット変換が必要な場合は実行
-	int converted_format = 0;
-	int converted_data_type = 0;
-	uint8_t* convert_work_buf = nullptr;
-	ConvertType convert_type = get_convert_type(format, type, &converted_format, &converted_data_type);
-	if ((convert_type != ConvertTypeNone) && (pixels != nullptr)) {
-		convert_work_buf = convertPixels(width, height, 1, convert_type, pixels);
-		pixels = convert_work_buf;
-		format = converted_format;
-		type = converted_data_type;
+	MTLRegion region = {
+		{0, 0, 0},
+		{(NSUInteger)width, (NSUInteger)height, 1}
+	};
+	// ピクセルアンパックバッファからの転送
+	if ((unpack != nullptr) && (unpack->buffer != nullptr)) {
+		if (uploadFromUnpackBuffer(context, level, 0, region, format, type, &pixels, unpack)) {
+			return true;
+		}
 	}
 	// テクスチャイメージを設定
-	if ((m_mtlTexture != nil) && (pixels != nullptr)) {
-		MTLRegion region = {
-			{0, 0, 0},
-			{(NSUInteger)width, (NSUInteger)height, 1}
-		};
-		NSUInteger bytes_per_row = get_bytes_per_pixel(format, type) * width;
-		[m_mtlTexture replaceRegion:region mipmapLevel:level withBytes:pixels bytesPerRow:bytes_per_row];
-	}
-	// ワークを作成している場合は解放
-	release_convert_work(convert_work_buf);
+	uploadPixels(context, level, 0, region, format, type, pixels, unpack);
 	return true;
 }
 
 bool TextureMetal::setSubImage2D(BackendContext* context, GLint level, GLint xoffset, GLint yoffset,
-	GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+	GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack)
 {
 	// サブイメージ設定可能か
 	bool texture_changed = isSubImageAcceptable(MTLTextureType2D, level, xoffset, yoffset, 0, width, height, 1, format, type);
 	if ((m_mtlTexture == nil) || !texture_changed) {
 		return false;
 	}
-	// フォーマット変換が必要な場合は実行
-	int converted_format = 0;
-	int converted_data_type = 0;
-	uint8_t* convert_work_buf = nullptr;
-	ConvertType convert_type = get_convert_type(format, type, &converted_format, &converted_data_type);
-	if ((convert_type != ConvertTypeNone) && (pixels != nullptr)) {
-		convert_work_buf = convertPixels(width, height, 1, convert_type, pixels);
-		pixels = convert_work_buf;
-		format = converted_format;
-		type = converted_data_type;
+	MTLRegion region = {
+		{(NSUInteger)xoffset, (NSUInteger)yoffset, 0},
+		{(NSUInteger)width, (NSUInteger)height, 1}
+	};
+	// ピクセルアンパックバッファからの転送
+	if ((unpack != nullptr) && (unpack->buffer != nullptr)) {
+		if (uploadFromUnpackBuffer(context, level, 0, region, format, type, &pixels, unpack)) {
+			return true;
+		}
 	}
 	// テクスチャイメージを設定
-	if ((m_mtlTexture != nil) && (pixels != nullptr)) {
-		MTLRegion region = {
-			{(NSUInteger)xoffset, (NSUInteger)yoffset, 0},
-			{(NSUInteger)width, (NSUInteger)height, 1}
-		};
-		NSUInteger bytes_per_row = get_bytes_per_pixel(format, type) * width;
-		[m_mtlTexture replaceRegion:region mipmapLevel:level withBytes:pixels bytesPerRow:bytes_per_row];
-	}
-	// ワークを作成している場合は解放
-	release_convert_work(convert_work_buf);
+	uploadPixels(context, level, 0, region, format, type, pixels, unpack);
 	return true;
 }
 
@@ -355,8 +634,12 @@ bool TextureMetal::setCompressedImage2D(BackendContext* context, GLint level, GL
 	GLsizei width, GLsizei height, GLsizei imageSize, const void* data, const TextureParameters* params)
 {
 	AXGL_ASSERT(params != nullptr);
+	// GPUが対応していない圧縮フォーマットは、CPUでデコードしたフォーマットのストレージを使用
+	CompressedFormatInfo transcode_info;
+	bool transcode = is_transcode_required(context, internalformat, &transcode_info);
+	GLenum storage_internalformat = transcode ? transcode_info.transcodedInternalformat : internalformat;
 	// ストレージが変化したかをチェック
-	bool texture_changed = isStorageChanged(MTLTextureType2D, level, internalformat, width, height, 1);
+	bool texture_changed = isStorageChanged(MTLTextureType2D, level, storage_internalformat, width, height, 1);
 	if ((m_mtlTexture == nil) || texture_changed) {
 		int lv0_width  = width;
 		int lv0_height = height;
@@ -367,23 +650,37 @@ bool TextureMetal::setCompressedImage2D(BackendContext* context, GLint level, GL
 		// ミップマップレベル数
 		int num_level = calc_num_level_2d(lv0_width, lv0_height);
 		// 2Dストレージを作成
-		createStorage2D(context, num_level, internalformat, lv0_width, lv0_height, params);
+		createStorage2D(context, num_level, storage_internalformat, lv0_width, lv0_height, params);
 	}
 	// テクスチャイメージを設定
 	if ((m_mtlTexture != nil) && (data != nullptr)) {
+		waitForPendingCopy(context);
+		waitForAsyncUpload();
 		MTLRegion region = {
 			{0, 0, 0},
 			{(NSUInteger)width, (NSUInteger)height, 1}
 		};
-		NSUInteger bytes_per_row_blocks = get_bytes_per_row_blocks(internalformat, width);
-		[m_mtlTexture replaceRegion:region mipmapLevel:level withBytes:data bytesPerRow:bytes_per_row_blocks];
+		if (transcode) {
+			// CPUでデコードして転送
+			NSUInteger bytes_per_row = width * getTranscodedPixelSize(transcode_info.transcodedFormat);
+			bool transcoded = TranscodeCache::getInstance().transcode(internalformat, data, imageSize, width, height, [&](const uint8_t* decoded) {
+				[m_mtlTexture replaceRegion:region mipmapLevel:level withBytes:decoded bytesPerRow:bytes_per_row];
+			});
+			if (!transcoded) {
+				AXGL_DBGOUT("TextureMetal::setCompressedImage2D> transcode failed:0x%04X\n", internalformat);
+				return false;
+			}
+		} else {
+			NSUInteger bytes_per_row_blocks = get_bytes_per_row_blocks(internalformat, width);
+			[m_mtlTexture replaceRegion:region mipmapLevel:level withBytes:data bytesPerRow:bytes_per_row_blocks];
+		}
 	}
 
 	return true;
 }
 
 bool TextureMetal::setImageCube(BackendContext* context, GLenum target, GLint level, GLenum internalformat,
-	GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const TextureParameters* params)
+	GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack, const TextureParameters* params)
 {
 	AXGL_ASSERT(params !=  nullptr);
 	// ストレージが変化したかをチェック
@@ -400,65 +697,41 @@ bool TextureMetal::setImageCube(BackendContext* context, GLenum target, GLint le
 		// Cubeストレージを作成
 		createStorageCube(context, num_level, internalformat, lv0_width, lv0_height, params);
 	}
-	// フォーマット変換が必要な場合は実行
-	int converted_format = 0;
-	int converted_data_type = 0;
-	uint8_t* convert_work_buf = nullptr;
-	ConvertType convert_type = get_convert_type(format, type, &converted_format, &converted_data_type);
-	if ((convert_type != ConvertTypeNone) && (pixels != nullptr)) {
-		convert_work_buf = convertPixels(width, height, 1, convert_type, pixels);
-		pixels = convert_work_buf;
-		format = converted_format;
-		type = converted_data_type;
+	MTLRegion region = {
+		{0, 0, 0},
+		{(NSUInteger)width, (NSUInteger)height, 1}
+	};
+	// ピクセルアンパックバッファからの転送
+	if ((unpack != nullptr) && (unpack->buffer != nullptr)) {
+		if (uploadFromUnpackBuffer(context, level, get_slice_value(target), region, format, type, &pixels, unpack)) {
+			return true;
+		}
 	}
 	// テクスチャイメージを設定
-	if ((m_mtlTexture != nil) && (pixels != nullptr)) {
-		MTLRegion region = {
-			{0, 0, 0},
-			{(NSUInteger)width, (NSUInteger)height, 1}
-		};
-		NSUInteger slice_value = get_slice_value(target);
-		NSUInteger bytes_per_row = get_bytes_per_pixel(format, type) * width;
-		NSUInteger bytes_per_image = bytes_per_row * height;
-		[m_mtlTexture replaceRegion:region mipmapLevel:level slice:slice_value withBytes:pixels bytesPerRow:bytes_per_row bytesPerImage:bytes_per_image];
-	}
-	// ワークを作成している場合は解放
-	release_convert_work(convert_work_buf);
+	uploadPixels(context, level, get_slice_value(target), region, format, type, pixels, unpack);
 	return true;
 }
 
 bool TextureMetal::setSubImageCube(BackendContext* context, GLenum target, GLint level, GLenum xoffset, GLenum yoffset,
-	GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+	GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack)
 {
 	// サブイメージ設定可能か
 	bool texture_changed = isSubImageAcceptable(MTLTextureTypeCube, level, xoffset, yoffset, 0, width, height, 1, format, type);
 	if ((m_mtlTexture == nil) || !texture_changed) {
 		return false;
 	}
-	// フォーマット変換が必要な場合は実行
-	int converted_format = 0;
-	int converted_data_type = 0;
-	uint8_t* convert_work_buf = nullptr;
-	ConvertType convert_type = get_convert_type(format, type, &converted_format, &converted_data_type);
-	if ((convert_type != ConvertTypeNone) && (pixels != nullptr)) {
-		convert_work_buf = convertPixels(width, height, 1, convert_type, pixels);
-		pixels = convert_work_buf;
-		format = converted_format;
-		type = converted_data_type;
+	MTLRegion region = {
+		{(NSUInteger)xoffset, (NSUInteger)yoffset, 0},
+		{(NSUInteger)width, (NSUInteger)height, 1}
+	};
+	// ピクセルアンパックバッファからの転送
+	if ((unpack != nullptr) && (unpack->buffer != nullptr)) {
+		if (uploadFromUnpackBuffer(context, level, get_slice_value(target), region, format, type, &pixels, unpack)) {
+			return true;
+		}
 	}
 	// テクスチャイメージを設定
-	if ((m_mtlTexture != nil) && (pixels != nullptr)) {
-		MTLRegion region = {
-			{(NSUInteger)xoffset, (NSUInteger)yoffset, 0},
-			{(NSUInteger)width, (NSUInteger)height, 1}
-		};
-		NSUInteger slice_value = get_slice_value(target);
-		NSUInteger bytes_per_row = get_bytes_per_pixel(format, type) * width;
-		NSUInteger bytes_per_image = bytes_per_row * height;
-		[m_mtlTexture replaceRegion:region mipmapLevel:level slice:slice_value withBytes:pixels bytesPerRow:bytes_per_row bytesPerImage:bytes_per_image];
-	}
-	// ワークを作成している場合は解放
-	release_convert_work(convert_work_buf);
+	uploadPixels(context, level, get_slice_value(target), region, format, type, pixels, unpack);
 	return true;
 }
 
@@ -466,8 +739,12 @@ bool TextureMetal::setCompressedImageCube(BackendContext* context, GLenum target
 	GLsizei width, GLsizei height, GLsizei imageSize, const void* data, const TextureParameters* params)
 {
 	AXGL_ASSERT(params != nullptr);
+	// GPUが対応していない圧縮フォーマットは、CPUでデコードしたフォーマットのストレージを使用
+	CompressedFormatInfo transcode_info;
+	bool transcode = is_transcode_required(context, internalformat, &transcode_info);
+	GLenum storage_internalformat = transcode ? transcode_info.transcodedInternalformat : internalformat;
 	// ストレージが変化したかをチェック
-	bool texture_changed = isStorageChanged(MTLTextureTypeCube, level, internalformat, width, height, 1);
+	bool texture_changed = isStorageChanged(MTLTextureTypeCube, level, storage_internalformat, width, height, 1);
 	if ((m_mtlTexture == nil) || texture_changed) {
 		int lv0_width  = width;
 		int lv0_height = height;
@@ -478,25 +755,39 @@ bool TextureMetal::setCompressedImageCube(BackendContext* context, GLenum target
 		// ミップマップレベル数
 		int num_level = calc_num_level_2d(lv0_width, lv0_height);
 		// Cubeストレージを作成
-		createStorageCube(context, num_level, internalformat, lv0_width, lv0_height, params);
+		createStorageCube(context, num_level, storage_internalformat, lv0_width, lv0_height, params);
 	}
 	// テクスチャイメージを設定
 	if ((m_mtlTexture != nil) && (data != nullptr)) {
+		waitForPendingCopy(context);
+		waitForAsyncUpload();
 		MTLRegion region = {
 			{0, 0, 0},
 			{(NSUInteger)width, (NSUInteger)height, 1}
 		};
 		NSUInteger slice_value = get_slice_value(target);
-		NSUInteger bytes_per_row_blocks = get_bytes_per_row_blocks(internalformat, width);
-		NSUInteger bytes_per_image = bytes_per_row_blocks * num_block_vertical(internalformat, height);
-		[m_mtlTexture replaceRegion:region mipmapLevel:level slice:slice_value withBytes:data bytesPerRow:bytes_per_row_blocks bytesPerImage:bytes_per_image];
+		if (transcode) {
+			// CPUでデコードして転送
+			NSUInteger bytes_per_row = width * getTranscodedPixelSize(transcode_info.transcodedFormat);
+			bool transcoded = TranscodeCache::getInstance().transcode(internalformat, data, imageSize, width, height, [&](const uint8_t* decoded) {
+				[m_mtlTexture replaceRegion:region mipmapLevel:level slice:slice_value withBytes:decoded bytesPerRow:bytes_per_row bytesPerImage:(bytes_per_row * height)];
+			});
+			if (!transcoded) {
+				AXGL_DBGOUT("TextureMetal::setCompressedImageCube> transcode failed:0x%04X\n", internalformat);
+				return false;
+			}
+		} else {
+			NSUInteger bytes_per_row_blocks = get_bytes_per_row_blocks(internalformat, width);
+			NSUInteger bytes_per_image = bytes_per_row_blocks * num_block_vertical(internalformat, height);
+			[m_mtlTexture replaceRegion:region mipmapLevel:level slice:slice_value withBytes:data bytesPerRow:bytes_per_row_blocks bytesPerImage:bytes_per_image];
+		}
 	}
 
 	return true;
 }
 
 bool TextureMetal::setImage3D(BackendContext* context, GLint level, GLenum internalformat,
-	GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const TextureParameters* params)
+	GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack, const TextureParameters* params)
 {
 	AXGL_ASSERT(params != nullptr);
 	// ストレージが変化したかをチェック
@@ -514,61 +805,41 @@ bool TextureMetal::setImage3D(BackendContext* context, GLint level, GLenum inter
 		// 3Dストレージを作成
 		createStorage3D(context, num_level, internalformat, lv0_width, lv0_height, lv0_depth, params);
 	}
-	// フォーマット変換が必要な場合は実行
-	int converted_format = 0;
-	int converted_data_type = 0;
-	uint8_t* convert_work_buf = nullptr;
-	ConvertType convert_type = get_convert_type(format, type, &converted_format, &converted_data_type);
-	if ((convert_type != ConvertTypeNone) && (pixels != nullptr)) {
-		convert_work_buf = convertPixels(width, height, depth, convert_type, pixels);
-		pixels = convert_work_buf;
-		format = converted_format;
-		type = converted_data_type;
+	MTLRegion region = {
+		{0, 0, 0},
+		{(NSUInteger)width, (NSUInteger)height, (NSUInteger)depth}
+	};
+	// ピクセルアンパックバッファからの転送
+	if ((unpack != nullptr) && (unpack->buffer != nullptr)) {
+		if (uploadFromUnpackBuffer(context, level, 0, region, format, type, &pixels, unpack)) {
+			return true;
+		}
 	}
 	// テクスチャイメージを設定
-	if ((m_mtlTexture != nil) && (pixels != nullptr)) {
-		MTLRegion region = {
-			{0, 0, 0},
-			{(NSUInteger)width, (NSUInteger)height, (NSUInteger)depth}
-		};
-		NSUInteger bytes_per_row = get_bytes_per_pixel(format, type) * width;
-		[m_mtlTexture replaceRegion:region mipmapLevel:level withBytes:pixels bytesPerRow:bytes_per_row];
-	}
-	// ワークを作成している場合は解放
-	release_convert_work(convert_work_buf);
+	uploadPixels(context, level, 0, region, format, type, pixels, unpack);
 	return true;
 }
 
 bool TextureMetal::setSubImage3D(BackendContext* context, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
-	GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels)
+	GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack)
 {
 	// サブイメージ設定可能か
 	bool texture_changed = isSubImageAcceptable(MTLTextureType3D, level, xoffset, yoffset, zoffset, width, height, depth, format, type);
 	if ((m_mtlTexture == nil) || !texture_changed) {
 		return false;
 	}
-	// フォーマット変換が必要な場合は実行
-	int converted_format = 0;
-	int converted_data_type = 0;
-	uint8_t* convert_work_buf = nullptr;
-	ConvertType convert_type = get_convert_type(format, type, &converted_format, &converted_data_type);
-	if ((convert_type != ConvertTypeNone) && (pixels != nullptr)) {
-		convert_work_buf = convertPixels(width, height, depth, convert_type, pixels);
-		pixels = convert_work_buf;
-		format = converted_format;
-		type = converted_data_type;
+	MTLRegion region = {
+		{(NSUInteger)xoffset, (NSUInteger)yoffset, (NSUInteger)zoffset},
+		{(NSUInteger)width, (NSUInteger)height, (NSUInteger)depth}
+	};
+	// ピクセルアンパックバッファからの転送
+	if ((unpack != nullptr) && (unpack->buffer != nullptr)) {
+		if (uploadFromUnpackBuffer(context, level, 0, region, format, type, &pixels, unpack)) {
+			return true;
+		}
 	}
 	// テクスチャイメージを設定
-	if ((m_mtlTexture != nil) && (pixels != nullptr)) {
-		MTLRegion region = {
-			{(NSUInteger)xoffset, (NSUInteger)yoffset, (NSUInteger)zoffset},
-			{(NSUInteger)width, (NSUInteger)height, (NSUInteger)depth}
-		};
-		NSUInteger bytes_per_row = get_bytes_per_pixel(format, type) * width;
-		[m_mtlTexture replaceRegion:region mipmapLevel:level withBytes:pixels bytesPerRow:bytes_per_row];
-	}
-	// ワークを作成している場合は解放
-	release_convert_work(convert_work_buf);
+	uploadPixels(context, level, 0, region, format, type, pixels, unpack);
 	return true;
 }
 
@@ -581,7 +852,7 @@ bool TextureMetal::setCompressedImage3D(BackendContext* context, GLint level, GL
 }
 
 bool TextureMetal::setImage2DArray(BackendContext* context, GLint level, GLenum internalformat,
-	GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const TextureParameters* params)
+	GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack, const TextureParameters* params)
 {
 	AXGL_ASSERT(params != nullptr);
 	// ストレージが変化したかをチェック
@@ -605,7 +876,7 @@ bool TextureMetal::setImage2DArray(BackendContext* context, GLint level, GLenum
 }
 
 bool TextureMetal::setSubImage2DArray(BackendContext* context, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
-	GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels)
+	GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack)
 {
 	// サブイメージ設定可能か
 	bool texture_changed = isSubImageAcceptable(MTLTextureType2DArray, level, xoffset, yoffset, zoffset, width, height, depth, format, type);
@@ -657,9 +928,11 @@ bool TextureMetal::createStorage2D(BackendContext* context, GLsizei levels, GLen
 	};
 	[m_mtlTextureDesc setSwizzle:mtl_swizzle];
 	// MTLTextureを作成
+	// NOTE: 削除されたテクスチャ、レンダーバッファの同じ構成のストレージがあれば再利用する
 	ContextMetal* mtl_context = reinterpret_cast<ContextMetal*>(context);
-	id<MTLDevice> mtl_device = mtl_context->getDevice();
-	m_mtlTexture = [mtl_device newTextureWithDescriptor:m_mtlTextureDesc];
+	// ストレージを再指定する場合は、古いMTLTextureを最後に使用したサブミッションの完了後に再利用させる
+	recycleUsedTexture(mtl_context);
+	m_mtlTexture = mtl_context->newPooledTexture(m_mtlTextureDesc);
 	// MTLTextureを再生成したことからdirty
 	m_dirty = true;
 	if (m_mtlTexture == nil) {
@@ -673,7 +946,8 @@ bool TextureMetal::createStorageCube(BackendContext* context, GLsizei levels, GL
 {
 	// NOTE: glTexImage*,glTexStorage* を呼び出す前にテクスチャパラメータ（サンプラパラメータは含まない）を設定する前提の処理
 	MTLPixelFormat pixel_format = convert_internalformat(internalformat);
-	MTLTextureUsage texture_usage = MTLTextureUsageShaderRead;
+	// MTLTextureUsageRenderTarget: フェイスをフレームバッファにアタッチ、glCopyTexSubImage2Dの描画先とすることを想定
+	MTLTextureUsage texture_usage = MTLTextureUsageShaderRead | MTLTextureUsageRenderTarget;
 #if TARGET_OS_IPHONE
 	MTLStorageMode storage_mode = MTLStorageModeShared;
 #else
@@ -699,9 +973,11 @@ bool TextureMetal::createStorageCube(BackendContext* context, GLsizei levels, GL
 	};
 	[m_mtlTextureDesc setSwizzle:mtl_swizzle];
 	// MTLTextureを作成
+	// NOTE: 削除されたテクスチャ、レンダーバッファの同じ構成のストレージがあれば再利用する
 	ContextMetal* mtl_context = reinterpret_cast<ContextMetal*>(context);
-	id<MTLDevice> mtl_device = mtl_context->getDevice();
-	m_mtlTexture = [mtl_device newTextureWithDescriptor:m_mtlTextureDesc];
+	// ストレージを再指定する場合は、古いMTLTextureを最後に使用したサブミッションの完了後に再利用させる
+	recycleUsedTexture(mtl_context);
+	m_mtlTexture = mtl_context->newPooledTexture(m_mtlTextureDesc);
 	// MTLTextureを再生成したことからdirty
 	m_dirty = true;
 	if (m_mtlTexture == nil) {
@@ -715,7 +991,8 @@ bool TextureMetal::createStorage3D(BackendContext* context, GLsizei levels, GLen
 {
 	// NOTE: glTexImage*,glTexStorage* を呼び出す前にテクスチャパラメータ（サンプラパラメータは含まない）を設定する前提の処理
 	MTLPixelFormat pixel_format = convert_internalformat(internalformat);
-	MTLTextureUsage texture_usage = MTLTextureUsageShaderRead;
+	// MTLTextureUsageRenderTarget: レイヤーをフレームバッファにアタッチすることを想定
+	MTLTextureUsage texture_usage = MTLTextureUsageShaderRead | MTLTextureUsageRenderTarget;
 #if TARGET_OS_IPHONE
 	MTLStorageMode storage_mode = MTLStorageModeShared;
 #else
@@ -742,9 +1019,11 @@ bool TextureMetal::createStorage3D(BackendContext* context, GLsizei levels, GLen
 	};
 	[m_mtlTextureDesc setSwizzle:mtl_swizzle];
 	// MTLTextureを作成
+	// NOTE: 削除されたテクスチャ、レンダーバッファの同じ構成のストレージがあれば再利用する
 	ContextMetal* mtl_context = reinterpret_cast<ContextMetal*>(context);
-	id<MTLDevice> mtl_device = mtl_context->getDevice();
-	m_mtlTexture = [mtl_device newTextureWithDescriptor:m_mtlTextureDesc];
+	// ストレージを再指定する場合は、古いMTLTextureを最後に使用したサブミッションの完了後に再利用させる
+	recycleUsedTexture(mtl_context);
+	m_mtlTexture = mtl_context->newPooledTexture(m_mtlTextureDesc);
 	// MTLTextureを再生成したことからdirty
 	m_dirty = true;
 	if (m_mtlTexture == nil) {
@@ -774,6 +1053,13 @@ bool TextureMetal::generateMipmap(BackendContext* context, const TextureParamete
 	// generateMipmapsForTextureを実行
 	ContextMetal* context_metal = static_cast<ContextMetal*>(context);
 	AXGL_ASSERT(context_metal != nullptr);
+	// 記録中の描画コマンド(ピクセルアンパックバッファからの転送等)を先に実行させる
+	context_metal->flush();
+	waitForAsyncUpload();
+	if (!is_blit_mipmap_supported(context_metal->getDevice(), [m_mtlTexture pixelFormat])) {
+		// ブリットコマンドで生成できないフォーマットはCPUで生成
+		return generateMipmapOnCPU(context_metal);
+	}
 	id<MTLCommandQueue> command_queue = context_metal->getCommandQueue();
 	AXGL_ASSERT(command_queue != nil);
 	id<MTLCommandBuffer> command_buffer = [command_queue commandBuffer];
@@ -787,8 +1073,338 @@ bool TextureMetal::generateMipmap(BackendContext* context, const TextureParamete
 	return true;
 }
 
+size_t TextureMetal::getMemorySize() const
+{
+	if (m_mtlTexture == nil) {
+		return 0;
+	}
+	// NOTE: アライメント等を含む、実際に確保されたサイズ
+	return [m_mtlTexture allocatedSize];
+}
+
+bool TextureMetal::copyImage2D(BackendContext* context, GLenum target, GLint level, GLenum internalformat,
+	GLint x, GLint y, GLsizei width, GLsizei height, BackendFramebuffer* readFramebuffer, GLenum readBuffer, const TextureParameters* params)
+{
+	AXGL_ASSERT(params != nullptr);
+	MTLTextureType texture_type = (target == GL_TEXTURE_2D) ? MTLTextureType2D : MTLTextureTypeCube;
+	// ストレージが変化したかをチェック
+	bool texture_changed = isStorageChanged(texture_type, level, internalformat, width, height, 1);
+	if ((m_mtlTexture == nil) || texture_changed) {
+		int lv0_width  = width;
+		int lv0_height = height;
+		if (level != 0) {
+			// レベル0のサイズを算出
+			calc_lv0_size_2d(width, height, level, &lv0_width, &lv0_height);
+		}
+		// ミップマップレベル数
+		int num_level = calc_num_level_2d(lv0_width, lv0_height);
+		// 2D,Cubeストレージを作成
+		if (texture_type == MTLTextureType2D) {
+			createStorage2D(context, num_level, internalformat, lv0_width, lv0_height, params);
+		} else {
+			createStorageCube(context, num_level, internalformat, lv0_width, lv0_height, params);
+		}
+	}
+	NSUInteger slice = (texture_type == MTLTextureType2D) ? 0 : get_slice_value(target);
+	// フレームバッファからのコピー
+	return copyFromFramebuffer(context, level, slice, 0, 0, x, y, width, height, readFramebuffer, readBuffer);
+}
+
+bool TextureMetal::copySubImage2D(BackendContext* context, GLenum target, GLint level, GLint xoffset, GLint yoffset,
+	GLint x, GLint y, GLsizei width, GLsizei height, BackendFramebuffer* readFramebuffer, GLenum readBuffer)
+{
+	if (m_mtlTexture == nil) {
+		return false;
+	}
+	// TextureType
+	MTLTextureType texture_type = (target == GL_TEXTURE_2D) ? MTLTextureType2D : MTLTextureTypeCube;
+	if (texture_type != [m_mtlTextureDesc textureType]) {
+		return false;
+	}
+	// コピー先の範囲がレベルのイメージに収まるか
+	int tex_width  = calc_image_size(level, (int)[m_mtlTextureDesc width]);
+	int tex_height = calc_image_size(level, (int)[m_mtlTextureDesc height]);
+	if ((level >= (GLint)[m_mtlTextureDesc mipmapLevelCount]) || (xoffset < 0) || (yoffset < 0)
+		|| ((xoffset + width) > tex_width) || ((yoffset + height) > tex_height)) {
+		return false;
+	}
+	NSUInteger slice = (texture_type == MTLTextureType2D) ? 0 : get_slice_value(target);
+	// フレームバッファからのコピー
+	return copyFromFramebuffer(context, level, slice, xoffset, yoffset, x, y, width, height, readFramebuffer, readBuffer);
+}
+
+// CPUでミップマップを生成する(レベル0を読み出して、生成した各レベルを書き戻す)
+bool TextureMetal::generateMipmapOnCPU(BackendContext* context)
+{
+	MTLTextureType texture_type = [m_mtlTexture textureType];
+	MipmapPixelFormat mipmap_format = get_mipmap_pixel_format([m_mtlTexture pixelFormat]);
+	if (mipmap_format == MipmapPixelFormatInvalid) {
+		AXGL_DBGOUT("TextureMetal::generateMipmapOnCPU> unsupported format:%d\n", (int)[m_mtlTexture pixelFormat]);
+		return false;
+	}
+	NSUInteger levels = [m_mtlTexture mipmapLevelCount];
+	if (levels <= 1) {
+		return true;
+	}
+	ContextMetal* context_metal = static_cast<ContextMetal*>(context);
+	AXGL_ASSERT(context_metal != nullptr);
+	// レベル0への描画、転送の完了を待つ
+	context_metal->finish();
+#if (TARGET_OS_IPHONE == 0)
+	// Managedストレージは、GPUで書き込んだ内容をCPUから参照できるように同期する
+	if ([m_mtlTexture storageMode] == MTLStorageModeManaged) {
+		id<MTLCommandBuffer> command_buffer = [context_metal->getCommandQueue() commandBuffer];
+		AXGL_ASSERT(command_buffer != nil);
+		id<MTLBlitCommandEncoder> blit_encoder = [command_buffer blitCommandEncoder];
+		AXGL_ASSERT(blit_encoder != nil);
+		[blit_encoder synchronizeResource:m_mtlTexture];
+		[blit_encoder endEncoding];
+		[command_buffer commit];
+		[command_buffer waitUntilCompleted];
+	}
+#endif
+	NSUInteger width = [m_mtlTexture width];
+	NSUInteger height = [m_mtlTexture height];
+	size_t pixel_size = getMipmapPixelSize(mipmap_format);
+	if (texture_type == MTLTextureType3D) {
+		// 3Dはボリューム全体のミップマップチェーンを生成
+		NSUInteger depth = [m_mtlTexture depth];
+		uint8_t* chain = static_cast<uint8_t*>(AXGL_ALLOC(getMipmapChainSize3D(mipmap_format,
+			(uint32_t)width, (uint32_t)height, (uint32_t)depth, (uint32_t)levels)));
+		if (chain == nullptr) {
+			AXGL_DBGOUT("TextureMetal::generateMipmapOnCPU> AXGL_ALLOC failed\n");
+			return false;
+		}
+		[m_mtlTexture getBytes:chain bytesPerRow:(pixel_size * width) bytesPerImage:(pixel_size * width * height)
+			fromRegion:MTLRegionMake3D(0, 0, 0, width, height, depth) mipmapLevel:0 slice:0];
+		generateMipmapChain3D(mipmap_format, chain, (uint32_t)width, (uint32_t)height, (uint32_t)depth, (uint32_t)levels);
+		const uint8_t* level_data = chain;
+		for (NSUInteger level = 1; level < levels; level++) {
+			level_data += pixel_size * calc_image_size((int)level - 1, (int)width) * calc_image_size((int)level - 1, (int)height)
+				* calc_image_size((int)level - 1, (int)depth);
+			NSUInteger level_width = calc_image_size((int)level, (int)width);
+			NSUInteger level_height = calc_image_size((int)level, (int)height);
+			NSUInteger level_depth = calc_image_size((int)level, (int)depth);
+			NSUInteger bytes_per_row = pixel_size * level_width;
+			replace_texture_region(m_mtlTexture, MTLRegionMake3D(0, 0, 0, level_width, level_height, level_depth), (GLint)level, 0,
+				level_data, bytes_per_row, bytes_per_row * level_height);
+		}
+		AXGL_FREE(chain);
+		return true;
+	}
+	NSUInteger slices = (texture_type == MTLTextureTypeCube) ? 6 : [m_mtlTexture arrayLength];
+	// 各スライスのミップマップチェーンを格納するバッファ
+	uint8_t* chain = static_cast<uint8_t*>(AXGL_ALLOC(getMipmapChainSize(mipmap_format, (uint32_t)width, (uint32_t)height, (uint32_t)levels)));
+	if (chain == nullptr) {
+		AXGL_DBGOUT("TextureMetal::generateMipmapOnCPU> AXGL_ALLOC failed\n");
+		return false;
+	}
+	for (NSUInteger slice = 0; slice < slices; slice++) {
+		[m_mtlTexture getBytes:chain bytesPerRow:(pixel_size * width) bytesPerImage:(pixel_size * width * height)
+			fromRegion:MTLRegionMake2D(0, 0, width, height) mipmapLevel:0 slice:slice];
+		generateMipmapChain(mipmap_format, chain, (uint32_t)width, (uint32_t)height, (uint32_t)levels);
+		const uint8_t* level_data = chain;
+		for (NSUInteger level = 1; level < levels; level++) {
+			level_data += pixel_size * calc_image_size((int)level - 1, (int)width) * calc_image_size((int)level - 1, (int)height);
+			NSUInteger level_width = calc_image_size((int)level, (int)width);
+			NSUInteger level_height = calc_image_size((int)level, (int)height);
+			NSUInteger bytes_per_row = pixel_size * level_width;
+			replace_texture_region(m_mtlTexture, MTLRegionMake2D(0, 0, level_width, level_height), (GLint)level, slice,
+				level_data, bytes_per_row, bytes_per_row * level_height);
+		}
+	}
+	AXGL_FREE(chain);
+	return true;
+}
+
+// クライアントメモリのピクセルデータを転送する(フォーマット変換を含む)
+void TextureMetal::uploadPixels(BackendContext* context, GLint level, NSUInteger slice, const MTLRegion& region,
+	GLenum format, GLenum type, const void* pixels, const UnpackParameters* unpack)
+{
+	if ((m_mtlTexture == nil) || (pixels == nullptr)
+		|| (region.size.width == 0) || (region.size.height == 0) || (region.size.depth == 0)) {
+		return;
+	}
+	GLsizei width = (GLsizei)region.size.width;
+	GLsizei height = (GLsizei)region.size.height;
+	GLsizei depth = (GLsizei)region.size.depth;
+	// フォーマット変換が必要か
+	int converted_format = 0;
+	int converted_data_type = 0;
+	ConvertType convert_type = get_convert_type(format, type, &converted_format, &converted_data_type);
+	// アンパックパラメータからソースデータのレイアウトを取得
+	NSUInteger bytes_per_pixel = get_unpack_bytes_per_pixel(convert_type, format, type);
+	UnpackLayout layout = get_unpack_layout(pixels, width, height, bytes_per_pixel, unpack);
+	// NOTE: GPUで転送中の場合は、CPUから書き換える前に完了を待つ
+	waitForPendingCopy(context);
+	// 大きな転送は、ステージングメモリにコピーしてワーカースレッドで変換と転送を行う
+	TextureUploadQueue& upload_queue = TextureUploadQueue::getInstance();
+	size_t src_size = (layout.bytesPerImage * (depth - 1)) + (layout.bytesPerRow * (height - 1)) + (bytes_per_pixel * width);
+	size_t converted_size = (convert_type != ConvertTypeNone) ? (static_cast<size_t>(width) * height * depth * 4) : 0;
+	if (upload_queue.shouldUploadAsync(src_size + converted_size)) {
+		TextureUploadTaskMetal* task = upload_queue.createTask<TextureUploadTaskMetal>(src_size + converted_size);
+		if (task != nullptr) {
+			memcpy(task->getStagingMemory(), layout.pixels, src_size);
+			task->texture = m_mtlTexture;
+			task->region = region;
+			task->level = level;
+			task->slice = slice;
+			task->convertType = convert_type;
+			task->bytesPerRow = layout.bytesPerRow;
+			task->bytesPerImage = layout.bytesPerImage;
+			task->convertedOffset = src_size;
+			// NOTE: 同じテクスチャへの転送は登録順に実行される
+			uint64_t ticket = upload_queue.enqueue(task, src_size);
+			if (ticket != 0) {
+				m_asyncUploadTicket = ticket;
+				return;
+			}
+		}
+	}
+	// ワーカースレッドでの転送が未完了の場合は、完了を待ってから書き換える
+	waitForAsyncUpload();
+	// フォーマット変換が必要な場合は実行
+	uint8_t* convert_work_buf = nullptr;
+	if (convert_type != ConvertTypeNone) {
+		// 変換したデータは詰めて格納する
+		convert_work_buf = convertPixels(width, height, depth, convert_type, layout.pixels, layout.bytesPerRow, layout.bytesPerImage);
+		format = converted_format;
+		type = converted_data_type;
+		layout.pixels = convert_work_buf;
+		layout.bytesPerRow = get_bytes_per_pixel(format, type) * width;
+		layout.bytesPerImage = layout.bytesPerRow * height;
+	}
+	// テクスチャイメージを設定
+	if (layout.pixels != nullptr) {
+		replace_texture_region(m_mtlTexture, region, level, slice, layout.pixels, layout.bytesPerRow, layout.bytesPerImage);
+	}
+	// ワークを作成している場合は解放
+	release_convert_work(convert_work_buf);
+	return;
+}
+
+bool TextureMetal::uploadFromUnpackBuffer(BackendContext* context, GLint level, NSUInteger slice, const MTLRegion& region,
+	GLenum format, GLenum type, const void** pixels, const UnpackParameters* unpack)
+{
+	AXGL_ASSERT((context != nullptr) && (pixels != nullptr) && (unpack != nullptr) && (unpack->buffer != nullptr));
+	ContextMetal* mtl_context = static_cast<ContextMetal*>(context);
+	BufferMetal* unpack_buffer = static_cast<BufferMetal*>(unpack->buffer);
+	// NOTE: pixelsはバッファ先頭からのオフセット
+	size_t buffer_offset = reinterpret_cast<uintptr_t>(*pixels);
+	*pixels = nullptr;
+	if ((m_mtlTexture == nil) || (region.size.width == 0) || (region.size.height == 0) || (region.size.depth == 0)) {
+		return true;
+	}
+	// アンパックパラメータからバッファ内のレイアウトを取得
+	int converted_format = 0;
+	int converted_data_type = 0;
+	ConvertType convert_type = get_convert_type(format, type, &converted_format, &converted_data_type);
+	NSUInteger bytes_per_pixel = get_unpack_bytes_per_pixel(convert_type, format, type);
+	UnpackLayout layout = get_unpack_layout(nullptr, (GLsizei)region.size.width, (GLsizei)region.size.height, bytes_per_pixel, unpack);
+	size_t src_offset = buffer_offset + layout.skipBytes;
+	// 読み出す範囲がバッファに収まるか
+	size_t src_end = src_offset + (layout.bytesPerImage * (region.size.depth - 1))
+		+ (layout.bytesPerRow * (region.size.height - 1)) + (bytes_per_pixel * region.size.width);
+	if (src_end > unpack_buffer->getBufferDataSize()) {
+		AXGL_DBGOUT("TextureMetal::uploadFromUnpackBuffer> out of buffer range\n");
+		return false;
+	}
+	// フォーマット変換が不要で、Blitのアライメント要件を満たす場合はGPUで転送
+	bool use_blit = (convert_type == ConvertTypeNone) && (format != GL_DEPTH_STENCIL) && (bytes_per_pixel > 0)
+		&& ((src_offset % bytes_per_pixel) == 0) && ((layout.bytesPerRow % bytes_per_pixel) == 0);
+	if (use_blit) {
+		// NOTE: ワーカースレッドでの転送の後に上書きするため、完了を待ってから記録する
+		waitForAsyncUpload();
+		// NOTE: イメージ毎のピッチは3Dテクスチャのみ指定する
+		NSUInteger bytes_per_image = ([m_mtlTexture textureType] == MTLTextureType3D) ? layout.bytesPerImage : 0;
+		if (mtl_context->copyBufferToTexture(unpack_buffer, src_offset, layout.bytesPerRow, bytes_per_image,
+			m_mtlTexture, slice, level, region)) {
+			// 記録中のサブミッションで転送される
+			m_pendingCopySerial = mtl_context->getSubmissionSerial().getPendingSerial();
+			setLastUsedSerial(&mtl_context->getSubmissionSerial(), m_pendingCopySerial);
+			return true;
+		}
+	}
+	// GPUで転送できない場合は、バッファのデータからCPUで転送する
+	// NOTE: スキップ分は呼び出し側でアンパックパラメータから適用する
+	unpack_buffer->resolveGpuWrite(mtl_context, true);
+	const uint8_t* data = unpack_buffer->getOriginalData();
+	if (data != nullptr) {
+		*pixels = data + buffer_offset;
+	}
+	return false;
+}
+
+// リードフレームバッファのカラーバッファからGPUでコピーする
+bool TextureMetal::copyFromFramebuffer(BackendContext* context, GLint level, NSUInteger slice, GLint xoffset, GLint yoffset,
+	GLint x, GLint y, GLsizei width, GLsizei height, BackendFramebuffer* readFramebuffer, GLenum readBuffer)
+{
+	AXGL_ASSERT(context != nullptr);
+	if ((m_mtlTexture == nil) || (width <= 0) || (height <= 0)) {
+		return true;
+	}
+	ContextMetal* mtl_context = static_cast<ContextMetal*>(context);
+	// NOTE: ワーカースレッドでの転送の後に上書きするため、完了を待ってから記録する
+	waitForAsyncUpload();
+	if (!mtl_context->copyFramebufferToTexture(readFramebuffer, readBuffer, x, y, width, height,
+		m_mtlTexture, slice, level, xoffset, yoffset)) {
+		return false;
+	}
+	// 記録中のサブミッションで転送される
+	m_pendingCopySerial = mtl_context->getSubmissionSerial().getPendingSerial();
+	setLastUsedSerial(&mtl_context->getSubmissionSerial(), m_pendingCopySerial);
+	return true;
+}
+
+// GPUでの転送が未完了の場合は、CPUから書き換える前に完了を待つ
+// NOTE: replaceRegionはコマンドバッファの順序に従わないため、後から実行される転送で上書きされるのを防ぐ
+void TextureMetal::waitForPendingCopy(BackendContext* context)
+{
+	if (m_pendingCopySerial == 0) {
+		return;
+	}
+	ContextMetal* mtl_context = static_cast<ContextMetal*>(context);
+	if (!mtl_context->getSubmissionSerial().isCompleted(m_pendingCopySerial)) {
+		mtl_context->finish();
+	}
+	m_pendingCopySerial = 0;
+	return;
+}
+
+// ワーカースレッドでの転送が未完了の場合は完了を待つ
+void TextureMetal::waitForAsyncUpload() const
+{
+	if (m_asyncUploadTicket != 0) {
+		TextureUploadQueue::getInstance().wait(m_asyncUploadTicket);
+	}
+	return;
+}
+
+// 現在のMTLTextureを、最後に使用したサブミッションの完了後に再利用させる
+void TextureMetal::recycleUsedTexture(ContextMetal* context)
+{
+	AXGL_ASSERT(context != nullptr);
+	if (m_mtlTexture == nil) {
+		return;
+	}
+	// NOTE: ワーカースレッドでの転送が完了してから再利用させる
+	waitForAsyncUpload();
+	// NOTE: 他のコンテキストが最後に使用した場合は、再利用できる時期を判定できないため返却しない(ARCによって破棄させる)
+	if ((m_lastUsedSerial == 0) || (m_lastUsedSerialSource == &context->getSubmissionSerial())) {
+		context->recycleTexture(m_mtlTexture, m_lastUsedSerial);
+	}
+	m_mtlTexture = nil;
+	m_lastUsedSerial = 0;
+	m_lastUsedSerialSource = nullptr;
+	// NOTE: 古いMTLTextureへの転送の完了を待つ必要はない
+	m_pendingCopySerial = 0;
+	return;
+}
+
 id<MTLTexture> TextureMetal::getMtlTexture() const
 {
+	// NOTE: 描画等でGPUが使用する前に、ワーカースレッドでの転送の完了を待つ
+	waitForAsyncUpload();
 	return m_mtlTexture;
 }
 
@@ -806,6 +1422,13 @@ bool TextureMetal::isDirty() const
 	return m_dirty;
 }
 
+void TextureMetal::setLastUsedSerial(const SubmissionSerial* submissionSerial, uint64_t serial)
+{
+	m_lastUsedSerial = serial;
+	m_lastUsedSerialSource = submissionSerial;
+	return;
+}
+
 void TextureMetal::clearDirty()
 {
 	m_dirty = false;
@@ -843,6 +1466,13 @@ bool TextureMetal::isSubImageAcceptable(MTLTextureType mtltype, GLint level, GLi
 		return false;
 	}
 	// PixelFormat
+	// NOTE: CPUで変換するフォーマットは変換後のフォーマットで比較
+	int converted_format = 0;
+	int converted_data_type = 0;
+	if (get_convert_type(format, type, &converted_format, &converted_data_type) != ConvertTypeNone) {
+		format = converted_format;
+		type = converted_data_type;
+	}
 	MTLPixelFormat img_format = get_pixel_format(format, type);
 	if (img_format != [m_mtlTextureDesc pixelFormat]) {
 		return false;
@@ -861,24 +1491,12 @@ bool TextureMetal::isSubImageAcceptable(MTLTextureType mtltype, GLint level, GLi
 	return true;
 }
 
-uint8_t* TextureMetal::convertPixels(int w, int h, int d, int convertType, const void* pixels)
+uint8_t* TextureMetal::convertPixels(int w, int h, int d, int convertType, const void* pixels, size_t bytesPerRow, size_t bytesPerImage)
 {
 	uint8_t* work_buf = nullptr;
 	AXGL_ASSERT(pixels != nullptr);
-	switch (convertType) {
-	case ConvertTypeRGB2RGBA:
-		if (!convert_rgb_to_rgba(w, h, d, static_cast<const uint8_t*>(pixels), &work_buf, 0xff)) {
-			AXGL_DBGOUT("RGB2RGBA> convert_rgb_to_rgba() failed\n");
-		}
-		break;
-	case ConvertTypeRGB2RGBAInt:
-		if (!convert_rgb_to_rgba(w, h, d, static_cast<const uint8_t*>(pixels), &work_buf, 1)) {
-			AXGL_DBGOUT("RGB2RGBAInt> convert_rgb_to_rgba() failed\n");
-		}
-		break;
-	default:
-		AXGL_ASSERT(0);
-		break;
+	if (!convert_to_rgba(static_cast<ConvertType>(convertType), w, h, d, static_cast<const uint8_t*>(pixels), bytesPerRow, bytesPerImage, &work_buf)) {
+		AXGL_DBGOUT("convertPixels> convert_to_rgba() failed type:%d\n", convertType);
 	}
 	return work_buf;
 }
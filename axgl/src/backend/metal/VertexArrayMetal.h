@@ -27,6 +27,11 @@ public:
 	// Attributeパラメータ構造体
 	struct AttribParamMetal {
 		MTLVertexFormat format = MTLVertexFormatInvalid;
+		int32_t type = 0;
+		int32_t size = 0;
+		bool normalized = false;
+		// NOTE: CPUでフォーマット変換したバッファを使用する(formatは変換後のフォーマット)
+		bool formatConversion = false;
 		uint32_t offset = 0;
 		uint32_t stride = 0;
 		uint32_t divisor = 0;
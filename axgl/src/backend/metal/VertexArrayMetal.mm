@@ -3,6 +3,7 @@
 #include "ContextMetal.h"
 #include "BufferMetal.h"
 #include "../../AXGLAllocatorImpl.h"
+#include "../../common/VertexConversion.h"
 
 namespace axgl {
 
@@ -60,9 +61,13 @@ void VertexArrayMetal::setVertexAttrib(uint32_t index, int32_t size, int32_t typ
 	AttribParamMetal* dst = &m_attribParams[index];
 	MTLVertexFormat format_metal = convert_vertex_format(type, size, (normalized == GL_TRUE));
 	dst->format = format_metal;
+	dst->type = type;
+	dst->size = size;
+	dst->normalized = (normalized == GL_TRUE);
+	dst->formatConversion = needVertexFormatConversion(type, normalized);
 	dst->offset = offset;
 	if (stride == 0) {
-		stride = get_size_from_gltype(type) * size;
+		stride = getVertexAttribSize(type, size);
 	}
 	dst->stride = stride;
 	dst->buffer = static_cast<BufferMetal*>(buffer);
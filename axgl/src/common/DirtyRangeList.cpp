@@ -0,0 +1,127 @@
+﻿// DirtyRangeList.cpp
+#include "DirtyRangeList.h"
+
+#include <string.h>
+#include <algorithm>
+
+namespace axgl {
+
+DirtyRangeList::DirtyRangeList()
+{
+}
+
+DirtyRangeList::~DirtyRangeList()
+{
+}
+
+void DirtyRangeList::add(intptr_t start, intptr_t end)
+{
+	AXGL_ASSERT(start <= end);
+	// 範囲全体を更新
+	if (m_start == m_end) {
+		m_start = start;
+		m_end = end;
+	} else {
+		m_start = std::min(m_start, start);
+		m_end = std::max(m_end, end);
+	}
+	m_updateCount++;
+	// 重なる、もしくは隣接する範囲は結合して保持する
+	// NOTE: 最初に見つかった範囲を広げ、それと重なる以降の範囲を取り除く(範囲同士は重ならない)
+	Range* merged = nullptr;
+	for (auto it = m_ranges.begin(); it != m_ranges.end();) {
+		if ((it->start <= end) && (start <= it->end)) {
+			start = std::min(start, it->start);
+			end = std::max(end, it->end);
+			if (merged == nullptr) {
+				merged = &(*it);
+				++it;
+			} else {
+				it = m_ranges.erase(it);
+			}
+			merged->start = start;
+			merged->end = end;
+		} else {
+			++it;
+		}
+	}
+	if (merged != nullptr) {
+		return;
+	}
+	if (m_ranges.size() < c_range_max) {
+		Range range = {start, end};
+		m_ranges.push_back(range);
+	} else {
+		// 範囲数が上限を超える場合は全体の範囲1つにまとめる
+		m_ranges.clear();
+		Range range = {m_start, m_end};
+		m_ranges.push_back(range);
+	}
+	return;
+}
+
+void DirtyRangeList::clear()
+{
+	m_ranges.clear();
+	m_start = 0;
+	m_end = 0;
+	m_updateCount = 0;
+	return;
+}
+
+bool DirtyRangeList::empty() const
+{
+	return m_ranges.empty();
+}
+
+const AXGLVector<DirtyRangeList::Range>& DirtyRangeList::getRanges() const
+{
+	return m_ranges;
+}
+
+intptr_t DirtyRangeList::getStart() const
+{
+	return m_start;
+}
+
+intptr_t DirtyRangeList::getEnd() const
+{
+	return m_end;
+}
+
+uint32_t DirtyRangeList::getUpdateCount() const
+{
+	return m_updateCount;
+}
+
+bool DirtyRangeList::getAlignedExtent(size_t dataSize, size_t capacity, size_t* start, size_t* end) const
+{
+	AXGL_ASSERT((start != nullptr) && (end != nullptr));
+	size_t aligned_start = static_cast<size_t>(m_start) & ~static_cast<size_t>(3);
+	size_t aligned_end = (std::min(static_cast<size_t>(m_end), dataSize) + 3) & ~static_cast<size_t>(3);
+	if ((aligned_start >= aligned_end) || (aligned_end > capacity)) {
+		return false;
+	}
+	*start = aligned_start;
+	*end = aligned_end;
+	return true;
+}
+
+void DirtyRangeList::gatherExtent(uint8_t* dst, const uint8_t* src, size_t srcSize, size_t start, size_t end)
+{
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr) && (start <= end));
+	// NOTE: 範囲の隙間も最新の内容のため、範囲全体を1回でコピーする
+	size_t src_end = std::min(end, srcSize);
+	if (start < src_end) {
+		memcpy(dst, src + start, src_end - start);
+	} else {
+		src_end = start;
+	}
+	if (src_end < end) {
+		// データの終端から4バイト境界までの余白
+		memset(dst + (src_end - start), 0, end - src_end);
+	}
+	return;
+}
+
+} // namespace axgl
@@ -0,0 +1,50 @@
+﻿// DirtyRangeList.h
+#ifndef __DirtyRangeList_h_
+#define __DirtyRangeList_h_
+
+#include "axglCommon.h"
+
+namespace axgl {
+
+// バッファの書き換えられた範囲を管理するクラス
+// NOTE: 重なる、もしくは隣接する範囲は結合し、範囲数が上限を超える場合は全体の範囲1つにまとめる
+class DirtyRangeList
+{
+public:
+	struct Range {
+		intptr_t start;
+		intptr_t end;
+	};
+	static constexpr size_t c_range_max = 16;
+
+public:
+	DirtyRangeList();
+	~DirtyRangeList();
+	// 書き換えた範囲[start, end)を追加
+	void add(intptr_t start, intptr_t end);
+	// 全ての範囲を破棄
+	void clear();
+	bool empty() const;
+	// 結合済みの範囲を取得
+	const AXGLVector<Range>& getRanges() const;
+	// 全ての範囲を含む範囲を取得
+	intptr_t getStart() const;
+	intptr_t getEnd() const;
+	// clear後に追加された回数を取得
+	uint32_t getUpdateCount() const;
+	// 全ての範囲を含む範囲を、4バイト単位に揃えて取得する(Blitのオフセットとサイズの制約)
+	// NOTE: 終端はdataSizeで制限してから揃える、揃えた終端がcapacityを超える場合はfalseを返す
+	bool getAlignedExtent(size_t dataSize, size_t capacity, size_t* start, size_t* end) const;
+	// srcの[start, end)をdstにまとめてコピーする(srcSizeを超える部分は0で埋める)
+	static void gatherExtent(uint8_t* dst, const uint8_t* src, size_t srcSize, size_t start, size_t end);
+
+private:
+	AXGLVector<Range> m_ranges;
+	intptr_t m_start = 0;
+	intptr_t m_end = 0;
+	uint32_t m_updateCount = 0;
+};
+
+} // namespace axgl
+
+#endif // __DirtyRangeList_h_
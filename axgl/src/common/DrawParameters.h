@@ -121,6 +121,8 @@ struct DrawParameters {
 	CoreSampler* samplers[AXGL_MAX_COMBINED_TEXTURE_IMAGE_UNITS] = {0};
 	// vertex buffer
 	CoreBuffer* vertexBuffer[AXGL_MAX_VERTEX_ATTRIBS] = {0};
+	// client-side vertex arrays (used when vertexBuffer is not bound)
+	const void* clientArrayPointer[AXGL_MAX_VERTEX_ATTRIBS] = {0};
 	// framebuffer
 	CoreFramebuffer* framebufferDraw = nullptr;
 	// index buffer
@@ -129,6 +131,8 @@ struct DrawParameters {
 	CoreVertexArray* vertexArray = nullptr;
 	// stencil reference value
 	StencilReference stencilReference;
+	// primitive restart (GL_PRIMITIVE_RESTART_FIXED_INDEX)
+	GLboolean primitiveRestartFixedIndex = GL_FALSE;
 	// dirty flags
 	uint32_t dirtyFlags = DIRTY_FLAGS_ALL;
 };
@@ -0,0 +1,458 @@
+﻿// IndexConversion.cpp
+#include "IndexConversion.h"
+#include "axglCommon.h"
+
+#include <string.h>
+#include <algorithm>
+#include <limits>
+
+#if defined(AXGL_INDEX_CONVERSION_NEON)
+#include <arm_neon.h>
+#elif defined(AXGL_INDEX_CONVERSION_SSE2)
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#endif
+
+namespace axgl {
+
+// TriangleFan変換のスカラー実装(triangleから末尾まで)
+template <typename SRC, typename DST>
+static inline void convert_tri_fan_scalar(DST* dst, const SRC* src, size_t triangle, size_t numTriangle)
+{
+	const DST center_index = static_cast<DST>(src[0]);
+	DST* dp = dst + (triangle * 3);
+	for (size_t i = triangle; i < numTriangle; i++) {
+		dp[0] = center_index;
+		dp[1] = static_cast<DST>(src[i + 1]);
+		dp[2] = static_cast<DST>(src[i + 2]);
+		dp += 3;
+	}
+	return;
+}
+
+// 最小値と最大値のスカラー実装(startから末尾まで)
+// NOTE: 最大値はbiasを加算した値(オーバーフローで折り返す)で比較する
+template <typename T>
+static inline void scan_index_range_scalar(const T* src, size_t start, size_t count, T bias, T* minValue, T* maxBiased)
+{
+	T min_value = *minValue;
+	T max_biased = *maxBiased;
+	for (size_t i = start; i < count; i++) {
+		min_value = std::min(min_value, src[i]);
+		max_biased = std::max(max_biased, static_cast<T>(src[i] + bias));
+	}
+	*minValue = min_value;
+	*maxBiased = max_biased;
+	return;
+}
+
+// SIMDレーンの最小値と最大値を集約
+template <typename T>
+static inline void reduce_index_range_lanes(const T* minLanes, const T* maxLanes, size_t numLanes, T* minValue, T* maxBiased)
+{
+	for (size_t i = 0; i < numLanes; i++) {
+		*minValue = std::min(*minValue, minLanes[i]);
+		*maxBiased = std::max(*maxBiased, maxLanes[i]);
+	}
+	return;
+}
+
+// 走査結果から最小値と最大値を設定
+// NOTE: リスタートインデックス(型の最大値)はbiasの加算で0に折り返すため、最大値の候補から外れる
+template <typename T>
+static inline void finish_index_range(size_t count, T minValue, T maxBiased, T bias, uint32_t* minIndex, uint32_t* maxIndex)
+{
+	if ((count == 0) || ((bias != 0) && (maxBiased == 0))) {
+		// 有効なインデックスがない
+		*minIndex = UINT32_MAX;
+		*maxIndex = 0;
+	} else {
+		*minIndex = minValue;
+		*maxIndex = static_cast<T>(maxBiased - bias);
+	}
+	return;
+}
+
+// リスタートインデックスで区切られたTriangleFanを三角形リストに変換する
+template <typename SRC, typename DST>
+static size_t convert_tri_fan_restart(DST* dst, const SRC* src, size_t count, void (*convertFunc)(DST*, const SRC*, size_t))
+{
+	const SRC restart_index = std::numeric_limits<SRC>::max();
+	size_t written = 0;
+	size_t start = 0;
+	for (size_t i = 0; i <= count; i++) {
+		if ((i == count) || (src[i] == restart_index)) {
+			// 区間毎に独立したTriangleFanとして変換(3頂点未満の区間は描画されない)
+			size_t num_indices = i - start;
+			if (num_indices >= 3) {
+				convertFunc(dst + written, src + start, num_indices);
+				written += (num_indices - 2) * 3;
+			}
+			start = i + 1;
+		}
+	}
+	return written;
+}
+
+// リスタートインデックスで区切られたLineLoopを、リスタートを含むLineStripに変換する
+template <typename SRC, typename DST>
+static size_t convert_line_loop_restart(DST* dst, const SRC* src, size_t count)
+{
+	const SRC restart_index = std::numeric_limits<SRC>::max();
+	const DST dst_restart_index = std::numeric_limits<DST>::max();
+	size_t written = 0;
+	size_t start = 0;
+	for (size_t i = 0; i <= count; i++) {
+		if ((i == count) || (src[i] == restart_index)) {
+			// 区間毎に先頭のインデックスを末尾に追加してループを閉じる(2頂点未満の区間は描画されない)
+			size_t num_indices = i - start;
+			if (num_indices >= 2) {
+				if (written > 0) {
+					dst[written++] = dst_restart_index;
+				}
+				for (size_t j = start; j < i; j++) {
+					dst[written++] = static_cast<DST>(src[j]);
+				}
+				dst[written++] = static_cast<DST>(src[start]);
+			}
+			start = i + 1;
+		}
+	}
+	return written;
+}
+
+// uint8のインデックスをuint16に拡張する
+void widenIndicesU8ToU16(uint16_t* dst, const uint8_t* src, size_t count)
+{
+	AXGL_ASSERT((count == 0) || ((dst != nullptr) && (src != nullptr)));
+	size_t i = 0;
+#if defined(AXGL_INDEX_CONVERSION_NEON)
+	for (; (i + 16) <= count; i += 16) {
+		uint8x16_t v = vld1q_u8(src + i);
+		vst1q_u16(dst + i, vmovl_u8(vget_low_u8(v)));
+		vst1q_u16(dst + i + 8, vmovl_u8(vget_high_u8(v)));
+	}
+#elif defined(AXGL_INDEX_CONVERSION_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	for (; (i + 16) <= count; i += 16) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(v, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(v, zero));
+	}
+#endif
+	for (; i < count; i++) {
+		dst[i] = src[i];
+	}
+	return;
+}
+
+// uint8のインデックスをuint16に拡張する(0xFFは0xFFFFに変換)
+void widenIndicesU8ToU16Restart(uint16_t* dst, const uint8_t* src, size_t count)
+{
+	AXGL_ASSERT((count == 0) || ((dst != nullptr) && (src != nullptr)));
+	size_t i = 0;
+#if defined(AXGL_INDEX_CONVERSION_NEON)
+	// 上位バイトに0xFFとの比較結果(0x00 or 0xFF)をインターリーブしてストア
+	const uint8x16_t restart = vdupq_n_u8(UINT8_MAX);
+	for (; (i + 16) <= count; i += 16) {
+		uint8x16x2_t v;
+		v.val[0] = vld1q_u8(src + i);
+		v.val[1] = vceqq_u8(v.val[0], restart);
+		vst2q_u8(reinterpret_cast<uint8_t*>(dst + i), v);
+	}
+#elif defined(AXGL_INDEX_CONVERSION_SSE2)
+	const __m128i restart = _mm_set1_epi8(static_cast<char>(UINT8_MAX));
+	for (; (i + 16) <= count; i += 16) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		__m128i hi = _mm_cmpeq_epi8(v, restart);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(v, hi));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(v, hi));
+	}
+#endif
+	for (; i < count; i++) {
+		dst[i] = (src[i] == UINT8_MAX) ? UINT16_MAX : src[i];
+	}
+	return;
+}
+
+// uint8のTriangleFanインデックスをuint16の三角形リストに変換する
+void convertTriFanIndicesU8(uint16_t* dst, const uint8_t* src, size_t count)
+{
+	if (count < 3) {
+		return;
+	}
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	const size_t num_triangle = count - 2;
+	size_t i = 0;
+#if defined(AXGL_INDEX_CONVERSION_NEON)
+	// 8三角形ずつ、3要素インターリーブでストア
+	uint16x8x3_t v;
+	v.val[0] = vdupq_n_u16(src[0]);
+	for (; (i + 8) <= num_triangle; i += 8) {
+		v.val[1] = vmovl_u8(vld1_u8(src + i + 1));
+		v.val[2] = vmovl_u8(vld1_u8(src + i + 2));
+		vst3q_u16(dst + (i * 3), v);
+	}
+#endif
+	// NOTE: SSE2には3要素インターリーブのストアがないため、スカラー実装を使用
+	convert_tri_fan_scalar(dst, src, i, num_triangle);
+	return;
+}
+
+// uint16のTriangleFanインデックスを三角形リストに変換する
+void convertTriFanIndicesU16(uint16_t* dst, const uint16_t* src, size_t count)
+{
+	if (count < 3) {
+		return;
+	}
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	const size_t num_triangle = count - 2;
+	size_t i = 0;
+#if defined(AXGL_INDEX_CONVERSION_NEON)
+	uint16x8x3_t v;
+	v.val[0] = vdupq_n_u16(src[0]);
+	for (; (i + 8) <= num_triangle; i += 8) {
+		v.val[1] = vld1q_u16(src + i + 1);
+		v.val[2] = vld1q_u16(src + i + 2);
+		vst3q_u16(dst + (i * 3), v);
+	}
+#endif
+	convert_tri_fan_scalar(dst, src, i, num_triangle);
+	return;
+}
+
+// uint32のTriangleFanインデックスを三角形リストに変換する
+void convertTriFanIndicesU32(uint32_t* dst, const uint32_t* src, size_t count)
+{
+	if (count < 3) {
+		return;
+	}
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	const size_t num_triangle = count - 2;
+	size_t i = 0;
+#if defined(AXGL_INDEX_CONVERSION_NEON)
+	uint32x4x3_t v;
+	v.val[0] = vdupq_n_u32(src[0]);
+	for (; (i + 4) <= num_triangle; i += 4) {
+		v.val[1] = vld1q_u32(src + i + 1);
+		v.val[2] = vld1q_u32(src + i + 2);
+		vst3q_u32(dst + (i * 3), v);
+	}
+#endif
+	convert_tri_fan_scalar(dst, src, i, num_triangle);
+	return;
+}
+
+// リスタートで区切られたuint8のTriangleFanインデックスをuint16の三角形リストに変換する
+size_t convertTriFanIndicesRestartU8(uint16_t* dst, const uint8_t* src, size_t count)
+{
+	AXGL_ASSERT((count == 0) || ((dst != nullptr) && (src != nullptr)));
+	return convert_tri_fan_restart(dst, src, count, convertTriFanIndicesU8);
+}
+
+// リスタートで区切られたuint16のTriangleFanインデックスを三角形リストに変換する
+size_t convertTriFanIndicesRestartU16(uint16_t* dst, const uint16_t* src, size_t count)
+{
+	AXGL_ASSERT((count == 0) || ((dst != nullptr) && (src != nullptr)));
+	return convert_tri_fan_restart(dst, src, count, convertTriFanIndicesU16);
+}
+
+// リスタートで区切られたuint32のTriangleFanインデックスを三角形リストに変換する
+size_t convertTriFanIndicesRestartU32(uint32_t* dst, const uint32_t* src, size_t count)
+{
+	AXGL_ASSERT((count == 0) || ((dst != nullptr) && (src != nullptr)));
+	return convert_tri_fan_restart(dst, src, count, convertTriFanIndicesU32);
+}
+
+// uint8のLineLoopインデックスをuint16のLineStripに変換する
+void convertLineLoopIndicesU8(uint16_t* dst, const uint8_t* src, size_t count)
+{
+	if (count == 0) {
+		return;
+	}
+	widenIndicesU8ToU16(dst, src, count);
+	// 先頭のインデックスを末尾に追加してループを閉じる
+	dst[count] = src[0];
+	return;
+}
+
+// uint16のLineLoopインデックスをLineStripに変換する
+void convertLineLoopIndicesU16(uint16_t* dst, const uint16_t* src, size_t count)
+{
+	if (count == 0) {
+		return;
+	}
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	memcpy(dst, src, count * sizeof(uint16_t));
+	dst[count] = src[0];
+	return;
+}
+
+// uint32のLineLoopインデックスをLineStripに変換する
+void convertLineLoopIndicesU32(uint32_t* dst, const uint32_t* src, size_t count)
+{
+	if (count == 0) {
+		return;
+	}
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	memcpy(dst, src, count * sizeof(uint32_t));
+	dst[count] = src[0];
+	return;
+}
+
+// リスタートで区切られたuint8のLineLoopインデックスをuint16のLineStripに変換する
+size_t convertLineLoopIndicesRestartU8(uint16_t* dst, const uint8_t* src, size_t count)
+{
+	AXGL_ASSERT((count == 0) || ((dst != nullptr) && (src != nullptr)));
+	return convert_line_loop_restart(dst, src, count);
+}
+
+// リスタートで区切られたuint16のLineLoopインデックスをLineStripに変換する
+size_t convertLineLoopIndicesRestartU16(uint16_t* dst, const uint16_t* src, size_t count)
+{
+	AXGL_ASSERT((count == 0) || ((dst != nullptr) && (src != nullptr)));
+	return convert_line_loop_restart(dst, src, count);
+}
+
+// リスタートで区切られたuint32のLineLoopインデックスをLineStripに変換する
+size_t convertLineLoopIndicesRestartU32(uint32_t* dst, const uint32_t* src, size_t count)
+{
+	AXGL_ASSERT((count == 0) || ((dst != nullptr) && (src != nullptr)));
+	return convert_line_loop_restart(dst, src, count);
+}
+
+// uint8インデックスの最小値と最大値を取得する
+void scanIndexRangeU8(const uint8_t* src, size_t count, bool primitiveRestart, uint32_t* minIndex, uint32_t* maxIndex)
+{
+	AXGL_ASSERT((minIndex != nullptr) && (maxIndex != nullptr));
+	const uint8_t bias = primitiveRestart ? 1 : 0;
+	uint8_t min_value = UINT8_MAX;
+	uint8_t max_biased = 0;
+	size_t i = 0;
+#if defined(AXGL_INDEX_CONVERSION_NEON) || defined(AXGL_INDEX_CONVERSION_SSE2)
+	if (count >= 16) {
+		alignas(16) uint8_t min_lanes[16];
+		alignas(16) uint8_t max_lanes[16];
+#if defined(AXGL_INDEX_CONVERSION_NEON)
+		const uint8x16_t vbias = vdupq_n_u8(bias);
+		uint8x16_t vmin = vdupq_n_u8(UINT8_MAX);
+		uint8x16_t vmax = vdupq_n_u8(0);
+		for (; (i + 16) <= count; i += 16) {
+			uint8x16_t v = vld1q_u8(src + i);
+			vmin = vminq_u8(vmin, v);
+			vmax = vmaxq_u8(vmax, vaddq_u8(v, vbias));
+		}
+		vst1q_u8(min_lanes, vmin);
+		vst1q_u8(max_lanes, vmax);
+#else
+		const __m128i vbias = _mm_set1_epi8(static_cast<char>(bias));
+		__m128i vmin = _mm_set1_epi8(static_cast<char>(UINT8_MAX));
+		__m128i vmax = _mm_setzero_si128();
+		for (; (i + 16) <= count; i += 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			vmin = _mm_min_epu8(vmin, v);
+			vmax = _mm_max_epu8(vmax, _mm_add_epi8(v, vbias));
+		}
+		_mm_store_si128(reinterpret_cast<__m128i*>(min_lanes), vmin);
+		_mm_store_si128(reinterpret_cast<__m128i*>(max_lanes), vmax);
+#endif
+		// レーンの集約
+		reduce_index_range_lanes(min_lanes, max_lanes, 16, &min_value, &max_biased);
+	}
+#endif
+	scan_index_range_scalar(src, i, count, bias, &min_value, &max_biased);
+	finish_index_range(count, min_value, max_biased, bias, minIndex, maxIndex);
+	return;
+}
+
+// uint16インデックスの最小値と最大値を取得する
+void scanIndexRangeU16(const uint16_t* src, size_t count, bool primitiveRestart, uint32_t* minIndex, uint32_t* maxIndex)
+{
+	AXGL_ASSERT((minIndex != nullptr) && (maxIndex != nullptr));
+	const uint16_t bias = primitiveRestart ? 1 : 0;
+	uint16_t min_value = UINT16_MAX;
+	uint16_t max_biased = 0;
+	size_t i = 0;
+#if defined(AXGL_INDEX_CONVERSION_NEON) || defined(AXGL_INDEX_CONVERSION_SSE2)
+	if (count >= 8) {
+		alignas(16) uint16_t min_lanes[8];
+		alignas(16) uint16_t max_lanes[8];
+#if defined(AXGL_INDEX_CONVERSION_NEON)
+		const uint16x8_t vbias = vdupq_n_u16(bias);
+		uint16x8_t vmin = vdupq_n_u16(UINT16_MAX);
+		uint16x8_t vmax = vdupq_n_u16(0);
+		for (; (i + 8) <= count; i += 8) {
+			uint16x8_t v = vld1q_u16(src + i);
+			vmin = vminq_u16(vmin, v);
+			vmax = vmaxq_u16(vmax, vaddq_u16(v, vbias));
+		}
+		vst1q_u16(min_lanes, vmin);
+		vst1q_u16(max_lanes, vmax);
+#else
+		// NOTE: SSE2には符号なし16bitのmin/maxがないため、符号反転して符号付きで比較
+		const __m128i sign = _mm_set1_epi16(static_cast<short>(0x8000));
+		const __m128i vbias = _mm_set1_epi16(static_cast<short>(bias));
+		__m128i vmin = _mm_set1_epi16(0x7fff);
+		__m128i vmax = _mm_set1_epi16(static_cast<short>(0x8000));
+		for (; (i + 8) <= count; i += 8) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			vmin = _mm_min_epi16(vmin, _mm_xor_si128(v, sign));
+			vmax = _mm_max_epi16(vmax, _mm_xor_si128(_mm_add_epi16(v, vbias), sign));
+		}
+		_mm_store_si128(reinterpret_cast<__m128i*>(min_lanes), _mm_xor_si128(vmin, sign));
+		_mm_store_si128(reinterpret_cast<__m128i*>(max_lanes), _mm_xor_si128(vmax, sign));
+#endif
+		reduce_index_range_lanes(min_lanes, max_lanes, 8, &min_value, &max_biased);
+	}
+#endif
+	scan_index_range_scalar(src, i, count, bias, &min_value, &max_biased);
+	finish_index_range(count, min_value, max_biased, bias, minIndex, maxIndex);
+	return;
+}
+
+// uint32インデックスの最小値と最大値を取得する
+void scanIndexRangeU32(const uint32_t* src, size_t count, bool primitiveRestart, uint32_t* minIndex, uint32_t* maxIndex)
+{
+	AXGL_ASSERT((minIndex != nullptr) && (maxIndex != nullptr));
+	const uint32_t bias = primitiveRestart ? 1 : 0;
+	uint32_t min_value = UINT32_MAX;
+	uint32_t max_biased = 0;
+	size_t i = 0;
+#if defined(AXGL_INDEX_CONVERSION_NEON) || (defined(AXGL_INDEX_CONVERSION_SSE2) && defined(__SSE4_1__))
+	if (count >= 4) {
+		alignas(16) uint32_t min_lanes[4];
+		alignas(16) uint32_t max_lanes[4];
+#if defined(AXGL_INDEX_CONVERSION_NEON)
+		const uint32x4_t vbias = vdupq_n_u32(bias);
+		uint32x4_t vmin = vdupq_n_u32(UINT32_MAX);
+		uint32x4_t vmax = vdupq_n_u32(0);
+		for (; (i + 4) <= count; i += 4) {
+			uint32x4_t v = vld1q_u32(src + i);
+			vmin = vminq_u32(vmin, v);
+			vmax = vmaxq_u32(vmax, vaddq_u32(v, vbias));
+		}
+		vst1q_u32(min_lanes, vmin);
+		vst1q_u32(max_lanes, vmax);
+#else
+		const __m128i vbias = _mm_set1_epi32(static_cast<int>(bias));
+		__m128i vmin = _mm_set1_epi32(-1);
+		__m128i vmax = _mm_setzero_si128();
+		for (; (i + 4) <= count; i += 4) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			vmin = _mm_min_epu32(vmin, v);
+			vmax = _mm_max_epu32(vmax, _mm_add_epi32(v, vbias));
+		}
+		_mm_store_si128(reinterpret_cast<__m128i*>(min_lanes), vmin);
+		_mm_store_si128(reinterpret_cast<__m128i*>(max_lanes), vmax);
+#endif
+		reduce_index_range_lanes(min_lanes, max_lanes, 4, &min_value, &max_biased);
+	}
+#endif
+	scan_index_range_scalar(src, i, count, bias, &min_value, &max_biased);
+	finish_index_range(count, min_value, max_biased, bias, minIndex, maxIndex);
+	return;
+}
+
+} // namespace axgl
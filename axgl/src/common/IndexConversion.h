@@ -0,0 +1,53 @@
+﻿// IndexConversion.h
+#ifndef __IndexConversion_h_
+#define __IndexConversion_h_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// SIMD実装の選択(コンパイル時)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AXGL_INDEX_CONVERSION_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#define AXGL_INDEX_CONVERSION_SSE2 1
+#endif
+
+namespace axgl {
+
+// uint8のインデックスをuint16に拡張する
+void widenIndicesU8ToU16(uint16_t* dst, const uint8_t* src, size_t count);
+// uint8のインデックスをuint16に拡張する(プリミティブリスタート用に0xFFを0xFFFFに変換)
+void widenIndicesU8ToU16Restart(uint16_t* dst, const uint8_t* src, size_t count);
+
+// TriangleFanのインデックスを三角形リストに変換する
+// NOTE: dstには 3 * (count - 2) 個のインデックスが書き込まれる
+void convertTriFanIndicesU8(uint16_t* dst, const uint8_t* src, size_t count);
+void convertTriFanIndicesU16(uint16_t* dst, const uint16_t* src, size_t count);
+void convertTriFanIndicesU32(uint32_t* dst, const uint32_t* src, size_t count);
+// リスタートインデックスで区切られたTriangleFanのインデックスを三角形リストに変換する
+// NOTE: 書き込んだインデックス数(最大 3 * (count - 2) 個)を返す
+size_t convertTriFanIndicesRestartU8(uint16_t* dst, const uint8_t* src, size_t count);
+size_t convertTriFanIndicesRestartU16(uint16_t* dst, const uint16_t* src, size_t count);
+size_t convertTriFanIndicesRestartU32(uint32_t* dst, const uint32_t* src, size_t count);
+
+// LineLoopのインデックスをLineStripに変換する
+// NOTE: dstには count + 1 個のインデックスが書き込まれる
+void convertLineLoopIndicesU8(uint16_t* dst, const uint8_t* src, size_t count);
+void convertLineLoopIndicesU16(uint16_t* dst, const uint16_t* src, size_t count);
+void convertLineLoopIndicesU32(uint32_t* dst, const uint32_t* src, size_t count);
+// リスタートインデックスで区切られたLineLoopのインデックスを、リスタートを含むLineStripに変換する
+// NOTE: 書き込んだインデックス数(最大 2 * count 個)を返す
+size_t convertLineLoopIndicesRestartU8(uint16_t* dst, const uint8_t* src, size_t count);
+size_t convertLineLoopIndicesRestartU16(uint16_t* dst, const uint16_t* src, size_t count);
+size_t convertLineLoopIndicesRestartU32(uint32_t* dst, const uint32_t* src, size_t count);
+
+// インデックスの最小値と最大値を取得する
+// NOTE: primitiveRestartが有効な場合はリスタートインデックス(型の最大値)を除外する
+// NOTE: 有効なインデックスがない場合は minIndex > maxIndex となる値を返す
+void scanIndexRangeU8(const uint8_t* src, size_t count, bool primitiveRestart, uint32_t* minIndex, uint32_t* maxIndex);
+void scanIndexRangeU16(const uint16_t* src, size_t count, bool primitiveRestart, uint32_t* minIndex, uint32_t* maxIndex);
+void scanIndexRangeU32(const uint32_t* src, size_t count, bool primitiveRestart, uint32_t* minIndex, uint32_t* maxIndex);
+
+} // namespace axgl
+
+#endif // __IndexConversion_h_
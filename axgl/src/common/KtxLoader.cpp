@@ -0,0 +1,387 @@
+﻿// KtxLoader.cpp
+#include "KtxLoader.h"
+#include "TextureTranscoder.h"
+
+#include <string.h>
+#include <algorithm>
+
+namespace axgl {
+
+// ファイル識別子
+static const uint8_t c_ktx1_identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+static const uint8_t c_ktx2_identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+// ヘッダのサイズ(KTX2はレベルインデックスを含まない)
+static constexpr size_t c_ktx1_header_size = 64;
+static constexpr size_t c_ktx2_header_size = 80;
+static constexpr size_t c_ktx2_level_index_size = 24;
+// KTXのエンディアンの確認用の値
+static constexpr uint32_t c_ktx1_endianness = 0x04030201;
+static constexpr uint32_t c_ktx1_endianness_swapped = 0x01020304;
+// 受け付けるテクスチャのサイズの上限(サイズの計算のオーバーフローを防ぐ)
+static constexpr uint32_t c_ktx_max_size = 16384;
+static constexpr uint32_t c_ktx_max_depth = 2048;
+
+static uint32_t read_u32(const uint8_t* p, bool swap)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	if (swap) {
+		value = ((value & 0x000000FF) << 24) | ((value & 0x0000FF00) << 8)
+			| ((value & 0x00FF0000) >> 8) | ((value & 0xFF000000) >> 24);
+	}
+	return value;
+}
+
+static uint64_t read_u64(const uint8_t* p)
+{
+	uint64_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+// 非圧縮フォーマットの1ピクセルのバイト数を取得(対応していない場合は0)
+static size_t get_pixel_size(GLenum format, GLenum type)
+{
+	// パックされたtype
+	switch (type) {
+	case GL_UNSIGNED_SHORT_5_6_5:
+	case GL_UNSIGNED_SHORT_4_4_4_4:
+	case GL_UNSIGNED_SHORT_5_5_5_1:
+		return 2;
+	case GL_UNSIGNED_INT_2_10_10_10_REV:
+	case GL_UNSIGNED_INT_10F_11F_11F_REV:
+	case GL_UNSIGNED_INT_5_9_9_9_REV:
+	case GL_UNSIGNED_INT_24_8:
+		return 4;
+	case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+		return 8;
+	default:
+		break;
+	}
+	size_t component_size = 0;
+	switch (type) {
+	case GL_UNSIGNED_BYTE:
+	case GL_BYTE:
+		component_size = 1;
+		break;
+	case GL_UNSIGNED_SHORT:
+	case GL_SHORT:
+	case GL_HALF_FLOAT:
+		component_size = 2;
+		break;
+	case GL_UNSIGNED_INT:
+	case GL_INT:
+	case GL_FLOAT:
+		component_size = 4;
+		break;
+	default:
+		return 0;
+	}
+	size_t num_components = 0;
+	switch (format) {
+	case GL_RED:
+	case GL_RED_INTEGER:
+	case GL_ALPHA:
+	case GL_LUMINANCE:
+	case GL_DEPTH_COMPONENT:
+		num_components = 1;
+		break;
+	case GL_RG:
+	case GL_RG_INTEGER:
+	case GL_LUMINANCE_ALPHA:
+		num_components = 2;
+		break;
+	case GL_RGB:
+	case GL_RGB_INTEGER:
+		num_components = 3;
+		break;
+	case GL_RGBA:
+	case GL_RGBA_INTEGER:
+		num_components = 4;
+		break;
+	default:
+		return 0;
+	}
+	return component_size * num_components;
+}
+
+// KTX2のvkFormatをGLのフォーマットに変換
+static bool convert_vk_format(uint32_t vkFormat, KtxTexture* texture)
+{
+	struct VkFormatMapping {
+		uint32_t vkFormat;
+		GLenum internalformat;
+		GLenum format;
+		GLenum type;
+	};
+	static const VkFormatMapping c_vk_format_mappings[] = {
+		{9, GL_R8, GL_RED, GL_UNSIGNED_BYTE}, // VK_FORMAT_R8_UNORM
+		{16, GL_RG8, GL_RG, GL_UNSIGNED_BYTE}, // VK_FORMAT_R8G8_UNORM
+		{23, GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE}, // VK_FORMAT_R8G8B8_UNORM
+		{29, GL_SRGB8, GL_RGB, GL_UNSIGNED_BYTE}, // VK_FORMAT_R8G8B8_SRGB
+		{37, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE}, // VK_FORMAT_R8G8B8A8_UNORM
+		{43, GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE}, // VK_FORMAT_R8G8B8A8_SRGB
+		{64, GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV}, // VK_FORMAT_A2B10G10R10_UNORM_PACK32
+		{76, GL_R16F, GL_RED, GL_HALF_FLOAT}, // VK_FORMAT_R16_SFLOAT
+		{83, GL_RG16F, GL_RG, GL_HALF_FLOAT}, // VK_FORMAT_R16G16_SFLOAT
+		{97, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT}, // VK_FORMAT_R16G16B16A16_SFLOAT
+		{100, GL_R32F, GL_RED, GL_FLOAT}, // VK_FORMAT_R32_SFLOAT
+		{103, GL_RG32F, GL_RG, GL_FLOAT}, // VK_FORMAT_R32G32_SFLOAT
+		{109, GL_RGBA32F, GL_RGBA, GL_FLOAT}, // VK_FORMAT_R32G32B32A32_SFLOAT
+		{122, GL_R11F_G11F_B10F, GL_RGB, GL_UNSIGNED_INT_10F_11F_11F_REV}, // VK_FORMAT_B10G11R11_UFLOAT_PACK32
+		{123, GL_RGB9_E5, GL_RGB, GL_UNSIGNED_INT_5_9_9_9_REV}, // VK_FORMAT_E5B9G9R9_UFLOAT_PACK32
+		{147, GL_COMPRESSED_RGB8_ETC2, 0, 0}, // VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK
+		{148, GL_COMPRESSED_SRGB8_ETC2, 0, 0},
+		{149, GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, 0, 0},
+		{150, GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2, 0, 0},
+		{151, GL_COMPRESSED_RGBA8_ETC2_EAC, 0, 0},
+		{152, GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, 0, 0},
+		{153, GL_COMPRESSED_R11_EAC, 0, 0}, // VK_FORMAT_EAC_R11_UNORM_BLOCK
+		{154, GL_COMPRESSED_SIGNED_R11_EAC, 0, 0},
+		{155, GL_COMPRESSED_RG11_EAC, 0, 0},
+		{156, GL_COMPRESSED_SIGNED_RG11_EAC, 0, 0},
+	};
+	// VK_FORMAT_ASTC_4x4_UNORM_BLOCKからVK_FORMAT_ASTC_12x12_SRGB_BLOCKまで、UNORMとSRGBが交互に並ぶ
+	static constexpr uint32_t c_vk_format_astc_first = 157;
+	static constexpr uint32_t c_vk_format_astc_last = 184;
+	if ((vkFormat >= c_vk_format_astc_first) && (vkFormat <= c_vk_format_astc_last)) {
+		uint32_t index = (vkFormat - c_vk_format_astc_first) / 2;
+		bool srgb = (((vkFormat - c_vk_format_astc_first) & 1) != 0);
+		texture->internalformat = (srgb ? GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR : GL_COMPRESSED_RGBA_ASTC_4x4_KHR) + index;
+		texture->format = 0;
+		texture->type = 0;
+		return true;
+	}
+	for (size_t i = 0; i < sizeof(c_vk_format_mappings) / sizeof(c_vk_format_mappings[0]); i++) {
+		if (c_vk_format_mappings[i].vkFormat == vkFormat) {
+			texture->internalformat = c_vk_format_mappings[i].internalformat;
+			texture->format = c_vk_format_mappings[i].format;
+			texture->type = c_vk_format_mappings[i].type;
+			return true;
+		}
+	}
+	return false;
+}
+
+// テクスチャのターゲット、サイズ、ミップレベル数を設定
+static bool setup_dimensions(KtxTexture* texture, uint32_t width, uint32_t height, uint32_t depth,
+	uint32_t layers, uint32_t faces, uint32_t levels)
+{
+	if ((width == 0) || (width > c_ktx_max_size) || (height > c_ktx_max_size)
+		|| (depth > c_ktx_max_depth) || (layers > c_ktx_max_depth)) {
+		return false;
+	}
+	// NOTE: 1Dテクスチャ(高さ0)は高さ1の2Dテクスチャとして扱う
+	height = std::max(height, 1u);
+	if (faces == 6) {
+		// NOTE: キューブマップ配列はGLES 3.0にない
+		if ((layers != 0) || (depth != 0) || (width != height)) {
+			return false;
+		}
+		texture->target = GL_TEXTURE_CUBE_MAP;
+		texture->depth = 1;
+	} else if (faces != 1) {
+		return false;
+	} else if (depth != 0) {
+		if (layers != 0) {
+			return false;
+		}
+		texture->target = GL_TEXTURE_3D;
+		texture->depth = depth;
+	} else if (layers != 0) {
+		texture->target = GL_TEXTURE_2D_ARRAY;
+		texture->depth = layers;
+	} else {
+		texture->target = GL_TEXTURE_2D;
+		texture->depth = 1;
+	}
+	texture->width = width;
+	texture->height = height;
+	texture->faces = faces;
+	// ミップレベル数が0の場合はレベル0のみ格納されている
+	texture->generateMipmap = (levels == 0);
+	texture->levels = std::max(levels, 1u);
+	uint32_t max_extent = std::max(width, height);
+	if (texture->target == GL_TEXTURE_3D) {
+		max_extent = std::max(max_extent, texture->depth);
+	}
+	uint32_t max_levels = 1;
+	while ((max_extent >> max_levels) != 0) {
+		max_levels++;
+	}
+	return (texture->levels <= std::min(max_levels, c_ktx_max_levels));
+}
+
+// 1つのミップレベルの1つの面のイメージのサイズを取得
+static size_t get_image_size(const KtxTexture* texture, uint32_t level, const CompressedFormatInfo& compressedInfo, size_t pixelSize)
+{
+	uint32_t width = std::max(texture->width >> level, 1u);
+	uint32_t height = std::max(texture->height >> level, 1u);
+	uint32_t depth = (texture->target == GL_TEXTURE_3D) ? std::max(texture->depth >> level, 1u) : texture->depth;
+	if (texture->compressed) {
+		return getCompressedImageSize(compressedInfo, width, height) * depth;
+	}
+	size_t alignment = static_cast<size_t>(texture->alignment);
+	size_t bytes_per_row = (width * pixelSize + alignment - 1) / alignment * alignment;
+	return bytes_per_row * height * depth;
+}
+
+// フォーマットを検証して、イメージサイズの計算に使用する情報を取得
+static bool get_format_size_info(const KtxTexture* texture, CompressedFormatInfo* compressedInfo, size_t* pixelSize)
+{
+	*pixelSize = 0;
+	if (texture->compressed) {
+		// NOTE: 対応している圧縮フォーマットはETC2/EAC、ASTC(GPUが対応していない場合はデコードする)
+		return getCompressedFormatInfo(texture->internalformat, compressedInfo);
+	}
+	*pixelSize = get_pixel_size(texture->format, texture->type);
+	return (*pixelSize != 0);
+}
+
+// KTX(バージョン1)のヘッダを検証してイメージの位置を取得
+static bool parse_ktx1(const uint8_t* data, size_t size, KtxTexture* texture)
+{
+	if (size < c_ktx1_header_size) {
+		return false;
+	}
+	uint32_t endianness = read_u32(data + 12, false);
+	if ((endianness != c_ktx1_endianness) && (endianness != c_ktx1_endianness_swapped)) {
+		return false;
+	}
+	bool swap = (endianness == c_ktx1_endianness_swapped);
+	uint32_t gl_type = read_u32(data + 16, swap);
+	uint32_t gl_type_size = read_u32(data + 20, swap);
+	uint32_t gl_format = read_u32(data + 24, swap);
+	uint32_t gl_internal_format = read_u32(data + 28, swap);
+	uint32_t pixel_width = read_u32(data + 36, swap);
+	uint32_t pixel_height = read_u32(data + 40, swap);
+	uint32_t pixel_depth = read_u32(data + 44, swap);
+	uint32_t array_elements = read_u32(data + 48, swap);
+	uint32_t faces = read_u32(data + 52, swap);
+	uint32_t levels = read_u32(data + 56, swap);
+	uint32_t key_value_bytes = read_u32(data + 60, swap);
+	if (swap && (gl_type_size != 1)) {
+		// NOTE: 2バイト以上の要素のバイトスワップは行わない
+		AXGL_DBGOUT("parseKtxTexture> byte swapping is not supported\n");
+		return false;
+	}
+	texture->compressed = (gl_type == 0) && (gl_format == 0);
+	texture->internalformat = gl_internal_format;
+	texture->format = gl_format;
+	texture->type = gl_type;
+	// NOTE: KTXの非圧縮イメージの行は4バイト境界に揃えられている
+	texture->alignment = 4;
+	if (!setup_dimensions(texture, pixel_width, pixel_height, pixel_depth, array_elements, faces, levels)) {
+		return false;
+	}
+	CompressedFormatInfo compressed_info;
+	size_t pixel_size;
+	if (!get_format_size_info(texture, &compressed_info, &pixel_size)) {
+		AXGL_DBGOUT("parseKtxTexture> unsupported format:0x%04X\n", gl_internal_format);
+		return false;
+	}
+	size_t offset = c_ktx1_header_size;
+	if (key_value_bytes > size - offset) {
+		return false;
+	}
+	offset += key_value_bytes;
+	for (uint32_t level = 0; level < texture->levels; level++) {
+		if (size - offset < sizeof(uint32_t)) {
+			return false;
+		}
+		size_t image_size = read_u32(data + offset, swap);
+		offset += sizeof(uint32_t);
+		// NOTE: キューブマップ(配列以外)のimageSizeは1つの面のサイズ、その他はレベル全体のサイズ
+		if (image_size != get_image_size(texture, level, compressed_info, pixel_size)) {
+			return false;
+		}
+		for (uint32_t face = 0; face < texture->faces; face++) {
+			if (image_size > size - offset) {
+				return false;
+			}
+			texture->images[level][face].data = data + offset;
+			texture->images[level][face].size = image_size;
+			// 面、ミップレベルは4バイト境界に揃えられている
+			offset += (image_size + 3) & ~static_cast<size_t>(3);
+			offset = std::min(offset, size);
+		}
+	}
+	return true;
+}
+
+// KTX2のヘッダを検証してイメージの位置を取得
+static bool parse_ktx2(const uint8_t* data, size_t size, KtxTexture* texture)
+{
+	if (size < c_ktx2_header_size) {
+		return false;
+	}
+	uint32_t vk_format = read_u32(data + 12, false);
+	uint32_t pixel_width = read_u32(data + 20, false);
+	uint32_t pixel_height = read_u32(data + 24, false);
+	uint32_t pixel_depth = read_u32(data + 28, false);
+	uint32_t layers = read_u32(data + 32, false);
+	uint32_t faces = read_u32(data + 36, false);
+	uint32_t levels = read_u32(data + 40, false);
+	uint32_t supercompression = read_u32(data + 44, false);
+	if (supercompression != 0) {
+		// NOTE: 超圧縮(Basis Universal、Zstandard等)されたデータは展開が必要なため直接転送できない
+		AXGL_DBGOUT("parseKtxTexture> supercompression is not supported:%u\n", supercompression);
+		return false;
+	}
+	if (!convert_vk_format(vk_format, texture)) {
+		AXGL_DBGOUT("parseKtxTexture> unsupported vkFormat:%u\n", vk_format);
+		return false;
+	}
+	texture->compressed = (texture->format == 0);
+	// NOTE: KTX2の非圧縮イメージの行には隙間がない
+	texture->alignment = 1;
+	if (!setup_dimensions(texture, pixel_width, pixel_height, pixel_depth, layers, faces, levels)) {
+		return false;
+	}
+	CompressedFormatInfo compressed_info;
+	size_t pixel_size;
+	if (!get_format_size_info(texture, &compressed_info, &pixel_size)) {
+		return false;
+	}
+	if (texture->levels * c_ktx2_level_index_size > size - c_ktx2_header_size) {
+		return false;
+	}
+	for (uint32_t level = 0; level < texture->levels; level++) {
+		const uint8_t* level_index = data + c_ktx2_header_size + level * c_ktx2_level_index_size;
+		uint64_t byte_offset = read_u64(level_index);
+		uint64_t byte_length = read_u64(level_index + 8);
+		if ((byte_offset > size) || (byte_length > size - byte_offset)) {
+			return false;
+		}
+		// NOTE: レベルのデータは配列の要素、面、スライスの順に隙間なく並ぶ
+		size_t image_size = get_image_size(texture, level, compressed_info, pixel_size);
+		if (byte_length != image_size * texture->faces) {
+			return false;
+		}
+		for (uint32_t face = 0; face < texture->faces; face++) {
+			texture->images[level][face].data = data + byte_offset + face * image_size;
+			texture->images[level][face].size = image_size;
+		}
+	}
+	return true;
+}
+
+bool parseKtxTexture(const void* data, size_t size, KtxTexture* texture)
+{
+	AXGL_ASSERT(texture != nullptr);
+	if ((data == nullptr) || (size < sizeof(c_ktx1_identifier))) {
+		return false;
+	}
+	memset(texture, 0, sizeof(*texture));
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	if (memcmp(bytes, c_ktx1_identifier, sizeof(c_ktx1_identifier)) == 0) {
+		return parse_ktx1(bytes, size, texture);
+	}
+	if (memcmp(bytes, c_ktx2_identifier, sizeof(c_ktx2_identifier)) == 0) {
+		return parse_ktx2(bytes, size, texture);
+	}
+	AXGL_DBGOUT("parseKtxTexture> not a KTX file\n");
+	return false;
+}
+
+} // namespace axgl
@@ -0,0 +1,48 @@
+﻿// KtxLoader.h
+#ifndef __KtxLoader_h_
+#define __KtxLoader_h_
+
+#include "axglCommon.h"
+
+namespace axgl {
+
+// KTXファイルに格納できるミップレベル数の上限
+static constexpr uint32_t c_ktx_max_levels = 16;
+
+// 1つのミップレベルの1つの面のイメージ
+// NOTE: 2D配列テクスチャは全ての要素、3Dテクスチャは全てのスライスを含む
+struct KtxImage {
+	const uint8_t* data;
+	size_t size;
+};
+
+// KTX(バージョン1)、KTX2ファイルのテクスチャの情報
+struct KtxTexture {
+	// GL_TEXTURE_2D、GL_TEXTURE_CUBE_MAP、GL_TEXTURE_2D_ARRAY、GL_TEXTURE_3D
+	GLenum target;
+	GLenum internalformat;
+	// 非圧縮フォーマットのformatとtype(圧縮フォーマットの場合は0)
+	GLenum format;
+	GLenum type;
+	bool compressed;
+	uint32_t width;
+	uint32_t height;
+	// 3Dテクスチャの奥行き、2D配列テクスチャの要素数(その他は1)
+	uint32_t depth;
+	uint32_t faces;
+	uint32_t levels;
+	// ファイルにミップレベルが含まれておらず、生成が必要
+	bool generateMipmap;
+	// 非圧縮フォーマットの行のアライメント(GL_UNPACK_ALIGNMENTと同じ意味)
+	GLint alignment;
+	// イメージ(ファイルのデータを直接指す)
+	KtxImage images[c_ktx_max_levels][6];
+};
+
+// KTX、KTX2ファイルのヘッダを検証して、各イメージの位置を取得する
+// NOTE: データはコピーしないため、textureはdataが有効な間のみ使用できる
+bool parseKtxTexture(const void* data, size_t size, KtxTexture* texture);
+
+} // namespace axgl
+
+#endif // __KtxLoader_h_
@@ -0,0 +1,63 @@
+﻿// MappedFile.cpp
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace axgl {
+
+// MappedFileクラスの実装 --------
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const char* path)
+{
+	close();
+	if (path == nullptr) {
+		return false;
+	}
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) {
+		AXGL_DBGOUT("MappedFile::open> open failed:%s\n", path);
+		return false;
+	}
+	struct stat st;
+	if ((fstat(fd, &st) != 0) || (st.st_size <= 0)) {
+		AXGL_DBGOUT("MappedFile::open> invalid file:%s\n", path);
+		::close(fd);
+		return false;
+	}
+	size_t size = static_cast<size_t>(st.st_size);
+	void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// NOTE: マップした後はファイルディスクリプタは不要
+	::close(fd);
+	if (data == MAP_FAILED) {
+		AXGL_DBGOUT("MappedFile::open> mmap failed:%s\n", path);
+		return false;
+	}
+	// 先頭から順に全体を読むことを通知
+	madvise(data, size, MADV_SEQUENTIAL);
+	m_data = static_cast<const uint8_t*>(data);
+	m_size = size;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_data != nullptr) {
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+		m_data = nullptr;
+		m_size = 0;
+	}
+	return;
+}
+
+} // namespace axgl
@@ -0,0 +1,33 @@
+﻿// MappedFile.h
+#ifndef __MappedFile_h_
+#define __MappedFile_h_
+
+#include "axglCommon.h"
+
+namespace axgl {
+
+// 読み込み専用でメモリにマップしたファイル
+// NOTE: ファイルの内容はアクセスした時にページ単位で読み込まれる
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+	// ファイルをマップする(既にマップしている場合は閉じてからマップ)
+	bool open(const char* path);
+	void close();
+	const uint8_t* getData() const { return m_data; }
+	size_t getSize() const { return m_size; }
+
+private:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+private:
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+};
+
+} // namespace axgl
+
+#endif // __MappedFile_h_
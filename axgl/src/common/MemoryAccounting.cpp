@@ -0,0 +1,114 @@
+﻿// MemoryAccounting.cpp
+#include "MemoryAccounting.h"
+#include "../AXGLAllocatorImpl.h"
+
+namespace axgl {
+
+// MemoryAccountingクラスの実装 --------
+MemoryAccounting::MemoryAccounting()
+{
+}
+
+MemoryAccounting::~MemoryAccounting()
+{
+}
+
+MemoryAccounting& MemoryAccounting::getInstance()
+{
+	static MemoryAccounting s_instance;
+	return s_instance;
+}
+
+void MemoryAccounting::setBudget(size_t budget, BudgetCallback callback, void* userData)
+{
+	size_t total_size = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_budget = budget;
+		m_callback = callback;
+		m_userData = userData;
+		total_size = m_totalSize;
+	}
+	// 既に予算を超えている場合は、設定した時点で通知
+	if ((callback != nullptr) && (total_size > budget)) {
+		callback(total_size, budget, userData);
+	}
+	return;
+}
+
+void MemoryAccounting::update(MemoryCategory category, size_t oldSize, size_t newSize)
+{
+	AXGL_ASSERT((category >= 0) && (category < MemoryCategoryCount));
+	if (oldSize == newSize) {
+		return;
+	}
+	BudgetCallback callback = nullptr;
+	void* user_data = nullptr;
+	size_t total_size = 0;
+	size_t budget = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		AXGL_ASSERT(m_categorySize[category] >= oldSize);
+		size_t prev_total_size = m_totalSize;
+		m_categorySize[category] = m_categorySize[category] - oldSize + newSize;
+		m_totalSize = m_totalSize - oldSize + newSize;
+		// 予算を下回っている状態から超えた時のみ通知
+		if ((prev_total_size <= m_budget) && (m_totalSize > m_budget)) {
+			callback = m_callback;
+			user_data = m_userData;
+			total_size = m_totalSize;
+			budget = m_budget;
+		}
+	}
+	// NOTE: コールバックからaxglGetMemorySize()を呼び出せるように、ロックの外で呼び出す
+	if (callback != nullptr) {
+		callback(total_size, budget, user_data);
+	}
+	return;
+}
+
+size_t MemoryAccounting::getTotalSize() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_totalSize;
+}
+
+size_t MemoryAccounting::getCategorySize(MemoryCategory category) const
+{
+	AXGL_ASSERT((category >= 0) && (category < MemoryCategoryCount));
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_categorySize[category];
+}
+
+} // namespace axgl
+
+//-------------------------------------------------------------------
+// メモリの予算とコールバックを設定
+void AXGL_APIENTRY axglSetMemoryBudget(std::size_t budget, AXGLMemoryBudgetCallback callback, void* userData)
+{
+	axgl::MemoryAccounting::getInstance().setBudget(budget, callback, userData);
+	return;
+}
+
+// メモリの使用量を分類毎に取得
+std::size_t AXGL_APIENTRY axglGetMemorySize(AXGLMemoryCategory category)
+{
+	axgl::MemoryAccounting& accounting = axgl::MemoryAccounting::getInstance();
+	switch (category) {
+	case AXGL_MEMORY_TEXTURE:
+		return accounting.getCategorySize(axgl::MemoryCategoryTexture);
+	case AXGL_MEMORY_RENDERBUFFER:
+		return accounting.getCategorySize(axgl::MemoryCategoryRenderbuffer);
+	case AXGL_MEMORY_BUFFER:
+		return accounting.getCategorySize(axgl::MemoryCategoryBuffer);
+	case AXGL_MEMORY_POOL:
+		return accounting.getCategorySize(axgl::MemoryCategoryPool);
+	case AXGL_MEMORY_SHADOW_BUFFER:
+		return accounting.getCategorySize(axgl::MemoryCategoryShadowBuffer);
+	case AXGL_MEMORY_STAGING:
+		return accounting.getCategorySize(axgl::MemoryCategoryStaging);
+	default:
+		break;
+	}
+	return accounting.getTotalSize();
+}
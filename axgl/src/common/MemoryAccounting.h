@@ -0,0 +1,57 @@
+﻿// MemoryAccounting.h
+#ifndef __MemoryAccounting_h_
+#define __MemoryAccounting_h_
+
+#include "axglCommon.h"
+#include <mutex>
+
+namespace axgl {
+
+// メモリの分類
+enum MemoryCategory {
+	MemoryCategoryTexture = 0,
+	MemoryCategoryRenderbuffer = 1,
+	MemoryCategoryBuffer = 2,
+	// 再利用のために保持しているMTLTexture、MTLBuffer
+	MemoryCategoryPool = 3,
+	// バッファのシャドウバッファ(CPUのメモリ)
+	MemoryCategoryShadowBuffer = 4,
+	// 動的バッファ、デフォルトUniformバッファ、テクスチャ転送のステージングメモリ
+	MemoryCategoryStaging = 5,
+	MemoryCategoryCount = 6
+};
+
+// テクスチャ、レンダーバッファ、バッファと、それらのためにaxglが保持するメモリの使用量を集計するクラス
+// NOTE: 各オブジェクトはストレージを確保、解放する毎にサイズの変化を通知する
+class MemoryAccounting
+{
+public:
+	// 使用量が予算を超えた時に呼び出す関数
+	typedef void (*BudgetCallback)(size_t totalSize, size_t budget, void* userData);
+
+public:
+	static MemoryAccounting& getInstance();
+	// 予算とコールバックを設定(SIZE_MAXで無制限)
+	void setBudget(size_t budget, BudgetCallback callback, void* userData);
+	// オブジェクトのサイズの変化を通知
+	void update(MemoryCategory category, size_t oldSize, size_t newSize);
+	// 使用量を取得
+	size_t getTotalSize() const;
+	size_t getCategorySize(MemoryCategory category) const;
+
+private:
+	MemoryAccounting();
+	~MemoryAccounting();
+
+private:
+	mutable std::mutex m_mutex;
+	size_t m_categorySize[MemoryCategoryCount] = {};
+	size_t m_totalSize = 0;
+	size_t m_budget = SIZE_MAX;
+	BudgetCallback m_callback = nullptr;
+	void* m_userData = nullptr;
+};
+
+} // namespace axgl
+
+#endif // __MemoryAccounting_h_
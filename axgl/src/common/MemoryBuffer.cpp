@@ -46,6 +46,7 @@ void MemoryBuffer::releaseResources()
         AXGL_FREE(m_data);
         m_data = nullptr;
     }
+    m_size = 0;
     return;
 }
 
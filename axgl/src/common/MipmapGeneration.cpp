@@ -0,0 +1,649 @@
+﻿// MipmapGeneration.cpp
+#include "MipmapGeneration.h"
+#include "WorkerPool.h"
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#if defined(AXGL_MIPMAP_GENERATION_NEON)
+#include <arm_neon.h>
+#elif defined(AXGL_MIPMAP_GENERATION_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace axgl {
+
+// 複数のスレッドで生成するレベルの最小サイズ(生成するレベルのバイト数)
+static constexpr size_t c_parallel_level_size = 1024 * 1024;
+// 並列に生成する場合の、スレッドあたりの行の分割数
+static constexpr uint32_t c_ranges_per_thread = 4;
+// 線形からsRGBへの変換で、探索の開始位置を引くテーブルのサイズ
+static constexpr uint32_t c_srgb_lookup_size = 4096;
+
+// sRGBと線形の変換テーブル
+struct SrgbTable {
+	float toLinear[256];
+	// NOTE: threshold[i]はsRGBの値iとi+1の境界(i+0.5)を線形に変換した値
+	float threshold[255];
+	// NOTE: lookup[i]は線形の値i / c_srgb_lookup_sizeのsRGBの値(探索の開始位置)
+	uint8_t lookup[c_srgb_lookup_size];
+};
+
+static float srgb_to_linear(double value)
+{
+	double linear = (value <= 0.04045) ? (value / 12.92) : pow((value + 0.055) / 1.055, 2.4);
+	return static_cast<float>(linear);
+}
+
+static const SrgbTable& get_srgb_table()
+{
+	// NOTE: 関数内のstatic変数の初期化はスレッドセーフ
+	static const SrgbTable s_table = []() {
+		SrgbTable table;
+		for (int i = 0; i < 256; i++) {
+			table.toLinear[i] = srgb_to_linear(i / 255.0);
+		}
+		for (int i = 0; i < 255; i++) {
+			table.threshold[i] = srgb_to_linear((i + 0.5) / 255.0);
+		}
+		for (uint32_t i = 0; i < c_srgb_lookup_size; i++) {
+			float linear = static_cast<float>(i) / c_srgb_lookup_size;
+			const float* pos = std::upper_bound(table.threshold, table.threshold + 255, linear);
+			table.lookup[i] = static_cast<uint8_t>(pos - table.threshold);
+		}
+		return table;
+	}();
+	return s_table;
+}
+
+// 線形の値をsRGBの8bitに変換(最も近い値に丸める)
+static inline uint8_t linear_to_srgb8(const SrgbTable& table, float linear)
+{
+	// テーブルで引いた開始位置から境界を越える分だけ進める(sRGBは単調増加のため、数回で収まる)
+	// NOTE: linearは[0, 1]の範囲(sRGBから変換した値の平均)
+	uint32_t index = std::min(static_cast<uint32_t>(linear * c_srgb_lookup_size), c_srgb_lookup_size - 1);
+	uint32_t value = table.lookup[index];
+	while ((value < 255) && (linear >= table.threshold[value])) {
+		value++;
+	}
+	return static_cast<uint8_t>(value);
+}
+
+// 1ピクセルのチャンネル数を取得
+static uint32_t get_channel_count(MipmapPixelFormat format)
+{
+	uint32_t channels = 0;
+	switch (format) {
+	case MipmapPixelFormatR8:
+	case MipmapPixelFormatR32F:
+		channels = 1;
+		break;
+	case MipmapPixelFormatRG8:
+	case MipmapPixelFormatRG32F:
+		channels = 2;
+		break;
+	case MipmapPixelFormatRGBA8:
+	case MipmapPixelFormatSRGB8A8:
+	case MipmapPixelFormatRGBA32F:
+		channels = 4;
+		break;
+	default:
+		AXGL_ASSERT(0);
+		break;
+	}
+	return channels;
+}
+
+//----------------------------------------------------------------------------
+// 8bit unorm/uint
+
+#if defined(AXGL_MIPMAP_GENERATION_SSE2)
+// 16bitレーンの2x2の合計を丸めて8bitに詰める
+static inline __m128i round_pack_sums(__m128i sum_lo, __m128i sum_hi)
+{
+	const __m128i bias = _mm_set1_epi16(2);
+	sum_lo = _mm_srli_epi16(_mm_add_epi16(sum_lo, bias), 2);
+	sum_hi = _mm_srli_epi16(_mm_add_epi16(sum_hi, bias), 2);
+	return _mm_packus_epi16(sum_lo, sum_hi);
+}
+
+// 隣り合うピクセルの合計を16bitレーンの下位64bitに詰める
+static inline __m128i pair_sum_epi16(__m128i sum, uint32_t channels)
+{
+	__m128i pair = sum;
+	if (channels == 4) {
+		// [p0 p1] -> 下位64bitにp0+p1
+		pair = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+	} else {
+		// [p0 p1 p2 p3] -> 32bit単位でp0+p1、p2+p3を下位64bitに集める
+		pair = _mm_add_epi16(sum, _mm_srli_si128(sum, 4));
+		pair = _mm_shuffle_epi32(pair, _MM_SHUFFLE(3, 1, 2, 0));
+	}
+	return pair;
+}
+#endif
+
+// 8bitのピクセルの行を縮小する(SIMDで処理したdstのバイト数を返す)
+static size_t downsample_row_u8_simd(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, size_t dstBytes, uint32_t channels)
+{
+	size_t processed = 0;
+#if defined(AXGL_MIPMAP_GENERATION_NEON)
+	if (channels == 1) {
+		// 32バイトから16ピクセル
+		for (; (processed + 16) <= dstBytes; processed += 16) {
+			const uint8_t* s0 = row0 + (processed * 2);
+			const uint8_t* s1 = row1 + (processed * 2);
+			uint16x8_t sum_lo = vpadalq_u8(vpaddlq_u8(vld1q_u8(s0)), vld1q_u8(s1));
+			uint16x8_t sum_hi = vpadalq_u8(vpaddlq_u8(vld1q_u8(s0 + 16)), vld1q_u8(s1 + 16));
+			vst1q_u8(dst + processed, vcombine_u8(vrshrn_n_u16(sum_lo, 2), vrshrn_n_u16(sum_hi, 2)));
+		}
+	} else if (channels == 2) {
+		// 32バイト(16ピクセル)から8ピクセル
+		for (; (processed + 16) <= dstBytes; processed += 16) {
+			uint8x16x2_t p0 = vld2q_u8(row0 + (processed * 2));
+			uint8x16x2_t p1 = vld2q_u8(row1 + (processed * 2));
+			uint8x8x2_t result;
+			result.val[0] = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(p0.val[0]), p1.val[0]), 2);
+			result.val[1] = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(p0.val[1]), p1.val[1]), 2);
+			vst2_u8(dst + processed, result);
+		}
+	} else {
+		// 64バイト(16ピクセル)から8ピクセル
+		for (; (processed + 32) <= dstBytes; processed += 32) {
+			uint8x16x4_t p0 = vld4q_u8(row0 + (processed * 2));
+			uint8x16x4_t p1 = vld4q_u8(row1 + (processed * 2));
+			uint8x8x4_t result;
+			for (int c = 0; c < 4; c++) {
+				result.val[c] = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(p0.val[c]), p1.val[c]), 2);
+			}
+			vst4_u8(dst + processed, result);
+		}
+	}
+#elif defined(AXGL_MIPMAP_GENERATION_SSE2)
+	// 各行32バイトから16バイト
+	const __m128i zero = _mm_setzero_si128();
+	for (; (processed + 16) <= dstBytes; processed += 16) {
+		const uint8_t* s0 = row0 + (processed * 2);
+		const uint8_t* s1 = row1 + (processed * 2);
+		__m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s0));
+		__m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s0 + 16));
+		__m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s1));
+		__m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s1 + 16));
+		// 縦方向の合計(16bit)
+		__m128i v0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+		__m128i v1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+		__m128i v2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+		__m128i v3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+		// 横方向の合計
+		__m128i sum_lo;
+		__m128i sum_hi;
+		if (channels == 1) {
+			const __m128i ones = _mm_set1_epi16(1);
+			sum_lo = _mm_packs_epi32(_mm_madd_epi16(v0, ones), _mm_madd_epi16(v1, ones));
+			sum_hi = _mm_packs_epi32(_mm_madd_epi16(v2, ones), _mm_madd_epi16(v3, ones));
+		} else {
+			sum_lo = _mm_unpacklo_epi64(pair_sum_epi16(v0, channels), pair_sum_epi16(v1, channels));
+			sum_hi = _mm_unpacklo_epi64(pair_sum_epi16(v2, channels), pair_sum_epi16(v3, channels));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + processed), round_pack_sums(sum_lo, sum_hi));
+	}
+#else
+	AXGL_UNUSED(row0);
+	AXGL_UNUSED(row1);
+	AXGL_UNUSED(dst);
+	AXGL_UNUSED(dstBytes);
+	AXGL_UNUSED(channels);
+#endif
+	return processed;
+}
+
+static void downsample_row_u8(const uint8_t* row0, const uint8_t* row1, uint8_t* dst,
+	uint32_t srcWidth, uint32_t dstWidth, uint32_t channels)
+{
+	size_t dst_bytes = static_cast<size_t>(dstWidth) * channels;
+	size_t start = 0;
+	if (srcWidth >= 2) {
+		start = downsample_row_u8_simd(row0, row1, dst, dst_bytes, channels);
+	}
+	// 残りのピクセル
+	for (uint32_t x = static_cast<uint32_t>(start / channels); x < dstWidth; x++) {
+		// NOTE: 幅が1の場合は同じ列を使用する
+		uint32_t x0 = std::min(x * 2, srcWidth - 1) * channels;
+		uint32_t x1 = std::min((x * 2) + 1, srcWidth - 1) * channels;
+		for (uint32_t c = 0; c < channels; c++) {
+			uint32_t sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+			dst[(x * channels) + c] = static_cast<uint8_t>((sum + 2) >> 2);
+		}
+	}
+	return;
+}
+
+//----------------------------------------------------------------------------
+// sRGB8_A8
+
+static void downsample_row_srgb8a8(const uint8_t* row0, const uint8_t* row1, uint8_t* dst,
+	uint32_t srcWidth, uint32_t dstWidth)
+{
+	const SrgbTable& table = get_srgb_table();
+	for (uint32_t x = 0; x < dstWidth; x++) {
+		uint32_t x0 = std::min(x * 2, srcWidth - 1) * 4;
+		uint32_t x1 = std::min((x * 2) + 1, srcWidth - 1) * 4;
+		uint8_t* dp = dst + (x * 4);
+		// RGBは線形に変換して補間
+		for (uint32_t c = 0; c < 3; c++) {
+			float sum = (table.toLinear[row0[x0 + c]] + table.toLinear[row1[x0 + c]])
+				+ (table.toLinear[row0[x1 + c]] + table.toLinear[row1[x1 + c]]);
+			dp[c] = linear_to_srgb8(table, sum * 0.25f);
+		}
+		// アルファは線形
+		uint32_t alpha = row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3];
+		dp[3] = static_cast<uint8_t>((alpha + 2) >> 2);
+	}
+	return;
+}
+
+//----------------------------------------------------------------------------
+// 32bit float
+
+// floatのピクセルの行を縮小する(SIMDで処理したdstの要素数を返す)
+static size_t downsample_row_f32_simd(const float* row0, const float* row1, float* dst, size_t dstCount, uint32_t channels)
+{
+	size_t processed = 0;
+#if defined(AXGL_MIPMAP_GENERATION_NEON)
+	const float32x4_t quarter = vdupq_n_f32(0.25f);
+	if (channels == 1) {
+		for (; (processed + 4) <= dstCount; processed += 4) {
+			float32x4x2_t p0 = vld2q_f32(row0 + (processed * 2));
+			float32x4x2_t p1 = vld2q_f32(row1 + (processed * 2));
+			float32x4_t sum = vaddq_f32(vaddq_f32(p0.val[0], p1.val[0]), vaddq_f32(p0.val[1], p1.val[1]));
+			vst1q_f32(dst + processed, vmulq_f32(sum, quarter));
+		}
+	} else if (channels == 2) {
+		for (; (processed + 8) <= dstCount; processed += 8) {
+			float32x4x4_t p0 = vld4q_f32(row0 + (processed * 2));
+			float32x4x4_t p1 = vld4q_f32(row1 + (processed * 2));
+			float32x4x2_t result;
+			result.val[0] = vmulq_f32(vaddq_f32(vaddq_f32(p0.val[0], p1.val[0]), vaddq_f32(p0.val[2], p1.val[2])), quarter);
+			result.val[1] = vmulq_f32(vaddq_f32(vaddq_f32(p0.val[1], p1.val[1]), vaddq_f32(p0.val[3], p1.val[3])), quarter);
+			vst2q_f32(dst + processed, result);
+		}
+	} else {
+		for (; (processed + 4) <= dstCount; processed += 4) {
+			const float* s0 = row0 + (processed * 2);
+			const float* s1 = row1 + (processed * 2);
+			float32x4_t sum = vaddq_f32(vaddq_f32(vld1q_f32(s0), vld1q_f32(s1)), vaddq_f32(vld1q_f32(s0 + 4), vld1q_f32(s1 + 4)));
+			vst1q_f32(dst + processed, vmulq_f32(sum, quarter));
+		}
+	}
+#elif defined(AXGL_MIPMAP_GENERATION_SSE2)
+	const __m128 quarter = _mm_set1_ps(0.25f);
+	for (; (processed + 4) <= dstCount; processed += 4) {
+		const float* s0 = row0 + (processed * 2);
+		const float* s1 = row1 + (processed * 2);
+		// 縦方向の合計
+		__m128 v0 = _mm_add_ps(_mm_loadu_ps(s0), _mm_loadu_ps(s1));
+		__m128 v1 = _mm_add_ps(_mm_loadu_ps(s0 + 4), _mm_loadu_ps(s1 + 4));
+		// 横方向の合計
+		__m128 sum;
+		if (channels == 1) {
+			sum = _mm_add_ps(_mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1)));
+		} else if (channels == 2) {
+			sum = _mm_add_ps(_mm_movelh_ps(v0, v1), _mm_movehl_ps(v1, v0));
+		} else {
+			sum = _mm_add_ps(v0, v1);
+		}
+		_mm_storeu_ps(dst + processed, _mm_mul_ps(sum, quarter));
+	}
+#else
+	AXGL_UNUSED(row0);
+	AXGL_UNUSED(row1);
+	AXGL_UNUSED(dst);
+	AXGL_UNUSED(dstCount);
+	AXGL_UNUSED(channels);
+#endif
+	return processed;
+}
+
+static void downsample_row_f32(const float* row0, const float* row1, float* dst,
+	uint32_t srcWidth, uint32_t dstWidth, uint32_t channels)
+{
+	size_t dst_count = static_cast<size_t>(dstWidth) * channels;
+	size_t start = 0;
+	if (srcWidth >= 2) {
+		start = downsample_row_f32_simd(row0, row1, dst, dst_count, channels);
+	}
+	// 残りのピクセル
+	for (uint32_t x = static_cast<uint32_t>(start / channels); x < dstWidth; x++) {
+		uint32_t x0 = std::min(x * 2, srcWidth - 1) * channels;
+		uint32_t x1 = std::min((x * 2) + 1, srcWidth - 1) * channels;
+		for (uint32_t c = 0; c < channels; c++) {
+			float sum = (row0[x0 + c] + row1[x0 + c]) + (row0[x1 + c] + row1[x1 + c]);
+			dst[(x * channels) + c] = sum * 0.25f;
+		}
+	}
+	return;
+}
+
+//----------------------------------------------------------------------------
+
+// 生成するレベルの情報
+struct MipmapLevelJob {
+	MipmapPixelFormat format;
+	const uint8_t* src;
+	size_t srcBytesPerRow;
+	uint32_t srcWidth;
+	uint32_t srcHeight;
+	uint8_t* dst;
+	size_t dstBytesPerRow;
+	uint32_t dstWidth;
+};
+
+// dstの行[startRow, endRow)を生成
+static void generate_level_rows(const MipmapLevelJob& job, uint32_t startRow, uint32_t endRow)
+{
+	uint32_t channels = get_channel_count(job.format);
+	for (uint32_t y = startRow; y < endRow; y++) {
+		// NOTE: 高さが1の場合は同じ行を使用する
+		const uint8_t* row0 = job.src + (job.srcBytesPerRow * std::min(y * 2, job.srcHeight - 1));
+		const uint8_t* row1 = job.src + (job.srcBytesPerRow * std::min((y * 2) + 1, job.srcHeight - 1));
+		uint8_t* dst = job.dst + (job.dstBytesPerRow * y);
+		switch (job.format) {
+		case MipmapPixelFormatR8:
+		case MipmapPixelFormatRG8:
+		case MipmapPixelFormatRGBA8:
+			downsample_row_u8(row0, row1, dst, job.srcWidth, job.dstWidth, channels);
+			break;
+		case MipmapPixelFormatSRGB8A8:
+			downsample_row_srgb8a8(row0, row1, dst, job.srcWidth, job.dstWidth);
+			break;
+		case MipmapPixelFormatR32F:
+		case MipmapPixelFormatRG32F:
+		case MipmapPixelFormatRGBA32F:
+			downsample_row_f32(reinterpret_cast<const float*>(row0), reinterpret_cast<const float*>(row1),
+				reinterpret_cast<float*>(dst), job.srcWidth, job.dstWidth, channels);
+			break;
+		default:
+			AXGL_ASSERT(0);
+			break;
+		}
+	}
+	return;
+}
+
+// WorkerPoolから呼ばれる
+static void generate_level_range(void* userData, uint32_t begin, uint32_t end)
+{
+	generate_level_rows(*static_cast<const MipmapLevelJob*>(userData), begin, end);
+	return;
+}
+
+// 1レベルを生成(大きなレベルは行を分割して複数のスレッドで生成)
+static void generate_level(const MipmapLevelJob& job, uint32_t dstHeight, bool parallel)
+{
+	if (!parallel || ((job.dstBytesPerRow * dstHeight) < c_parallel_level_size)) {
+		generate_level_rows(job, 0, dstHeight);
+		return;
+	}
+	WorkerPool& worker_pool = WorkerPool::getInstance();
+	uint32_t num_ranges = worker_pool.getConcurrency() * c_ranges_per_thread;
+	uint32_t rows_per_range = (dstHeight + num_ranges - 1) / num_ranges;
+	worker_pool.parallelFor(dstHeight, rows_per_range, generate_level_range, const_cast<MipmapLevelJob*>(&job));
+	return;
+}
+
+//----------------------------------------------------------------------------
+// 3D
+
+// 生成する3Dのレベルの情報
+struct MipmapLevelJob3D {
+	MipmapPixelFormat format;
+	const uint8_t* src;
+	size_t srcBytesPerRow;
+	size_t srcBytesPerImage;
+	uint32_t srcWidth;
+	uint32_t srcHeight;
+	uint32_t srcDepth;
+	uint8_t* dst;
+	size_t dstBytesPerRow;
+	size_t dstBytesPerImage;
+	uint32_t dstWidth;
+	uint32_t dstHeight;
+};
+
+// 2つのスライスの2行ずつ(rows[0..3])から1行を生成
+// NOTE: 3Dテクスチャのミップマップの生成は頻度が低いため、スカラーで処理する
+static void downsample_row_3d(MipmapPixelFormat format, const uint8_t* const rows[4], uint8_t* dst,
+	uint32_t srcWidth, uint32_t dstWidth)
+{
+	uint32_t channels = get_channel_count(format);
+	for (uint32_t x = 0; x < dstWidth; x++) {
+		uint32_t x0 = std::min(x * 2, srcWidth - 1) * channels;
+		uint32_t x1 = std::min((x * 2) + 1, srcWidth - 1) * channels;
+		for (uint32_t c = 0; c < channels; c++) {
+			uint32_t i0 = x0 + c;
+			uint32_t i1 = x1 + c;
+			uint32_t di = (x * channels) + c;
+			switch (format) {
+			case MipmapPixelFormatR8:
+			case MipmapPixelFormatRG8:
+			case MipmapPixelFormatRGBA8:
+			case MipmapPixelFormatSRGB8A8:
+				if ((format == MipmapPixelFormatSRGB8A8) && (c < 3)) {
+					// RGBは線形に変換して補間
+					const SrgbTable& table = get_srgb_table();
+					float sum = 0.0f;
+					for (int r = 0; r < 4; r++) {
+						sum += table.toLinear[rows[r][i0]] + table.toLinear[rows[r][i1]];
+					}
+					dst[di] = linear_to_srgb8(table, sum * 0.125f);
+				} else {
+					uint32_t sum = 0;
+					for (int r = 0; r < 4; r++) {
+						sum += rows[r][i0] + rows[r][i1];
+					}
+					dst[di] = static_cast<uint8_t>((sum + 4) >> 3);
+				}
+				break;
+			case MipmapPixelFormatR32F:
+			case MipmapPixelFormatRG32F:
+			case MipmapPixelFormatRGBA32F:
+				{
+					float sum = 0.0f;
+					for (int r = 0; r < 4; r++) {
+						const float* row = reinterpret_cast<const float*>(rows[r]);
+						sum += row[i0] + row[i1];
+					}
+					reinterpret_cast<float*>(dst)[di] = sum * 0.125f;
+				}
+				break;
+			default:
+				AXGL_ASSERT(0);
+				break;
+			}
+		}
+	}
+	return;
+}
+
+// dstの行[startRow, endRow)を生成(行の番号はスライスを通した通し番号)
+static void generate_level_rows_3d(const MipmapLevelJob3D& job, uint32_t startRow, uint32_t endRow)
+{
+	for (uint32_t row = startRow; row < endRow; row++) {
+		uint32_t y = row % job.dstHeight;
+		uint32_t z = row / job.dstHeight;
+		// NOTE: 奥行き、高さが1の場合は同じスライス、行を使用する
+		const uint8_t* slice0 = job.src + (job.srcBytesPerImage * std::min(z * 2, job.srcDepth - 1));
+		const uint8_t* slice1 = job.src + (job.srcBytesPerImage * std::min((z * 2) + 1, job.srcDepth - 1));
+		size_t offset0 = job.srcBytesPerRow * std::min(y * 2, job.srcHeight - 1);
+		size_t offset1 = job.srcBytesPerRow * std::min((y * 2) + 1, job.srcHeight - 1);
+		const uint8_t* rows[4] = { slice0 + offset0, slice0 + offset1, slice1 + offset0, slice1 + offset1 };
+		uint8_t* dst = job.dst + (job.dstBytesPerImage * z) + (job.dstBytesPerRow * y);
+		downsample_row_3d(job.format, rows, dst, job.srcWidth, job.dstWidth);
+	}
+	return;
+}
+
+// WorkerPoolから呼ばれる
+static void generate_level_range_3d(void* userData, uint32_t begin, uint32_t end)
+{
+	generate_level_rows_3d(*static_cast<const MipmapLevelJob3D*>(userData), begin, end);
+	return;
+}
+
+// 3Dの1レベルを生成(大きなレベルは行を分割して複数のスレッドで生成)
+static void generate_level_3d(const MipmapLevelJob3D& job, uint32_t dstDepth, bool parallel)
+{
+	uint32_t num_rows = job.dstHeight * dstDepth;
+	if (!parallel || ((job.dstBytesPerRow * num_rows) < c_parallel_level_size)) {
+		generate_level_rows_3d(job, 0, num_rows);
+		return;
+	}
+	WorkerPool& worker_pool = WorkerPool::getInstance();
+	uint32_t num_ranges = worker_pool.getConcurrency() * c_ranges_per_thread;
+	uint32_t rows_per_range = (num_rows + num_ranges - 1) / num_ranges;
+	worker_pool.parallelFor(num_rows, rows_per_range, generate_level_range_3d, const_cast<MipmapLevelJob3D*>(&job));
+	return;
+}
+
+size_t getMipmapPixelSize(MipmapPixelFormat format)
+{
+	size_t pixel_size = 0;
+	switch (format) {
+	case MipmapPixelFormatR8:
+	case MipmapPixelFormatRG8:
+	case MipmapPixelFormatRGBA8:
+	case MipmapPixelFormatSRGB8A8:
+		pixel_size = get_channel_count(format) * sizeof(uint8_t);
+		break;
+	case MipmapPixelFormatR32F:
+	case MipmapPixelFormatRG32F:
+	case MipmapPixelFormatRGBA32F:
+		pixel_size = get_channel_count(format) * sizeof(float);
+		break;
+	default:
+		AXGL_ASSERT(0);
+		break;
+	}
+	return pixel_size;
+}
+
+size_t getMipmapChainSize(MipmapPixelFormat format, uint32_t width, uint32_t height, uint32_t levels)
+{
+	size_t pixel_size = getMipmapPixelSize(format);
+	size_t chain_size = 0;
+	for (uint32_t level = 0; level < levels; level++) {
+		chain_size += pixel_size * width * height;
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+	}
+	return chain_size;
+}
+
+size_t getMipmapChainSize3D(MipmapPixelFormat format, uint32_t width, uint32_t height, uint32_t depth, uint32_t levels)
+{
+	size_t pixel_size = getMipmapPixelSize(format);
+	size_t chain_size = 0;
+	for (uint32_t level = 0; level < levels; level++) {
+		chain_size += pixel_size * width * height * depth;
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+		depth = std::max(1u, depth / 2);
+	}
+	return chain_size;
+}
+
+void generateMipmapLevel(MipmapPixelFormat format, const void* src, size_t srcBytesPerRow, uint32_t srcWidth, uint32_t srcHeight,
+	void* dst, size_t dstBytesPerRow)
+{
+	AXGL_ASSERT((src != nullptr) && (dst != nullptr) && (srcWidth > 0) && (srcHeight > 0));
+	MipmapLevelJob job;
+	job.format = format;
+	job.src = static_cast<const uint8_t*>(src);
+	job.srcBytesPerRow = srcBytesPerRow;
+	job.srcWidth = srcWidth;
+	job.srcHeight = srcHeight;
+	job.dst = static_cast<uint8_t*>(dst);
+	job.dstBytesPerRow = dstBytesPerRow;
+	job.dstWidth = std::max(1u, srcWidth / 2);
+	generate_level(job, std::max(1u, srcHeight / 2), false);
+	return;
+}
+
+void generateMipmapChain(MipmapPixelFormat format, void* data, uint32_t width, uint32_t height, uint32_t levels)
+{
+	AXGL_ASSERT((data != nullptr) && (width > 0) && (height > 0));
+	size_t pixel_size = getMipmapPixelSize(format);
+	uint8_t* src = static_cast<uint8_t*>(data);
+	for (uint32_t level = 1; level < levels; level++) {
+		MipmapLevelJob job;
+		job.format = format;
+		job.src = src;
+		job.srcBytesPerRow = pixel_size * width;
+		job.srcWidth = width;
+		job.srcHeight = height;
+		job.dst = src + (job.srcBytesPerRow * height);
+		job.dstWidth = std::max(1u, width / 2);
+		job.dstBytesPerRow = pixel_size * job.dstWidth;
+		uint32_t dst_height = std::max(1u, height / 2);
+		generate_level(job, dst_height, true);
+		// 生成したレベルを次のソースにする
+		src = job.dst;
+		width = job.dstWidth;
+		height = dst_height;
+	}
+	return;
+}
+
+void generateMipmapLevel3D(MipmapPixelFormat format, const void* src, size_t srcBytesPerRow, size_t srcBytesPerImage,
+	uint32_t srcWidth, uint32_t srcHeight, uint32_t srcDepth, void* dst, size_t dstBytesPerRow, size_t dstBytesPerImage)
+{
+	AXGL_ASSERT((src != nullptr) && (dst != nullptr) && (srcWidth > 0) && (srcHeight > 0) && (srcDepth > 0));
+	MipmapLevelJob3D job;
+	job.format = format;
+	job.src = static_cast<const uint8_t*>(src);
+	job.srcBytesPerRow = srcBytesPerRow;
+	job.srcBytesPerImage = srcBytesPerImage;
+	job.srcWidth = srcWidth;
+	job.srcHeight = srcHeight;
+	job.srcDepth = srcDepth;
+	job.dst = static_cast<uint8_t*>(dst);
+	job.dstBytesPerRow = dstBytesPerRow;
+	job.dstBytesPerImage = dstBytesPerImage;
+	job.dstWidth = std::max(1u, srcWidth / 2);
+	job.dstHeight = std::max(1u, srcHeight / 2);
+	generate_level_3d(job, std::max(1u, srcDepth / 2), false);
+	return;
+}
+
+void generateMipmapChain3D(MipmapPixelFormat format, void* data, uint32_t width, uint32_t height, uint32_t depth, uint32_t levels)
+{
+	AXGL_ASSERT((data != nullptr) && (width > 0) && (height > 0) && (depth > 0));
+	size_t pixel_size = getMipmapPixelSize(format);
+	uint8_t* src = static_cast<uint8_t*>(data);
+	for (uint32_t level = 1; level < levels; level++) {
+		MipmapLevelJob3D job;
+		job.format = format;
+		job.src = src;
+		job.srcBytesPerRow = pixel_size * width;
+		job.srcBytesPerImage = job.srcBytesPerRow * height;
+		job.srcWidth = width;
+		job.srcHeight = height;
+		job.srcDepth = depth;
+		job.dst = src + (job.srcBytesPerImage * depth);
+		job.dstWidth = std::max(1u, width / 2);
+		job.dstHeight = std::max(1u, height / 2);
+		job.dstBytesPerRow = pixel_size * job.dstWidth;
+		job.dstBytesPerImage = job.dstBytesPerRow * job.dstHeight;
+		uint32_t dst_depth = std::max(1u, depth / 2);
+		generate_level_3d(job, dst_depth, true);
+		// 生成したレベルを次のソースにする
+		src = job.dst;
+		width = job.dstWidth;
+		height = job.dstHeight;
+		depth = dst_depth;
+	}
+	return;
+}
+
+} // namespace axgl
@@ -0,0 +1,56 @@
+﻿// MipmapGeneration.h
+#ifndef __MipmapGeneration_h_
+#define __MipmapGeneration_h_
+
+#include "axglCommon.h"
+
+// SIMD実装の選択(コンパイル時)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AXGL_MIPMAP_GENERATION_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#define AXGL_MIPMAP_GENERATION_SSE2 1
+#endif
+
+namespace axgl {
+
+// CPUでミップマップを生成するピクセルフォーマット
+enum MipmapPixelFormat {
+	MipmapPixelFormatInvalid = 0,
+	// 8bit unorm(チャンネルの並びは問わない)
+	// NOTE: 整数フォーマットはglGenerateMipmapのエラーとなるため対象外
+	MipmapPixelFormatR8 = 1,
+	MipmapPixelFormatRG8 = 2,
+	MipmapPixelFormatRGBA8 = 3,
+	// RGBはsRGB、アルファは線形として補間
+	MipmapPixelFormatSRGB8A8 = 4,
+	// 32bit float
+	MipmapPixelFormatR32F = 5,
+	MipmapPixelFormatRG32F = 6,
+	MipmapPixelFormatRGBA32F = 7
+};
+
+// 1ピクセルのバイト数を取得
+size_t getMipmapPixelSize(MipmapPixelFormat format);
+// レベル0から各レベルを詰めて格納したミップマップチェーンのサイズ(バイト数)を取得
+size_t getMipmapChainSize(MipmapPixelFormat format, uint32_t width, uint32_t height, uint32_t levels);
+// 3Dテクスチャのミップマップチェーンのサイズ(バイト数)を取得
+size_t getMipmapChainSize3D(MipmapPixelFormat format, uint32_t width, uint32_t height, uint32_t depth, uint32_t levels);
+
+// 2x2のボックスフィルタで1つ下のレベルを生成する
+// NOTE: dstのサイズは各辺max(1, src / 2)、奇数サイズの最後の行、列は使用しない
+void generateMipmapLevel(MipmapPixelFormat format, const void* src, size_t srcBytesPerRow, uint32_t srcWidth, uint32_t srcHeight,
+	void* dst, size_t dstBytesPerRow);
+// レベル0からミップマップチェーンを生成する(dataはgetMipmapChainSize()のサイズで、先頭にレベル0を格納)
+// NOTE: 大きなレベルは複数のスレッドで分割して生成する
+void generateMipmapChain(MipmapPixelFormat format, void* data, uint32_t width, uint32_t height, uint32_t levels);
+
+// 2x2x2のボックスフィルタで3Dテクスチャの1つ下のレベルを生成する
+// NOTE: dstのサイズは各辺max(1, src / 2)、奥行きが1の場合はgenerateMipmapLevel()と同じ2x2のフィルタになる
+void generateMipmapLevel3D(MipmapPixelFormat format, const void* src, size_t srcBytesPerRow, size_t srcBytesPerImage,
+	uint32_t srcWidth, uint32_t srcHeight, uint32_t srcDepth, void* dst, size_t dstBytesPerRow, size_t dstBytesPerImage);
+// レベル0から3Dテクスチャのミップマップチェーンを生成する(dataはgetMipmapChainSize3D()のサイズ)
+void generateMipmapChain3D(MipmapPixelFormat format, void* data, uint32_t width, uint32_t height, uint32_t depth, uint32_t levels);
+
+} // namespace axgl
+
+#endif // __MipmapGeneration_h_
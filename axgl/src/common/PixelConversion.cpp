@@ -0,0 +1,555 @@
+﻿// PixelConversion.cpp
+#include "PixelConversion.h"
+
+#include <string.h>
+
+#if defined(AXGL_PIXEL_CONVERSION_NEON)
+#include <arm_neon.h>
+#elif defined(AXGL_PIXEL_CONVERSION_SSSE3)
+#include <tmmintrin.h>
+#elif defined(AXGL_PIXEL_CONVERSION_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace axgl {
+
+// 16bitのピクセルを読み出す(アライメントを問わない)
+static inline uint16_t load_u16(const uint8_t* src)
+{
+	uint16_t value;
+	memcpy(&value, src, sizeof(value));
+	return value;
+}
+
+// 4bit、5bit、6bitの値を8bitに展開
+static inline uint8_t expand4(uint32_t value)
+{
+	return static_cast<uint8_t>((value << 4) | value);
+}
+
+static inline uint8_t expand5(uint32_t value)
+{
+	return static_cast<uint8_t>((value << 3) | (value >> 2));
+}
+
+static inline uint8_t expand6(uint32_t value)
+{
+	return static_cast<uint8_t>((value << 2) | (value >> 4));
+}
+
+#if defined(AXGL_PIXEL_CONVERSION_SSE2) || defined(AXGL_PIXEL_CONVERSION_SSSE3)
+// 16bitレーンの5bit値を8bitに展開
+static inline __m128i expand5_epi16(__m128i value)
+{
+	return _mm_or_si128(_mm_slli_epi16(value, 3), _mm_srli_epi16(value, 2));
+}
+
+// 16bitレーンの(R|G<<8)と(B|A<<8)を、RGBA8の8ピクセルとして書き込む
+static inline void store_rg_ba_epi16(uint8_t* dst, __m128i rg, __m128i ba)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi16(rg, ba));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_unpackhi_epi16(rg, ba));
+	return;
+}
+#endif
+
+#if defined(AXGL_PIXEL_CONVERSION_NEON)
+// 16bitレーンの5bit値を8bitに展開
+static inline uint16x8_t expand5_u16(uint16x8_t value)
+{
+	return vorrq_u16(vshlq_n_u16(value, 3), vshrq_n_u16(value, 2));
+}
+
+// 16bitレーンの(R|G<<8)と(B|A<<8)を、RGBA8の8ピクセルとして書き込む
+static inline void store_rg_ba_u16(uint8_t* dst, uint16x8_t rg, uint16x8_t ba)
+{
+	uint16x8x2_t rgba = {{rg, ba}};
+	vst2q_u16(reinterpret_cast<uint16_t*>(dst), rgba);
+	return;
+}
+#endif
+
+// RGB8をRGBA8に変換する(アルファは指定値)
+void convertPixelsRGB8ToRGBA8(void* dst, const void* src, size_t count, uint8_t alpha)
+{
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	size_t i = 0;
+#if defined(AXGL_PIXEL_CONVERSION_NEON)
+	// 16ピクセル単位で、RGBの3チャンネルを分離して読み込みアルファを加えて書き込む
+	uint8x16_t alpha_vec = vdupq_n_u8(alpha);
+	for (; (i + 16) <= count; i += 16) {
+		uint8x16x3_t rgb = vld3q_u8(sp);
+		uint8x16x4_t rgba = {{rgb.val[0], rgb.val[1], rgb.val[2], alpha_vec}};
+		vst4q_u8(dp, rgba);
+		sp += 16 * 3;
+		dp += 16 * 4;
+	}
+#elif defined(AXGL_PIXEL_CONVERSION_SSSE3)
+	// 16ピクセル(48バイト)単位で、4ピクセル毎にシャッフルしてアルファを加える
+	const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i alpha_vec = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(alpha) << 24));
+	for (; (i + 16) <= count; i += 16) {
+		__m128i s0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sp));
+		__m128i s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sp + 16));
+		__m128i s2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sp + 32));
+		__m128i p0 = _mm_shuffle_epi8(s0, shuffle);
+		__m128i p1 = _mm_shuffle_epi8(_mm_alignr_epi8(s1, s0, 12), shuffle);
+		__m128i p2 = _mm_shuffle_epi8(_mm_alignr_epi8(s2, s1, 8), shuffle);
+		__m128i p3 = _mm_shuffle_epi8(_mm_srli_si128(s2, 4), shuffle);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dp), _mm_or_si128(p0, alpha_vec));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dp + 16), _mm_or_si128(p1, alpha_vec));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dp + 32), _mm_or_si128(p2, alpha_vec));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dp + 48), _mm_or_si128(p3, alpha_vec));
+		sp += 16 * 3;
+		dp += 16 * 4;
+	}
+#endif
+	for (; i < count; i++) {
+		memcpy(dp, sp, 3);
+		dp[3] = alpha;
+		sp += 3;
+		dp += 4;
+	}
+	return;
+}
+
+// RGB565をRGBA8に展開する
+void convertPixelsRGB565ToRGBA8(void* dst, const void* src, size_t count)
+{
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	size_t i = 0;
+#if defined(AXGL_PIXEL_CONVERSION_NEON)
+	const uint16x8_t mask5 = vdupq_n_u16(0x1f);
+	const uint16x8_t mask6 = vdupq_n_u16(0x3f);
+	const uint16x8_t alpha = vdupq_n_u16(0xff00);
+	for (; (i + 8) <= count; i += 8) {
+		uint16x8_t p = vreinterpretq_u16_u8(vld1q_u8(sp));
+		uint16x8_t r = expand5_u16(vshrq_n_u16(p, 11));
+		uint16x8_t g = vshrq_n_u16(vandq_u16(p, vshlq_n_u16(mask6, 5)), 5);
+		g = vorrq_u16(vshlq_n_u16(g, 2), vshrq_n_u16(g, 4));
+		uint16x8_t b = expand5_u16(vandq_u16(p, mask5));
+		store_rg_ba_u16(dp, vorrq_u16(r, vshlq_n_u16(g, 8)), vorrq_u16(b, alpha));
+		sp += 8 * 2;
+		dp += 8 * 4;
+	}
+#elif defined(AXGL_PIXEL_CONVERSION_SSE2)
+	const __m128i mask5 = _mm_set1_epi16(0x1f);
+	const __m128i mask6 = _mm_set1_epi16(0x3f);
+	const __m128i alpha = _mm_set1_epi16(static_cast<short>(0xff00));
+	for (; (i + 8) <= count; i += 8) {
+		__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sp));
+		__m128i r = expand5_epi16(_mm_srli_epi16(p, 11));
+		__m128i g = _mm_and_si128(_mm_srli_epi16(p, 5), mask6);
+		g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+		__m128i b = expand5_epi16(_mm_and_si128(p, mask5));
+		store_rg_ba_epi16(dp, _mm_or_si128(r, _mm_slli_epi16(g, 8)), _mm_or_si128(b, alpha));
+		sp += 8 * 2;
+		dp += 8 * 4;
+	}
+#endif
+	for (; i < count; i++) {
+		uint32_t p = load_u16(sp);
+		dp[0] = expand5(p >> 11);
+		dp[1] = expand6((p >> 5) & 0x3f);
+		dp[2] = expand5(p & 0x1f);
+		dp[3] = 0xff;
+		sp += 2;
+		dp += 4;
+	}
+	return;
+}
+
+// RGBA4444をRGBA8に展開する
+void convertPixelsRGBA4444ToRGBA8(void* dst, const void* src, size_t count)
+{
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	size_t i = 0;
+#if defined(AXGL_PIXEL_CONVERSION_NEON)
+	const uint16x8_t mask4 = vdupq_n_u16(0x000f);
+	for (; (i + 8) <= count; i += 8) {
+		uint16x8_t p = vreinterpretq_u16_u8(vld1q_u8(sp));
+		// 上位の(R,G)と下位の(B,A)をそれぞれ8bitレーンの下位4bitに並べて展開
+		uint16x8_t rg = vorrq_u16(vshrq_n_u16(p, 12), vshlq_n_u16(vandq_u16(vshrq_n_u16(p, 8), mask4), 8));
+		uint16x8_t ba = vorrq_u16(vandq_u16(vshrq_n_u16(p, 4), mask4), vshlq_n_u16(vandq_u16(p, mask4), 8));
+		rg = vorrq_u16(rg, vshlq_n_u16(rg, 4));
+		ba = vorrq_u16(ba, vshlq_n_u16(ba, 4));
+		store_rg_ba_u16(dp, rg, ba);
+		sp += 8 * 2;
+		dp += 8 * 4;
+	}
+#elif defined(AXGL_PIXEL_CONVERSION_SSE2)
+	const __m128i mask4 = _mm_set1_epi16(0x000f);
+	for (; (i + 8) <= count; i += 8) {
+		__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sp));
+		// 上位の(R,G)と下位の(B,A)をそれぞれ8bitレーンの下位4bitに並べて展開
+		__m128i rg = _mm_or_si128(_mm_srli_epi16(p, 12), _mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(p, 8), mask4), 8));
+		__m128i ba = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(p, 4), mask4), _mm_slli_epi16(_mm_and_si128(p, mask4), 8));
+		rg = _mm_or_si128(rg, _mm_slli_epi16(rg, 4));
+		ba = _mm_or_si128(ba, _mm_slli_epi16(ba, 4));
+		store_rg_ba_epi16(dp, rg, ba);
+		sp += 8 * 2;
+		dp += 8 * 4;
+	}
+#endif
+	for (; i < count; i++) {
+		uint32_t p = load_u16(sp);
+		dp[0] = expand4(p >> 12);
+		dp[1] = expand4((p >> 8) & 0xf);
+		dp[2] = expand4((p >> 4) & 0xf);
+		dp[3] = expand4(p & 0xf);
+		sp += 2;
+		dp += 4;
+	}
+	return;
+}
+
+// RGBA5551をRGBA8に展開する
+void convertPixelsRGBA5551ToRGBA8(void* dst, const void* src, size_t count)
+{
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	size_t i = 0;
+#if defined(AXGL_PIXEL_CONVERSION_NEON)
+	const uint16x8_t mask5 = vdupq_n_u16(0x1f);
+	const uint16x8_t mask1 = vdupq_n_u16(0x01);
+	for (; (i + 8) <= count; i += 8) {
+		uint16x8_t p = vreinterpretq_u16_u8(vld1q_u8(sp));
+		uint16x8_t r = expand5_u16(vshrq_n_u16(p, 11));
+		uint16x8_t g = expand5_u16(vandq_u16(vshrq_n_u16(p, 6), mask5));
+		uint16x8_t b = expand5_u16(vandq_u16(vshrq_n_u16(p, 1), mask5));
+		uint16x8_t a = vmulq_n_u16(vandq_u16(p, mask1), 0xff00);
+		store_rg_ba_u16(dp, vorrq_u16(r, vshlq_n_u16(g, 8)), vorrq_u16(b, a));
+		sp += 8 * 2;
+		dp += 8 * 4;
+	}
+#elif defined(AXGL_PIXEL_CONVERSION_SSE2)
+	const __m128i mask5 = _mm_set1_epi16(0x1f);
+	const __m128i mask1 = _mm_set1_epi16(0x01);
+	const __m128i alpha = _mm_set1_epi16(static_cast<short>(0xff00));
+	for (; (i + 8) <= count; i += 8) {
+		__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sp));
+		__m128i r = expand5_epi16(_mm_srli_epi16(p, 11));
+		__m128i g = expand5_epi16(_mm_and_si128(_mm_srli_epi16(p, 6), mask5));
+		__m128i b = expand5_epi16(_mm_and_si128(_mm_srli_epi16(p, 1), mask5));
+		// アルファビットが1のレーンを0xff00にする
+		__m128i a = _mm_and_si128(_mm_cmpeq_epi16(_mm_and_si128(p, mask1), mask1), alpha);
+		store_rg_ba_epi16(dp, _mm_or_si128(r, _mm_slli_epi16(g, 8)), _mm_or_si128(b, a));
+		sp += 8 * 2;
+		dp += 8 * 4;
+	}
+#endif
+	for (; i < count; i++) {
+		uint32_t p = load_u16(sp);
+		dp[0] = expand5(p >> 11);
+		dp[1] = expand5((p >> 6) & 0x1f);
+		dp[2] = expand5((p >> 1) & 0x1f);
+		dp[3] = (p & 0x1) ? 0xff : 0x00;
+		sp += 2;
+		dp += 4;
+	}
+	return;
+}
+
+// 輝度(L)をRGBA8(L,L,L,1)に展開する
+void convertPixelsLuminanceToRGBA8(void* dst, const void* src, size_t count)
+{
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	size_t i = 0;
+#if defined(AXGL_PIXEL_CONVERSION_NEON)
+	const uint8x16_t alpha = vdupq_n_u8(0xff);
+	for (; (i + 16) <= count; i += 16) {
+		uint8x16_t l = vld1q_u8(sp);
+		uint8x16x4_t rgba = {{l, l, l, alpha}};
+		vst4q_u8(dp, rgba);
+		sp += 16;
+		dp += 16 * 4;
+	}
+#elif defined(AXGL_PIXEL_CONVERSION_SSE2)
+	const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xff));
+	for (; (i + 16) <= count; i += 16) {
+		__m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sp));
+		// (L,L)と(L,A)の16bitレーンを作成して交互に並べる
+		__m128i ll_lo = _mm_unpacklo_epi8(l, l);
+		__m128i ll_hi = _mm_unpackhi_epi8(l, l);
+		__m128i la_lo = _mm_unpacklo_epi8(l, alpha);
+		__m128i la_hi = _mm_unpackhi_epi8(l, alpha);
+		store_rg_ba_epi16(dp, ll_lo, la_lo);
+		store_rg_ba_epi16(dp + 32, ll_hi, la_hi);
+		sp += 16;
+		dp += 16 * 4;
+	}
+#endif
+	for (; i < count; i++) {
+		dp[0] = sp[0];
+		dp[1] = sp[0];
+		dp[2] = sp[0];
+		dp[3] = 0xff;
+		sp += 1;
+		dp += 4;
+	}
+	return;
+}
+
+// 輝度とアルファ(L,A)をRGBA8(L,L,L,A)に展開する
+void convertPixelsLuminanceAlphaToRGBA8(void* dst, const void* src, size_t count)
+{
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	size_t i = 0;
+#if defined(AXGL_PIXEL_CONVERSION_NEON)
+	for (; (i + 16) <= count; i += 16) {
+		uint8x16x2_t la = vld2q_u8(sp);
+		uint8x16x4_t rgba = {{la.val[0], la.val[0], la.val[0], la.val[1]}};
+		vst4q_u8(dp, rgba);
+		sp += 16 * 2;
+		dp += 16 * 4;
+	}
+#elif defined(AXGL_PIXEL_CONVERSION_SSE2)
+	const __m128i mask_l = _mm_set1_epi16(0x00ff);
+	for (; (i + 8) <= count; i += 8) {
+		// (L,A)の16bitレーンから(L,L)を作成して交互に並べる
+		__m128i la = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sp));
+		__m128i l = _mm_and_si128(la, mask_l);
+		__m128i ll = _mm_or_si128(l, _mm_slli_epi16(l, 8));
+		store_rg_ba_epi16(dp, ll, la);
+		sp += 8 * 2;
+		dp += 8 * 4;
+	}
+#endif
+	for (; i < count; i++) {
+		dp[0] = sp[0];
+		dp[1] = sp[0];
+		dp[2] = sp[0];
+		dp[3] = sp[1];
+		sp += 2;
+		dp += 4;
+	}
+	return;
+}
+
+// アルファ(A)をRGBA8(0,0,0,A)に展開する
+void convertPixelsAlphaToRGBA8(void* dst, const void* src, size_t count)
+{
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	size_t i = 0;
+#if defined(AXGL_PIXEL_CONVERSION_NEON)
+	const uint8x16_t zero = vdupq_n_u8(0);
+	for (; (i + 16) <= count; i += 16) {
+		uint8x16x4_t rgba = {{zero, zero, zero, vld1q_u8(sp)}};
+		vst4q_u8(dp, rgba);
+		sp += 16;
+		dp += 16 * 4;
+	}
+#elif defined(AXGL_PIXEL_CONVERSION_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	for (; (i + 16) <= count; i += 16) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sp));
+		store_rg_ba_epi16(dp, zero, _mm_unpacklo_epi8(zero, a));
+		store_rg_ba_epi16(dp + 32, zero, _mm_unpackhi_epi8(zero, a));
+		sp += 16;
+		dp += 16 * 4;
+	}
+#endif
+	for (; i < count; i++) {
+		dp[0] = 0;
+		dp[1] = 0;
+		dp[2] = 0;
+		dp[3] = sp[0];
+		sp += 1;
+		dp += 4;
+	}
+	return;
+}
+
+// BGRA8とRGBA8のR,Bを入れ替える
+void swizzlePixelsBGRA8ToRGBA8(void* dst, const void* src, size_t count)
+{
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	size_t i = 0;
+#if defined(AXGL_PIXEL_CONVERSION_NEON)
+	for (; (i + 16) <= count; i += 16) {
+		uint8x16x4_t bgra = vld4q_u8(sp);
+		uint8x16x4_t rgba = {{bgra.val[2], bgra.val[1], bgra.val[0], bgra.val[3]}};
+		vst4q_u8(dp, rgba);
+		sp += 16 * 4;
+		dp += 16 * 4;
+	}
+#elif defined(AXGL_PIXEL_CONVERSION_SSE2)
+	const __m128i mask_ga = _mm_set1_epi32(static_cast<int>(0xff00ff00));
+	for (; (i + 4) <= count; i += 4) {
+		// 32bitレーン内で、R,Bのバイトを16bit回転して入れ替える
+		__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sp));
+		__m128i ga = _mm_and_si128(p, mask_ga);
+		__m128i rb = _mm_andnot_si128(mask_ga, p);
+		rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dp), _mm_or_si128(ga, rb));
+		sp += 4 * 4;
+		dp += 4 * 4;
+	}
+#endif
+	for (; i < count; i++) {
+		uint8_t b = sp[0];
+		uint8_t r = sp[2];
+		dp[0] = r;
+		dp[1] = sp[1];
+		dp[2] = b;
+		dp[3] = sp[3];
+		sp += 4;
+		dp += 4;
+	}
+	return;
+}
+
+// 2つの行の内容を入れ替える
+static void swap_rows(uint8_t* row0, uint8_t* row1, size_t size)
+{
+	size_t i = 0;
+#if defined(AXGL_PIXEL_CONVERSION_NEON)
+	for (; (i + 16) <= size; i += 16) {
+		uint8x16_t v0 = vld1q_u8(row0 + i);
+		uint8x16_t v1 = vld1q_u8(row1 + i);
+		vst1q_u8(row0 + i, v1);
+		vst1q_u8(row1 + i, v0);
+	}
+#elif defined(AXGL_PIXEL_CONVERSION_SSE2)
+	for (; (i + 16) <= size; i += 16) {
+		__m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i));
+		__m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(row0 + i), v1);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(row1 + i), v0);
+	}
+#endif
+	for (; i < size; i++) {
+		uint8_t tmp = row0[i];
+		row0[i] = row1[i];
+		row1[i] = tmp;
+	}
+	return;
+}
+
+// イメージの行の並びを上下反転する
+// NOTE: 作業用のメモリを確保せず、行同士を直接入れ替える
+void flipImageRows(void* data, size_t bytesPerRow, size_t height)
+{
+	AXGL_ASSERT(data != nullptr);
+	uint8_t* pixels = static_cast<uint8_t*>(data);
+	for (size_t y = 0; y < (height / 2); y++) {
+		swap_rows(pixels + (y * bytesPerRow), pixels + ((height - 1 - y) * bytesPerRow), bytesPerRow);
+	}
+	return;
+}
+
+// イメージの行をコピーする
+// NOTE: 上下反転は読み出す行の順序で行い、入れ替えはコピーと同じ走査で行う
+void copyImageRows(void* dst, size_t dstBytesPerRow, const void* src, size_t srcBytesPerRow,
+	size_t rowSize, size_t height, bool flipY, bool swizzleBGRA8)
+{
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	AXGL_ASSERT(!swizzleBGRA8 || ((rowSize % 4) == 0));
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	for (size_t y = 0; y < height; y++) {
+		const uint8_t* src_row = sp + ((flipY ? (height - 1 - y) : y) * srcBytesPerRow);
+		uint8_t* dst_row = dp + (y * dstBytesPerRow);
+		if (swizzleBGRA8) {
+			swizzlePixelsBGRA8ToRGBA8(dst_row, src_row, rowSize / 4);
+		} else {
+			memcpy(dst_row, src_row, rowSize);
+		}
+	}
+	return;
+}
+
+// 16bit浮動小数点のビット列を32bit浮動小数点のビット列に変換
+static inline uint32_t half_to_float_bits(uint16_t value)
+{
+	uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+	if (exponent == 0) {
+		if (mantissa == 0) {
+			return sign;
+		}
+		// 非正規化数は正規化する
+		exponent = 127 - 15 + 1;
+		while ((mantissa & 0x400) == 0) {
+			mantissa <<= 1;
+			exponent--;
+		}
+		mantissa &= 0x3ff;
+		return sign | (exponent << 23) | (mantissa << 13);
+	}
+	if (exponent == 0x1f) {
+		// 無限大、NaN
+		return sign | 0x7f800000 | (mantissa << 13);
+	}
+	return sign | ((exponent + (127 - 15)) << 23) | (mantissa << 13);
+}
+
+// 16bit浮動小数点を32bit浮動小数点に変換する
+void convertHalfToFloat(void* dst, const void* src, size_t count)
+{
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	size_t i = 0;
+#if defined(AXGL_PIXEL_CONVERSION_NEON) && defined(__aarch64__)
+	for (; (i + 4) <= count; i += 4) {
+		float16x4_t h = vreinterpret_f16_u8(vld1_u8(sp));
+		vst1q_u8(dp, vreinterpretq_u8_f32(vcvt_f32_f16(h)));
+		sp += 4 * sizeof(uint16_t);
+		dp += 4 * sizeof(float);
+	}
+#elif defined(AXGL_PIXEL_CONVERSION_SSE2)
+	// 指数と仮数を32bit浮動小数点の位置に移し、指数のバイアスを整数の加算で補正する
+	// NOTE: 非正規化数は指数を1にした正規化数から2^-14を引いて求め、非正規化数の演算を避ける
+	const __m128i mask_em = _mm_set1_epi32(0x7fff);
+	const __m128i mask_sign = _mm_set1_epi32(0x8000);
+	const __m128i mask_exponent = _mm_set1_epi32(0x0f800000);
+	const __m128i bias = _mm_set1_epi32((127 - 15) << 23);
+	const __m128i denormal_bias = _mm_set1_epi32((127 - 15 + 1) << 23);
+	const __m128i zero = _mm_setzero_si128();
+	for (; (i + 8) <= count; i += 8) {
+		__m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sp));
+		__m128i h32[2] = { _mm_unpacklo_epi16(h, zero), _mm_unpackhi_epi16(h, zero) };
+		for (int j = 0; j < 2; j++) {
+			__m128i em = _mm_slli_epi32(_mm_and_si128(h32[j], mask_em), 13);
+			__m128i sign = _mm_slli_epi32(_mm_and_si128(h32[j], mask_sign), 16);
+			__m128i exponent = _mm_and_si128(em, mask_exponent);
+			// 正規化数(無限大、NaNは指数のバイアスを2回加えて最大値にする)
+			__m128i inf_nan = _mm_cmpeq_epi32(exponent, mask_exponent);
+			__m128i bits = _mm_add_epi32(_mm_add_epi32(em, bias), _mm_and_si128(inf_nan, bias));
+			// 非正規化数、0
+			__m128i denormal = _mm_cmpeq_epi32(exponent, zero);
+			__m128 denormal_value = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(em, denormal_bias)), _mm_castsi128_ps(denormal_bias));
+			bits = _mm_or_si128(_mm_andnot_si128(denormal, bits), _mm_and_si128(denormal, _mm_castps_si128(denormal_value)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dp + j * 16), _mm_or_si128(bits, sign));
+		}
+		sp += 8 * sizeof(uint16_t);
+		dp += 8 * sizeof(float);
+	}
+#endif
+	for (; i < count; i++) {
+		uint32_t bits = half_to_float_bits(load_u16(sp));
+		memcpy(dp, &bits, sizeof(bits));
+		sp += sizeof(uint16_t);
+		dp += sizeof(float);
+	}
+	return;
+}
+
+} // namespace axgl
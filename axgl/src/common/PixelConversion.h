@@ -0,0 +1,43 @@
+﻿// PixelConversion.h
+#ifndef __PixelConversion_h_
+#define __PixelConversion_h_
+
+#include "axglCommon.h"
+
+// SIMD実装の選択(コンパイル時)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AXGL_PIXEL_CONVERSION_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#define AXGL_PIXEL_CONVERSION_SSE2 1
+#if defined(__SSSE3__)
+#define AXGL_PIXEL_CONVERSION_SSSE3 1
+#endif
+#endif
+
+namespace axgl {
+
+// NOTE: countはピクセル数、dstとsrcのアライメントは問わない
+// RGB8をRGBA8に変換する(アルファは指定値)
+void convertPixelsRGB8ToRGBA8(void* dst, const void* src, size_t count, uint8_t alpha);
+// 16bitにパックされたピクセル(GL_UNSIGNED_SHORT_*)をRGBA8に展開する
+void convertPixelsRGB565ToRGBA8(void* dst, const void* src, size_t count);
+void convertPixelsRGBA4444ToRGBA8(void* dst, const void* src, size_t count);
+void convertPixelsRGBA5551ToRGBA8(void* dst, const void* src, size_t count);
+// 輝度、アルファをRGBA8に展開する
+void convertPixelsLuminanceToRGBA8(void* dst, const void* src, size_t count);
+void convertPixelsLuminanceAlphaToRGBA8(void* dst, const void* src, size_t count);
+void convertPixelsAlphaToRGBA8(void* dst, const void* src, size_t count);
+// BGRA8とRGBA8のR,Bを入れ替える(dstとsrcは同じ領域でも良い)
+void swizzlePixelsBGRA8ToRGBA8(void* dst, const void* src, size_t count);
+// イメージの行の並びを上下反転する
+void flipImageRows(void* data, size_t bytesPerRow, size_t height);
+// イメージの行をコピーする(上下反転、BGRA8のR,Bの入れ替えをコピーと同時に行う)
+// NOTE: rowSizeは1行のバイト数、dstとsrcは重ならないこと
+void copyImageRows(void* dst, size_t dstBytesPerRow, const void* src, size_t srcBytesPerRow,
+	size_t rowSize, size_t height, bool flipY, bool swizzleBGRA8);
+// 16bit浮動小数点を32bit浮動小数点に変換する(countは要素数)
+void convertHalfToFloat(void* dst, const void* src, size_t count);
+
+} // namespace axgl
+
+#endif // __PixelConversion_h_
@@ -0,0 +1,236 @@
+﻿// ShadowBufferBudget.cpp
+#include "ShadowBufferBudget.h"
+#include "../AXGLAllocatorImpl.h"
+
+namespace axgl {
+
+// 破棄の対象とする、書き込まれていない期間(サブミッション数)
+static constexpr uint64_t c_shadow_buffer_idle_ticks = 60;
+
+// usageからシャドウバッファの分類を取得
+ShadowBufferClass getShadowBufferClass(GLenum usage)
+{
+	ShadowBufferClass shadow_class = ShadowBufferClassStatic;
+	switch (usage) {
+	case GL_DYNAMIC_DRAW:
+	case GL_DYNAMIC_READ:
+	case GL_DYNAMIC_COPY:
+		shadow_class = ShadowBufferClassDynamic;
+		break;
+	case GL_STREAM_DRAW:
+	case GL_STREAM_READ:
+	case GL_STREAM_COPY:
+		shadow_class = ShadowBufferClassStream;
+		break;
+	default:
+		break;
+	}
+	return shadow_class;
+}
+
+// ShadowBufferEntryクラスの実装 --------
+ShadowBufferEntry::ShadowBufferEntry()
+{
+}
+
+ShadowBufferEntry::~ShadowBufferEntry()
+{
+	AXGL_ASSERT(m_shadowOwner.load(std::memory_order_relaxed) == nullptr);
+}
+
+// ShadowBufferBudgetクラスの実装 --------
+// 予算とサイズ(全てのコンテキストで共通)
+static std::atomic<size_t> s_shadowBufferBudget{ SIZE_MAX };
+static std::atomic<size_t> s_shadowBufferTotalSize{ 0 };
+static std::atomic<size_t> s_shadowBufferClassSize[ShadowBufferClassCount] = {};
+
+ShadowBufferBudget::ShadowBufferBudget()
+{
+}
+
+ShadowBufferBudget::~ShadowBufferBudget()
+{
+	clear();
+}
+
+void ShadowBufferBudget::setBudget(size_t size)
+{
+	s_shadowBufferBudget.store(size, std::memory_order_relaxed);
+	return;
+}
+
+size_t ShadowBufferBudget::getBudget()
+{
+	return s_shadowBufferBudget.load(std::memory_order_relaxed);
+}
+
+size_t ShadowBufferBudget::getTotalSize()
+{
+	return s_shadowBufferTotalSize.load(std::memory_order_relaxed);
+}
+
+size_t ShadowBufferBudget::getClassSize(ShadowBufferClass shadowClass)
+{
+	AXGL_ASSERT((shadowClass >= 0) && (shadowClass < ShadowBufferClassCount));
+	return s_shadowBufferClassSize[shadowClass].load(std::memory_order_relaxed);
+}
+
+void ShadowBufferBudget::update(ShadowBufferEntry* entry, ShadowBufferClass shadowClass, size_t size)
+{
+	AXGL_ASSERT(entry != nullptr);
+	if (entry->m_shadowOwner.load(std::memory_order_acquire) != this) {
+		detach(entry);
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (entry->m_shadowOwner.load(std::memory_order_relaxed) == this) {
+		unlink(entry);
+	}
+	if (size == 0) {
+		return;
+	}
+	entry->m_shadowSize = size;
+	entry->m_shadowClass = shadowClass;
+	entry->m_shadowWriteTick = m_tick;
+	// 最後に書き込まれたものとして末尾に追加
+	link(entry);
+	return;
+}
+
+void ShadowBufferBudget::acquire(ShadowBufferEntry* entry)
+{
+	AXGL_ASSERT(entry != nullptr);
+	ShadowBufferBudget* owner = entry->m_shadowOwner.load(std::memory_order_acquire);
+	if ((owner == nullptr) || (owner == this)) {
+		return;
+	}
+	// 他のコンテキストのリストから外す
+	// NOTE: 他のコンテキストが破棄中の場合は、破棄が終わるまで待つ
+	if (!detach(entry)) {
+		// 他のコンテキストによって破棄された
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	entry->m_shadowWriteTick = m_tick;
+	link(entry);
+	return;
+}
+
+void ShadowBufferBudget::remove(ShadowBufferEntry* entry)
+{
+	AXGL_ASSERT(entry != nullptr);
+	detach(entry);
+	return;
+}
+
+void ShadowBufferBudget::evict(const SubmissionSerial* submissionSerial)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_tick++;
+	const size_t budget = s_shadowBufferBudget.load(std::memory_order_relaxed);
+	// 書き込まれていない期間が長いもの(先頭)から順に破棄
+	ShadowBufferEntry* entry = m_head;
+	while ((entry != nullptr) && (s_shadowBufferTotalSize.load(std::memory_order_relaxed) > budget)) {
+		if ((m_tick - entry->m_shadowWriteTick) < c_shadow_buffer_idle_ticks) {
+			// 以降は最近書き込まれたもののみ
+			break;
+		}
+		ShadowBufferEntry* next = entry->m_shadowNext;
+		// NOTE: GPUが使用中、マップ中等で破棄できないものは残す
+		if (entry->evictShadowBuffer(submissionSerial)) {
+			unlink(entry);
+		}
+		entry = next;
+	}
+	return;
+}
+
+void ShadowBufferBudget::clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	while (m_head != nullptr) {
+		unlink(m_head);
+	}
+	return;
+}
+
+// エントリを保持しているリストから外す(外した場合はtrueを返す)
+bool ShadowBufferBudget::detach(ShadowBufferEntry* entry)
+{
+	for (;;) {
+		ShadowBufferBudget* owner = entry->m_shadowOwner.load(std::memory_order_acquire);
+		if (owner == nullptr) {
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(owner->m_mutex);
+		// NOTE: ロックを待つ間に、破棄等でリストから外された場合はやり直す
+		if (entry->m_shadowOwner.load(std::memory_order_relaxed) == owner) {
+			owner->unlink(entry);
+			return true;
+		}
+	}
+}
+
+void ShadowBufferBudget::link(ShadowBufferEntry* entry)
+{
+	AXGL_ASSERT(entry->m_shadowOwner.load(std::memory_order_relaxed) == nullptr);
+	entry->m_shadowPrev = m_tail;
+	entry->m_shadowNext = nullptr;
+	if (m_tail != nullptr) {
+		m_tail->m_shadowNext = entry;
+	} else {
+		m_head = entry;
+	}
+	m_tail = entry;
+	entry->m_shadowOwner.store(this, std::memory_order_release);
+	s_shadowBufferTotalSize.fetch_add(entry->m_shadowSize, std::memory_order_relaxed);
+	s_shadowBufferClassSize[entry->m_shadowClass].fetch_add(entry->m_shadowSize, std::memory_order_relaxed);
+	return;
+}
+
+// NOTE: サイズと分類は、他のリストに移す場合のために保持する
+void ShadowBufferBudget::unlink(ShadowBufferEntry* entry)
+{
+	AXGL_ASSERT(entry->m_shadowOwner.load(std::memory_order_relaxed) == this);
+	if (entry->m_shadowPrev != nullptr) {
+		entry->m_shadowPrev->m_shadowNext = entry->m_shadowNext;
+	} else {
+		m_head = entry->m_shadowNext;
+	}
+	if (entry->m_shadowNext != nullptr) {
+		entry->m_shadowNext->m_shadowPrev = entry->m_shadowPrev;
+	} else {
+		m_tail = entry->m_shadowPrev;
+	}
+	entry->m_shadowPrev = nullptr;
+	entry->m_shadowNext = nullptr;
+	entry->m_shadowOwner.store(nullptr, std::memory_order_release);
+	s_shadowBufferTotalSize.fetch_sub(entry->m_shadowSize, std::memory_order_relaxed);
+	s_shadowBufferClassSize[entry->m_shadowClass].fetch_sub(entry->m_shadowSize, std::memory_order_relaxed);
+	return;
+}
+
+} // namespace axgl
+
+//-------------------------------------------------------------------
+// シャドウバッファの予算を設定
+void AXGL_APIENTRY axglSetShadowBufferBudget(std::size_t size)
+{
+	axgl::ShadowBufferBudget::setBudget(size);
+	return;
+}
+
+// シャドウバッファのサイズを分類毎に取得
+std::size_t AXGL_APIENTRY axglGetShadowBufferSize(AXGLShadowBufferClass bufferClass)
+{
+	switch (bufferClass) {
+	case AXGL_SHADOW_BUFFER_STATIC:
+		return axgl::ShadowBufferBudget::getClassSize(axgl::ShadowBufferClassStatic);
+	case AXGL_SHADOW_BUFFER_DYNAMIC:
+		return axgl::ShadowBufferBudget::getClassSize(axgl::ShadowBufferClassDynamic);
+	case AXGL_SHADOW_BUFFER_STREAM:
+		return axgl::ShadowBufferBudget::getClassSize(axgl::ShadowBufferClassStream);
+	default:
+		break;
+	}
+	return axgl::ShadowBufferBudget::getTotalSize();
+}
@@ -0,0 +1,90 @@
+﻿// ShadowBufferBudget.h
+#ifndef __ShadowBufferBudget_h_
+#define __ShadowBufferBudget_h_
+
+#include "axglCommon.h"
+#include <atomic>
+#include <mutex>
+
+namespace axgl {
+
+class SubmissionSerial;
+class ShadowBufferBudget;
+
+// シャドウバッファ(バッファオブジェクトのCPU側のコピー)の分類
+enum ShadowBufferClass {
+	ShadowBufferClassStatic = 0,
+	ShadowBufferClassDynamic = 1,
+	ShadowBufferClassStream = 2,
+	ShadowBufferClassCount = 3
+};
+
+// usageからシャドウバッファの分類を取得
+ShadowBufferClass getShadowBufferClass(GLenum usage);
+
+// シャドウバッファの予算管理の対象(バックエンドのバッファが継承する)
+class ShadowBufferEntry
+{
+public:
+	ShadowBufferEntry();
+	virtual ~ShadowBufferEntry();
+	// シャドウバッファを破棄できる場合は破棄してtrueを返す
+	// NOTE: 予算管理のロック中に呼ばれるため、ShadowBufferBudgetを呼び出さないこと
+	virtual bool evictShadowBuffer(const SubmissionSerial* submissionSerial) = 0;
+
+private:
+	friend class ShadowBufferBudget;
+	// エントリを保持しているリスト(対象外の場合はnullptr)
+	std::atomic<ShadowBufferBudget*> m_shadowOwner{ nullptr };
+	ShadowBufferEntry* m_shadowPrev = nullptr;
+	ShadowBufferEntry* m_shadowNext = nullptr;
+	size_t m_shadowSize = 0;
+	ShadowBufferClass m_shadowClass = ShadowBufferClassStatic;
+	// 最後に書き込まれた時のティック
+	uint64_t m_shadowWriteTick = 0;
+};
+
+// シャドウバッファのメモリ予算を管理するクラス(コンテキスト毎に保持する)
+// NOTE: 書き込み順のリストを保持し、予算を超えた場合は書き込まれていない期間が長いものから破棄する
+// NOTE: 破棄はリストを保持するコンテキストのスレッドで行い、他のコンテキストが使用する場合はacquireでリストを移す
+// 予算とサイズは全てのコンテキストで共通
+class ShadowBufferBudget
+{
+public:
+	ShadowBufferBudget();
+	~ShadowBufferBudget();
+	// 予算を設定(SIZE_MAXで無制限)
+	static void setBudget(size_t size);
+	static size_t getBudget();
+	// シャドウバッファのサイズを取得
+	static size_t getTotalSize();
+	static size_t getClassSize(ShadowBufferClass shadowClass);
+	// シャドウバッファの確保、書き込みを通知(sizeが0の場合は対象外にする)
+	void update(ShadowBufferEntry* entry, ShadowBufferClass shadowClass, size_t size);
+	// バッファの使用開始を通知(他のコンテキストのリストにある場合は、このリストに移す)
+	// NOTE: シャドウバッファにアクセスする前に呼び出す
+	void acquire(ShadowBufferEntry* entry);
+	// シャドウバッファの解放を通知
+	static void remove(ShadowBufferEntry* entry);
+	// 予算を超えている場合に、しばらく書き込まれていないシャドウバッファを破棄する
+	// NOTE: サブミッション毎に、リストを保持するコンテキストのスレッドで呼び出す
+	void evict(const SubmissionSerial* submissionSerial);
+	// 全てのエントリをリストから外す(コンテキストの破棄時)
+	void clear();
+
+private:
+	static bool detach(ShadowBufferEntry* entry);
+	void link(ShadowBufferEntry* entry);
+	void unlink(ShadowBufferEntry* entry);
+
+private:
+	// NOTE: コンテキスト毎のロックのため、他のコンテキストがリストを移す場合以外は競合しない
+	std::mutex m_mutex;
+	ShadowBufferEntry* m_head = nullptr;
+	ShadowBufferEntry* m_tail = nullptr;
+	uint64_t m_tick = 0;
+};
+
+} // namespace axgl
+
+#endif // __ShadowBufferBudget_h_
@@ -0,0 +1,67 @@
+﻿// SubmissionSerial.cpp
+#include "SubmissionSerial.h"
+
+namespace axgl {
+
+SubmissionSerial::SubmissionSerial()
+	: m_completedSerial(0)
+{
+}
+
+SubmissionSerial::~SubmissionSerial()
+{
+}
+
+uint64_t SubmissionSerial::getPendingSerial() const
+{
+	return m_pendingSerial;
+}
+
+uint64_t SubmissionSerial::getCompletedSerial() const
+{
+	return m_completedSerial.load(std::memory_order_acquire);
+}
+
+bool SubmissionSerial::isCompleted(uint64_t serial) const
+{
+	return serial <= getCompletedSerial();
+}
+
+bool SubmissionSerial::isCompleted(const SubmissionSerial* source, uint64_t serial) const
+{
+	if (serial == 0) {
+		// 一度も使用されていない
+		return true;
+	}
+	if (source != this) {
+		// NOTE: sourceは破棄されている可能性があるため参照しない
+		return false;
+	}
+	return isCompleted(serial);
+}
+
+uint64_t SubmissionSerial::submit()
+{
+	uint64_t serial = m_pendingSerial;
+	m_pendingSerial++;
+	return serial;
+}
+
+void SubmissionSerial::complete(uint64_t serial)
+{
+	// 完了の通知順が前後しても、完了済みのシリアルは減らさない
+	uint64_t completed = m_completedSerial.load(std::memory_order_relaxed);
+	while ((completed < serial)
+		&& !m_completedSerial.compare_exchange_weak(completed, serial, std::memory_order_release, std::memory_order_relaxed)) {
+	}
+	return;
+}
+
+void SubmissionSerial::reset()
+{
+	m_pendingSerial = 1;
+	m_completedSerial.store(0, std::memory_order_release);
+	return;
+}
+
+} // namespace axgl
@@ -0,0 +1,40 @@
+﻿// SubmissionSerial.h
+#ifndef __SubmissionSerial_h_
+#define __SubmissionSerial_h_
+
+#include "axglCommon.h"
+#include <atomic>
+
+namespace axgl {
+
+// GPUへのサブミッション(コマンドバッファ)のシリアル番号を管理するクラス
+// NOTE: リソースに最後に使用したシリアルを記録し、完了済みのシリアルと比較してGPUが使用中かを判定する
+class SubmissionSerial
+{
+public:
+	SubmissionSerial();
+	~SubmissionSerial();
+	// 記録中(未submit)のサブミッションのシリアルを取得
+	uint64_t getPendingSerial() const;
+	// 完了済みの最大のシリアルを取得
+	uint64_t getCompletedSerial() const;
+	// シリアルのサブミッションが完了しているか
+	bool isCompleted(uint64_t serial) const;
+	// sourceが発行したシリアルのサブミッションが完了しているか
+	// NOTE: 他のSubmissionSerial(コンテキスト)が発行したシリアルは完了を判定できないため、未使用(0)以外は未完了とする
+	bool isCompleted(const SubmissionSerial* source, uint64_t serial) const;
+	// 記録中のサブミッションをsubmitし、そのシリアルを返す
+	uint64_t submit();
+	// サブミッションの完了を通知(完了ハンドラのスレッドから呼ばれる)
+	void complete(uint64_t serial);
+	// 初期状態に戻す
+	void reset();
+
+private:
+	uint64_t m_pendingSerial = 1;
+	std::atomic<uint64_t> m_completedSerial;
+};
+
+} // namespace axgl
+
+#endif // __SubmissionSerial_h_
@@ -0,0 +1,1538 @@
+﻿// TextureTranscoder.cpp
+#include "TextureTranscoder.h"
+#include "WorkerPool.h"
+
+#include <string.h>
+#include <algorithm>
+
+namespace axgl {
+
+// キャッシュするデコード結果の合計サイズの上限
+static constexpr size_t c_transcode_cache_limit = 32 * 1024 * 1024;
+// キャッシュする1つのデコード結果の上限(大きなイメージで他のエントリを追い出さない)
+static constexpr size_t c_transcode_cache_entry_limit = c_transcode_cache_limit / 4;
+// 並列にデコードする最小のブロック数
+static constexpr uint32_t c_parallel_block_count = 1024;
+// 並列にデコードする場合の、スレッドあたりのブロック行の分割数
+static constexpr uint32_t c_ranges_per_thread = 4;
+// ASTCの最大のブロックサイズ(12x12)
+static constexpr uint32_t c_astc_max_block_texels = 144;
+
+// ブロックの種類
+enum BlockKind {
+	BlockKindEtc2RGB = 0,
+	BlockKindEtc2PunchThrough = 1,
+	BlockKindEtc2RGBA = 2,
+	BlockKindEacR11 = 3,
+	BlockKindEacSignedR11 = 4,
+	BlockKindEacRG11 = 5,
+	BlockKindEacSignedRG11 = 6,
+	BlockKindAstc = 7
+};
+
+// フォーマットの情報
+struct FormatDesc {
+	CompressedFormatInfo info;
+	BlockKind kind;
+	bool srgb;
+};
+
+static bool get_format_desc(GLenum internalformat, FormatDesc* desc)
+{
+	AXGL_ASSERT(desc != nullptr);
+	// ASTCのブロックサイズ(GL_COMPRESSED_RGBA_ASTC_4x4_KHRからの順)
+	static const uint8_t c_astc_block_sizes[14][2] = {
+		{4, 4}, {5, 4}, {5, 5}, {6, 5}, {6, 6}, {8, 5}, {8, 6}, {8, 8},
+		{10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10}, {12, 12}
+	};
+	desc->info.blockWidth = 4;
+	desc->info.blockHeight = 4;
+	desc->info.blockBytes = 16;
+	desc->info.transcodedFormat = TranscodedFormatRGBA8;
+	desc->info.transcodedInternalformat = GL_RGBA8;
+	desc->srgb = false;
+	switch (internalformat) {
+	case GL_COMPRESSED_R11_EAC:
+		desc->kind = BlockKindEacR11;
+		desc->info.blockBytes = 8;
+		break;
+	case GL_COMPRESSED_SIGNED_R11_EAC:
+		desc->kind = BlockKindEacSignedR11;
+		desc->info.blockBytes = 8;
+		break;
+	case GL_COMPRESSED_RG11_EAC:
+		desc->kind = BlockKindEacRG11;
+		break;
+	case GL_COMPRESSED_SIGNED_RG11_EAC:
+		desc->kind = BlockKindEacSignedRG11;
+		break;
+	case GL_COMPRESSED_RGB8_ETC2:
+	case GL_COMPRESSED_SRGB8_ETC2:
+		desc->kind = BlockKindEtc2RGB;
+		desc->info.blockBytes = 8;
+		desc->srgb = (internalformat == GL_COMPRESSED_SRGB8_ETC2);
+		break;
+	case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+	case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+		desc->kind = BlockKindEtc2PunchThrough;
+		desc->info.blockBytes = 8;
+		desc->srgb = (internalformat == GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2);
+		break;
+	case GL_COMPRESSED_RGBA8_ETC2_EAC:
+	case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+		desc->kind = BlockKindEtc2RGBA;
+		desc->srgb = (internalformat == GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC);
+		break;
+	default:
+		if ((internalformat >= GL_COMPRESSED_RGBA_ASTC_4x4_KHR) && (internalformat <= GL_COMPRESSED_RGBA_ASTC_12x12_KHR)) {
+			desc->kind = BlockKindAstc;
+			desc->info.blockWidth = c_astc_block_sizes[internalformat - GL_COMPRESSED_RGBA_ASTC_4x4_KHR][0];
+			desc->info.blockHeight = c_astc_block_sizes[internalformat - GL_COMPRESSED_RGBA_ASTC_4x4_KHR][1];
+		} else if ((internalformat >= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR) && (internalformat <= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12_KHR)) {
+			desc->kind = BlockKindAstc;
+			desc->info.blockWidth = c_astc_block_sizes[internalformat - GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR][0];
+			desc->info.blockHeight = c_astc_block_sizes[internalformat - GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR][1];
+			desc->srgb = true;
+		} else {
+			return false;
+		}
+		break;
+	}
+	if (desc->srgb) {
+		desc->info.transcodedFormat = TranscodedFormatSRGB8A8;
+		desc->info.transcodedInternalformat = GL_SRGB8_ALPHA8;
+	} else if ((desc->kind == BlockKindEacR11) || (desc->kind == BlockKindEacSignedR11)) {
+		desc->info.transcodedFormat = TranscodedFormatR16F;
+		desc->info.transcodedInternalformat = GL_R16F;
+	} else if ((desc->kind == BlockKindEacRG11) || (desc->kind == BlockKindEacSignedRG11)) {
+		desc->info.transcodedFormat = TranscodedFormatRG16F;
+		desc->info.transcodedInternalformat = GL_RG16F;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// 共通
+
+static inline uint8_t clamp_u8(int value)
+{
+	return static_cast<uint8_t>((value < 0) ? 0 : ((value > 255) ? 255 : value));
+}
+
+static inline uint32_t read_be32(const uint8_t* p)
+{
+	return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+		| (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+static inline uint64_t read_be64(const uint8_t* p)
+{
+	return (static_cast<uint64_t>(read_be32(p)) << 32) | read_be32(p + 4);
+}
+
+// floatをhalfに変換(最近接偶数丸め、EACのデコード結果の範囲[-1, 1]のみ)
+static uint16_t float_to_half(float value)
+{
+	uint32_t bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+	uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+	int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFF;
+	if (exponent <= 0) {
+		// NOTE: EACのデコード結果は0以外は正規化数の範囲
+		return sign;
+	}
+	uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+	uint32_t round_bits = mantissa & 0x1FFF;
+	if ((round_bits > 0x1000) || ((round_bits == 0x1000) && ((half & 1) != 0))) {
+		half++;
+	}
+	return static_cast<uint16_t>(sign | half);
+}
+
+//----------------------------------------------------------------------------
+// ETC2/EAC
+
+// ETC1の輝度の変化量(ピクセルインデックス0、1の値。2、3は符号が逆)
+static const int c_etc1_modifier_table[8][2] = {
+	{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}
+};
+// ETC2のTモード、Hモードの距離
+static const int c_etc2_distance_table[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+// EACの変化量
+static const int c_eac_modifier_table[16][8] = {
+	{-3, -6, -9, -15, 2, 5, 8, 14},
+	{-3, -7, -10, -13, 2, 6, 9, 12},
+	{-2, -5, -8, -13, 1, 4, 7, 12},
+	{-2, -4, -6, -13, 1, 3, 5, 12},
+	{-3, -6, -8, -12, 2, 5, 7, 11},
+	{-3, -7, -9, -11, 2, 6, 8, 10},
+	{-4, -7, -8, -11, 3, 6, 7, 10},
+	{-3, -5, -8, -11, 2, 4, 7, 10},
+	{-2, -6, -8, -10, 1, 5, 7, 9},
+	{-2, -5, -8, -10, 1, 4, 7, 9},
+	{-2, -4, -8, -10, 1, 3, 7, 9},
+	{-2, -5, -7, -10, 1, 4, 6, 9},
+	{-3, -4, -7, -10, 2, 3, 6, 9},
+	{-1, -2, -3, -10, 0, 1, 2, 9},
+	{-4, -6, -8, -9, 3, 5, 7, 8},
+	{-3, -5, -7, -9, 2, 4, 6, 8}
+};
+
+static inline int extend4(uint32_t value)
+{
+	return static_cast<int>((value << 4) | value);
+}
+
+static inline int extend5(uint32_t value)
+{
+	return static_cast<int>((value << 3) | (value >> 2));
+}
+
+static inline int extend6(uint32_t value)
+{
+	return static_cast<int>((value << 2) | (value >> 4));
+}
+
+static inline int extend7(uint32_t value)
+{
+	return static_cast<int>((value << 1) | (value >> 6));
+}
+
+// 3bitの符号付きの値
+static inline int sign_extend3(uint32_t value)
+{
+	return ((value & 0x4) != 0) ? (static_cast<int>(value) - 8) : static_cast<int>(value);
+}
+
+static inline void set_rgba(uint8_t* dst, int r, int g, int b, int a)
+{
+	dst[0] = clamp_u8(r);
+	dst[1] = clamp_u8(g);
+	dst[2] = clamp_u8(b);
+	dst[3] = clamp_u8(a);
+	return;
+}
+
+// ETC2のRGBブロックをデコード(dstは4x4のRGBA8、行のピッチは16バイト)
+// NOTE: punchThroughの場合はRGB8_PUNCHTHROUGH_ALPHA1として、差分ビットを不透明フラグとして扱う
+static void decode_etc2_rgb_block(const uint8_t* block, bool punchThrough, uint8_t* dst)
+{
+	uint32_t hi = read_be32(block);
+	uint32_t lo = read_be32(block + 4);
+	bool diff_bit = ((hi >> 1) & 1) != 0;
+	bool flip_bit = (hi & 1) != 0;
+	bool opaque = true;
+	if (punchThrough) {
+		// NOTE: punchthroughは個別モードがなく、常に差分モードのレイアウト
+		opaque = diff_bit;
+		diff_bit = true;
+	}
+	// ピクセルのインデックス(x * 4 + yの順)
+	uint32_t indices[16];
+	for (uint32_t p = 0; p < 16; p++) {
+		indices[p] = (((lo >> (p + 16)) & 1) << 1) | ((lo >> p) & 1);
+	}
+	int base[2][3];
+	if (!diff_bit) {
+		// 個別モード
+		base[0][0] = extend4((hi >> 28) & 0xF);
+		base[1][0] = extend4((hi >> 24) & 0xF);
+		base[0][1] = extend4((hi >> 20) & 0xF);
+		base[1][1] = extend4((hi >> 16) & 0xF);
+		base[0][2] = extend4((hi >> 12) & 0xF);
+		base[1][2] = extend4((hi >> 8) & 0xF);
+	} else {
+		int r = (hi >> 27) & 0x1F;
+		int g = (hi >> 19) & 0x1F;
+		int b = (hi >> 11) & 0x1F;
+		int r2 = r + sign_extend3((hi >> 24) & 0x7);
+		int g2 = g + sign_extend3((hi >> 16) & 0x7);
+		int b2 = b + sign_extend3((hi >> 8) & 0x7);
+		if ((r2 < 0) || (r2 > 31)) {
+			// Tモード
+			int c1[3] = {
+				extend4((((hi >> 27) & 0x3) << 2) | ((hi >> 24) & 0x3)),
+				extend4((hi >> 20) & 0xF),
+				extend4((hi >> 16) & 0xF)
+			};
+			int c2[3] = { extend4((hi >> 12) & 0xF), extend4((hi >> 8) & 0xF), extend4((hi >> 4) & 0xF) };
+			int d = c_etc2_distance_table[(((hi >> 2) & 0x3) << 1) | (hi & 1)];
+			int paint[4][3];
+			for (int c = 0; c < 3; c++) {
+				paint[0][c] = c1[c];
+				paint[1][c] = c2[c] + d;
+				paint[2][c] = c2[c];
+				paint[3][c] = c2[c] - d;
+			}
+			for (uint32_t p = 0; p < 16; p++) {
+				uint8_t* dp = dst + ((p & 3) * 16) + ((p >> 2) * 4);
+				if (!opaque && (indices[p] == 2)) {
+					set_rgba(dp, 0, 0, 0, 0);
+				} else {
+					const int* color = paint[indices[p]];
+					set_rgba(dp, color[0], color[1], color[2], 255);
+				}
+			}
+			return;
+		}
+		if ((g2 < 0) || (g2 > 31)) {
+			// Hモード
+			uint32_t r1 = (hi >> 27) & 0xF;
+			uint32_t g1 = (((hi >> 24) & 0x7) << 1) | ((hi >> 20) & 1);
+			uint32_t b1 = (((hi >> 19) & 1) << 3) | ((hi >> 15) & 0x7);
+			uint32_t r2h = (hi >> 11) & 0xF;
+			uint32_t g2h = (hi >> 7) & 0xF;
+			uint32_t b2h = (hi >> 3) & 0xF;
+			uint32_t order = (((r1 << 8) | (g1 << 4) | b1) >= ((r2h << 8) | (g2h << 4) | b2h)) ? 1 : 0;
+			int d = c_etc2_distance_table[(((hi >> 2) & 1) << 2) | ((hi & 1) << 1) | order];
+			int c1[3] = { extend4(r1), extend4(g1), extend4(b1) };
+			int c2[3] = { extend4(r2h), extend4(g2h), extend4(b2h) };
+			int paint[4][3];
+			for (int c = 0; c < 3; c++) {
+				paint[0][c] = c1[c] + d;
+				paint[1][c] = c1[c] - d;
+				paint[2][c] = c2[c] + d;
+				paint[3][c] = c2[c] - d;
+			}
+			for (uint32_t p = 0; p < 16; p++) {
+				uint8_t* dp = dst + ((p & 3) * 16) + ((p >> 2) * 4);
+				if (!opaque && (indices[p] == 2)) {
+					set_rgba(dp, 0, 0, 0, 0);
+				} else {
+					const int* color = paint[indices[p]];
+					set_rgba(dp, color[0], color[1], color[2], 255);
+				}
+			}
+			return;
+		}
+		if ((b2 < 0) || (b2 > 31)) {
+			// プラナーモード(常に不透明)
+			int ro = extend6((hi >> 25) & 0x3F);
+			int go = extend7((((hi >> 24) & 1) << 6) | ((hi >> 17) & 0x3F));
+			int bo = extend6((((hi >> 16) & 1) << 5) | (((hi >> 11) & 0x3) << 3) | ((hi >> 7) & 0x7));
+			int rh = extend6((((hi >> 2) & 0x1F) << 1) | (hi & 1));
+			int gh = extend7((lo >> 25) & 0x7F);
+			int bh = extend6((lo >> 19) & 0x3F);
+			int rv = extend6((lo >> 13) & 0x3F);
+			int gv = extend7((lo >> 6) & 0x7F);
+			int bv = extend6(lo & 0x3F);
+			for (int y = 0; y < 4; y++) {
+				for (int x = 0; x < 4; x++) {
+					uint8_t* dp = dst + (y * 16) + (x * 4);
+					set_rgba(dp,
+						((x * (rh - ro)) + (y * (rv - ro)) + (4 * ro) + 2) >> 2,
+						((x * (gh - go)) + (y * (gv - go)) + (4 * go) + 2) >> 2,
+						((x * (bh - bo)) + (y * (bv - bo)) + (4 * bo) + 2) >> 2,
+						255);
+				}
+			}
+			return;
+		}
+		// 差分モード
+		base[0][0] = extend5(r);
+		base[0][1] = extend5(g);
+		base[0][2] = extend5(b);
+		base[1][0] = extend5(r2);
+		base[1][1] = extend5(g2);
+		base[1][2] = extend5(b2);
+	}
+	const int* modifiers[2] = {
+		c_etc1_modifier_table[(hi >> 5) & 0x7],
+		c_etc1_modifier_table[(hi >> 2) & 0x7]
+	};
+	for (uint32_t p = 0; p < 16; p++) {
+		uint32_t x = p >> 2;
+		uint32_t y = p & 3;
+		uint32_t sub_block = flip_bit ? (y >> 1) : (x >> 1);
+		uint8_t* dp = dst + (y * 16) + (x * 4);
+		uint32_t index = indices[p];
+		int modifier = 0;
+		if (!opaque) {
+			// 不透明でない場合は、インデックス2が透明、0の変化量は0
+			if (index == 2) {
+				set_rgba(dp, 0, 0, 0, 0);
+				continue;
+			}
+			modifier = (index == 0) ? 0 : ((index == 1) ? modifiers[sub_block][1] : -modifiers[sub_block][1]);
+		} else {
+			modifier = ((index & 2) != 0) ? -modifiers[sub_block][index & 1] : modifiers[sub_block][index & 1];
+		}
+		const int* color = base[sub_block];
+		set_rgba(dp, color[0] + modifier, color[1] + modifier, color[2] + modifier, 255);
+	}
+	return;
+}
+
+// EACのブロックをデコード(valuesは4x4、y * 4 + xの順)
+// NOTE: eleven == falseはETC2のアルファ(8bit)、trueはR11(符号付きの場合は[-1023, 1023]、符号なしは[0, 2047])
+static void decode_eac_block(const uint8_t* block, bool eleven, bool isSigned, int* values)
+{
+	uint64_t bits = read_be64(block);
+	int base = static_cast<int>((bits >> 56) & 0xFF);
+	int multiplier = static_cast<int>((bits >> 52) & 0xF);
+	const int* modifiers = c_eac_modifier_table[(bits >> 48) & 0xF];
+	if (eleven && isSigned) {
+		base = static_cast<int8_t>(base);
+		if (base == -128) {
+			base = -127;
+		}
+	}
+	for (uint32_t p = 0; p < 16; p++) {
+		int modifier = modifiers[(bits >> (45 - (3 * p))) & 0x7];
+		int value = 0;
+		if (!eleven) {
+			value = std::min(std::max(base + (modifier * multiplier), 0), 255);
+		} else {
+			// NOTE: 乗数が0の場合は1/8として扱う
+			int scaled = (multiplier != 0) ? (modifier * multiplier * 8) : modifier;
+			if (isSigned) {
+				value = std::min(std::max((base * 8) + scaled, -1023), 1023);
+			} else {
+				value = std::min(std::max((base * 8) + 4 + scaled, 0), 2047);
+			}
+		}
+		values[((p & 3) * 4) + (p >> 2)] = value;
+	}
+	return;
+}
+
+// EAC R11/RG11のブロックをデコード(dstは4x4のhalf、行のピッチはchannels * 8バイト)
+static void decode_eac_r11_block(const uint8_t* block, uint32_t channels, bool isSigned, uint8_t* dst)
+{
+	float scale = isSigned ? (1.0f / 1023.0f) : (1.0f / 2047.0f);
+	for (uint32_t c = 0; c < channels; c++) {
+		int values[16];
+		decode_eac_block(block + (c * 8), true, isSigned, values);
+		uint16_t* dp = reinterpret_cast<uint16_t*>(dst);
+		for (uint32_t i = 0; i < 16; i++) {
+			dp[(i * channels) + c] = float_to_half(values[i] * scale);
+		}
+	}
+	return;
+}
+
+//----------------------------------------------------------------------------
+// ASTC(LDR)
+
+// ASTCの量子化レベル
+enum {
+	AstcQuant2 = 0,
+	AstcQuant3 = 1,
+	AstcQuant4 = 2,
+	AstcQuant5 = 3,
+	AstcQuant6 = 4,
+	AstcQuant8 = 5,
+	AstcQuant32 = 11,
+	AstcQuant256 = 20,
+	AstcQuantCount = 21,
+	// ウェイトに使用する量子化レベルの数
+	AstcWeightQuantCount = 12
+};
+
+// 整数列の符号化(Integer Sequence Encoding)の構成
+struct IseEncoding {
+	uint8_t bits;
+	uint8_t trits;
+	uint8_t quints;
+};
+
+static const IseEncoding c_ise_encodings[AstcQuantCount] = {
+	{1, 0, 0}, {0, 1, 0}, {2, 0, 0}, {0, 0, 1}, {1, 1, 0}, {3, 0, 0}, {1, 0, 1},
+	{2, 1, 0}, {4, 0, 0}, {2, 0, 1}, {3, 1, 0}, {5, 0, 0}, {3, 0, 1}, {4, 1, 0},
+	{6, 0, 0}, {4, 0, 1}, {5, 1, 0}, {7, 0, 0}, {5, 0, 1}, {6, 1, 0}, {8, 0, 0}
+};
+
+// ASTCのデコードに使用するテーブル
+struct AstcTables {
+	uint8_t trits[256][5];
+	uint8_t quints[128][3];
+	// 量子化された値から色の値[0, 255]
+	uint8_t colorUnquant[AstcQuantCount][256];
+	// 量子化された値からウェイト[0, 64]
+	uint8_t weightUnquant[AstcWeightQuantCount][32];
+};
+
+static inline uint32_t get_bit(uint32_t value, uint32_t bit)
+{
+	return (value >> bit) & 1;
+}
+
+static void build_trit_table(uint8_t trits[256][5])
+{
+	for (uint32_t t = 0; t < 256; t++) {
+		uint32_t c = 0;
+		uint32_t t3 = 0;
+		uint32_t t4 = 0;
+		if (((t >> 2) & 0x7) == 0x7) {
+			c = (((t >> 5) & 0x7) << 2) | (t & 0x3);
+			t4 = 2;
+			t3 = 2;
+		} else {
+			c = t & 0x1F;
+			if (((t >> 5) & 0x3) == 0x3) {
+				t4 = 2;
+				t3 = get_bit(t, 7);
+			} else {
+				t4 = get_bit(t, 7);
+				t3 = (t >> 5) & 0x3;
+			}
+		}
+		uint32_t t0 = 0;
+		uint32_t t1 = 0;
+		uint32_t t2 = 0;
+		if ((c & 0x3) == 0x3) {
+			t2 = 2;
+			t1 = get_bit(c, 4);
+			t0 = (get_bit(c, 3) << 1) | (get_bit(c, 2) & ~get_bit(c, 3) & 1);
+		} else if (((c >> 2) & 0x3) == 0x3) {
+			t2 = 2;
+			t1 = 2;
+			t0 = c & 0x3;
+		} else {
+			t2 = get_bit(c, 4);
+			t1 = (c >> 2) & 0x3;
+			t0 = (get_bit(c, 1) << 1) | (get_bit(c, 0) & ~get_bit(c, 1) & 1);
+		}
+		trits[t][0] = static_cast<uint8_t>(t0);
+		trits[t][1] = static_cast<uint8_t>(t1);
+		trits[t][2] = static_cast<uint8_t>(t2);
+		trits[t][3] = static_cast<uint8_t>(t3);
+		trits[t][4] = static_cast<uint8_t>(t4);
+	}
+	return;
+}
+
+static void build_quint_table(uint8_t quints[128][3])
+{
+	for (uint32_t q = 0; q < 128; q++) {
+		uint32_t q0 = 0;
+		uint32_t q1 = 0;
+		uint32_t q2 = 0;
+		if ((((q >> 1) & 0x3) == 0x3) && (((q >> 5) & 0x3) == 0)) {
+			q2 = (get_bit(q, 0) << 2) | ((get_bit(q, 4) & ~get_bit(q, 0) & 1) << 1) | (get_bit(q, 3) & ~get_bit(q, 0) & 1);
+			q1 = 4;
+			q0 = 4;
+		} else {
+			uint32_t c = 0;
+			if (((q >> 1) & 0x3) == 0x3) {
+				q2 = 4;
+				c = (((q >> 3) & 0x3) << 3) | ((~(q >> 5) & 0x3) << 1) | get_bit(q, 0);
+			} else {
+				q2 = (q >> 5) & 0x3;
+				c = q & 0x1F;
+			}
+			if ((c & 0x7) == 0x5) {
+				q1 = 4;
+				q0 = (c >> 3) & 0x3;
+			} else {
+				q1 = (c >> 3) & 0x3;
+				q0 = c & 0x7;
+			}
+		}
+		quints[q][0] = static_cast<uint8_t>(q0);
+		quints[q][1] = static_cast<uint8_t>(q1);
+		quints[q][2] = static_cast<uint8_t>(q2);
+	}
+	return;
+}
+
+// ビットを繰り返して8bitに拡張
+static uint32_t replicate_bits(uint32_t value, uint32_t bits, uint32_t targetBits)
+{
+	uint32_t result = 0;
+	uint32_t filled = 0;
+	while (filled < targetBits) {
+		result = (result << bits) | value;
+		filled += bits;
+	}
+	return result >> (filled - targetBits);
+}
+
+static uint32_t unquantize_color(uint32_t quant, uint32_t value)
+{
+	const IseEncoding& encoding = c_ise_encodings[quant];
+	if ((encoding.trits == 0) && (encoding.quints == 0)) {
+		return replicate_bits(value, encoding.bits, 8);
+	}
+	uint32_t d = value >> encoding.bits;
+	uint32_t m = value & ((1u << encoding.bits) - 1);
+	uint32_t a = get_bit(m, 0) ? 0x1FF : 0;
+	uint32_t b1 = get_bit(m, 1);
+	uint32_t b2 = get_bit(m, 2);
+	uint32_t b3 = get_bit(m, 3);
+	uint32_t b4 = get_bit(m, 4);
+	uint32_t b5 = get_bit(m, 5);
+	uint32_t b = 0;
+	uint32_t c = 0;
+	if (encoding.trits != 0) {
+		switch (encoding.bits) {
+		case 1:
+			c = 204;
+			break;
+		case 2:
+			// b000b0bb0
+			b = (b1 << 8) | (b1 << 4) | (b1 << 2) | (b1 << 1);
+			c = 93;
+			break;
+		case 3:
+			// cb000cbcb
+			b = (b2 << 8) | (b1 << 7) | (b2 << 3) | (b1 << 2) | (b2 << 1) | b1;
+			c = 44;
+			break;
+		case 4:
+			// dcb000dcb
+			b = (b3 << 8) | (b2 << 7) | (b1 << 6) | (b3 << 2) | (b2 << 1) | b1;
+			c = 22;
+			break;
+		case 5:
+			// edcb000ed
+			b = (b4 << 8) | (b3 << 7) | (b2 << 6) | (b1 << 5) | (b4 << 1) | b3;
+			c = 11;
+			break;
+		case 6:
+			// fedcb000f
+			b = (b5 << 8) | (b4 << 7) | (b3 << 6) | (b2 << 5) | (b1 << 4) | b5;
+			c = 5;
+			break;
+		default:
+			break;
+		}
+	} else {
+		switch (encoding.bits) {
+		case 1:
+			c = 113;
+			break;
+		case 2:
+			// b0000bb00
+			b = (b1 << 8) | (b1 << 3) | (b1 << 2);
+			c = 54;
+			break;
+		case 3:
+			// cb0000cbc
+			b = (b2 << 8) | (b1 << 7) | (b2 << 2) | (b1 << 1) | b2;
+			c = 26;
+			break;
+		case 4:
+			// dcb0000dc
+			b = (b3 << 8) | (b2 << 7) | (b1 << 6) | (b3 << 1) | b2;
+			c = 13;
+			break;
+		case 5:
+			// edcb0000e
+			b = (b4 << 8) | (b3 << 7) | (b2 << 6) | (b1 << 5) | b4;
+			c = 6;
+			break;
+		default:
+			break;
+		}
+	}
+	uint32_t t = (d * c) + b;
+	t ^= a;
+	return (a & 0x80) | (t >> 2);
+}
+
+static uint32_t unquantize_weight(uint32_t quant, uint32_t value)
+{
+	const IseEncoding& encoding = c_ise_encodings[quant];
+	uint32_t result = 0;
+	if ((encoding.trits == 0) && (encoding.quints == 0)) {
+		result = replicate_bits(value, encoding.bits, 6);
+	} else if (encoding.bits == 0) {
+		static const uint8_t c_trit_weights[3] = {0, 32, 63};
+		static const uint8_t c_quint_weights[5] = {0, 16, 32, 47, 63};
+		result = (encoding.trits != 0) ? c_trit_weights[value] : c_quint_weights[value];
+	} else {
+		uint32_t d = value >> encoding.bits;
+		uint32_t m = value & ((1u << encoding.bits) - 1);
+		uint32_t a = get_bit(m, 0) ? 0x7F : 0;
+		uint32_t b1 = get_bit(m, 1);
+		uint32_t b2 = get_bit(m, 2);
+		uint32_t b = 0;
+		uint32_t c = 0;
+		if (encoding.trits != 0) {
+			switch (encoding.bits) {
+			case 1:
+				c = 50;
+				break;
+			case 2:
+				// b000b0b
+				b = (b1 << 6) | (b1 << 2) | b1;
+				c = 23;
+				break;
+			case 3:
+				// cb000cb
+				b = (b2 << 6) | (b1 << 5) | (b2 << 1) | b1;
+				c = 11;
+				break;
+			default:
+				break;
+			}
+		} else {
+			switch (encoding.bits) {
+			case 1:
+				c = 28;
+				break;
+			case 2:
+				// b0000b0
+				b = (b1 << 6) | (b1 << 1);
+				c = 13;
+				break;
+			default:
+				break;
+			}
+		}
+		uint32_t t = (d * c) + b;
+		t ^= a;
+		result = (a & 0x20) | (t >> 2);
+	}
+	// [0, 63]を[0, 64]に拡張
+	if (result > 32) {
+		result++;
+	}
+	return result;
+}
+
+static const AstcTables& get_astc_tables()
+{
+	// NOTE: 関数内のstatic変数の初期化はスレッドセーフ
+	static const AstcTables* s_tables = []() {
+		static AstcTables tables;
+		build_trit_table(tables.trits);
+		build_quint_table(tables.quints);
+		for (uint32_t q = 0; q < AstcQuantCount; q++) {
+			const IseEncoding& encoding = c_ise_encodings[q];
+			uint32_t levels = (1u << encoding.bits) * ((encoding.trits != 0) ? 3 : ((encoding.quints != 0) ? 5 : 1));
+			for (uint32_t v = 0; v < 256; v++) {
+				tables.colorUnquant[q][v] = static_cast<uint8_t>((v < levels) ? unquantize_color(q, v) : 0);
+			}
+			if (q < AstcWeightQuantCount) {
+				for (uint32_t v = 0; v < 32; v++) {
+					tables.weightUnquant[q][v] = static_cast<uint8_t>((v < levels) ? unquantize_weight(q, v) : 0);
+				}
+			}
+		}
+		return &tables;
+	}();
+	return *s_tables;
+}
+
+// 128bitのブロックからビット列を読み出す(endより後のビットは0)
+static inline uint32_t read_bits(const uint8_t* block, uint32_t pos, uint32_t count, uint32_t end = 128)
+{
+	if ((count == 0) || (pos >= end)) {
+		return 0;
+	}
+	count = std::min(count, end - pos);
+	uint32_t value = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t bit_pos = pos + i;
+		value |= static_cast<uint32_t>((block[bit_pos >> 3] >> (bit_pos & 7)) & 1) << i;
+	}
+	return value;
+}
+
+static uint32_t get_ise_bit_count(uint32_t count, uint32_t quant)
+{
+	const IseEncoding& encoding = c_ise_encodings[quant];
+	uint32_t bits = encoding.bits * count;
+	if (encoding.trits != 0) {
+		bits += ((8 * count) + 4) / 5;
+	}
+	if (encoding.quints != 0) {
+		bits += ((7 * count) + 2) / 3;
+	}
+	return bits;
+}
+
+// 整数列の符号化をデコード(valuesは量子化された値)
+static void decode_ise(const AstcTables& tables, uint32_t quant, uint32_t count, const uint8_t* block, uint32_t pos, uint8_t* values)
+{
+	const IseEncoding& encoding = c_ise_encodings[quant];
+	uint32_t end = pos + get_ise_bit_count(count, quant);
+	uint32_t bits = encoding.bits;
+	if (encoding.trits != 0) {
+		// 5つの値毎に8bitのトリット
+		static const uint8_t c_trit_bits[5] = {2, 2, 1, 2, 1};
+		for (uint32_t i = 0; i < count; i += 5) {
+			uint32_t m[5];
+			uint32_t t = 0;
+			uint32_t t_shift = 0;
+			for (uint32_t j = 0; j < 5; j++) {
+				m[j] = read_bits(block, pos, bits, end);
+				pos += bits;
+				t |= read_bits(block, pos, c_trit_bits[j], end) << t_shift;
+				pos += c_trit_bits[j];
+				t_shift += c_trit_bits[j];
+			}
+			for (uint32_t j = 0; (j < 5) && ((i + j) < count); j++) {
+				values[i + j] = static_cast<uint8_t>((tables.trits[t][j] << bits) | m[j]);
+			}
+		}
+	} else if (encoding.quints != 0) {
+		// 3つの値毎に7bitのクイント
+		static const uint8_t c_quint_bits[3] = {3, 2, 2};
+		for (uint32_t i = 0; i < count; i += 3) {
+			uint32_t m[3];
+			uint32_t q = 0;
+			uint32_t q_shift = 0;
+			for (uint32_t j = 0; j < 3; j++) {
+				m[j] = read_bits(block, pos, bits, end);
+				pos += bits;
+				q |= read_bits(block, pos, c_quint_bits[j], end) << q_shift;
+				pos += c_quint_bits[j];
+				q_shift += c_quint_bits[j];
+			}
+			for (uint32_t j = 0; (j < 3) && ((i + j) < count); j++) {
+				values[i + j] = static_cast<uint8_t>((tables.quints[q][j] << bits) | m[j]);
+			}
+		}
+	} else {
+		for (uint32_t i = 0; i < count; i++) {
+			values[i] = static_cast<uint8_t>(read_bits(block, pos, bits, end));
+			pos += bits;
+		}
+	}
+	return;
+}
+
+// ブロックモード
+struct AstcBlockMode {
+	uint32_t gridWidth;
+	uint32_t gridHeight;
+	uint32_t weightQuant;
+	bool dualPlane;
+};
+
+static bool decode_block_mode(uint32_t mode, AstcBlockMode* blockMode)
+{
+	uint32_t r = 0;
+	uint32_t h = get_bit(mode, 9);
+	uint32_t d = get_bit(mode, 10);
+	uint32_t a = (mode >> 5) & 0x3;
+	uint32_t w = 0;
+	uint32_t gh = 0;
+	if ((mode & 0x3) != 0) {
+		r = ((mode & 0x3) << 1) | get_bit(mode, 4);
+		uint32_t b = (mode >> 7) & 0x3;
+		switch ((mode >> 2) & 0x3) {
+		case 0:
+			w = b + 4;
+			gh = a + 2;
+			break;
+		case 1:
+			w = b + 8;
+			gh = a + 2;
+			break;
+		case 2:
+			w = a + 2;
+			gh = b + 8;
+			break;
+		default:
+			b &= 1;
+			if (get_bit(mode, 8) != 0) {
+				w = b + 2;
+				gh = a + 2;
+			} else {
+				w = a + 2;
+				gh = b + 6;
+			}
+			break;
+		}
+	} else {
+		r = (((mode >> 2) & 0x3) << 1) | get_bit(mode, 4);
+		if (((mode >> 2) & 0x3) == 0) {
+			// 予約
+			return false;
+		}
+		uint32_t b = (mode >> 9) & 0x3;
+		switch ((mode >> 7) & 0x3) {
+		case 0:
+			w = 12;
+			gh = a + 2;
+			break;
+		case 1:
+			w = a + 2;
+			gh = 12;
+			break;
+		case 2:
+			w = a + 6;
+			gh = b + 6;
+			d = 0;
+			h = 0;
+			break;
+		default:
+			if (a == 0) {
+				w = 6;
+				gh = 10;
+			} else if (a == 1) {
+				w = 10;
+				gh = 6;
+			} else {
+				return false;
+			}
+			break;
+		}
+	}
+	if (r < 2) {
+		return false;
+	}
+	blockMode->gridWidth = w;
+	blockMode->gridHeight = gh;
+	blockMode->weightQuant = (r - 2) + (h * 6);
+	blockMode->dualPlane = (d != 0);
+	return true;
+}
+
+// パーティションのハッシュ
+static uint32_t hash52(uint32_t value)
+{
+	value ^= value >> 15;
+	value *= 0xEEDE0891;
+	value ^= value >> 5;
+	value += value << 16;
+	value ^= value >> 7;
+	value ^= value >> 3;
+	value ^= value << 6;
+	value ^= value >> 17;
+	return value;
+}
+
+static uint32_t select_partition(uint32_t seed, uint32_t x, uint32_t y, uint32_t partitionCount, bool smallBlock)
+{
+	if (smallBlock) {
+		x <<= 1;
+		y <<= 1;
+	}
+	seed += (partitionCount - 1) * 1024;
+	uint32_t rnum = hash52(seed);
+	uint32_t seeds[8];
+	for (uint32_t i = 0; i < 8; i++) {
+		seeds[i] = (rnum >> (i * 4)) & 0xF;
+		seeds[i] *= seeds[i];
+	}
+	uint32_t sh1 = 0;
+	uint32_t sh2 = 0;
+	if ((seed & 1) != 0) {
+		sh1 = ((seed & 2) != 0) ? 4 : 5;
+		sh2 = (partitionCount == 3) ? 6 : 5;
+	} else {
+		sh1 = (partitionCount == 3) ? 6 : 5;
+		sh2 = ((seed & 2) != 0) ? 4 : 5;
+	}
+	for (uint32_t i = 0; i < 8; i++) {
+		seeds[i] >>= ((i & 1) == 0) ? sh1 : sh2;
+	}
+	// NOTE: 2Dではzの項(seed9～seed12)は0
+	uint32_t a = ((seeds[0] * x) + (seeds[1] * y) + (rnum >> 14)) & 0x3F;
+	uint32_t b = ((seeds[2] * x) + (seeds[3] * y) + (rnum >> 10)) & 0x3F;
+	uint32_t c = ((seeds[4] * x) + (seeds[5] * y) + (rnum >> 6)) & 0x3F;
+	uint32_t d = ((seeds[6] * x) + (seeds[7] * y) + (rnum >> 2)) & 0x3F;
+	if (partitionCount < 4) {
+		d = 0;
+	}
+	if (partitionCount < 3) {
+		c = 0;
+	}
+	if ((a >= b) && (a >= c) && (a >= d)) {
+		return 0;
+	} else if ((b >= c) && (b >= d)) {
+		return 1;
+	} else if (c >= d) {
+		return 2;
+	}
+	return 3;
+}
+
+static inline void bit_transfer_signed(int* a, int* b)
+{
+	*b >>= 1;
+	*b |= *a & 0x80;
+	*a >>= 1;
+	*a &= 0x3F;
+	if ((*a & 0x20) != 0) {
+		*a -= 0x40;
+	}
+	return;
+}
+
+static inline void set_endpoint(int* e, int r, int g, int b, int a)
+{
+	e[0] = std::min(std::max(r, 0), 255);
+	e[1] = std::min(std::max(g, 0), 255);
+	e[2] = std::min(std::max(b, 0), 255);
+	e[3] = std::min(std::max(a, 0), 255);
+	return;
+}
+
+// 青を縮約したエンドポイント
+static inline void set_endpoint_blue_contract(int* e, int r, int g, int b, int a)
+{
+	set_endpoint(e, (r + b) >> 1, (g + b) >> 1, b, a);
+	return;
+}
+
+// LDRのエンドポイントをデコード(HDRのモードはfalse)
+static bool decode_endpoints(uint32_t cem, const int* values, int* e0, int* e1)
+{
+	int v[8];
+	for (uint32_t i = 0; i < (((cem >> 2) + 1) * 2); i++) {
+		v[i] = values[i];
+	}
+	switch (cem) {
+	case 0:
+		// 輝度
+		set_endpoint(e0, v[0], v[0], v[0], 255);
+		set_endpoint(e1, v[1], v[1], v[1], 255);
+		break;
+	case 1:
+		{
+			// 輝度(基準値と差分)
+			int l0 = (v[0] >> 2) | (v[1] & 0xC0);
+			int l1 = std::min(l0 + (v[1] & 0x3F), 255);
+			set_endpoint(e0, l0, l0, l0, 255);
+			set_endpoint(e1, l1, l1, l1, 255);
+		}
+		break;
+	case 4:
+		// 輝度とアルファ
+		set_endpoint(e0, v[0], v[0], v[0], v[2]);
+		set_endpoint(e1, v[1], v[1], v[1], v[3]);
+		break;
+	case 5:
+		// 輝度とアルファ(基準値と差分)
+		bit_transfer_signed(&v[1], &v[0]);
+		bit_transfer_signed(&v[3], &v[2]);
+		set_endpoint(e0, v[0], v[0], v[0], v[2]);
+		set_endpoint(e1, v[0] + v[1], v[0] + v[1], v[0] + v[1], v[2] + v[3]);
+		break;
+	case 6:
+		// RGBとスケール
+		set_endpoint(e0, (v[0] * v[3]) >> 8, (v[1] * v[3]) >> 8, (v[2] * v[3]) >> 8, 255);
+		set_endpoint(e1, v[0], v[1], v[2], 255);
+		break;
+	case 8:
+		// RGB
+		if ((v[1] + v[3] + v[5]) >= (v[0] + v[2] + v[4])) {
+			set_endpoint(e0, v[0], v[2], v[4], 255);
+			set_endpoint(e1, v[1], v[3], v[5], 255);
+		} else {
+			set_endpoint_blue_contract(e0, v[1], v[3], v[5], 255);
+			set_endpoint_blue_contract(e1, v[0], v[2], v[4], 255);
+		}
+		break;
+	case 9:
+		// RGB(基準値と差分)
+		bit_transfer_signed(&v[1], &v[0]);
+		bit_transfer_signed(&v[3], &v[2]);
+		bit_transfer_signed(&v[5], &v[4]);
+		if ((v[1] + v[3] + v[5]) >= 0) {
+			set_endpoint(e0, v[0], v[2], v[4], 255);
+			set_endpoint(e1, v[0] + v[1], v[2] + v[3], v[4] + v[5], 255);
+		} else {
+			set_endpoint_blue_contract(e0, v[0] + v[1], v[2] + v[3], v[4] + v[5], 255);
+			set_endpoint_blue_contract(e1, v[0], v[2], v[4], 255);
+		}
+		break;
+	case 10:
+		// RGBとスケール、アルファ
+		set_endpoint(e0, (v[0] * v[3]) >> 8, (v[1] * v[3]) >> 8, (v[2] * v[3]) >> 8, v[4]);
+		set_endpoint(e1, v[0], v[1], v[2], v[5]);
+		break;
+	case 12:
+		// RGBA
+		if ((v[1] + v[3] + v[5]) >= (v[0] + v[2] + v[4])) {
+			set_endpoint(e0, v[0], v[2], v[4], v[6]);
+			set_endpoint(e1, v[1], v[3], v[5], v[7]);
+		} else {
+			set_endpoint_blue_contract(e0, v[1], v[3], v[5], v[7]);
+			set_endpoint_blue_contract(e1, v[0], v[2], v[4], v[6]);
+		}
+		break;
+	case 13:
+		// RGBA(基準値と差分)
+		bit_transfer_signed(&v[1], &v[0]);
+		bit_transfer_signed(&v[3], &v[2]);
+		bit_transfer_signed(&v[5], &v[4]);
+		bit_transfer_signed(&v[7], &v[6]);
+		if ((v[1] + v[3] + v[5]) >= 0) {
+			set_endpoint(e0, v[0], v[2], v[4], v[6]);
+			set_endpoint(e1, v[0] + v[1], v[2] + v[3], v[4] + v[5], v[6] + v[7]);
+		} else {
+			set_endpoint_blue_contract(e0, v[0] + v[1], v[2] + v[3], v[4] + v[5], v[6] + v[7]);
+			set_endpoint_blue_contract(e1, v[0], v[2], v[4], v[6]);
+		}
+		break;
+	default:
+		// HDR
+		return false;
+	}
+	return true;
+}
+
+// 16bitの値を8bitに変換
+static inline uint8_t astc_to_u8(uint32_t value, bool srgb)
+{
+	return static_cast<uint8_t>(srgb ? (value >> 8) : (((value * 255) + 32767) / 65535));
+}
+
+// エラーの色(マゼンタ)で埋める
+static void fill_astc_error(uint8_t* dst, uint32_t texelCount)
+{
+	for (uint32_t i = 0; i < texelCount; i++) {
+		set_rgba(dst + (i * 4), 255, 0, 255, 255);
+	}
+	return;
+}
+
+// ASTCのブロックをデコード(dstはblockWidth x blockHeightのRGBA8、隙間なし)
+static void decode_astc_block(const uint8_t* block, uint32_t blockWidth, uint32_t blockHeight, bool srgb, uint8_t* dst)
+{
+	const AstcTables& tables = get_astc_tables();
+	uint32_t texel_count = blockWidth * blockHeight;
+	uint32_t mode = read_bits(block, 0, 11);
+	if ((mode & 0x1FF) == 0x1FC) {
+		// 単色のブロック(void-extent)
+		if (get_bit(mode, 9) != 0) {
+			// HDR
+			fill_astc_error(dst, texel_count);
+			return;
+		}
+		uint8_t color[4];
+		for (uint32_t c = 0; c < 4; c++) {
+			color[c] = astc_to_u8(read_bits(block, 64 + (c * 16), 16), srgb);
+		}
+		for (uint32_t i = 0; i < texel_count; i++) {
+			memcpy(dst + (i * 4), color, 4);
+		}
+		return;
+	}
+	AstcBlockMode block_mode;
+	if (!decode_block_mode(mode, &block_mode)
+		|| (block_mode.gridWidth > blockWidth) || (block_mode.gridHeight > blockHeight)) {
+		fill_astc_error(dst, texel_count);
+		return;
+	}
+	uint32_t plane_count = block_mode.dualPlane ? 2 : 1;
+	uint32_t grid_count = block_mode.gridWidth * block_mode.gridHeight;
+	uint32_t weight_count = grid_count * plane_count;
+	uint32_t weight_bits = get_ise_bit_count(weight_count, block_mode.weightQuant);
+	uint32_t partition_count = read_bits(block, 11, 2) + 1;
+	if ((weight_count > 64) || (weight_bits < 24) || (weight_bits > 96)
+		|| (block_mode.dualPlane && (partition_count == 4))) {
+		fill_astc_error(dst, texel_count);
+		return;
+	}
+	// カラーエンドポイントモード
+	uint32_t cems[4] = {0, 0, 0, 0};
+	uint32_t partition_index = 0;
+	uint32_t config_end = 17;
+	uint32_t below_weights = 128 - weight_bits;
+	if (partition_count == 1) {
+		cems[0] = read_bits(block, 13, 4);
+	} else {
+		partition_index = read_bits(block, 13, 10);
+		uint32_t cem_bits = read_bits(block, 23, 6);
+		config_end = 29;
+		if ((cem_bits & 0x3) == 0) {
+			for (uint32_t i = 0; i < partition_count; i++) {
+				cems[i] = cem_bits >> 2;
+			}
+		} else {
+			// NOTE: 残りのビットはウェイトの直前に格納されている
+			uint32_t extra_bits = (3 * partition_count) - 4;
+			below_weights -= extra_bits;
+			cem_bits |= read_bits(block, below_weights, extra_bits) << 6;
+			uint32_t base_class = (cem_bits & 0x3) - 1;
+			for (uint32_t i = 0; i < partition_count; i++) {
+				uint32_t c = (cem_bits >> (2 + i)) & 1;
+				uint32_t m = (cem_bits >> (2 + partition_count + (i * 2))) & 0x3;
+				cems[i] = ((base_class + c) << 2) | m;
+			}
+		}
+	}
+	int ccs = -1;
+	if (block_mode.dualPlane) {
+		below_weights -= 2;
+		ccs = static_cast<int>(read_bits(block, below_weights, 2));
+	}
+	uint32_t color_value_count = 0;
+	for (uint32_t i = 0; i < partition_count; i++) {
+		color_value_count += ((cems[i] >> 2) + 1) * 2;
+	}
+	if ((color_value_count > 18) || (below_weights < config_end)) {
+		fill_astc_error(dst, texel_count);
+		return;
+	}
+	// 収まる最も大きな量子化レベル
+	uint32_t color_bits = below_weights - config_end;
+	int color_quant = -1;
+	for (int q = AstcQuant256; q >= AstcQuant6; q--) {
+		if (get_ise_bit_count(color_value_count, q) <= color_bits) {
+			color_quant = q;
+			break;
+		}
+	}
+	if (color_quant < 0) {
+		fill_astc_error(dst, texel_count);
+		return;
+	}
+	uint8_t quantized[64];
+	decode_ise(tables, color_quant, color_value_count, block, config_end, quantized);
+	int color_values[18];
+	for (uint32_t i = 0; i < color_value_count; i++) {
+		color_values[i] = tables.colorUnquant[color_quant][quantized[i]];
+	}
+	// エンドポイント(16bitに拡張)
+	uint32_t endpoints[4][2][4];
+	const int* values = color_values;
+	for (uint32_t i = 0; i < partition_count; i++) {
+		int e0[4];
+		int e1[4];
+		if (!decode_endpoints(cems[i], values, e0, e1)) {
+			fill_astc_error(dst, texel_count);
+			return;
+		}
+		for (uint32_t c = 0; c < 4; c++) {
+			endpoints[i][0][c] = srgb ? ((e0[c] << 8) | 0x80) : ((e0[c] << 8) | e0[c]);
+			endpoints[i][1][c] = srgb ? ((e1[c] << 8) | 0x80) : ((e1[c] << 8) | e1[c]);
+		}
+		values += ((cems[i] >> 2) + 1) * 2;
+	}
+	// ウェイトはブロックの最上位ビットから逆順に格納されている
+	uint8_t reversed[16];
+	for (uint32_t i = 0; i < 16; i++) {
+		uint8_t v = block[15 - i];
+		v = static_cast<uint8_t>(((v * 0x0802u & 0x22110u) | (v * 0x8020u & 0x88440u)) * 0x10101u >> 16);
+		reversed[i] = v;
+	}
+	decode_ise(tables, block_mode.weightQuant, weight_count, reversed, 0, quantized);
+	// グリッドのウェイト(補間で範囲外を参照するため余白を持たせる)
+	uint8_t grid_weights[2][64 + 16] = {};
+	for (uint32_t i = 0; i < grid_count; i++) {
+		for (uint32_t p = 0; p < plane_count; p++) {
+			grid_weights[p][i] = tables.weightUnquant[block_mode.weightQuant][quantized[(i * plane_count) + p]];
+		}
+	}
+	// テクセル毎にウェイトを補間して色を求める
+	uint32_t ds = (1024 + (blockWidth / 2)) / (blockWidth - 1);
+	uint32_t dt = (1024 + (blockHeight / 2)) / (blockHeight - 1);
+	bool small_block = (texel_count < 31);
+	for (uint32_t y = 0; y < blockHeight; y++) {
+		uint32_t gt = (((dt * y) * (block_mode.gridHeight - 1)) + 32) >> 6;
+		uint32_t jt = gt >> 4;
+		uint32_t ft = gt & 0xF;
+		for (uint32_t x = 0; x < blockWidth; x++) {
+			uint32_t gs = (((ds * x) * (block_mode.gridWidth - 1)) + 32) >> 6;
+			uint32_t js = gs >> 4;
+			uint32_t fs = gs & 0xF;
+			uint32_t v0 = js + (jt * block_mode.gridWidth);
+			uint32_t w11 = ((fs * ft) + 8) >> 4;
+			uint32_t w10 = ft - w11;
+			uint32_t w01 = fs - w11;
+			uint32_t w00 = 16 - fs - ft + w11;
+			uint32_t weights[2];
+			for (uint32_t p = 0; p < plane_count; p++) {
+				const uint8_t* gw = grid_weights[p];
+				weights[p] = ((gw[v0] * w00) + (gw[v0 + 1] * w01)
+					+ (gw[v0 + block_mode.gridWidth] * w10) + (gw[v0 + block_mode.gridWidth + 1] * w11) + 8) >> 4;
+			}
+			uint32_t partition = (partition_count > 1)
+				? select_partition(partition_index, x, y, partition_count, small_block) : 0;
+			uint8_t* dp = dst + (((y * blockWidth) + x) * 4);
+			for (uint32_t c = 0; c < 4; c++) {
+				uint32_t w = (static_cast<int>(c) == ccs) ? weights[1] : weights[0];
+				uint32_t value = ((endpoints[partition][0][c] * (64 - w)) + (endpoints[partition][1][c] * w) + 32) >> 6;
+				dp[c] = astc_to_u8(value, srgb);
+			}
+		}
+	}
+	return;
+}
+
+//----------------------------------------------------------------------------
+
+// デコードする処理の情報
+struct TranscodeJob {
+	const FormatDesc* desc;
+	const uint8_t* data;
+	uint32_t width;
+	uint32_t height;
+	uint32_t blocksX;
+	uint8_t* dst;
+	size_t dstBytesPerRow;
+};
+
+// ブロックの行[begin, end)をデコード
+static void transcode_block_rows(void* userData, uint32_t begin, uint32_t end)
+{
+	const TranscodeJob& job = *static_cast<const TranscodeJob*>(userData);
+	const FormatDesc& desc = *job.desc;
+	uint32_t block_width = desc.info.blockWidth;
+	uint32_t block_height = desc.info.blockHeight;
+	size_t pixel_size = getTranscodedPixelSize(desc.info.transcodedFormat);
+	// デコードしたブロック(最大で12x12のRGBA8)
+	uint8_t texels[c_astc_max_block_texels * 4];
+	for (uint32_t by = begin; by < end; by++) {
+		const uint8_t* block = job.data + (static_cast<size_t>(by) * job.blocksX * desc.info.blockBytes);
+		for (uint32_t bx = 0; bx < job.blocksX; bx++, block += desc.info.blockBytes) {
+			switch (desc.kind) {
+			case BlockKindEtc2RGB:
+				decode_etc2_rgb_block(block, false, texels);
+				break;
+			case BlockKindEtc2PunchThrough:
+				decode_etc2_rgb_block(block, true, texels);
+				break;
+			case BlockKindEtc2RGBA:
+				{
+					// アルファのブロックの後にRGBのブロック
+					int alpha[16];
+					decode_eac_block(block, false, false, alpha);
+					decode_etc2_rgb_block(block + 8, false, texels);
+					for (uint32_t i = 0; i < 16; i++) {
+						texels[(i * 4) + 3] = static_cast<uint8_t>(alpha[i]);
+					}
+				}
+				break;
+			case BlockKindEacR11:
+			case BlockKindEacSignedR11:
+				decode_eac_r11_block(block, 1, (desc.kind == BlockKindEacSignedR11), texels);
+				break;
+			case BlockKindEacRG11:
+			case BlockKindEacSignedRG11:
+				decode_eac_r11_block(block, 2, (desc.kind == BlockKindEacSignedRG11), texels);
+				break;
+			case BlockKindAstc:
+				decode_astc_block(block, block_width, block_height, desc.srgb, texels);
+				break;
+			default:
+				AXGL_ASSERT(0);
+				break;
+			}
+			// イメージの範囲内をコピー
+			uint32_t x = bx * block_width;
+			uint32_t y = by * block_height;
+			uint32_t copy_width = std::min(block_width, job.width - x);
+			uint32_t copy_height = std::min(block_height, job.height - y);
+			for (uint32_t row = 0; row < copy_height; row++) {
+				memcpy(job.dst + (job.dstBytesPerRow * (y + row)) + (pixel_size * x),
+					texels + (pixel_size * block_width * row), pixel_size * copy_width);
+			}
+		}
+	}
+	return;
+}
+
+bool getCompressedFormatInfo(GLenum internalformat, CompressedFormatInfo* info)
+{
+	AXGL_ASSERT(info != nullptr);
+	FormatDesc desc;
+	if (!get_format_desc(internalformat, &desc)) {
+		return false;
+	}
+	*info = desc.info;
+	return true;
+}
+
+size_t getCompressedImageSize(const CompressedFormatInfo& info, uint32_t width, uint32_t height)
+{
+	size_t blocks_x = (width + info.blockWidth - 1) / info.blockWidth;
+	size_t blocks_y = (height + info.blockHeight - 1) / info.blockHeight;
+	return blocks_x * blocks_y * info.blockBytes;
+}
+
+size_t getTranscodedPixelSize(TranscodedFormat format)
+{
+	size_t pixel_size = 0;
+	switch (format) {
+	case TranscodedFormatRGBA8:
+	case TranscodedFormatSRGB8A8:
+	case TranscodedFormatRG16F:
+		pixel_size = 4;
+		break;
+	case TranscodedFormatR16F:
+		pixel_size = 2;
+		break;
+	default:
+		AXGL_ASSERT(0);
+		break;
+	}
+	return pixel_size;
+}
+
+bool transcodeCompressedImage(GLenum internalformat, const void* data, size_t dataSize, uint32_t width, uint32_t height,
+	void* dst, size_t dstBytesPerRow)
+{
+	FormatDesc desc;
+	if ((data == nullptr) || (dst == nullptr) || !get_format_desc(internalformat, &desc)) {
+		return false;
+	}
+	if ((width == 0) || (height == 0)) {
+		return true;
+	}
+	if (dataSize < getCompressedImageSize(desc.info, width, height)) {
+		AXGL_DBGOUT("transcodeCompressedImage> imageSize is too small:%zu\n", dataSize);
+		return false;
+	}
+	TranscodeJob job;
+	job.desc = &desc;
+	job.data = static_cast<const uint8_t*>(data);
+	job.width = width;
+	job.height = height;
+	job.blocksX = (width + desc.info.blockWidth - 1) / desc.info.blockWidth;
+	job.dst = static_cast<uint8_t*>(dst);
+	job.dstBytesPerRow = dstBytesPerRow;
+	uint32_t blocks_y = (height + desc.info.blockHeight - 1) / desc.info.blockHeight;
+	if ((job.blocksX * blocks_y) < c_parallel_block_count) {
+		transcode_block_rows(&job, 0, blocks_y);
+		return true;
+	}
+	// ブロックの行を分割して並列にデコード
+	WorkerPool& worker_pool = WorkerPool::getInstance();
+	uint32_t num_ranges = worker_pool.getConcurrency() * c_ranges_per_thread;
+	uint32_t rows_per_range = (blocks_y + num_ranges - 1) / num_ranges;
+	worker_pool.parallelFor(blocks_y, rows_per_range, transcode_block_rows, &job);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+// 圧縮データのハッシュ(8バイト単位で乗算と回転により混合)
+static inline uint64_t rotate_left64(uint64_t value, uint32_t shift)
+{
+	return (value << shift) | (value >> (64 - shift));
+}
+
+static uint64_t hash_memory(const void* data, size_t size)
+{
+	static constexpr uint64_t c_prime1 = 0x9E3779B185EBCA87ULL;
+	static constexpr uint64_t c_prime2 = 0xC2B2AE3D27D4EB4FULL;
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	// 4レーンを独立に混合して、乗算の遅延を隠す
+	uint64_t lanes[4] = { c_prime1 + c_prime2, c_prime2, 0, 0 - c_prime1 };
+	size_t offset = 0;
+	for (; (offset + 32) <= size; offset += 32) {
+		for (uint32_t i = 0; i < 4; i++) {
+			uint64_t word = 0;
+			memcpy(&word, p + offset + (i * 8), sizeof(word));
+			lanes[i] = rotate_left64(lanes[i] + (word * c_prime2), 31) * c_prime1;
+		}
+	}
+	uint64_t hash = rotate_left64(lanes[0], 1) + rotate_left64(lanes[1], 7) + rotate_left64(lanes[2], 12) + rotate_left64(lanes[3], 18);
+	hash += size;
+	for (; offset < size; offset++) {
+		hash = rotate_left64(hash ^ (p[offset] * c_prime1), 11) * c_prime2;
+	}
+	hash ^= hash >> 33;
+	hash *= c_prime2;
+	hash ^= hash >> 29;
+	return hash;
+}
+
+// TranscodeCacheクラスの実装 --------
+TranscodeCache::TranscodeCache()
+{
+}
+
+TranscodeCache::~TranscodeCache()
+{
+	// NOTE: 終了時はアロケータが破棄されている可能性があるため、デコード結果は解放しない
+}
+
+TranscodeCache& TranscodeCache::getInstance()
+{
+	static TranscodeCache s_instance;
+	return s_instance;
+}
+
+// NOTE: m_mutexのロック中に呼び出す
+const uint8_t* TranscodeCache::findOrTranscode(GLenum internalformat, const void* data, size_t dataSize, uint32_t width, uint32_t height)
+{
+	CompressedFormatInfo info;
+	if ((data == nullptr) || !getCompressedFormatInfo(internalformat, &info)) {
+		return nullptr;
+	}
+	uint64_t hash = hash_memory(data, dataSize);
+	for (Entry& entry : m_entries) {
+		if ((entry.hash == hash) && (entry.internalformat == internalformat) && (entry.dataSize == dataSize)
+			&& (entry.width == width) && (entry.height == height) && (memcmp(entry.source, data, dataSize) == 0)) {
+			entry.lastUsed = ++m_useCounter;
+			return entry.decoded;
+		}
+	}
+	size_t pixel_size = getTranscodedPixelSize(info.transcodedFormat);
+	size_t decoded_size = pixel_size * width * height;
+	uint8_t* decoded = static_cast<uint8_t*>(AXGL_ALLOC(decoded_size));
+	if (decoded == nullptr) {
+		return nullptr;
+	}
+	if (!transcodeCompressedImage(internalformat, data, dataSize, width, height, decoded, pixel_size * width)) {
+		AXGL_FREE(decoded);
+		return nullptr;
+	}
+	if (decoded_size > c_transcode_cache_entry_limit) {
+		// キャッシュしない
+		m_scratch = decoded;
+		return decoded;
+	}
+	uint8_t* source = static_cast<uint8_t*>(AXGL_ALLOC(dataSize));
+	if (source == nullptr) {
+		// キャッシュしない
+		m_scratch = decoded;
+		return decoded;
+	}
+	memcpy(source, data, dataSize);
+	evict(decoded_size + dataSize);
+	Entry entry = { hash, internalformat, dataSize, width, height, source, decoded, decoded_size, ++m_useCounter };
+	m_entries.push_back(entry);
+	m_cacheSize += decoded_size + dataSize;
+	return decoded;
+}
+
+void TranscodeCache::clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	releaseScratch();
+	for (Entry& entry : m_entries) {
+		AXGL_FREE(entry.source);
+		AXGL_FREE(entry.decoded);
+	}
+	m_entries.clear();
+	m_cacheSize = 0;
+	return;
+}
+
+size_t TranscodeCache::getCacheSize() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_cacheSize;
+}
+
+void TranscodeCache::releaseScratch()
+{
+	if (m_scratch != nullptr) {
+		AXGL_FREE(m_scratch);
+		m_scratch = nullptr;
+	}
+	return;
+}
+
+void TranscodeCache::evict(size_t requiredSize)
+{
+	// 上限に収まるまで、最も長く使用されていないエントリから破棄
+	while (!m_entries.empty() && ((m_cacheSize + requiredSize) > c_transcode_cache_limit)) {
+		size_t oldest = 0;
+		for (size_t i = 1; i < m_entries.size(); i++) {
+			if (m_entries[i].lastUsed < m_entries[oldest].lastUsed) {
+				oldest = i;
+			}
+		}
+		AXGL_FREE(m_entries[oldest].source);
+		AXGL_FREE(m_entries[oldest].decoded);
+		m_cacheSize -= m_entries[oldest].decodedSize + m_entries[oldest].dataSize;
+		m_entries.erase(m_entries.begin() + oldest);
+	}
+	return;
+}
+
+} // namespace axgl
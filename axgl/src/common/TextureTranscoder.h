@@ -0,0 +1,101 @@
+﻿// TextureTranscoder.h
+#ifndef __TextureTranscoder_h_
+#define __TextureTranscoder_h_
+
+#include "axglCommon.h"
+
+#include <mutex>
+
+namespace axgl {
+
+// 圧縮テクスチャをCPUでデコードした後のフォーマット
+enum TranscodedFormat {
+	TranscodedFormatInvalid = 0,
+	TranscodedFormatRGBA8 = 1,
+	TranscodedFormatSRGB8A8 = 2,
+	// EAC R11/RG11(unsigned、signedとも)
+	TranscodedFormatR16F = 3,
+	TranscodedFormatRG16F = 4
+};
+
+// 圧縮テクスチャのフォーマットの情報
+struct CompressedFormatInfo {
+	uint32_t blockWidth;
+	uint32_t blockHeight;
+	uint32_t blockBytes;
+	TranscodedFormat transcodedFormat;
+	// デコード後のフォーマットに対応するinternalformat
+	GLenum transcodedInternalformat;
+};
+
+// ETC2/EAC、ASTC(LDR)のフォーマットの情報を取得(対応していない場合はfalse)
+bool getCompressedFormatInfo(GLenum internalformat, CompressedFormatInfo* info);
+// 圧縮データのサイズ(バイト数)を取得
+size_t getCompressedImageSize(const CompressedFormatInfo& info, uint32_t width, uint32_t height);
+// デコード後の1ピクセルのバイト数を取得
+size_t getTranscodedPixelSize(TranscodedFormat format);
+
+// 圧縮データをデコードする(dstはwidth x heightのデコード後のフォーマット)
+// NOTE: 大きなイメージはブロックの行を分割して、WorkerPoolで並列にデコードする
+bool transcodeCompressedImage(GLenum internalformat, const void* data, size_t dataSize, uint32_t width, uint32_t height,
+	void* dst, size_t dstBytesPerRow);
+
+// デコード結果を圧縮データの内容でキャッシュするクラス
+// NOTE: 全てのコンテキストで共有するため、複数のスレッドから呼び出される
+class TranscodeCache
+{
+public:
+	static TranscodeCache& getInstance();
+	// デコード済みのデータ(width x height、隙間なし)をfunction(const uint8_t*)に渡す(キャッシュにない場合はデコードして登録)
+	// NOTE: functionはキャッシュのロック中に呼び出す(データはfunctionの中でのみ有効)。失敗した場合はfalse
+	template <typename Function>
+	bool transcode(GLenum internalformat, const void* data, size_t dataSize, uint32_t width, uint32_t height, Function function)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const uint8_t* decoded = findOrTranscode(internalformat, data, dataSize, width, height);
+		if (decoded == nullptr) {
+			return false;
+		}
+		function(decoded);
+		releaseScratch();
+		return true;
+	}
+	// キャッシュを破棄
+	void clear();
+	// キャッシュしているデータのサイズ(バイト数、比較用の圧縮データを含む)を取得
+	size_t getCacheSize() const;
+
+private:
+	// キャッシュのエントリ
+	struct Entry {
+		uint64_t hash;
+		GLenum internalformat;
+		size_t dataSize;
+		uint32_t width;
+		uint32_t height;
+		// NOTE: ハッシュの衝突で異なるデータのデコード結果を返さないように、圧縮データを比較する
+		uint8_t* source;
+		uint8_t* decoded;
+		size_t decodedSize;
+		uint64_t lastUsed;
+	};
+
+private:
+	TranscodeCache();
+	~TranscodeCache();
+	const uint8_t* findOrTranscode(GLenum internalformat, const void* data, size_t dataSize, uint32_t width, uint32_t height);
+	void releaseScratch();
+	void evict(size_t requiredSize);
+
+private:
+	mutable std::mutex m_mutex;
+	AXGLVector<Entry> m_entries;
+	size_t m_cacheSize = 0;
+	uint64_t m_useCounter = 0;
+	// NOTE: キャッシュに収まらないデコード結果をfunctionの呼び出しまで保持する
+	uint8_t* m_scratch = nullptr;
+};
+
+} // namespace axgl
+
+#endif // __TextureTranscoder_h_
@@ -0,0 +1,322 @@
+﻿// TextureUploadQueue.cpp
+#include "TextureUploadQueue.h"
+#include "MemoryAccounting.h"
+
+#include <algorithm>
+
+namespace axgl {
+
+// ワーカースレッドで転送する最小のサイズ(バイト数)
+// NOTE: 小さな転送はステージングへのコピーとスレッド間の受け渡しのコストが上回る
+static constexpr size_t c_texture_upload_async_threshold = 256 * 1024;
+// 再利用のために保持するステージングメモリの上限
+static constexpr size_t c_staging_pool_limit = 64 * 1024 * 1024;
+
+// 経過時間(ミリ秒)を取得
+static double get_elapsed_ms(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// TextureUploadTaskクラスの実装 --------
+TextureUploadTask::TextureUploadTask()
+{
+}
+
+TextureUploadTask::~TextureUploadTask()
+{
+	AXGL_ASSERT(m_staging == nullptr);
+}
+
+uint8_t* TextureUploadTask::getStagingMemory() const
+{
+	return m_staging;
+}
+
+size_t TextureUploadTask::getStagingSize() const
+{
+	return m_stagingSize;
+}
+
+// TextureUploadQueueクラスの実装 --------
+TextureUploadQueue::TextureUploadQueue()
+	: m_enabled(false), m_completedTicket(0)
+{
+}
+
+TextureUploadQueue::~TextureUploadQueue()
+{
+	// ワーカースレッドを終了
+	// NOTE: 終了時はアロケータが破棄されている可能性があるため、タスクとステージングメモリは解放しない
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopRequested = true;
+	}
+	m_queueCond.notify_all();
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+}
+
+TextureUploadQueue& TextureUploadQueue::getInstance()
+{
+	static TextureUploadQueue s_instance;
+	return s_instance;
+}
+
+void TextureUploadQueue::setEnabled(bool enable)
+{
+	std::lock_guard<std::mutex> enable_lock(m_enableMutex);
+	if (enable) {
+		if (!m_thread.joinable()) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopRequested = false;
+			m_thread = std::thread(&TextureUploadQueue::workerMain, this);
+		}
+		m_enabled = true;
+	} else {
+		// キューに残ったタスクを実行してからワーカースレッドを終了
+		// NOTE: enqueueはロック中にm_enabledを確認するため、終了要求後にタスクが登録されることはない
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_enabled = false;
+			m_stopRequested = true;
+		}
+		m_queueCond.notify_all();
+		if (m_thread.joinable()) {
+			m_thread.join();
+		}
+		collectFinishedTasks();
+		// 使用しなくなったステージングメモリを解放
+		releaseStagingPool();
+	}
+	return;
+}
+
+bool TextureUploadQueue::isEnabled() const
+{
+	return m_enabled;
+}
+
+bool TextureUploadQueue::shouldUploadAsync(size_t size) const
+{
+	return m_enabled && (size >= c_texture_upload_async_threshold);
+}
+
+uint64_t TextureUploadQueue::enqueue(TextureUploadTask* task, size_t uploadBytes)
+{
+	AXGL_ASSERT(task != nullptr);
+	uint64_t ticket = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		// NOTE: 無効化と競合した場合に、終了したワーカースレッドのキューに残さないようロック中に確認する
+		if (m_enabled.load(std::memory_order_relaxed)) {
+			ticket = m_nextTicket++;
+			task->m_ticket = ticket;
+			task->m_uploadBytes = uploadBytes;
+			task->m_enqueueTime = std::chrono::steady_clock::now();
+			task->m_next = nullptr;
+			// 末尾に追加
+			if (m_pendingTail != nullptr) {
+				m_pendingTail->m_next = task;
+			} else {
+				m_pendingHead = task;
+			}
+			m_pendingTail = task;
+			m_stats.queueDepth++;
+			m_stats.maxQueueDepth = std::max(m_stats.maxQueueDepth, m_stats.queueDepth);
+		}
+	}
+	if (ticket == 0) {
+		destroyTask(task);
+		return 0;
+	}
+	m_queueCond.notify_one();
+	return ticket;
+}
+
+bool TextureUploadQueue::isCompleted(uint64_t ticket) const
+{
+	return ticket <= m_completedTicket.load(std::memory_order_acquire);
+}
+
+void TextureUploadQueue::wait(uint64_t ticket)
+{
+	if (isCompleted(ticket)) {
+		return;
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_completedCond.wait(lock, [this, ticket]() { return isCompleted(ticket); });
+	m_stats.waitCount++;
+	m_stats.waitTimeMs += get_elapsed_ms(start, std::chrono::steady_clock::now());
+	return;
+}
+
+void TextureUploadQueue::getStats(Stats* stats) const
+{
+	AXGL_ASSERT(stats != nullptr);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	*stats = m_stats;
+	return;
+}
+
+bool TextureUploadQueue::attachStagingMemory(TextureUploadTask* task, size_t size)
+{
+	AXGL_ASSERT((task != nullptr) && (task->m_staging == nullptr));
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		// プールから収まる最小のブロックを探す(無駄が大きいブロックは使用しない)
+		size_t found = m_stagingPool.size();
+		for (size_t i = 0; i < m_stagingPool.size(); i++) {
+			const StagingBlock& block = m_stagingPool[i];
+			if ((block.size >= size) && (block.size <= (size * 2))
+				&& ((found == m_stagingPool.size()) || (block.size < m_stagingPool[found].size))) {
+				found = i;
+			}
+		}
+		if (found < m_stagingPool.size()) {
+			task->m_staging = m_stagingPool[found].memory;
+			task->m_stagingSize = m_stagingPool[found].size;
+			m_stagingPool.erase(m_stagingPool.begin() + found);
+			m_stats.stagingPoolSize -= task->m_stagingSize;
+			return true;
+		}
+	}
+	task->m_staging = static_cast<uint8_t*>(AXGL_ALLOC(size));
+	if (task->m_staging == nullptr) {
+		return false;
+	}
+	task->m_stagingSize = size;
+	MemoryAccounting::getInstance().update(MemoryCategoryStaging, 0, size);
+	return true;
+}
+
+void TextureUploadQueue::collectFinishedTasks()
+{
+	// 完了したタスクを取り出す
+	TextureUploadTask* finished = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		finished = m_finishedHead;
+		m_finishedHead = nullptr;
+	}
+	while (finished != nullptr) {
+		TextureUploadTask* next = finished->m_next;
+		destroyTask(finished);
+		finished = next;
+	}
+	return;
+}
+
+void TextureUploadQueue::destroyTask(TextureUploadTask* task)
+{
+	AXGL_ASSERT(task != nullptr);
+	// ステージングメモリはプールに戻す
+	if (task->m_staging != nullptr) {
+		StagingBlock block = { task->m_staging, task->m_stagingSize };
+		task->m_staging = nullptr;
+		task->m_stagingSize = 0;
+		// 上限を超えた場合は古いブロックから取り除き、ロックの外で解放する
+		AXGLVector<StagingBlock> released;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stagingPool.push_back(block);
+			m_stats.stagingPoolSize += block.size;
+			size_t release_count = 0;
+			while ((m_stats.stagingPoolSize > c_staging_pool_limit) && (release_count < m_stagingPool.size())) {
+				m_stats.stagingPoolSize -= m_stagingPool[release_count].size;
+				release_count++;
+			}
+			released.assign(m_stagingPool.begin(), m_stagingPool.begin() + release_count);
+			m_stagingPool.erase(m_stagingPool.begin(), m_stagingPool.begin() + release_count);
+		}
+		for (const StagingBlock& oldest : released) {
+			AXGL_FREE(oldest.memory);
+			MemoryAccounting::getInstance().update(MemoryCategoryStaging, oldest.size, 0);
+		}
+	}
+	AXGL_DELETE(task);
+	return;
+}
+
+void TextureUploadQueue::releaseStagingPool()
+{
+	AXGLVector<StagingBlock> released;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		released.swap(m_stagingPool);
+		m_stats.stagingPoolSize = 0;
+	}
+	for (const StagingBlock& block : released) {
+		AXGL_FREE(block.memory);
+		MemoryAccounting::getInstance().update(MemoryCategoryStaging, block.size, 0);
+	}
+	return;
+}
+
+void TextureUploadQueue::workerMain()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_queueCond.wait(lock, [this]() { return m_stopRequested || (m_pendingHead != nullptr); });
+		if (m_pendingHead == nullptr) {
+			// 終了要求があり、キューが空
+			break;
+		}
+		// NOTE: 実行中のタスクもキューの深さに含めるため、完了まで先頭に残す
+		TextureUploadTask* task = m_pendingHead;
+		lock.unlock();
+		task->execute();
+		std::chrono::steady_clock::time_point completed_time = std::chrono::steady_clock::now();
+		lock.lock();
+		// 先頭から取り除いて、完了したタスクに移す
+		m_pendingHead = task->m_next;
+		if (m_pendingHead == nullptr) {
+			m_pendingTail = nullptr;
+		}
+		task->m_next = m_finishedHead;
+		m_finishedHead = task;
+		// 統計を更新
+		double latency_ms = get_elapsed_ms(task->m_enqueueTime, completed_time);
+		m_stats.queueDepth--;
+		m_stats.uploadCount++;
+		m_stats.uploadBytes += task->m_uploadBytes;
+		m_stats.totalLatencyMs += latency_ms;
+		m_stats.maxLatencyMs = std::max(m_stats.maxLatencyMs, latency_ms);
+		// 登録順に実行するため、完了したチケットは単調に増加する
+		m_completedTicket.store(task->m_ticket, std::memory_order_release);
+		m_completedCond.notify_all();
+	}
+	return;
+}
+
+} // namespace axgl
+
+//-------------------------------------------------------------------
+// テクスチャ転送のワーカースレッドを有効化
+void AXGL_APIENTRY axglSetTextureUploadThreadEnabled(bool enable)
+{
+	axgl::TextureUploadQueue::getInstance().setEnabled(enable);
+	return;
+}
+
+// テクスチャ転送の統計を取得
+void AXGL_APIENTRY axglGetTextureUploadStats(AXGLTextureUploadStats* stats)
+{
+	if (stats == nullptr) {
+		return;
+	}
+	axgl::TextureUploadQueue::Stats queue_stats;
+	axgl::TextureUploadQueue::getInstance().getStats(&queue_stats);
+	stats->queueDepth = queue_stats.queueDepth;
+	stats->maxQueueDepth = queue_stats.maxQueueDepth;
+	stats->uploadCount = queue_stats.uploadCount;
+	stats->uploadBytes = queue_stats.uploadBytes;
+	stats->averageLatencyMs = (queue_stats.uploadCount > 0) ? (queue_stats.totalLatencyMs / queue_stats.uploadCount) : 0.0;
+	stats->maxLatencyMs = queue_stats.maxLatencyMs;
+	stats->waitCount = queue_stats.waitCount;
+	stats->waitTimeMs = queue_stats.waitTimeMs;
+	stats->stagingPoolSize = queue_stats.stagingPoolSize;
+	return;
+}
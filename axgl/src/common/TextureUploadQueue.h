@@ -0,0 +1,126 @@
+﻿// TextureUploadQueue.h
+#ifndef __TextureUploadQueue_h_
+#define __TextureUploadQueue_h_
+
+#include "axglCommon.h"
+#include "../AXGLAllocatorImpl.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace axgl {
+
+// ワーカースレッドで実行するテクスチャの転送(バックエンドが継承する)
+class TextureUploadTask
+{
+public:
+	TextureUploadTask();
+	virtual ~TextureUploadTask();
+	// ワーカースレッドから呼ばれる
+	// NOTE: アロケータはスレッドセーフとは限らないため、メモリの確保や解放をしないこと
+	virtual void execute() = 0;
+	// ステージングメモリを取得(転送するデータはenqueue前にコピーしておく)
+	uint8_t* getStagingMemory() const;
+	size_t getStagingSize() const;
+
+private:
+	friend class TextureUploadQueue;
+	TextureUploadTask* m_next = nullptr;
+	uint8_t* m_staging = nullptr;
+	size_t m_stagingSize = 0;
+	size_t m_uploadBytes = 0;
+	uint64_t m_ticket = 0;
+	std::chrono::steady_clock::time_point m_enqueueTime;
+};
+
+// テクスチャの転送をワーカースレッドで実行するキュー
+// NOTE: タスクは登録順に1つのワーカースレッドで実行し、完了したタスクとステージングメモリの解放は登録する側のスレッドで行う
+// 複数のコンテキストのスレッドから呼び出せる(キューとステージングメモリのプールはm_mutexで保護する)
+class TextureUploadQueue
+{
+public:
+	// 統計
+	struct Stats {
+		size_t queueDepth = 0; // 待機中、実行中のタスク数
+		size_t maxQueueDepth = 0;
+		uint64_t uploadCount = 0; // 完了したタスク数
+		uint64_t uploadBytes = 0;
+		double totalLatencyMs = 0.0; // 登録から完了までの時間の合計
+		double maxLatencyMs = 0.0;
+		uint64_t waitCount = 0; // 完了を待った回数
+		double waitTimeMs = 0.0;
+		size_t stagingPoolSize = 0;
+	};
+
+public:
+	static TextureUploadQueue& getInstance();
+	// ワーカースレッドを有効化(無効化時はキューの完了を待ち、ステージングメモリを解放する)
+	void setEnabled(bool enable);
+	bool isEnabled() const;
+	// ワーカースレッドで転送するサイズか
+	bool shouldUploadAsync(size_t size) const;
+	// ステージングメモリを用意したタスクを作成
+	template <typename T> T* createTask(size_t stagingSize);
+	// タスクを登録して完了待ちのチケットを返す(0の場合は登録失敗で、タスクは破棄される)
+	uint64_t enqueue(TextureUploadTask* task, size_t uploadBytes);
+	// チケットのタスクが完了したか
+	bool isCompleted(uint64_t ticket) const;
+	// チケットのタスクの完了を待つ
+	void wait(uint64_t ticket);
+	// 統計を取得
+	void getStats(Stats* stats) const;
+
+private:
+	// ステージングメモリのブロック
+	struct StagingBlock {
+		uint8_t* memory;
+		size_t size;
+	};
+
+private:
+	TextureUploadQueue();
+	~TextureUploadQueue();
+	bool attachStagingMemory(TextureUploadTask* task, size_t size);
+	void collectFinishedTasks();
+	void destroyTask(TextureUploadTask* task);
+	void releaseStagingPool();
+	void workerMain();
+
+private:
+	mutable std::mutex m_mutex;
+	// NOTE: ワーカースレッドの開始、終了をシリアライズする
+	std::mutex m_enableMutex;
+	std::condition_variable m_queueCond;
+	std::condition_variable m_completedCond;
+	std::thread m_thread;
+	std::atomic<bool> m_enabled;
+	bool m_stopRequested = false;
+	TextureUploadTask* m_pendingHead = nullptr;
+	TextureUploadTask* m_pendingTail = nullptr;
+	TextureUploadTask* m_finishedHead = nullptr;
+	uint64_t m_nextTicket = 1;
+	std::atomic<uint64_t> m_completedTicket;
+	AXGLVector<StagingBlock> m_stagingPool;
+	Stats m_stats;
+};
+
+template <typename T> T* TextureUploadQueue::createTask(size_t stagingSize)
+{
+	// 完了したタスクを回収して、ステージングメモリを再利用する
+	collectFinishedTasks();
+	T* task = AXGL_NEW(T);
+	if (task == nullptr) {
+		return nullptr;
+	}
+	if (!attachStagingMemory(task, stagingSize)) {
+		destroyTask(task);
+		return nullptr;
+	}
+	return task;
+}
+
+} // namespace axgl
+
+#endif // __TextureUploadQueue_h_
@@ -0,0 +1,209 @@
+﻿// VertexConversion.cpp
+#include "VertexConversion.h"
+
+#include <string.h>
+#include <algorithm>
+
+#if defined(AXGL_VERTEX_CONVERSION_NEON)
+#include <arm_neon.h>
+#elif defined(AXGL_VERTEX_CONVERSION_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace axgl {
+
+// 符号付きのビットフィールドを符号拡張して取り出す
+static inline int32_t extract_signed_bits(uint32_t value, uint32_t shift, uint32_t bits)
+{
+	uint32_t field = (value >> shift) & ((1u << bits) - 1);
+	uint32_t sign_bit = 1u << (bits - 1);
+	return static_cast<int32_t>(field ^ sign_bit) - static_cast<int32_t>(sign_bit);
+}
+
+// 符号付き正規化(GL ES 3.0の規則: max(c / (2^(b-1) - 1), -1))
+static inline float normalize_signed(int32_t value, uint32_t bits)
+{
+	float scale = static_cast<float>((1 << (bits - 1)) - 1);
+	return std::max(static_cast<float>(value) / scale, -1.0f);
+}
+
+// 頂点属性1頂点分のサイズ(バイト数)を取得
+uint32_t getVertexAttribSize(GLenum type, GLint size)
+{
+	uint32_t component_size = 0;
+	switch (type) {
+	case GL_BYTE:
+	case GL_UNSIGNED_BYTE:
+		component_size = sizeof(uint8_t);
+		break;
+	case GL_SHORT:
+	case GL_UNSIGNED_SHORT:
+	case GL_HALF_FLOAT:
+		component_size = sizeof(uint16_t);
+		break;
+	case GL_INT:
+	case GL_UNSIGNED_INT:
+	case GL_FLOAT:
+	case GL_FIXED:
+		component_size = sizeof(uint32_t);
+		break;
+	case GL_INT_2_10_10_10_REV:
+	case GL_UNSIGNED_INT_2_10_10_10_REV:
+		// 4要素を32bitにパック
+		return sizeof(uint32_t);
+	default:
+		AXGL_ASSERT(0);
+		break;
+	}
+	return component_size * static_cast<uint32_t>(size);
+}
+
+// 頂点属性のフォーマットがCPUでの変換を必要とするか
+bool needVertexFormatConversion(GLenum type, GLboolean normalized)
+{
+	bool need_conversion = false;
+	switch (type) {
+	case GL_FIXED:
+		need_conversion = true;
+		break;
+	case GL_INT_2_10_10_10_REV:
+	case GL_UNSIGNED_INT_2_10_10_10_REV:
+		// 正規化する場合はMetalの頂点フォーマットを直接使用できる
+		need_conversion = (normalized != GL_TRUE);
+		break;
+	default:
+		break;
+	}
+	return need_conversion;
+}
+
+// 変換後(float)の頂点属性1頂点分のサイズ(バイト数)を取得
+uint32_t getConvertedVertexAttribSize(GLenum type, GLint size)
+{
+	if ((type == GL_INT_2_10_10_10_REV) || (type == GL_UNSIGNED_INT_2_10_10_10_REV)) {
+		return sizeof(float) * 4;
+	}
+	return sizeof(float) * static_cast<uint32_t>(size);
+}
+
+// 固定小数点(16.16)の頂点属性をfloatに変換する
+void convertVertexFixedToFloat(void* dst, size_t dstStride, const void* src, size_t srcStride, size_t vertexCount, GLint size)
+{
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr) && (size >= 1) && (size <= 4));
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	if (size == 4) {
+		// 4要素の場合は1頂点をまとめて変換
+		for (size_t v = 0; v < vertexCount; v++) {
+#if defined(AXGL_VERTEX_CONVERSION_NEON)
+			int32x4_t fixed = vreinterpretq_s32_u8(vld1q_u8(sp));
+			vst1q_f32(reinterpret_cast<float*>(dp), vcvtq_n_f32_s32(fixed, 16));
+#elif defined(AXGL_VERTEX_CONVERSION_SSE2)
+			__m128i fixed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sp));
+			__m128 value = _mm_mul_ps(_mm_cvtepi32_ps(fixed), _mm_set1_ps(1.0f / 65536.0f));
+			_mm_storeu_ps(reinterpret_cast<float*>(dp), value);
+#else
+			int32_t fixed[4];
+			float value[4];
+			memcpy(fixed, sp, sizeof(fixed));
+			for (int c = 0; c < 4; c++) {
+				value[c] = static_cast<float>(fixed[c]) * (1.0f / 65536.0f);
+			}
+			memcpy(dp, value, sizeof(value));
+#endif
+			dp += dstStride;
+			sp += srcStride;
+		}
+		return;
+	}
+	for (size_t v = 0; v < vertexCount; v++) {
+		int32_t fixed[4];
+		float value[4];
+		memcpy(fixed, sp, sizeof(int32_t) * size);
+		for (GLint c = 0; c < size; c++) {
+			value[c] = static_cast<float>(fixed[c]) * (1.0f / 65536.0f);
+		}
+		memcpy(dp, value, sizeof(float) * size);
+		dp += dstStride;
+		sp += srcStride;
+	}
+	return;
+}
+
+// 符号付き2_10_10_10の頂点属性をfloat4に変換する
+void convertVertexInt2101010ToFloat(void* dst, size_t dstStride, const void* src, size_t srcStride, size_t vertexCount, bool normalized)
+{
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	for (size_t v = 0; v < vertexCount; v++) {
+		uint32_t packed;
+		memcpy(&packed, sp, sizeof(packed));
+		int32_t x = extract_signed_bits(packed, 0, 10);
+		int32_t y = extract_signed_bits(packed, 10, 10);
+		int32_t z = extract_signed_bits(packed, 20, 10);
+		int32_t w = extract_signed_bits(packed, 30, 2);
+		float value[4];
+		if (normalized) {
+			value[0] = normalize_signed(x, 10);
+			value[1] = normalize_signed(y, 10);
+			value[2] = normalize_signed(z, 10);
+			value[3] = normalize_signed(w, 2);
+		} else {
+			value[0] = static_cast<float>(x);
+			value[1] = static_cast<float>(y);
+			value[2] = static_cast<float>(z);
+			value[3] = static_cast<float>(w);
+		}
+		memcpy(dp, value, sizeof(value));
+		dp += dstStride;
+		sp += srcStride;
+	}
+	return;
+}
+
+// 符号なし2_10_10_10の頂点属性をfloat4に変換する
+void convertVertexUInt2101010ToFloat(void* dst, size_t dstStride, const void* src, size_t srcStride, size_t vertexCount, bool normalized)
+{
+	AXGL_ASSERT((dst != nullptr) && (src != nullptr));
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	const float scale_xyz = normalized ? (1.0f / 1023.0f) : 1.0f;
+	const float scale_w = normalized ? (1.0f / 3.0f) : 1.0f;
+	for (size_t v = 0; v < vertexCount; v++) {
+		uint32_t packed;
+		memcpy(&packed, sp, sizeof(packed));
+		float value[4];
+		value[0] = static_cast<float>(packed & 0x3ff) * scale_xyz;
+		value[1] = static_cast<float>((packed >> 10) & 0x3ff) * scale_xyz;
+		value[2] = static_cast<float>((packed >> 20) & 0x3ff) * scale_xyz;
+		value[3] = static_cast<float>(packed >> 30) * scale_w;
+		memcpy(dp, value, sizeof(value));
+		dp += dstStride;
+		sp += srcStride;
+	}
+	return;
+}
+
+// 頂点属性をtypeに応じてfloatに変換する
+void convertVertexAttrib(void* dst, size_t dstStride, const void* src, size_t srcStride, size_t vertexCount,
+	GLenum type, GLint size, GLboolean normalized)
+{
+	switch (type) {
+	case GL_FIXED:
+		convertVertexFixedToFloat(dst, dstStride, src, srcStride, vertexCount, size);
+		break;
+	case GL_INT_2_10_10_10_REV:
+		convertVertexInt2101010ToFloat(dst, dstStride, src, srcStride, vertexCount, (normalized == GL_TRUE));
+		break;
+	case GL_UNSIGNED_INT_2_10_10_10_REV:
+		convertVertexUInt2101010ToFloat(dst, dstStride, src, srcStride, vertexCount, (normalized == GL_TRUE));
+		break;
+	default:
+		AXGL_ASSERT(0);
+		break;
+	}
+	return;
+}
+
+} // namespace axgl
@@ -0,0 +1,36 @@
+﻿// VertexConversion.h
+#ifndef __VertexConversion_h_
+#define __VertexConversion_h_
+
+#include "axglCommon.h"
+
+// SIMD実装の選択(コンパイル時)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AXGL_VERTEX_CONVERSION_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#define AXGL_VERTEX_CONVERSION_SSE2 1
+#endif
+
+namespace axgl {
+
+// 頂点属性1頂点分のサイズ(バイト数)を取得
+uint32_t getVertexAttribSize(GLenum type, GLint size);
+// 頂点属性のフォーマットがCPUでの変換を必要とするか
+// NOTE: GL_FIXEDと、正規化しない2_10_10_10はMetalの頂点フォーマットで表現できない
+bool needVertexFormatConversion(GLenum type, GLboolean normalized);
+// 変換後(float)の頂点属性1頂点分のサイズ(バイト数)を取得
+uint32_t getConvertedVertexAttribSize(GLenum type, GLint size);
+
+// 固定小数点(16.16)の頂点属性をfloatに変換する
+// NOTE: ストライドはバイト数、srcのアライメントは問わない
+void convertVertexFixedToFloat(void* dst, size_t dstStride, const void* src, size_t srcStride, size_t vertexCount, GLint size);
+// 2_10_10_10の頂点属性をfloat4に変換する
+void convertVertexInt2101010ToFloat(void* dst, size_t dstStride, const void* src, size_t srcStride, size_t vertexCount, bool normalized);
+void convertVertexUInt2101010ToFloat(void* dst, size_t dstStride, const void* src, size_t srcStride, size_t vertexCount, bool normalized);
+// 頂点属性をtypeに応じてfloatに変換する
+void convertVertexAttrib(void* dst, size_t dstStride, const void* src, size_t srcStride, size_t vertexCount,
+	GLenum type, GLint size, GLboolean normalized);
+
+} // namespace axgl
+
+#endif // __VertexConversion_h_
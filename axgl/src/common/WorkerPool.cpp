@@ -0,0 +1,136 @@
+﻿// WorkerPool.cpp
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+namespace axgl {
+
+// WorkerPoolクラスの実装 --------
+WorkerPool::WorkerPool()
+	: m_nextIndex(0)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+	// ワーカースレッドを終了
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopRequested = true;
+	}
+	m_jobCond.notify_all();
+	for (uint32_t i = 0; i < m_threadCount; i++) {
+		if (m_threads[i].joinable()) {
+			m_threads[i].join();
+		}
+	}
+}
+
+WorkerPool& WorkerPool::getInstance()
+{
+	static WorkerPool s_instance;
+	return s_instance;
+}
+
+uint32_t WorkerPool::getConcurrency() const
+{
+	// NOTE: ワーカースレッドの起動前でも起動後と同じ値を返す
+	uint32_t hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+	return std::min(hardware_threads - 1, c_max_worker_threads) + 1;
+}
+
+void WorkerPool::parallelFor(uint32_t count, uint32_t grainSize, RangeFunction function, void* userData)
+{
+	AXGL_ASSERT(function != nullptr);
+	if (count == 0) {
+		return;
+	}
+	grainSize = std::max(1u, grainSize);
+	uint32_t num_ranges = (count + grainSize - 1) / grainSize;
+	if ((num_ranges <= 1) || (getConcurrency() <= 1)) {
+		// 分割しない場合は呼び出したスレッドで処理
+		function(userData, 0, count);
+		return;
+	}
+	std::lock_guard<std::mutex> call_lock(m_callMutex);
+	startThreads();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_function = function;
+		m_userData = userData;
+		m_count = count;
+		m_grainSize = grainSize;
+		m_nextIndex.store(0, std::memory_order_relaxed);
+		// 呼び出したスレッドも処理するため、ワーカースレッドは残りの範囲数まで
+		m_maxParticipants = std::min(m_threadCount, num_ranges - 1);
+		m_participants = 0;
+		m_jobOpen = true;
+		m_jobGeneration++;
+	}
+	m_jobCond.notify_all();
+	processRanges();
+	// 新たな参加を締め切って、参加中のワーカースレッドの完了を待つ
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_jobOpen = false;
+	m_doneCond.wait(lock, [this]() { return m_activeWorkers == 0; });
+	m_function = nullptr;
+	m_userData = nullptr;
+	return;
+}
+
+void WorkerPool::startThreads()
+{
+	if (m_threadsStarted) {
+		return;
+	}
+	m_threadsStarted = true;
+	m_threadCount = getConcurrency() - 1;
+	for (uint32_t i = 0; i < m_threadCount; i++) {
+		m_threads[i] = std::thread(&WorkerPool::workerMain, this);
+	}
+	return;
+}
+
+void WorkerPool::processRanges()
+{
+	while (true) {
+		uint32_t begin = m_nextIndex.fetch_add(m_grainSize, std::memory_order_relaxed);
+		if (begin >= m_count) {
+			break;
+		}
+		uint32_t end = std::min(begin + m_grainSize, m_count);
+		m_function(m_userData, begin, end);
+	}
+	return;
+}
+
+void WorkerPool::workerMain()
+{
+	uint64_t seen_generation = 0;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_jobCond.wait(lock, [this, seen_generation]() {
+			return m_stopRequested || (m_jobOpen && (m_jobGeneration != seen_generation));
+		});
+		if (m_stopRequested) {
+			break;
+		}
+		seen_generation = m_jobGeneration;
+		if (m_participants >= m_maxParticipants) {
+			// 十分な数のワーカースレッドが参加済み
+			continue;
+		}
+		m_participants++;
+		m_activeWorkers++;
+		lock.unlock();
+		processRanges();
+		lock.lock();
+		m_activeWorkers--;
+		if (m_activeWorkers == 0) {
+			m_doneCond.notify_all();
+		}
+	}
+	return;
+}
+
+} // namespace axgl
@@ -0,0 +1,64 @@
+﻿// WorkerPool.h
+#ifndef __WorkerPool_h_
+#define __WorkerPool_h_
+
+#include "axglCommon.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace axgl {
+
+// CPUで並列に処理するためのワーカースレッドのプール
+// NOTE: ワーカースレッドは最初の並列処理で起動し、終了まで保持する
+class WorkerPool
+{
+public:
+	// 範囲[begin, end)を処理する関数
+	typedef void (*RangeFunction)(void* userData, uint32_t begin, uint32_t end);
+	// ワーカースレッドの最大数
+	static constexpr uint32_t c_max_worker_threads = 7;
+
+public:
+	static WorkerPool& getInstance();
+	// 並列に処理するスレッド数(呼び出したスレッドを含む)を取得
+	uint32_t getConcurrency() const;
+	// [0, count)をgrainSize毎に分割して並列に処理し、全ての完了を待つ
+	// NOTE: 呼び出したスレッドも処理する。functionの中からparallelFor()を呼び出さないこと
+	void parallelFor(uint32_t count, uint32_t grainSize, RangeFunction function, void* userData);
+
+private:
+	WorkerPool();
+	~WorkerPool();
+	void startThreads();
+	void processRanges();
+	void workerMain();
+
+private:
+	// NOTE: parallelFor()の呼び出しを直列化する
+	std::mutex m_callMutex;
+	std::mutex m_mutex;
+	std::condition_variable m_jobCond;
+	std::condition_variable m_doneCond;
+	std::thread m_threads[c_max_worker_threads];
+	uint32_t m_threadCount = 0;
+	bool m_threadsStarted = false;
+	bool m_stopRequested = false;
+	// 実行中の処理
+	uint64_t m_jobGeneration = 0;
+	bool m_jobOpen = false;
+	RangeFunction m_function = nullptr;
+	void* m_userData = nullptr;
+	uint32_t m_count = 0;
+	uint32_t m_grainSize = 1;
+	std::atomic<uint32_t> m_nextIndex;
+	// 処理に参加できるワーカースレッド数と、参加中のワーカースレッド数
+	uint32_t m_maxParticipants = 0;
+	uint32_t m_participants = 0;
+	uint32_t m_activeWorkers = 0;
+};
+
+} // namespace axgl
+
+#endif // __WorkerPool_h_
@@ -14,6 +14,7 @@
 
 #include "axglDebug.h"
 #include "../AXGLAllocatorImpl.h"
+#include <axglExt.h>
 
 #define AXGL_UNUSED(a) ((void)(a))
 
@@ -4,6 +4,7 @@
 #include "CoreBuffer.h"
 #include "CoreContext.h"
 #include "../backend/BackendBuffer.h"
+#include "../common/MemoryAccounting.h"
 
 namespace axgl {
 
@@ -37,12 +38,57 @@ void CoreBuffer::setData(CoreContext* context, GLsizeiptr size, const void* data
 	if ((m_pBackendBuffer == nullptr) || (context == nullptr)) {
 		return;
 	}
+	if (m_immutable) {
+		// イミュータブルなストレージは再確保できない
+		setErrorCode(GL_INVALID_OPERATION);
+		return;
+	}
 	BackendContext* backend_context = context->getBackendContext();
 	AXGL_ASSERT(backend_context != nullptr);
 	if (!m_pBackendBuffer->setData(backend_context, size, data, usage)) {
 		// internal error
 		AXGL_DBGOUT("BackendBuffer::setData() failed\n");
+		// NOTE: 要求されたサイズは確保に成功した場合のみ設定する
+		// バックエンドは古いストレージを解放済みのため、空のバッファとして扱う
+		setErrorCode(GL_OUT_OF_MEMORY);
+		m_size = 0;
+		updateMemorySize();
+		return;
+	}
+	m_size = size;
+	m_usage = usage;
+	updateMemorySize();
+	return;
+}
+
+// イミュータブルなストレージを確保
+void CoreBuffer::setStorage(CoreContext* context, GLsizeiptr size, const void* data, GLbitfield flags)
+{
+	if ((m_pBackendBuffer == nullptr) || (context == nullptr)) {
+		return;
+	}
+	if (m_immutable) {
+		// 既にイミュータブル
+		setErrorCode(GL_INVALID_OPERATION);
+		return;
+	}
+	BackendContext* backend_context = context->getBackendContext();
+	AXGL_ASSERT(backend_context != nullptr);
+	if (!m_pBackendBuffer->setStorage(backend_context, size, data, flags)) {
+		// internal error
+		AXGL_DBGOUT("BackendBuffer::setStorage() failed\n");
+		// NOTE: setData()と同様に、バックエンドは古いストレージを解放済みのため、空のバッファとして扱う
+		setErrorCode(GL_OUT_OF_MEMORY);
+		m_size = 0;
+		updateMemorySize();
+		return;
 	}
+	m_immutable = true;
+	m_storageFlags = flags;
+	m_size = size;
+	updateMemorySize();
+	// NOTE: GL_BUFFER_USAGEはDYNAMIC_STORAGEの有無で決める(拡張仕様)
+	m_usage = ((flags & GL_DYNAMIC_STORAGE_BIT_EXT) != 0) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
 	return;
 }
 
@@ -52,6 +98,16 @@ void CoreBuffer::setSubData(CoreContext* context, GLintptr offset, GLsizeiptr si
 	if ((m_pBackendBuffer == nullptr) || (context == nullptr)) {
 		return;
 	}
+	if ((m_storageFlags & GL_DYNAMIC_STORAGE_BIT_EXT) == 0) {
+		// DYNAMIC_STORAGEを指定していないイミュータブルなストレージ
+		setErrorCode(GL_INVALID_OPERATION);
+		return;
+	}
+	if (m_mapped && ((m_accessFlags & GL_MAP_PERSISTENT_BIT_EXT) == 0)) {
+		// PERSISTENT以外でマップ中
+		setErrorCode(GL_INVALID_OPERATION);
+		return;
+	}
 	BackendContext* backend_context = context->getBackendContext();
 	AXGL_ASSERT(backend_context != nullptr);
 	if (!m_pBackendBuffer->setSubData(backend_context, offset, size, data)) {
@@ -67,6 +123,12 @@ void* CoreBuffer::mapBufferRange(CoreContext* context, GLintptr offset, GLsizeip
 	if ((m_pBackendBuffer == nullptr) || (context == nullptr)) {
 		return nullptr;
 	}
+	const GLbitfield storage_access = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT_EXT | GL_MAP_COHERENT_BIT_EXT;
+	if ((access & storage_access & ~m_storageFlags) != 0) {
+		// ストレージフラグで許可されていないアクセス
+		setErrorCode(GL_INVALID_OPERATION);
+		return nullptr;
+	}
 	BackendContext* backend_context = context->getBackendContext();
 	AXGL_ASSERT(backend_context != nullptr);
 	if (!m_pBackendBuffer->mapRange(backend_context, offset, size, access, &m_pMapPointer)) {
@@ -75,6 +137,9 @@ void* CoreBuffer::mapBufferRange(CoreContext* context, GLintptr offset, GLsizeip
 		m_pMapPointer = nullptr;
 	} else {
 		m_accessFlags = access;
+		m_mapped = true;
+		m_mapOffset = offset;
+		m_mapLength = size;
 	}
 	return m_pMapPointer;
 }
@@ -93,6 +158,9 @@ GLboolean CoreBuffer::unmapBuffer(CoreContext* context)
 		result = GL_FALSE;
 	}
 	m_pMapPointer = nullptr;
+	m_mapped = false;
+	m_mapOffset = 0;
+	m_mapLength = 0;
 	return result;
 }
 
@@ -161,6 +229,12 @@ void CoreBuffer::getBufferParameteriv(CoreContext* context, GLenum pname, GLint*
 	case GL_BUFFER_USAGE:
 		*params = m_usage;
 		break;
+	case GL_BUFFER_IMMUTABLE_STORAGE_EXT:
+		*params = m_immutable ? GL_TRUE : GL_FALSE;
+		break;
+	case GL_BUFFER_STORAGE_FLAGS_EXT:
+		*params = static_cast<GLint>(m_storageFlags);
+		break;
 	default:
 		setErrorCode(GL_INVALID_ENUM);
 		break;
@@ -220,6 +294,18 @@ void CoreBuffer::terminate(CoreContext* context)
 		BackendBuffer::destroy(m_pBackendBuffer);
 		m_pBackendBuffer = nullptr;
 	}
+	m_size = 0;
+	updateMemorySize();
+	return;
+}
+
+// GPUメモリの使用量を更新
+// NOTE: バックエンドはストレージの確保を遅延、変換する場合があるため、データストアのサイズで集計する
+void CoreBuffer::updateMemorySize()
+{
+	size_t memory_size = static_cast<size_t>(m_size);
+	MemoryAccounting::getInstance().update(MemoryCategoryBuffer, m_memorySize, memory_size);
+	m_memorySize = memory_size;
 	return;
 }
 
@@ -19,6 +19,7 @@ public:
 	void setTarget(GLenum target);
 	GLenum getTarget() const;
 	void setData(CoreContext* context, GLsizeiptr size, const void* data, GLenum usage);
+	void setStorage(CoreContext* context, GLsizeiptr size, const void* data, GLbitfield flags);
 	void setSubData(CoreContext* context, GLintptr offset, GLsizeiptr size, const void* data);
 	void* mapBufferRange(CoreContext* context, GLintptr offset, GLsizeiptr size, GLbitfield access);
 	GLboolean unmapBuffer(CoreContext* context);
@@ -33,11 +34,24 @@ public:
 	{
 		return m_pBackendBuffer;
 	}
+	GLsizeiptr getSize() const
+	{
+		return m_size;
+	}
+	bool isMapped() const
+	{
+		return m_mapped;
+	}
 
 private:
 	enum {
 		TARGET_UNKNOWN = 0
 	};
+	// NOTE: glBufferDataで確保したバッファのストレージフラグ(GL_EXT_buffer_storage)
+	static const GLbitfield MUTABLE_STORAGE_FLAGS = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT_EXT;
+
+private:
+	void updateMemorySize();
 
 private:
 	GLenum m_target = TARGET_UNKNOWN;
@@ -48,7 +62,11 @@ private:
 	GLintptr m_mapOffset = 0;
 	GLsizeiptr m_mapLength = 0;
 	GLbitfield m_accessFlags = 0;
+	bool m_immutable = false;
+	GLbitfield m_storageFlags = MUTABLE_STORAGE_FLAGS;
 	BackendBuffer* m_pBackendBuffer = nullptr;
+	// GPUメモリの使用量(MemoryAccountingに通知済みのサイズ)
+	size_t m_memorySize = 0;
 };
 
 } // namespace axgl
@@ -15,9 +15,12 @@
 #include "CoreVertexArray.h"
 #include "CoreUtility.h"
 
+#include "../common/KtxLoader.h"
 #include "../backend/BackendContext.h"
 #include "../backend/BackendRenderbuffer.h"
 
+#include <algorithm>
+
 // GLの型変換に使用するマクロ
 #define GLINT_TO_GLBOOLEAN(a) (((a) == 0) ? GL_FALSE : GL_TRUE)
 #define GLFLOAT_TO_GLBOOLEAN(a) (((a) == 0.0f) ? GL_FALSE : GL_TRUE)
@@ -27,12 +30,69 @@
 namespace axgl {
 
 // glGetStringで返す文字列
-static const char* c_extension_string = "";
+static const char* c_extension_string = "GL_EXT_buffer_storage";
 static const char* c_vendor_string = "Vendor string";
 static const char* c_renderer_string = "Renderer string";
 static const char* c_version_string = "3.0";
 static const char* c_shader_language_version = "3.0.0";
 
+// ピクセルのアンパックパラメータをバックエンドのパラメータに変換
+static void get_unpack_parameters(const CoreState::UnpackParams& params, CoreBuffer* unpackBuffer, bool is3d, BackendTexture::UnpackParameters* unpack)
+{
+	AXGL_ASSERT(unpack != nullptr);
+	unpack->rowLength = params.unpackRowLength;
+	unpack->skipPixels = params.unpackSkipPixels;
+	unpack->skipRows = params.unpackSkipRows;
+	unpack->alignment = params.unpackAlignment;
+	// NOTE: GL_UNPACK_IMAGE_HEIGHTとGL_UNPACK_SKIP_IMAGESは3Dテクスチャのみ適用
+	unpack->imageHeight = is3d ? params.unpackImageHeight : 0;
+	unpack->skipImages = is3d ? params.unpackSkipImages : 0;
+	// NOTE: ピクセルアンパックバッファがバインドされている場合、ピクセルデータはバッファから読み出す
+	unpack->buffer = (unpackBuffer != nullptr) ? unpackBuffer->getBackendBuffer() : nullptr;
+	return;
+}
+
+// ピクセルのパックパラメータをバックエンドのパラメータに変換
+static void get_pack_parameters(const CoreState::PackParams& params, CoreBuffer* packBuffer, BackendContext::PackParameters* pack)
+{
+	AXGL_ASSERT(pack != nullptr);
+	pack->rowLength = params.packRowLength;
+	pack->skipPixels = params.packSkipPixels;
+	pack->skipRows = params.packSkipRows;
+	pack->alignment = params.packAlignment;
+	// NOTE: ピクセルパックバッファがバインドされている場合、ピクセルデータはバッファに書き込む
+	pack->buffer = (packBuffer != nullptr) ? packBuffer->getBackendBuffer() : nullptr;
+	return;
+}
+
+// ピクセルパックバッファへの書き込みがバッファの範囲内で、オフセットがtypeのデータ境界にあるか
+static bool is_valid_pack_buffer_range(const CoreState::PackParams& params, CoreBuffer* packBuffer,
+	GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+	AXGL_ASSERT(packBuffer != nullptr);
+	return isValidPackBufferRange(static_cast<size_t>(packBuffer->getSize()), reinterpret_cast<size_t>(pixels),
+		width, height, format, type, params.packRowLength, params.packSkipRows, params.packSkipPixels, params.packAlignment);
+}
+
+// バッファのターゲットとして有効か
+static bool is_valid_buffer_target(GLenum target)
+{
+	switch (target) {
+	case GL_ARRAY_BUFFER:
+	case GL_COPY_READ_BUFFER:
+	case GL_COPY_WRITE_BUFFER:
+	case GL_ELEMENT_ARRAY_BUFFER:
+	case GL_PIXEL_PACK_BUFFER:
+	case GL_PIXEL_UNPACK_BUFFER:
+	case GL_TRANSFORM_FEEDBACK_BUFFER:
+	case GL_UNIFORM_BUFFER:
+		return true;
+	default:
+		break;
+	}
+	return false;
+}
+
 // コンストラクタ
 CoreContext::CoreContext()
 {
@@ -355,7 +415,18 @@ void CoreContext::copyTexImage2D(GLenum target, GLint level, GLenum internalform
 	if (core_texture == nullptr) {
 		return;
 	}
-	core_texture->copyTexImage2d(level, internalformat, x, y, width, height, border);
+	// GL_READ_BUFFER
+	GLenum read_buffer = m_state.getReadBuffer();
+	if (read_buffer == GL_NONE) {
+		return;
+	}
+	BackendFramebuffer* backend_framebuffer = nullptr;
+	CoreFramebuffer* read_framebuffer = m_state.getFramebuffer(GL_READ_FRAMEBUFFER);
+	if (read_framebuffer != 0) {
+		backend_framebuffer = read_framebuffer->getBackendFramebuffer();
+	}
+	core_texture->copyTexImage2d(this, target, level, internalformat, x, y, width, height, border,
+		backend_framebuffer, read_buffer);
 	return;
 }
 
@@ -366,7 +437,18 @@ void CoreContext::copyTexSubImage2D(GLenum target, GLint level, GLint xoffset, G
 	if (core_texture == nullptr) {
 		return;
 	}
-	core_texture->copyTexSubImage2d(level, xoffset, yoffset, x, y, width, height);
+	// GL_READ_BUFFER
+	GLenum read_buffer = m_state.getReadBuffer();
+	if (read_buffer == GL_NONE) {
+		return;
+	}
+	BackendFramebuffer* backend_framebuffer = nullptr;
+	CoreFramebuffer* read_framebuffer = m_state.getFramebuffer(GL_READ_FRAMEBUFFER);
+	if (read_framebuffer != 0) {
+		backend_framebuffer = read_framebuffer->getBackendFramebuffer();
+	}
+	core_texture->copyTexSubImage2d(this, target, level, xoffset, yoffset, x, y, width, height,
+		backend_framebuffer, read_buffer);
 	return;
 }
 
@@ -523,8 +605,8 @@ void CoreContext::drawElements(GLenum mode, GLsizei count, GLenum type, const vo
 	if (m_pBackendContext == nullptr) {
 		return;
 	}
-	if (!m_state.elementArrayBufferAvailable()) {
-		// Element Array Buffer がバインドされていない（クライアントメモリを使用する）描画はサポートしない
+	if (!m_state.elementArrayBufferAvailable() && (indices == nullptr)) {
+		// Element Array Buffer がバインドされていない場合、indicesはクライアントメモリのインデックス
 		return;
 	}
 	// サンプラとテクスチャを準備
@@ -643,6 +725,10 @@ void CoreContext::generateMipmap(GLenum target)
 		setErrorCode(GL_INVALID_OPERATION);
 		return;
 	}
+	if (!isMipmapGeneratableFormat(core_texture->getInternalformat())) {
+		setErrorCode(GL_INVALID_OPERATION);
+		return;
+	}
 	core_texture->generateMipmap(this);
 	return;
 }
@@ -982,14 +1068,16 @@ void CoreContext::getBooleanv(GLenum pname, GLboolean* data)
 		break;
 		case GL_IMPLEMENTATION_COLOR_READ_FORMAT:
 		{
-			const BackendContext::PlatformParams& params = m_pBackendContext->getPlatformParams();
-			*data = GLINT_TO_GLBOOLEAN(params.implementationColorReadFormat);
+			GLenum read_format, read_type;
+			getImplementationColorReadFormat(&read_format, &read_type);
+			*data = GLINT_TO_GLBOOLEAN(read_format);
 		}
 		break;
 		case GL_IMPLEMENTATION_COLOR_READ_TYPE:
 		{
-			const BackendContext::PlatformParams& params = m_pBackendContext->getPlatformParams();
-			*data = GLINT_TO_GLBOOLEAN(params.implementationColorReadType);
+			GLenum read_format, read_type;
+			getImplementationColorReadFormat(&read_format, &read_type);
+			*data = GLINT_TO_GLBOOLEAN(read_type);
 		}
 		break;
 		case GL_LINE_WIDTH:
@@ -2007,14 +2095,16 @@ void CoreContext::getFloatv(GLenum pname, GLfloat* data)
 		break;
 		case GL_IMPLEMENTATION_COLOR_READ_FORMAT:
 		{
-			const BackendContext::PlatformParams& params = m_pBackendContext->getPlatformParams();
-			*data = static_cast<GLfloat>(params.implementationColorReadFormat);
+			GLenum read_format, read_type;
+			getImplementationColorReadFormat(&read_format, &read_type);
+			*data = static_cast<GLfloat>(read_format);
 		}
 		break;
 		case GL_IMPLEMENTATION_COLOR_READ_TYPE:
 		{
-			const BackendContext::PlatformParams& params = m_pBackendContext->getPlatformParams();
-			*data = static_cast<GLfloat>(params.implementationColorReadType);
+			GLenum read_format, read_type;
+			getImplementationColorReadFormat(&read_format, &read_type);
+			*data = static_cast<GLfloat>(read_type);
 		}
 		break;
 		case GL_LINE_WIDTH:
@@ -3019,14 +3109,16 @@ void CoreContext::getIntegerv(GLenum pname, GLint* data)
 		break;
 		case GL_IMPLEMENTATION_COLOR_READ_FORMAT:
 		{
-			const BackendContext::PlatformParams& params = m_pBackendContext->getPlatformParams();
-			*data = params.implementationColorReadFormat;
+			GLenum read_format, read_type;
+			getImplementationColorReadFormat(&read_format, &read_type);
+			*data = read_format;
 		}
 		break;
 		case GL_IMPLEMENTATION_COLOR_READ_TYPE:
 		{
-			const BackendContext::PlatformParams& params = m_pBackendContext->getPlatformParams();
-			*data = params.implementationColorReadType;
+			GLenum read_format, read_type;
+			getImplementationColorReadFormat(&read_format, &read_type);
+			*data = read_type;
 		}
 		break;
 		case GL_LINE_WIDTH:
@@ -4123,12 +4215,30 @@ void CoreContext::polygonOffset(GLfloat factor, GLfloat units)
 
 void CoreContext::readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels)
 {
-	if ((m_pBackendContext == nullptr) || (pixels == nullptr)) {
+	if (m_pBackendContext == nullptr) {
+		return;
+	}
+	CoreBuffer* pack_buffer = m_state.getBuffer(GL_PIXEL_PACK_BUFFER);
+	if (pack_buffer != nullptr) {
+		if (pack_buffer->isMapped()) {
+			// GL_INVALID_OPERATION is generated if a non-zero buffer object name is bound to the GL_PIXEL_PACK_BUFFER target and the buffer object is mapped.
+			setErrorCode(GL_INVALID_OPERATION);
+			return;
+		}
+		if (!is_valid_pack_buffer_range(m_state.getPackParams(), pack_buffer, width, height, format, type, pixels)) {
+			// GL_INVALID_OPERATION is generated if a non-zero buffer object name is bound to the GL_PIXEL_PACK_BUFFER target and the data would be packed to the buffer object such that the memory writes required would exceed the data store size.
+			// GL_INVALID_OPERATION is generated if a non-zero buffer object name is bound to the GL_PIXEL_PACK_BUFFER target and data is not evenly divisible into the number of bytes needed to store in memory a datum indicated by type.
+			setErrorCode(GL_INVALID_OPERATION);
+			return;
+		}
+	} else if (pixels == nullptr) {
+		// NOTE: ピクセルパックバッファがバインドされている場合、pixelsはオフセットのため0も有効
 		return;
 	}
 	// GL_READ_BUFFER
+	// NOTE: GL_DEPTH_COMPONENTは深度アタッチメントから読み出すため、GL_READ_BUFFERを参照しない
 	GLenum read_buffer = m_state.getReadBuffer();
-	if (read_buffer == GL_NONE) {
+	if ((read_buffer == GL_NONE) && (format != GL_DEPTH_COMPONENT)) {
 		return;
 	}
 	BackendFramebuffer* backend_framebuffer = nullptr;
@@ -4136,8 +4246,14 @@ void CoreContext::readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GL
 	if (read_framebuffer != 0) {
 		backend_framebuffer = read_framebuffer->getBackendFramebuffer();
 	}
-	m_pBackendContext->readPixels(x, y, width, height, format, type,
-		backend_framebuffer, read_buffer, pixels);
+	BackendContext::PackParameters pack;
+	get_pack_parameters(m_state.getPackParams(), pack_buffer, &pack);
+	bool result = m_pBackendContext->readPixels(x, y, width, height, format, type,
+		backend_framebuffer, read_buffer, pixels, &pack);
+	if (!result && (pack_buffer != nullptr)) {
+		// NOTE: バッファへの書き込みをバックエンドが実行できない場合(コピー先のピクセル境界にないオフセットなど)は、何も書き込まれないことをエラーで通知する
+		setErrorCode(GL_INVALID_OPERATION);
+	}
 	return;
 }
 
@@ -4238,7 +4354,15 @@ void CoreContext::texImage2D(GLenum target, GLint level, GLint internalformat, G
 	if (core_texture == nullptr) {
 		return;
 	}
-	core_texture->texImage2d(this, target, level, internalformat, width, height, border, format, type, pixels);
+	CoreBuffer* unpack_buffer = m_state.getBuffer(GL_PIXEL_UNPACK_BUFFER);
+	if ((unpack_buffer != nullptr) && unpack_buffer->isMapped()) {
+		// GL_INVALID_OPERATION is generated if a non-zero buffer object name is bound to the GL_PIXEL_UNPACK_BUFFER target and the buffer object's data store is currently mapped.
+		setErrorCode(GL_INVALID_OPERATION);
+		return;
+	}
+	BackendTexture::UnpackParameters unpack;
+	get_unpack_parameters(m_state.getUnpackParams(), unpack_buffer, false, &unpack);
+	core_texture->texImage2d(this, target, level, internalformat, width, height, border, format, type, pixels, &unpack);
 	return;
 }
 
@@ -4288,7 +4412,15 @@ void CoreContext::texSubImage2D(GLenum target, GLint level, GLint xoffset, GLint
 	if (core_texture == nullptr) {
 		return;
 	}
-	core_texture->texSubImage2d(this, target, level, xoffset, yoffset, width, height, format, type, pixels);
+	CoreBuffer* unpack_buffer = m_state.getBuffer(GL_PIXEL_UNPACK_BUFFER);
+	if ((unpack_buffer != nullptr) && unpack_buffer->isMapped()) {
+		// GL_INVALID_OPERATION is generated if a non-zero buffer object name is bound to the GL_PIXEL_UNPACK_BUFFER target and the buffer object's data store is currently mapped.
+		setErrorCode(GL_INVALID_OPERATION);
+		return;
+	}
+	BackendTexture::UnpackParameters unpack;
+	get_unpack_parameters(m_state.getUnpackParams(), unpack_buffer, false, &unpack);
+	core_texture->texSubImage2d(this, target, level, xoffset, yoffset, width, height, format, type, pixels, &unpack);
 	return;
 }
 
@@ -4557,6 +4689,11 @@ void CoreContext::vertexAttribPointer(GLuint index, GLint size, GLenum type, GLb
 {
 	CoreBuffer* core_buffer = m_state.getBuffer(GL_ARRAY_BUFFER);
 	CoreVertexArray* core_vertex_array = m_state.getVertexArray();
+	if ((core_vertex_array != nullptr) && (core_buffer == nullptr) && (pointer != nullptr)) {
+		// クライアントメモリの頂点配列はデフォルトのVAOでのみ使用できる
+		setErrorCode(GL_INVALID_OPERATION);
+		return;
+	}
 	if (core_vertex_array != nullptr) {
 		core_vertex_array->setVertexAttribPointer(this, index, size, type, normalized, stride, pointer, core_buffer);
 	} else {
@@ -4580,14 +4717,17 @@ void CoreContext::readBuffer(GLenum src)
 
 void CoreContext::drawRangeElements(GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void* indices)
 {
-	// 引数start,endは無視: ドライバ最適化(頂点バッファの使用範囲)のヒント
-	AXGL_UNUSED(start);
-	AXGL_UNUSED(end);
+	// 引数start,endはドライバ最適化(頂点バッファの使用範囲)のヒントとしてバックエンドに渡す
 	if (m_pBackendContext == nullptr) {
 		return;
 	}
-	if (!m_state.elementArrayBufferAvailable()) {
-		// Element Array Buffer がバインドされていない（クライアントメモリを使用する）描画はサポートしない
+	if (end < start) {
+		// GL_INVALID_VALUE is generated if end < start
+		setErrorCode(GL_INVALID_VALUE);
+		return;
+	}
+	if (!m_state.elementArrayBufferAvailable() && (indices == nullptr)) {
+		// Element Array Buffer がバインドされていない場合、indicesはクライアントメモリのインデックス
 		return;
 	}
 	// サンプラとテクスチャを準備
@@ -4595,7 +4735,7 @@ void CoreContext::drawRangeElements(GLenum mode, GLuint start, GLuint end, GLsiz
 	// インスタンス描画を無効に設定
 	m_state.setInstancedRendering(false);
 	// 描画
-	m_pBackendContext->drawElements(mode, count, type, indices, &m_state.getDrawParameters(), &m_state.getClearParams());
+	m_pBackendContext->drawRangeElements(mode, start, end, count, type, indices, &m_state.getDrawParameters(), &m_state.getClearParams());
 	// GLステートのダーティをクリア
 	m_state.clearDrawParameterDirtyFlags();
 	return;
@@ -4607,7 +4747,15 @@ void CoreContext::texImage3D(GLenum target, GLint level, GLint internalformat, G
 	if (core_texture == nullptr) {
 		return;
 	}
-	core_texture->texImage3d(this, target, level, internalformat, width, height, depth, border, format, type, pixels);
+	CoreBuffer* unpack_buffer = m_state.getBuffer(GL_PIXEL_UNPACK_BUFFER);
+	if ((unpack_buffer != nullptr) && unpack_buffer->isMapped()) {
+		// GL_INVALID_OPERATION is generated if a non-zero buffer object name is bound to the GL_PIXEL_UNPACK_BUFFER target and the buffer object's data store is currently mapped.
+		setErrorCode(GL_INVALID_OPERATION);
+		return;
+	}
+	BackendTexture::UnpackParameters unpack;
+	get_unpack_parameters(m_state.getUnpackParams(), unpack_buffer, true, &unpack);
+	core_texture->texImage3d(this, target, level, internalformat, width, height, depth, border, format, type, pixels, &unpack);
 	return;
 }
 
@@ -4617,7 +4765,15 @@ void CoreContext::texSubImage3D(GLenum target, GLint level, GLint xoffset, GLint
 	if (core_texture == nullptr) {
 		return;
 	}
-	core_texture->texSubImage3d(this, target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+	CoreBuffer* unpack_buffer = m_state.getBuffer(GL_PIXEL_UNPACK_BUFFER);
+	if ((unpack_buffer != nullptr) && unpack_buffer->isMapped()) {
+		// GL_INVALID_OPERATION is generated if a non-zero buffer object name is bound to the GL_PIXEL_UNPACK_BUFFER target and the buffer object's data store is currently mapped.
+		setErrorCode(GL_INVALID_OPERATION);
+		return;
+	}
+	BackendTexture::UnpackParameters unpack;
+	get_unpack_parameters(m_state.getUnpackParams(), unpack_buffer, true, &unpack);
+	core_texture->texSubImage3d(this, target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels, &unpack);
 	return;
 }
 
@@ -5107,6 +5263,11 @@ void CoreContext::vertexAttribIPointer(GLuint index, GLint size, GLenum type, GL
 {
 	CoreBuffer* core_buffer = m_state.getBuffer(GL_ARRAY_BUFFER);
 	CoreVertexArray* core_vertex_array = m_state.getVertexArray();
+	if ((core_vertex_array != nullptr) && (core_buffer == nullptr) && (pointer != nullptr)) {
+		// client-side arrays are available only for the default vertex array object
+		setErrorCode(GL_INVALID_OPERATION);
+		return;
+	}
 	if (core_vertex_array != nullptr) {
 		// set to vertex array object
 		core_vertex_array->setVertexAttribIPointer(this, index, size, type, stride, pointer, core_buffer);
@@ -5477,8 +5638,8 @@ void CoreContext::drawElementsInstanced(GLenum mode, GLsizei count, GLenum type,
 	if (m_pBackendContext == nullptr) {
 		return;
 	}
-	if (!m_state.elementArrayBufferAvailable()) {
-		// Element Array Buffer がバインドされていない（クライアントメモリを使用する）描画はサポートしない
+	if (!m_state.elementArrayBufferAvailable() && (indices == nullptr)) {
+		// Element Array Buffer がバインドされていない場合、indicesはクライアントメモリのインデックス
 		return;
 	}
 	// テクスチャとサンプラを準備
@@ -5817,14 +5978,16 @@ void CoreContext::getInteger64v(GLenum pname, GLint64* data)
 		break;
 		case GL_IMPLEMENTATION_COLOR_READ_FORMAT:
 		{
-			const BackendContext::PlatformParams& params = m_pBackendContext->getPlatformParams();
-			*data = params.implementationColorReadFormat;
+			GLenum read_format, read_type;
+			getImplementationColorReadFormat(&read_format, &read_type);
+			*data = read_format;
 		}
 		break;
 		case GL_IMPLEMENTATION_COLOR_READ_TYPE:
 		{
-			const BackendContext::PlatformParams& params = m_pBackendContext->getPlatformParams();
-			*data = params.implementationColorReadType;
+			GLenum read_format, read_type;
+			getImplementationColorReadFormat(&read_format, &read_type);
+			*data = read_type;
 		}
 		break;
 		case GL_LINE_WIDTH:
@@ -6910,23 +7073,33 @@ void CoreContext::programParameteri(GLuint program, GLenum pname, GLint value)
 
 void CoreContext::invalidateFramebuffer(GLenum target, GLsizei numAttachments, const GLenum* attachments)
 {
+	if (numAttachments < 0) {
+		// GL_INVALID_VALUE is generated if numAttachments is negative.
+		setErrorCode(GL_INVALID_VALUE);
+		return;
+	}
 	CoreFramebuffer* core_framebuffer = m_state.getFramebuffer(target);
 	if (core_framebuffer == nullptr) {
 		// default framebuffer なので無視
 		return;
 	}
-	core_framebuffer->invalidateFramebuffer(numAttachments, attachments);
+	core_framebuffer->invalidateFramebuffer(this, numAttachments, attachments);
 	return;
 }
 
 void CoreContext::invalidateSubFramebuffer(GLenum target, GLsizei numAttachments, const GLenum* attachments, GLint x, GLint y, GLsizei width, GLsizei height)
 {
+	if ((numAttachments < 0) || (width < 0) || (height < 0)) {
+		// GL_INVALID_VALUE is generated if numAttachments, width, or height is negative.
+		setErrorCode(GL_INVALID_VALUE);
+		return;
+	}
 	CoreFramebuffer* core_framebuffer = m_state.getFramebuffer(target);
 	if (core_framebuffer == nullptr) {
 		// default framebuffer なので無視
 		return;
 	}
-	core_framebuffer->invalidateSubFramebuffer(numAttachments, attachments, x, y, width, height);
+	core_framebuffer->invalidateSubFramebuffer(this, numAttachments, attachments, x, y, width, height);
 	return;
 }
 
@@ -7020,6 +7193,143 @@ void CoreContext::invalidateCache(GLbitfield flags)
 	return;
 }
 
+void CoreContext::getTexturePoolStats(AXGLTexturePoolStats* stats) const
+{
+	AXGL_ASSERT(stats != nullptr);
+	BackendContext::TexturePoolStats pool_stats = {};
+	if (m_pBackendContext != nullptr) {
+		m_pBackendContext->getTexturePoolStats(&pool_stats);
+	}
+	stats->hitCount = pool_stats.hitCount;
+	stats->missCount = pool_stats.missCount;
+	stats->pooledCount = pool_stats.pooledCount;
+	stats->pooledBytes = pool_stats.pooledBytes;
+	return;
+}
+
+void CoreContext::getRenderPassStats(AXGLRenderPassStats* stats) const
+{
+	AXGL_ASSERT(stats != nullptr);
+	BackendContext::RenderPassStats pass_stats = {};
+	if (m_pBackendContext != nullptr) {
+		m_pBackendContext->getRenderPassStats(&pass_stats);
+	}
+	stats->passCount = pass_stats.passCount;
+	stats->loadSkippedCount = pass_stats.loadSkippedCount;
+	stats->storeSkippedCount = pass_stats.storeSkippedCount;
+	return;
+}
+
+void CoreContext::getBufferUploadStats(AXGLBufferUploadStats* stats) const
+{
+	AXGL_ASSERT(stats != nullptr);
+	BackendContext::BufferUploadStats upload_stats = {};
+	if (m_pBackendContext != nullptr) {
+		m_pBackendContext->getBufferUploadStats(&upload_stats);
+	}
+	stats->updateCount = upload_stats.updateCount;
+	stats->copyCount = upload_stats.copyCount;
+	stats->uploadBytes = upload_stats.uploadBytes;
+	stats->coalescedCount = upload_stats.coalescedCount;
+	stats->coalescedBytes = upload_stats.coalescedBytes;
+	return;
+}
+
+void CoreContext::bufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+{
+	const GLbitfield valid_flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT_EXT
+		| GL_MAP_COHERENT_BIT_EXT | GL_DYNAMIC_STORAGE_BIT_EXT | GL_CLIENT_STORAGE_BIT_EXT;
+	if (!is_valid_buffer_target(target)) {
+		// GL_INVALID_ENUM
+		setErrorCode(GL_INVALID_ENUM);
+		return;
+	}
+	CoreBuffer* core_buffer = m_state.getBuffer(target);
+	if (core_buffer == nullptr) {
+		// GL_INVALID_OPERATION: バッファ0がバインドされている
+		setErrorCode(GL_INVALID_OPERATION);
+		return;
+	}
+	if ((size <= 0) || ((flags & ~valid_flags) != 0)) {
+		// GL_INVALID_VALUE
+		setErrorCode(GL_INVALID_VALUE);
+		return;
+	}
+	if (((flags & GL_MAP_PERSISTENT_BIT_EXT) != 0) && ((flags & (GL_MAP_READ_BIT | GL_MAP_WRITE_BIT)) == 0)) {
+		// GL_INVALID_VALUE: PERSISTENTにはREADかWRITEが必要
+		setErrorCode(GL_INVALID_VALUE);
+		return;
+	}
+	if (((flags & GL_MAP_COHERENT_BIT_EXT) != 0) && ((flags & GL_MAP_PERSISTENT_BIT_EXT) == 0)) {
+		// GL_INVALID_VALUE: COHERENTにはPERSISTENTが必要
+		setErrorCode(GL_INVALID_VALUE);
+		return;
+	}
+	core_buffer->setStorage(this, size, data, flags);
+	return;
+}
+
+// KTX、KTX2ファイルのイメージをバインドされているテクスチャに設定する
+// NOTE: 各イメージはファイルのデータから直接転送し、アンパックパラメータとピクセルアンパックバッファは使用しない
+bool CoreContext::texImageKTX(const void* data, size_t size, GLenum* target)
+{
+	KtxTexture ktx;
+	if (!parseKtxTexture(data, size, &ktx)) {
+		setErrorCode(GL_INVALID_VALUE);
+		return false;
+	}
+	if (target != nullptr) {
+		*target = ktx.target;
+	}
+	// NOTE: バックエンドは2D配列テクスチャと、3Dテクスチャの圧縮イメージのストレージを作成できない
+	if ((ktx.target == GL_TEXTURE_2D_ARRAY) || (ktx.compressed && (ktx.target != GL_TEXTURE_2D) && (ktx.target != GL_TEXTURE_CUBE_MAP))) {
+		AXGL_DBGOUT("CoreContext::texImageKTX> %s0x%04X texture is not supported\n", ktx.compressed ? "compressed " : "", ktx.target);
+		setErrorCode(GL_INVALID_OPERATION);
+		return false;
+	}
+	CoreTexture* core_texture = m_state.getTexture(ktx.target);
+	if (core_texture == nullptr) {
+		// default texture
+		setErrorCode(GL_INVALID_OPERATION);
+		return false;
+	}
+	BackendTexture::UnpackParameters unpack;
+	unpack.alignment = ktx.alignment;
+	for (uint32_t level = 0; level < ktx.levels; level++) {
+		GLsizei width = static_cast<GLsizei>(std::max(ktx.width >> level, 1u));
+		GLsizei height = static_cast<GLsizei>(std::max(ktx.height >> level, 1u));
+		GLsizei depth = static_cast<GLsizei>((ktx.target == GL_TEXTURE_3D) ? std::max(ktx.depth >> level, 1u) : ktx.depth);
+		for (uint32_t face = 0; face < ktx.faces; face++) {
+			const KtxImage& image = ktx.images[level][face];
+			GLenum image_target = (ktx.target == GL_TEXTURE_CUBE_MAP) ? (GL_TEXTURE_CUBE_MAP_POSITIVE_X + face) : ktx.target;
+			bool result = false;
+			if (ktx.compressed) {
+				result = core_texture->compressedTexImage2d(this, image_target, level, ktx.internalformat,
+					width, height, 0, static_cast<GLsizei>(image.size), image.data);
+			} else if (ktx.target == GL_TEXTURE_3D) {
+				result = core_texture->texImage3d(this, image_target, level, ktx.internalformat,
+					width, height, depth, 0, ktx.format, ktx.type, image.data, &unpack);
+			} else {
+				result = core_texture->texImage2d(this, image_target, level, ktx.internalformat,
+					width, height, 0, ktx.format, ktx.type, image.data, &unpack);
+			}
+			if (!result) {
+				// NOTE: バックエンドで作成できないフォーマット、サイズ
+				AXGL_DBGOUT("CoreContext::texImageKTX> level %u face %u upload failed\n", level, face);
+				setErrorCode(GL_INVALID_OPERATION);
+				return false;
+			}
+		}
+	}
+	// NOTE: 圧縮、整数、深度フォーマットはミップマップを生成できない(glGenerateMipmapと同じ)
+	if (ktx.generateMipmap && !ktx.compressed && isMipmapGeneratableFormat(ktx.internalformat)) {
+		if (!core_texture->generateMipmap(this)) {
+			return false;
+		}
+	}
+	return true;
+}
+
 GLenum CoreContext::getDrawFramebufferFormat(int colorIndex)
 {
 	// TODO: GL_DRAW_FRAMEBUFFER がバインドされている場合、framebuffer の color attachment から
@@ -7042,6 +7352,22 @@ GLenum CoreContext::getDrawStencilbufferFormat()
 	return GL_STENCIL_INDEX8;
 }
 
+// リードバッファの内容をそのまま読み出せるformat,typeを取得する
+// NOTE: フレームバッファオブジェクトがバインドされていない場合は、プラットフォームの既定値
+void CoreContext::getImplementationColorReadFormat(GLenum* format, GLenum* type)
+{
+	AXGL_ASSERT((format != nullptr) && (type != nullptr));
+	const BackendContext::PlatformParams& params = m_pBackendContext->getPlatformParams();
+	*format = params.implementationColorReadFormat;
+	*type = params.implementationColorReadType;
+	CoreFramebuffer* read_framebuffer = m_state.getFramebuffer(GL_READ_FRAMEBUFFER);
+	if (read_framebuffer != nullptr) {
+		m_pBackendContext->getImplementationColorReadFormat(read_framebuffer->getBackendFramebuffer(),
+			m_state.getReadBuffer(), format, type);
+	}
+	return;
+}
+
 const BackendRenderbufferFormat* CoreContext::getRenderbufferFormat(GLuint count, const BackendRenderbufferFormat* formats, GLenum format)
 {
 	const BackendRenderbufferFormat* rptr = nullptr;
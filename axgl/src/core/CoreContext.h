@@ -298,11 +298,18 @@ public:
 	// other interface methods
 	CoreRenderbuffer* getCurrentRenderbuffer();
 	void invalidateCache(GLbitfield flags);
+	void getTexturePoolStats(AXGLTexturePoolStats* stats) const;
+	void getRenderPassStats(AXGLRenderPassStats* stats) const;
+	void getBufferUploadStats(AXGLBufferUploadStats* stats) const;
+	// extension methods
+	void bufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+	bool texImageKTX(const void* data, size_t size, GLenum* target);
 
 private:
 	GLenum getDrawFramebufferFormat(int colorIndex);
 	GLenum getDrawDepthbufferFormat();
 	GLenum getDrawStencilbufferFormat();
+	void getImplementationColorReadFormat(GLenum* format, GLenum* type);
 	static const BackendRenderbufferFormat* getRenderbufferFormat(GLuint count, const BackendRenderbufferFormat* formats, GLenum format);
 
 private:
@@ -242,25 +242,24 @@ void CoreFramebuffer::setTextureLayer(CoreContext* context, GLenum attachment, C
 }
 
 // FramebufferをInvalidate
-void CoreFramebuffer::invalidateFramebuffer(GLsizei numAttachments, const GLenum *attachments)
+void CoreFramebuffer::invalidateFramebuffer(CoreContext* context, GLsizei numAttachments, const GLenum *attachments)
 {
-	// TODO: attachment の RBO or Texture に invalidate
-	AXGL_UNUSED(numAttachments);
-	AXGL_UNUSED(attachments);
+	// NOTE: 全体の無効化は、原点から最大サイズの領域の無効化と同じ
+	invalidateSubFramebuffer(context, numAttachments, attachments, 0, 0, INT32_MAX, INT32_MAX);
 	return;
 }
 
 // Framebufferの領域をInvalidate
-void CoreFramebuffer::invalidateSubFramebuffer(GLsizei numAttachments, const GLenum *attachments, GLint x, GLint y, GLsizei width, GLsizei height)
+// NOTE: アタッチメントの内容の保持が不要になったことをバックエンドに通知する(ロード、ストアの省略に使用)
+void CoreFramebuffer::invalidateSubFramebuffer(CoreContext* context, GLsizei numAttachments, const GLenum *attachments, GLint x, GLint y, GLsizei width, GLsizei height)
 {
-	// TODO: attachment の RBO or Texture に invalidate
-	// NOTE: サポートできるかあやしい
-	AXGL_UNUSED(numAttachments);
-	AXGL_UNUSED(attachments);
-	AXGL_UNUSED(x);
-	AXGL_UNUSED(y);
-	AXGL_UNUSED(width);
-	AXGL_UNUSED(height);
+	AXGL_ASSERT(context != nullptr);
+	if ((m_pBackendFramebuffer == nullptr) || (numAttachments == 0) || (attachments == nullptr)) {
+		return;
+	}
+	BackendContext* backend_context = context->getBackendContext();
+	AXGL_ASSERT(backend_context != nullptr);
+	m_pBackendFramebuffer->invalidate(backend_context, numAttachments, attachments, x, y, width, height);
 	return;
 }
 
@@ -25,8 +25,8 @@ public:
 	void setRenderbuffer(CoreContext* context, GLenum attachment, CoreRenderbuffer* renderbuffer);
 	void setTexture2d(CoreContext* context, GLenum attachment, CoreTexture* texture, GLenum textarget, GLint level);
 	void setTextureLayer(CoreContext* context, GLenum attachment, CoreTexture* texture, GLint level, GLint layer);
-	void invalidateFramebuffer(GLsizei numAttachments, const GLenum* attachments);
-	void invalidateSubFramebuffer(GLsizei numAttachments, const GLenum* attachments, GLint x, GLint y, GLsizei width, GLsizei height);
+	void invalidateFramebuffer(CoreContext* context, GLsizei numAttachments, const GLenum* attachments);
+	void invalidateSubFramebuffer(CoreContext* context, GLsizei numAttachments, const GLenum* attachments, GLint x, GLint y, GLsizei width, GLsizei height);
 	void getAttachmentParameteriv(GLenum attachment, GLenum pname, GLint* params);
 	void setupTargetAttachment(TargetAttachment* targetAttachment);
 	bool initialize(CoreContext* context);
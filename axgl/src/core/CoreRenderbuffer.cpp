@@ -4,6 +4,7 @@
 #include "CoreContext.h"
 #include "CoreUtility.h"
 #include "../backend/BackendRenderbuffer.h"
+#include "../common/MemoryAccounting.h"
 
 namespace axgl {
 
@@ -30,6 +31,7 @@ void CoreRenderbuffer::createStorage(CoreContext* context, GLenum internalformat
 			AXGL_DBGOUT("BackendRenderbuffer::createStorage() failed\n");
 		}
 	}
+	updateMemorySize();
 	return;
 }
 
@@ -47,6 +49,7 @@ void CoreRenderbuffer::createStorageMultisample(CoreContext* context, GLsizei sa
 			AXGL_DBGOUT("BackendRenderbuffer::createStorageMultisample() failed\n");
 		}
 	}
+	updateMemorySize();
 	return;
 }
 
@@ -56,6 +59,7 @@ void CoreRenderbuffer::updateStorageInformationFromBackend()
 		return;
 	}
 	m_pBackendRenderbuffer->getStorageInformation(&m_internalformat, &m_width, &m_height, &m_samples);
+	updateMemorySize();
 	return;
 }
 
@@ -125,6 +129,16 @@ void CoreRenderbuffer::terminate(CoreContext* context)
 		BackendRenderbuffer::destroy(m_pBackendRenderbuffer);
 		m_pBackendRenderbuffer = nullptr;
 	}
+	updateMemorySize();
+	return;
+}
+
+// GPUメモリの使用量を更新
+void CoreRenderbuffer::updateMemorySize()
+{
+	size_t memory_size = (m_pBackendRenderbuffer != nullptr) ? m_pBackendRenderbuffer->getMemorySize() : 0;
+	MemoryAccounting::getInstance().update(MemoryCategoryRenderbuffer, m_memorySize, memory_size);
+	m_memorySize = memory_size;
 	return;
 }
 
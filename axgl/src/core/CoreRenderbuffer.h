@@ -43,12 +43,17 @@ public:
 		return m_pBackendRenderbuffer;
 	}
 
+private:
+	void updateMemorySize();
+
 private:
 	GLenum m_internalformat = GL_RGBA8; // ### dummy initial value
 	GLsizei m_width = 0;
 	GLsizei m_height = 0;
 	GLsizei m_samples = 0;
 	BackendRenderbuffer* m_pBackendRenderbuffer = nullptr;
+	// GPUメモリの使用量(MemoryAccountingに通知済みのサイズ)
+	size_t m_memorySize = 0;
 };
 
 } // namespace axgl
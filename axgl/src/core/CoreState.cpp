@@ -590,7 +590,9 @@ void CoreState::setVertexAttribPointer(CoreContext* context, GLuint index, GLint
 	dst->type = type;
 	dst->normalized = normalized;
 	dst->stride = stride;
-	dst->pointer = pointer;
+	// NOTE: クライアントメモリのポインタはパイプラインステートのキーに含めない(描画毎に変わるため)
+	dst->pointer = (buffer != nullptr) ? pointer : nullptr;
+	m_drawParameters.clientArrayPointer[index] = (buffer != nullptr) ? nullptr : pointer;
 	// array buffer
 	if (m_drawParameters.vertexBuffer[index] != nullptr) {
 		m_drawParameters.vertexBuffer[index]->release(context);
@@ -614,7 +616,9 @@ void CoreState::setVertexAttribIPointer(CoreContext* context, GLuint index, GLin
 	dst->type = type;
 	dst->normalized = GL_FALSE;
 	dst->stride = stride;
-	dst->pointer = pointer;
+	// NOTE: クライアントメモリのポインタはパイプラインステートのキーに含めない(描画毎に変わるため)
+	dst->pointer = (buffer != nullptr) ? pointer : nullptr;
+	m_drawParameters.clientArrayPointer[index] = (buffer != nullptr) ? nullptr : pointer;
 	// array buffer
 	if (m_drawParameters.vertexBuffer[index] != nullptr) {
 		m_drawParameters.vertexBuffer[index]->release(context);
@@ -839,7 +843,12 @@ void CoreState::getVertexAttribPointerv(GLuint index, GLenum pname, void** point
 	switch (pname) {
 	case GL_VERTEX_ATTRIB_ARRAY_POINTER:
 		AXGL_ASSERT(pointer != nullptr);
-		*pointer = const_cast<void*>(src.pointer);
+		if (m_drawParameters.vertexBuffer[index] != nullptr) {
+			*pointer = const_cast<void*>(src.pointer);
+		} else {
+			// クライアントメモリの頂点配列
+			*pointer = const_cast<void*>(m_drawParameters.clientArrayPointer[index]);
+		}
 		break;
 	default:
 		setErrorCode(GL_INVALID_ENUM);
@@ -869,7 +878,7 @@ void CoreState::setEnable(GLenum cap, GLboolean enable)
 		m_drawParameters.dirtyFlags |= POLYGON_OFFSET_DIRTY_BIT;
 		break;
 	case GL_PRIMITIVE_RESTART_FIXED_INDEX:
-		m_primitiveRestartFixedIndex = enable;
+		m_drawParameters.primitiveRestartFixedIndex = enable;
 		break;
 	case GL_RASTERIZER_DISCARD:
 		m_rasterizerDiscard = enable;
@@ -914,7 +923,7 @@ GLboolean CoreState::getEnable(GLenum cap)
 		rval = m_drawParameters.polygonOffsetParams.polygonOffsetFillEnable;
 		break;
 	case GL_PRIMITIVE_RESTART_FIXED_INDEX:
-		rval = m_primitiveRestartFixedIndex;
+		rval = m_drawParameters.primitiveRestartFixedIndex;
 		break;
 	case GL_RASTERIZER_DISCARD:
 		rval = m_rasterizerDiscard;
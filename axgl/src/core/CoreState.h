@@ -194,7 +194,6 @@ private:
 	CoreQuery* m_pTransformFeedbackPrimitivesWritten = nullptr;
 	// enable/disable
 	GLboolean m_dither = GL_TRUE;
-	GLboolean m_primitiveRestartFixedIndex = GL_FALSE;
 	GLboolean m_rasterizerDiscard = GL_FALSE;
 	// GL_ACTIVE_TEXTURE
 	GLenum m_activeTexture = GL_TEXTURE0;
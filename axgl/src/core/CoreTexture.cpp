@@ -2,6 +2,7 @@
 // Textureクラスの実装
 #include "CoreTexture.h"
 #include "CoreContext.h"
+#include "../common/MemoryAccounting.h"
 
 namespace axgl {
 
@@ -25,6 +26,7 @@ void CoreTexture::terminate(CoreContext* context)
 		BackendTexture::destroy(m_pBackendTexture);
 		m_pBackendTexture = nullptr;
 	}
+	updateMemorySize();
 	if (m_pBackendSampler != nullptr) {
 		m_pBackendSampler->terminate(backend_context);
 		BackendSampler::destroy(m_pBackendSampler);
@@ -48,13 +50,13 @@ GLenum CoreTexture::getTarget() const
 	return m_target;
 }
 
-void CoreTexture::compressedTexImage2d(CoreContext* context, GLenum target, GLint level, GLenum internalformat,
+bool CoreTexture::compressedTexImage2d(CoreContext* context, GLenum target, GLint level, GLenum internalformat,
 	GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void *data)
 {
 	AXGL_ASSERT(context != nullptr);
 	if (!setupBackendTexture(context)) {
 		AXGL_DBGOUT("CoreTexture::setupBackendTexture() failed\n");
-		return;
+		return false;
 	}
 	AXGL_UNUSED(border);
 	BackendContext* backend_context = context->getBackendContext();
@@ -70,10 +72,11 @@ void CoreTexture::compressedTexImage2d(CoreContext* context, GLenum target, GLin
 		AXGL_ASSERT(0);
 	}
 	m_internalformat = internalformat;
+	updateMemorySize();
 	if (!result) {
 		AXGL_DBGOUT("BackendTexture::setCompressedImage*() failed\n");
 	}
-	return;
+	return result;
 }
 
 void CoreTexture::compressedTexSubImage2d(CoreContext* context, GLenum target, GLint level, GLint xoffset, GLint yoffset,
@@ -94,41 +97,67 @@ void CoreTexture::compressedTexSubImage2d(CoreContext* context, GLenum target, G
 	return;
 }
 
-void CoreTexture::copyTexImage2d(GLint level, GLenum internalformat, GLint x, GLint y, GLsizei width, GLsizei height, GLint border)
+void CoreTexture::copyTexImage2d(CoreContext* context, GLenum target, GLint level, GLenum internalformat,
+	GLint x, GLint y, GLsizei width, GLsizei height, GLint border, BackendFramebuffer* readFramebuffer, GLenum readBuffer)
 {
-	// TODO:
-	AXGL_UNUSED(level);
-	AXGL_UNUSED(internalformat);
-	AXGL_UNUSED(x);
-	AXGL_UNUSED(y);
-	AXGL_UNUSED(width);
-	AXGL_UNUSED(height);
+	AXGL_ASSERT(context != nullptr);
+	if (!setupBackendTexture(context)) {
+		AXGL_DBGOUT("CoreTexture::setupBackendTexture() failed\n");
+		return;
+	}
 	AXGL_UNUSED(border);
-	AXGL_DBGOUT("CoreTexture::copyTexImage2d() called\n");
+	BackendContext* backend_context = context->getBackendContext();
+	bool result = false;
+	AXGL_ASSERT(m_pBackendTexture != nullptr);
+	if (m_target == GL_TEXTURE_CUBE_MAP) {
+		result = m_pBackendTexture->copyImage2D(backend_context, target, level, internalformat,
+			x, y, width, height, readFramebuffer, readBuffer, &m_textureParameters);
+	} else if(m_target == GL_TEXTURE_2D) {
+		result = m_pBackendTexture->copyImage2D(backend_context, GL_TEXTURE_2D, level, internalformat,
+			x, y, width, height, readFramebuffer, readBuffer, &m_textureParameters);
+	} else {
+		AXGL_ASSERT(0);
+	}
+	m_internalformat = internalformat;
+	updateMemorySize();
+	if (!result) {
+		AXGL_DBGOUT("BackendTexture::copyImage2D() failed\n");
+	}
 	return;
 }
 
-void CoreTexture::copyTexSubImage2d(GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height)
+void CoreTexture::copyTexSubImage2d(CoreContext* context, GLenum target, GLint level, GLint xoffset, GLint yoffset,
+	GLint x, GLint y, GLsizei width, GLsizei height, BackendFramebuffer* readFramebuffer, GLenum readBuffer)
 {
-	// TODO:
-	AXGL_UNUSED(level);
-	AXGL_UNUSED(xoffset);
-	AXGL_UNUSED(yoffset);
-	AXGL_UNUSED(x);
-	AXGL_UNUSED(y);
-	AXGL_UNUSED(width);
-	AXGL_UNUSED(height);
-	AXGL_DBGOUT("CoreTexture::copyTexSubImage2d() called\n");
+	if (m_pBackendTexture == nullptr) {
+		return;
+	}
+	AXGL_ASSERT(context != nullptr);
+	BackendContext* backend_context = context->getBackendContext();
+	bool result = false;
+	if (m_target == GL_TEXTURE_CUBE_MAP) {
+		result = m_pBackendTexture->copySubImage2D(backend_context, target, level, xoffset, yoffset,
+			x, y, width, height, readFramebuffer, readBuffer);
+	} else if(m_target == GL_TEXTURE_2D) {
+		result = m_pBackendTexture->copySubImage2D(backend_context, GL_TEXTURE_2D, level, xoffset, yoffset,
+			x, y, width, height, readFramebuffer, readBuffer);
+	} else {
+		AXGL_ASSERT(0);
+	}
+	if (!result) {
+		AXGL_DBGOUT("BackendTexture::copySubImage2D() failed\n");
+	}
 	return;
 }
 
-void CoreTexture::texImage2d(CoreContext* context, GLenum target, GLint level, GLint internalformat,
-	GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels)
+bool CoreTexture::texImage2d(CoreContext* context, GLenum target, GLint level, GLint internalformat,
+	GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels,
+	const BackendTexture::UnpackParameters* unpack)
 {
 	AXGL_ASSERT(context != nullptr);
 	if (!setupBackendTexture(context)) {
 		AXGL_DBGOUT("CoreTexture::setupBackendTexture() failed\n");
-		return;
+		return false;
 	}
 	AXGL_UNUSED(border);
 	BackendContext* backend_context = context->getBackendContext();
@@ -136,22 +165,24 @@ void CoreTexture::texImage2d(CoreContext* context, GLenum target, GLint level, G
 	AXGL_ASSERT(m_pBackendTexture != nullptr);
 	if (m_target == GL_TEXTURE_CUBE_MAP) {
 		result = m_pBackendTexture->setImageCube(backend_context, target, level, internalformat,
-			width, height, format, type, pixels, &m_textureParameters);
+			width, height, format, type, pixels, unpack, &m_textureParameters);
 	} else if(m_target == GL_TEXTURE_2D) {
 		result = m_pBackendTexture->setImage2D(backend_context, level, internalformat,
-			width, height, format, type, pixels, &m_textureParameters);
+			width, height, format, type, pixels, unpack, &m_textureParameters);
 	} else {
 		AXGL_ASSERT(0);
 	}
 	m_internalformat = internalformat;
+	updateMemorySize();
 	if (!result) {
 		AXGL_DBGOUT("BackendTexture::texImage2d() failed\n");
 	}
-	return;
+	return result;
 }
 
 void CoreTexture::texSubImage2d(CoreContext* context, GLenum target, GLint level, GLint xoffset, GLint yoffset,
-	GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+	GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels,
+	const BackendTexture::UnpackParameters* unpack)
 {
 	if (m_pBackendTexture == nullptr) {
 		return;
@@ -162,10 +193,10 @@ void CoreTexture::texSubImage2d(CoreContext* context, GLenum target, GLint level
 	AXGL_ASSERT(m_pBackendTexture != nullptr);
 	if (m_target == GL_TEXTURE_CUBE_MAP) {
 		result = m_pBackendTexture->setSubImageCube(backend_context, target, level, xoffset, yoffset,
-			width, height, format, type, pixels);
+			width, height, format, type, pixels, unpack);
 	} else if(m_target == GL_TEXTURE_2D) {
 		result = m_pBackendTexture->setSubImage2D(backend_context, level, xoffset, yoffset,
-			width, height, format, type, pixels);
+			width, height, format, type, pixels, unpack);
 	} else {
 		AXGL_ASSERT(0);
 	}
@@ -320,12 +351,13 @@ void CoreTexture::texParameteriv(GLenum pname, const GLint* params)
 	return;
 }
 
-void CoreTexture::texImage3d(CoreContext* context, GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void *pixels)
+bool CoreTexture::texImage3d(CoreContext* context, GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void *pixels,
+	const BackendTexture::UnpackParameters* unpack)
 {
 	AXGL_ASSERT(context != nullptr);
 	if (!setupBackendTexture(context)) {
 		AXGL_DBGOUT("CoreTexture::setupBackendTexture() failed\n");
-		return;
+		return false;
 	}
 	AXGL_UNUSED(target);
 	AXGL_UNUSED(border);
@@ -334,22 +366,24 @@ void CoreTexture::texImage3d(CoreContext* context, GLenum target, GLint level, G
 	AXGL_ASSERT(m_pBackendTexture != nullptr);
 	if (m_target == GL_TEXTURE_2D_ARRAY) {
 		result = m_pBackendTexture->setImage2DArray(backend_context, level, internalformat,
-			width, height, depth, format, type, pixels, &m_textureParameters);
+			width, height, depth, format, type, pixels, unpack, &m_textureParameters);
 	} else if(m_target == GL_TEXTURE_3D) {
 		result = m_pBackendTexture->setImage3D(backend_context, level, internalformat,
-			width, height, depth, format, type, pixels, &m_textureParameters);
+			width, height, depth, format, type, pixels, unpack, &m_textureParameters);
 	} else {
 		AXGL_ASSERT(0);
 	}
 	m_internalformat = internalformat;
+	updateMemorySize();
 	if (!result) {
 		AXGL_DBGOUT("BackendTexture::setImage*() failed\n");
 	}
-	return;
+	return result;
 }
 
 void CoreTexture::texSubImage3d(CoreContext* context, GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
-	GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels)
+	GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels,
+	const BackendTexture::UnpackParameters* unpack)
 {
 	if (m_pBackendTexture == nullptr) {
 		return;
@@ -361,10 +395,10 @@ void CoreTexture::texSubImage3d(CoreContext* context, GLenum target, GLint level
 	AXGL_ASSERT(m_pBackendTexture != nullptr);
 	if (m_target == GL_TEXTURE_2D_ARRAY) {
 		result = m_pBackendTexture->setSubImage2DArray(backend_context, level, xoffset, yoffset, zoffset,
-			width, height, depth, format, type, pixels);
+			width, height, depth, format, type, pixels, unpack);
 	} else if(m_target == GL_TEXTURE_3D) {
 		result = m_pBackendTexture->setSubImage3D(backend_context, level, xoffset, yoffset, zoffset,
-			width, height, depth, format, type, pixels);
+			width, height, depth, format, type, pixels, unpack);
 	} else {
 		AXGL_ASSERT(0);
 	}
@@ -411,6 +445,7 @@ void CoreTexture::compressedTexImage3d(CoreContext* context, GLenum target, GLin
 		AXGL_ASSERT(0);
 	}
 	m_internalformat = internalformat;
+	updateMemorySize();
 	if (!result) {
 		AXGL_DBGOUT("BackendTexture::setCompressedImage*() failed\n");
 	}
@@ -455,6 +490,7 @@ void CoreTexture::texStorage2d(CoreContext* context, GLsizei levels, GLenum inte
 	}
 	m_immutableFormat = GL_TRUE;
 	m_internalformat = internalformat;
+	updateMemorySize();
 	if (!result) {
 		AXGL_DBGOUT("BackendTexture::createStorage*() failed\n");
 	}
@@ -479,24 +515,27 @@ void CoreTexture::texStorage3d(CoreContext* context, GLsizei levels, GLenum inte
 		AXGL_ASSERT(0);
 	}
 	m_immutableFormat = GL_TRUE;
-	m_internalformat = internalformat; 
+	m_internalformat = internalformat;
+	updateMemorySize();
 	if (!result) {
 		AXGL_DBGOUT("BackendTexture::createStorage*() failed\n");
 	}
 	return;
 }
 
-void CoreTexture::generateMipmap(CoreContext* context)
+bool CoreTexture::generateMipmap(CoreContext* context)
 {
 	if (m_pBackendTexture == nullptr) {
-		return;
+		return false;
 	}
 	AXGL_ASSERT(context != nullptr);
 	bool result = m_pBackendTexture->generateMipmap(context->getBackendContext(), &m_textureParameters);
 	if (!result) {
+		// NOTE: バックエンドで生成できないフォーマット
 		AXGL_DBGOUT("BackendTexture::generateMipmap() failed\n");
+		setErrorCode(GL_INVALID_OPERATION);
 	}
-	return;
+	return result;
 }
 
 void CoreTexture::getParameterfv(GLenum pname, GLfloat* params)
@@ -617,6 +656,15 @@ void CoreTexture::getParameteriv(GLenum pname, GLint* params)
 	return;
 }
 
+// GPUメモリの使用量を更新
+void CoreTexture::updateMemorySize()
+{
+	size_t memory_size = (m_pBackendTexture != nullptr) ? m_pBackendTexture->getMemorySize() : 0;
+	MemoryAccounting::getInstance().update(MemoryCategoryTexture, m_memorySize, memory_size);
+	m_memorySize = memory_size;
+	return;
+}
+
 bool CoreTexture::setupSampler(CoreContext* context)
 {
 	if (m_pBackendSampler == nullptr) {
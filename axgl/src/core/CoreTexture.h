@@ -22,20 +22,26 @@ public:
 	void terminate(CoreContext* context) override;
 	void setTarget(GLenum target);
 	GLenum getTarget() const;
-	void compressedTexImage2d(CoreContext* context, GLenum target, GLint level, GLenum internalformat,
+	bool compressedTexImage2d(CoreContext* context, GLenum target, GLint level, GLenum internalformat,
 		GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void *data);
 	void compressedTexSubImage2d(CoreContext* context, GLenum target, GLint level, GLint xoffset, GLint yoffset,
 		GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void *data);
-	void copyTexImage2d(GLint level, GLenum internalformat, GLint x, GLint y, GLsizei width, GLsizei height, GLint border);
-	void copyTexSubImage2d(GLint level, GLint xoffset, GLint yofffset, GLint x, GLint y, GLsizei width, GLsizei height);
-	void texImage2d(CoreContext* context, GLenum target, GLint level, GLint internalformat,
-		GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels);
+	void copyTexImage2d(CoreContext* context, GLenum target, GLint level, GLenum internalformat,
+		GLint x, GLint y, GLsizei width, GLsizei height, GLint border, BackendFramebuffer* readFramebuffer, GLenum readBuffer);
+	void copyTexSubImage2d(CoreContext* context, GLenum target, GLint level, GLint xoffset, GLint yoffset,
+		GLint x, GLint y, GLsizei width, GLsizei height, BackendFramebuffer* readFramebuffer, GLenum readBuffer);
+	bool texImage2d(CoreContext* context, GLenum target, GLint level, GLint internalformat,
+		GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels,
+		const BackendTexture::UnpackParameters* unpack);
 	void texSubImage2d(CoreContext* context, GLenum target, GLint level, GLint xoffset, GLint yoffset,
-		GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
-	void texImage3d(CoreContext* context, GLenum target, GLint level, GLint internalformat,
-		GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void *pixels);
+		GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels,
+		const BackendTexture::UnpackParameters* unpack);
+	bool texImage3d(CoreContext* context, GLenum target, GLint level, GLint internalformat,
+		GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void *pixels,
+		const BackendTexture::UnpackParameters* unpack);
 	void texSubImage3d(CoreContext* context, GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
-		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels);
+		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels,
+		const BackendTexture::UnpackParameters* unpack);
 	void copyTexSubImage3d(GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLint x, GLint y, GLsizei width, GLsizei height);
 	void compressedTexImage3d(CoreContext* context, GLenum target, GLint level, GLenum internalformat,
 		GLsizei width, GLsizei height, GLsizei depth, GLint border, GLsizei imageSize, const void *data);
@@ -47,7 +53,7 @@ public:
 	void texParameteriv(GLenum pname, const GLint* params);
 	void texStorage2d(CoreContext* context, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
 	void texStorage3d(CoreContext* context, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth);
-	void generateMipmap(CoreContext* context);
+	bool generateMipmap(CoreContext* context);
 	GLenum getInternalformat() const
 	{
 		return m_internalformat;
@@ -71,6 +77,7 @@ private:
 
 private:
 	bool setupBackendTexture(CoreContext* context);
+	void updateMemorySize();
 
 private:
 	GLenum m_target = TARGET_UNKNOWN;
@@ -81,6 +88,8 @@ private:
 	BackendSampler::SamplerParameters m_samplerParameters;
 	BackendSampler* m_pBackendSampler = nullptr;
 	bool m_samplerDirty = true;
+	// GPUメモリの使用量(MemoryAccountingに通知済みのサイズ)
+	size_t m_memorySize = 0;
 };
 
 } // namespace axgl
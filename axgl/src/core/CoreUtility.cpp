@@ -1,5 +1,6 @@
 ﻿// CoreUtility.cpp
 #include "CoreUtility.h"
+#include "../common/TextureTranscoder.h"
 
 namespace axgl {
 
@@ -364,4 +365,154 @@ GLboolean isIntegerFromType(GLenum type)
 	return rval;
 }
 
+// typeの1データのバイト数(パックされたtypeは1ピクセルのバイト数)
+size_t getTypeSizeFromType(GLenum type)
+{
+	size_t rval = 0;
+	switch (type) {
+	case GL_BYTE:
+	case GL_UNSIGNED_BYTE:
+		rval = 1;
+		break;
+	case GL_SHORT:
+	case GL_UNSIGNED_SHORT:
+	case GL_HALF_FLOAT:
+	case GL_UNSIGNED_SHORT_5_6_5:
+	case GL_UNSIGNED_SHORT_4_4_4_4:
+	case GL_UNSIGNED_SHORT_5_5_5_1:
+		rval = 2;
+		break;
+	case GL_INT:
+	case GL_UNSIGNED_INT:
+	case GL_FLOAT:
+	case GL_UNSIGNED_INT_2_10_10_10_REV:
+	case GL_UNSIGNED_INT_10F_11F_11F_REV:
+	case GL_UNSIGNED_INT_5_9_9_9_REV:
+	case GL_UNSIGNED_INT_24_8:
+		rval = 4;
+		break;
+	case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+		rval = 8;
+		break;
+	default:
+		break;
+	}
+	return rval;
+}
+
+// formatとtypeの1ピクセルのバイト数(不明な組み合わせは0)
+size_t getPixelSizeFromFormatType(GLenum format, GLenum type)
+{
+	switch (type) {
+	case GL_UNSIGNED_SHORT_5_6_5:
+	case GL_UNSIGNED_SHORT_4_4_4_4:
+	case GL_UNSIGNED_SHORT_5_5_5_1:
+	case GL_UNSIGNED_INT_2_10_10_10_REV:
+	case GL_UNSIGNED_INT_10F_11F_11F_REV:
+	case GL_UNSIGNED_INT_5_9_9_9_REV:
+	case GL_UNSIGNED_INT_24_8:
+	case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+		return getTypeSizeFromType(type);
+	default:
+		break;
+	}
+	size_t num_components = 0;
+	switch (format) {
+	case GL_RED:
+	case GL_RED_INTEGER:
+	case GL_ALPHA:
+	case GL_LUMINANCE:
+	case GL_DEPTH_COMPONENT:
+		num_components = 1;
+		break;
+	case GL_RG:
+	case GL_RG_INTEGER:
+	case GL_LUMINANCE_ALPHA:
+		num_components = 2;
+		break;
+	case GL_RGB:
+	case GL_RGB_INTEGER:
+		num_components = 3;
+		break;
+	case GL_RGBA:
+	case GL_RGBA_INTEGER:
+		num_components = 4;
+		break;
+	default:
+		break;
+	}
+	return getTypeSizeFromType(type) * num_components;
+}
+
+// ミップマップを生成できるフォーマットか(整数、デプス、ステンシル、圧縮のフォーマットは不可)
+bool isMipmapGeneratableFormat(GLenum internalformat)
+{
+	switch (internalformat) {
+	case GL_R8UI:
+	case GL_R8I:
+	case GL_R16UI:
+	case GL_R16I:
+	case GL_R32UI:
+	case GL_R32I:
+	case GL_RG8UI:
+	case GL_RG8I:
+	case GL_RG16UI:
+	case GL_RG16I:
+	case GL_RG32UI:
+	case GL_RG32I:
+	case GL_RGB8UI:
+	case GL_RGB8I:
+	case GL_RGB16UI:
+	case GL_RGB16I:
+	case GL_RGB32UI:
+	case GL_RGB32I:
+	case GL_RGBA8UI:
+	case GL_RGBA8I:
+	case GL_RGB10_A2UI:
+	case GL_RGBA16UI:
+	case GL_RGBA16I:
+	case GL_RGBA32UI:
+	case GL_RGBA32I:
+	case GL_DEPTH_COMPONENT:
+	case GL_DEPTH_STENCIL:
+	case GL_STENCIL_INDEX8:
+		return false;
+	case 0x83f1: //GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+		return false;
+	default:
+		break;
+	}
+	// ETC2/EAC、ASTCの圧縮フォーマット
+	CompressedFormatInfo compressed_info;
+	if (getCompressedFormatInfo(internalformat, &compressed_info)) {
+		return false;
+	}
+	return (getDepthBitsFromFormat(internalformat) == 0) && (getStencilBitsFromFormat(internalformat) == 0);
+}
+
+// ピクセルパックバッファへの書き込みがバッファの範囲内で、オフセットがtypeのデータ境界にあるか
+// NOTE: 行のバイト数はバックエンドと同じく、GL_PACK_ROW_LENGTHのピクセル数をGL_PACK_ALIGNMENTに揃える
+bool isValidPackBufferRange(size_t bufferSize, size_t offset, GLsizei width, GLsizei height, GLenum format, GLenum type,
+	GLint rowLength, GLint skipRows, GLint skipPixels, GLint alignment)
+{
+	size_t type_size = getTypeSizeFromType(type);
+	if ((type_size != 0) && ((offset % type_size) != 0)) {
+		return false;
+	}
+	if (offset > bufferSize) {
+		return false;
+	}
+	size_t pixel_size = getPixelSizeFromFormatType(format, type);
+	if ((width <= 0) || (height <= 0) || (pixel_size == 0)) {
+		// NOTE: 書き込みがない場合と、不明なformatとtypeの組み合わせ(バックエンドで失敗する)は範囲を確認しない
+		return true;
+	}
+	size_t row_length = (rowLength > 0) ? static_cast<size_t>(rowLength) : static_cast<size_t>(width);
+	size_t row_alignment = (alignment > 0) ? static_cast<size_t>(alignment) : 1;
+	size_t bytes_per_row = (((row_length * pixel_size) + row_alignment - 1) / row_alignment) * row_alignment;
+	size_t skip_bytes = (static_cast<size_t>(skipRows) * bytes_per_row) + (static_cast<size_t>(skipPixels) * pixel_size);
+	size_t end = offset + skip_bytes + (bytes_per_row * static_cast<size_t>(height - 1)) + (pixel_size * static_cast<size_t>(width));
+	return (end <= bufferSize);
+}
+
 } // namespace axgl
@@ -15,6 +15,11 @@ int getStencilBitsFromFormat(GLenum format);
 GLenum getComponentTypeFromFormat(GLenum format, bool isStencil = false);
 GLenum getColorEncodingFromFormat(GLenum format);
 GLboolean isIntegerFromType(GLenum type);
+size_t getTypeSizeFromType(GLenum type);
+size_t getPixelSizeFromFormatType(GLenum format, GLenum type);
+bool isMipmapGeneratableFormat(GLenum internalformat);
+bool isValidPackBufferRange(size_t bufferSize, size_t offset, GLsizei width, GLsizei height, GLenum format, GLenum type,
+	GLint rowLength, GLint skipRows, GLint skipPixels, GLint alignment);
 
 } // namespace
 
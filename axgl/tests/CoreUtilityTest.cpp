@@ -0,0 +1,58 @@
+// CoreUtilityTest.cpp
+// glGenerateMipmapで使用するフォーマットの判定を確認する
+#include "core/CoreUtility.h"
+
+#include <gtest/gtest.h>
+
+using namespace axgl;
+
+namespace {
+
+TEST(CoreUtility, MipmapGeneratableColorFormats)
+{
+	const GLenum formats[] = {
+		GL_RGBA8, GL_SRGB8_ALPHA8, GL_RGB565, GL_R8, GL_RG16F, GL_RGBA32F, GL_R11F_G11F_B10F, GL_RGB10_A2,
+		GL_RGBA, GL_RGB, GL_LUMINANCE_ALPHA, GL_ALPHA
+	};
+	for (GLenum format : formats) {
+		EXPECT_TRUE(isMipmapGeneratableFormat(format)) << std::hex << format;
+	}
+}
+
+TEST(CoreUtility, MipmapNotGeneratableIntegerFormats)
+{
+	const GLenum formats[] = {
+		GL_R8UI, GL_R32I, GL_RG16UI, GL_RGB8I, GL_RGBA8UI, GL_RGB10_A2UI, GL_RGBA32I
+	};
+	for (GLenum format : formats) {
+		EXPECT_FALSE(isMipmapGeneratableFormat(format)) << std::hex << format;
+	}
+}
+
+TEST(CoreUtility, MipmapNotGeneratableDepthStencilFormats)
+{
+	const GLenum formats[] = {
+		GL_DEPTH_COMPONENT, GL_DEPTH_STENCIL, GL_STENCIL_INDEX8,
+		GL_DEPTH_COMPONENT16, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT32F, GL_DEPTH24_STENCIL8, GL_DEPTH32F_STENCIL8
+	};
+	for (GLenum format : formats) {
+		EXPECT_FALSE(isMipmapGeneratableFormat(format)) << std::hex << format;
+	}
+}
+
+// 圧縮フォーマットはGL_INVALID_OPERATIONになる(ES 3.0 glGenerateMipmap)
+TEST(CoreUtility, MipmapNotGeneratableCompressedFormats)
+{
+	const GLenum formats[] = {
+		GL_COMPRESSED_R11_EAC, GL_COMPRESSED_SIGNED_RG11_EAC, GL_COMPRESSED_RGB8_ETC2, GL_COMPRESSED_SRGB8_ETC2,
+		GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, GL_COMPRESSED_RGBA8_ETC2_EAC, GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC,
+		GL_COMPRESSED_RGBA_ASTC_4x4_KHR, GL_COMPRESSED_RGBA_ASTC_8x6_KHR, GL_COMPRESSED_RGBA_ASTC_12x12_KHR,
+		GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR, GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x10_KHR,
+		0x83f1 // GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+	};
+	for (GLenum format : formats) {
+		EXPECT_FALSE(isMipmapGeneratableFormat(format)) << std::hex << format;
+	}
+}
+
+} // namespace
@@ -0,0 +1,140 @@
+// DirtyRangeListTest.cpp
+// DirtyRangeListの範囲の結合、上限を超えた場合のまとめ、4バイト単位の転送範囲を確認する
+#include "common/DirtyRangeList.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+std::vector<std::pair<intptr_t, intptr_t>> get_ranges(const DirtyRangeList& list)
+{
+	std::vector<std::pair<intptr_t, intptr_t>> ranges;
+	for (const DirtyRangeList::Range& range : list.getRanges()) {
+		ranges.emplace_back(range.start, range.end);
+	}
+	std::sort(ranges.begin(), ranges.end());
+	return ranges;
+}
+
+} // namespace
+
+TEST(DirtyRangeList, Empty)
+{
+	DirtyRangeList list;
+	EXPECT_TRUE(list.empty());
+	EXPECT_EQ(list.getUpdateCount(), 0u);
+	size_t start = 0;
+	size_t end = 0;
+	EXPECT_FALSE(list.getAlignedExtent(1024, 1024, &start, &end));
+}
+
+TEST(DirtyRangeList, MergeOverlappingAndAdjacent)
+{
+	DirtyRangeList list;
+	list.add(0, 64);
+	list.add(128, 192);
+	list.add(64, 96); // 隣接
+	list.add(180, 256); // 重なり
+	list.add(512, 576);
+	using Ranges = std::vector<std::pair<intptr_t, intptr_t>>;
+	EXPECT_EQ(get_ranges(list), (Ranges{ { 0, 96 }, { 128, 256 }, { 512, 576 } }));
+	// 2つの範囲をつなぐ
+	list.add(90, 130);
+	EXPECT_EQ(get_ranges(list), (Ranges{ { 0, 256 }, { 512, 576 } }));
+	EXPECT_EQ(list.getStart(), 0);
+	EXPECT_EQ(list.getEnd(), 576);
+	EXPECT_EQ(list.getUpdateCount(), 6u);
+	list.clear();
+	EXPECT_TRUE(list.empty());
+	EXPECT_EQ(list.getUpdateCount(), 0u);
+	EXPECT_EQ(list.getStart(), list.getEnd());
+}
+
+TEST(DirtyRangeList, CollapseOverLimit)
+{
+	DirtyRangeList list;
+	for (size_t i = 0; i < DirtyRangeList::c_range_max; i++) {
+		list.add(i * 256, i * 256 + 64);
+	}
+	EXPECT_EQ(list.getRanges().size(), DirtyRangeList::c_range_max);
+	list.add(100000, 100004);
+	ASSERT_EQ(list.getRanges().size(), 1u);
+	EXPECT_EQ(list.getRanges()[0].start, 0);
+	EXPECT_EQ(list.getRanges()[0].end, 100004);
+	EXPECT_EQ(list.getUpdateCount(), DirtyRangeList::c_range_max + 1);
+}
+
+// ランダムな範囲を追加し、範囲が重ならず、追加した全てのバイトを含むことを確認する
+TEST(DirtyRangeList, RandomCoverage)
+{
+	constexpr intptr_t c_size = 4096;
+	std::mt19937 rng(7);
+	for (int round = 0; round < 200; round++) {
+		DirtyRangeList list;
+		std::vector<bool> written(c_size, false);
+		int count = 1 + static_cast<int>(rng() % 40);
+		for (int i = 0; i < count; i++) {
+			intptr_t start = static_cast<intptr_t>(rng() % (c_size - 64));
+			intptr_t end = start + 1 + static_cast<intptr_t>(rng() % 64);
+			list.add(start, end);
+			std::fill(written.begin() + start, written.begin() + end, true);
+		}
+		std::vector<std::pair<intptr_t, intptr_t>> ranges = get_ranges(list);
+		ASSERT_LE(ranges.size(), DirtyRangeList::c_range_max);
+		for (size_t i = 1; i < ranges.size(); i++) {
+			// 隣接する範囲は結合されている
+			ASSERT_LT(ranges[i - 1].second, ranges[i].first);
+		}
+		for (intptr_t b = 0; b < c_size; b++) {
+			if (!written[b]) {
+				continue;
+			}
+			bool covered = false;
+			for (const auto& range : ranges) {
+				covered = covered || ((range.first <= b) && (b < range.second));
+			}
+			ASSERT_TRUE(covered) << "round=" << round << " byte=" << b;
+		}
+	}
+}
+
+TEST(DirtyRangeList, AlignedExtent)
+{
+	DirtyRangeList list;
+	list.add(5, 9);
+	list.add(30, 33);
+	size_t start = 0;
+	size_t end = 0;
+	ASSERT_TRUE(list.getAlignedExtent(1024, 1024, &start, &end));
+	EXPECT_EQ(start, 4u);
+	EXPECT_EQ(end, 36u);
+	// データの終端で制限してから揃える
+	ASSERT_TRUE(list.getAlignedExtent(31, 32, &start, &end));
+	EXPECT_EQ(start, 4u);
+	EXPECT_EQ(end, 32u);
+	EXPECT_EQ((end - start) % 4, 0u);
+	// 揃えた終端が転送先を超える場合
+	EXPECT_FALSE(list.getAlignedExtent(31, 31, &start, &end));
+}
+
+TEST(DirtyRangeList, GatherExtent)
+{
+	std::vector<uint8_t> src(30);
+	for (size_t i = 0; i < src.size(); i++) {
+		src[i] = static_cast<uint8_t>(i + 1);
+	}
+	std::vector<uint8_t> dst(32, 0xcd);
+	DirtyRangeList::gatherExtent(dst.data(), src.data(), src.size(), 4, 32);
+	for (size_t i = 0; i < 26; i++) {
+		EXPECT_EQ(dst[i], src[i + 4]);
+	}
+	// データの終端を超える部分は0
+	EXPECT_EQ(dst[26], 0);
+	EXPECT_EQ(dst[27], 0);
+	EXPECT_EQ(dst[28], 0xcd);
+}
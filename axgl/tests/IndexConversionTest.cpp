@@ -0,0 +1,252 @@
+// IndexConversionTest.cpp
+// IndexConversionのSIMD実装を、スカラーの参照実装と全ての長さ、境界値で比較する
+#include "common/IndexConversion.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+// SIMDの幅(16要素)と端数の組み合わせを網羅する長さ
+constexpr size_t c_max_count = 80;
+
+template <typename T>
+std::vector<T> make_indices(size_t count, uint32_t seed, bool withRestart)
+{
+	std::mt19937 rng(seed);
+	std::vector<T> indices(count);
+	for (size_t i = 0; i < count; i++) {
+		uint32_t value = rng();
+		if (withRestart && ((value % 7) == 0)) {
+			indices[i] = std::numeric_limits<T>::max();
+		} else {
+			// NOTE: 型の最大値付近も含める
+			indices[i] = static_cast<T>(((value >> 3) % 4) == 0 ? (std::numeric_limits<T>::max() - (value % 3) - 1) : value);
+		}
+	}
+	return indices;
+}
+
+// 参照実装
+template <typename SRC, typename DST>
+std::vector<DST> ref_tri_fan(const SRC* src, size_t count)
+{
+	std::vector<DST> dst;
+	for (size_t i = 0; (i + 2) < count; i++) {
+		dst.push_back(src[0]);
+		dst.push_back(src[i + 1]);
+		dst.push_back(src[i + 2]);
+	}
+	return dst;
+}
+
+template <typename SRC, typename DST>
+std::vector<DST> ref_tri_fan_restart(const std::vector<SRC>& src)
+{
+	std::vector<DST> dst;
+	size_t start = 0;
+	for (size_t i = 0; i <= src.size(); i++) {
+		if ((i == src.size()) || (src[i] == std::numeric_limits<SRC>::max())) {
+			std::vector<DST> part = ref_tri_fan<SRC, DST>(src.data() + start, i - start);
+			dst.insert(dst.end(), part.begin(), part.end());
+			start = i + 1;
+		}
+	}
+	return dst;
+}
+
+template <typename SRC, typename DST>
+std::vector<DST> ref_line_loop_restart(const std::vector<SRC>& src)
+{
+	std::vector<DST> dst;
+	size_t start = 0;
+	for (size_t i = 0; i <= src.size(); i++) {
+		if ((i == src.size()) || (src[i] == std::numeric_limits<SRC>::max())) {
+			if ((i - start) >= 2) {
+				if (!dst.empty()) {
+					dst.push_back(std::numeric_limits<DST>::max());
+				}
+				dst.insert(dst.end(), src.begin() + start, src.begin() + i);
+				dst.push_back(src[start]);
+			}
+			start = i + 1;
+		}
+	}
+	return dst;
+}
+
+template <typename T>
+void ref_scan(const std::vector<T>& src, bool primitiveRestart, uint32_t* minIndex, uint32_t* maxIndex)
+{
+	*minIndex = UINT32_MAX;
+	*maxIndex = 0;
+	for (T value : src) {
+		if (primitiveRestart && (value == std::numeric_limits<T>::max())) {
+			continue;
+		}
+		*minIndex = std::min<uint32_t>(*minIndex, value);
+		*maxIndex = std::max<uint32_t>(*maxIndex, value);
+	}
+	return;
+}
+
+} // namespace
+
+TEST(IndexConversion, WidenU8ToU16AllValues)
+{
+	// 全ての値を、全ての開始位置(アライメント)で変換
+	std::vector<uint8_t> src(256 + 16);
+	for (size_t i = 0; i < src.size(); i++) {
+		src[i] = static_cast<uint8_t>(i);
+	}
+	for (size_t offset = 0; offset < 16; offset++) {
+		std::vector<uint16_t> dst(256);
+		std::vector<uint16_t> dst_restart(256);
+		widenIndicesU8ToU16(dst.data(), src.data() + offset, 256);
+		widenIndicesU8ToU16Restart(dst_restart.data(), src.data() + offset, 256);
+		for (size_t i = 0; i < 256; i++) {
+			uint8_t value = src[offset + i];
+			ASSERT_EQ(dst[i], value);
+			ASSERT_EQ(dst_restart[i], (value == UINT8_MAX) ? UINT16_MAX : value);
+		}
+	}
+}
+
+TEST(IndexConversion, WidenU8ToU16DoesNotWritePastCount)
+{
+	for (size_t count = 0; count <= c_max_count; count++) {
+		std::vector<uint8_t> src = make_indices<uint8_t>(count, static_cast<uint32_t>(count), false);
+		std::vector<uint16_t> dst(count + 1, 0xCDCD);
+		widenIndicesU8ToU16(dst.data(), src.data(), count);
+		ASSERT_EQ(dst[count], 0xCDCD) << "count:" << count;
+	}
+}
+
+TEST(IndexConversion, TriFanMatchesReference)
+{
+	for (size_t count = 0; count <= c_max_count; count++) {
+		std::vector<uint8_t> src8 = make_indices<uint8_t>(count, 1000 + static_cast<uint32_t>(count), false);
+		std::vector<uint16_t> src16 = make_indices<uint16_t>(count, 2000 + static_cast<uint32_t>(count), false);
+		std::vector<uint32_t> src32 = make_indices<uint32_t>(count, 3000 + static_cast<uint32_t>(count), false);
+		size_t num = (count >= 3) ? ((count - 2) * 3) : 0;
+		std::vector<uint16_t> dst8(num + 1, 0xCDCD);
+		std::vector<uint16_t> dst16(num + 1, 0xCDCD);
+		std::vector<uint32_t> dst32(num + 1, 0xCDCDCDCD);
+		convertTriFanIndicesU8(dst8.data(), src8.data(), count);
+		convertTriFanIndicesU16(dst16.data(), src16.data(), count);
+		convertTriFanIndicesU32(dst32.data(), src32.data(), count);
+		std::vector<uint16_t> ref8 = ref_tri_fan<uint8_t, uint16_t>(src8.data(), count);
+		std::vector<uint16_t> ref16 = ref_tri_fan<uint16_t, uint16_t>(src16.data(), count);
+		std::vector<uint32_t> ref32 = ref_tri_fan<uint32_t, uint32_t>(src32.data(), count);
+		ASSERT_TRUE(std::equal(ref8.begin(), ref8.end(), dst8.begin())) << "count:" << count;
+		ASSERT_TRUE(std::equal(ref16.begin(), ref16.end(), dst16.begin())) << "count:" << count;
+		ASSERT_TRUE(std::equal(ref32.begin(), ref32.end(), dst32.begin())) << "count:" << count;
+		ASSERT_EQ(dst8[num], 0xCDCD);
+		ASSERT_EQ(dst16[num], 0xCDCD);
+		ASSERT_EQ(dst32[num], 0xCDCDCDCDu);
+	}
+}
+
+TEST(IndexConversion, TriFanRestartMatchesReference)
+{
+	for (size_t count = 0; count <= c_max_count; count++) {
+		std::vector<uint8_t> src8 = make_indices<uint8_t>(count, 4000 + static_cast<uint32_t>(count), true);
+		std::vector<uint16_t> src16 = make_indices<uint16_t>(count, 5000 + static_cast<uint32_t>(count), true);
+		std::vector<uint32_t> src32 = make_indices<uint32_t>(count, 6000 + static_cast<uint32_t>(count), true);
+		// NOTE: 書き込みがない場合もdstは有効なポインタを渡す
+		size_t max_num = (count >= 3) ? ((count - 2) * 3) : 1;
+		std::vector<uint16_t> dst8(max_num);
+		std::vector<uint16_t> dst16(max_num);
+		std::vector<uint32_t> dst32(max_num);
+		size_t n8 = convertTriFanIndicesRestartU8(dst8.data(), src8.data(), count);
+		size_t n16 = convertTriFanIndicesRestartU16(dst16.data(), src16.data(), count);
+		size_t n32 = convertTriFanIndicesRestartU32(dst32.data(), src32.data(), count);
+		dst8.resize(n8);
+		dst16.resize(n16);
+		dst32.resize(n32);
+		ASSERT_EQ(dst8, (ref_tri_fan_restart<uint8_t, uint16_t>(src8))) << "count:" << count;
+		ASSERT_EQ(dst16, (ref_tri_fan_restart<uint16_t, uint16_t>(src16))) << "count:" << count;
+		ASSERT_EQ(dst32, (ref_tri_fan_restart<uint32_t, uint32_t>(src32))) << "count:" << count;
+	}
+}
+
+TEST(IndexConversion, LineLoopMatchesReference)
+{
+	for (size_t count = 1; count <= c_max_count; count++) {
+		std::vector<uint8_t> src8 = make_indices<uint8_t>(count, 7000 + static_cast<uint32_t>(count), false);
+		std::vector<uint16_t> src16 = make_indices<uint16_t>(count, 8000 + static_cast<uint32_t>(count), false);
+		std::vector<uint32_t> src32 = make_indices<uint32_t>(count, 9000 + static_cast<uint32_t>(count), false);
+		std::vector<uint16_t> dst8(count + 1);
+		std::vector<uint16_t> dst16(count + 1);
+		std::vector<uint32_t> dst32(count + 1);
+		convertLineLoopIndicesU8(dst8.data(), src8.data(), count);
+		convertLineLoopIndicesU16(dst16.data(), src16.data(), count);
+		convertLineLoopIndicesU32(dst32.data(), src32.data(), count);
+		for (size_t i = 0; i <= count; i++) {
+			size_t j = (i == count) ? 0 : i;
+			ASSERT_EQ(dst8[i], src8[j]);
+			ASSERT_EQ(dst16[i], src16[j]);
+			ASSERT_EQ(dst32[i], src32[j]);
+		}
+	}
+}
+
+TEST(IndexConversion, LineLoopRestartMatchesReference)
+{
+	for (size_t count = 0; count <= c_max_count; count++) {
+		std::vector<uint8_t> src8 = make_indices<uint8_t>(count, 10000 + static_cast<uint32_t>(count), true);
+		std::vector<uint16_t> src16 = make_indices<uint16_t>(count, 11000 + static_cast<uint32_t>(count), true);
+		std::vector<uint32_t> src32 = make_indices<uint32_t>(count, 12000 + static_cast<uint32_t>(count), true);
+		std::vector<uint16_t> dst8(count * 2 + 1);
+		std::vector<uint16_t> dst16(count * 2 + 1);
+		std::vector<uint32_t> dst32(count * 2 + 1);
+		dst8.resize(convertLineLoopIndicesRestartU8(dst8.data(), src8.data(), count));
+		dst16.resize(convertLineLoopIndicesRestartU16(dst16.data(), src16.data(), count));
+		dst32.resize(convertLineLoopIndicesRestartU32(dst32.data(), src32.data(), count));
+		ASSERT_EQ(dst8, (ref_line_loop_restart<uint8_t, uint16_t>(src8))) << "count:" << count;
+		ASSERT_EQ(dst16, (ref_line_loop_restart<uint16_t, uint16_t>(src16))) << "count:" << count;
+		ASSERT_EQ(dst32, (ref_line_loop_restart<uint32_t, uint32_t>(src32))) << "count:" << count;
+	}
+}
+
+TEST(IndexConversion, ScanRangeMatchesReference)
+{
+	for (size_t count = 0; count <= c_max_count; count++) {
+		for (int restart = 0; restart < 2; restart++) {
+			std::vector<uint8_t> src8 = make_indices<uint8_t>(count, 13000 + static_cast<uint32_t>(count), restart != 0);
+			std::vector<uint16_t> src16 = make_indices<uint16_t>(count, 14000 + static_cast<uint32_t>(count), restart != 0);
+			std::vector<uint32_t> src32 = make_indices<uint32_t>(count, 15000 + static_cast<uint32_t>(count), restart != 0);
+			uint32_t min_index, max_index, ref_min, ref_max;
+			scanIndexRangeU8(src8.data(), count, restart != 0, &min_index, &max_index);
+			ref_scan(src8, restart != 0, &ref_min, &ref_max);
+			ASSERT_EQ(min_index, ref_min) << "count:" << count;
+			ASSERT_EQ(max_index, ref_max) << "count:" << count;
+			scanIndexRangeU16(src16.data(), count, restart != 0, &min_index, &max_index);
+			ref_scan(src16, restart != 0, &ref_min, &ref_max);
+			ASSERT_EQ(min_index, ref_min) << "count:" << count;
+			ASSERT_EQ(max_index, ref_max) << "count:" << count;
+			scanIndexRangeU32(src32.data(), count, restart != 0, &min_index, &max_index);
+			ref_scan(src32, restart != 0, &ref_min, &ref_max);
+			ASSERT_EQ(min_index, ref_min) << "count:" << count;
+			ASSERT_EQ(max_index, ref_max) << "count:" << count;
+		}
+	}
+}
+
+TEST(IndexConversion, ScanRangeOnlyRestartIndices)
+{
+	// リスタートインデックスのみの場合は有効なインデックスがない
+	std::vector<uint16_t> src(40, UINT16_MAX);
+	uint32_t min_index, max_index;
+	scanIndexRangeU16(src.data(), src.size(), true, &min_index, &max_index);
+	EXPECT_GT(min_index, max_index);
+	// リスタートが無効な場合は通常の値として扱う
+	scanIndexRangeU16(src.data(), src.size(), false, &min_index, &max_index);
+	EXPECT_EQ(min_index, UINT16_MAX);
+	EXPECT_EQ(max_index, UINT16_MAX);
+}
@@ -0,0 +1,570 @@
+// KtxLoaderTest.cpp
+// KTX、KTX2ファイルのヘッダの検証を、正しいファイルと、それを壊したファイルの一覧(切り詰め、フィールドの改変)で確認する
+// NOTE: ファイルは必要なサイズだけ確保したバッファに置き、範囲外の読み出しをAddressSanitizerで検出する
+#include "common/KtxLoader.h"
+#include "common/MappedFile.h"
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+const uint8_t c_ktx1_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+const uint8_t c_ktx2_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// KTX(バージョン1)のヘッダのフィールドのオフセット
+enum Ktx1Field : size_t {
+	Ktx1Endianness = 12,
+	Ktx1GlType = 16,
+	Ktx1GlTypeSize = 20,
+	Ktx1GlFormat = 24,
+	Ktx1GlInternalFormat = 28,
+	Ktx1PixelWidth = 36,
+	Ktx1PixelHeight = 40,
+	Ktx1PixelDepth = 44,
+	Ktx1ArrayElements = 48,
+	Ktx1Faces = 52,
+	Ktx1Levels = 56,
+	Ktx1KeyValueBytes = 60,
+	Ktx1HeaderSize = 64
+};
+
+// KTX2のヘッダのフィールドのオフセット
+enum Ktx2Field : size_t {
+	Ktx2VkFormat = 12,
+	Ktx2PixelWidth = 20,
+	Ktx2PixelHeight = 24,
+	Ktx2PixelDepth = 28,
+	Ktx2Layers = 32,
+	Ktx2Faces = 36,
+	Ktx2Levels = 40,
+	Ktx2Supercompression = 44,
+	Ktx2HeaderSize = 80,
+	Ktx2LevelIndexSize = 24
+};
+
+// テストで使用するファイルの構成
+struct KtxDesc {
+	uint32_t width = 8;
+	uint32_t height = 4;
+	uint32_t depth = 0;
+	uint32_t layers = 0;
+	uint32_t faces = 1;
+	uint32_t levels = 4;
+	// 非圧縮は1ピクセルのバイト数、圧縮(ETC2 RGB8)は0
+	uint32_t pixelSize = 4;
+};
+
+void store_u32(std::vector<uint8_t>* bytes, size_t offset, uint32_t value)
+{
+	memcpy(bytes->data() + offset, &value, sizeof(value));
+}
+
+void store_u64(std::vector<uint8_t>* bytes, size_t offset, uint64_t value)
+{
+	memcpy(bytes->data() + offset, &value, sizeof(value));
+}
+
+uint32_t load_u32(const std::vector<uint8_t>& bytes, size_t offset)
+{
+	uint32_t value;
+	memcpy(&value, bytes.data() + offset, sizeof(value));
+	return value;
+}
+
+// 1つのミップレベルの1つの面のイメージのサイズ(行のアライメントを指定)
+size_t image_size(const KtxDesc& desc, uint32_t level, size_t alignment)
+{
+	size_t width = std::max(desc.width >> level, 1u);
+	size_t height = std::max(std::max(desc.height, 1u) >> level, 1u);
+	size_t depth = (desc.depth != 0) ? std::max(desc.depth >> level, 1u) : std::max(desc.layers, 1u);
+	if (desc.pixelSize == 0) {
+		return ((width + 3) / 4) * ((height + 3) / 4) * 8 * depth;
+	}
+	size_t bytes_per_row = (width * desc.pixelSize + alignment - 1) / alignment * alignment;
+	return bytes_per_row * height * depth;
+}
+
+uint8_t pattern_byte(size_t offset)
+{
+	return static_cast<uint8_t>((offset * 31) + 7);
+}
+
+// KTX(バージョン1)ファイルを作成する(RGBA8、RG8またはETC2 RGB8)
+std::vector<uint8_t> make_ktx1(const KtxDesc& desc, uint32_t keyValueBytes = 0)
+{
+	std::vector<uint8_t> bytes(Ktx1HeaderSize + keyValueBytes, 0);
+	memcpy(bytes.data(), c_ktx1_identifier, sizeof(c_ktx1_identifier));
+	store_u32(&bytes, Ktx1Endianness, 0x04030201);
+	if (desc.pixelSize == 0) {
+		store_u32(&bytes, Ktx1GlInternalFormat, GL_COMPRESSED_RGB8_ETC2);
+	} else {
+		store_u32(&bytes, Ktx1GlType, GL_UNSIGNED_BYTE);
+		store_u32(&bytes, Ktx1GlTypeSize, 1);
+		store_u32(&bytes, Ktx1GlFormat, (desc.pixelSize == 4) ? GL_RGBA : GL_RG);
+		store_u32(&bytes, Ktx1GlInternalFormat, (desc.pixelSize == 4) ? GL_RGBA8 : GL_RG8);
+	}
+	store_u32(&bytes, Ktx1PixelWidth, desc.width);
+	store_u32(&bytes, Ktx1PixelHeight, desc.height);
+	store_u32(&bytes, Ktx1PixelDepth, desc.depth);
+	store_u32(&bytes, Ktx1ArrayElements, desc.layers);
+	store_u32(&bytes, Ktx1Faces, desc.faces);
+	store_u32(&bytes, Ktx1Levels, desc.levels);
+	store_u32(&bytes, Ktx1KeyValueBytes, keyValueBytes);
+	for (uint32_t level = 0; level < std::max(desc.levels, 1u); level++) {
+		size_t size = image_size(desc, level, 4);
+		size_t offset = bytes.size();
+		bytes.resize(offset + sizeof(uint32_t));
+		store_u32(&bytes, offset, static_cast<uint32_t>(size));
+		for (uint32_t face = 0; face < desc.faces; face++) {
+			offset = bytes.size();
+			bytes.resize(offset + ((size + 3) & ~static_cast<size_t>(3)), 0);
+			for (size_t i = 0; i < size; i++) {
+				bytes[offset + i] = pattern_byte(offset + i);
+			}
+		}
+	}
+	return bytes;
+}
+
+// KTX2ファイルを作成する(VK_FORMAT_R8G8B8A8_UNORMまたはVK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK)
+// NOTE: 仕様と同じく、小さいミップレベルからファイルに格納する
+std::vector<uint8_t> make_ktx2(const KtxDesc& desc)
+{
+	uint32_t levels = std::max(desc.levels, 1u);
+	std::vector<uint8_t> bytes(Ktx2HeaderSize + (levels * Ktx2LevelIndexSize), 0);
+	memcpy(bytes.data(), c_ktx2_identifier, sizeof(c_ktx2_identifier));
+	store_u32(&bytes, Ktx2VkFormat, (desc.pixelSize == 0) ? 147 : 37);
+	store_u32(&bytes, Ktx2PixelWidth, desc.width);
+	store_u32(&bytes, Ktx2PixelHeight, desc.height);
+	store_u32(&bytes, Ktx2PixelDepth, desc.depth);
+	store_u32(&bytes, Ktx2Layers, desc.layers);
+	store_u32(&bytes, Ktx2Faces, desc.faces);
+	store_u32(&bytes, Ktx2Levels, desc.levels);
+	for (uint32_t i = 0; i < levels; i++) {
+		uint32_t level = levels - 1 - i;
+		size_t length = image_size(desc, level, 1) * desc.faces;
+		size_t offset = bytes.size();
+		bytes.resize(offset + length);
+		for (size_t j = 0; j < length; j++) {
+			bytes[offset + j] = pattern_byte(offset + j);
+		}
+		size_t index = Ktx2HeaderSize + (level * Ktx2LevelIndexSize);
+		store_u64(&bytes, index, offset);
+		store_u64(&bytes, index + 8, length);
+		store_u64(&bytes, index + 16, length);
+	}
+	return bytes;
+}
+
+// ファイルのサイズだけ確保したバッファ(解析したイメージはこのバッファを指す)
+class ExactFile
+{
+public:
+	explicit ExactFile(const std::vector<uint8_t>& bytes)
+		: ExactFile(bytes, bytes.size())
+	{
+	}
+	ExactFile(const std::vector<uint8_t>& bytes, size_t size)
+		: m_data(new uint8_t[std::max(size, static_cast<size_t>(1))])
+		, m_size(size)
+	{
+		memcpy(m_data.get(), bytes.data(), size);
+	}
+	bool parse(KtxTexture* texture) const
+	{
+		bool result = parseKtxTexture(m_data.get(), m_size, texture);
+		if (result) {
+			// 全てのイメージがファイルの範囲内を指していること
+			for (uint32_t level = 0; level < texture->levels; level++) {
+				for (uint32_t face = 0; face < texture->faces; face++) {
+					const KtxImage& image = texture->images[level][face];
+					EXPECT_GE(image.data, m_data.get());
+					EXPECT_LE(image.size, m_size - static_cast<size_t>(image.data - m_data.get()));
+				}
+			}
+		}
+		return result;
+	}
+	// イメージの内容が作成した時のパターンと一致するか
+	void expectPattern(const KtxImage& image, size_t size) const
+	{
+		ASSERT_EQ(image.size, size);
+		size_t offset = static_cast<size_t>(image.data - m_data.get());
+		for (size_t i = 0; i < size; i++) {
+			if (image.data[i] != pattern_byte(offset + i)) {
+				ADD_FAILURE() << "mismatch at " << (offset + i);
+				return;
+			}
+		}
+	}
+
+private:
+	std::unique_ptr<uint8_t[]> m_data;
+	size_t m_size;
+};
+
+bool parse(const std::vector<uint8_t>& bytes, KtxTexture* texture)
+{
+	return ExactFile(bytes).parse(texture);
+}
+
+// 壊したファイルの一覧(正しいファイルを改変する)
+struct Corruption {
+	const char* name;
+	std::function<void(std::vector<uint8_t>*)> apply;
+};
+
+std::vector<Corruption> ktx1_corruptions()
+{
+	return {
+		{ "Identifier", [](std::vector<uint8_t>* b) { (*b)[5] = '2'; } },
+		{ "Endianness", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1Endianness, 0x01020403); } },
+		{ "ZeroWidth", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1PixelWidth, 0); } },
+		{ "HugeWidth", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1PixelWidth, 0x80000000u); } },
+		{ "HugeHeight", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1PixelHeight, 0xFFFFFFFFu); } },
+		{ "HugeDepth", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1PixelDepth, 0x10000u); } },
+		{ "HugeLayers", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1ArrayElements, 0xFFFFFFFFu); } },
+		{ "TwoFaces", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1Faces, 2); } },
+		{ "ZeroFaces", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1Faces, 0); } },
+		{ "NonSquareCube", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1Faces, 6); } },
+		{ "DepthAndLayers", [](std::vector<uint8_t>* b) {
+			store_u32(b, Ktx1PixelDepth, 2);
+			store_u32(b, Ktx1ArrayElements, 2);
+		} },
+		{ "TooManyLevels", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1Levels, 5); } },
+		{ "HugeLevels", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1Levels, 0xFFFFFFFFu); } },
+		{ "KeyValueOverflow", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1KeyValueBytes, 0xFFFFFFFCu); } },
+		{ "KeyValuePastEnd", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1KeyValueBytes, static_cast<uint32_t>(b->size())); } },
+		{ "ImageSizeMismatch", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1HeaderSize, load_u32(*b, Ktx1HeaderSize) + 4); } },
+		{ "ImageSizeHuge", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1HeaderSize, 0xFFFFFFFFu); } },
+		{ "UnknownType", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1GlType, 0x1234); } },
+		{ "UnknownFormat", [](std::vector<uint8_t>* b) { store_u32(b, Ktx1GlFormat, 0x1234); } },
+		{ "UnknownCompressedFormat", [](std::vector<uint8_t>* b) {
+			store_u32(b, Ktx1GlType, 0);
+			store_u32(b, Ktx1GlFormat, 0);
+			store_u32(b, Ktx1GlInternalFormat, 0x1234);
+		} },
+		{ "SwappedMultiByteType", [](std::vector<uint8_t>* b) {
+			// NOTE: バイトスワップが必要な2バイト以上の要素には対応していない
+			store_u32(b, Ktx1Endianness, 0x01020304);
+			store_u32(b, Ktx1GlTypeSize, 0x02000000);
+		} },
+		{ "Truncated", [](std::vector<uint8_t>* b) { b->resize(b->size() - 4); } },
+	};
+}
+
+std::vector<Corruption> ktx2_corruptions()
+{
+	return {
+		{ "Identifier", [](std::vector<uint8_t>* b) { (*b)[11] = 0; } },
+		{ "Supercompression", [](std::vector<uint8_t>* b) { store_u32(b, Ktx2Supercompression, 2); } },
+		{ "UnknownVkFormat", [](std::vector<uint8_t>* b) { store_u32(b, Ktx2VkFormat, 0); } },
+		{ "ZeroWidth", [](std::vector<uint8_t>* b) { store_u32(b, Ktx2PixelWidth, 0); } },
+		{ "HugeWidth", [](std::vector<uint8_t>* b) { store_u32(b, Ktx2PixelWidth, 0xFFFFFFFFu); } },
+		{ "SixFacesNonSquare", [](std::vector<uint8_t>* b) { store_u32(b, Ktx2Faces, 6); } },
+		{ "TooManyLevels", [](std::vector<uint8_t>* b) { store_u32(b, Ktx2Levels, 5); } },
+		{ "HugeLevels", [](std::vector<uint8_t>* b) { store_u32(b, Ktx2Levels, 0xFFFFFFFFu); } },
+		{ "ByteOffsetPastEnd", [](std::vector<uint8_t>* b) { store_u64(b, Ktx2HeaderSize, b->size() + 1); } },
+		{ "ByteOffsetOverflow", [](std::vector<uint8_t>* b) { store_u64(b, Ktx2HeaderSize, UINT64_MAX - 8); } },
+		{ "ByteLengthOverflow", [](std::vector<uint8_t>* b) { store_u64(b, Ktx2HeaderSize + 8, UINT64_MAX); } },
+		{ "ByteLengthMismatch", [](std::vector<uint8_t>* b) {
+			uint64_t length;
+			memcpy(&length, b->data() + Ktx2HeaderSize + 8, sizeof(length));
+			store_u64(b, Ktx2HeaderSize + 8, length - 1);
+		} },
+		{ "LevelIndexPastEnd", [](std::vector<uint8_t>* b) { b->resize(Ktx2HeaderSize + Ktx2LevelIndexSize); } },
+		{ "Truncated", [](std::vector<uint8_t>* b) { b->resize(b->size() - 1); } },
+	};
+}
+
+// テスト用の一時ファイル
+class TempFile
+{
+public:
+	explicit TempFile(const char* name)
+		: m_path(testing::TempDir() + name)
+	{
+	}
+	~TempFile()
+	{
+		std::remove(m_path.c_str());
+	}
+	bool write(const std::vector<uint8_t>& bytes)
+	{
+		std::FILE* fp = std::fopen(m_path.c_str(), "wb");
+		if (fp == nullptr) {
+			return false;
+		}
+		bool result = (std::fwrite(bytes.data(), 1, bytes.size(), fp) == bytes.size());
+		return (std::fclose(fp) == 0) && result;
+	}
+	const char* path() const
+	{
+		return m_path.c_str();
+	}
+
+private:
+	std::string m_path;
+};
+
+} // namespace
+
+TEST(KtxLoader, Ktx1Texture2D)
+{
+	KtxDesc desc;
+	ExactFile file(make_ktx1(desc, 16));
+	KtxTexture texture;
+	ASSERT_TRUE(file.parse(&texture));
+	EXPECT_EQ(texture.target, static_cast<GLenum>(GL_TEXTURE_2D));
+	EXPECT_EQ(texture.internalformat, static_cast<GLenum>(GL_RGBA8));
+	EXPECT_EQ(texture.format, static_cast<GLenum>(GL_RGBA));
+	EXPECT_EQ(texture.type, static_cast<GLenum>(GL_UNSIGNED_BYTE));
+	EXPECT_FALSE(texture.compressed);
+	EXPECT_FALSE(texture.generateMipmap);
+	EXPECT_EQ(texture.width, 8u);
+	EXPECT_EQ(texture.height, 4u);
+	EXPECT_EQ(texture.depth, 1u);
+	EXPECT_EQ(texture.faces, 1u);
+	EXPECT_EQ(texture.levels, 4u);
+	EXPECT_EQ(texture.alignment, 4);
+	for (uint32_t level = 0; level < 4; level++) {
+		file.expectPattern(texture.images[level][0], image_size(desc, level, 4));
+	}
+}
+
+// KTXの非圧縮イメージの行は4バイト境界に揃えられる
+TEST(KtxLoader, Ktx1RowAlignment)
+{
+	KtxDesc desc;
+	desc.width = 3;
+	desc.height = 3;
+	desc.levels = 2;
+	desc.pixelSize = 2;
+	KtxTexture texture;
+	ASSERT_TRUE(parse(make_ktx1(desc), &texture));
+	EXPECT_EQ(texture.images[0][0].size, 8u * 3u);
+	EXPECT_EQ(texture.images[1][0].size, 4u);
+}
+
+TEST(KtxLoader, Ktx1CubeArray3D)
+{
+	KtxDesc cube;
+	cube.width = 4;
+	cube.height = 4;
+	cube.faces = 6;
+	cube.levels = 3;
+	ExactFile file(make_ktx1(cube));
+	KtxTexture texture;
+	ASSERT_TRUE(file.parse(&texture));
+	EXPECT_EQ(texture.target, static_cast<GLenum>(GL_TEXTURE_CUBE_MAP));
+	EXPECT_EQ(texture.faces, 6u);
+	for (uint32_t level = 0; level < 3; level++) {
+		for (uint32_t face = 0; face < 6; face++) {
+			file.expectPattern(texture.images[level][face], image_size(cube, level, 4));
+		}
+	}
+	KtxDesc array;
+	array.layers = 3;
+	ASSERT_TRUE(parse(make_ktx1(array), &texture));
+	EXPECT_EQ(texture.target, static_cast<GLenum>(GL_TEXTURE_2D_ARRAY));
+	EXPECT_EQ(texture.depth, 3u);
+	EXPECT_EQ(texture.images[3][0].size, 4u * 3u);
+	// 3Dテクスチャは奥行きもミップレベル毎に縮小する
+	KtxDesc volume;
+	volume.width = 2;
+	volume.height = 2;
+	volume.depth = 8;
+	ASSERT_TRUE(parse(make_ktx1(volume), &texture));
+	EXPECT_EQ(texture.target, static_cast<GLenum>(GL_TEXTURE_3D));
+	EXPECT_EQ(texture.depth, 8u);
+	EXPECT_EQ(texture.levels, 4u);
+	EXPECT_EQ(texture.images[3][0].size, 4u);
+}
+
+// ミップレベル数0はレベル0のみで、ミップマップの生成が必要
+TEST(KtxLoader, Ktx1GenerateMipmap)
+{
+	KtxDesc desc;
+	desc.levels = 0;
+	KtxTexture texture;
+	ASSERT_TRUE(parse(make_ktx1(desc), &texture));
+	EXPECT_TRUE(texture.generateMipmap);
+	EXPECT_EQ(texture.levels, 1u);
+}
+
+// ビッグエンディアンのファイル(1バイトの要素のみ)
+TEST(KtxLoader, Ktx1Swapped)
+{
+	KtxDesc desc;
+	std::vector<uint8_t> bytes = make_ktx1(desc);
+	auto swap_u32 = [&](size_t offset) {
+		std::reverse(bytes.begin() + static_cast<std::ptrdiff_t>(offset), bytes.begin() + static_cast<std::ptrdiff_t>(offset + 4));
+	};
+	for (size_t offset = Ktx1Endianness; offset < Ktx1HeaderSize; offset += 4) {
+		swap_u32(offset);
+	}
+	size_t offset = Ktx1HeaderSize;
+	for (uint32_t level = 0; level < desc.levels; level++) {
+		size_t size = load_u32(bytes, offset);
+		swap_u32(offset);
+		offset += sizeof(uint32_t) + size;
+	}
+	ExactFile file(bytes);
+	KtxTexture texture;
+	ASSERT_TRUE(file.parse(&texture));
+	EXPECT_EQ(texture.width, 8u);
+	EXPECT_EQ(texture.levels, 4u);
+	file.expectPattern(texture.images[3][0], image_size(desc, 3, 4));
+}
+
+TEST(KtxLoader, Ktx2Texture)
+{
+	KtxDesc desc;
+	ExactFile file(make_ktx2(desc));
+	KtxTexture texture;
+	ASSERT_TRUE(file.parse(&texture));
+	EXPECT_EQ(texture.target, static_cast<GLenum>(GL_TEXTURE_2D));
+	EXPECT_EQ(texture.internalformat, static_cast<GLenum>(GL_RGBA8));
+	EXPECT_EQ(texture.alignment, 1);
+	for (uint32_t level = 0; level < 4; level++) {
+		file.expectPattern(texture.images[level][0], image_size(desc, level, 1));
+	}
+	// 圧縮フォーマットのキューブマップ
+	KtxDesc cube;
+	cube.width = 8;
+	cube.height = 8;
+	cube.faces = 6;
+	cube.pixelSize = 0;
+	ExactFile cube_file(make_ktx2(cube));
+	ASSERT_TRUE(cube_file.parse(&texture));
+	EXPECT_EQ(texture.target, static_cast<GLenum>(GL_TEXTURE_CUBE_MAP));
+	EXPECT_EQ(texture.internalformat, static_cast<GLenum>(GL_COMPRESSED_RGB8_ETC2));
+	EXPECT_TRUE(texture.compressed);
+	for (uint32_t level = 0; level < 4; level++) {
+		for (uint32_t face = 0; face < 6; face++) {
+			cube_file.expectPattern(texture.images[level][face], image_size(cube, level, 1));
+		}
+	}
+}
+
+// 壊したファイルは全て失敗する
+TEST(KtxLoader, MalformedCorpus)
+{
+	KtxDesc desc;
+	const std::vector<uint8_t> ktx1 = make_ktx1(desc);
+	const std::vector<uint8_t> ktx2 = make_ktx2(desc);
+	KtxTexture texture;
+	ASSERT_TRUE(parse(ktx1, &texture));
+	ASSERT_TRUE(parse(ktx2, &texture));
+	for (const Corruption& corruption : ktx1_corruptions()) {
+		std::vector<uint8_t> bytes = ktx1;
+		corruption.apply(&bytes);
+		EXPECT_FALSE(parse(bytes, &texture)) << "KTX1 " << corruption.name;
+	}
+	for (const Corruption& corruption : ktx2_corruptions()) {
+		std::vector<uint8_t> bytes = ktx2;
+		corruption.apply(&bytes);
+		EXPECT_FALSE(parse(bytes, &texture)) << "KTX2 " << corruption.name;
+	}
+	EXPECT_FALSE(parseKtxTexture(nullptr, 64, &texture));
+}
+
+// 途中で切り詰めたファイルは全て失敗する
+TEST(KtxLoader, TruncatedFiles)
+{
+	KtxDesc desc;
+	desc.width = 4;
+	desc.height = 4;
+	desc.faces = 6;
+	desc.levels = 3;
+	const std::vector<uint8_t> files[] = { make_ktx1(desc, 8), make_ktx2(desc) };
+	for (const std::vector<uint8_t>& bytes : files) {
+		KtxTexture texture;
+		ASSERT_TRUE(parse(bytes, &texture));
+		for (size_t size = 0; size < bytes.size(); size++) {
+			EXPECT_FALSE(ExactFile(bytes, size).parse(&texture)) << "size " << size;
+		}
+	}
+}
+
+// ヘッダとレベルインデックスの値をランダムに書き換えても、範囲外を参照しない
+TEST(KtxLoader, RandomHeaderMutation)
+{
+	KtxDesc desc;
+	desc.layers = 2;
+	const std::vector<uint8_t> files[] = { make_ktx1(desc), make_ktx2(desc) };
+	std::mt19937 rng(1);
+	for (const std::vector<uint8_t>& file : files) {
+		const size_t header_size = (file[5] == '1') ? (Ktx1HeaderSize + 4) : (Ktx2HeaderSize + (desc.levels * Ktx2LevelIndexSize));
+		for (int i = 0; i < 2000; i++) {
+			std::vector<uint8_t> bytes = file;
+			int count = 1 + static_cast<int>(rng() % 4);
+			for (int j = 0; j < count; j++) {
+				size_t offset = 12 + (rng() % (header_size - 12));
+				switch (rng() % 3) {
+				case 0:
+					bytes[offset] ^= static_cast<uint8_t>(1u << (rng() % 8));
+					break;
+				case 1:
+					bytes[offset] = 0xFF;
+					break;
+				default:
+					bytes[offset] = 0;
+					break;
+				}
+			}
+			KtxTexture texture;
+			if (parse(bytes, &texture)) {
+				EXPECT_LE(texture.levels, c_ktx_max_levels);
+				EXPECT_TRUE((texture.faces == 1) || (texture.faces == 6));
+			}
+		}
+	}
+}
+
+TEST(MappedFile, OpenAndClose)
+{
+	KtxDesc desc;
+	const std::vector<uint8_t> bytes = make_ktx2(desc);
+	TempFile temp("axgl_mapped_file_test.ktx2");
+	ASSERT_TRUE(temp.write(bytes));
+	MappedFile file;
+	ASSERT_TRUE(file.open(temp.path()));
+	ASSERT_EQ(file.getSize(), bytes.size());
+	EXPECT_EQ(memcmp(file.getData(), bytes.data(), bytes.size()), 0);
+	KtxTexture texture;
+	EXPECT_TRUE(parseKtxTexture(file.getData(), file.getSize(), &texture));
+	// 開き直し
+	ASSERT_TRUE(file.open(temp.path()));
+	EXPECT_EQ(file.getSize(), bytes.size());
+	file.close();
+	EXPECT_EQ(file.getData(), nullptr);
+	EXPECT_EQ(file.getSize(), 0u);
+}
+
+// 存在しないファイル、空のファイルは開けない(前にマップしたファイルは閉じる)
+TEST(MappedFile, InvalidFiles)
+{
+	TempFile valid("axgl_mapped_file_valid.bin");
+	TempFile empty("axgl_mapped_file_empty.bin");
+	ASSERT_TRUE(valid.write(std::vector<uint8_t>(16, 1)));
+	ASSERT_TRUE(empty.write(std::vector<uint8_t>()));
+	MappedFile file;
+	ASSERT_TRUE(file.open(valid.path()));
+	EXPECT_FALSE(file.open(empty.path()));
+	EXPECT_EQ(file.getData(), nullptr);
+	EXPECT_EQ(file.getSize(), 0u);
+	EXPECT_FALSE(file.open((std::string(valid.path()) + ".missing").c_str()));
+	EXPECT_FALSE(file.open(nullptr));
+	EXPECT_FALSE(file.open(testing::TempDir().c_str()));
+	EXPECT_EQ(file.getData(), nullptr);
+}
@@ -0,0 +1,79 @@
+// MemoryAccountingTest.cpp
+// 分類毎の使用量の集計と予算のコールバック、テクスチャ転送のステージングメモリの集計を確認する
+#include "common/MemoryAccounting.h"
+#include "common/TextureUploadQueue.h"
+
+#include <gtest/gtest.h>
+
+using namespace axgl;
+
+namespace {
+
+struct CallbackRecord {
+	int count = 0;
+	size_t totalSize = 0;
+};
+
+void budget_callback(size_t totalSize, size_t budget, void* userData)
+{
+	AXGL_UNUSED(budget);
+	CallbackRecord* record = static_cast<CallbackRecord*>(userData);
+	record->count++;
+	record->totalSize = totalSize;
+}
+
+class NopTask : public TextureUploadTask
+{
+public:
+	virtual void execute() override
+	{
+	}
+};
+
+} // namespace
+
+TEST(MemoryAccounting, CategorySizeAndBudget)
+{
+	MemoryAccounting& accounting = MemoryAccounting::getInstance();
+	const size_t base_total = accounting.getTotalSize();
+	const size_t base_pool = accounting.getCategorySize(MemoryCategoryPool);
+	CallbackRecord record;
+	accounting.setBudget(base_total + 100, budget_callback, &record);
+	accounting.update(MemoryCategoryPool, 0, 60);
+	accounting.update(MemoryCategoryShadowBuffer, 0, 30);
+	EXPECT_EQ(accounting.getCategorySize(MemoryCategoryPool), base_pool + 60);
+	EXPECT_EQ(axglGetMemorySize(AXGL_MEMORY_POOL), base_pool + 60);
+	EXPECT_EQ(record.count, 0);
+	// 予算を超えた時のみ通知し、超えている間の増加では通知しない
+	accounting.update(MemoryCategoryStaging, 0, 20);
+	EXPECT_EQ(record.count, 1);
+	EXPECT_EQ(record.totalSize, base_total + 110);
+	accounting.update(MemoryCategoryStaging, 20, 40);
+	EXPECT_EQ(record.count, 1);
+	// 下回った後に再び超えた場合は通知
+	accounting.update(MemoryCategoryStaging, 40, 0);
+	accounting.update(MemoryCategoryStaging, 0, 40);
+	EXPECT_EQ(record.count, 2);
+	accounting.setBudget(SIZE_MAX, nullptr, nullptr);
+	accounting.update(MemoryCategoryStaging, 40, 0);
+	accounting.update(MemoryCategoryShadowBuffer, 30, 0);
+	accounting.update(MemoryCategoryPool, 60, 0);
+	EXPECT_EQ(accounting.getTotalSize(), base_total);
+}
+
+// ステージングメモリは確保から解放(プールからの解放を含む)まで集計する
+TEST(MemoryAccounting, TextureUploadStaging)
+{
+	MemoryAccounting& accounting = MemoryAccounting::getInstance();
+	TextureUploadQueue& queue = TextureUploadQueue::getInstance();
+	queue.setEnabled(false);
+	const size_t base_staging = accounting.getCategorySize(MemoryCategoryStaging);
+	NopTask* task = queue.createTask<NopTask>(4096);
+	ASSERT_NE(task, nullptr);
+	EXPECT_EQ(accounting.getCategorySize(MemoryCategoryStaging), base_staging + 4096);
+	// 無効な場合は登録されずに破棄され、ステージングメモリはプールに戻る
+	EXPECT_EQ(queue.enqueue(task, 4096), 0u);
+	EXPECT_EQ(accounting.getCategorySize(MemoryCategoryStaging), base_staging + 4096);
+	queue.setEnabled(false);
+	EXPECT_EQ(accounting.getCategorySize(MemoryCategoryStaging), base_staging);
+}
@@ -0,0 +1,232 @@
+// MipmapGenerationTest.cpp
+// CPUでのミップマップ生成(SIMDと並列化)を、ピクセル毎のボックスフィルタの参照実装と比較する
+#include "common/MipmapGeneration.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+uint32_t channel_count(MipmapPixelFormat format)
+{
+	switch (format) {
+	case MipmapPixelFormatR8:
+	case MipmapPixelFormatR32F:
+		return 1;
+	case MipmapPixelFormatRG8:
+	case MipmapPixelFormatRG32F:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+bool is_float(MipmapPixelFormat format)
+{
+	return (format == MipmapPixelFormatR32F) || (format == MipmapPixelFormatRG32F) || (format == MipmapPixelFormatRGBA32F);
+}
+
+double srgb_to_linear(double value)
+{
+	return (value <= 0.04045) ? (value / 12.92) : std::pow((value + 0.055) / 1.055, 2.4);
+}
+
+double linear_to_srgb(double value)
+{
+	return (value <= 0.0031308) ? (value * 12.92) : ((1.055 * std::pow(value, 1.0 / 2.4)) - 0.055);
+}
+
+// ピクセル毎のボックスフィルタ(2x2x2、奥行き1は2x2)で1つ下のレベルを生成する参照実装
+std::vector<uint8_t> reference_level(MipmapPixelFormat format, const std::vector<uint8_t>& src,
+	uint32_t width, uint32_t height, uint32_t depth, bool volume)
+{
+	const uint32_t channels = channel_count(format);
+	const uint32_t dst_width = std::max(1u, width / 2);
+	const uint32_t dst_height = std::max(1u, height / 2);
+	const uint32_t dst_depth = volume ? std::max(1u, depth / 2) : depth;
+	const size_t pixel_size = getMipmapPixelSize(format);
+	std::vector<uint8_t> dst(pixel_size * dst_width * dst_height * dst_depth);
+	for (uint32_t z = 0; z < dst_depth; z++) {
+		uint32_t zs[2] = { volume ? std::min(z * 2, depth - 1) : z, volume ? std::min(z * 2 + 1, depth - 1) : z };
+		for (uint32_t y = 0; y < dst_height; y++) {
+			uint32_t ys[2] = { std::min(y * 2, height - 1), std::min(y * 2 + 1, height - 1) };
+			for (uint32_t x = 0; x < dst_width; x++) {
+				uint32_t xs[2] = { std::min(x * 2, width - 1), std::min(x * 2 + 1, width - 1) };
+				for (uint32_t c = 0; c < channels; c++) {
+					double sum = 0.0;
+					for (uint32_t i = 0; i < 8; i++) {
+						size_t index = ((((size_t)zs[i >> 2] * height + ys[(i >> 1) & 1]) * width) + xs[i & 1]) * channels + c;
+						if (is_float(format)) {
+							sum += reinterpret_cast<const float*>(src.data())[index];
+						} else if ((format == MipmapPixelFormatSRGB8A8) && (c < 3)) {
+							sum += srgb_to_linear(src[index] / 255.0);
+						} else {
+							sum += src[index];
+						}
+					}
+					double average = sum / 8.0;
+					size_t dst_index = ((((size_t)z * dst_height + y) * dst_width) + x) * channels + c;
+					if (is_float(format)) {
+						reinterpret_cast<float*>(dst.data())[dst_index] = static_cast<float>(average);
+					} else if ((format == MipmapPixelFormatSRGB8A8) && (c < 3)) {
+						dst[dst_index] = static_cast<uint8_t>(std::lround(linear_to_srgb(average) * 255.0));
+					} else {
+						// NOTE: 8bitは0.5を切り上げる
+						dst[dst_index] = static_cast<uint8_t>(std::floor(average + 0.5));
+					}
+				}
+			}
+		}
+	}
+	return dst;
+}
+
+std::vector<uint8_t> make_pixels(MipmapPixelFormat format, size_t count)
+{
+	std::mt19937 rng(7);
+	std::vector<uint8_t> pixels(getMipmapPixelSize(format) * count + 1);
+	if (is_float(format)) {
+		std::uniform_real_distribution<float> dist(-4.0f, 4.0f);
+		for (size_t i = 0; i < count * channel_count(format); i++) {
+			reinterpret_cast<float*>(pixels.data())[i] = dist(rng);
+		}
+	} else {
+		for (uint8_t& value : pixels) {
+			value = static_cast<uint8_t>(rng());
+		}
+	}
+	return pixels;
+}
+
+// 8bitは完全に一致、sRGBは線形での丸めの差(1)まで、floatは加算順の差まで許容する
+void expect_level_near(MipmapPixelFormat format, const uint8_t* actual, const std::vector<uint8_t>& expected, size_t pixelCount)
+{
+	const size_t count = pixelCount * channel_count(format);
+	for (size_t i = 0; i < count; i++) {
+		if (is_float(format)) {
+			float e = reinterpret_cast<const float*>(expected.data())[i];
+			float a = reinterpret_cast<const float*>(actual)[i];
+			ASSERT_NEAR(a, e, 1e-5f) << "index " << i;
+		} else if (format == MipmapPixelFormatSRGB8A8) {
+			ASSERT_LE(std::abs(actual[i] - expected[i]), 1) << "index " << i;
+		} else {
+			ASSERT_EQ(actual[i], expected[i]) << "index " << i;
+		}
+	}
+}
+
+struct LevelSize {
+	uint32_t width;
+	uint32_t height;
+	uint32_t depth;
+};
+
+const MipmapPixelFormat c_formats[] = {
+	MipmapPixelFormatR8, MipmapPixelFormatRG8, MipmapPixelFormatRGBA8, MipmapPixelFormatSRGB8A8,
+	MipmapPixelFormatR32F, MipmapPixelFormatRG32F, MipmapPixelFormatRGBA32F
+};
+
+} // namespace
+
+// 奇数サイズ、幅または高さが1のレベルを含む2Dの1レベル
+TEST(MipmapGeneration, Level2D)
+{
+	const LevelSize sizes[] = { { 64, 32, 1 }, { 37, 21, 1 }, { 1, 9, 1 }, { 17, 1, 1 }, { 1, 1, 1 } };
+	for (MipmapPixelFormat format : c_formats) {
+		for (const LevelSize& size : sizes) {
+			SCOPED_TRACE(testing::Message() << "format " << format << " size " << size.width << "x" << size.height);
+			std::vector<uint8_t> src = make_pixels(format, (size_t)size.width * size.height);
+			std::vector<uint8_t> expected = reference_level(format, src, size.width, size.height, 1, false);
+			const uint32_t dst_width = std::max(1u, size.width / 2);
+			const uint32_t dst_height = std::max(1u, size.height / 2);
+			const size_t pixel_size = getMipmapPixelSize(format);
+			std::vector<uint8_t> dst(pixel_size * dst_width * dst_height);
+			generateMipmapLevel(format, src.data(), pixel_size * size.width, size.width, size.height, dst.data(), pixel_size * dst_width);
+			expect_level_near(format, dst.data(), expected, (size_t)dst_width * dst_height);
+		}
+	}
+}
+
+// 奇数サイズ、奥行き1を含む3Dの1レベル
+TEST(MipmapGeneration, Level3D)
+{
+	const LevelSize sizes[] = { { 16, 8, 4 }, { 9, 7, 5 }, { 8, 8, 1 }, { 1, 1, 6 }, { 3, 1, 2 } };
+	for (MipmapPixelFormat format : c_formats) {
+		for (const LevelSize& size : sizes) {
+			SCOPED_TRACE(testing::Message() << "format " << format << " size " << size.width << "x" << size.height << "x" << size.depth);
+			std::vector<uint8_t> src = make_pixels(format, (size_t)size.width * size.height * size.depth);
+			std::vector<uint8_t> expected = reference_level(format, src, size.width, size.height, size.depth, true);
+			const uint32_t dst_width = std::max(1u, size.width / 2);
+			const uint32_t dst_height = std::max(1u, size.height / 2);
+			const uint32_t dst_depth = std::max(1u, size.depth / 2);
+			const size_t pixel_size = getMipmapPixelSize(format);
+			std::vector<uint8_t> dst(pixel_size * dst_width * dst_height * dst_depth);
+			generateMipmapLevel3D(format, src.data(), pixel_size * size.width, pixel_size * size.width * size.height,
+				size.width, size.height, size.depth, dst.data(), pixel_size * dst_width, pixel_size * dst_width * dst_height);
+			expect_level_near(format, dst.data(), expected, (size_t)dst_width * dst_height * dst_depth);
+		}
+	}
+}
+
+// 奥行き1の3Dは2Dと同じ結果になる
+TEST(MipmapGeneration, Level3DDepthOneMatches2D)
+{
+	const uint32_t width = 33;
+	const uint32_t height = 18;
+	std::vector<uint8_t> src = make_pixels(MipmapPixelFormatRGBA8, width * height);
+	std::vector<uint8_t> dst_2d(16 * 9 * 4);
+	std::vector<uint8_t> dst_3d(dst_2d.size());
+	generateMipmapLevel(MipmapPixelFormatRGBA8, src.data(), width * 4, width, height, dst_2d.data(), 16 * 4);
+	generateMipmapLevel3D(MipmapPixelFormatRGBA8, src.data(), width * 4, width * height * 4, width, height, 1,
+		dst_3d.data(), 16 * 4, 16 * 9 * 4);
+	EXPECT_EQ(dst_2d, dst_3d);
+}
+
+// チェーン全体(大きなレベルは複数のスレッドで生成)の各レベルが、前のレベルからの参照実装と一致する
+void check_chain(MipmapPixelFormat format, uint32_t width, uint32_t height, uint32_t depth, bool volume)
+{
+	uint32_t levels = 1;
+	while ((width >> levels) | (height >> levels) | (volume ? (depth >> levels) : 0)) {
+		levels++;
+	}
+	const size_t pixel_size = getMipmapPixelSize(format);
+	const size_t chain_size = volume ? getMipmapChainSize3D(format, width, height, depth, levels)
+		: getMipmapChainSize(format, width, height, levels);
+	std::vector<uint8_t> chain = make_pixels(format, chain_size / pixel_size);
+	if (volume) {
+		generateMipmapChain3D(format, chain.data(), width, height, depth, levels);
+	} else {
+		generateMipmapChain(format, chain.data(), width, height, levels);
+	}
+	size_t offset = 0;
+	for (uint32_t level = 1; level < levels; level++) {
+		SCOPED_TRACE(testing::Message() << "level " << level);
+		const size_t src_size = pixel_size * width * height * depth;
+		std::vector<uint8_t> src(chain.begin() + offset, chain.begin() + offset + src_size);
+		std::vector<uint8_t> expected = reference_level(format, src, width, height, depth, volume);
+		offset += src_size;
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+		depth = volume ? std::max(1u, depth / 2) : depth;
+		expect_level_near(format, chain.data() + offset, expected, (size_t)width * height * depth);
+	}
+	EXPECT_EQ(offset + (pixel_size * width * height * depth) + 1, chain.size());
+}
+
+TEST(MipmapGeneration, Chain2D)
+{
+	check_chain(MipmapPixelFormatRGBA8, 1024, 600, 1, false);
+	check_chain(MipmapPixelFormatSRGB8A8, 300, 1024, 1, false);
+	check_chain(MipmapPixelFormatR32F, 1024, 1024, 1, false);
+}
+
+TEST(MipmapGeneration, Chain3D)
+{
+	check_chain(MipmapPixelFormatRGBA8, 128, 64, 96, true);
+	check_chain(MipmapPixelFormatRG32F, 33, 17, 9, true);
+}
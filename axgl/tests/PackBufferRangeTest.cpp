@@ -0,0 +1,69 @@
+// PackBufferRangeTest.cpp
+// ピクセルパックバッファへのglReadPixelsの範囲とオフセットの判定を確認する
+// NOTE: falseの場合、glReadPixelsはGL_INVALID_OPERATIONになる
+#include "core/CoreUtility.h"
+
+#include <gtest/gtest.h>
+
+using namespace axgl;
+
+namespace {
+
+// デフォルトのパックパラメータ(GL_PACK_ALIGNMENT=4)で判定
+bool isValidRange(size_t bufferSize, size_t offset, GLsizei width, GLsizei height, GLenum format, GLenum type)
+{
+	return isValidPackBufferRange(bufferSize, offset, width, height, format, type, 0, 0, 0, 4);
+}
+
+TEST(PackBufferRange, FitsExactly)
+{
+	// 16x16 RGBA8: 1024バイト
+	EXPECT_TRUE(isValidRange(1024, 0, 16, 16, GL_RGBA, GL_UNSIGNED_BYTE));
+	EXPECT_TRUE(isValidRange(1028, 4, 16, 16, GL_RGBA, GL_UNSIGNED_BYTE));
+}
+
+TEST(PackBufferRange, ExceedsBufferSize)
+{
+	EXPECT_FALSE(isValidRange(1023, 0, 16, 16, GL_RGBA, GL_UNSIGNED_BYTE));
+	EXPECT_FALSE(isValidRange(1024, 4, 16, 16, GL_RGBA, GL_UNSIGNED_BYTE));
+	// オフセットがバッファの外
+	EXPECT_FALSE(isValidRange(1024, 2048, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE));
+}
+
+TEST(PackBufferRange, OffsetNotAlignedToType)
+{
+	EXPECT_FALSE(isValidRange(4096, 1, 1, 1, GL_RGBA, GL_FLOAT));
+	EXPECT_FALSE(isValidRange(4096, 2, 1, 1, GL_RGBA, GL_FLOAT));
+	EXPECT_TRUE(isValidRange(4096, 4, 1, 1, GL_RGBA, GL_FLOAT));
+	EXPECT_FALSE(isValidRange(4096, 1, 1, 1, GL_RGB, GL_UNSIGNED_SHORT_5_6_5));
+	// GL_UNSIGNED_BYTEは任意のオフセットが有効
+	EXPECT_TRUE(isValidRange(4096, 3, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE));
+}
+
+TEST(PackBufferRange, RowAlignment)
+{
+	// 3x2 RGB8: 行は9バイトをGL_PACK_ALIGNMENTに揃える。最後の行は揃えない
+	EXPECT_TRUE(isValidPackBufferRange(21, 0, 3, 2, GL_RGB, GL_UNSIGNED_BYTE, 0, 0, 0, 4));
+	EXPECT_FALSE(isValidPackBufferRange(20, 0, 3, 2, GL_RGB, GL_UNSIGNED_BYTE, 0, 0, 0, 4));
+	EXPECT_TRUE(isValidPackBufferRange(18, 0, 3, 2, GL_RGB, GL_UNSIGNED_BYTE, 0, 0, 0, 1));
+	EXPECT_FALSE(isValidPackBufferRange(17, 0, 3, 2, GL_RGB, GL_UNSIGNED_BYTE, 0, 0, 0, 1));
+}
+
+TEST(PackBufferRange, RowLengthAndSkip)
+{
+	// GL_PACK_ROW_LENGTH=8の4x4 RGBA8: 行は32バイト
+	EXPECT_TRUE(isValidPackBufferRange(112, 0, 4, 4, GL_RGBA, GL_UNSIGNED_BYTE, 8, 0, 0, 4));
+	EXPECT_FALSE(isValidPackBufferRange(111, 0, 4, 4, GL_RGBA, GL_UNSIGNED_BYTE, 8, 0, 0, 4));
+	// GL_PACK_SKIP_ROWS=1、GL_PACK_SKIP_PIXELS=2
+	EXPECT_TRUE(isValidPackBufferRange(152, 0, 4, 4, GL_RGBA, GL_UNSIGNED_BYTE, 8, 1, 2, 4));
+	EXPECT_FALSE(isValidPackBufferRange(151, 0, 4, 4, GL_RGBA, GL_UNSIGNED_BYTE, 8, 1, 2, 4));
+}
+
+TEST(PackBufferRange, NoWrite)
+{
+	// 書き込みがない場合はオフセットのみ確認する
+	EXPECT_TRUE(isValidRange(0, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE));
+	EXPECT_TRUE(isValidRange(16, 16, 0, 4, GL_RGBA, GL_UNSIGNED_BYTE));
+}
+
+} // namespace
@@ -0,0 +1,293 @@
+// PixelConversionTest.cpp
+// PixelConversionのSIMD実装の変換結果を、ピクセルごとに変換するスカラーの参照実装と比較する
+#include "common/PixelConversion.h"
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+// SIMDのブロック境界と端数を含むピクセル数
+constexpr size_t c_max_count = 70;
+// アライメントされていないsrc、dstのオフセット
+constexpr size_t c_max_offset = 4;
+
+std::vector<uint8_t> make_bytes(size_t size, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::vector<uint8_t> bytes(size);
+	for (uint8_t& value : bytes) {
+		value = static_cast<uint8_t>(rng());
+	}
+	return bytes;
+}
+
+uint16_t load_u16(const uint8_t* src)
+{
+	uint16_t value;
+	memcpy(&value, src, sizeof(value));
+	return value;
+}
+
+// nbitの値を8bitに展開する(上位ビットの複製)
+uint8_t ref_expand(uint32_t value, uint32_t bits)
+{
+	uint32_t result = value << (8 - bits);
+	for (uint32_t shift = bits; shift < 8; shift += bits) {
+		result |= (value << (8 - bits)) >> shift;
+	}
+	return static_cast<uint8_t>(result);
+}
+
+// 参照実装(dstはRGBA8、1ピクセル分)
+using RefConversion = void (*)(uint8_t* dst, const uint8_t* src);
+using Conversion = void (*)(void* dst, const void* src, size_t count);
+
+void ref_rgb565(uint8_t* dst, const uint8_t* src)
+{
+	uint32_t p = load_u16(src);
+	dst[0] = ref_expand((p >> 11) & 0x1f, 5);
+	dst[1] = ref_expand((p >> 5) & 0x3f, 6);
+	dst[2] = ref_expand(p & 0x1f, 5);
+	dst[3] = 0xff;
+}
+
+void ref_rgba4444(uint8_t* dst, const uint8_t* src)
+{
+	uint32_t p = load_u16(src);
+	dst[0] = ref_expand((p >> 12) & 0xf, 4);
+	dst[1] = ref_expand((p >> 8) & 0xf, 4);
+	dst[2] = ref_expand((p >> 4) & 0xf, 4);
+	dst[3] = ref_expand(p & 0xf, 4);
+}
+
+void ref_rgba5551(uint8_t* dst, const uint8_t* src)
+{
+	uint32_t p = load_u16(src);
+	dst[0] = ref_expand((p >> 11) & 0x1f, 5);
+	dst[1] = ref_expand((p >> 6) & 0x1f, 5);
+	dst[2] = ref_expand((p >> 1) & 0x1f, 5);
+	dst[3] = (p & 1) ? 0xff : 0;
+}
+
+void ref_luminance(uint8_t* dst, const uint8_t* src)
+{
+	dst[0] = dst[1] = dst[2] = src[0];
+	dst[3] = 0xff;
+}
+
+void ref_luminance_alpha(uint8_t* dst, const uint8_t* src)
+{
+	dst[0] = dst[1] = dst[2] = src[0];
+	dst[3] = src[1];
+}
+
+void ref_alpha(uint8_t* dst, const uint8_t* src)
+{
+	dst[0] = dst[1] = dst[2] = 0;
+	dst[3] = src[0];
+}
+
+void ref_swizzle(uint8_t* dst, const uint8_t* src)
+{
+	dst[0] = src[2];
+	dst[1] = src[1];
+	dst[2] = src[0];
+	dst[3] = src[3];
+}
+
+// 全てのピクセル数とオフセットで参照実装と比較し、範囲外を書き換えていないことを確認する
+void check_conversion(Conversion conversion, RefConversion reference, size_t srcPixelSize, const char* name)
+{
+	for (size_t count = 0; count <= c_max_count; count++) {
+		for (size_t offset = 0; offset < c_max_offset; offset++) {
+			std::vector<uint8_t> src = make_bytes(offset + count * srcPixelSize + 1, static_cast<uint32_t>(count * 8 + offset));
+			std::vector<uint8_t> dst(offset + count * 4 + 4, 0xcd);
+			conversion(dst.data() + offset, src.data() + offset, count);
+			for (size_t i = 0; i < count; i++) {
+				uint8_t expected[4];
+				reference(expected, src.data() + offset + i * srcPixelSize);
+				for (int c = 0; c < 4; c++) {
+					ASSERT_EQ(dst[offset + i * 4 + c], expected[c]) << name << " count=" << count << " offset=" << offset << " i=" << i << " c=" << c;
+				}
+			}
+			for (size_t i = 0; i < offset; i++) {
+				ASSERT_EQ(dst[i], 0xcd) << name;
+			}
+			for (size_t i = offset + count * 4; i < dst.size(); i++) {
+				ASSERT_EQ(dst[i], 0xcd) << name;
+			}
+		}
+	}
+}
+
+// 16bit浮動小数点の参照実装
+float ref_half(uint16_t value)
+{
+	float sign = (value & 0x8000) ? -1.0f : 1.0f;
+	int exponent = (value >> 10) & 0x1f;
+	int mantissa = value & 0x3ff;
+	if (exponent == 0) {
+		return sign * std::ldexp(static_cast<float>(mantissa), -24);
+	}
+	if (exponent == 0x1f) {
+		return (mantissa == 0) ? sign * INFINITY : NAN;
+	}
+	return sign * std::ldexp(static_cast<float>(mantissa + 0x400), exponent - 25);
+}
+
+} // namespace
+
+TEST(PixelConversion, RGB8ToRGBA8)
+{
+	for (size_t count = 0; count <= c_max_count; count++) {
+		for (size_t offset = 0; offset < c_max_offset; offset++) {
+			const uint8_t alpha = static_cast<uint8_t>(0x80 + count);
+			std::vector<uint8_t> src = make_bytes(offset + count * 3 + 1, static_cast<uint32_t>(count * 8 + offset));
+			std::vector<uint8_t> dst(offset + count * 4 + 4, 0xcd);
+			convertPixelsRGB8ToRGBA8(dst.data() + offset, src.data() + offset, count, alpha);
+			for (size_t i = 0; i < count; i++) {
+				for (int c = 0; c < 3; c++) {
+					ASSERT_EQ(dst[offset + i * 4 + c], src[offset + i * 3 + c]) << "count=" << count << " offset=" << offset << " i=" << i;
+				}
+				ASSERT_EQ(dst[offset + i * 4 + 3], alpha);
+			}
+			ASSERT_EQ(dst[offset + count * 4], 0xcd);
+		}
+	}
+}
+
+TEST(PixelConversion, Packed16ToRGBA8)
+{
+	check_conversion(convertPixelsRGB565ToRGBA8, ref_rgb565, 2, "565");
+	check_conversion(convertPixelsRGBA4444ToRGBA8, ref_rgba4444, 2, "4444");
+	check_conversion(convertPixelsRGBA5551ToRGBA8, ref_rgba5551, 2, "5551");
+}
+
+// 全ての16bit値を変換する
+TEST(PixelConversion, Packed16AllValues)
+{
+	std::vector<uint16_t> src(65536);
+	for (size_t i = 0; i < src.size(); i++) {
+		src[i] = static_cast<uint16_t>(i);
+	}
+	std::vector<uint8_t> dst(src.size() * 4);
+	const struct {
+		Conversion conversion;
+		RefConversion reference;
+	} list[] = {
+		{ convertPixelsRGB565ToRGBA8, ref_rgb565 },
+		{ convertPixelsRGBA4444ToRGBA8, ref_rgba4444 },
+		{ convertPixelsRGBA5551ToRGBA8, ref_rgba5551 },
+	};
+	for (const auto& item : list) {
+		item.conversion(dst.data(), src.data(), src.size());
+		for (size_t i = 0; i < src.size(); i++) {
+			uint8_t expected[4];
+			item.reference(expected, reinterpret_cast<const uint8_t*>(&src[i]));
+			ASSERT_EQ(memcmp(&dst[i * 4], expected, 4), 0) << std::hex << i;
+		}
+	}
+}
+
+TEST(PixelConversion, LuminanceAlphaToRGBA8)
+{
+	check_conversion(convertPixelsLuminanceToRGBA8, ref_luminance, 1, "L");
+	check_conversion(convertPixelsLuminanceAlphaToRGBA8, ref_luminance_alpha, 2, "LA");
+	check_conversion(convertPixelsAlphaToRGBA8, ref_alpha, 1, "A");
+}
+
+TEST(PixelConversion, SwizzleBGRA8)
+{
+	check_conversion(swizzlePixelsBGRA8ToRGBA8, ref_swizzle, 4, "BGRA");
+	// 同じ領域での変換
+	for (size_t count = 0; count <= c_max_count; count++) {
+		std::vector<uint8_t> pixels = make_bytes(count * 4 + 1, static_cast<uint32_t>(count));
+		std::vector<uint8_t> src = pixels;
+		swizzlePixelsBGRA8ToRGBA8(pixels.data() + 1, pixels.data() + 1, count);
+		for (size_t i = 0; i < count; i++) {
+			uint8_t expected[4];
+			ref_swizzle(expected, &src[1 + i * 4]);
+			ASSERT_EQ(memcmp(&pixels[1 + i * 4], expected, 4), 0) << "count=" << count << " i=" << i;
+		}
+	}
+}
+
+TEST(PixelConversion, FlipImageRows)
+{
+	for (size_t height = 0; height <= 5; height++) {
+		for (size_t bytes_per_row : { size_t(1), size_t(15), size_t(16), size_t(37), size_t(64) }) {
+			std::vector<uint8_t> src = make_bytes(bytes_per_row * height + 1, static_cast<uint32_t>(height * 100 + bytes_per_row));
+			std::vector<uint8_t> pixels = src;
+			flipImageRows(pixels.data(), bytes_per_row, height);
+			for (size_t y = 0; y < height; y++) {
+				ASSERT_EQ(memcmp(&pixels[y * bytes_per_row], &src[(height - 1 - y) * bytes_per_row], bytes_per_row), 0)
+					<< "height=" << height << " bytesPerRow=" << bytes_per_row << " y=" << y;
+			}
+		}
+	}
+}
+
+TEST(PixelConversion, CopyImageRows)
+{
+	constexpr size_t c_height = 7;
+	const size_t row_size = 4 * 19;
+	const size_t src_bytes_per_row = row_size + 5;
+	const size_t dst_bytes_per_row = row_size + 12;
+	std::vector<uint8_t> src = make_bytes(src_bytes_per_row * c_height, 5);
+	for (int flip = 0; flip < 2; flip++) {
+		for (int swizzle = 0; swizzle < 2; swizzle++) {
+			std::vector<uint8_t> dst(dst_bytes_per_row * c_height, 0xcd);
+			copyImageRows(dst.data(), dst_bytes_per_row, src.data(), src_bytes_per_row, row_size, c_height, (flip != 0), (swizzle != 0));
+			for (size_t y = 0; y < c_height; y++) {
+				const uint8_t* src_row = &src[(flip ? (c_height - 1 - y) : y) * src_bytes_per_row];
+				const uint8_t* dst_row = &dst[y * dst_bytes_per_row];
+				for (size_t i = 0; i < row_size; i += 4) {
+					uint8_t expected[4];
+					if (swizzle) {
+						ref_swizzle(expected, src_row + i);
+					} else {
+						memcpy(expected, src_row + i, 4);
+					}
+					ASSERT_EQ(memcmp(dst_row + i, expected, 4), 0) << "flip=" << flip << " swizzle=" << swizzle << " y=" << y << " i=" << i;
+				}
+				// 行の間の領域を書き換えていないこと
+				for (size_t i = row_size; i < dst_bytes_per_row; i++) {
+					ASSERT_EQ(dst_row[i], 0xcd);
+				}
+			}
+		}
+	}
+}
+
+// 全ての16bit値(非正規化数、無限大、NaNを含む)を変換する
+TEST(PixelConversion, HalfToFloat)
+{
+	std::vector<uint16_t> src(65536 + 1);
+	for (size_t i = 0; i < 65536; i++) {
+		src[i] = static_cast<uint16_t>(i);
+	}
+	// 端数の要素
+	src[65536] = 0x3c00;
+	for (size_t offset = 0; offset < 2; offset++) {
+		const size_t count = src.size() - offset;
+		std::vector<uint8_t> dst(count * sizeof(float) + 1);
+		convertHalfToFloat(dst.data() + 1, src.data() + offset, count);
+		for (size_t i = 0; i < count; i++) {
+			float value;
+			memcpy(&value, &dst[1 + i * sizeof(float)], sizeof(value));
+			float expected = ref_half(src[offset + i]);
+			if (std::isnan(expected)) {
+				ASSERT_TRUE(std::isnan(value)) << std::hex << src[offset + i];
+			} else {
+				ASSERT_EQ(value, expected) << std::hex << src[offset + i];
+				ASSERT_EQ(std::signbit(value), std::signbit(expected)) << std::hex << src[offset + i];
+			}
+		}
+	}
+}
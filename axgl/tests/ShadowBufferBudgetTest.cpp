@@ -0,0 +1,194 @@
+// ShadowBufferBudgetTest.cpp
+// コンテキスト毎のShadowBufferBudgetによる破棄と、他のコンテキストへのリストの移動を偽のバッファで確認する
+#include "common/ShadowBufferBudget.h"
+#include "common/SubmissionSerial.h"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+// 破棄の対象とする、書き込まれていない期間(ShadowBufferBudget.cppと同じ値)
+constexpr int c_idle_ticks = 60;
+
+// BufferMetalのシャドウバッファの破棄を模したもの
+class FakeBuffer : public ShadowBufferEntry
+{
+public:
+	virtual bool evictShadowBuffer(const SubmissionSerial* submissionSerial) override
+	{
+		AXGL_UNUSED(submissionSerial);
+		// 他のスレッドがアクセス中のバッファを破棄していないこと
+		if (accessing.load()) {
+			violationCount++;
+		}
+		if (!evictable) {
+			return false;
+		}
+		evictCount++;
+		return true;
+	}
+
+	bool evictable = true;
+	std::atomic<bool> accessing{ false };
+	std::atomic<int> evictCount{ 0 };
+	std::atomic<int> violationCount{ 0 };
+};
+
+// テスト中に予算を設定し、終了時に無制限に戻す
+class ScopedBudget
+{
+public:
+	explicit ScopedBudget(size_t size)
+	{
+		ShadowBufferBudget::setBudget(size);
+	}
+	~ScopedBudget()
+	{
+		ShadowBufferBudget::setBudget(SIZE_MAX);
+	}
+};
+
+void tick(ShadowBufferBudget* budget, const SubmissionSerial* serial, int count)
+{
+	for (int i = 0; i < count; i++) {
+		budget->evict(serial);
+	}
+}
+
+} // namespace
+
+TEST(ShadowBufferBudget, ClassSize)
+{
+	FakeBuffer static_buffer;
+	FakeBuffer stream_buffer;
+	ShadowBufferBudget budget;
+	budget.update(&static_buffer, getShadowBufferClass(GL_STATIC_DRAW), 100);
+	budget.update(&stream_buffer, getShadowBufferClass(GL_STREAM_DRAW), 30);
+	EXPECT_EQ(ShadowBufferBudget::getClassSize(ShadowBufferClassStatic), 100u);
+	EXPECT_EQ(ShadowBufferBudget::getClassSize(ShadowBufferClassStream), 30u);
+	EXPECT_EQ(ShadowBufferBudget::getTotalSize(), 130u);
+	// サイズの変更
+	budget.update(&static_buffer, ShadowBufferClassStatic, 40);
+	EXPECT_EQ(ShadowBufferBudget::getTotalSize(), 70u);
+	// サイズ0で対象外
+	budget.update(&stream_buffer, ShadowBufferClassStream, 0);
+	EXPECT_EQ(ShadowBufferBudget::getClassSize(ShadowBufferClassStream), 0u);
+	ShadowBufferBudget::remove(&static_buffer);
+	EXPECT_EQ(ShadowBufferBudget::getTotalSize(), 0u);
+}
+
+// 予算を超えている間だけ、書き込まれていない期間が長いものから破棄する
+TEST(ShadowBufferBudget, EvictIdle)
+{
+	SubmissionSerial serial;
+	FakeBuffer old_buffer;
+	FakeBuffer pinned_buffer;
+	FakeBuffer recent_buffer;
+	ShadowBufferBudget budget;
+	ScopedBudget scoped_budget(150);
+	budget.update(&old_buffer, ShadowBufferClassStatic, 100);
+	budget.update(&pinned_buffer, ShadowBufferClassStatic, 100);
+	pinned_buffer.evictable = false;
+	tick(&budget, &serial, c_idle_ticks);
+	budget.update(&recent_buffer, ShadowBufferClassStatic, 100);
+	budget.evict(&serial);
+	// 破棄できないものは残し、最近書き込まれたものは破棄しない
+	EXPECT_EQ(old_buffer.evictCount.load(), 1);
+	EXPECT_EQ(pinned_buffer.evictCount.load(), 0);
+	EXPECT_EQ(recent_buffer.evictCount.load(), 0);
+	EXPECT_EQ(ShadowBufferBudget::getTotalSize(), 200u);
+	// 予算内になったら破棄しない
+	ShadowBufferBudget::remove(&pinned_buffer);
+	tick(&budget, &serial, c_idle_ticks * 2);
+	EXPECT_EQ(recent_buffer.evictCount.load(), 0);
+	EXPECT_EQ(ShadowBufferBudget::getTotalSize(), 100u);
+}
+
+// 他のコンテキストが使用したバッファは、そのコンテキストのリストに移り、元のコンテキストは破棄しない
+TEST(ShadowBufferBudget, AcquireMovesEntry)
+{
+	SubmissionSerial serial_a;
+	SubmissionSerial serial_b;
+	FakeBuffer buffer;
+	ShadowBufferBudget budget_a;
+	ShadowBufferBudget budget_b;
+	ScopedBudget scoped_budget(0);
+	budget_a.update(&buffer, ShadowBufferClassDynamic, 64);
+	tick(&budget_b, &serial_b, c_idle_ticks);
+	budget_b.acquire(&buffer);
+	// サイズは移動しても変わらない
+	EXPECT_EQ(ShadowBufferBudget::getClassSize(ShadowBufferClassDynamic), 64u);
+	tick(&budget_a, &serial_a, c_idle_ticks * 2);
+	EXPECT_EQ(buffer.evictCount.load(), 0);
+	// 移動時は最近使用したものとして扱う
+	budget_b.evict(&serial_b);
+	EXPECT_EQ(buffer.evictCount.load(), 0);
+	tick(&budget_b, &serial_b, c_idle_ticks);
+	EXPECT_EQ(buffer.evictCount.load(), 1);
+	EXPECT_EQ(ShadowBufferBudget::getTotalSize(), 0u);
+	// 破棄されたものは移動しない
+	budget_a.acquire(&buffer);
+	EXPECT_EQ(ShadowBufferBudget::getTotalSize(), 0u);
+}
+
+// コンテキストの破棄時にリストから外す
+TEST(ShadowBufferBudget, Clear)
+{
+	FakeBuffer buffer;
+	{
+		ShadowBufferBudget budget;
+		budget.update(&buffer, ShadowBufferClassStatic, 16);
+		EXPECT_EQ(ShadowBufferBudget::getTotalSize(), 16u);
+	}
+	EXPECT_EQ(ShadowBufferBudget::getTotalSize(), 0u);
+	ShadowBufferBudget other;
+	other.acquire(&buffer);
+	EXPECT_EQ(ShadowBufferBudget::getTotalSize(), 0u);
+}
+
+// 2つのコンテキストのスレッドが共有するバッファを交互に使用し、それぞれサブミッション毎に破棄する
+// NOTE: GLと同様に、同じバッファへのアクセスはアプリケーションが同期する(ここではバッファ毎のmutex)
+TEST(ShadowBufferBudget, SharedBuffersOnTwoThreads)
+{
+	constexpr size_t c_buffer_count = 16;
+	constexpr int c_iteration_count = 3000;
+	std::vector<FakeBuffer> buffers(c_buffer_count);
+	std::vector<std::mutex> buffer_mutexes(c_buffer_count);
+	ScopedBudget scoped_budget(0);
+	auto run = [&](unsigned int seed) {
+		SubmissionSerial serial;
+		ShadowBufferBudget budget;
+		for (int i = 0; i < c_iteration_count; i++) {
+			size_t index = (seed * 7 + static_cast<size_t>(i) * 5) % c_buffer_count;
+			{
+				std::lock_guard<std::mutex> lock(buffer_mutexes[index]);
+				FakeBuffer& buffer = buffers[index];
+				// シャドウバッファにアクセスする前に移す
+				budget.acquire(&buffer);
+				buffer.accessing = true;
+				if ((i % 3) == 0) {
+					budget.update(&buffer, ShadowBufferClassStream, 256);
+				}
+				buffer.accessing = false;
+			}
+			if ((i % 4) == 0) {
+				budget.evict(&serial);
+			}
+		}
+		// NOTE: budgetの破棄でリストから外す
+	};
+	std::thread thread_a(run, 1u);
+	std::thread thread_b(run, 2u);
+	thread_a.join();
+	thread_b.join();
+	for (FakeBuffer& buffer : buffers) {
+		EXPECT_EQ(buffer.violationCount.load(), 0);
+	}
+	EXPECT_EQ(ShadowBufferBudget::getTotalSize(), 0u);
+}
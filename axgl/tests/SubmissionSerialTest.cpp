@@ -0,0 +1,185 @@
+// SubmissionSerialTest.cpp
+// SubmissionSerialによるGPU使用中の判定を、コマンドバッファの完了を任意の順で通知する偽のコマンドキューで確認する
+#include "common/SubmissionSerial.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+// ContextMetalのコマンドバッファのsubmitと完了ハンドラを模した偽のコマンドキュー
+class FakeCommandQueue
+{
+public:
+	// 記録中のコマンドバッファで使用するシリアル
+	uint64_t getPendingSerial() const
+	{
+		return m_serial.getPendingSerial();
+	}
+	// 記録中のコマンドバッファをsubmitする(完了はまだ通知しない)
+	uint64_t commit()
+	{
+		uint64_t serial = m_serial.submit();
+		m_inFlight.push_back(serial);
+		return serial;
+	}
+	// submit済みのコマンドバッファを1つ完了させる
+	void completeOne(size_t index)
+	{
+		ASSERT_LT(index, m_inFlight.size());
+		m_serial.complete(m_inFlight[index]);
+		m_inFlight.erase(m_inFlight.begin() + index);
+	}
+	// 全て完了させる(waitUntilCompleted)
+	void completeAll()
+	{
+		for (uint64_t serial : m_inFlight) {
+			m_serial.complete(serial);
+		}
+		m_inFlight.clear();
+	}
+	const SubmissionSerial& getSubmissionSerial() const
+	{
+		return m_serial;
+	}
+	SubmissionSerial& getSubmissionSerial()
+	{
+		return m_serial;
+	}
+
+private:
+	SubmissionSerial m_serial;
+	std::vector<uint64_t> m_inFlight;
+};
+
+// BufferMetalの最後に使用したシリアルの記録と判定を模したもの
+struct FakeResource
+{
+	uint64_t lastUsedSerial = 0;
+	const SubmissionSerial* lastUsedSerialSource = nullptr;
+
+	void use(const FakeCommandQueue& queue)
+	{
+		lastUsedSerial = queue.getPendingSerial();
+		lastUsedSerialSource = &queue.getSubmissionSerial();
+	}
+	bool isInFlight(const FakeCommandQueue& queue) const
+	{
+		return !queue.getSubmissionSerial().isCompleted(lastUsedSerialSource, lastUsedSerial);
+	}
+};
+
+} // namespace
+
+TEST(SubmissionSerial, UnusedResourceIsNotInFlight)
+{
+	FakeCommandQueue queue;
+	FakeResource resource;
+	EXPECT_FALSE(resource.isInFlight(queue));
+}
+
+TEST(SubmissionSerial, PendingAndSubmittedAreInFlight)
+{
+	FakeCommandQueue queue;
+	FakeResource resource;
+	resource.use(queue);
+	// 記録中
+	EXPECT_TRUE(resource.isInFlight(queue));
+	queue.commit();
+	// submit済み、未完了
+	EXPECT_TRUE(resource.isInFlight(queue));
+	queue.completeAll();
+	EXPECT_FALSE(resource.isInFlight(queue));
+}
+
+TEST(SubmissionSerial, OutOfOrderCompletion)
+{
+	FakeCommandQueue queue;
+	FakeResource first;
+	FakeResource second;
+	first.use(queue);
+	queue.commit();
+	second.use(queue);
+	queue.commit();
+	// 後のコマンドバッファの完了が先に通知された場合、それ以前のシリアルも完了とみなす(キューは順に実行される)
+	queue.completeOne(1);
+	EXPECT_FALSE(first.isInFlight(queue));
+	EXPECT_FALSE(second.isInFlight(queue));
+	// 前のコマンドバッファの完了が後から通知されても、完了済みのシリアルは戻らない
+	queue.completeOne(0);
+	EXPECT_EQ(queue.getSubmissionSerial().getCompletedSerial(), 2u);
+}
+
+// 他のコンテキスト(コマンドキュー)が最後に使用した場合は、シリアルの値によらず使用中とする
+TEST(SubmissionSerial, OtherSourceIsInFlight)
+{
+	FakeCommandQueue queue_a;
+	FakeCommandQueue queue_b;
+	FakeResource resource;
+	// queue_bはシリアルが進んでいるため、値だけを比較すると完了済みと誤判定する
+	for (int i = 0; i < 10; i++) {
+		queue_b.commit();
+	}
+	queue_b.completeAll();
+	resource.use(queue_a);
+	queue_a.commit();
+	EXPECT_TRUE(resource.isInFlight(queue_a));
+	EXPECT_TRUE(resource.isInFlight(queue_b));
+	queue_a.completeAll();
+	EXPECT_FALSE(resource.isInFlight(queue_a));
+	EXPECT_TRUE(resource.isInFlight(queue_b));
+	// queue_bで使用すると、queue_bで判定できる
+	resource.use(queue_b);
+	queue_b.commit();
+	queue_b.completeAll();
+	EXPECT_FALSE(resource.isInFlight(queue_b));
+	EXPECT_TRUE(resource.isInFlight(queue_a));
+}
+
+TEST(SubmissionSerial, Reset)
+{
+	FakeCommandQueue queue;
+	queue.commit();
+	queue.completeAll();
+	queue.getSubmissionSerial().reset();
+	EXPECT_EQ(queue.getSubmissionSerial().getPendingSerial(), 1u);
+	EXPECT_EQ(queue.getSubmissionSerial().getCompletedSerial(), 0u);
+}
+
+// 完了ハンドラのスレッドから任意の順で通知され、GLのスレッドで判定する
+TEST(SubmissionSerial, CompletionFromOtherThreads)
+{
+	constexpr uint64_t c_count = 2000;
+	SubmissionSerial serial;
+	std::vector<uint64_t> serials;
+	for (uint64_t i = 0; i < c_count; i++) {
+		serials.push_back(serial.submit());
+	}
+	std::shuffle(serials.begin(), serials.end(), std::mt19937(3));
+	std::vector<std::thread> threads;
+	constexpr size_t c_thread_count = 4;
+	for (size_t t = 0; t < c_thread_count; t++) {
+		threads.emplace_back([&serial, &serials, t]() {
+			for (size_t i = t; i < serials.size(); i += c_thread_count) {
+				serial.complete(serials[i]);
+			}
+		});
+	}
+	uint64_t last = 0;
+	while (last < c_count) {
+		// 完了済みのシリアルは単調増加する
+		uint64_t completed = serial.getCompletedSerial();
+		ASSERT_GE(completed, last);
+		last = completed;
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	EXPECT_TRUE(serial.isCompleted(&serial, c_count));
+	EXPECT_FALSE(serial.isCompleted(&serial, c_count + 1));
+}
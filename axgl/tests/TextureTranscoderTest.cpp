@@ -0,0 +1,356 @@
+// TextureTranscoderTest.cpp
+// ETC2/EAC、ASTCのデコードを、仕様(Khronos Data Format Specification)から手で組み立てたブロックで確認する
+#include "common/TextureTranscoder.h"
+#include "common/PixelConversion.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+// 仕様のETC1の輝度の変化量(テーブル0): インデックス0、1は+2、+8、2、3は-2、-8
+const int c_etc1_table0[4] = { 2, 8, -2, -8 };
+// 仕様のEACの変化量(テーブル0)
+const int c_eac_table0[8] = { -3, -6, -9, -15, 2, 5, 8, 14 };
+
+uint8_t clamp_u8(int value)
+{
+	return static_cast<uint8_t>(std::min(std::max(value, 0), 255));
+}
+
+// 64bitのブロックをビッグエンディアンで格納
+void store_be64(uint8_t* dst, uint64_t value)
+{
+	for (int i = 0; i < 8; i++) {
+		dst[i] = static_cast<uint8_t>(value >> (56 - (i * 8)));
+	}
+}
+
+// ETC1/ETC2のピクセルインデックス(ピクセルx * 4 + yのビットにMSB、LSB)
+uint64_t etc_indices(const uint32_t* indices)
+{
+	uint64_t msb = 0;
+	uint64_t lsb = 0;
+	for (uint32_t x = 0; x < 4; x++) {
+		for (uint32_t y = 0; y < 4; y++) {
+			uint32_t index = indices[(y * 4) + x];
+			msb |= static_cast<uint64_t>(index >> 1) << ((x * 4) + y);
+			lsb |= static_cast<uint64_t>(index & 1) << ((x * 4) + y);
+		}
+	}
+	return (msb << 16) | lsb;
+}
+
+// EACのインデックス(列優先で、最初のピクセルが上位ビット)
+uint64_t eac_indices(const uint32_t* indices)
+{
+	uint64_t bits = 0;
+	for (uint32_t x = 0; x < 4; x++) {
+		for (uint32_t y = 0; y < 4; y++) {
+			uint32_t p = (x * 4) + y;
+			bits |= static_cast<uint64_t>(indices[(y * 4) + x]) << (45 - (p * 3));
+		}
+	}
+	return bits;
+}
+
+// ASTCのブロック(LSBから順に書き込む)
+struct AstcBlock {
+	uint8_t bytes[16] = {};
+
+	void write(uint32_t pos, uint32_t count, uint32_t value)
+	{
+		for (uint32_t i = 0; i < count; i++) {
+			if ((value >> i) & 1) {
+				bytes[(pos + i) / 8] |= static_cast<uint8_t>(1 << ((pos + i) % 8));
+			}
+		}
+	}
+	// ウェイトはブロックの最上位ビットから逆順に格納
+	void writeReversed(uint32_t pos, uint32_t count, uint32_t value)
+	{
+		for (uint32_t i = 0; i < count; i++) {
+			if ((value >> i) & 1) {
+				uint32_t bit = 127 - (pos + i);
+				bytes[bit / 8] |= static_cast<uint8_t>(1 << (bit % 8));
+			}
+		}
+	}
+};
+
+std::vector<uint8_t> transcode(GLenum internalformat, const void* data, size_t dataSize, uint32_t width, uint32_t height)
+{
+	CompressedFormatInfo info;
+	EXPECT_TRUE(getCompressedFormatInfo(internalformat, &info));
+	size_t pixel_size = getTranscodedPixelSize(info.transcodedFormat);
+	std::vector<uint8_t> decoded(pixel_size * width * height);
+	EXPECT_TRUE(transcodeCompressedImage(internalformat, data, dataSize, width, height, decoded.data(), pixel_size * width));
+	return decoded;
+}
+
+// halfの値をfloatで取得
+std::vector<float> to_float(const std::vector<uint8_t>& halfs)
+{
+	std::vector<float> values(halfs.size() / 2 + 1);
+	convertHalfToFloat(values.data(), halfs.data(), halfs.size() / 2);
+	values.pop_back();
+	return values;
+}
+
+const uint32_t c_pattern[16] = { 0, 1, 2, 3, 3, 2, 1, 0, 1, 3, 0, 2, 2, 0, 3, 1 };
+const uint32_t c_pattern8[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 7, 6, 5, 4, 3, 2, 1, 0 };
+
+} // namespace
+
+// 個別モード: 4bitのベース色(x * 17)、左右のサブブロック
+TEST(TextureTranscoder, Etc2Individual)
+{
+	uint8_t block[8];
+	// R1=15, R2=4, G1=0, G2=8, B1=8, B2=15, テーブル0/0, diff=0, flip=0
+	uint64_t bits = (0xFull << 60) | (0x4ull << 56) | (0x0ull << 52) | (0x8ull << 48) | (0x8ull << 44) | (0xFull << 40);
+	store_be64(block, bits | etc_indices(c_pattern));
+	std::vector<uint8_t> decoded = transcode(GL_COMPRESSED_RGB8_ETC2, block, sizeof(block), 4, 4);
+	const int base[2][3] = { { 255, 0, 136 }, { 68, 136, 255 } };
+	for (uint32_t y = 0; y < 4; y++) {
+		for (uint32_t x = 0; x < 4; x++) {
+			const int* color = base[x / 2];
+			int modifier = c_etc1_table0[c_pattern[(y * 4) + x]];
+			const uint8_t* p = &decoded[((y * 4) + x) * 4];
+			SCOPED_TRACE(testing::Message() << "x " << x << " y " << y);
+			EXPECT_EQ(p[0], clamp_u8(color[0] + modifier));
+			EXPECT_EQ(p[1], clamp_u8(color[1] + modifier));
+			EXPECT_EQ(p[2], clamp_u8(color[2] + modifier));
+			EXPECT_EQ(p[3], 255);
+		}
+	}
+}
+
+// 差分モード: 5bitのベース色と3bitの差分、flipで上下のサブブロック
+TEST(TextureTranscoder, Etc2Differential)
+{
+	uint8_t block[8];
+	// R=16,dR=+1 G=0,dG=0 B=31,dB=-1 テーブル1/0, diff=1, flip=1
+	uint64_t bits = (16ull << 59) | (1ull << 56) | (0ull << 51) | (0ull << 48) | (31ull << 43) | (7ull << 40)
+		| (1ull << 37) | (0ull << 34) | (1ull << 33) | (1ull << 32);
+	store_be64(block, bits | etc_indices(c_pattern));
+	std::vector<uint8_t> decoded = transcode(GL_COMPRESSED_RGB8_ETC2, block, sizeof(block), 4, 4);
+	// 5bitの値(x << 3 | x >> 2)
+	const int base[2][3] = { { 132, 0, 255 }, { 140, 0, 247 } };
+	const int table1[4] = { 5, 17, -5, -17 };
+	for (uint32_t y = 0; y < 4; y++) {
+		for (uint32_t x = 0; x < 4; x++) {
+			uint32_t sub_block = y / 2;
+			const int* color = base[sub_block];
+			uint32_t index = c_pattern[(y * 4) + x];
+			int modifier = (sub_block == 0) ? table1[index] : c_etc1_table0[index];
+			const uint8_t* p = &decoded[((y * 4) + x) * 4];
+			SCOPED_TRACE(testing::Message() << "x " << x << " y " << y);
+			EXPECT_EQ(p[0], clamp_u8(color[0] + modifier));
+			EXPECT_EQ(p[1], clamp_u8(color[1] + modifier));
+			EXPECT_EQ(p[2], clamp_u8(color[2] + modifier));
+		}
+	}
+}
+
+// RGBA8: EACのアルファ(base + modifier * multiplier)の後にETC2のRGB
+TEST(TextureTranscoder, Etc2EacAlpha)
+{
+	uint8_t block[16];
+	store_be64(block, (100ull << 56) | (3ull << 52) | (0ull << 48) | eac_indices(c_pattern8));
+	store_be64(block + 8, (0x8ull << 60) | (0x8ull << 56) | (0x8ull << 52) | (0x8ull << 48) | (0x8ull << 44) | (0x8ull << 40));
+	std::vector<uint8_t> decoded = transcode(GL_COMPRESSED_RGBA8_ETC2_EAC, block, sizeof(block), 4, 4);
+	for (uint32_t i = 0; i < 16; i++) {
+		EXPECT_EQ(decoded[(i * 4) + 0], 138);
+		EXPECT_EQ(decoded[(i * 4) + 3], clamp_u8(100 + (c_eac_table0[c_pattern8[i]] * 3))) << "pixel " << i;
+	}
+}
+
+// R11: 符号なしはbase * 8 + 4 + modifier * multiplier * 8を[0, 2047]、符号付きは[-1023, 1023]で正規化
+TEST(TextureTranscoder, EacR11)
+{
+	uint8_t block[8];
+	store_be64(block, (128ull << 56) | (2ull << 52) | (0ull << 48) | eac_indices(c_pattern8));
+	std::vector<float> values = to_float(transcode(GL_COMPRESSED_R11_EAC, block, sizeof(block), 4, 4));
+	for (uint32_t i = 0; i < 16; i++) {
+		float expected = ((128 * 8) + 4 + (c_eac_table0[c_pattern8[i]] * 2 * 8)) / 2047.0f;
+		EXPECT_NEAR(values[i], expected, 1e-3f) << "pixel " << i;
+	}
+	// 符号付き(base = -100)、乗数0は1/8
+	store_be64(block, (0x9Cull << 56) | (0ull << 52) | (0ull << 48) | eac_indices(c_pattern8));
+	values = to_float(transcode(GL_COMPRESSED_SIGNED_R11_EAC, block, sizeof(block), 4, 4));
+	for (uint32_t i = 0; i < 16; i++) {
+		float expected = ((-100 * 8) + c_eac_table0[c_pattern8[i]]) / 1023.0f;
+		EXPECT_NEAR(values[i], expected, 1e-3f) << "pixel " << i;
+	}
+}
+
+// RG11: Rのブロックの後にGのブロック
+TEST(TextureTranscoder, EacRG11)
+{
+	uint8_t block[16];
+	store_be64(block, (255ull << 56) | (15ull << 52) | eac_indices(c_pattern8));
+	store_be64(block + 8, (0ull << 56) | (1ull << 52) | eac_indices(c_pattern8));
+	std::vector<float> values = to_float(transcode(GL_COMPRESSED_RG11_EAC, block, sizeof(block), 4, 4));
+	for (uint32_t i = 0; i < 16; i++) {
+		int modifier = c_eac_table0[c_pattern8[i]];
+		float r = std::min(std::max((255 * 8) + 4 + (modifier * 15 * 8), 0), 2047) / 2047.0f;
+		float g = std::min(std::max(4 + (modifier * 8), 0), 2047) / 2047.0f;
+		EXPECT_NEAR(values[(i * 2) + 0], r, 1e-3f) << "pixel " << i;
+		EXPECT_NEAR(values[(i * 2) + 1], g, 1e-3f) << "pixel " << i;
+	}
+}
+
+// 単色(void-extent)のブロック: UNORM16の色、ブロックサイズに関わらず全てのテクセル
+TEST(TextureTranscoder, AstcVoidExtent)
+{
+	AstcBlock block;
+	block.write(0, 9, 0x1FC);
+	block.write(9, 1, 0);
+	block.write(10, 2, 0x3);
+	// 範囲なし(全て1)
+	for (uint32_t i = 0; i < 4; i++) {
+		block.write(12 + (i * 13), 13, 0x1FFF);
+	}
+	block.write(64, 16, 0xFFFF);
+	block.write(80, 16, 0x0000);
+	block.write(96, 16, 0x8080);
+	block.write(112, 16, 0x4040);
+	const GLenum formats[] = { GL_COMPRESSED_RGBA_ASTC_4x4_KHR, GL_COMPRESSED_RGBA_ASTC_8x5_KHR, GL_COMPRESSED_RGBA_ASTC_12x12_KHR };
+	for (GLenum format : formats) {
+		// NOTE: ブロックサイズの倍数でないイメージは、はみ出したテクセルを捨てる
+		std::vector<uint8_t> decoded = transcode(format, block.bytes, sizeof(block.bytes), 3, 2);
+		for (size_t i = 0; i < 6; i++) {
+			EXPECT_EQ(decoded[(i * 4) + 0], 255);
+			EXPECT_EQ(decoded[(i * 4) + 1], 0);
+			EXPECT_EQ(decoded[(i * 4) + 2], 128);
+			EXPECT_EQ(decoded[(i * 4) + 3], 64);
+		}
+	}
+}
+
+// 1パーティション、CEM 8(LDR RGB direct)、4x4のウェイトグリッド(0..7)
+TEST(TextureTranscoder, AstcDirectRGB)
+{
+	AstcBlock block;
+	// ブロックモード: R=7(R0=bit4,R1=bit0,R2=bit1)、bit[3:2]=00でW=B+4、H=A+2(A=2、B=0)
+	block.write(0, 11, (1 << 0) | (1 << 1) | (1 << 4) | (2 << 5) | (0 << 7));
+	block.write(11, 2, 0);
+	block.write(13, 4, 8);
+	// 色(48bitで8bitに量子化): r0, r1, g0, g1, b0, b1
+	const uint32_t colors[6] = { 0, 255, 64, 128, 200, 40 };
+	for (uint32_t i = 0; i < 6; i++) {
+		block.write(17 + (i * 8), 8, colors[i]);
+	}
+	uint32_t weights[16];
+	for (uint32_t i = 0; i < 16; i++) {
+		weights[i] = (i * 5) % 8;
+		block.writeReversed(i * 3, 3, weights[i]);
+	}
+	std::vector<uint8_t> decoded = transcode(GL_COMPRESSED_RGBA_ASTC_4x4_KHR, block.bytes, sizeof(block.bytes), 4, 4);
+	// r1 + g1 + b1 >= r0 + g0 + b0 のためblue contractなし
+	const uint32_t e0[4] = { colors[0], colors[2], colors[4], 255 };
+	const uint32_t e1[4] = { colors[1], colors[3], colors[5], 255 };
+	for (uint32_t i = 0; i < 16; i++) {
+		// 3bitのウェイトを6bitに拡張して、32より大きい場合は1を加える
+		uint32_t w = (weights[i] << 3) | weights[i];
+		w += (w > 32) ? 1 : 0;
+		for (uint32_t c = 0; c < 4; c++) {
+			uint32_t c0 = (e0[c] << 8) | e0[c];
+			uint32_t c1 = (e1[c] << 8) | e1[c];
+			uint32_t value = ((c0 * (64 - w)) + (c1 * w) + 32) >> 6;
+			uint8_t expected = static_cast<uint8_t>(std::lround(value * 255.0 / 65535.0));
+			EXPECT_EQ(decoded[(i * 4) + c], expected) << "texel " << i << " channel " << c;
+		}
+	}
+}
+
+// 予約されたブロックモード、HDRの単色ブロックはエラーの色(マゼンタ)
+TEST(TextureTranscoder, AstcErrorColor)
+{
+	AstcBlock reserved;
+	AstcBlock hdr;
+	hdr.write(0, 9, 0x1FC);
+	hdr.write(9, 1, 1);
+	hdr.write(10, 2, 0x3);
+	for (const AstcBlock* block : { &reserved, &hdr }) {
+		std::vector<uint8_t> decoded = transcode(GL_COMPRESSED_RGBA_ASTC_4x4_KHR, block->bytes, sizeof(block->bytes), 4, 4);
+		for (uint32_t i = 0; i < 16; i++) {
+			EXPECT_EQ(decoded[(i * 4) + 0], 255);
+			EXPECT_EQ(decoded[(i * 4) + 1], 0);
+			EXPECT_EQ(decoded[(i * 4) + 2], 255);
+			EXPECT_EQ(decoded[(i * 4) + 3], 255);
+		}
+	}
+}
+
+// データが不足している場合は失敗
+TEST(TextureTranscoder, ShortData)
+{
+	uint8_t block[8] = {};
+	std::vector<uint8_t> decoded(8 * 8 * 4);
+	EXPECT_FALSE(transcodeCompressedImage(GL_COMPRESSED_RGB8_ETC2, block, sizeof(block), 8, 8, decoded.data(), 8 * 4));
+}
+
+// ハッシュとサイズが同じでも、内容の異なるデータのデコード結果は返さない
+TEST(TranscodeCache, ComparesSource)
+{
+	TranscodeCache& cache = TranscodeCache::getInstance();
+	cache.clear();
+	uint8_t block_a[8];
+	uint8_t block_b[8];
+	store_be64(block_a, (0xFull << 60) | (0xFull << 56));
+	store_be64(block_b, (0x0ull << 60) | (0x0ull << 56));
+	uint8_t red = 0;
+	EXPECT_TRUE(cache.transcode(GL_COMPRESSED_RGB8_ETC2, block_a, sizeof(block_a), 4, 4, [&](const uint8_t* decoded) { red = decoded[0]; }));
+	EXPECT_EQ(red, 255);
+	EXPECT_TRUE(cache.transcode(GL_COMPRESSED_RGB8_ETC2, block_b, sizeof(block_b), 4, 4, [&](const uint8_t* decoded) { red = decoded[0]; }));
+	EXPECT_EQ(red, 2);
+	// 2つのエントリ(デコード結果と比較用のデータ)
+	EXPECT_EQ(cache.getCacheSize(), 2 * ((4 * 4 * 4) + sizeof(block_a)));
+	cache.clear();
+	EXPECT_EQ(cache.getCacheSize(), 0u);
+}
+
+// 複数のスレッド(コンテキスト)から同時に使用する
+TEST(TranscodeCache, ConcurrentUse)
+{
+	TranscodeCache& cache = TranscodeCache::getInstance();
+	cache.clear();
+	// 大きさの異なるイメージで、キャッシュの追い出しとキャッシュしないデコード結果を含める
+	const uint32_t sizes[] = { 16, 64, 256, 1600 };
+	std::atomic<int> mismatch_count{ 0 };
+	auto run = [&](uint32_t seed) {
+		for (uint32_t i = 0; i < 16; i++) {
+			uint32_t size = sizes[(i + seed) % 4];
+			uint8_t value = static_cast<uint8_t>((i * 3 + seed) & 0xF);
+			// 全てのブロックが個別モードの単色(R=G=B=value * 17、変化量+2)
+			std::vector<uint8_t> data((size / 4) * (size / 4) * 8, 0);
+			for (size_t b = 0; b < data.size(); b += 8) {
+				store_be64(&data[b], (static_cast<uint64_t>(value) * 0x111111ull) << 40);
+			}
+			uint8_t expected = clamp_u8((value * 17) + 2);
+			bool result = cache.transcode(GL_COMPRESSED_RGB8_ETC2, data.data(), data.size(), size, size, [&](const uint8_t* decoded) {
+				for (size_t p = 0; p < static_cast<size_t>(size) * size; p++) {
+					if (decoded[p * 4] != expected) {
+						mismatch_count++;
+						break;
+					}
+				}
+			});
+			EXPECT_TRUE(result);
+		}
+	};
+	std::thread thread_a(run, 0u);
+	std::thread thread_b(run, 1u);
+	run(2u);
+	thread_a.join();
+	thread_b.join();
+	EXPECT_EQ(mismatch_count.load(), 0);
+	cache.clear();
+}
@@ -0,0 +1,102 @@
+// TextureUploadQueueTest.cpp
+// 複数のスレッドからのタスクの登録と、ワーカースレッドの有効化、無効化の競合を確認する
+#include "common/TextureUploadQueue.h"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+std::atomic<int> s_executedCount{ 0 };
+std::atomic<bool> s_mismatch{ false };
+
+// ステージングメモリの内容を確認するタスク
+class CheckTask : public TextureUploadTask
+{
+public:
+	virtual void execute() override
+	{
+		const uint8_t* staging = getStagingMemory();
+		for (size_t i = 0; i < size; i++) {
+			if (staging[i] != value) {
+				s_mismatch = true;
+			}
+		}
+		s_executedCount++;
+	}
+
+	size_t size = 0;
+	uint8_t value = 0;
+};
+
+} // namespace
+
+TEST(TextureUploadQueue, DisabledQueueRejects)
+{
+	TextureUploadQueue& queue = TextureUploadQueue::getInstance();
+	queue.setEnabled(false);
+	CheckTask* task = queue.createTask<CheckTask>(64);
+	ASSERT_NE(task, nullptr);
+	EXPECT_EQ(queue.enqueue(task, 64), 0u);
+	// 破棄したタスクのステージングメモリはプールに戻り、無効化で解放される
+	TextureUploadQueue::Stats stats;
+	queue.getStats(&stats);
+	EXPECT_EQ(stats.stagingPoolSize, 64u);
+	queue.setEnabled(false);
+	queue.getStats(&stats);
+	EXPECT_EQ(stats.stagingPoolSize, 0u);
+}
+
+// 2つのスレッドが登録と完了待ちを繰り返す間に、ワーカースレッドを有効化、無効化する
+// 登録に成功したタスクは必ず完了し、waitが戻ること
+TEST(TextureUploadQueue, EnqueueWhileToggling)
+{
+	TextureUploadQueue& queue = TextureUploadQueue::getInstance();
+	queue.setEnabled(true);
+	s_executedCount = 0;
+	s_mismatch = false;
+	std::atomic<int> enqueued_count{ 0 };
+	std::atomic<bool> running{ true };
+	auto producer = [&](uint8_t seed) {
+		for (int i = 0; i < 500; i++) {
+			const size_t size = 1024 + static_cast<size_t>((i * 37 + seed) % 4096);
+			const uint8_t value = static_cast<uint8_t>(i + seed);
+			CheckTask* task = queue.createTask<CheckTask>(size);
+			ASSERT_NE(task, nullptr);
+			memset(task->getStagingMemory(), value, size);
+			task->size = size;
+			task->value = value;
+			uint64_t ticket = queue.enqueue(task, size);
+			if (ticket != 0) {
+				enqueued_count++;
+				// NOTE: 完了したタスクは他のスレッドのcreateTaskで破棄されるため、以降は参照しない
+				queue.wait(ticket);
+			}
+		}
+	};
+	std::thread toggle([&]() {
+		bool enable = false;
+		while (running) {
+			queue.setEnabled(enable);
+			enable = !enable;
+			std::this_thread::yield();
+		}
+	});
+	std::thread producer_a(producer, static_cast<uint8_t>(1));
+	std::thread producer_b(producer, static_cast<uint8_t>(2));
+	producer_a.join();
+	producer_b.join();
+	running = false;
+	toggle.join();
+	queue.setEnabled(false);
+	EXPECT_EQ(s_executedCount.load(), enqueued_count.load());
+	EXPECT_FALSE(s_mismatch.load());
+	TextureUploadQueue::Stats stats;
+	queue.getStats(&stats);
+	EXPECT_EQ(stats.queueDepth, 0u);
+}
@@ -0,0 +1,201 @@
+// VertexConversionTest.cpp
+// VertexConversionの変換結果を、GL ES 3.0の規則に従ったスカラーの参照実装と比較する
+#include "common/VertexConversion.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+constexpr size_t c_vertex_count = 37;
+
+// 参照実装
+float ref_fixed(int32_t value)
+{
+	return static_cast<float>(static_cast<double>(value) / 65536.0);
+}
+
+int32_t ref_sign_extend(uint32_t field, uint32_t bits)
+{
+	return (field & (1u << (bits - 1))) ? static_cast<int32_t>(field) - (1 << bits) : static_cast<int32_t>(field);
+}
+
+void ref_int2101010(float* dst, uint32_t packed, bool normalized)
+{
+	const uint32_t bits[4] = { 10, 10, 10, 2 };
+	uint32_t shift = 0;
+	for (int c = 0; c < 4; c++) {
+		int32_t value = ref_sign_extend((packed >> shift) & ((1u << bits[c]) - 1), bits[c]);
+		dst[c] = normalized ? std::max(static_cast<float>(value) / static_cast<float>((1 << (bits[c] - 1)) - 1), -1.0f) : static_cast<float>(value);
+		shift += bits[c];
+	}
+}
+
+void ref_uint2101010(float* dst, uint32_t packed, bool normalized)
+{
+	const uint32_t bits[4] = { 10, 10, 10, 2 };
+	uint32_t shift = 0;
+	for (int c = 0; c < 4; c++) {
+		uint32_t value = (packed >> shift) & ((1u << bits[c]) - 1);
+		dst[c] = normalized ? static_cast<float>(value) / static_cast<float>((1u << bits[c]) - 1) : static_cast<float>(value);
+		shift += bits[c];
+	}
+}
+
+// 頂点データを、指定のオフセットとストライドで配置する
+std::vector<uint8_t> make_vertices(const std::vector<uint32_t>& values, size_t components, size_t offset, size_t stride)
+{
+	size_t vertex_count = values.size() / components;
+	std::vector<uint8_t> data(offset + stride * vertex_count + 1, 0xcd);
+	for (size_t v = 0; v < vertex_count; v++) {
+		memcpy(&data[offset + stride * v], &values[v * components], sizeof(uint32_t) * components);
+	}
+	return data;
+}
+
+std::vector<uint32_t> make_values(size_t count, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::vector<uint32_t> values(count);
+	for (size_t i = 0; i < count; i++) {
+		values[i] = rng();
+	}
+	// 境界値
+	const uint32_t edges[] = { 0x00000000, 0xffffffff, 0x80000000, 0x7fffffff, 0x00010000, 0xffff0000, 0x00000200, 0x40000000, 0xc0000000 };
+	for (size_t i = 0; (i < (sizeof(edges) / sizeof(edges[0]))) && (i < count); i++) {
+		values[i] = edges[i];
+	}
+	return values;
+}
+
+float load_float(const std::vector<uint8_t>& data, size_t offset)
+{
+	float value;
+	memcpy(&value, &data[offset], sizeof(value));
+	return value;
+}
+
+} // namespace
+
+TEST(VertexConversion, AttribSize)
+{
+	EXPECT_EQ(getVertexAttribSize(GL_FIXED, 3), 12u);
+	EXPECT_EQ(getVertexAttribSize(GL_INT_2_10_10_10_REV, 4), 4u);
+	EXPECT_EQ(getVertexAttribSize(GL_UNSIGNED_INT_2_10_10_10_REV, 4), 4u);
+	EXPECT_EQ(getConvertedVertexAttribSize(GL_FIXED, 3), 12u);
+	EXPECT_EQ(getConvertedVertexAttribSize(GL_INT_2_10_10_10_REV, 4), 16u);
+	EXPECT_TRUE(needVertexFormatConversion(GL_FIXED, GL_FALSE));
+	EXPECT_TRUE(needVertexFormatConversion(GL_FIXED, GL_TRUE));
+	EXPECT_TRUE(needVertexFormatConversion(GL_INT_2_10_10_10_REV, GL_FALSE));
+	EXPECT_FALSE(needVertexFormatConversion(GL_INT_2_10_10_10_REV, GL_TRUE));
+	EXPECT_TRUE(needVertexFormatConversion(GL_UNSIGNED_INT_2_10_10_10_REV, GL_FALSE));
+	EXPECT_FALSE(needVertexFormatConversion(GL_UNSIGNED_INT_2_10_10_10_REV, GL_TRUE));
+	EXPECT_FALSE(needVertexFormatConversion(GL_FLOAT, GL_FALSE));
+}
+
+// 全ての要素数、ストライド、アライメントされていないsrcで比較する
+TEST(VertexConversion, FixedToFloat)
+{
+	for (GLint size = 1; size <= 4; size++) {
+		const size_t src_stride_list[] = { sizeof(int32_t) * size, sizeof(int32_t) * size + 3, 32 };
+		for (size_t src_stride : src_stride_list) {
+			for (size_t offset = 0; offset < 4; offset++) {
+				std::vector<uint32_t> values = make_values(c_vertex_count * size, static_cast<uint32_t>(size * 16 + offset));
+				std::vector<uint8_t> src = make_vertices(values, size, offset, src_stride);
+				const size_t dst_stride = sizeof(float) * size + 4;
+				std::vector<uint8_t> dst(dst_stride * c_vertex_count, 0xcd);
+				convertVertexAttrib(dst.data(), dst_stride, src.data() + offset, src_stride, c_vertex_count, GL_FIXED, size, GL_FALSE);
+				for (size_t v = 0; v < c_vertex_count; v++) {
+					for (GLint c = 0; c < size; c++) {
+						float expected = ref_fixed(static_cast<int32_t>(values[v * size + c]));
+						ASSERT_FLOAT_EQ(load_float(dst, dst_stride * v + sizeof(float) * c), expected)
+							<< "size=" << size << " stride=" << src_stride << " offset=" << offset << " v=" << v << " c=" << c;
+					}
+					// ストライドの隙間を書き換えていないこと
+					for (size_t i = sizeof(float) * size; i < dst_stride; i++) {
+						ASSERT_EQ(dst[dst_stride * v + i], 0xcd);
+					}
+				}
+			}
+		}
+	}
+}
+
+TEST(VertexConversion, Int2101010ToFloat)
+{
+	for (int normalized = 0; normalized < 2; normalized++) {
+		for (size_t src_stride : { size_t(4), size_t(7), size_t(16) }) {
+			for (size_t offset = 0; offset < 4; offset++) {
+				std::vector<uint32_t> values = make_values(c_vertex_count, static_cast<uint32_t>(100 + offset));
+				std::vector<uint8_t> src = make_vertices(values, 1, offset, src_stride);
+				const size_t dst_stride = sizeof(float) * 4 + 8;
+				std::vector<uint8_t> dst(dst_stride * c_vertex_count, 0xcd);
+				convertVertexAttrib(dst.data(), dst_stride, src.data() + offset, src_stride, c_vertex_count, GL_INT_2_10_10_10_REV, 4, normalized ? GL_TRUE : GL_FALSE);
+				for (size_t v = 0; v < c_vertex_count; v++) {
+					float expected[4];
+					ref_int2101010(expected, values[v], (normalized != 0));
+					for (int c = 0; c < 4; c++) {
+						ASSERT_FLOAT_EQ(load_float(dst, dst_stride * v + sizeof(float) * c), expected[c])
+							<< "normalized=" << normalized << " packed=" << std::hex << values[v] << " c=" << c;
+					}
+				}
+			}
+		}
+	}
+}
+
+TEST(VertexConversion, Int2101010Extremes)
+{
+	// x = -512(正規化で-1にクランプ), y = 511, z = -1, w = -2(正規化で-1にクランプ)
+	uint32_t packed = 0x200u | (0x1ffu << 10) | (0x3ffu << 20) | (0x2u << 30);
+	float dst[4];
+	convertVertexInt2101010ToFloat(dst, sizeof(dst), &packed, sizeof(packed), 1, false);
+	EXPECT_EQ(dst[0], -512.0f);
+	EXPECT_EQ(dst[1], 511.0f);
+	EXPECT_EQ(dst[2], -1.0f);
+	EXPECT_EQ(dst[3], -2.0f);
+	convertVertexInt2101010ToFloat(dst, sizeof(dst), &packed, sizeof(packed), 1, true);
+	EXPECT_EQ(dst[0], -1.0f);
+	EXPECT_EQ(dst[1], 1.0f);
+	EXPECT_FLOAT_EQ(dst[2], -1.0f / 511.0f);
+	EXPECT_EQ(dst[3], -1.0f);
+}
+
+TEST(VertexConversion, UInt2101010ToFloat)
+{
+	for (int normalized = 0; normalized < 2; normalized++) {
+		for (size_t src_stride : { size_t(4), size_t(5), size_t(12) }) {
+			for (size_t offset = 0; offset < 4; offset++) {
+				std::vector<uint32_t> values = make_values(c_vertex_count, static_cast<uint32_t>(200 + offset));
+				std::vector<uint8_t> src = make_vertices(values, 1, offset, src_stride);
+				const size_t dst_stride = sizeof(float) * 4;
+				std::vector<uint8_t> dst(dst_stride * c_vertex_count, 0xcd);
+				convertVertexAttrib(dst.data(), dst_stride, src.data() + offset, src_stride, c_vertex_count, GL_UNSIGNED_INT_2_10_10_10_REV, 4, normalized ? GL_TRUE : GL_FALSE);
+				for (size_t v = 0; v < c_vertex_count; v++) {
+					float expected[4];
+					ref_uint2101010(expected, values[v], (normalized != 0));
+					for (int c = 0; c < 4; c++) {
+						ASSERT_FLOAT_EQ(load_float(dst, dst_stride * v + sizeof(float) * c), expected[c])
+							<< "normalized=" << normalized << " packed=" << std::hex << values[v] << " c=" << c;
+					}
+				}
+			}
+		}
+	}
+}
+
+TEST(VertexConversion, ZeroVertices)
+{
+	uint32_t src = 0x12345678;
+	float dst[4] = { 1.0f, 2.0f, 3.0f, 4.0f };
+	convertVertexFixedToFloat(dst, sizeof(dst), &src, sizeof(src), 0, 4);
+	convertVertexInt2101010ToFloat(dst, sizeof(dst), &src, sizeof(src), 0, true);
+	convertVertexUInt2101010ToFloat(dst, sizeof(dst), &src, sizeof(src), 0, true);
+	EXPECT_EQ(dst[0], 1.0f);
+	EXPECT_EQ(dst[3], 4.0f);
+}
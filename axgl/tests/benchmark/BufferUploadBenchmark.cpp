@@ -0,0 +1,101 @@
+// BufferUploadBenchmark.cpp
+// 小さなglBufferSubDataを繰り返す場合の、CPU側の処理(シャドウバッファへの書き込み、範囲の管理、転送元へのコピー)の比較
+// NOTE: BufferMetalのsetSubDataと、次の描画でのステージング領域への転送を模したもの
+#include "common/DirtyRangeList.h"
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+constexpr size_t c_buffer_size = 64 * 1024;
+constexpr size_t c_update_size = 64;
+
+// 置き換え前の処理: 範囲全体だけを保持し、描画毎に全体をBlitの転送元にコピーする
+void BM_SubData_Union(benchmark::State& state)
+{
+	const size_t updates = static_cast<size_t>(state.range(0));
+	const size_t spacing = static_cast<size_t>(state.range(1));
+	std::vector<uint8_t> shadow(c_buffer_size);
+	std::vector<uint8_t> src_buffer(c_buffer_size);
+	uint8_t data[c_update_size] = {};
+	for (auto _ : state) {
+		intptr_t dirty_start = 0;
+		intptr_t dirty_end = 0;
+		for (size_t i = 0; i < updates; i++) {
+			intptr_t offset = static_cast<intptr_t>((i * spacing) % (c_buffer_size - c_update_size));
+			std::copy(data, data + c_update_size, shadow.data() + offset);
+			if (dirty_start == dirty_end) {
+				dirty_start = offset;
+				dirty_end = offset + c_update_size;
+			} else {
+				dirty_start = std::min(dirty_start, offset);
+				dirty_end = std::max<intptr_t>(dirty_end, offset + c_update_size);
+			}
+		}
+		memcpy(src_buffer.data() + dirty_start, shadow.data() + dirty_start, dirty_end - dirty_start);
+		benchmark::DoNotOptimize(src_buffer.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * updates));
+}
+
+// 書き換え毎にステージング領域にコピーする(1回の更新毎に1つのコピーコマンド)
+void BM_SubData_PerCall(benchmark::State& state)
+{
+	const size_t updates = static_cast<size_t>(state.range(0));
+	const size_t spacing = static_cast<size_t>(state.range(1));
+	std::vector<uint8_t> shadow(c_buffer_size);
+	std::vector<uint8_t> staging(updates * c_update_size);
+	uint8_t data[c_update_size] = {};
+	for (auto _ : state) {
+		size_t staging_offset = 0;
+		for (size_t i = 0; i < updates; i++) {
+			size_t offset = (i * spacing) % (c_buffer_size - c_update_size);
+			std::copy(data, data + c_update_size, shadow.data() + offset);
+			memcpy(staging.data() + staging_offset, shadow.data() + offset, c_update_size);
+			staging_offset += c_update_size;
+		}
+		benchmark::DoNotOptimize(staging.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * updates));
+}
+
+// DirtyRangeListで範囲を結合し、描画時に1回でステージング領域にまとめてコピーする
+void BM_SubData_Gathered(benchmark::State& state)
+{
+	const size_t updates = static_cast<size_t>(state.range(0));
+	const size_t spacing = static_cast<size_t>(state.range(1));
+	std::vector<uint8_t> shadow(c_buffer_size);
+	std::vector<uint8_t> staging(c_buffer_size);
+	uint8_t data[c_update_size] = {};
+	DirtyRangeList ranges;
+	for (auto _ : state) {
+		for (size_t i = 0; i < updates; i++) {
+			intptr_t offset = static_cast<intptr_t>((i * spacing) % (c_buffer_size - c_update_size));
+			std::copy(data, data + c_update_size, shadow.data() + offset);
+			ranges.add(offset, offset + c_update_size);
+		}
+		size_t start = 0;
+		size_t end = 0;
+		if (ranges.getAlignedExtent(c_buffer_size, c_buffer_size, &start, &end)) {
+			DirtyRangeList::gatherExtent(staging.data(), shadow.data(), shadow.size(), start, end);
+		}
+		ranges.clear();
+		benchmark::DoNotOptimize(staging.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * updates));
+}
+
+} // namespace
+
+// {更新回数, 更新の間隔(バイト数)}: 連続した更新と、まばらな更新
+BENCHMARK(BM_SubData_Union)->Args({ 256, 64 })->Args({ 256, 256 })->Args({ 16, 4096 });
+BENCHMARK(BM_SubData_PerCall)->Args({ 256, 64 })->Args({ 256, 256 })->Args({ 16, 4096 });
+BENCHMARK(BM_SubData_Gathered)->Args({ 256, 64 })->Args({ 256, 256 })->Args({ 16, 4096 });
@@ -0,0 +1,154 @@
+// IndexConversionBenchmark.cpp
+// インデックス変換のSIMD実装と、置き換え前のスカラーのループとの比較
+#include "common/IndexConversion.h"
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+template <typename T>
+std::vector<T> make_indices(size_t count)
+{
+	std::mt19937 rng(1);
+	std::vector<T> indices(count);
+	for (T& index : indices) {
+		index = static_cast<T>(rng());
+	}
+	return indices;
+}
+
+// 置き換え前のuint8→uint16の拡張(setupBufferInDrawのループ)
+void BM_WidenU8ToU16_Scalar(benchmark::State& state)
+{
+	const size_t count = static_cast<size_t>(state.range(0));
+	std::vector<uint8_t> src = make_indices<uint8_t>(count);
+	std::vector<uint16_t> dst(count);
+	for (auto _ : state) {
+		const uint8_t* sp = src.data();
+		uint16_t* dp = dst.data();
+		for (size_t i = 0; i < count; i++) {
+			dp[i] = sp[i];
+		}
+		benchmark::DoNotOptimize(dst.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+void BM_WidenU8ToU16(benchmark::State& state)
+{
+	const size_t count = static_cast<size_t>(state.range(0));
+	std::vector<uint8_t> src = make_indices<uint8_t>(count);
+	std::vector<uint16_t> dst(count);
+	for (auto _ : state) {
+		widenIndicesU8ToU16(dst.data(), src.data(), count);
+		benchmark::DoNotOptimize(dst.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+// 置き換え前のTriangleFan変換(要素毎のループ)
+void BM_TriFanU16_Scalar(benchmark::State& state)
+{
+	const size_t count = static_cast<size_t>(state.range(0));
+	std::vector<uint16_t> src = make_indices<uint16_t>(count);
+	std::vector<uint16_t> dst((count - 2) * 3);
+	for (auto _ : state) {
+		uint16_t* dp = dst.data();
+		for (size_t i = 0; (i + 2) < count; i++) {
+			*dp++ = src[0];
+			*dp++ = src[i + 1];
+			*dp++ = src[i + 2];
+		}
+		benchmark::DoNotOptimize(dst.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+void BM_TriFanU16(benchmark::State& state)
+{
+	const size_t count = static_cast<size_t>(state.range(0));
+	std::vector<uint16_t> src = make_indices<uint16_t>(count);
+	std::vector<uint16_t> dst((count - 2) * 3);
+	for (auto _ : state) {
+		convertTriFanIndicesU16(dst.data(), src.data(), count);
+		benchmark::DoNotOptimize(dst.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+void BM_LineLoopU8(benchmark::State& state)
+{
+	const size_t count = static_cast<size_t>(state.range(0));
+	std::vector<uint8_t> src = make_indices<uint8_t>(count);
+	std::vector<uint16_t> dst(count + 1);
+	for (auto _ : state) {
+		convertLineLoopIndicesU8(dst.data(), src.data(), count);
+		benchmark::DoNotOptimize(dst.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+// 置き換え前の最小値、最大値の走査
+void BM_ScanRangeU16_Scalar(benchmark::State& state)
+{
+	const size_t count = static_cast<size_t>(state.range(0));
+	std::vector<uint16_t> src = make_indices<uint16_t>(count);
+	for (auto _ : state) {
+		uint32_t min_index = UINT32_MAX;
+		uint32_t max_index = 0;
+		for (size_t i = 0; i < count; i++) {
+			min_index = std::min<uint32_t>(min_index, src[i]);
+			max_index = std::max<uint32_t>(max_index, src[i]);
+		}
+		benchmark::DoNotOptimize(min_index);
+		benchmark::DoNotOptimize(max_index);
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+void BM_ScanRangeU16(benchmark::State& state)
+{
+	const size_t count = static_cast<size_t>(state.range(0));
+	std::vector<uint16_t> src = make_indices<uint16_t>(count);
+	for (auto _ : state) {
+		uint32_t min_index, max_index;
+		scanIndexRangeU16(src.data(), count, false, &min_index, &max_index);
+		benchmark::DoNotOptimize(min_index);
+		benchmark::DoNotOptimize(max_index);
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+void BM_ScanRangeU32Restart(benchmark::State& state)
+{
+	const size_t count = static_cast<size_t>(state.range(0));
+	std::vector<uint32_t> src = make_indices<uint32_t>(count);
+	for (auto _ : state) {
+		uint32_t min_index, max_index;
+		scanIndexRangeU32(src.data(), count, true, &min_index, &max_index);
+		benchmark::DoNotOptimize(min_index);
+		benchmark::DoNotOptimize(max_index);
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+} // namespace
+
+BENCHMARK(BM_WidenU8ToU16_Scalar)->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_WidenU8ToU16)->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_TriFanU16_Scalar)->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_TriFanU16)->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_LineLoopU8)->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_ScanRangeU16_Scalar)->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_ScanRangeU16)->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_ScanRangeU32Restart)->Range(1 << 8, 1 << 20);
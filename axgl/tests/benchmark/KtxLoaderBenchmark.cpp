@@ -0,0 +1,155 @@
+// KtxLoaderBenchmark.cpp
+// KTX2ファイルの読み込み(bytes_per_secondはファイルのバイト数)
+// メモリにマップして各イメージを直接コピーする場合と、ファイル全体をバッファに読み込んでからコピーする場合の比較
+// NOTE: 2回目以降はページキャッシュから読み込むため、ストレージの速度は含まない
+#include "common/KtxLoader.h"
+#include "common/MappedFile.h"
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+// 2048x2048のRGBA8(全ミップレベル)
+constexpr uint32_t c_size = 2048;
+constexpr uint32_t c_levels = 12;
+
+void store_u32(std::vector<uint8_t>* bytes, size_t offset, uint32_t value)
+{
+	memcpy(bytes->data() + offset, &value, sizeof(value));
+}
+
+void store_u64(std::vector<uint8_t>* bytes, size_t offset, uint64_t value)
+{
+	memcpy(bytes->data() + offset, &value, sizeof(value));
+}
+
+std::vector<uint8_t> make_ktx2()
+{
+	static const uint8_t c_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	constexpr size_t c_header_size = 80;
+	constexpr size_t c_level_index_size = 24;
+	std::vector<uint8_t> bytes(c_header_size + (c_levels * c_level_index_size), 0);
+	memcpy(bytes.data(), c_identifier, sizeof(c_identifier));
+	store_u32(&bytes, 12, 37); // VK_FORMAT_R8G8B8A8_UNORM
+	store_u32(&bytes, 20, c_size);
+	store_u32(&bytes, 24, c_size);
+	store_u32(&bytes, 36, 1);
+	store_u32(&bytes, 40, c_levels);
+	for (uint32_t i = 0; i < c_levels; i++) {
+		uint32_t level = c_levels - 1 - i;
+		size_t extent = c_size >> level;
+		size_t length = extent * extent * 4;
+		size_t offset = bytes.size();
+		bytes.resize(offset + length, static_cast<uint8_t>(level));
+		size_t index = c_header_size + (level * c_level_index_size);
+		store_u64(&bytes, index, offset);
+		store_u64(&bytes, index + 8, length);
+		store_u64(&bytes, index + 16, length);
+	}
+	return bytes;
+}
+
+// ベンチマークで読み込むファイル(最初の使用時に一時ディレクトリに作成)
+const std::string& get_file_path()
+{
+	static const std::string s_path = []() {
+		const char* temp_dir = std::getenv("TMPDIR");
+		std::string path = std::string((temp_dir != nullptr) ? temp_dir : "/tmp") + "/axgl_ktx_loader_benchmark.ktx2";
+		std::vector<uint8_t> bytes = make_ktx2();
+		std::FILE* fp = std::fopen(path.c_str(), "wb");
+		if (fp != nullptr) {
+			std::fwrite(bytes.data(), 1, bytes.size(), fp);
+			std::fclose(fp);
+		}
+		return path;
+	}();
+	return s_path;
+}
+
+// 各イメージをテクスチャのストレージに転送する代わりにコピーする
+void copy_images(const KtxTexture& texture, uint8_t* dst)
+{
+	for (uint32_t level = 0; level < texture.levels; level++) {
+		const KtxImage& image = texture.images[level][0];
+		memcpy(dst, image.data, image.size);
+		dst += image.size;
+	}
+	return;
+}
+
+// メモリにマップして、マップしたデータから直接コピーする(axglTexImageKTXFile)
+void BM_LoadMappedFile(benchmark::State& state)
+{
+	const std::string& path = get_file_path();
+	std::vector<uint8_t> dst(c_size * c_size * 4 * 2);
+	size_t file_size = 0;
+	for (auto _ : state) {
+		MappedFile file;
+		KtxTexture texture;
+		if (!file.open(path.c_str()) || !parseKtxTexture(file.getData(), file.getSize(), &texture)) {
+			state.SkipWithError("load failed");
+			break;
+		}
+		copy_images(texture, dst.data());
+		file_size = file.getSize();
+		benchmark::DoNotOptimize(dst.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file_size));
+}
+
+// ファイル全体をバッファに読み込んでからコピーする
+void BM_LoadReadFile(benchmark::State& state)
+{
+	const std::string& path = get_file_path();
+	std::vector<uint8_t> dst(c_size * c_size * 4 * 2);
+	size_t file_size = 0;
+	for (auto _ : state) {
+		std::FILE* fp = std::fopen(path.c_str(), "rb");
+		if (fp == nullptr) {
+			state.SkipWithError("open failed");
+			break;
+		}
+		std::fseek(fp, 0, SEEK_END);
+		std::vector<uint8_t> bytes(static_cast<size_t>(std::ftell(fp)));
+		std::fseek(fp, 0, SEEK_SET);
+		size_t read_size = std::fread(bytes.data(), 1, bytes.size(), fp);
+		std::fclose(fp);
+		KtxTexture texture;
+		if ((read_size != bytes.size()) || !parseKtxTexture(bytes.data(), bytes.size(), &texture)) {
+			state.SkipWithError("load failed");
+			break;
+		}
+		copy_images(texture, dst.data());
+		file_size = bytes.size();
+		benchmark::DoNotOptimize(dst.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file_size));
+}
+
+// ヘッダの検証とイメージの位置の取得のみ
+void BM_ParseKtx2(benchmark::State& state)
+{
+	std::vector<uint8_t> bytes = make_ktx2();
+	for (auto _ : state) {
+		KtxTexture texture;
+		bool result = parseKtxTexture(bytes.data(), bytes.size(), &texture);
+		benchmark::DoNotOptimize(result);
+		benchmark::DoNotOptimize(texture.images[0][0].data);
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+} // namespace
+
+BENCHMARK(BM_LoadMappedFile)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadReadFile)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ParseKtx2);
@@ -0,0 +1,110 @@
+// MipmapGenerationBenchmark.cpp
+// CPUでのミップマップチェーンの生成と、ピクセルごとに処理するスカラーのループとの比較(bytes_per_secondはレベル0のバイト数)
+#include "common/MipmapGeneration.h"
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+std::vector<uint8_t> make_chain(size_t size)
+{
+	std::mt19937 rng(1);
+	std::vector<uint8_t> bytes(size);
+	for (uint8_t& value : bytes) {
+		value = static_cast<uint8_t>(rng() & 0x3f);
+	}
+	return bytes;
+}
+
+// スカラーのループ --------
+void scalar_chain_rgba8(uint8_t* data, uint32_t width, uint32_t height, uint32_t levels)
+{
+	uint8_t* src = data;
+	for (uint32_t level = 1; level < levels; level++) {
+		uint32_t dst_width = std::max(1u, width / 2);
+		uint32_t dst_height = std::max(1u, height / 2);
+		uint8_t* dst = src + (static_cast<size_t>(width) * height * 4);
+		for (uint32_t y = 0; y < dst_height; y++) {
+			const uint8_t* row0 = src + (static_cast<size_t>(std::min(y * 2, height - 1)) * width * 4);
+			const uint8_t* row1 = src + (static_cast<size_t>(std::min(y * 2 + 1, height - 1)) * width * 4);
+			for (uint32_t x = 0; x < dst_width; x++) {
+				uint32_t x0 = std::min(x * 2, width - 1) * 4;
+				uint32_t x1 = std::min(x * 2 + 1, width - 1) * 4;
+				for (uint32_t c = 0; c < 4; c++) {
+					uint32_t sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+					dst[((static_cast<size_t>(y) * dst_width) + x) * 4 + c] = static_cast<uint8_t>((sum + 2) >> 2);
+				}
+			}
+		}
+		src = dst;
+		width = dst_width;
+		height = dst_height;
+	}
+}
+
+uint32_t level_count(uint32_t size)
+{
+	uint32_t levels = 1;
+	while ((size >> levels) != 0) {
+		levels++;
+	}
+	return levels;
+}
+
+// 生成関数の測定 --------
+
+// 2Dのミップマップチェーン(arg: 辺のサイズ)
+void BM_ScalarChainRGBA8(benchmark::State& state)
+{
+	const uint32_t size = static_cast<uint32_t>(state.range(0));
+	const uint32_t levels = level_count(size);
+	std::vector<uint8_t> chain = make_chain(getMipmapChainSize(MipmapPixelFormatRGBA8, size, size, levels));
+	for (auto _ : state) {
+		scalar_chain_rgba8(chain.data(), size, size, levels);
+		benchmark::DoNotOptimize(chain.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size * size * 4));
+}
+
+void BM_GenerateChain(benchmark::State& state, MipmapPixelFormat format)
+{
+	const uint32_t size = static_cast<uint32_t>(state.range(0));
+	const uint32_t levels = level_count(size);
+	std::vector<uint8_t> chain = make_chain(getMipmapChainSize(format, size, size, levels));
+	for (auto _ : state) {
+		generateMipmapChain(format, chain.data(), size, size, levels);
+		benchmark::DoNotOptimize(chain.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size * size * getMipmapPixelSize(format)));
+}
+
+// 3Dのミップマップチェーン(arg: 辺のサイズ)
+void BM_GenerateChain3D(benchmark::State& state, MipmapPixelFormat format)
+{
+	const uint32_t size = static_cast<uint32_t>(state.range(0));
+	const uint32_t levels = level_count(size);
+	std::vector<uint8_t> chain = make_chain(getMipmapChainSize3D(format, size, size, size, levels));
+	for (auto _ : state) {
+		generateMipmapChain3D(format, chain.data(), size, size, size, levels);
+		benchmark::DoNotOptimize(chain.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size * size * size * getMipmapPixelSize(format)));
+}
+
+} // namespace
+
+BENCHMARK(BM_ScalarChainRGBA8)->Arg(256)->Arg(2048)->UseRealTime();
+BENCHMARK_CAPTURE(BM_GenerateChain, RGBA8, MipmapPixelFormatRGBA8)->Arg(256)->Arg(2048)->UseRealTime();
+BENCHMARK_CAPTURE(BM_GenerateChain, SRGB8A8, MipmapPixelFormatSRGB8A8)->Arg(256)->Arg(2048)->UseRealTime();
+BENCHMARK_CAPTURE(BM_GenerateChain, R8, MipmapPixelFormatR8)->Arg(2048)->UseRealTime();
+BENCHMARK_CAPTURE(BM_GenerateChain, RGBA32F, MipmapPixelFormatRGBA32F)->Arg(2048)->UseRealTime();
+BENCHMARK_CAPTURE(BM_GenerateChain3D, RGBA8, MipmapPixelFormatRGBA8)->Arg(128)->UseRealTime();
+BENCHMARK_CAPTURE(BM_GenerateChain3D, R32F, MipmapPixelFormatR32F)->Arg(128)->UseRealTime();
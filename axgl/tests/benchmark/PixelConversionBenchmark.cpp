@@ -0,0 +1,232 @@
+// PixelConversionBenchmark.cpp
+// ピクセル変換と、ピクセルごとに変換するスカラーのループとの比較(bytes_per_secondはsrcのバイト数)
+#include "common/PixelConversion.h"
+
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+// 1024x1024のイメージ
+constexpr size_t c_pixel_count = 1024 * 1024;
+
+std::vector<uint8_t> make_bytes(size_t size)
+{
+	std::mt19937 rng(1);
+	std::vector<uint8_t> bytes(size);
+	for (uint8_t& value : bytes) {
+		value = static_cast<uint8_t>(rng());
+	}
+	return bytes;
+}
+
+// スカラーのループ --------
+void scalar_rgb8(void* dst, const void* src, size_t count)
+{
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	for (size_t i = 0; i < count; i++) {
+		dp[i * 4 + 0] = sp[i * 3 + 0];
+		dp[i * 4 + 1] = sp[i * 3 + 1];
+		dp[i * 4 + 2] = sp[i * 3 + 2];
+		dp[i * 4 + 3] = 0xff;
+	}
+}
+
+void scalar_rgb565(void* dst, const void* src, size_t count)
+{
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	for (size_t i = 0; i < count; i++) {
+		uint16_t p;
+		memcpy(&p, sp + i * 2, sizeof(p));
+		uint32_t r = (p >> 11) & 0x1f;
+		uint32_t g = (p >> 5) & 0x3f;
+		uint32_t b = p & 0x1f;
+		dp[i * 4 + 0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+		dp[i * 4 + 1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+		dp[i * 4 + 2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+		dp[i * 4 + 3] = 0xff;
+	}
+}
+
+void scalar_rgba4444(void* dst, const void* src, size_t count)
+{
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	for (size_t i = 0; i < count; i++) {
+		uint16_t p;
+		memcpy(&p, sp + i * 2, sizeof(p));
+		for (int c = 0; c < 4; c++) {
+			uint32_t v = (p >> (12 - c * 4)) & 0xf;
+			dp[i * 4 + c] = static_cast<uint8_t>((v << 4) | v);
+		}
+	}
+}
+
+void scalar_rgba5551(void* dst, const void* src, size_t count)
+{
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	for (size_t i = 0; i < count; i++) {
+		uint16_t p;
+		memcpy(&p, sp + i * 2, sizeof(p));
+		for (int c = 0; c < 3; c++) {
+			uint32_t v = (p >> (11 - c * 5)) & 0x1f;
+			dp[i * 4 + c] = static_cast<uint8_t>((v << 3) | (v >> 2));
+		}
+		dp[i * 4 + 3] = (p & 1) ? 0xff : 0;
+	}
+}
+
+void scalar_luminance(void* dst, const void* src, size_t count)
+{
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	for (size_t i = 0; i < count; i++) {
+		dp[i * 4 + 0] = dp[i * 4 + 1] = dp[i * 4 + 2] = sp[i];
+		dp[i * 4 + 3] = 0xff;
+	}
+}
+
+void scalar_luminance_alpha(void* dst, const void* src, size_t count)
+{
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	for (size_t i = 0; i < count; i++) {
+		dp[i * 4 + 0] = dp[i * 4 + 1] = dp[i * 4 + 2] = sp[i * 2];
+		dp[i * 4 + 3] = sp[i * 2 + 1];
+	}
+}
+
+void scalar_alpha(void* dst, const void* src, size_t count)
+{
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	for (size_t i = 0; i < count; i++) {
+		dp[i * 4 + 0] = dp[i * 4 + 1] = dp[i * 4 + 2] = 0;
+		dp[i * 4 + 3] = sp[i];
+	}
+}
+
+void scalar_swizzle(void* dst, const void* src, size_t count)
+{
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	for (size_t i = 0; i < count; i++) {
+		uint8_t b = sp[i * 4 + 0];
+		dp[i * 4 + 0] = sp[i * 4 + 2];
+		dp[i * 4 + 1] = sp[i * 4 + 1];
+		dp[i * 4 + 2] = b;
+		dp[i * 4 + 3] = sp[i * 4 + 3];
+	}
+}
+
+void scalar_half(void* dst, const void* src, size_t count)
+{
+	uint8_t* dp = static_cast<uint8_t*>(dst);
+	const uint8_t* sp = static_cast<const uint8_t*>(src);
+	for (size_t i = 0; i < count; i++) {
+		uint16_t h;
+		memcpy(&h, sp + i * 2, sizeof(h));
+		uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+		uint32_t exponent = (h >> 10) & 0x1f;
+		uint32_t mantissa = h & 0x3ff;
+		uint32_t bits;
+		if (exponent == 0) {
+			// 非正規化数は0として扱う(分岐を含むスカラーの比較用)
+			bits = sign;
+		} else if (exponent == 0x1f) {
+			bits = sign | 0x7f800000 | (mantissa << 13);
+		} else {
+			bits = sign | ((exponent + (127 - 15)) << 23) | (mantissa << 13);
+		}
+		memcpy(dp + i * 4, &bits, sizeof(bits));
+	}
+}
+
+// 変換関数の測定 --------
+using Conversion = void (*)(void* dst, const void* src, size_t count);
+
+void run_conversion(benchmark::State& state, Conversion conversion, size_t srcPixelSize, size_t dstPixelSize)
+{
+	std::vector<uint8_t> src = make_bytes(c_pixel_count * srcPixelSize);
+	std::vector<uint8_t> dst(c_pixel_count * dstPixelSize);
+	for (auto _ : state) {
+		conversion(dst.data(), src.data(), c_pixel_count);
+		benchmark::DoNotOptimize(dst.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * c_pixel_count * srcPixelSize));
+}
+
+void rgb8_to_rgba8(void* dst, const void* src, size_t count)
+{
+	convertPixelsRGB8ToRGBA8(dst, src, count, 0xff);
+}
+
+void half_to_float(void* dst, const void* src, size_t count)
+{
+	// NOTE: RGBA16Fの4要素
+	convertHalfToFloat(dst, src, count * 4);
+}
+
+void scalar_half4(void* dst, const void* src, size_t count)
+{
+	scalar_half(dst, src, count * 4);
+}
+
+// 1024x1024のBGRA8を上下反転とR,Bの入れ替えを行いながらコピーする
+void BM_CopyImageRows(benchmark::State& state)
+{
+	constexpr size_t c_size = 1024;
+	const bool flip_y = (state.range(0) != 0);
+	const bool swizzle = (state.range(1) != 0);
+	std::vector<uint8_t> src = make_bytes(c_size * c_size * 4);
+	std::vector<uint8_t> dst(src.size());
+	for (auto _ : state) {
+		copyImageRows(dst.data(), c_size * 4, src.data(), c_size * 4, c_size * 4, c_size, flip_y, swizzle);
+		benchmark::DoNotOptimize(dst.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * src.size()));
+}
+
+void BM_FlipImageRows(benchmark::State& state)
+{
+	constexpr size_t c_size = 1024;
+	std::vector<uint8_t> pixels = make_bytes(c_size * c_size * 4);
+	for (auto _ : state) {
+		flipImageRows(pixels.data(), c_size * 4, c_size);
+		benchmark::DoNotOptimize(pixels.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * pixels.size()));
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(run_conversion, RGB8_Scalar, scalar_rgb8, 3, 4);
+BENCHMARK_CAPTURE(run_conversion, RGB8, rgb8_to_rgba8, 3, 4);
+BENCHMARK_CAPTURE(run_conversion, RGB565_Scalar, scalar_rgb565, 2, 4);
+BENCHMARK_CAPTURE(run_conversion, RGB565, convertPixelsRGB565ToRGBA8, 2, 4);
+BENCHMARK_CAPTURE(run_conversion, RGBA4444_Scalar, scalar_rgba4444, 2, 4);
+BENCHMARK_CAPTURE(run_conversion, RGBA4444, convertPixelsRGBA4444ToRGBA8, 2, 4);
+BENCHMARK_CAPTURE(run_conversion, RGBA5551_Scalar, scalar_rgba5551, 2, 4);
+BENCHMARK_CAPTURE(run_conversion, RGBA5551, convertPixelsRGBA5551ToRGBA8, 2, 4);
+BENCHMARK_CAPTURE(run_conversion, Luminance_Scalar, scalar_luminance, 1, 4);
+BENCHMARK_CAPTURE(run_conversion, Luminance, convertPixelsLuminanceToRGBA8, 1, 4);
+BENCHMARK_CAPTURE(run_conversion, LuminanceAlpha_Scalar, scalar_luminance_alpha, 2, 4);
+BENCHMARK_CAPTURE(run_conversion, LuminanceAlpha, convertPixelsLuminanceAlphaToRGBA8, 2, 4);
+BENCHMARK_CAPTURE(run_conversion, Alpha_Scalar, scalar_alpha, 1, 4);
+BENCHMARK_CAPTURE(run_conversion, Alpha, convertPixelsAlphaToRGBA8, 1, 4);
+BENCHMARK_CAPTURE(run_conversion, SwizzleBGRA8_Scalar, scalar_swizzle, 4, 4);
+BENCHMARK_CAPTURE(run_conversion, SwizzleBGRA8, swizzlePixelsBGRA8ToRGBA8, 4, 4);
+BENCHMARK_CAPTURE(run_conversion, HalfToFloat_Scalar, scalar_half4, 8, 16);
+BENCHMARK_CAPTURE(run_conversion, HalfToFloat, half_to_float, 8, 16);
+BENCHMARK(BM_CopyImageRows)->Args({ 0, 0 })->Args({ 1, 0 })->Args({ 1, 1 });
+BENCHMARK(BM_FlipImageRows);
@@ -0,0 +1,98 @@
+// TextureTranscoderBenchmark.cpp
+// 圧縮テクスチャのデコードと、TranscodeCacheのヒット時のコスト(bytes_per_secondはデコード後のバイト数)
+#include "common/TextureTranscoder.h"
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+// 1024x1024のイメージ
+constexpr uint32_t c_image_size = 1024;
+
+// ETC2/EACのブロック(ランダムなビット列は全てのモードを含む)
+std::vector<uint8_t> make_random_blocks(size_t size)
+{
+	std::mt19937 rng(1);
+	std::vector<uint8_t> bytes(size);
+	for (uint8_t& value : bytes) {
+		value = static_cast<uint8_t>(rng());
+	}
+	return bytes;
+}
+
+// ASTCのブロック(ランダムなビット列はほとんどがエラーのブロックになるため、
+// 1パーティション、CEM 8、4x4のウェイトグリッドの有効なブロックを組み立てる)
+std::vector<uint8_t> make_astc_blocks(size_t blockCount)
+{
+	std::mt19937 rng(1);
+	std::vector<uint8_t> bytes(blockCount * 16, 0);
+	auto write = [](uint8_t* block, uint32_t pos, uint32_t count, uint32_t value) {
+		for (uint32_t i = 0; i < count; i++) {
+			if ((value >> i) & 1) {
+				block[(pos + i) / 8] |= static_cast<uint8_t>(1 << ((pos + i) % 8));
+			}
+		}
+	};
+	for (size_t b = 0; b < blockCount; b++) {
+		uint8_t* block = &bytes[b * 16];
+		write(block, 0, 11, 0x53);
+		write(block, 13, 4, 8);
+		for (uint32_t i = 0; i < 6; i++) {
+			write(block, 17 + (i * 8), 8, rng() & 0xFF);
+		}
+		for (uint32_t i = 0; i < 48; i++) {
+			write(block, 127 - i, 1, rng() & 1);
+		}
+	}
+	return bytes;
+}
+
+void BM_Transcode(benchmark::State& state, GLenum internalformat, bool astc)
+{
+	CompressedFormatInfo info;
+	if (!getCompressedFormatInfo(internalformat, &info)) {
+		state.SkipWithError("unsupported format");
+		return;
+	}
+	const size_t block_count = static_cast<size_t>((c_image_size + info.blockWidth - 1) / info.blockWidth)
+		* ((c_image_size + info.blockHeight - 1) / info.blockHeight);
+	std::vector<uint8_t> data = astc ? make_astc_blocks(block_count) : make_random_blocks(block_count * info.blockBytes);
+	const size_t pixel_size = getTranscodedPixelSize(info.transcodedFormat);
+	std::vector<uint8_t> dst(pixel_size * c_image_size * c_image_size);
+	for (auto _ : state) {
+		transcodeCompressedImage(internalformat, data.data(), data.size(), c_image_size, c_image_size, dst.data(), pixel_size * c_image_size);
+		benchmark::DoNotOptimize(dst.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * dst.size()));
+}
+
+// キャッシュにヒットした場合(ハッシュと圧縮データの比較)
+void BM_TranscodeCacheHit(benchmark::State& state)
+{
+	const size_t size = static_cast<size_t>(state.range(0));
+	std::vector<uint8_t> data = make_random_blocks((size / 4) * (size / 4) * 8);
+	TranscodeCache& cache = TranscodeCache::getInstance();
+	cache.clear();
+	for (auto _ : state) {
+		cache.transcode(GL_COMPRESSED_RGB8_ETC2, data.data(), data.size(), static_cast<uint32_t>(size), static_cast<uint32_t>(size),
+			[](const uint8_t* decoded) { benchmark::DoNotOptimize(decoded); });
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size * size * 4));
+	cache.clear();
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_Transcode, ETC2_RGB8, GL_COMPRESSED_RGB8_ETC2, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Transcode, ETC2_RGBA8_EAC, GL_COMPRESSED_RGBA8_ETC2_EAC, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Transcode, ETC2_SRGB8, GL_COMPRESSED_SRGB8_ETC2, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Transcode, EAC_R11, GL_COMPRESSED_R11_EAC, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Transcode, EAC_RG11, GL_COMPRESSED_RG11_EAC, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Transcode, ASTC_4x4, GL_COMPRESSED_RGBA_ASTC_4x4_KHR, true)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Transcode, ASTC_8x8, GL_COMPRESSED_RGBA_ASTC_8x8_KHR, true)->UseRealTime();
+BENCHMARK(BM_TranscodeCacheHit)->Arg(256)->Arg(1024);
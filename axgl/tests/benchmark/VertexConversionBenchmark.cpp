@@ -0,0 +1,107 @@
+// VertexConversionBenchmark.cpp
+// 頂点フォーマット変換と、要素ごとに変換するスカラーのループとの比較
+#include "common/VertexConversion.h"
+
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace axgl;
+
+namespace {
+
+std::vector<uint32_t> make_values(size_t count)
+{
+	std::mt19937 rng(1);
+	std::vector<uint32_t> values(count);
+	for (uint32_t& value : values) {
+		value = rng();
+	}
+	return values;
+}
+
+// 要素ごとに変換するスカラーのループ(GL_FIXED、4要素)
+void BM_FixedToFloat4_Scalar(benchmark::State& state)
+{
+	const size_t count = static_cast<size_t>(state.range(0));
+	std::vector<uint32_t> src = make_values(count * 4);
+	std::vector<float> dst(count * 4);
+	for (auto _ : state) {
+		const int32_t* sp = reinterpret_cast<const int32_t*>(src.data());
+		float* dp = dst.data();
+		for (size_t i = 0; i < (count * 4); i++) {
+			dp[i] = static_cast<float>(sp[i]) / 65536.0f;
+		}
+		benchmark::DoNotOptimize(dst.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * count * 16));
+}
+
+void BM_FixedToFloat(benchmark::State& state)
+{
+	const size_t count = static_cast<size_t>(state.range(0));
+	const GLint size = static_cast<GLint>(state.range(1));
+	std::vector<uint32_t> src = make_values(count * size);
+	std::vector<float> dst(count * size);
+	for (auto _ : state) {
+		convertVertexFixedToFloat(dst.data(), sizeof(float) * size, src.data(), sizeof(int32_t) * size, count, size);
+		benchmark::DoNotOptimize(dst.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * count * sizeof(int32_t) * size));
+}
+
+// インターリーブされた頂点(ストライド32バイト)からの変換
+void BM_FixedToFloat4_Interleaved(benchmark::State& state)
+{
+	const size_t count = static_cast<size_t>(state.range(0));
+	constexpr size_t c_stride = 32;
+	std::vector<uint8_t> src(count * c_stride);
+	std::vector<uint32_t> values = make_values(count * c_stride / 4);
+	memcpy(src.data(), values.data(), src.size());
+	std::vector<float> dst(count * 4);
+	for (auto _ : state) {
+		convertVertexFixedToFloat(dst.data(), sizeof(float) * 4, src.data(), c_stride, count, 4);
+		benchmark::DoNotOptimize(dst.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * count * 16));
+}
+
+void BM_Int2101010ToFloat(benchmark::State& state)
+{
+	const size_t count = static_cast<size_t>(state.range(0));
+	const bool normalized = (state.range(1) != 0);
+	std::vector<uint32_t> src = make_values(count);
+	std::vector<float> dst(count * 4);
+	for (auto _ : state) {
+		convertVertexInt2101010ToFloat(dst.data(), sizeof(float) * 4, src.data(), sizeof(uint32_t), count, normalized);
+		benchmark::DoNotOptimize(dst.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * count * sizeof(uint32_t)));
+}
+
+void BM_UInt2101010ToFloat(benchmark::State& state)
+{
+	const size_t count = static_cast<size_t>(state.range(0));
+	const bool normalized = (state.range(1) != 0);
+	std::vector<uint32_t> src = make_values(count);
+	std::vector<float> dst(count * 4);
+	for (auto _ : state) {
+		convertVertexUInt2101010ToFloat(dst.data(), sizeof(float) * 4, src.data(), sizeof(uint32_t), count, normalized);
+		benchmark::DoNotOptimize(dst.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * count * sizeof(uint32_t)));
+}
+
+} // namespace
+
+BENCHMARK(BM_FixedToFloat4_Scalar)->Arg(1024)->Arg(65536);
+BENCHMARK(BM_FixedToFloat)->Args({ 1024, 4 })->Args({ 65536, 4 })->Args({ 65536, 3 })->Args({ 65536, 2 });
+BENCHMARK(BM_FixedToFloat4_Interleaved)->Arg(65536);
+BENCHMARK(BM_Int2101010ToFloat)->Args({ 65536, 0 })->Args({ 65536, 1 });
+BENCHMARK(BM_UInt2101010ToFloat)->Args({ 65536, 0 })->Args({ 65536, 1 });